@@ -0,0 +1,57 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_BENCHMARK_H
+#define FS_BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A benchmark runs its operation the given number of times, everything it
+// needs is prepared before it is added so only the operation is timed.
+using BenchmarkFunction = std::function<void(uint64_t iterations)>;
+
+struct BenchmarkResult {
+	std::string name;
+	uint64_t iterations = 0;
+	double nsPerOp = 0;
+	double minNsPerOp = 0;
+	double maxNsPerOp = 0;
+};
+
+class Benchmarks
+{
+	public:
+		void add(std::string name, BenchmarkFunction function);
+
+		// every benchmark whose name contains filter runs repetitions times, each
+		// run with as many iterations as take at least minTime
+		std::vector<BenchmarkResult> run(std::string_view filter, std::chrono::milliseconds minTime, uint32_t repetitions) const;
+
+	private:
+		struct Entry {
+			std::string name;
+			BenchmarkFunction function;
+		};
+
+		std::vector<Entry> entries;
+};
+
+// keeps the compiler from dropping a result the benchmark never reads
+template <typename T>
+void doNotOptimize(const T& value)
+{
+	static const volatile void* sink;
+	sink = &value;
+}
+
+void registerNetworkBenchmarks(Benchmarks& benchmarks);
+void registerItemBenchmarks(Benchmarks& benchmarks);
+void registerMapBenchmarks(Benchmarks& benchmarks);
+void registerDispatcherBenchmarks(Benchmarks& benchmarks);
+
+#endif
@@ -0,0 +1,79 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "benchmark.h"
+
+#include "tasks.h"
+
+#include <future>
+
+namespace {
+
+// a dispatcher of its own, the one of the engine stays untouched
+class BenchDispatcher
+{
+	public:
+		BenchDispatcher() {
+			dispatcher.start();
+		}
+
+		~BenchDispatcher() {
+			dispatcher.shutdown();
+			dispatcher.join();
+		}
+
+		Dispatcher dispatcher;
+};
+
+BenchDispatcher& getBenchDispatcher()
+{
+	static BenchDispatcher instance;
+	return instance;
+}
+
+// queues every task from this thread and waits until the dispatcher ran
+// them, whatever order its lanes pick them in
+void runTasks(uint64_t iterations, bool batched)
+{
+	Dispatcher& dispatcher = getBenchDispatcher().dispatcher;
+
+	uint64_t counter = 0;
+	std::promise<void> done;
+	std::future<void> finished = done.get_future();
+
+	std::vector<Task*> tasks;
+	for (uint64_t i = 0; i < iterations; ++i) {
+		Task* task = createTask([&counter, &done, iterations]() {
+			if (++counter == iterations) {
+				done.set_value();
+			}
+		}, i % 2 == 0 ? DISPATCHER_LANE_PLAYER : DISPATCHER_LANE_DEFAULT);
+
+		if (batched) {
+			tasks.push_back(task);
+		} else {
+			dispatcher.addTask(task);
+		}
+	}
+	if (batched) {
+		dispatcher.addTasks(tasks);
+	}
+
+	finished.wait();
+	doNotOptimize(counter);
+}
+
+}
+
+void registerDispatcherBenchmarks(Benchmarks& benchmarks)
+{
+	benchmarks.add("dispatcher/addTask", [](uint64_t iterations) {
+		runTasks(iterations, false);
+	});
+
+	benchmarks.add("dispatcher/addTasks", [](uint64_t iterations) {
+		runTasks(iterations, true);
+	});
+}
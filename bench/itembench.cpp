@@ -0,0 +1,100 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "benchmark.h"
+
+#include "fileloader.h"
+#include "item.h"
+#include "tools.h"
+
+namespace {
+
+// ids spread over the loaded item types, in an order that defeats the cache
+std::vector<uint16_t> sampleItemIds(size_t count)
+{
+	std::vector<uint16_t> ids;
+	for (size_t id = 100; id < Item::items.size() && ids.size() < count; id += 7) {
+		if (Item::items[id].id != 0) {
+			ids.push_back(static_cast<uint16_t>(id));
+		}
+	}
+	std::ranges::shuffle(ids, getRandomGenerator());
+	return ids;
+}
+
+ItemPtr makeAttributedItem()
+{
+	const std::vector<uint16_t> ids = sampleItemIds(1);
+	ItemPtr item = Item::CreateItem(ids.empty() ? 100 : ids.front());
+	item->setSpecialDescription("It was forged for the benchmarks.");
+	item->setText("Property of the benchmark guild.");
+	item->setWriter("Benchmark Player");
+	item->setDate(1700000000);
+	item->setActionId(1000);
+	return item;
+}
+
+}
+
+void registerItemBenchmarks(Benchmarks& benchmarks)
+{
+	benchmarks.add("items/getItemType", [](uint64_t iterations) {
+		const std::vector<uint16_t> ids = sampleItemIds(4096);
+		if (ids.empty()) {
+			return;
+		}
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			doNotOptimize(Item::items.getItemType(ids[i % ids.size()]).weight);
+		}
+	});
+
+	benchmarks.add("items/getItemIdByClientId", [](uint64_t iterations) {
+		std::vector<uint16_t> clientIds;
+		for (uint16_t id : sampleItemIds(4096)) {
+			clientIds.push_back(Item::items[id].clientId);
+		}
+		if (clientIds.empty()) {
+			return;
+		}
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			doNotOptimize(Item::items.getItemIdByClientId(clientIds[i % clientIds.size()]).id);
+		}
+	});
+
+	benchmarks.add("items/getItemIdByName", [](uint64_t iterations) {
+		std::vector<std::string> names;
+		for (uint16_t id : sampleItemIds(1024)) {
+			if (!Item::items[id].name.empty()) {
+				names.push_back(Item::items[id].name);
+			}
+		}
+		if (names.empty()) {
+			return;
+		}
+
+		for (uint64_t i = 0; i < iterations; ++i) {
+			doNotOptimize(Item::items.getItemIdByName(names[i % names.size()]));
+		}
+	});
+
+	benchmarks.add("itemattributes/clone", [](uint64_t iterations) {
+		const ItemPtr item = makeAttributedItem();
+		for (uint64_t i = 0; i < iterations; ++i) {
+			doNotOptimize(item->clone());
+		}
+	});
+
+	benchmarks.add("propwritestream/serializeAttr", [](uint64_t iterations) {
+		const ItemPtr item = makeAttributedItem();
+		PropWriteStream stream;
+		for (uint64_t i = 0; i < iterations; ++i) {
+			stream.clear();
+			item->serializeAttr(stream);
+			doNotOptimize(stream.getStream().size());
+		}
+	});
+}
@@ -0,0 +1,141 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "benchmark.h"
+
+#include "configmanager.h"
+#include "definitions.h"
+#include "item.h"
+
+#include <fstream>
+#include <fmt/format.h>
+
+extern ConfigManager g_config;
+
+void Benchmarks::add(std::string name, BenchmarkFunction function)
+{
+	entries.push_back({std::move(name), std::move(function)});
+}
+
+std::vector<BenchmarkResult> Benchmarks::run(std::string_view filter, std::chrono::milliseconds minTime, uint32_t repetitions) const
+{
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<BenchmarkResult> results;
+	for (const Entry& entry : entries) {
+		if (entry.name.find(filter) == std::string::npos) {
+			continue;
+		}
+
+		// find how many iterations take minTime, the runs then use that many
+		uint64_t iterations = 1;
+		while (true) {
+			const auto start = Clock::now();
+			entry.function(iterations);
+			const auto elapsed = Clock::now() - start;
+			if (elapsed >= minTime || iterations >= (UINT64_C(1) << 40)) {
+				break;
+			}
+
+			const double ratio = static_cast<double>(minTime.count()) * 1e6 / std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			iterations = std::max(iterations * 2, static_cast<uint64_t>(iterations * std::min(ratio * 1.2, 100.0)));
+		}
+
+		std::vector<double> samples;
+		samples.reserve(repetitions);
+		for (uint32_t i = 0; i < repetitions; ++i) {
+			const auto start = Clock::now();
+			entry.function(iterations);
+			const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+			samples.push_back(static_cast<double>(elapsed) / iterations);
+		}
+		std::sort(samples.begin(), samples.end());
+
+		BenchmarkResult& result = results.emplace_back();
+		result.name = entry.name;
+		result.iterations = iterations;
+		result.nsPerOp = samples[samples.size() / 2];
+		result.minNsPerOp = samples.front();
+		result.maxNsPerOp = samples.back();
+
+		std::cout << fmt::format("{:<40s} {:>14.1f} ns/op {:>12d} iterations", result.name, result.nsPerOp, result.iterations) << std::endl;
+	}
+	return results;
+}
+
+namespace {
+
+std::string toJson(const std::vector<BenchmarkResult>& results)
+{
+	std::string json = fmt::format("{{\n\t\"server\": \"{:s}\",\n\t\"version\": \"{:s}\",\n\t\"time\": {:d},\n\t\"benchmarks\": [", STATUS_SERVER_NAME, STATUS_SERVER_VERSION, time(nullptr));
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult& result = results[i];
+		json += fmt::format("{:s}\n\t\t{{\"name\": \"{:s}\", \"iterations\": {:d}, \"ns_per_op\": {:.3f}, \"min_ns_per_op\": {:.3f}, \"max_ns_per_op\": {:.3f}}}",
+		                    i == 0 ? "" : ",", result.name, result.iterations, result.nsPerOp, result.minNsPerOp, result.maxNsPerOp);
+	}
+	json += "\n\t]\n}\n";
+	return json;
+}
+
+std::string_view getOption(std::string_view arg, std::string_view name)
+{
+	if (arg.size() > name.size() + 3 && arg.starts_with("--") && arg.substr(2, name.size()) == name && arg[name.size() + 2] == '=') {
+		return arg.substr(name.size() + 3);
+	}
+	return {};
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filter;
+	std::string outFile = "benchmarks.json";
+	std::chrono::milliseconds minTime{200};
+	uint32_t repetitions = 5;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string_view arg = argv[i];
+		if (auto value = getOption(arg, "filter"); !value.empty()) {
+			filter = value;
+		} else if (auto value = getOption(arg, "out"); !value.empty()) {
+			outFile = value;
+		} else if (auto value = getOption(arg, "min-time"); !value.empty()) {
+			minTime = std::chrono::milliseconds(std::max(1, std::stoi(std::string(value))));
+		} else if (auto value = getOption(arg, "repetitions"); !value.empty()) {
+			repetitions = std::max(1, std::stoi(std::string(value)));
+		} else {
+			std::cout << "Usage: " << argv[0] << " [--filter=name] [--out=file.json] [--min-time=ms] [--repetitions=n]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (!g_config.load()) {
+		std::cout << "> Warning: config.lua could not be loaded, using the default settings." << std::endl;
+	}
+
+	Benchmarks benchmarks;
+	registerNetworkBenchmarks(benchmarks);
+	registerDispatcherBenchmarks(benchmarks);
+
+	// the rest need the item types, the map ones build their own area
+	if (Item::items.loadFromOtb("data/items/items.otb") && Item::items.loadFromToml()) {
+		registerItemBenchmarks(benchmarks);
+		registerMapBenchmarks(benchmarks);
+	} else {
+		std::cout << "> Warning: the items could not be loaded, the item and map benchmarks are skipped." << std::endl;
+	}
+
+	const std::vector<BenchmarkResult> results = benchmarks.run(filter, minTime, repetitions);
+
+	std::ofstream out(outFile, std::ios::trunc);
+	if (!out) {
+		std::cout << "> ERROR: Unable to write " << outFile << std::endl;
+		return 1;
+	}
+	out << toJson(results);
+	std::cout << ">> " << results.size() << " benchmarks written to " << outFile << std::endl;
+	return 0;
+}
@@ -0,0 +1,133 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "benchmark.h"
+
+#include "game.h"
+#include "monster.h"
+
+#include <fmt/format.h>
+
+extern Game g_game;
+
+namespace {
+
+// a walkable area on two floors, with few monsters on its west half and
+// many on its east half
+constexpr uint16_t AREA_X = 1000;
+constexpr uint16_t AREA_Y = 1000;
+constexpr uint16_t AREA_WIDTH = 192;
+constexpr uint16_t AREA_HEIGHT = 96;
+constexpr uint8_t AREA_FLOOR = 7;
+
+const Position SPARSE_CENTER(AREA_X + AREA_WIDTH / 4, AREA_Y + AREA_HEIGHT / 2, AREA_FLOOR);
+const Position DENSE_CENTER(AREA_X + AREA_WIDTH * 3 / 4, AREA_Y + AREA_HEIGHT / 2, AREA_FLOOR);
+
+MonsterType benchMonsterType;
+std::vector<MonsterPtr> benchMonsters;
+
+uint16_t findGroundId()
+{
+	for (size_t id = 100; id < Item::items.size(); ++id) {
+		const ItemType& it = Item::items[id];
+		if (it.isGroundTile() && !it.blockSolid && it.speed > 0) {
+			return static_cast<uint16_t>(id);
+		}
+	}
+	return 0;
+}
+
+bool buildArea()
+{
+	const uint16_t groundId = findGroundId();
+	if (groundId == 0) {
+		return false;
+	}
+
+	for (uint8_t z = AREA_FLOOR - 1; z <= AREA_FLOOR; ++z) {
+		for (uint16_t y = AREA_Y; y < AREA_Y + AREA_HEIGHT; ++y) {
+			for (uint16_t x = AREA_X; x < AREA_X + AREA_WIDTH; ++x) {
+				TilePtr tile = std::make_shared<Tile>(x, y, z);
+				tile->internalAddThing(Item::CreateItem(groundId));
+				g_game.map.setTile(x, y, z, tile);
+			}
+		}
+	}
+
+	benchMonsterType.name = "Benchmark Monster";
+	benchMonsterType.nameDescription = "a benchmark monster";
+	benchMonsterType.info.health = 100;
+	benchMonsterType.info.healthMax = 100;
+	benchMonsterType.info.baseSpeed = 200;
+
+	for (uint16_t y = AREA_Y; y < AREA_Y + AREA_HEIGHT; ++y) {
+		for (uint16_t x = AREA_X; x < AREA_X + AREA_WIDTH; ++x) {
+			const bool dense = x >= AREA_X + AREA_WIDTH / 2;
+			const uint16_t spacing = dense ? 2 : 8;
+			if ((x - AREA_X) % spacing != 0 || (y - AREA_Y) % spacing != 0) {
+				continue;
+			}
+
+			MonsterPtr monster = std::make_shared<Monster>(&benchMonsterType);
+			if (g_game.map.placeCreature(Position(x, y, AREA_FLOOR), monster, false, true)) {
+				benchMonsters.push_back(std::move(monster));
+			}
+		}
+	}
+	return true;
+}
+
+void addSpectatorBenchmark(Benchmarks& benchmarks, std::string name, Position center, bool multifloor, bool onlyPlayers)
+{
+	benchmarks.add(std::move(name), [=](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; ++i) {
+			SpectatorVec spectators;
+			g_game.map.getSpectators(spectators, center, multifloor, onlyPlayers,
+			                         Map::maxViewportX, Map::maxViewportX, Map::maxViewportY, Map::maxViewportY);
+			doNotOptimize(spectators.size());
+		}
+	});
+}
+
+}
+
+void registerMapBenchmarks(Benchmarks& benchmarks)
+{
+	if (!buildArea()) {
+		std::cout << "> Warning: no walkable ground item found, the map benchmarks are skipped." << std::endl;
+		return;
+	}
+
+	addSpectatorBenchmark(benchmarks, "map/getSpectators/sparse", SPARSE_CENTER, false, false);
+	addSpectatorBenchmark(benchmarks, "map/getSpectators/dense", DENSE_CENTER, false, false);
+	addSpectatorBenchmark(benchmarks, "map/getSpectators/dense/multifloor", DENSE_CENTER, true, false);
+	addSpectatorBenchmark(benchmarks, "map/getSpectators/dense/players", DENSE_CENTER, true, true);
+	addSpectatorBenchmark(benchmarks, "map/getSpectators/empty", Position(AREA_X + 8, AREA_Y + 8, AREA_FLOOR - 1), false, false);
+
+	// a monster of the sparse half walking to a tile across it
+	for (int32_t distance : {8, 24, 48}) {
+		benchmarks.add(fmt::format("map/getPathMatching/{:d}", distance), [distance](uint64_t iterations) {
+			if (benchMonsters.empty()) {
+				return;
+			}
+
+			CreaturePtr creature = benchMonsters.front();
+			const Position& start = creature->getPosition();
+			const FrozenPathingConditionCall condition(Position(start.x + distance, start.y + distance / 2 + 1, start.z));
+
+			FindPathParams fpp;
+			fpp.clearSight = false;
+			fpp.maxSearchDist = distance * 2;
+			fpp.minTargetDist = 0;
+			fpp.maxTargetDist = 0;
+
+			std::vector<Direction> dirList;
+			for (uint64_t i = 0; i < iterations; ++i) {
+				dirList.clear();
+				doNotOptimize(g_game.map.getPathMatching(creature, dirList, condition, fpp));
+			}
+		});
+	}
+}
@@ -0,0 +1,80 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "benchmark.h"
+
+#include "networkmessage.h"
+#include "outputmessage.h"
+#include "tools.h"
+#include "xtea.h"
+
+#include <fmt/format.h>
+
+namespace {
+
+// what a creature say sends, roughly
+void encodeMessage(NetworkMessage& msg)
+{
+	msg.addByte(0xAA);
+	msg.add<uint32_t>(0);
+	msg.addString("Benchmark Player");
+	msg.add<uint16_t>(100);
+	msg.addByte(0x01);
+	msg.addPosition(Position(1000, 1000, 7));
+	msg.addString("hi, how much for the sword of the benchmarks?");
+}
+
+std::vector<uint8_t> makeBuffer(size_t size)
+{
+	std::vector<uint8_t> buffer(size);
+	for (size_t i = 0; i < size; ++i) {
+		buffer[i] = static_cast<uint8_t>(i * 31 + 7);
+	}
+	return buffer;
+}
+
+}
+
+void registerNetworkBenchmarks(Benchmarks& benchmarks)
+{
+	benchmarks.add("networkmessage/encode", [](uint64_t iterations) {
+		NetworkMessage msg;
+		for (uint64_t i = 0; i < iterations; ++i) {
+			msg.reset();
+			encodeMessage(msg);
+			doNotOptimize(msg.getLength());
+		}
+	});
+
+	benchmarks.add("outputmessage/frame", [](uint64_t iterations) {
+		NetworkMessage msg;
+		encodeMessage(msg);
+		for (uint64_t i = 0; i < iterations; ++i) {
+			OutputMessage_ptr output = OutputMessagePool::getOutputMessage();
+			output->append(msg);
+			output->writeMessageLength();
+			output->addCryptoHeader(true);
+			doNotOptimize(output->getLength());
+		}
+	});
+
+	for (size_t size : {64, 1024, 16384}) {
+		benchmarks.add(fmt::format("xtea/encrypt/{:d}", size), [size](uint64_t iterations) {
+			std::vector<uint8_t> buffer = makeBuffer(size);
+			const xtea::round_keys keys = xtea::expand_key({0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210});
+			for (uint64_t i = 0; i < iterations; ++i) {
+				xtea::encrypt(buffer.data(), buffer.size(), keys);
+			}
+			doNotOptimize(buffer.front());
+		});
+
+		benchmarks.add(fmt::format("adler/{:d}", size), [size](uint64_t iterations) {
+			const std::vector<uint8_t> buffer = makeBuffer(size);
+			for (uint64_t i = 0; i < iterations; ++i) {
+				doNotOptimize(adlerChecksum(buffer.data(), buffer.size()));
+			}
+		});
+	}
+}
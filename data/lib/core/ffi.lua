@@ -0,0 +1,78 @@
+-- Puts the plain C accessors of src/luaffi.h in place of the Lua C functions
+-- scripts call the most, so LuaJIT can compile them into its traces. Only
+-- takes effect on a server built with the luajit-ffi premake option, the
+-- replaced functions are kept in BlackTekFFI.original.
+if type(jit) ~= 'table' or BlackTekFFI then
+	return
+end
+
+local loaded, ffi = pcall(require, 'ffi')
+if not loaded then
+	return
+end
+
+pcall(ffi.cdef, [[
+typedef struct { uint16_t x; uint16_t y; uint8_t z; } BlackTekPosition;
+bool blacktek_creature_get_position(const void* creature, BlackTekPosition* position);
+bool blacktek_creature_get_health(const void* creature, int32_t* health);
+bool blacktek_creature_get_max_health(const void* creature, int32_t* health);
+bool blacktek_player_get_storage_value(const void* player, uint32_t key, int32_t* value);
+bool blacktek_item_get_id(const void* item, uint16_t* id);
+]])
+
+local C = ffi.C
+if not pcall(function() return C.blacktek_item_get_id end) then
+	return
+end
+
+BlackTekFFI = {
+	original = {
+		creatureGetPosition = Creature.getPosition,
+		creatureGetHealth = Creature.getHealth,
+		creatureGetMaxHealth = Creature.getMaxHealth,
+		playerGetStorageValue = Player.getStorageValue,
+		itemGetId = Item.getId
+	}
+}
+
+local position = ffi.new('BlackTekPosition')
+local int32 = ffi.new('int32_t[1]')
+local uint16 = ffi.new('uint16_t[1]')
+local positionMetatable = debug.getmetatable(Position(0, 0, 0))
+
+function Creature.getPosition(self)
+	if not C.blacktek_creature_get_position(self, position) then
+		return nil
+	end
+	return setmetatable({x = position.x, y = position.y, z = position.z, stackpos = 0}, positionMetatable)
+end
+
+function Creature.getHealth(self)
+	if not C.blacktek_creature_get_health(self, int32) then
+		return nil
+	end
+	return int32[0]
+end
+
+function Creature.getMaxHealth(self)
+	if not C.blacktek_creature_get_max_health(self, int32) then
+		return nil
+	end
+	return int32[0]
+end
+
+function Player.getStorageValue(self, key)
+	if not C.blacktek_player_get_storage_value(self, key, int32) then
+		return nil
+	end
+	return int32[0]
+end
+
+function Item.getId(self)
+	if not C.blacktek_item_get_id(self, uint16) then
+		return nil
+	end
+	return uint16[0]
+end
+
+print('>> Using LuaJIT FFI accessors')
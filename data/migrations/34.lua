@@ -1,3 +1,34 @@
 function onUpdateDatabase()
-	return false
+	print("> Updating database to version 34 (Worlds)")
+
+	db.query("ALTER TABLE `players` ADD COLUMN `world_id` int unsigned NOT NULL DEFAULT 0")
+
+	db.query([[
+		CREATE TABLE IF NOT EXISTS `worlds` (
+			`id` int unsigned NOT NULL,
+			`name` varchar(255) NOT NULL,
+			`ip` varchar(255) NOT NULL,
+			`port` smallint unsigned NOT NULL DEFAULT 7172,
+			PRIMARY KEY (`id`)
+		) ENGINE=InnoDB DEFAULT CHARACTER SET=utf8;
+	]])
+
+	db.query([[
+		CREATE TABLE IF NOT EXISTS `world_messages` (
+			`id` bigint unsigned NOT NULL AUTO_INCREMENT,
+			`origin` int unsigned NOT NULL,
+			`type` tinyint unsigned NOT NULL,
+			`target` int unsigned NOT NULL DEFAULT 0,
+			`receiver` varchar(255) NOT NULL DEFAULT '',
+			`sender` varchar(255) NOT NULL DEFAULT '',
+			`level` int unsigned NOT NULL DEFAULT 0,
+			`talktype` tinyint unsigned NOT NULL DEFAULT 0,
+			`text` text NOT NULL,
+			`created_at` bigint NOT NULL,
+			PRIMARY KEY (`id`),
+			KEY `created_at` (`created_at`)
+		) ENGINE=InnoDB DEFAULT CHARACTER SET=utf8;
+	]])
+
+	return true
 end
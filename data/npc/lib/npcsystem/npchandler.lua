@@ -393,6 +393,31 @@ if NpcHandler == nil then
 		end
 	end
 
+	-- Lets the server drop what is said out of talkRadius before it gets here, unless
+	-- a callback or module wants to hear it. Called on every think, it only goes to the
+	-- server when the range changed.
+	function NpcHandler:updateHearRange()
+		local radius = self.talkRadius
+		if self:getCallback(CALLBACK_CREATURE_SAY) then
+			radius = -1
+		else
+			for _, module in pairs(self.modules) do
+				if module.callbackOnCreatureSay then
+					radius = -1
+					break
+				end
+			end
+		end
+
+		if self.hearRadius ~= radius then
+			local npc = Npc()
+			if npc then
+				npc:setHearRadius(radius)
+				self.hearRadius = radius
+			end
+		end
+	end
+
 	-- Handles onCreatureSay events. If you with to handle this yourself, please use the CALLBACK_CREATURE_SAY callback.
 	function NpcHandler:onCreatureSay(creature, msgtype, msg)
 		local cid = creature:getId()
@@ -485,6 +510,7 @@ if NpcHandler == nil then
 
 	-- Handles onThink events. If you wish to handle this yourself, please use the CALLBACK_ONTHINK callback.
 	function NpcHandler:onThink()
+		self:updateHearRange()
 		local callback = self:getCallback(CALLBACK_ONTHINK)
 		if callback == nil or callback() then
 			if NPCHANDLER_TALKDELAY == TALKDELAY_ONTHINK then
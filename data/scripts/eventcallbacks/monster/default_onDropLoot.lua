@@ -8,12 +8,8 @@ ec.onDropLoot = function(self, corpse)
 	local player = Player(corpse:getCorpseOwner())
 	local mType = self:getType()
 	if not player or player:getStamina() > 840 then
-		local monsterLoot = mType:getLoot()
-		for i = 1, #monsterLoot do
-			local item = corpse:createLootItem(monsterLoot[i])
-			if not item then
-				print('[Warning] DropLoot:', 'Could not add loot item to corpse.')
-			end
+		if not corpse:createLoot(mType) then
+			print('[Warning] DropLoot:', 'Could not add loot item to corpse.')
 		end
 
 		if player then
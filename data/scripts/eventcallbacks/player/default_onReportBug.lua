@@ -6,23 +6,14 @@ ec.onReportBug = function(self, message, position, category)
 	end
 
 	local name = self:getName()
-	local file = io.open("data/reports/bugs/" .. name .. " report.txt", "a")
-
-	if not file then
-		self:sendTextMessage(MESSAGE_EVENT_DEFAULT, "There was an error when processing your report, please contact a gamemaster.")
-		return true
-	end
-
-	io.output(file)
-	io.write("------------------------------\n")
-	io.write("Name: " .. name)
+	local text = "------------------------------\n" .. "Name: " .. name
 	if category == BUG_CATEGORY_MAP then
-		io.write(" [Map position: " .. position.x .. ", " .. position.y .. ", " .. position.z .. "]")
+		text = text .. " [Map position: " .. position.x .. ", " .. position.y .. ", " .. position.z .. "]"
 	end
 	local playerPosition = self:getPosition()
-	io.write(" [Player Position: " .. playerPosition.x .. ", " .. playerPosition.y .. ", " .. playerPosition.z .. "]\n")
-	io.write("Comment: " .. message .. "\n")
-	io.close(file)
+	text = text .. " [Player Position: " .. playerPosition.x .. ", " .. playerPosition.y .. ", " .. playerPosition.z .. "]\n"
+	text = text .. "Comment: " .. message .. "\n"
+	Game.writeLog("data/reports/bugs/" .. name .. " report.txt", text)
 
 	self:sendTextMessage(MESSAGE_EVENT_DEFAULT, "Your report has been sent to " .. configManager.getString(configKeys.SERVER_NAME) .. ".")
 	return true
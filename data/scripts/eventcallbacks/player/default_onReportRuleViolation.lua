@@ -1,5 +1,9 @@
+local function getReportFile(name, targetName, reportType)
+	return string.format("data/reports/players/%s-%s-%d.txt", name, targetName, reportType)
+end
+
 local function hasPendingReport(name, targetName, reportType)
-	local f = io.open(string.format("data/reports/players/%s-%s-%d.txt", name, targetName, reportType), "r")
+	local f = io.open(getReportFile(name, targetName, reportType), "r")
 	if f then
 		io.close(f)
 		return true
@@ -17,24 +21,18 @@ ec.onReportRuleViolation = function(self, targetName, reportType, reportReason,
 		return
 	end
 
-	local file = io.open(string.format("data/reports/players/%s-%s-%d.txt", name, targetName, reportType), "a")
-	if not file then
-		self:sendTextMessage(MESSAGE_EVENT_ADVANCE, "There was an error when processing your report, please contact a gamemaster.")
-		return
-	end
-
-	io.output(file)
-	io.write("------------------------------\n")
-	io.write("Reported by: " .. name .. "\n")
-	io.write("Target: " .. targetName .. "\n")
-	io.write("Type: " .. reportType .. "\n")
-	io.write("Reason: " .. reportReason .. "\n")
-	io.write("Comment: " .. comment .. "\n")
+	local text = "------------------------------\n"
+	text = text .. "Reported by: " .. name .. "\n"
+	text = text .. "Target: " .. targetName .. "\n"
+	text = text .. "Type: " .. reportType .. "\n"
+	text = text .. "Reason: " .. reportReason .. "\n"
+	text = text .. "Comment: " .. comment .. "\n"
 	if reportType ~= REPORT_TYPE_BOT then
-		io.write("Translation: " .. translation .. "\n")
+		text = text .. "Translation: " .. translation .. "\n"
 	end
-	io.write("------------------------------\n")
-	io.close(file)
+	text = text .. "------------------------------\n"
+
+	Game.writeLog(getReportFile(name, targetName, reportType), text)
 	self:sendTextMessage(MESSAGE_EVENT_ADVANCE, string.format("Thank you for reporting %s. Your report will be processed by %s team as soon as possible.", targetName, configManager.getString(configKeys.SERVER_NAME)))
 end
 
@@ -0,0 +1,51 @@
+-- /ffibench [iterations]
+-- Times the FFI accessors of data/lib/core/ffi.lua against the Lua C functions
+-- they replace, on the player saying it and the item in their left hand.
+local talk = TalkAction("/ffibench")
+
+local function measure(iterations, callback, ...)
+	local start = os.clock()
+	for _ = 1, iterations do
+		callback(...)
+	end
+	return (os.clock() - start) * 1000
+end
+
+function talk.onSay(player, words, param)
+	if not player or not player:getGroup():getAccess() or player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return false
+	end
+
+	if not BlackTekFFI then
+		player:sendTextMessage(MESSAGE_EVENT_ORANGE, "The FFI accessors are not in use, build with LuaJIT and the luajit-ffi option.")
+		return false
+	end
+
+	local iterations = tonumber(param) or 1000000
+	local original = BlackTekFFI.original
+	local benchmarks = {
+		{"getPosition", original.creatureGetPosition, Creature.getPosition, player},
+		{"getHealth", original.creatureGetHealth, Creature.getHealth, player},
+		{"getMaxHealth", original.creatureGetMaxHealth, Creature.getMaxHealth, player},
+		{"getStorageValue", original.playerGetStorageValue, Player.getStorageValue, player, 1000}
+	}
+
+	local item = player:getSlotItem(CONST_SLOT_LEFT)
+	if item then
+		benchmarks[#benchmarks + 1] = {"item getId", original.itemGetId, Item.getId, item}
+	end
+
+	local lines = {string.format("%d calls each, C API / FFI:", iterations)}
+	for _, benchmark in ipairs(benchmarks) do
+		local name, before, after = benchmark[1], benchmark[2], benchmark[3]
+		local capi = measure(iterations, before, benchmark[4], benchmark[5])
+		local ffi = measure(iterations, after, benchmark[4], benchmark[5])
+		lines[#lines + 1] = string.format("%s: %.1f ms / %.1f ms (%.1fx)", name, capi, ffi, capi / math.max(ffi, 0.001))
+	end
+
+	player:sendTextMessage(MESSAGE_EVENT_ORANGE, table.concat(lines, "\n"))
+	return false
+end
+
+talk:separator(" ")
+talk:register()
@@ -0,0 +1,26 @@
+local sortKeys = {dispatcher = true, lua = true, path = true, received = true, sent = true, packets = true}
+
+function onSay(player, words, param)
+	if not player:getGroup():getAccess() then
+		return true
+	end
+
+	if player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return false
+	end
+
+	-- /cost [sortBy] [limit], the heaviest players since they logged in
+	local split = param:splitTrimmed(" ")
+	local sortBy = sortKeys[split[1]] and split[1] or "dispatcher"
+	local limit = math.max(1, math.min(50, tonumber(split[2] or split[1]) or 10))
+
+	local lines = {"Players by " .. sortBy .. " since login:"}
+	for _, cost in ipairs(Game.getPlayerCosts(limit, sortBy)) do
+		local seconds = math.max(1, cost.seconds)
+		lines[#lines + 1] = string.format("%s: %.1f ms dispatcher, %.1f ms lua, %d path nodes, %d packets, %d KB in, %d KB out in %d s (%.2f ms/s)",
+			cost.name, cost.dispatcherTime / 1000, cost.luaTime / 1000, cost.pathNodes, cost.packets,
+			cost.bytesReceived / 1024, cost.bytesSent / 1024, cost.seconds, cost.dispatcherTime / 1000 / seconds)
+	end
+	player:showTextDialog(2160, table.concat(lines, "\n"))
+	return false
+end
@@ -0,0 +1,24 @@
+function onSay(player, words, param)
+	if not player:getGroup():getAccess() then
+		return true
+	end
+
+	if player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return false
+	end
+
+	local names = {}
+	local report = Game.getMemoryReport()
+	for name in pairs(report) do
+		names[#names + 1] = name
+	end
+	table.sort(names)
+
+	local text = "Memory:"
+	for _, name in ipairs(names) do
+		local entry = report[name]
+		text = string.format("%s\n%s: %d, %.1f MB", text, name, entry.count, entry.bytes / (1024 * 1024))
+	end
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, text)
+	return false
+end
@@ -0,0 +1,22 @@
+function onSay(player, words, param)
+	if not player:getGroup():getAccess() then
+		return true
+	end
+
+	if player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return false
+	end
+
+	if Game.startLuaProfiler() then
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "Lua profiler started, say " .. words .. " again to stop it.")
+		return false
+	end
+
+	local file = Game.stopLuaProfiler()
+	if file then
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "Lua profile written to " .. file .. ".")
+	else
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "The Lua profile could not be written, see the console.")
+	end
+	return false
+end
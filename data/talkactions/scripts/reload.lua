@@ -81,11 +81,12 @@ function onSay(player, words, param)
 		EventCallback:clear()
 	end
 
+	local start = os.mtime()
 	Game.reload(reloadType)
 	if reloadType == RELOAD_TYPE_GLOBAL then
 		-- we need to reload the scripts as well
 		Game.reload(RELOAD_TYPE_SCRIPTS)
 	end
-	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, string.format("Reloaded %s.", param:lower()))
+	player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, string.format("Reloaded %s in %d ms.", param:lower(), os.mtime() - start))
 	return false
 end
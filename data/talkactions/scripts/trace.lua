@@ -0,0 +1,18 @@
+function onSay(player, words, param)
+	if not player:getGroup():getAccess() then
+		return true
+	end
+
+	if player:getAccountType() < ACCOUNT_TYPE_GOD then
+		return false
+	end
+
+	local seconds = math.max(1, math.min(60, tonumber(param) or 10))
+	local file = Game.startTrace(seconds)
+	if file then
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "Recording a trace of " .. seconds .. " seconds to " .. file .. ".")
+	else
+		player:sendTextMessage(MESSAGE_STATUS_CONSOLE_BLUE, "A trace is already being recorded.")
+	end
+	return false
+end
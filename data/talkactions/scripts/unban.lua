@@ -8,8 +8,8 @@ function onSay(player, words, param)
 		return false
 	end
 
-	db.asyncQuery("DELETE FROM `account_bans` WHERE `account_id` = " .. result.getNumber(resultId, "account_id"))
-	db.asyncQuery("DELETE FROM `ip_bans` WHERE `ip` = " .. result.getNumber(resultId, "lastip"))
+	db.asyncQuery("DELETE FROM `account_bans` WHERE `account_id` = " .. result.getNumber(resultId, "account_id"), Game.clearBanCache)
+	db.asyncQuery("DELETE FROM `ip_bans` WHERE `ip` = " .. result.getNumber(resultId, "lastip"), Game.clearBanCache)
 	result.free(resultId)
 	player:sendTextMessage(MESSAGE_EVENT_ADVANCE, param .. " has been unbanned.")
 	return false
@@ -0,0 +1,46 @@
+-- Every file in data/workers runs in each worker state (luaWorkerThreads in
+-- config.lua). Those states know nothing of the game, their global functions
+-- only see what they are given:
+--   Game.callWorker("closestWord", function(success, word, distance)
+--       ...
+--   end, text, {"trade", "job", "name"})
+-- The callback runs on the dispatcher once the function returned, success is
+-- false and the only value the error message if it failed.
+
+local function distance(a, b)
+	local lengthA, lengthB = #a, #b
+	if lengthA == 0 then
+		return lengthB
+	elseif lengthB == 0 then
+		return lengthA
+	end
+
+	local previous, current = {}, {}
+	for j = 0, lengthB do
+		previous[j] = j
+	end
+
+	for i = 1, lengthA do
+		current[0] = i
+		local byteA = a:byte(i)
+		for j = 1, lengthB do
+			local cost = byteA == b:byte(j) and 0 or 1
+			current[j] = math.min(previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost)
+		end
+		previous, current = current, previous
+	end
+	return previous[lengthB]
+end
+
+-- the word of words closest to text and its edit distance, ignoring case
+function closestWord(text, words)
+	text = text:lower()
+	local bestWord, bestDistance = nil, math.huge
+	for _, word in ipairs(words) do
+		local wordDistance = distance(text, word:lower())
+		if wordDistance < bestDistance then
+			bestWord, bestDistance = word, wordDistance
+		end
+	end
+	return bestWord, bestDistance
+end
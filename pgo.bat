@@ -0,0 +1,42 @@
+@echo off
+setlocal enabledelayedexpansion
+
+:: Builds a profile-guided optimized server with MSVC, see pgo.sh for the stages.
+:: Run it from a Developer Command Prompt after bootstrap.bat, with config.lua
+:: set up with a database, the training simulation loads the world.
+:: Usage: pgo.bat [players] [seconds]
+
+set players=%1
+if "!players!"=="" set players=200
+set seconds=%2
+if "!seconds!"=="" set seconds=120
+set vs_version=vs2022
+set pgoDir=build\pgo
+
+if not exist config.lua (
+    echo config.lua is missing, the simulation needs it with a working database.
+    exit /b 1
+)
+
+if exist !pgoDir! rmdir /s /q !pgoDir!
+mkdir !pgoDir!
+
+echo Building the instrumented stage...
+cmd /c premake5.exe %vs_version% --lto --pgo=generate || goto failed
+msbuild Black-Tek-Server.sln /t:Rebuild /p:Configuration=Release /p:Platform=64 /m || goto failed
+
+:: the instrumented binary writes its .pgc files next to the .pgd when it exits
+echo Training with !players! simulated players for !seconds! seconds...
+Black-Tek-Server.exe --simulate=!players! --simulate-time=!seconds! || goto failed
+
+echo Building the optimized stage...
+cmd /c premake5.exe %vs_version% --lto --pgo=use || goto failed
+msbuild Black-Tek-Server.sln /t:Rebuild /p:Configuration=Release /p:Platform=64 /m || goto failed
+
+echo Profile-guided build finished!
+exit /b 0
+
+:failed
+echo The profile-guided build failed.
+exit /b 1
+endlocal
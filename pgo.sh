@@ -0,0 +1,105 @@
+#!/bin/bash
+
+# Builds a profile-guided optimized server in three stages: an instrumented
+# build, a training run of it, and the final build from the profiles the run
+# wrote. The training runs the headless simulation (--simulate) on the map of
+# config.lua, so combat, movement, spectators, pathfinding and decay are
+# measured with their real data, and the benchmarks for the protocol encoding
+# the simulated players never reach. Run bootstrap.sh and set up config.lua
+# with a database first, the simulation loads the world like the server does.
+#
+# Usage: ./pgo.sh [--cc=gcc|clang] [--bolt] [players] [seconds]
+#   --bolt  reorders the final binary with llvm-bolt from a perf profile of
+#           a second training run, needs perf, perf2bolt and llvm-bolt
+
+# Echo tags
+RED="\033[0;31m"
+GREEN="\033[0;32m"
+END="\033[0;0m"
+
+premake_cmd="${HOME}/.local/bin/premake5"
+if ! command -v "${premake_cmd}" &> /dev/null; then
+	premake_cmd="premake5"
+fi
+
+toolset="gcc"
+bolt=false
+players=200
+seconds=120
+pgo_dir="build/pgo"
+
+positional=()
+for arg in "$@"; do
+	case "$arg" in
+		--cc=*) toolset="${arg#--cc=}" ;;
+		--bolt) bolt=true ;;
+		*) positional+=("$arg") ;;
+	esac
+done
+players="${positional[0]:-$players}"
+seconds="${positional[1]:-$seconds}"
+
+case "$(uname -m)" in
+	aarch64 | armv8* | armv9* | arm64) build_arch="arm64" ;;
+	*) build_arch="64" ;;
+esac
+config="release_${build_arch}"
+
+premake_args="--cc=${toolset} --lto"
+if [ $bolt == true ]; then
+	premake_args="${premake_args} --bolt"
+fi
+
+fail () {
+	echo -e "${RED}=== $1 ===${END}"
+	exit 1
+}
+
+build () {
+	echo -e "${GREEN}Building the $1 stage${END}"
+	${premake_cmd} gmake2 ${premake_args} --pgo=$1 || fail "premake failed"
+	make clean "config=${config}" > /dev/null
+	make -j `nproc` "config=${config}" || fail "The $1 build failed"
+}
+
+train () {
+	# the benchmarks only help clang, gcc keeps the profiles of each object file
+	if [ "$toolset" == "clang" ]; then
+		./Black-Tek-Bench || fail "The benchmarks failed"
+	fi
+	./Black-Tek-Server --simulate=${players} --simulate-time=${seconds} || fail "The simulation failed"
+}
+
+if [ ! -f config.lua ]; then
+	fail "config.lua is missing, the simulation needs it with a working database"
+fi
+
+rm -rf "${pgo_dir}"
+mkdir -p "${pgo_dir}"
+
+build generate
+
+echo -e "${GREEN}Training with ${players} simulated players for ${seconds} seconds${END}"
+if [ "$toolset" == "clang" ]; then
+	export LLVM_PROFILE_FILE="${PWD}/${pgo_dir}/%m-%p.profraw"
+fi
+train
+if [ "$toolset" == "clang" ]; then
+	llvm-profdata merge -output="${pgo_dir}/default.profdata" "${pgo_dir}"/*.profraw || fail "llvm-profdata could not merge the profiles"
+	unset LLVM_PROFILE_FILE
+fi
+
+build use
+
+if [ $bolt == true ]; then
+	echo -e "${GREEN}Recording the layout profile for llvm-bolt${END}"
+	perf record -e cycles:u -j any,u -o "${pgo_dir}/perf.data" -- ./Black-Tek-Server --simulate=${players} --simulate-time=${seconds} || fail "perf record failed"
+	perf2bolt -p "${pgo_dir}/perf.data" -o "${pgo_dir}/perf.fdata" ./Black-Tek-Server || fail "perf2bolt failed"
+	llvm-bolt ./Black-Tek-Server -o "${pgo_dir}/Black-Tek-Server.bolt" -data="${pgo_dir}/perf.fdata" \
+		-reorder-blocks=ext-tsp -reorder-functions=hfsort -split-functions -split-all-cold -dyno-stats || fail "llvm-bolt failed"
+	mv -f "${pgo_dir}/Black-Tek-Server.bolt" ./Black-Tek-Server
+fi
+
+# the next plain premake run goes back to the usual builds
+echo -e "${GREEN}=== Profile-guided build finished ===${END}"
+echo "To start the server: ./Black-Tek-Server"
@@ -4,55 +4,126 @@ workspace "Black-Tek-Server"
     platforms { "64", "ARM64", "ARM" }
     location ""
     editorintegration "On"
+    startproject "Black-Tek-Server"
 
--- Project configuration
-project "Black-Tek-Server"
-    kind "ConsoleApp"
+-- Custom command-line options
+newoption {
+    trigger     = "lua",
+    description = "Specific Lua library to use (e.g., lua5.4).",
+    value       = "libname",
+    category    = "BlackTek", -- Group options together
+    default     = "lua",
+    allowed     = {
+        { "lua", "Default" },
+        { "lua5.4", "Use Lua 5.4" },
+        { "lua5.3", "Use Lua 5.3" },
+        { "luajit-5.1", "Use LuaJIT" }
+    }
+}
+
+newoption {
+    trigger     = "custom-includes",
+    description = "Comma-separated list of custom include paths.",
+    value       = "include paths",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "custom-libs",
+    description = "Comma-separated list of custom library paths.",
+    value       = "library paths",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "verbose",
+    description = "Enable verbose compilation warnings.",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "luajit-ffi",
+    description = "Export the plain C accessors data/lib/core/ffi.lua binds with the LuaJIT FFI (use with --lua=luajit-5.1).",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "spectator-grid",
+    description = "Use the per-floor sector grid spectator index instead of the quadtree walk.",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "dense-tiles",
+    description = "Store tiles in contiguous 64x64 regions instead of quadtree floors.",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "alloc-profiler",
+    description = "Count every allocation by the task or thread that made it, see Game.getAllocationStats.",
+    category    = "BlackTek"
+}
+
+newoption {
+    trigger     = "allocator",
+    description = "Allocator behind operator new.",
+    value       = "name",
+    category    = "BlackTek",
+    default     = "system",
+    allowed     = {
+        { "system", "The malloc of the C library" },
+        { "mimalloc", "mimalloc" },
+        { "jemalloc", "jemalloc, with one arena per thread" }
+    }
+}
+
+newoption {
+    trigger     = "lto",
+    description = "Compile for link time optimization, not only link for it.",
+    category    = "BlackTek"
+}
+
+-- pgo.sh and pgo.bat run the stages: an instrumented build, a training run on the
+-- headless simulation and the benchmarks, then the build using its profiles
+newoption {
+    trigger     = "pgo",
+    description = "Profile-guided optimization stage.",
+    value       = "stage",
+    category    = "BlackTek",
+    allowed     = {
+        { "generate", "Instrumented build, writes profiles to --pgo-dir when it exits" },
+        { "use", "Optimized build from the profiles in --pgo-dir" }
+    }
+}
+
+newoption {
+    trigger     = "pgo-dir",
+    description = "Directory of the profile-guided optimization profiles.",
+    value       = "path",
+    category    = "BlackTek",
+    default     = "build/pgo"
+}
+
+newoption {
+    trigger     = "bolt",
+    description = "Keep the relocations llvm-bolt needs to reorder the linked server.",
+    category    = "BlackTek"
+}
+
+-- Settings shared by the server and the benchmarks, both build the engine
+-- absolute, the build runs from its own directory
+local pgoDir = path.getabsolute(_OPTIONS["pgo-dir"] or "build/pgo")
+
+local function engineSettings()
     language "C++"
     cppdialect "C++20"
-    targetdir "%{wks.location}"
-    objdir "build/%{cfg.buildcfg}/obj"
     location ""
-    files { "src/**.cpp", "src/**.h" }
     flags { "MultiProcessorCompile" }
     enableunitybuild "On"
     intrinsics "On"
     editandcontinue "Off"
 
-    -- Custom command-line options
-    newoption {
-        trigger     = "lua",
-        description = "Specific Lua library to use (e.g., lua5.4).",
-        value       = "libname",
-        category    = "BlackTek", -- Group options together
-        default     = "lua",
-        allowed     = {
-            { "lua", "Default" },
-            { "lua5.4", "Use Lua 5.4" },
-            { "lua5.3", "Use Lua 5.3" }
-        }
-    }
-
-    newoption {
-        trigger     = "custom-includes",
-        description = "Comma-separated list of custom include paths.",
-        value       = "include paths",
-        category    = "BlackTek"
-    }
-
-    newoption {
-        trigger     = "custom-libs",
-        description = "Comma-separated list of custom library paths.",
-        value       = "library paths",
-        category    = "BlackTek"
-    }
-
-    newoption {
-        trigger     = "verbose",
-        description = "Enable verbose compilation warnings.",
-        category    = "BlackTek"
-    }
-
     -- Process custom include and library paths
     if _OPTIONS["custom-includes"] then
         includedirs { string.explode(_OPTIONS["custom-includes"], ",") }
@@ -62,6 +133,30 @@ project "Black-Tek-Server"
         libdirs { string.explode(_OPTIONS["custom-libs"], ",") }
     end
 
+    filter "options:spectator-grid"
+        defines { "SPECTATOR_GRID" }
+
+    filter "options:dense-tiles"
+        defines { "DENSE_TILE_STORE" }
+
+    filter "options:luajit-ffi"
+        defines { "LUAJIT_FFI" }
+
+    filter "options:alloc-profiler"
+        defines { "ALLOCATION_PROFILER" }
+
+    filter "options:allocator=mimalloc"
+        defines { "USE_MIMALLOC" }
+        links { "mimalloc" }
+
+    filter "options:allocator=jemalloc"
+        defines { "USE_JEMALLOC" }
+        links { "jemalloc" }
+
+    -- ffi.C looks the accessors up in the symbols the executable exports
+    filter { "options:luajit-ffi", "system:not windows" }
+        linkoptions { "-rdynamic" }
+
     -- Configuration-specific settings
     filter "configurations:Debug"
         defines { "DEBUG" }
@@ -137,6 +232,69 @@ project "Black-Tek-Server"
     filter "toolset:clang"
         buildoptions { "-Wimplicit-fallthrough", "-Wmove" }
 
+    -- Link time and profile-guided optimization
+    filter { "options:lto", "toolset:gcc" }
+        buildoptions { "-flto=auto" }
+
+    filter { "options:lto", "toolset:clang" }
+        buildoptions { "-flto=thin" }
+        linkoptions { "-flto=thin" }
+
+    filter { "options:lto", "system:windows" }
+        buildoptions { "/GL" }
+        linkoptions { "/LTCG" }
+
+    -- the training run only reaches part of the code, what it missed is optimized as usual
+    filter { "options:pgo=generate", "toolset:gcc" }
+        buildoptions { "-fprofile-generate=" .. pgoDir, "-fprofile-update=prefer-atomic" }
+        linkoptions { "-fprofile-generate=" .. pgoDir }
+
+    filter { "options:pgo=use", "toolset:gcc" }
+        buildoptions { "-fprofile-use=" .. pgoDir, "-fprofile-partial-training", "-Wno-missing-profile" }
+        linkoptions { "-fprofile-use=" .. pgoDir }
+
+    -- pgo.sh merges the raw profiles of every training binary into default.profdata
+    filter { "options:pgo=generate", "toolset:clang" }
+        buildoptions { "-fprofile-generate=" .. pgoDir }
+        linkoptions { "-fprofile-generate=" .. pgoDir }
+
+    filter { "options:pgo=use", "toolset:clang" }
+        buildoptions { "-fprofile-use=" .. pgoDir .. "/default.profdata", "-Wno-profile-instr-unprofiled", "-Wno-profile-instr-out-of-date" }
+        linkoptions { "-fprofile-use=" .. pgoDir .. "/default.profdata" }
+
+    filter { "options:pgo=generate", "system:windows" }
+        buildoptions { "/GL" }
+        linkoptions { "/LTCG", "/GENPROFILE:PGD=" .. pgoDir .. "/%{prj.name}.pgd" }
+
+    filter { "options:pgo=use", "system:windows" }
+        buildoptions { "/GL" }
+        linkoptions { "/LTCG", "/USEPROFILE:PGD=" .. pgoDir .. "/%{prj.name}.pgd" }
+
+    filter { "options:bolt", "system:not windows" }
+        linkoptions { "-Wl,--emit-relocs" }
+
     -- macOS-specific settings
     filter { "system:macosx", "action:gmake" }
         buildoptions { "-fvisibility=hidden" }
+
+    filter {}
+end
+
+-- Project configuration
+project "Black-Tek-Server"
+    kind "ConsoleApp"
+    targetdir "%{wks.location}"
+    objdir "build/%{cfg.buildcfg}/obj"
+    files { "src/**.cpp", "src/**.h" }
+    engineSettings()
+
+-- Benchmarks of the engine hot paths, run from the server directory so
+-- data/ is found: ./Black-Tek-Bench [--filter=name] [--out=results.json]
+project "Black-Tek-Bench"
+    kind "ConsoleApp"
+    targetdir "%{wks.location}"
+    objdir "build/%{cfg.buildcfg}/bench"
+    files { "src/**.cpp", "src/**.h", "bench/**.cpp", "bench/**.h" }
+    includedirs { "src" }
+    defines { "BLACKTEK_BENCH" }
+    engineSettings()
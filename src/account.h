@@ -8,6 +8,8 @@
 
 struct Account {
 	std::vector<std::string> characters;
+	// the world of each of the characters
+	std::vector<uint32_t> characterWorlds;
 	std::string name;
 	std::string key;
 	uint32_t id = 0;
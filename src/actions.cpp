@@ -8,6 +8,7 @@
 #include "configmanager.h"
 #include "container.h"
 #include "game.h"
+#include "iologindata.h"
 #include "pugicast.h"
 #include "spells.h"
 #include "rewardchest.h"
@@ -45,6 +46,8 @@ void Actions::clear(bool fromLua)
 	clearMap(useItemMap, fromLua);
 	clearMap(uniqueItemMap, fromLua);
 	clearMap(actionItemMap, fromLua);
+	itemIdActions.clear();
+	itemIdActionsSize = 0;
 
 	reInitState(fromLua);
 }
@@ -286,15 +289,27 @@ Action* Actions::getAction(const ItemConstPtr& item)
 		}
 	}
 
-	auto it = useItemMap.find(item->getID());
-	if (it != useItemMap.end()) {
-		return &it->second;
+	if (itemIdActionsSize != useItemMap.size()) {
+		updateItemIdActions();
+	}
+
+	if (const uint16_t id = item->getID(); id < itemIdActions.size() && itemIdActions[id]) {
+		return itemIdActions[id];
 	}
 
 	//rune items
 	return g_spells->getRuneSpell(item->getID());
 }
 
+void Actions::updateItemIdActions()
+{
+	itemIdActions.assign(useItemMap.empty() ? 0 : useItemMap.rbegin()->first + 1, nullptr);
+	for (auto& it : useItemMap) {
+		itemIdActions[it.first] = &it.second;
+	}
+	itemIdActionsSize = useItemMap.size();
+}
+
 ReturnValue Actions::internalUseItem(PlayerPtr player, const Position& pos, uint8_t index, const ItemPtr& item, bool isHotkey)
 {
 	if (auto door = item->getDoor()) {
@@ -347,6 +362,27 @@ ReturnValue Actions::internalUseItem(PlayerPtr player, const Position& pos, uint
 	}
 
 	if (auto container = item->getContainer()) {
+		// the depot, the inbox and the reward chest may still be in the database
+		if (player->hasUnloadedSections() && (container->getDepotLocker() || container->getRewardChest() || container->isRewardCorpse() || item->getID() == ITEM_REWARD_CONTAINER)) {
+			IOLoginData::loadPlayerSectionsAsync(player, [this, playerId = player->getID(), pos, index, weakItem = std::weak_ptr<Item>(item), isHotkey]() {
+				const auto player = g_game.getPlayerByID(playerId);
+				const auto item = weakItem.lock();
+				if (!player || !item || item->isRemoved()) {
+					return;
+				}
+
+				// opened once they are in, if the player did not walk away meanwhile
+				if (item->getTile() && !Position::areInRange<1, 1, 0>(player->getPosition(), item->getPosition())) {
+					return;
+				}
+
+				if (const ReturnValue ret = internalUseItem(player, pos, index, item, isHotkey); ret != RETURNVALUE_NOERROR) {
+					player->sendCancelMessage(ret);
+				}
+			});
+			return RETURNVALUE_NOERROR;
+		}
+
 		ContainerPtr openContainer;
 
 		//depot container
@@ -622,8 +658,7 @@ bool Action::executeUse(const PlayerPtr& player, const ItemPtr& item, const Posi
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushThing(L, item);
 	LuaScriptInterface::pushPosition(L, fromPosition);
@@ -138,7 +138,12 @@ class Actions final : public BaseEvents
 		ActionUseMap uniqueItemMap;
 		ActionUseMap actionItemMap;
 
+		// by item id, the actions of useItemMap, rebuilt once their number changed since
+		std::vector<Action*> itemIdActions;
+		size_t itemIdActionsSize = 0;
+
 		Action* getAction(const ItemConstPtr& item);
+		void updateItemIdActions();
 		void clearMap(ActionUseMap& map, bool fromLua);
 
 		LuaScriptInterface scriptInterface;
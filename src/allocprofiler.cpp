@@ -0,0 +1,198 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "allocprofiler.h"
+
+#include "scheduler.h"
+#include "tracing.h"
+
+#include <new>
+
+#if defined(USE_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(USE_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+AllocationProfiler g_allocationProfiler;
+
+namespace {
+
+struct LabelCounter
+{
+	std::atomic<const char*> label{nullptr};
+	std::atomic<uint64_t> allocations{0};
+	std::atomic<uint64_t> bytes{0};
+};
+
+// constant initialized, operator new may run before main
+std::array<LabelCounter, AllocationProfiler::LABEL_CAPACITY> counters;
+
+#if defined(USE_JEMALLOC)
+void bindThreadArena()
+{
+	// every thread allocates from an arena of its own, set once on its first allocation
+	static thread_local bool bound = false;
+	if (bound) {
+		return;
+	}
+	bound = true;
+
+	unsigned arena = 0;
+	size_t size = sizeof(arena);
+	if (mallctl("arenas.create", &arena, &size, nullptr, 0) == 0) {
+		mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena));
+	}
+}
+#endif
+
+#if defined(ALLOCATION_PROFILER) || defined(USE_MIMALLOC) || defined(USE_JEMALLOC)
+void* allocate(size_t size) noexcept
+{
+#if defined(USE_MIMALLOC)
+	void* p = mi_malloc(size);
+#elif defined(USE_JEMALLOC)
+	bindThreadArena();
+	void* p = std::malloc(size == 0 ? 1 : size);
+#else
+	void* p = std::malloc(size == 0 ? 1 : size);
+#endif
+
+#ifdef ALLOCATION_PROFILER
+	if (p) {
+		AllocationProfiler::count(size);
+	}
+#endif
+	return p;
+}
+
+void* allocateOrThrow(size_t size)
+{
+	while (true) {
+		if (void* p = allocate(size)) {
+			return p;
+		}
+
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) {
+			throw std::bad_alloc();
+		}
+		handler();
+	}
+}
+
+void deallocate(void* p) noexcept
+{
+#if defined(USE_MIMALLOC)
+	mi_free(p);
+#else
+	std::free(p);
+#endif
+}
+#endif
+
+}
+
+#if defined(ALLOCATION_PROFILER) || defined(USE_MIMALLOC) || defined(USE_JEMALLOC)
+// the aligned forms are left to the standard library, they pair with each other
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+#endif
+
+const char* AllocationProfiler::getAllocatorName()
+{
+#if defined(USE_MIMALLOC)
+	return "mimalloc";
+#elif defined(USE_JEMALLOC)
+	return "jemalloc";
+#else
+	return "system";
+#endif
+}
+
+void AllocationProfiler::count(size_t bytes)
+{
+	const char* label = currentLabel ? currentLabel : TraceRecorder::getThreadName();
+
+	// open addressing on the address of the label, the same label text at two
+	// addresses takes two slots and is merged when sampled
+	const size_t mask = LABEL_CAPACITY - 1;
+	size_t index = (reinterpret_cast<uintptr_t>(label) >> 3) * UINT64_C(0x9E3779B97F4A7C15) >> 54;
+	for (size_t probe = 0; probe < LABEL_CAPACITY; ++probe, index = (index + 1) & mask) {
+		LabelCounter& counter = counters[index];
+		const char* existing = counter.label.load(std::memory_order_acquire);
+		if (!existing && counter.label.compare_exchange_strong(existing, label, std::memory_order_acq_rel)) {
+			existing = label;
+		}
+
+		if (existing == label) {
+			counter.allocations.fetch_add(1, std::memory_order_relaxed);
+			counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			return;
+		}
+	}
+	// a full table drops the count, a thousand labels is not a profile anyone reads
+}
+
+uint64_t AllocationProfiler::getTotalAllocations()
+{
+	uint64_t total = 0;
+	for (const LabelCounter& counter : counters) {
+		total += counter.allocations.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+void AllocationProfiler::start()
+{
+	if (!isBuiltIn() || started) {
+		return;
+	}
+
+	started = true;
+	previous.assign(LABEL_CAPACITY, {0, 0});
+	g_scheduler.addEvent(createSchedulerTask(1000, [this]() { sample(); }, DISPATCHER_LANE_BACKGROUND));
+}
+
+void AllocationProfiler::sample()
+{
+	// the vectors and strings made here are counted too, under this task
+	std::map<std::string_view, AllocationRate> rates;
+	for (size_t i = 0; i < LABEL_CAPACITY; ++i) {
+		const LabelCounter& counter = counters[i];
+		const char* label = counter.label.load(std::memory_order_acquire);
+		if (!label) {
+			continue;
+		}
+
+		const uint64_t allocations = counter.allocations.load(std::memory_order_relaxed);
+		const uint64_t bytes = counter.bytes.load(std::memory_order_relaxed);
+
+		AllocationRate& rate = rates[label];
+		rate.allocations += allocations - previous[i].first;
+		rate.bytes += bytes - previous[i].second;
+		rate.totalAllocations += allocations;
+		rate.totalBytes += bytes;
+		previous[i] = {allocations, bytes};
+	}
+
+	lastSecond.clear();
+	lastSecond.reserve(rates.size());
+	for (auto& [label, rate] : rates) {
+		rate.label = label;
+		lastSecond.push_back(std::move(rate));
+	}
+	std::ranges::sort(lastSecond, std::ranges::greater(), &AllocationRate::allocations);
+
+	g_scheduler.addEvent(createSchedulerTask(1000, [this]() { sample(); }, DISPATCHER_LANE_BACKGROUND));
+}
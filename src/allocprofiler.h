@@ -0,0 +1,95 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_ALLOCPROFILER_H
+#define FS_ALLOCPROFILER_H
+
+struct AllocationRate
+{
+	std::string label;
+	// in the last second
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+	// since startup
+	uint64_t totalAllocations = 0;
+	uint64_t totalBytes = 0;
+};
+
+// Built with --alloc-profiler, the global operator new counts every
+// allocation under the label of what its thread is running: the function
+// that queued the dispatcher task, the name of the thread anywhere else.
+// Counting takes two relaxed atomic adds on a fixed table and never
+// allocates. Once a second the counters are turned into allocations per
+// second by label.
+// --allocator picks what operator new allocates from, with or without the
+// profiler, to compare them on the same simulation.
+class AllocationProfiler
+{
+	public:
+		static constexpr size_t LABEL_CAPACITY = 1024;
+
+		static constexpr bool isBuiltIn() {
+#ifdef ALLOCATION_PROFILER
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		static const char* getAllocatorName();
+
+		static const char* getLabel() {
+			return currentLabel;
+		}
+
+		static const char* exchangeLabel(const char* label) {
+			return std::exchange(currentLabel, label);
+		}
+
+		// operator new, any thread
+		static void count(size_t bytes);
+
+		// dispatcher thread, samples every second from now on
+		void start();
+
+		// the last second, most allocations first
+		const std::vector<AllocationRate>& getLastSecond() const {
+			return lastSecond;
+		}
+
+		// every allocation counted since startup
+		static uint64_t getTotalAllocations();
+
+	private:
+		void sample();
+
+		static inline thread_local const char* currentLabel = nullptr;
+
+		std::vector<AllocationRate> lastSecond;
+		// totals of every table slot at the previous sample
+		std::vector<std::pair<uint64_t, uint64_t>> previous;
+		bool started = false;
+};
+
+extern AllocationProfiler g_allocationProfiler;
+
+// labels the allocations of the thread until it goes out of scope, label has
+// to outlive the server, like the names of a std::source_location
+class AllocationScope
+{
+	public:
+		explicit AllocationScope(const char* label) : previous(AllocationProfiler::exchangeLabel(label)) {}
+
+		~AllocationScope() {
+			AllocationProfiler::exchangeLabel(previous);
+		}
+
+		// non-copyable
+		AllocationScope(const AllocationScope&) = delete;
+		AllocationScope& operator=(const AllocationScope&) = delete;
+
+	private:
+		const char* previous;
+};
+
+#endif
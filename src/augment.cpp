@@ -26,6 +26,16 @@ Augment::Augment(std::shared_ptr<Augment>& original) : m_name(original->m_name),
 }
 
 
+bool Augment::isSameAs(const Augment& other) const {
+	const auto sameModifiers = [](const auto& modifiers, const auto& otherModifiers) {
+		return std::equal(modifiers.begin(), modifiers.end(), otherModifiers.begin(), otherModifiers.end(),
+			[](const auto& modifier, const auto& otherModifier) { return modifier->isSameAs(*otherModifier); });
+	};
+
+	return m_name == other.m_name && m_description == other.m_description
+		&& sameModifiers(m_attack_modifiers, other.m_attack_modifiers) && sameModifiers(m_defense_modifiers, other.m_defense_modifiers);
+}
+
 std::vector<std::shared_ptr<DamageModifier>> Augment::getAttackModifiers(uint8_t modType) {
 	std::vector<std::shared_ptr<DamageModifier>> modifiers;
 	for (auto& mod : m_attack_modifiers) {
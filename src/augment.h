@@ -45,6 +45,9 @@ public:
 	std::vector<std::shared_ptr<DamageModifier>> getAttackModifiers(uint8_t modType);
 	std::vector<std::shared_ptr<DamageModifier>> getDefenseModifiers(uint8_t modType);
 
+	// same name, description and modifiers in the same order
+	bool isSameAs(const Augment& other) const;
+
 	void serialize(PropWriteStream& propWriteStream) const {
 		// Serialize m_name and m_description
 		propWriteStream.writeString(m_name);
@@ -155,6 +158,7 @@ inline void Augment::setDescription(const std::string& description) {
 }
 
 inline void Augment::addModifier(std::shared_ptr<DamageModifier>& mod) {
+	DamageModifier::invalidateSets();
 	if (mod->getStance() == ATTACK_MOD) {
 		m_attack_modifiers.push_back(mod);
 	} else if (mod->getStance() == DEFENSE_MOD) {
@@ -163,6 +167,7 @@ inline void Augment::addModifier(std::shared_ptr<DamageModifier>& mod) {
 }
 
 inline void Augment::removeModifier(std::shared_ptr<DamageModifier>& mod) {
+	DamageModifier::invalidateSets();
 	if (mod->getStance() == ATTACK_MOD) {
 		m_attack_modifiers.erase(std::remove(m_attack_modifiers.begin(), m_attack_modifiers.end(), mod), m_attack_modifiers.end());
 	}
@@ -14,6 +14,14 @@
 
 static gtl::node_hash_map<std::string, std::shared_ptr<Augment>> global_augments {};
 
+// set in the count of lists written with a kind before every augment, the ones before are all full
+static constexpr uint32_t AUGMENT_LIST_KINDS = 0x80000000;
+
+enum StoredAugment : uint8_t {
+    STORED_AUGMENT_FULL = 0,
+    STORED_AUGMENT_REGISTERED = 1,
+};
+
 std::shared_ptr<Augment> Augments::MakeAugment(std::string_view augmentName)
 {
     auto it = global_augments.find(augmentName.data());
@@ -353,6 +361,67 @@ void Augments::RemoveAugment(const std::string& augName) {
     }
 }
 
+void Augments::Serialize(PropWriteStream& propWriteStream, const std::vector<std::shared_ptr<Augment>>& augments)
+{
+    propWriteStream.write<uint32_t>(static_cast<uint32_t>(augments.size()) | AUGMENT_LIST_KINDS);
+    for (const auto& augment : augments) {
+        const auto it = global_augments.find(augment->getName());
+        if (it != global_augments.end() && augment->isSameAs(*it->second)) {
+            propWriteStream.write<uint8_t>(STORED_AUGMENT_REGISTERED);
+            propWriteStream.writeString(augment->getName());
+        } else {
+            propWriteStream.write<uint8_t>(STORED_AUGMENT_FULL);
+            augment->serialize(propWriteStream);
+        }
+    }
+}
+
+bool Augments::Unserialize(PropStream& propReadStream, std::vector<std::shared_ptr<Augment>>& augments, uint32_t maxCount)
+{
+    uint32_t count = 0;
+    if (!propReadStream.read<uint32_t>(count)) {
+        return false;
+    }
+
+    const bool withKinds = (count & AUGMENT_LIST_KINDS) != 0;
+    count &= ~AUGMENT_LIST_KINDS;
+    if (count > maxCount) {
+        std::cout << "[Warning][Augments] Stored list of " << count << " augments is too long \n";
+        return false;
+    }
+
+    augments.reserve(augments.size() + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t kind = STORED_AUGMENT_FULL;
+        if (withKinds && !propReadStream.read<uint8_t>(kind)) {
+            return false;
+        }
+
+        if (kind == STORED_AUGMENT_REGISTERED) {
+            auto [name, success] = propReadStream.readString();
+            if (!success) {
+                return false;
+            }
+
+            // a definition removed since the save takes the augment with it, the
+            // lookup needs the name terminated
+            if (auto augment = GetAugment(std::string(name))) {
+                augments.push_back(std::move(augment));
+            } else {
+                std::cout << "[Warning][Augments] Stored augment " << name << " is no longer registered \n";
+            }
+            continue;
+        }
+
+        auto augment = std::make_shared<Augment>();
+        if (!augment->unserialize(propReadStream)) {
+            return false;
+        }
+        augments.push_back(std::move(augment));
+    }
+    return true;
+}
+
 std::shared_ptr<Augment> Augments::GetAugment(std::string_view augName)
 {
     auto it = global_augments.find(augName.data());
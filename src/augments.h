@@ -43,6 +43,11 @@ public:
 	static void RemoveAugment(std::string_view augName);
 	static void RemoveAugment(const std::string& augName);
 	static std::shared_ptr<Augment> GetAugment(std::string_view augName);
+
+	// the stored form of a list, an augment equal to its registered definition is
+	// stored by name alone and read back as a copy of the definition
+	static void Serialize(PropWriteStream& propWriteStream, const std::vector<std::shared_ptr<Augment>>& augments);
+	static bool Unserialize(PropStream& propReadStream, std::vector<std::shared_ptr<Augment>>& augments, uint32_t maxCount);
 };
 
 
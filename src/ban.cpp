@@ -4,18 +4,104 @@
 #include "otpch.h"
 
 #include "ban.h"
+#include "configmanager.h"
 #include "database.h"
 #include "databasetasks.h"
 #include "tools.h"
 
 #include <fmt/format.h>
 
+extern ConfigManager g_config;
+
+namespace {
+
+struct CachedBan
+{
+	BanInfo info;
+	int64_t validUntil = 0;
+	bool banned = false;
+};
+
+using BanCacheMap = gtl::flat_hash_map<uint32_t, CachedBan>;
+
+std::mutex cacheLock;
+BanCacheMap accountCache;
+BanCacheMap ipCache;
+BanCacheMap namelockCache;
+uint32_t cacheStores = 0;
+// bumped by clearCache, a lookup that started before it does not store its answer
+uint64_t cacheGeneration = 0;
+
+bool findCached(const BanCacheMap& cache, uint32_t key, CachedBan& entry, uint64_t& generation)
+{
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	generation = cacheGeneration;
+
+	auto it = cache.find(key);
+	if (it == cache.end() || it->second.validUntil <= OTSYS_TIME()) {
+		return false;
+	}
+
+	entry = it->second;
+	return true;
+}
+
+void storeCached(BanCacheMap& cache, uint32_t key, CachedBan entry, uint64_t generation)
+{
+	const int64_t cacheTime = g_config.getNumber(ConfigManager::BAN_CACHE_TIME);
+	if (cacheTime <= 0) {
+		return;
+	}
+
+	const int64_t now = OTSYS_TIME();
+	entry.validUntil = now + cacheTime;
+	if (entry.banned && entry.info.expiresAt != 0) {
+		// the next lookup after the end of the ban moves it out of the database
+		entry.validUntil = std::min<int64_t>(entry.validUntil, now + (entry.info.expiresAt - time(nullptr) + 1) * 1000);
+	}
+
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	if (generation != cacheGeneration) {
+		return;
+	}
+
+	// a flood of addresses leaves answers no one asks for again, forget them
+	if (++cacheStores >= 4096) {
+		cacheStores = 0;
+		for (BanCacheMap* map : {&accountCache, &ipCache, &namelockCache}) {
+			for (auto it = map->begin(); it != map->end();) {
+				if (it->second.validUntil <= now) {
+					map->erase(it++);
+				} else {
+					++it;
+				}
+			}
+		}
+	}
+
+	cache.insert_or_assign(key, std::move(entry));
+}
+
+}
+
 bool Ban::acceptConnection(uint32_t clientIP)
 {
-	std::lock_guard<std::recursive_mutex> lockClass(lock);
+	std::lock_guard<std::mutex> lockClass(lock);
 
 	uint64_t currentTime = OTSYS_TIME();
 
+	// addresses quiet for a while connect as if for the first time, forget them
+	if (++connectChecks >= 4096) {
+		connectChecks = 0;
+		for (auto it = ipConnectMap.begin(); it != ipConnectMap.end();) {
+			if (it->second.blockTime <= currentTime && currentTime - it->second.lastAttempt > 60000) {
+				ipConnectMap.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+
 	auto it = ipConnectMap.find(clientIP);
 	if (it == ipConnectMap.end()) {
 		ipConnectMap.emplace(clientIP, ConnectBlock(currentTime, 0, 1));
@@ -44,12 +130,20 @@ bool Ban::acceptConnection(uint32_t clientIP)
 	return true;
 }
 
-bool IOBan::isAccountBanned(uint32_t accountId, BanInfo& banInfo)
+bool IOBan::isAccountBanned(Database& db, uint32_t accountId, BanInfo& banInfo)
 {
-	Database& db = Database::getInstance();
+	CachedBan cached;
+	uint64_t generation;
+	if (findCached(accountCache, accountId, cached, generation)) {
+		if (cached.banned) {
+			banInfo = cached.info;
+		}
+		return cached.banned;
+	}
 
 	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `reason`, `expires_at`, `banned_at`, `banned_by`, (SELECT `name` FROM `players` WHERE `id` = `banned_by`) AS `name` FROM `account_bans` WHERE `account_id` = {:d}", accountId));
 	if (!result) {
+		storeCached(accountCache, accountId, cached, generation);
 		return false;
 	}
 
@@ -58,41 +152,70 @@ bool IOBan::isAccountBanned(uint32_t accountId, BanInfo& banInfo)
 		// Move the ban to history if it has expired
 		g_databaseTasks.addTask(fmt::format("INSERT INTO `account_ban_history` (`account_id`, `reason`, `banned_at`, `expired_at`, `banned_by`) VALUES ({:d}, {:s}, {:d}, {:d}, {:d})", accountId, db.escapeString(result->getString("reason")), result->getNumber<time_t>("banned_at"), expiresAt, result->getNumber<uint32_t>("banned_by")));
 		g_databaseTasks.addTask(fmt::format("DELETE FROM `account_bans` WHERE `account_id` = {:d}", accountId));
+		storeCached(accountCache, accountId, cached, generation);
 		return false;
 	}
 
 	banInfo.expiresAt = expiresAt;
 	banInfo.reason = result->getString("reason");
 	banInfo.bannedBy = result->getString("name");
+	storeCached(accountCache, accountId, {banInfo, 0, true}, generation);
 	return true;
 }
 
-bool IOBan::isIpBanned(uint32_t clientIP, BanInfo& banInfo)
+bool IOBan::isIpBanned(Database& db, uint32_t clientIP, BanInfo& banInfo)
 {
 	if (clientIP == 0) {
 		return false;
 	}
 
-	Database& db = Database::getInstance();
+	CachedBan cached;
+	uint64_t generation;
+	if (findCached(ipCache, clientIP, cached, generation)) {
+		if (cached.banned) {
+			banInfo = cached.info;
+		}
+		return cached.banned;
+	}
 
 	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `reason`, `expires_at`, (SELECT `name` FROM `players` WHERE `id` = `banned_by`) AS `name` FROM `ip_bans` WHERE `ip` = {:d}", clientIP));
 	if (!result) {
+		storeCached(ipCache, clientIP, cached, generation);
 		return false;
 	}
 
 	int64_t expiresAt = result->getNumber<int64_t>("expires_at");
 	if (expiresAt != 0 && time(nullptr) > expiresAt) {
 		g_databaseTasks.addTask(fmt::format("DELETE FROM `ip_bans` WHERE `ip` = {:d}", clientIP));
+		storeCached(ipCache, clientIP, cached, generation);
 		return false;
 	}
 
 	banInfo.expiresAt = expiresAt;
 	banInfo.reason = result->getString("reason");
 	banInfo.bannedBy = result->getString("name");
+	storeCached(ipCache, clientIP, {banInfo, 0, true}, generation);
 	return true;
 }
 
-bool IOBan::isPlayerNamelocked(uint32_t playerId)
+bool IOBan::isPlayerNamelocked(Database& db, uint32_t playerId)
+{
+	CachedBan cached;
+	uint64_t generation;
+	if (findCached(namelockCache, playerId, cached, generation)) {
+		return cached.banned;
+	}
+
+	cached.banned = db.storeQuery(fmt::format("SELECT 1 FROM `player_namelocks` WHERE `player_id` = {:d}", playerId)).get() != nullptr;
+	storeCached(namelockCache, playerId, cached, generation);
+	return cached.banned;
+}
+
+void IOBan::clearCache()
 {
-	return Database::getInstance().storeQuery(fmt::format("SELECT 1 FROM `player_namelocks` WHERE `player_id` = {:d}", playerId)).get() != nullptr;
+	std::lock_guard<std::mutex> lockClass(cacheLock);
+	++cacheGeneration;
+	accountCache.clear();
+	ipCache.clear();
+	namelockCache.clear();
 }
@@ -4,6 +4,8 @@
 #ifndef FS_BAN_H
 #define FS_BAN_H
 
+#include <gtl/phmap.hpp>
+
 struct BanInfo {
 	std::string bannedBy;
 	std::string reason;
@@ -19,7 +21,7 @@ struct ConnectBlock {
 	uint32_t count;
 };
 
-using IpConnectMap = std::map<uint32_t, ConnectBlock>;
+using IpConnectMap = gtl::flat_hash_map<uint32_t, ConnectBlock>;
 
 class Ban
 {
@@ -28,15 +30,26 @@ class Ban
 
 	private:
 		IpConnectMap ipConnectMap;
-		std::recursive_mutex lock;
+		std::mutex lock;
+		uint32_t connectChecks = 0;
 };
 
+class Database;
+
+// The lookups take the connection to run on, the login path calls them from
+// the database workers. Their answers, banned or not, are kept for
+// banCacheTime milliseconds and never past the end of the ban, so a flood of
+// logins for the same account or address queries the database once. Bans
+// written without clearCache show up when the entries run out.
 class IOBan
 {
 	public:
-		static bool isAccountBanned(uint32_t accountId, BanInfo& banInfo);
-		static bool isIpBanned(uint32_t clientIP, BanInfo& banInfo);
-		static bool isPlayerNamelocked(uint32_t playerId);
+		static bool isAccountBanned(Database& db, uint32_t accountId, BanInfo& banInfo);
+		static bool isIpBanned(Database& db, uint32_t clientIP, BanInfo& banInfo);
+		static bool isPlayerNamelocked(Database& db, uint32_t playerId);
+
+		// any thread, after adding or lifting a ban
+		static void clearCache();
 };
 
 #endif
@@ -7,6 +7,7 @@
 #include "game.h"
 #include "pugicast.h"
 #include "scheduler.h"
+#include "worldbus.h"
 
 #include <fmt/format.h>
 
@@ -130,12 +131,24 @@ bool ChatChannel::talk(const PlayerConstPtr& fromPlayer, SpeakClasses type, cons
 		return false;
 	}
 
+	// the same bytes for every listener, encoded once
+	NetworkMessage msg;
+	ProtocolGame::AddToChannel(msg, fromPlayer, type, text, id);
 	for (const auto& val : users | std::views::values) {
-		val->sendToChannel(fromPlayer, type, text, id);
+		val->sendBroadcast(msg);
 	}
 	return true;
 }
 
+void ChatChannel::talk(const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text)
+{
+	NetworkMessage msg;
+	ProtocolGame::AddToChannel(msg, speaker, level, type, text, id);
+	for (const auto& val : users | std::views::values) {
+		val->sendBroadcast(msg);
+	}
+}
+
 bool ChatChannel::executeCanJoinEvent(const PlayerConstPtr& player) const
 {
 	if (canJoinEvent == -1) {
@@ -155,8 +168,7 @@ bool ChatChannel::executeCanJoinEvent(const PlayerConstPtr& player) const
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(canJoinEvent);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	return scriptInterface->callFunction(1);
 }
@@ -180,8 +192,7 @@ bool ChatChannel::executeOnJoinEvent(const PlayerConstPtr& player) const
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(onJoinEvent);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	return scriptInterface->callFunction(1);
 }
@@ -205,8 +216,7 @@ bool ChatChannel::executeOnLeaveEvent(const PlayerConstPtr& player) const
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(onLeaveEvent);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	return scriptInterface->callFunction(1);
 }
@@ -230,8 +240,7 @@ bool ChatChannel::executeOnSpeakEvent(const PlayerConstPtr& player, SpeakClasses
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(onSpeakEvent);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	lua_pushinteger(L, type);
 	LuaScriptInterface::pushString(L, message);
@@ -492,7 +501,17 @@ bool Chat::talkToChannel(const PlayerConstPtr& player, SpeakClasses type, const
 		return false;
 	}
 
-	return channel->talk(player, type, text);
+	if (!channel->talk(player, type, text)) {
+		return false;
+	}
+
+	// the members on the other worlds hear it too
+	if (channelId == CHANNEL_GUILD) {
+		if (const auto& guild = player->getGuild()) {
+			g_worldBus.publishGuildMessage(guild->getId(), player, type, text);
+		}
+	}
+	return true;
 }
 
 ChannelList Chat::getChannelList(const PlayerConstPtr& player)
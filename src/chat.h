@@ -7,10 +7,13 @@
 #include "const.h"
 #include "luascript.h"
 
+#include <gtl/btree.hpp>
+
 class Party;
 class Player;
 
-using UsersMap = std::map<uint32_t, PlayerPtr>;
+// listeners sit side by side in the nodes, a message walks them in order
+using UsersMap = gtl::btree_map<uint32_t, PlayerPtr>;
 using InvitedMap = std::map<uint32_t, PlayerConstPtr>;
 
 class ChatChannel
@@ -27,6 +30,8 @@ class ChatChannel
 		bool hasUser( const PlayerConstPtr& player) const;
 
 		bool talk(const PlayerConstPtr& fromPlayer, SpeakClasses type, const std::string& text);
+		// said on another world
+		void talk(const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text);
 		void sendToAll(const std::string& message, SpeakClasses type) const;
 
 		const std::string& getName() const {
@@ -20,53 +20,39 @@ extern Events* g_events;
 // we use a thread-local tile buffer for reuse across calls to avoid repeated allocations
 thread_local std::vector<TilePtr> area_tile_buffer;
 
-static std::vector<TilePtr> getList(const MatrixArea& area, const Position& targetPos, const Direction dir) 
+static std::vector<TilePtr> getList(const std::vector<AreaOffset>& offsets, const Position& targetPos, const Direction dir) 
 {
 	const Position casterPos = getNextPosition(dir, targetPos);
-
-	const uint32_t rows = area.getRows();
-	const uint32_t cols = area.getCols();
-	const auto& center = area.getCenter();
-
-	const int32_t startX = targetPos.x - static_cast<int32_t>(center.first);
-	const int32_t startY = targetPos.y - static_cast<int32_t>(center.second);
 	const uint32_t z = targetPos.z;
 
 	area_tile_buffer.clear();
-	area_tile_buffer.reserve(rows * cols);
+	area_tile_buffer.reserve(offsets.size());
 
+	// the offsets go row by row, neighbours mostly share a quadtree leaf
+	Map::TileLookupHint hint;
 	Position pos(0, 0, z);
 
-	for (uint32_t row = 0; row < rows; ++row) 
+	for (const AreaOffset& offset : offsets) 
 	{
-		pos.y = startY + static_cast<int32_t>(row);
+		pos.x = targetPos.x + offset.x;
+		pos.y = targetPos.y + offset.y;
 
-		for (uint32_t col = 0; col < cols; ++col) 
+		[[unlikely]]
+		if (not g_game.isSightClear(casterPos, pos, true))
 		{
-			[[unlikely]]
-			if (not area(row, col))  
-			{
-				continue;
-			}
-
-			pos.x = startX + static_cast<int32_t>(col);
-
-			[[unlikely]]
-			if (not g_game.isSightClear(casterPos, pos, true))
-			{
-				continue;
-			}
-
-			auto tile = g_game.map.getTile(pos);
-			[[unlikely]]
-			if (not tile)
-			{
-				tile = std::make_shared<Tile>(pos.x, pos.y, z);
-				g_game.map.setTile(pos, tile);
-			}
+			continue;
+		}
 
-			area_tile_buffer.push_back(tile);
+		auto tile = g_game.map.getTile(pos.x, pos.y, z, hint);
+		[[unlikely]]
+		if (not tile)
+		{
+			tile = std::make_shared<Tile>(pos.x, pos.y, z);
+			g_game.map.setTile(pos, tile);
+			hint = {};
 		}
+
+		area_tile_buffer.push_back(tile);
 	}
 
 	return area_tile_buffer;
@@ -84,7 +70,7 @@ std::vector<TilePtr> getCombatArea(const Position& centerPos, const Position& ta
 	[[likely]]
 	if (area) 
 	{
-		return getList(area->getArea(centerPos, targetPos), targetPos, getDirectionTo(targetPos, centerPos));
+		return getList(area->getOffsets(centerPos, targetPos), targetPos, getDirectionTo(targetPos, centerPos));
 	}
 
 	auto tile = g_game.map.getTile(targetPos);
@@ -357,7 +343,7 @@ bool Combat::isInPvpZone(const CreatureConstPtr& attacker, const CreatureConstPt
 
 bool Combat::isProtected(const PlayerConstPtr& attacker, const PlayerConstPtr& target)
 {
-	uint32_t protectionLevel = g_config.getNumber(ConfigManager::PROTECTION_LEVEL);
+	uint32_t protectionLevel = g_config.getSnapshot().protectionLevel;
 	if (target->getLevel() < protectionLevel or attacker->getLevel() < protectionLevel) 
 	{
 		return true;
@@ -1126,7 +1112,7 @@ void Combat::doTargetCombat(const CreaturePtr& caster, const CreaturePtr& target
 	if (success) {
 		if (target and caster and target != caster) {
 			if (damage.critical) {
-				if ((damage.augmented and g_config.getBoolean(ConfigManager::AUGMENT_CRITICAL_ANIMATION)) or not (damage.augmented)) {
+				if ((damage.augmented and g_config.getSnapshot().augmentCriticalAnimation) or not (damage.augmented)) {
 					g_game.addMagicEffect(target->getPosition(), CONST_ME_CRITICAL_DAMAGE);
 				}
 			}
@@ -1356,7 +1342,7 @@ void Combat::doTargetCombat(const CreaturePtr& caster, const CreaturePtr& target
 
 				if (staminaGain) {
 					if (staminaGain <= std::numeric_limits<uint16_t>::max()) {
-						const uint16_t trueStaminaGain = g_config.getBoolean(ConfigManager::AUGMENT_STAMINA_RULE) ?
+						const uint16_t trueStaminaGain = g_config.getSnapshot().augmentStaminaRule ?
 							static_cast<uint16_t>(staminaGain) :
 							static_cast<uint16_t>(staminaGain / 60);
 						
@@ -1487,11 +1473,13 @@ void Combat::doAreaCombat(const CreaturePtr& caster, const Position& position, c
 		}
 	}
 
+	g_game.beginCombatBatch(spectators);
 	for (const auto& target : toDamageCreatures) 
 	{
 		CombatDamage local_damage = damage;
 		Combat::doTargetCombat(caster, target, local_damage, p, false);
 	}
+	g_game.endCombatBatch();
 }
 
 void Combat::applyDamageIncreaseModifier
@@ -1567,8 +1555,100 @@ void Combat::applyDamageReductionModifier
 
 //**********************************************************//
 
+std::optional<std::pair<double, double>> ValueCallback::probe(int32_t level, int32_t magicLevel) const
+{
+	if (!scriptInterface->reserveScriptEnv()) {
+		return std::nullopt;
+	}
+
+	ScriptEnvironment* env = scriptInterface->getScriptEnv();
+	if (!env->setCallbackId(scriptId, scriptInterface)) {
+		scriptInterface->resetScriptEnv();
+		return std::nullopt;
+	}
+
+	lua_State* L = scriptInterface->getLuaState();
+	const int top = lua_gettop(L);
+
+	// without a player, a callback that looks at one fails here and stays a script
+	scriptInterface->pushFunction(scriptId);
+	lua_pushnil(L);
+	lua_pushinteger(L, level);
+	lua_pushinteger(L, magicLevel);
+
+	std::optional<std::pair<double, double>> values;
+	if (lua_pcall(L, 3, 2, 0) == 0 && lua_type(L, -2) == LUA_TNUMBER && lua_type(L, -1) == LUA_TNUMBER) {
+		values.emplace(lua_tonumber(L, -2), lua_tonumber(L, -1));
+	}
+
+	lua_settop(L, top);
+	scriptInterface->resetScriptEnv();
+	return values;
+}
+
+void ValueCallback::compile()
+{
+	formula.reset();
+	if (type != COMBAT_FORMULA_LEVELMAGIC || !scriptInterface) {
+		return;
+	}
+
+	static constexpr int32_t scale = 1000;
+	const auto base = probe(0, 0);
+	const auto levelStep = probe(scale, 0);
+	const auto magicStep = probe(0, scale);
+	if (!base || !levelStep || !magicStep) {
+		return;
+	}
+
+	LinearFormula linear{
+		(levelStep->first - base->first) / scale, (magicStep->first - base->first) / scale, base->first,
+		(levelStep->second - base->second) / scale, (magicStep->second - base->second) / scale, base->second,
+	};
+
+	// the samples cover low levels and caps scripts put on them, a random or
+	// clamped formula misses one of them and is left to the script
+	static constexpr std::array<std::pair<int32_t, int32_t>, 10> samples {{
+		{1, 0}, {8, 3}, {20, 20}, {21, 21}, {57, 13}, {100, 50}, {250, 90}, {600, 120}, {1300, 150}, {5000, 300},
+	}};
+
+	for (const auto& [level, magicLevel] : samples) {
+		const auto values = probe(level, magicLevel);
+		if (!values) {
+			return;
+		}
+
+		const double min = std::fma(level, linear.minLevel, std::fma(magicLevel, linear.minMagic, linear.minBase));
+		const double max = std::fma(level, linear.maxLevel, std::fma(magicLevel, linear.maxMagic, linear.maxBase));
+		if (static_cast<int32_t>(min) != static_cast<int32_t>(values->first) || static_cast<int32_t>(max) != static_cast<int32_t>(values->second)) {
+			return;
+		}
+
+		if (std::abs(min - values->first) > 1e-6 * std::max(1.0, std::abs(min)) || std::abs(max - values->second) > 1e-6 * std::max(1.0, std::abs(max))) {
+			return;
+		}
+	}
+
+	const auto repeat = probe(57, 13);
+	if (!repeat || repeat != probe(57, 13)) {
+		return;
+	}
+
+	formula = linear;
+}
+
 void ValueCallback::getMinMaxValues(const PlayerPtr& player, CombatDamage& damage) const
 {
+	if (formula) {
+		const int32_t level = player->getLevel();
+		const int32_t magicLevel = player->getMagicLevel();
+		damage.primary.value = normal_random(
+			static_cast<int32_t>(std::fma(level, formula->minLevel, std::fma(magicLevel, formula->minMagic, formula->minBase))),
+			static_cast<int32_t>(std::fma(level, formula->maxLevel, std::fma(magicLevel, formula->maxMagic, formula->maxBase)))
+		);
+		return;
+	}
+
 	//onGetPlayerMinMaxValues(...)
 	if (!scriptInterface->reserveScriptEnv()) {
 		std::cout << "[Error - ValueCallback::getMinMaxValues] Call stack overflow" << std::endl;
@@ -1585,8 +1665,7 @@ void ValueCallback::getMinMaxValues(const PlayerPtr& player, CombatDamage& damag
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	int parameters = 1;
 	switch (type) {
@@ -1670,8 +1749,7 @@ void TileCallback::onTileCombat(const CreaturePtr& creature, const TilePtr& tile
 
 	scriptInterface->pushFunction(scriptId);
 	if (creature) {
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 	} else {
 		lua_pushnil(L);
 	}
@@ -1701,15 +1779,13 @@ void TargetCallback::onTargetCombat(const CreaturePtr& creature, const CreatureP
 	scriptInterface->pushFunction(scriptId);
 
 	if (creature) {
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 	} else {
 		lua_pushnil(L);
 	}
 
 	if (target) {
-		LuaScriptInterface::pushSharedPtr(L, target);
-		LuaScriptInterface::setCreatureMetatable(L, -1, target);
+		LuaScriptInterface::pushCreature(L, target);
 	} else {
 		lua_pushnil(L);
 	}
@@ -1727,7 +1803,7 @@ void TargetCallback::onTargetCombat(const CreaturePtr& creature, const CreatureP
 	scriptInterface->resetScriptEnv();
 }
 
-const MatrixArea& AreaCombat::getArea(const Position& centerPos, const Position& targetPos) const {
+size_t AreaCombat::getAreaIndex(const Position& centerPos, const Position& targetPos) const {
 	const int32_t dx = Position::getOffsetX(targetPos, centerPos);
 	const int32_t dy = Position::getOffsetY(targetPos, centerPos);
 
@@ -1754,15 +1830,52 @@ const MatrixArea& AreaCombat::getArea(const Position& centerPos, const Position&
 		}
 	}
 
+	return dir;
+}
+
+const MatrixArea& AreaCombat::getArea(const Position& centerPos, const Position& targetPos) const {
+	const size_t index = getAreaIndex(centerPos, targetPos);
 	[[unlikely]]
-	if (dir >= areas.size()) {
+	if (index >= areas.size()) {
 		// log location
 		static MatrixArea empty;
 		return empty;
 	}
-	return areas[dir];
+	return areas[index];
 }
 
+const std::vector<AreaOffset>& AreaCombat::getOffsets(const Position& centerPos, const Position& targetPos) const {
+	const size_t index = getAreaIndex(centerPos, targetPos);
+	[[unlikely]]
+	if (index >= offsets.size()) {
+		static const std::vector<AreaOffset> empty;
+		return empty;
+	}
+	return offsets[index];
+}
+
+void AreaCombat::updateOffsets()
+{
+	offsets.resize(areas.size());
+	for (size_t i = 0; i < areas.size(); ++i) {
+		const MatrixArea& area = areas[i];
+		const auto& center = area.getCenter();
+
+		auto& list = offsets[i];
+		list.clear();
+		for (uint32_t row = 0; row < area.getRows(); ++row) {
+			for (uint32_t col = 0; col < area.getCols(); ++col) {
+				if (area(row, col)) {
+					list.push_back({static_cast<int16_t>(static_cast<int32_t>(col) - static_cast<int32_t>(center.first)),
+						static_cast<int16_t>(static_cast<int32_t>(row) - static_cast<int32_t>(center.second))});
+				}
+			}
+		}
+		list.shrink_to_fit();
+	}
+}
+
+
 void AreaCombat::setupArea(const std::vector<uint32_t>& vec, uint32_t rows)
 {
 	auto area = createArea(vec, rows);
@@ -1774,6 +1887,7 @@ void AreaCombat::setupArea(const std::vector<uint32_t>& vec, uint32_t rows)
 	areas[DIRECTION_SOUTH] = area.rotate180();
 	areas[DIRECTION_WEST] = area.rotate270();
 	areas[DIRECTION_NORTH] = std::move(area);
+	updateOffsets();
 }
 
 void AreaCombat::setupArea(int32_t length, int32_t spread)
@@ -1859,6 +1973,7 @@ void AreaCombat::setupExtArea(const std::vector<uint32_t>& vec, uint32_t rows)
 	areas[DIRECTION_SOUTHEAST] = area.rotate180();
 	areas[DIRECTION_SOUTHWEST] = area.rotate270();
 	areas[DIRECTION_NORTHWEST] = std::move(area);
+	updateOffsets();
 }
 
 void MagicField::onStepInField(const CreaturePtr& creature)
@@ -28,7 +28,19 @@ class ValueCallback final : public CallBack
 		explicit ValueCallback(formulaType_t type): type(type) {}
 		void getMinMaxValues(const PlayerPtr& player, CombatDamage& damage) const;
 
+		// a level and magic level callback returning a * level + b * magicLevel + c
+		// for min and max is read once, the hits then work it out without calling it
+		void compile();
+
 	private:
+		struct LinearFormula {
+			double minLevel, minMagic, minBase;
+			double maxLevel, maxMagic, maxBase;
+		};
+
+		std::optional<std::pair<double, double>> probe(int32_t level, int32_t magicLevel) const;
+
+		std::optional<LinearFormula> formula;
 		formulaType_t type;
 };
 
@@ -68,6 +80,12 @@ struct CombatParams {
 	bool ignoreResistances = false;
 };
 
+// a tile of an area, relative to the position it is cast at
+struct AreaOffset {
+	int16_t x;
+	int16_t y;
+};
+
 class AreaCombat
 {
 	public:
@@ -76,10 +94,16 @@ class AreaCombat
 		void setupArea(int32_t radius);
 		void setupExtArea(const std::vector<uint32_t>& vec, uint32_t rows);
 		const MatrixArea& getArea(const Position& centerPos, const Position& targetPos) const;
-		
+		// the tiles of getArea only, row by row
+		const std::vector<AreaOffset>& getOffsets(const Position& centerPos, const Position& targetPos) const;
 
 	private:
+		size_t getAreaIndex(const Position& centerPos, const Position& targetPos) const;
+		void updateOffsets();
+
 		std::vector<MatrixArea> areas;
+		// one list for each of the areas, built when they are set up
+		std::vector<std::vector<AreaOffset>> offsets;
 		bool hasExtArea = false;
 };
 
@@ -6,9 +6,47 @@
 #include "condition.h"
 #include "game.h"
 #include "monster.h"
+#include "lockfree.h"
 
 extern Game g_game;
 
+namespace {
+
+constexpr size_t CONDITION_FREE_LIST_CAPACITY = 1024;
+
+// one free list for each size, types of the same size share it
+template <typename... Types>
+struct ConditionPool
+{
+	static void* allocate(const size_t size) {
+		void* p = nullptr;
+		((size == sizeof(Types) && (p = LockfreePoolingAllocator<Types, CONDITION_FREE_LIST_CAPACITY>().allocate(1))) || ...);
+		return p ? p : ::operator new(size);
+	}
+
+	static void deallocate(void* p, const size_t size) {
+		const bool pooled = ((size == sizeof(Types) && (LockfreePoolingAllocator<Types, CONDITION_FREE_LIST_CAPACITY>().deallocate(static_cast<Types*>(p), 1), true)) || ...);
+		if (!pooled) {
+			::operator delete(p);
+		}
+	}
+};
+
+using ConditionAllocator = ConditionPool<ConditionGeneric, ConditionAttributes, ConditionRegeneration, ConditionSoul, ConditionInvisible,
+	ConditionDamage, ConditionSpeed, ConditionOutfit, ConditionLight, ConditionSpellCooldown, ConditionSpellGroupCooldown, ConditionDrunk>;
+
+}
+
+void* Condition::operator new(const size_t size)
+{
+	return ConditionAllocator::allocate(size);
+}
+
+void Condition::operator delete(void* p, const size_t size)
+{
+	ConditionAllocator::deallocate(p, size);
+}
+
 bool Condition::setParam(ConditionParam_t param, int32_t value)
 {
 	switch (param) {
@@ -134,7 +172,7 @@ void Condition::serialize(PropWriteStream& propWriteStream)
 	propWriteStream.write<uint32_t>(id);
 
 	propWriteStream.write<uint8_t>(CONDITIONATTR_TICKS);
-	propWriteStream.write<uint32_t>(ticks);
+	propWriteStream.write<uint32_t>(getTicks());
 
 	propWriteStream.write<uint8_t>(CONDITIONATTR_ISBUFF);
 	propWriteStream.write<uint8_t>(isBuff);
@@ -146,6 +184,14 @@ void Condition::serialize(PropWriteStream& propWriteStream)
 	propWriteStream.write<uint8_t>(aggressive);
 }
 
+int32_t Condition::getTicks() const
+{
+	if (periodic || ticks <= 0 || endTime == 0) {
+		return ticks;
+	}
+	return static_cast<int32_t>(std::clamp<int64_t>(endTime - OTSYS_TIME(), 0, ticks));
+}
+
 void Condition::setTicks(int32_t newTicks)
 {
 	ticks = newTicks;
@@ -1219,7 +1265,7 @@ bool ConditionDamage::init()
 			startDamage = std::max<int32_t>(1, std::ceil(amount / 20.0));
 		}
 
-		std::list<int32_t> list;
+		std::vector<int32_t> list;
 		ConditionDamage::generateDamageList(amount, startDamage, list);
 		for (int32_t value : list) {
 			addDamage(1, tickInterval, -value);
@@ -1495,7 +1541,7 @@ uint32_t ConditionDamage::getIcons() const
 	return icons;
 }
 
-void ConditionDamage::generateDamageList(int32_t amount, int32_t start, std::list<int32_t>& list)
+void ConditionDamage::generateDamageList(int32_t amount, int32_t start, std::vector<int32_t>& list)
 {
 	amount = std::abs(amount);
 	int32_t sum = 0;
@@ -7,6 +7,7 @@
 #include "fileloader.h"
 #include "enums.h"
 #include "declarations.h"
+#include "instancecounter.h"
 
 class PropStream;
 
@@ -52,7 +53,67 @@ struct IntervalInfo {
 	int32_t interval;
 };
 
-class Condition
+// the damage rounds of a ConditionDamage in one block. Rounds are taken from
+// the front, the space they leave is reused once the list runs empty or more
+// than half of it is spent.
+class IntervalQueue
+{
+	public:
+		IntervalQueue() = default;
+		IntervalQueue(const IntervalQueue& other) : rounds(other.begin(), other.end()) {}
+		IntervalQueue& operator=(const IntervalQueue& other) {
+			if (this != &other) {
+				rounds.assign(other.begin(), other.end());
+				head = 0;
+			}
+			return *this;
+		}
+
+		bool empty() const {
+			return head == rounds.size();
+		}
+
+		IntervalInfo& front() {
+			return rounds[head];
+		}
+
+		const IntervalInfo& front() const {
+			return rounds[head];
+		}
+
+		void push_back(const IntervalInfo& info) {
+			if (head != 0 && head * 2 >= rounds.size()) {
+				rounds.erase(rounds.begin(), rounds.begin() + head);
+				head = 0;
+			}
+			rounds.push_back(info);
+		}
+
+		void pop_front() {
+			if (++head == rounds.size()) {
+				clear();
+			}
+		}
+
+		void clear() {
+			rounds.clear();
+			head = 0;
+		}
+
+		std::vector<IntervalInfo>::const_iterator begin() const {
+			return rounds.begin() + head;
+		}
+
+		std::vector<IntervalInfo>::const_iterator end() const {
+			return rounds.end();
+		}
+
+	private:
+		std::vector<IntervalInfo> rounds;
+		size_t head = 0;
+};
+
+class Condition : public InstanceCounter<Condition>
 {
 	public:
 		Condition() = default;
@@ -61,6 +122,10 @@ class Condition
 			subId(subId), ticks(ticks), conditionType(type), isBuff(buff), aggressive(aggressive), id(id) {}
 		virtual ~Condition() = default;
 
+		// poison, fire and bleeding come and go all fight long, their memory is recycled
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
 		virtual bool startCondition(CreaturePtr creature);
 		virtual bool executeCondition(CreaturePtr creature, int32_t interval);
 		virtual void endCondition(CreaturePtr creature) = 0;
@@ -85,9 +150,8 @@ class Condition
 			return endTime;
 		}
 	
-		int32_t getTicks() const {
-			return ticks;
-		}
+		// the ones executeConditions skips until they end count down by their end time
+		int32_t getTicks() const;
 	
 		void setTicks(int32_t newTicks);
 	
@@ -108,6 +172,11 @@ class Condition
 
 		bool isPersistent() const;
 
+		// whether executeCondition has work before the end time
+		bool isDue(int64_t now) const {
+			return periodic || endTime < now;
+		}
+
 	protected:
 		virtual bool updateCondition(const Condition* addCondition);
 
@@ -117,6 +186,8 @@ class Condition
 		ConditionType_t conditionType;
 		bool isBuff;
 		bool aggressive;
+		// acts every think, like damage over time and regeneration
+		bool periodic = false;
 
 	private:
 		ConditionId_t id;
@@ -184,7 +255,9 @@ class ConditionRegeneration final : public ConditionGeneric
 {
 	public:
 		ConditionRegeneration(ConditionId_t id, ConditionType_t type, int32_t ticks, bool buff = false, uint32_t subId = 0, bool aggressive = false):
-			ConditionGeneric(id, type, ticks, buff, subId, aggressive) {}
+			ConditionGeneric(id, type, ticks, buff, subId, aggressive) {
+			periodic = true;
+		}
 
 		void addCondition(CreaturePtr creature, const Condition* condition) override;
 		bool executeCondition(CreaturePtr creature, int32_t interval) override;
@@ -214,7 +287,9 @@ class ConditionSoul final : public ConditionGeneric
 {
 	public:
 		ConditionSoul(ConditionId_t id, ConditionType_t type, int32_t ticks, bool buff = false, uint32_t subId = 0, bool aggressive = false) :
-			ConditionGeneric(id, type, ticks, buff, subId, aggressive) {}
+			ConditionGeneric(id, type, ticks, buff, subId, aggressive) {
+			periodic = true;
+		}
 
 		void addCondition(CreaturePtr creature, const Condition* condition) override;
 		bool executeCondition(CreaturePtr creature, int32_t interval) override;
@@ -253,11 +328,15 @@ class ConditionInvisible final : public ConditionGeneric
 class ConditionDamage final : public Condition
 {
 	public:
-		ConditionDamage() = default;
+		ConditionDamage() {
+			periodic = true;
+		}
 		ConditionDamage(ConditionId_t id, ConditionType_t type, bool buff = false, uint32_t subId = 0, bool aggressive = true) :
-			Condition(id, type, 0, buff, subId, aggressive) {}
+			Condition(id, type, 0, buff, subId, aggressive) {
+			periodic = true;
+		}
 
-		static void generateDamageList(int32_t amount, int32_t start, std::list<int32_t>& list);
+		static void generateDamageList(int32_t amount, int32_t start, std::vector<int32_t>& list);
 
 		bool startCondition(CreaturePtr creature) override;
 		bool executeCondition(CreaturePtr creature, int32_t interval) override;
@@ -304,7 +383,7 @@ class ConditionDamage final : public Condition
 
 		bool init();
 
-		std::list<IntervalInfo> damageList;
+		IntervalQueue damageList;
 
 		bool getNextDamage(int32_t& damage);
 		bool doDamage(CreaturePtr creature, int32_t healthChange) const;
@@ -376,7 +455,9 @@ class ConditionLight final : public Condition
 {
 	public:
 		ConditionLight(ConditionId_t id, ConditionType_t type, int32_t ticks, bool buff, uint32_t subId, uint8_t lightlevel, uint8_t lightcolor, bool aggressive = false) :
-			Condition(id, type, ticks, buff, subId, aggressive), lightInfo(lightlevel, lightcolor) {}
+			Condition(id, type, ticks, buff, subId, aggressive), lightInfo(lightlevel, lightcolor) {
+			periodic = true;
+		}
 
 		bool startCondition(CreaturePtr creature) override;
 		bool executeCondition(CreaturePtr creature, int32_t interval) override;
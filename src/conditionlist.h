@@ -0,0 +1,137 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_CONDITIONLIST_H
+#define FS_CONDITIONLIST_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+class Condition;
+
+// The conditions of a creature, in the order they were added. Erasing one
+// leaves a hole that iteration skips, so an iterator or slot stays valid while
+// conditions end or start inside a loop over them. compact closes the holes
+// and must only be called when no loop is running.
+class ConditionList
+{
+	public:
+		class iterator
+		{
+			public:
+				using iterator_concept = std::forward_iterator_tag;
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = Condition*;
+				using difference_type = std::ptrdiff_t;
+				using pointer = Condition* const*;
+				using reference = Condition* const&;
+
+				iterator() = default;
+
+				reference operator*() const {
+					return (*items)[index];
+				}
+
+				iterator& operator++() {
+					++index;
+					skipHoles();
+					return *this;
+				}
+
+				iterator operator++(int) {
+					iterator copy = *this;
+					++*this;
+					return copy;
+				}
+
+				// end follows the conditions added while iterating
+				bool operator==(const iterator& other) const {
+					if (sentinel || other.sentinel) {
+						return atEnd() && other.atEnd();
+					}
+					return index == other.index;
+				}
+
+			private:
+				iterator(const std::vector<Condition*>* items, size_t index, bool sentinel = false) :
+					items(items), index(index), sentinel(sentinel) {
+					skipHoles();
+				}
+
+				bool atEnd() const {
+					return sentinel || !items || index >= items->size();
+				}
+
+				void skipHoles() {
+					while (!atEnd() && !(*items)[index]) {
+						++index;
+					}
+				}
+
+				const std::vector<Condition*>* items = nullptr;
+				size_t index = 0;
+				bool sentinel = false;
+
+				friend class ConditionList;
+		};
+
+		using const_iterator = iterator;
+
+		iterator begin() const {
+			return {&items, 0};
+		}
+
+		iterator end() const {
+			return {&items, items.size(), true};
+		}
+
+		bool empty() const {
+			return items.size() == holes;
+		}
+
+		void push_back(Condition* condition) {
+			if (items.capacity() == 0) {
+				items.reserve(4);
+			}
+			items.push_back(condition);
+		}
+
+		iterator erase(iterator it) {
+			eraseSlot(it.index);
+			return ++it;
+		}
+
+		// slots count the holes too, a slot keeps its condition until it is erased
+		size_t slots() const {
+			return items.size();
+		}
+
+		Condition* slot(size_t index) const {
+			return index < items.size() ? items[index] : nullptr;
+		}
+
+		void eraseSlot(size_t index) {
+			items[index] = nullptr;
+			++holes;
+
+			// trailing holes go right away, it moves no one
+			while (!items.empty() && !items.back()) {
+				items.pop_back();
+				--holes;
+			}
+		}
+
+		void compact() {
+			if (holes != 0) {
+				std::erase(items, nullptr);
+				holes = 0;
+			}
+		}
+
+	private:
+		std::vector<Condition*> items;
+		size_t holes = 0;
+};
+
+#endif
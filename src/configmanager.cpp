@@ -207,6 +207,7 @@ bool ConfigManager::load()
 		}
 
 		integer[STATUS_PORT] = getGlobalNumber(L, "statusProtocolPort", 7171);
+		integer[METRICS_PORT] = getGlobalNumber(L, "metricsPort", 0);
 
 		integer[MARKET_OFFER_DURATION] = getGlobalNumber(L, "marketOfferDuration", 30 * 24 * 60 * 60);
 	}
@@ -253,11 +254,24 @@ bool ConfigManager::load()
 	boolean[AUGMENT_STAMINA_RULE] = getGlobalBoolean(L, "augmentStaminInMinutes", false);
 	boolean[AUGMENT_CRITICAL_ANIMATION] = getGlobalBoolean(L, "showAnimationOnCritHitFromAugment", true);
 	boolean[NPC_PZ_WALKTHROUGH] = getGlobalBoolean(L, "allowNpcWalkthroughInPz", false);
+	boolean[LAZY_MAP_TILES] = getGlobalBoolean(L, "lazyMapTiles", false);
+	boolean[MAP_SNAPSHOT] = getGlobalBoolean(L, "mapSnapshot", true);
+	boolean[DROP_FLOOD_PACKETS] = getGlobalBoolean(L, "dropFloodPackets", false);
+	boolean[PACKET_COMPRESSION] = getGlobalBoolean(L, "packetCompression", false);
+	boolean[COALESCE_EFFECTS] = getGlobalBoolean(L, "coalesceEffects", false);
+	boolean[LUA_PROFILER] = getGlobalBoolean(L, "luaProfiler", false);
+	boolean[LUA_BYTECODE_CACHE] = getGlobalBoolean(L, "luaBytecodeCache", true);
+	boolean[LAZY_DEPOT_LOADING] = getGlobalBoolean(L, "lazyDepotLoading", true);
+	boolean[TICK_PROFILER] = getGlobalBoolean(L, "tickProfiler", false);
 
 	// Account manager
 	boolean[ENABLE_ACCOUNT_MANAGER] = getGlobalBoolean(L, "useIngameAccountManager", true);
 	boolean[ENABLE_NO_PASS_LOGIN] = getGlobalBoolean(L, "allowNoPassLogin", true);
 	string[ACCOUNT_MANAGER_AUTH] = getGlobalString(L, "accountManagerPassword", "1");
+	string[PACKET_CAPTURE_FILE] = getGlobalString(L, "packetCaptureFile", "");
+	string[LUA_GC_MODE] = getGlobalString(L, "luaGarbageCollector", "incremental");
+	string[JOURNAL_FILE] = getGlobalString(L, "journalFile", "");
+	string[THREAD_AFFINITY] = getGlobalString(L, "threadAffinity", "");
 	integer[ACCOUNT_MANAGER_POS_X] = getGlobalNumber(L, "managerPositionX", 0);
 	integer[ACCOUNT_MANAGER_POS_Y] = getGlobalNumber(L, "managerPositionY", 0);
 	integer[ACCOUNT_MANAGER_POS_Z] = getGlobalNumber(L, "managerPositionZ", 0);
@@ -305,6 +319,38 @@ bool ConfigManager::load()
 	integer[VIP_PREMIUM_LIMIT] = getGlobalNumber(L, "vipPremiumLimit", 100);
 	integer[DEPOT_FREE_LIMIT] = getGlobalNumber(L, "depotFreeLimit", 2000);
 	integer[DEPOT_PREMIUM_LIMIT] = getGlobalNumber(L, "depotPremiumLimit", 10000);
+	integer[DISPATCHER_WEIGHT_PLAYER] = getGlobalNumber(L, "dispatcherPlayerWeight", 8);
+	integer[DISPATCHER_WEIGHT_CREATURE] = getGlobalNumber(L, "dispatcherCreatureWeight", 4);
+	integer[DISPATCHER_WEIGHT_DEFAULT] = getGlobalNumber(L, "dispatcherDefaultWeight", 4);
+	integer[DISPATCHER_WEIGHT_BACKGROUND] = getGlobalNumber(L, "dispatcherBackgroundWeight", 1);
+	integer[DISPATCHER_JOB_BUDGET] = getGlobalNumber(L, "dispatcherJobBudget", 10);
+	integer[PATHFINDING_THREADS] = getGlobalNumber(L, "pathfindingThreads", 0);
+	integer[MONSTER_THINK_THREADS] = getGlobalNumber(L, "monsterThinkThreads", 0);
+	integer[NETWORK_THREADS] = getGlobalNumber(L, "networkThreads", 0);
+	integer[CRYPTO_THREADS] = getGlobalNumber(L, "cryptoThreads", 0);
+	integer[MAX_PACKET_BURST] = getGlobalNumber(L, "maxPacketBurst", 0);
+	integer[MAX_PACKETS_PER_SECOND_PER_IP] = getGlobalNumber(L, "maxPacketsPerSecondPerIp", 0);
+	integer[PACKET_COMPRESSION_LEVEL] = getGlobalNumber(L, "packetCompressionLevel", 6);
+	integer[STATUS_CACHE_INTERVAL] = getGlobalNumber(L, "statusCacheInterval", 1000);
+	integer[METRICS_INTERVAL] = getGlobalNumber(L, "metricsInterval", 5000);
+	integer[DATABASE_WORKERS] = getGlobalNumber(L, "databaseWorkers", 1);
+	integer[SLOW_QUERY_THRESHOLD] = getGlobalNumber(L, "slowQueryThreshold", 200);
+	integer[STORAGE_FLUSH_INTERVAL] = getGlobalNumber(L, "storageFlushInterval", 5000);
+	integer[JOURNAL_COMMIT_INTERVAL] = getGlobalNumber(L, "journalCommitInterval", 10);
+	integer[PLAYER_SAVE_INTERVAL] = getGlobalNumber(L, "playerSaveInterval", 0);
+	integer[DISPATCHER_REALTIME_PRIORITY] = getGlobalNumber(L, "dispatcherRealtimePriority", 0);
+	integer[STORAGE_HOT_RANGE_START] = getGlobalNumber(L, "storageHotRangeStart", 20000);
+	integer[STORAGE_HOT_RANGE_SIZE] = getGlobalNumber(L, "storageHotRangeSize", 16384);
+	integer[MAP_LOAD_THREADS] = getGlobalNumber(L, "mapLoadThreads", 4);
+	integer[ITEM_LOAD_THREADS] = getGlobalNumber(L, "itemLoadThreads", 4);
+	integer[LUA_WORKER_THREADS] = getGlobalNumber(L, "luaWorkerThreads", 0);
+	integer[LUA_GC_PAUSE] = getGlobalNumber(L, "luaGcPause", 0);
+	integer[LUA_GC_STEP_MULTIPLIER] = getGlobalNumber(L, "luaGcStepMultiplier", 0);
+	integer[LUA_GC_IDLE_STEP] = getGlobalNumber(L, "luaGcIdleStep", 0);
+	integer[TICK_BUDGET_WARNING] = getGlobalNumber(L, "tickBudgetWarning", 100);
+	integer[BAN_CACHE_TIME] = getGlobalNumber(L, "banCacheTime", 30000);
+	integer[WORLD_ID] = getGlobalNumber(L, "worldId", 0);
+	integer[WORLD_BUS_INTERVAL] = getGlobalNumber(L, "worldBusInterval", 250);
 
 	floats[REWARD_BASE_RATE] = getGlobalFloat(L, "rewardBaseRate", 1.0f);
 	floats[REWARD_RATE_DAMAGE_DONE] = getGlobalFloat(L, "rewardRateDamageDone", 1.0f);
@@ -316,6 +362,7 @@ bool ConfigManager::load()
 		expStages = loadLuaStages(L);
 	}
 	expStages.shrink_to_fit();
+	updateSnapshot();
 
 	loaded = true;
 	lua_close(L);
@@ -323,6 +370,22 @@ bool ConfigManager::load()
 	return true;
 }
 
+void ConfigManager::updateSnapshot()
+{
+	ConfigSnapshot next;
+	next.protectionLevel = static_cast<uint32_t>(integer[PROTECTION_LEVEL]);
+	next.pzLocked = integer[PZ_LOCKED];
+	next.allowWalkthrough = boolean[ALLOW_WALKTHROUGH];
+	next.classicEquipmentSlots = boolean[CLASSIC_EQUIPMENT_SLOTS];
+	next.cleanProtectionZones = boolean[CLEAN_PROTECTION_ZONES];
+	next.onlyInvitedCanMoveHouseItems = boolean[ONLY_INVITED_CAN_MOVE_HOUSE_ITEMS];
+	next.npcPzWalkthrough = boolean[NPC_PZ_WALKTHROUGH];
+	next.augmentSlotProtection = boolean[AUGMENT_SLOT_PROTECTION];
+	next.augmentStaminaRule = boolean[AUGMENT_STAMINA_RULE];
+	next.augmentCriticalAnimation = boolean[AUGMENT_CRITICAL_ANIMATION];
+	snapshot = next;
+}
+
 bool ConfigManager::reload()
 {
 	bool result = load();
@@ -394,6 +457,7 @@ bool ConfigManager::setNumber(integer_config_t what, int32_t value)
 	}
 
 	integer[what] = value;
+	updateSnapshot();
 	return true;
 }
 
@@ -405,6 +469,7 @@ bool ConfigManager::setBoolean(boolean_config_t what, bool value)
 	}
 
 	boolean[what] = value;
+	updateSnapshot();
 	return true;
 }
 
@@ -9,6 +9,24 @@
 
 using ExperienceStages = std::vector<std::tuple<uint32_t, uint32_t, float>>;
 
+// The settings read in the innermost loops of combat, walking and item moves,
+// copied out of the tables with their final types whenever the config is
+// loaded or one of them is set. Hot code can keep a reference to it, it is
+// replaced as a whole on the dispatcher, which is the only thread reading it.
+struct ConfigSnapshot
+{
+	uint32_t protectionLevel = 1;
+	int32_t pzLocked = 0;
+	bool allowWalkthrough = false;
+	bool classicEquipmentSlots = false;
+	bool cleanProtectionZones = false;
+	bool onlyInvitedCanMoveHouseItems = false;
+	bool npcPzWalkthrough = false;
+	bool augmentSlotProtection = false;
+	bool augmentStaminaRule = false;
+	bool augmentCriticalAnimation = false;
+};
+
 class ConfigManager
 {
 	public:
@@ -61,6 +79,15 @@ class ConfigManager
 			NPC_PZ_WALKTHROUGH,
 			ENABLE_ACCOUNT_MANAGER,
 			ENABLE_NO_PASS_LOGIN,
+			LAZY_MAP_TILES,
+			MAP_SNAPSHOT,
+			DROP_FLOOD_PACKETS,
+			PACKET_COMPRESSION,
+			COALESCE_EFFECTS,
+			LUA_PROFILER,
+			LUA_BYTECODE_CACHE,
+			TICK_PROFILER,
+			LAZY_DEPOT_LOADING,
 
 			LAST_BOOLEAN_CONFIG /* this must be the last one */
 		};
@@ -85,6 +112,10 @@ class ConfigManager
 			MAP_AUTHOR,
 			CONFIG_FILE,
 			ACCOUNT_MANAGER_AUTH,
+			PACKET_CAPTURE_FILE,
+			LUA_GC_MODE,
+			JOURNAL_FILE,
+			THREAD_AFFINITY,
 
 			LAST_STRING_CONFIG /* this must be the last one */
 		};
@@ -116,6 +147,7 @@ class ConfigManager
 			GAME_PORT,
 			LOGIN_PORT,
 			STATUS_PORT,
+			METRICS_PORT,
 			STAIRHOP_DELAY,
 			MARKET_OFFER_DURATION,
 			CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES,
@@ -132,6 +164,38 @@ class ConfigManager
 			ACCOUNT_MANAGER_POS_X,
 			ACCOUNT_MANAGER_POS_Y,
 			ACCOUNT_MANAGER_POS_Z,
+			DISPATCHER_WEIGHT_PLAYER,
+			DISPATCHER_WEIGHT_CREATURE,
+			DISPATCHER_WEIGHT_DEFAULT,
+			DISPATCHER_WEIGHT_BACKGROUND,
+			DISPATCHER_JOB_BUDGET,
+			PATHFINDING_THREADS,
+			MONSTER_THINK_THREADS,
+			NETWORK_THREADS,
+			CRYPTO_THREADS,
+			MAX_PACKET_BURST,
+			MAX_PACKETS_PER_SECOND_PER_IP,
+			PACKET_COMPRESSION_LEVEL,
+			STATUS_CACHE_INTERVAL,
+			METRICS_INTERVAL,
+			DATABASE_WORKERS,
+			SLOW_QUERY_THRESHOLD,
+			STORAGE_FLUSH_INTERVAL,
+			JOURNAL_COMMIT_INTERVAL,
+			PLAYER_SAVE_INTERVAL,
+			DISPATCHER_REALTIME_PRIORITY,
+			STORAGE_HOT_RANGE_START,
+			STORAGE_HOT_RANGE_SIZE,
+			MAP_LOAD_THREADS,
+			ITEM_LOAD_THREADS,
+			LUA_WORKER_THREADS,
+			LUA_GC_PAUSE,
+			LUA_GC_STEP_MULTIPLIER,
+			LUA_GC_IDLE_STEP,
+			TICK_BUDGET_WARNING,
+			BAN_CACHE_TIME,
+			WORLD_ID,
+			WORLD_BUS_INTERVAL,
 
 			LAST_INTEGER_CONFIG /* this must be the last one */
 		};
@@ -159,14 +223,21 @@ class ConfigManager
 		bool setBoolean(boolean_config_t what, bool value);
 
 		bool setFloat(float_config_t what, float value);
+
+		const ConfigSnapshot& getSnapshot() const {
+			return snapshot;
+		}
 		
 	private:
+		void updateSnapshot();
+
 		std::string string[LAST_STRING_CONFIG] = {};
 		int32_t integer[LAST_INTEGER_CONFIG] = {};
 		bool boolean[LAST_BOOLEAN_CONFIG] = {};
 		float floats[LAST_FLOAT_CONFIG] = {};
 
 		ExperienceStages expStages = {};
+		ConfigSnapshot snapshot;
 
 		bool loaded = false;
 };
@@ -5,10 +5,12 @@
 
 #include "configmanager.h"
 #include "connection.h"
+#include "cryptopool.h"
 #include "outputmessage.h"
 #include "protocol.h"
 #include "scheduler.h"
 #include "server.h"
+#include "tracing.h"
 
 extern ConfigManager g_config;
 
@@ -28,6 +30,48 @@ void ConnectionManager::releaseConnection(const Connection_ptr& connection)
 	connections.erase(connection);
 }
 
+bool ConnectionManager::acceptPacket(uint32_t ip, int64_t now)
+{
+	const int32_t rate = g_config.getNumber(ConfigManager::MAX_PACKETS_PER_SECOND_PER_IP);
+	if (rate <= 0) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lockClass(ipBucketLock);
+
+	// addresses quiet for a while have a full bucket again, forget them
+	if (++ipBucketChecks >= 4096) {
+		ipBucketChecks = 0;
+		for (auto it = ipBuckets.begin(); it != ipBuckets.end();) {
+			if (now - it->second.getLastRefill() > 60000) {
+				ipBuckets.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	return ipBuckets[ip].consume(now, rate, rate * 2);
+}
+
+ProtocolTraffic& ConnectionManager::getProtocolTraffic(const char* protocolName)
+{
+	std::lock_guard<std::mutex> lockClass(trafficLock);
+	return traffic.try_emplace(protocolName).first->second;
+}
+
+std::vector<std::tuple<std::string, uint64_t, uint64_t>> ConnectionManager::getTraffic()
+{
+	std::lock_guard<std::mutex> lockClass(trafficLock);
+
+	std::vector<std::tuple<std::string, uint64_t, uint64_t>> result;
+	result.reserve(traffic.size());
+	for (const auto& [name, counters] : traffic) {
+		result.emplace_back(name, counters.received.load(std::memory_order_relaxed), counters.sent.load(std::memory_order_relaxed));
+	}
+	return result;
+}
+
 void ConnectionManager::closeAll()
 {
 	std::lock_guard<std::mutex> lockClass(connectionManagerLock);
@@ -60,7 +104,7 @@ void Connection::close(bool force)
 		g_dispatcher.addTask(createTask([protocol = protocol]() { protocol->release(); }));
 	}
 
-	if (messageQueue.empty() || force) {
+	if ((messageQueue.empty() && writingMessages.empty()) || force) {
 		closeSocket();
 	} else {
 		//will be closed by the destructor or onWriteOperation
@@ -87,9 +131,15 @@ Connection::~Connection()
 	closeSocket();
 }
 
+void Connection::setProtocol(Protocol_ptr protocol)
+{
+	traffic = &ConnectionManager::getInstance().getProtocolTraffic(protocol->getProtocolName());
+	this->protocol = std::move(protocol);
+}
+
 void Connection::accept(Protocol_ptr protocol)
 {
-	this->protocol = protocol;
+	setProtocol(protocol);
 	g_dispatcher.addTask(createTask([=]() { protocol->onConnect(); }));
 
 	accept();
@@ -124,18 +174,6 @@ void Connection::parseHeader(const boost::system::error_code& error)
 		return;
 	}
 
-	uint32_t timePassed = std::max<uint32_t>(1, (time(nullptr) - timeConnected) + 1);
-	if ((++packetsSent / timePassed) > static_cast<uint32_t>(g_config.getNumber(ConfigManager::MAX_PACKETS_PER_SECOND))) {
-		std::cout << convertIPToString(getIP()) << " disconnected for exceeding packet per second limit." << std::endl;
-		close();
-		return;
-	}
-
-	if (timePassed > 2) {
-		timeConnected = time(nullptr);
-		packetsSent = 0;
-	}
-
 	uint16_t size = msg.getLengthHeader();
 	if (size == 0 || size >= NETWORKMESSAGE_MAXSIZE - 16) {
 		close(FORCE_CLOSE);
@@ -158,6 +196,7 @@ void Connection::parseHeader(const boost::system::error_code& error)
 
 void Connection::parsePacket(const boost::system::error_code& error)
 {
+	TraceScope trace("read packet", "network");
 	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
 	readTimer.cancel();
 
@@ -183,26 +222,76 @@ void Connection::parsePacket(const boost::system::error_code& error)
 		msg.skipBytes(-NetworkMessage::CHECKSUM_LENGTH);
 	}
 
+	// flooding is stopped here, before the protocol parses anything or queues a task
+	if (!acceptPacket()) {
+		if (receivedFirst && g_config.getBoolean(ConfigManager::DROP_FLOOD_PACKETS)) {
+			readNextPacket();
+			return;
+		}
+
+		std::cout << convertIPToString(getIP()) << " disconnected for exceeding packet per second limit." << std::endl;
+		close();
+		return;
+	}
+
 	if (!receivedFirst) {
 		// First message received
 		receivedFirst = true;
 
 		if (!protocol) {
 			// Game protocol has already been created at this point
-			protocol = service_port->make_protocol(recvChecksum == checksum, msg, shared_from_this());
-			if (!protocol) {
+			Protocol_ptr firstProtocol = service_port->make_protocol(recvChecksum == checksum, msg, shared_from_this());
+			if (!firstProtocol) {
 				close(FORCE_CLOSE);
 				return;
 			}
+			setProtocol(std::move(firstProtocol));
 		} else {
 			msg.skipBytes(1); // Skip protocol ID
 		}
+		traffic->received.fetch_add(msg.getLength(), std::memory_order_relaxed);
+
+		if (g_cryptoPool.isRunning()) {
+			// nothing reads into msg until the handshake is done with it
+			g_cryptoPool.addTask([thisPtr = shared_from_this()]() { thisPtr->parseFirstPacket(); });
+			return;
+		}
 
 		protocol->onRecvFirstMessage(msg);
 	} else {
+		traffic->received.fetch_add(msg.getLength(), std::memory_order_relaxed);
 		protocol->onRecvMessage(msg); // Send the packet to the current protocol
 	}
 
+	readNextPacket();
+}
+
+bool Connection::acceptPacket()
+{
+	const int64_t now = OTSYS_TIME();
+	const uint32_t rate = std::max<int32_t>(1, g_config.getNumber(ConfigManager::MAX_PACKETS_PER_SECOND));
+	const int32_t burst = g_config.getNumber(ConfigManager::MAX_PACKET_BURST);
+	if (!packetBucket.consume(now, rate, burst > 0 ? burst : rate * 2)) {
+		return false;
+	}
+	return ConnectionManager::getInstance().acceptPacket(getIP(), now);
+}
+
+void Connection::parseFirstPacket()
+{
+	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+	if (closed) {
+		return;
+	}
+
+	protocol->onRecvFirstMessage(msg);
+	if (!closed) {
+		readNextPacket();
+	}
+}
+
+void Connection::readNextPacket()
+{
 	try {
 		readTimer.expires_after(std::chrono::seconds(CONNECTION_READ_TIMEOUT));
 		readTimer.async_wait([thisPtr = std::weak_ptr<Connection>(shared_from_this())](const boost::system::error_code& error) { Connection::handleTimeout(thisPtr, error); });
@@ -212,36 +301,58 @@ void Connection::parsePacket(const boost::system::error_code& error)
 		                        boost::asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH),
 								[thisPtr = shared_from_this()](const boost::system::error_code& error, auto /*bytes_transferred*/) { thisPtr->parseHeader(error); });
 	} catch (boost::system::system_error& e) {
-		std::cout << "[Network error - Connection::parsePacket] " << e.what() << std::endl;
+		std::cout << "[Network error - Connection::readNextPacket] " << e.what() << std::endl;
 		close(FORCE_CLOSE);
 	}
 }
 
-void Connection::send(const OutputMessage_ptr& msg)
+void Connection::send(const OutputMessage_ptr& msg, bool urgent/* = false*/)
 {
 	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
 	if (closed) {
 		return;
 	}
 
-	bool noPendingWrite = messageQueue.empty();
-	messageQueue.emplace_back(msg);
-	if (noPendingWrite) {
-		internalSend(msg);
+	if (urgent) {
+		messageQueue.insert(messageQueue.begin() + urgentMessages++, msg);
+	} else {
+		messageQueue.emplace_back(msg);
+	}
+
+	if (writingMessages.empty()) {
+		internalSend();
 	}
 }
 
-void Connection::internalSend(const OutputMessage_ptr& msg)
+void Connection::internalSend()
 {
-	protocol->onSendMessage(msg);
+	TraceScope trace("write messages", "network");
+	// at least one message and then as many as fit the budget, whatever is left
+	// goes with the next write behind any urgent message queued by then
+	size_t count = 0, bytes = 0;
+	do {
+		protocol->onSendMessage(messageQueue[count]);
+		bytes += messageQueue[count]->getLength();
+		++count;
+	} while (count < messageQueue.size() && bytes + messageQueue[count]->getLength() <= CONNECTION_WRITE_BUDGET);
+
+	writingMessages.assign(std::make_move_iterator(messageQueue.begin()), std::make_move_iterator(messageQueue.begin() + count));
+	messageQueue.erase(messageQueue.begin(), messageQueue.begin() + count);
+	urgentMessages -= std::min(urgentMessages, count);
+
+	// the messages go out in queue order, so their encryption does too
+	writeBuffers.clear();
+	for (const auto& message : writingMessages) {
+		writeBuffers.emplace_back(message->getOutputBuffer(), message->getLength());
+	}
+
 	try {
 		writeTimer.expires_after
 		(std::chrono::seconds(CONNECTION_WRITE_TIMEOUT));
 		writeTimer.async_wait([thisPtr = std::weak_ptr<Connection>(shared_from_this())](const boost::system::error_code& error) { Connection::handleTimeout(thisPtr, error); });
 
-		boost::asio::async_write(socket,
-		                         boost::asio::buffer(msg->getOutputBuffer(), msg->getLength()),
-								[thisPtr = shared_from_this()](const boost::system::error_code& error, auto /*bytes_transferred*/) { thisPtr->onWriteOperation(error); });
+		boost::asio::async_write(socket, writeBuffers,
+								[thisPtr = shared_from_this()](const boost::system::error_code& error, size_t bytesTransferred) { thisPtr->onWriteOperation(error, bytesTransferred); });
 	} catch (boost::system::system_error& e) {
 		std::cout << "[Network error - Connection::internalSend] " << e.what() << std::endl;
 		close(FORCE_CLOSE);
@@ -262,20 +373,29 @@ uint32_t Connection::getIP()
 	return htonl(endpoint.address().to_v4().to_uint());
 }
 
-void Connection::onWriteOperation(const boost::system::error_code& error)
+void Connection::onWriteOperation(const boost::system::error_code& error, size_t bytesTransferred)
 {
 	std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
 	writeTimer.cancel();
-	messageQueue.pop_front();
+
+	ConnectionWriteStats& stats = ConnectionManager::getInstance().getWriteStats();
+	++stats.writes;
+	stats.messages += writingMessages.size();
+	stats.bytes += bytesTransferred;
+	if (traffic) {
+		traffic->sent.fetch_add(bytesTransferred, std::memory_order_relaxed);
+	}
+	writingMessages.clear();
 
 	if (error) {
 		messageQueue.clear();
+		urgentMessages = 0;
 		close(FORCE_CLOSE);
 		return;
 	}
 
 	if (!messageQueue.empty()) {
-		internalSend(messageQueue.front());
+		internalSend();
 	} else if (closed) {
 		closeSocket();
 	}
@@ -10,6 +10,8 @@
 
 static constexpr int32_t CONNECTION_WRITE_TIMEOUT = 30;
 static constexpr int32_t CONNECTION_READ_TIMEOUT = 30;
+// bytes gathered into one write, a message that arrives meanwhile waits at most this long
+static constexpr size_t CONNECTION_WRITE_BUDGET = 16384;
 
 class Protocol;
 using Protocol_ptr = std::shared_ptr<Protocol>;
@@ -24,6 +26,49 @@ class ServicePort;
 using ServicePort_ptr = std::shared_ptr<ServicePort>;
 using ConstServicePort_ptr = std::shared_ptr<const ServicePort>;
 
+// what the coalesced writes of all connections carried, updated from the network threads
+struct ConnectionWriteStats {
+	std::atomic<uint64_t> writes{0};
+	std::atomic<uint64_t> messages{0};
+	std::atomic<uint64_t> bytes{0};
+};
+
+// bytes the connections of one protocol read and wrote, packet headers included
+struct ProtocolTraffic {
+	std::atomic<uint64_t> received{0};
+	std::atomic<uint64_t> sent{0};
+};
+
+// Token bucket for received packets, refilled at rate per second up to burst.
+class PacketBucket
+{
+	public:
+		bool consume(int64_t now, uint32_t rate, uint32_t burst) {
+			const int64_t capacity = static_cast<int64_t>(burst) * 1000;
+			if (lastRefill == 0) {
+				tokens = capacity;
+			} else {
+				tokens = std::min(capacity, tokens + (now - lastRefill) * rate);
+			}
+			lastRefill = now;
+
+			if (tokens < 1000) {
+				return false;
+			}
+			tokens -= 1000;
+			return true;
+		}
+
+		int64_t getLastRefill() const {
+			return lastRefill;
+		}
+
+	private:
+		// thousandths of a packet, a millisecond refills rate of them
+		int64_t tokens = 0;
+		int64_t lastRefill = 0;
+};
+
 class ConnectionManager
 {
 	public:
@@ -36,9 +81,30 @@ class ConnectionManager
 		void releaseConnection(const Connection_ptr& connection);
 		void closeAll();
 
+		ConnectionWriteStats& getWriteStats() {
+			return writeStats;
+		}
+
+		// counters stay put, connections keep a pointer to the ones of their protocol
+		ProtocolTraffic& getProtocolTraffic(const char* protocolName);
+		// name, received and sent bytes of every protocol that had a connection
+		std::vector<std::tuple<std::string, uint64_t, uint64_t>> getTraffic();
+
+		// false when the connections of ip went over maxPacketsPerSecondPerIp
+		bool acceptPacket(uint32_t ip, int64_t now);
+
 	private:
 		ConnectionManager() = default;
 
+		ConnectionWriteStats writeStats;
+
+		gtl::node_hash_map<std::string, ProtocolTraffic> traffic;
+		std::mutex trafficLock;
+
+		gtl::flat_hash_map<uint32_t, PacketBucket> ipBuckets;
+		std::mutex ipBucketLock;
+		uint32_t ipBucketChecks = 0;
+
 		gtl::parallel_flat_hash_set<Connection_ptr> connections;
 		std::mutex connectionManagerLock;
 };
@@ -57,8 +123,7 @@ class Connection : public std::enable_shared_from_this<Connection>
 			readTimer(io_context),
 			writeTimer(io_context),
 			service_port(std::move(service_port)),
-			socket(io_context),
-			timeConnected(time(nullptr)) {}
+			socket(io_context) {}
 		~Connection();
 
 		friend class ConnectionManager;
@@ -68,20 +133,29 @@ class Connection : public std::enable_shared_from_this<Connection>
 		void accept(Protocol_ptr protocol);
 		void accept();
 
-		void send(const OutputMessage_ptr& msg);
+		// urgent messages go ahead of the ones still waiting, only for messages
+		// the client does not need to see in order, such as pings
+		void send(const OutputMessage_ptr& msg, bool urgent = false);
 
 		uint32_t getIP();
 
 	private:
 		void parseHeader(const boost::system::error_code& error);
 		void parsePacket(const boost::system::error_code& error);
+		// runs the handshake of the first message, then goes on reading
+		void parseFirstPacket();
+		void readNextPacket();
+		// takes the packet from the connection's and the address's budget
+		bool acceptPacket();
 
-		void onWriteOperation(const boost::system::error_code& error);
+		void onWriteOperation(const boost::system::error_code& error, size_t bytesTransferred);
+		void setProtocol(Protocol_ptr protocol);
 
 		static void handleTimeout(ConnectionWeak_ptr connectionWeak, const boost::system::error_code& error);
 
 		void closeSocket();
-		void internalSend(const OutputMessage_ptr& msg);
+		// writes everything queued so far with one gathered write
+		void internalSend();
 
 		boost::asio::ip::tcp::socket& getSocket() {
 			return socket;
@@ -95,15 +169,20 @@ class Connection : public std::enable_shared_from_this<Connection>
 
 		std::recursive_mutex connectionLock;
 
-		std::list<OutputMessage_ptr> messageQueue;
+		// queued while a write is in flight, swapped into writingMessages by the next write
+		std::vector<OutputMessage_ptr> messageQueue;
+		std::vector<OutputMessage_ptr> writingMessages;
+		std::vector<boost::asio::const_buffer> writeBuffers;
+		// the urgent messages at the front of messageQueue
+		size_t urgentMessages = 0;
 
 		ConstServicePort_ptr service_port;
 		Protocol_ptr protocol;
+		ProtocolTraffic* traffic = nullptr;
 
 		boost::asio::ip::tcp::socket socket;
 
-		time_t timeConnected;
-		uint32_t packetsSent = 0;
+		PacketBucket packetBucket;
 
 		bool closed = false;
 		bool receivedFirst = false;
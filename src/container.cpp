@@ -84,6 +84,7 @@ void Container::addItem(const ItemPtr& item)
 {
 	itemlist.push_back(item);
 	item->setParent(getContainer());
+	invalidatePageEncodings();
 }
 
 Attr_ReadValue Container::readAttr(const AttrTypes_t attr, PropStream& propStream)
@@ -104,7 +105,7 @@ bool Container::unserializeItemNode(OTB::Loader& loader, const OTB::Node& node,
 		return false;
 	}
 
-	for (auto& itemNode : node.children) {
+	return OTB::Loader::forEachChild(node, [this, &loader](const OTB::Node& itemNode) {
 		//load container items
 		if (itemNode.type != OTBM_ITEM) {
 			// unknown type
@@ -127,8 +128,8 @@ bool Container::unserializeItemNode(OTB::Loader& loader, const OTB::Node& node,
 
 		addItem(item);
 		updateItemWeight(item->getWeight());
-	}
-	return true;
+		return true;
+	});
 }
 
 void Container::updateItemWeight(int32_t diff)
@@ -218,7 +219,7 @@ void Container::onAddContainerItem(ItemPtr& item)
 	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), false, true, 1, 1, 1, 1);
 	
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto c_player = spectator->getPlayer())
 		{
 			const auto t_container = std::dynamic_pointer_cast<Container>(shared_from_this());
@@ -226,7 +227,7 @@ void Container::onAddContainerItem(ItemPtr& item)
 		}
 	}
 
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto c_player = spectator->getPlayer())
 		{
 			const auto t_container = std::dynamic_pointer_cast<Container>(shared_from_this());
@@ -240,7 +241,7 @@ void Container::onUpdateContainerItem(uint32_t index, const ItemPtr& oldItem, co
 	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), false, true, 1, 1, 1, 1);
 	
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto c_player = spectator->getPlayer())
 		{
 			auto t_container = std::dynamic_pointer_cast<Container>(shared_from_this());
@@ -248,7 +249,7 @@ void Container::onUpdateContainerItem(uint32_t index, const ItemPtr& oldItem, co
 		}
 	}
 
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto c_player = spectator->getPlayer())
 		{
 			auto t_container = std::dynamic_pointer_cast<Container>(shared_from_this());
@@ -262,7 +263,7 @@ void Container::onRemoveContainerItem(uint32_t index, const ItemPtr& item)
 	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), false, true, 1, 1, 1, 1);
 	
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto c_player = spectator->getPlayer())
 		{
 			auto t_container = std::dynamic_pointer_cast<Container>(shared_from_this());
@@ -270,7 +271,7 @@ void Container::onRemoveContainerItem(uint32_t index, const ItemPtr& item)
 		}
 	}
 
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto c_player = spectator->getPlayer())
 		{
 			auto t_container = std::dynamic_pointer_cast<Container>(shared_from_this());
@@ -532,6 +533,7 @@ void Container::addThing(int32_t index, ThingPtr thing)
 
 	item->setParent(getContainer());
 	itemlist.push_front(item);
+	invalidatePageEncodings();
 	updateItemWeight(item->getWeight());
 	ammoCount += item->getItemCount();
 
@@ -571,6 +573,7 @@ void Container::updateThing(ThingPtr thing, uint16_t itemId, uint32_t count)
 	const int32_t oldWeight = item->getWeight();
 	item->setID(itemId);
 	item->setSubType(count);
+	invalidatePageEncodings();
 	updateItemWeight(-oldWeight + item->getWeight());
 
 	//send change to client
@@ -594,6 +597,7 @@ void Container::replaceThing(uint32_t index, ThingPtr thing)
 	ammoCount -= replacedItem->getItemCount();
 	itemlist[index] = item;
 	item->setParent(getContainer());
+	invalidatePageEncodings();
 	updateItemWeight(-static_cast<int32_t>(replacedItem->getWeight()) + item->getWeight());
 	ammoCount += item->getItemCount();
 
@@ -622,6 +626,7 @@ void Container::removeThing(ThingPtr thing, uint32_t count)
 		const int32_t oldWeight = item->getWeight();
 		ammoCount -= (item->getItemCount() - newCount);
 		item->setItemCount(newCount);
+		invalidatePageEncodings();
 		updateItemWeight(-oldWeight + item->getWeight());
 
 		//send change to client
@@ -638,6 +643,7 @@ void Container::removeThing(ThingPtr thing, uint32_t count)
 
 		item->clearParent();
 		itemlist.erase(itemlist.begin() + index);
+		invalidatePageEncodings();
 	}
 }
 
@@ -745,10 +751,40 @@ void Container::internalAddThing(uint32_t, ThingPtr thing)
 	}
 	item->setParent(getContainer());
 	itemlist.push_front(item);
+	invalidatePageEncodings();
 	updateItemWeight(item->getWeight());
 	ammoCount += item->getItemCount();
 }
 
+void Container::addItems(const ItemVector& items)
+{
+	if (items.empty()) {
+		return;
+	}
+
+	int32_t weight = 0;
+	for (const auto& item : items) {
+		item->setParent(getContainer());
+		itemlist.push_front(item);
+		weight += item->getWeight();
+		ammoCount += item->getItemCount();
+	}
+	invalidatePageEncodings();
+	updateItemWeight(weight);
+
+	if (!getParent()) {
+		return;
+	}
+
+	SpectatorVec spectators;
+	g_game.map.getSpectators(spectators, getPosition(), false, true, 1, 1, 1, 1);
+	for (const auto& spectator : spectators) {
+		if (const auto c_player = spectator->getPlayer()) {
+			c_player->onSendContainer(getContainer());
+		}
+	}
+}
+
 void Container::startDecaying()
 {
 	Item::startDecaying();
@@ -119,6 +119,24 @@ class Container : public Item, public Cylinder
 		uint32_t getItemHoldingCount() const;
 		uint32_t getWeight() const override final;
 
+		// the items of the page starting at firstIndex as sendContainer encoded
+		// them, nullptr when that page was not sent since the items last changed
+		const std::vector<uint8_t>* getPageEncoding(uint16_t firstIndex, uint8_t count) const {
+			if (!pageEncodings) {
+				return nullptr;
+			}
+
+			auto it = pageEncodings->find(getPageKey(firstIndex, count));
+			return it != pageEncodings->end() ? &it->second : nullptr;
+		}
+
+		void setPageEncoding(uint16_t firstIndex, uint8_t count, const uint8_t* bytes, size_t size) const {
+			if (!pageEncodings) {
+				pageEncodings = std::make_unique<gtl::flat_hash_map<uint32_t, std::vector<uint8_t>>>();
+			}
+			(*pageEncodings)[getPageKey(firstIndex, count)].assign(bytes, bytes + size);
+		}
+
 		bool isUnlocked() const {
 			return unlocked;
 		}
@@ -159,14 +177,29 @@ class Container : public Item, public Cylinder
 
 		void internalAddThing(ThingPtr thing) override final;
 		void internalAddThing(uint32_t index, ThingPtr thing) override final;
+		// items in no cylinder yet, each put in front as addThing would, with one weight
+		// update and one refresh for the players that have it open
+		void addItems(const ItemVector& items);
 		void startDecaying() override final;
 
 	protected:
+		// every change to itemlist or to the items in it calls this
+		void invalidatePageEncodings() {
+			pageEncodings.reset();
+		}
+
 		ItemDeque itemlist;
 
 	private:
 		std::ostringstream& getContentDescription(std::ostringstream& os) const;
 
+		static uint32_t getPageKey(uint16_t firstIndex, uint8_t count) {
+			return (static_cast<uint32_t>(firstIndex) << 8) | count;
+		}
+
+		// only containers someone looked into have any
+		mutable std::unique_ptr<gtl::flat_hash_map<uint32_t, std::vector<uint8_t>>> pageEncodings;
+
 		uint32_t maxSize;
 		uint32_t totalWeight = 0;
 		uint32_t serializationCount = 0;
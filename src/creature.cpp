@@ -6,6 +6,7 @@
 #include "creature.h"
 #include "game.h"
 #include "monster.h"
+#include "pathfinding.h"
 #include "configmanager.h"
 #include "scheduler.h"
 #include "events.h"
@@ -302,7 +303,7 @@ void Creature::addEventWalk(bool firstStep)
 		g_game.checkCreatureWalk(getID());
 	}
 
-	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, [id = getID()]() { g_game.checkCreatureWalk(id); }));
+	eventWalk = g_scheduler.addEvent(createSchedulerTask(ticks, [id = getID()]() { g_game.checkCreatureWalk(id); }, DISPATCHER_LANE_CREATURE));
 }
 
 void Creature::stopEventWalk()
@@ -322,6 +323,12 @@ void Creature::updateMapCache()
 		for (int32_t x = -maxWalkCacheWidth; x <= maxWalkCacheWidth; ++x) {
 			pos.x = myPos.getX() + x;
 			pos.y = myPos.getY() + y;
+			// blocked for pathfinding whatever walks there, skip fetching the tile
+			if (Map::isPathBlocked(g_game.map.getTileState(pos.x, pos.y, pos.z))) {
+				updateTileCache(nullptr, pos);
+				continue;
+			}
+
 			TilePtr tile = g_game.map.getTile(pos);
 			updateTileCache(tile, pos);
 		}
@@ -635,7 +642,7 @@ void Creature::onCreatureMove(const CreaturePtr& creature,
 			else {
 				if (hasExtraSwing()) {
 					//our target is moving lets see if we can get in hit
-					g_dispatcher.addTask(createTask([id = getID()]() { g_game.checkCreatureAttack(id); }));
+					g_dispatcher.addTask(createTask([id = getID()]() { g_game.checkCreatureAttack(id); }, DISPATCHER_LANE_CREATURE));
 				}
 
 				if (newTile->getZone() != oldTile->getZone()) {
@@ -650,7 +657,7 @@ CreatureVector Creature::getKillers() const
 {
 	CreatureVector killers;
 	const int64_t timeNow = OTSYS_TIME();
-	const uint32_t inFightTicks = g_config.getNumber(ConfigManager::PZ_LOCKED);
+	const uint32_t inFightTicks = g_config.getSnapshot().pzLocked;
 	for (const auto& it : damageMap) {
 		auto attacker = g_game.getCreatureByID(it.first);
 		if (attacker && attacker != shared_from_this() && timeNow - it.second.ticks <= inFightTicks) {
@@ -676,7 +683,7 @@ void Creature::onDeath()
 	CreaturePtr mostDamageCreature = nullptr;
 
 	const int64_t timeNow = OTSYS_TIME();
-	const uint32_t inFightTicks = g_config.getNumber(ConfigManager::PZ_LOCKED);
+	const uint32_t inFightTicks = g_config.getSnapshot().pzLocked;
 	int32_t mostDamage = 0;
 	std::map<CreaturePtr, uint64_t> experienceMap;
 	for (const auto& it : damageMap) {
@@ -793,7 +800,7 @@ bool Creature::hasBeenAttacked(uint32_t attackerId)
 	if (it == damageMap.end()) {
 		return false;
 	}
-	return (OTSYS_TIME() - it->second.ticks) <= g_config.getNumber(ConfigManager::PZ_LOCKED);
+	return (OTSYS_TIME() - it->second.ticks) <= g_config.getSnapshot().pzLocked;
 }
 
 ItemPtr Creature::getCorpse(const CreaturePtr&, const CreaturePtr&)
@@ -936,6 +943,9 @@ void Creature::getPathSearchParams(const CreatureConstPtr&, FindPathParams& fpp)
 
 void Creature::goToFollowCreature()
 {
+	// whatever is still being searched is outdated now
+	followPathRequest = 0;
+
 	if (auto target = getFollowCreature()) {
 		FindPathParams fpp;
 		getPathSearchParams(target, fpp);
@@ -950,6 +960,10 @@ void Creature::goToFollowCreature()
 			} else { // maxTargetDist > 1
 				if (!monster->getDistanceStep(targetPos, dir)) {
 					// if we can't get anything then let the A* calculate
+					if (requestFollowPath(targetPos, fpp, false)) {
+						return;
+					}
+
 					listWalkDir.clear();
 					if (getPathTo(targetPos, listWalkDir, fpp)) {
 						hasFollowPath = true;
@@ -968,7 +982,18 @@ void Creature::goToFollowCreature()
 				hasFollowPath = true;
 				startAutoWalk();
 			}
+		} else if (repairFollowPath(targetPos, fpp)) {
+			// still walking the previous path, only its end has changed
+			startAutoWalk();
+		} else if (followFlowField(target, fpp)) {
+			hasFollowPath = true;
+			startAutoWalk();
 		} else {
+			++g_pathfinder.getFollowStats().searched;
+			if (requestFollowPath(targetPos, fpp, true)) {
+				return;
+			}
+
 			listWalkDir.clear();
 			if (getPathTo(targetPos, listWalkDir, fpp)) {
 				hasFollowPath = true;
@@ -982,6 +1007,133 @@ void Creature::goToFollowCreature()
 	onFollowCreatureComplete(getFollowCreature());
 }
 
+bool Creature::repairFollowPath(const Position& targetPos, const FindPathParams& fpp)
+{
+	// farther targets take the best distance found, only exact adjacency is cheap to verify
+	if (!hasFollowPath || listWalkDir.empty() || fpp.maxTargetDist != 1) {
+		return false;
+	}
+
+	const FrozenPathingConditionCall pathCondition(targetPos);
+	const Position& startPos = getPosition();
+	int32_t bestMatch = 0;
+	if (pathCondition(startPos, startPos, fpp, bestMatch)) {
+		// already there, the old path would walk past the target
+		return false;
+	}
+
+	CreaturePtr self = getCreature();
+	Position pos = startPos;
+
+	// the next step is at the back, walk the path and stop at the first tile next to the target
+	for (size_t i = listWalkDir.size(); i-- > 0;) {
+		pos = getNextPosition(listWalkDir[i], pos);
+		if (!g_game.map.canWalkTo(self, pos)) {
+			return false;
+		}
+
+		if (pathCondition(startPos, pos, fpp, bestMatch)) {
+			listWalkDir.erase(listWalkDir.begin(), listWalkDir.begin() + i);
+			++g_pathfinder.getFollowStats().kept;
+			return true;
+		}
+	}
+
+	// the end fell out of reach, look a few steps further from there
+	FindPathParams tailParams = fpp;
+	tailParams.fullPathSearch = true;
+	tailParams.maxSearchDist = FOLLOW_PATH_REPAIR_RANGE;
+
+	std::vector<Direction> tail;
+	if (!g_game.map.getPathMatching(self, pos, tail, pathCondition, tailParams) || tail.empty()) {
+		return false;
+	}
+
+	// the tail is walked last, so it goes below the current steps
+	listWalkDir.insert(listWalkDir.begin(), tail.begin(), tail.end());
+	++g_pathfinder.getFollowStats().repaired;
+	return true;
+}
+
+bool Creature::followFlowField(const CreaturePtr& target, const FindPathParams& fpp)
+{
+	// the field leads next to the target, keeping distance is left to the search
+	if (!getMonster() || fpp.maxTargetDist != 1 || fpp.keepDistance) {
+		return false;
+	}
+
+	const Position& pos = getPosition();
+	const Position& targetPos = target->getPosition();
+	if (pos.z != targetPos.z || Position::getDistanceX(pos, targetPos) > FLOW_FIELD_RANGE || Position::getDistanceY(pos, targetPos) > FLOW_FIELD_RANGE) {
+		return false;
+	}
+
+	const FlowField* field = g_game.map.getFlowField(target->getID(), targetPos, getID());
+	if (!field) {
+		return false;
+	}
+
+	CreaturePtr self = getCreature();
+	std::vector<Direction> dirList;
+	if (!field->getPath(g_game.map, self, dirList)) {
+		return false;
+	}
+
+	listWalkDir = std::move(dirList);
+	++g_pathfinder.getFollowStats().flowField;
+	return true;
+}
+
+bool Creature::requestFollowPath(const Position& targetPos, const FindPathParams& fpp, bool notifyComplete)
+{
+	// players keep searching on the spot, their clicks want an answer right away
+	if (!getMonster() || !g_pathfinder.isRunning() || fpp.maxSearchDist <= 0 || fpp.maxSearchDist > PATH_SNAPSHOT_MAX_RANGE) {
+		return false;
+	}
+
+	PathRequest request;
+	CreaturePtr self = getCreature();
+	request.snapshot.capture(self, targetPos, fpp);
+	request.fpp = fpp;
+	request.creatureId = getID();
+	request.targetId = getFollowCreature()->getID();
+	request.requestId = g_pathfinder.getNextRequestId();
+	request.notifyComplete = notifyComplete;
+
+	followPathRequest = request.requestId;
+	g_pathfinder.addRequest(std::move(request));
+	return true;
+}
+
+void Creature::onFollowPathFound(PathResult& result)
+{
+	if (result.requestId != followPathRequest || isRemoved()) {
+		return;
+	}
+	followPathRequest = 0;
+
+	const auto target = getFollowCreature();
+	if (!target || target->getID() != result.targetId) {
+		return;
+	}
+
+	if (getPosition() != result.startPos) {
+		// walked on meanwhile, the directions would start from the wrong tile
+		goToFollowCreature();
+		return;
+	}
+
+	listWalkDir = std::move(result.dirList);
+	hasFollowPath = result.found;
+	if (hasFollowPath) {
+		startAutoWalk();
+	}
+
+	if (result.notifyComplete) {
+		onFollowCreatureComplete(target);
+	}
+}
+
 bool Creature::setFollowCreature(const CreaturePtr& creature)
 {
 	if (creature) {
@@ -1380,21 +1532,28 @@ Condition* Creature::getCondition(ConditionType_t type, ConditionId_t conditionI
 
 void Creature::executeConditions(uint32_t interval)
 {
-	ConditionList tempConditions{ conditions };
-	for (Condition* condition : tempConditions) {
-		auto it = std::ranges::find(conditions, condition);
-		if (it == conditions.end()) {
+	conditions.compact();
+
+	// the ones started by the conditions below wait for the next round
+	const size_t count = conditions.slots();
+	if (count == 0) {
+		return;
+	}
+
+	// most conditions only wait for their end time, they are left alone until then
+	const int64_t now = OTSYS_TIME();
+	const auto self = getCreature();
+	for (size_t index = 0; index < count; ++index) {
+		Condition* condition = conditions.slot(index);
+		if (!condition || !condition->isDue(now)) {
 			continue;
 		}
 
-		if (!condition->executeCondition(std::dynamic_pointer_cast<Creature>(shared_from_this()), interval)) {
-			it = std::ranges::find(conditions, condition);
-			if (it != conditions.end()) {
-				conditions.erase(it);
-				condition->endCondition(std::dynamic_pointer_cast<Creature>(shared_from_this()));
-				onEndCondition(condition->getType());
-				delete condition;
-			}
+		if (!condition->executeCondition(self, interval) && conditions.slot(index) == condition) {
+			conditions.eraseSlot(index);
+			condition->endCondition(self);
+			onEndCondition(condition->getType());
+			delete condition;
 		}
 	}
 }
@@ -1550,17 +1709,13 @@ bool Creature::registerCreatureEvent(const std::string& name)
 	}
 
 	CreatureEventType_t type = event->getEventType();
-	if (hasEventRegistered(type)) {
-		for (CreatureEvent* creatureEvent : eventsList) {
-			if (creatureEvent == event) {
-				return false;
-			}
-		}
-	} else {
-		scriptEventsBitField |= static_cast<uint32_t>(1) << type;
+	const auto range = std::ranges::equal_range(eventsList, type, {}, &CreatureEvent::getEventType);
+	if (std::ranges::find(range, event) != range.end()) {
+		return false;
 	}
 
-	eventsList.push_back(event);
+	eventsList.insert(range.end(), event);
+	scriptEventsBitField |= static_cast<uint32_t>(1) << type;
 	return true;
 }
 
@@ -1576,24 +1731,12 @@ bool Creature::unregisterCreatureEvent(const std::string& name)
 		return false;
 	}
 
-	bool resetTypeBit = true;
-
-	auto it = eventsList.begin(), end = eventsList.end();
-	while (it != end) {
-		CreatureEvent* curEvent = *it;
-		if (curEvent == event) {
-			it = eventsList.erase(it);
-			continue;
-		}
-
-		if (curEvent->getEventType() == type) {
-			resetTypeBit = false;
+	const auto range = std::ranges::equal_range(eventsList, type, {}, &CreatureEvent::getEventType);
+	if (const auto it = std::ranges::find(range, event); it != range.end()) {
+		if (range.size() == 1) {
+			scriptEventsBitField &= ~(static_cast<uint32_t>(1) << type);
 		}
-		++it;
-	}
-
-	if (resetTypeBit) {
-		scriptEventsBitField &= ~(static_cast<uint32_t>(1) << type);
+		eventsList.erase(it);
 	}
 	return true;
 }
@@ -1606,12 +1749,8 @@ CreatureEventList Creature::getCreatureEvents(CreatureEventType_t type) const
 		return tmpEventList;
 	}
 
-	for (CreatureEvent* creatureEvent : eventsList) {
-		if (!creatureEvent->isLoaded()) {
-			continue;
-		}
-
-		if (creatureEvent->getEventType() == type) {
+	for (CreatureEvent* creatureEvent : std::ranges::equal_range(eventsList, type, {}, &CreatureEvent::getEventType)) {
+		if (creatureEvent->isLoaded()) {
 			tmpEventList.push_back(creatureEvent);
 		}
 	}
@@ -1677,6 +1816,11 @@ bool FrozenPathingConditionCall::operator()(const Position& startPos, const Posi
 		return false;
 	}
 
+	return isMatchingDistance(testPos, fpp, bestMatchDist);
+}
+
+bool FrozenPathingConditionCall::isMatchingDistance(const Position& testPos, const FindPathParams& fpp, int32_t& bestMatchDist) const
+{
 	int32_t testDist = std::max<int32_t>(Position::getDistanceX(targetPos, testPos), Position::getDistanceY(targetPos, testPos));
 	if (fpp.maxTargetDist == 1) {
 		if (testDist < fpp.minTargetDist || testDist > fpp.maxTargetDist) {
@@ -1711,6 +1855,15 @@ bool Creature::isInvisible() const
 bool Creature::getPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp)
 {
 	CreaturePtr t_c = getCreature();
+
+	// too far for the node budget of a single search
+	const Position& pos = getPosition();
+	const int32_t distance = std::max(Position::getDistanceX(pos, targetPos), Position::getDistanceY(pos, targetPos));
+	if (distance > NAVIGATION_MIN_DISTANCE && pos.z == targetPos.z && (fpp.maxSearchDist == 0 || fpp.maxSearchDist >= distance)) {
+		if (g_game.map.getLongPath(t_c, targetPos, dirList, fpp)) {
+			return true;
+		}
+	}
 	return g_game.map.getPathMatching(t_c, dirList, FrozenPathingConditionCall(targetPos), fpp);
 }
 
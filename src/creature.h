@@ -7,16 +7,20 @@
 #include "map.h"
 #include "position.h"
 #include "condition.h"
+#include "conditionlist.h"
 #include "const.h"
 #include "tile.h"
 #include "enums.h"
 #include "creatureevent.h"
+
+#include <boost/container/small_vector.hpp>
 #include "declarations.h"
 #include "skills.h"
 
 class Map;
-using ConditionList = std::list<Condition*>;
-using CreatureEventList = std::list<CreatureEvent*>;
+// the events of one type, copied out so they can register and unregister
+// events of the creature while they run
+using CreatureEventList = boost::container::small_vector<CreatureEvent*, 4>;
 using namespace Components::Skills;
 
 enum slots_t : uint8_t {
@@ -51,6 +55,8 @@ static constexpr int32_t EVENT_CREATURECOUNT = 10;
 static constexpr int32_t EVENT_CREATURE_THINK_INTERVAL = 1000;
 static constexpr int32_t EVENT_CHECK_CREATURE_INTERVAL = (EVENT_CREATURE_THINK_INTERVAL / EVENT_CREATURECOUNT);
 
+struct PathResult;
+
 class FrozenPathingConditionCall
 {
 	public:
@@ -62,6 +68,13 @@ class FrozenPathingConditionCall
 		bool isInRange(const Position& startPos, const Position& testPos,
 		               const FindPathParams& fpp) const;
 
+		// the distance part of operator(), without range and sight checks
+		bool isMatchingDistance(const Position& testPos, const FindPathParams& fpp, int32_t& bestMatchDist) const;
+
+		const Position& getTargetPos() const {
+			return targetPos;
+		}
+
 	private:
 		Position targetPos;
 };
@@ -469,6 +482,10 @@ class Creature : virtual public Thing, public SharedObject
 		virtual void onAttackedCreatureDisappear(bool) {}
 		virtual void onFollowCreatureDisappear(bool) {}
 		virtual void onCreatureSay(const CreaturePtr&, SpeakClasses, const std::string&) {}
+		// whether onCreatureSay does anything, speech is not handed to the ones that don't
+		virtual bool listensToSpeech() const {
+			return false;
+		}
 		virtual void onPlacedCreature() {}
 
 		virtual bool getCombatValues(int32_t&, int32_t&) {
@@ -564,6 +581,12 @@ class Creature : virtual public Thing, public SharedObject
 
 		int32_t getWalkCache(const Position& pos) const;
 
+		// the players a multifloor spectator query around this creature returns,
+		// kept by Map while the creature is placed on it
+		const std::vector<Player*>& getObservers() const {
+			return observers;
+		}
+
 		const Position& getLastPosition() const {
 			return lastPosition;
 		}
@@ -579,7 +602,17 @@ class Creature : virtual public Thing, public SharedObject
 		bool getPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp);
 		bool getPathTo(const Position& targetPos, std::vector<Direction>& dirList, int32_t minTargetDist, int32_t maxTargetDist, bool fullPathSearch = true, bool clearSight = true, int32_t maxSearchDist = 0);
 
+		// result of a follow path search run by the pathfinding workers
+		void onFollowPathFound(PathResult& result);
+
 	protected:
+		// hands the search to the pathfinding workers when they take it
+		bool requestFollowPath(const Position& targetPos, const FindPathParams& fpp, bool notifyComplete);
+		// keeps or patches listWalkDir after the target moved instead of searching again
+		bool repairFollowPath(const Position& targetPos, const FindPathParams& fpp);
+		// takes the path from the flow field shared by everyone chasing target
+		bool followFlowField(const CreaturePtr& target, const FindPathParams& fpp);
+
 		virtual bool useCacheMap() const {
 			return false;
 		}
@@ -600,10 +633,12 @@ class Creature : virtual public Thing, public SharedObject
 		CountMap damageMap;
 
 		std::list<CreaturePtr> summons;
-		CreatureEventList eventsList;
+		// grouped by type, each type in the order it was registered
+		std::vector<CreatureEvent*> eventsList;
 		ConditionList conditions;
 
 		std::vector<Direction> listWalkDir;
+		std::vector<Player*> observers;
 		SkillRegistry c_skills;
 
 		TileWeakPtr tile;
@@ -620,6 +655,8 @@ class Creature : virtual public Thing, public SharedObject
 		uint32_t blockCount = 0;
 		uint32_t blockTicks = 0;
 		uint32_t lastStepCost = 1;
+		// follow path search still running on the workers, 0 when none
+		uint32_t followPathRequest = 0;
 		uint32_t baseSpeed = 220;
 		int32_t varSpeed = 0;
 		int32_t health = 1000;
@@ -642,6 +679,8 @@ class Creature : virtual public Thing, public SharedObject
 		bool isUpdatingPath = false;
 		bool creatureCheck = false;
 		bool inCheckCreaturesVector = false;
+		uint8_t checkCreatureBucket = 0;
+		uint32_t checkCreatureIndex = 0;
 		bool skillLoss = true;
 		bool lootDrop = true;
 		bool cancelNextWalk = false;
@@ -279,8 +279,7 @@ bool CreatureEvent::executeOnLogin(const PlayerPtr& player) const
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	return scriptInterface->callFunction(1);
 }
 
@@ -298,8 +297,7 @@ bool CreatureEvent::executeOnLogout(const PlayerPtr& player) const
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	return scriptInterface->callFunction(1);
 }
 
@@ -317,8 +315,7 @@ bool CreatureEvent::executeOnThink(const CreaturePtr& creature, uint32_t interva
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	lua_pushinteger(L, interval);
 
 	return scriptInterface->callFunction(2);
@@ -339,12 +336,10 @@ bool CreatureEvent::executeOnPrepareDeath(const CreaturePtr& creature, const Cre
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 
 	if (killer) {
-		LuaScriptInterface::pushSharedPtr(L, killer);
-		LuaScriptInterface::setCreatureMetatable(L, -1, killer);
+		LuaScriptInterface::pushCreature(L, killer);
 	} else {
 		lua_pushnil(L);
 	}
@@ -366,21 +361,18 @@ bool CreatureEvent::executeOnDeath(const CreaturePtr& creature, const ItemPtr& c
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 
 	LuaScriptInterface::pushThing(L, corpse);
 
 	if (killer) {
-		LuaScriptInterface::pushSharedPtr(L, killer);
-		LuaScriptInterface::setCreatureMetatable(L, -1, killer);
+		LuaScriptInterface::pushCreature(L, killer);
 	} else {
 		lua_pushnil(L);
 	}
 
 	if (mostDamageKiller) {
-		LuaScriptInterface::pushSharedPtr(L, mostDamageKiller);
-		LuaScriptInterface::setCreatureMetatable(L, -1, mostDamageKiller);
+		LuaScriptInterface::pushCreature(L, mostDamageKiller);
 	} else {
 		lua_pushnil(L);
 	}
@@ -406,8 +398,7 @@ bool CreatureEvent::executeAdvance(const PlayerPtr& player, skills_t skill, uint
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	lua_pushinteger(L, static_cast<uint32_t>(skill));
 	lua_pushinteger(L, oldLevel);
 	lua_pushinteger(L, newLevel);
@@ -429,10 +420,8 @@ void CreatureEvent::executeOnKill(const CreaturePtr& creature, const CreaturePtr
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
-	LuaScriptInterface::pushSharedPtr(L, target);
-	LuaScriptInterface::setCreatureMetatable(L, -1, target);
+	LuaScriptInterface::pushCreature(L, creature);
+	LuaScriptInterface::pushCreature(L, target);
 	scriptInterface->callVoidFunction(2);
 }
 
@@ -450,8 +439,7 @@ void CreatureEvent::executeModalWindow(const PlayerPtr& player, uint32_t modalWi
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	lua_pushinteger(L, modalWindowId);
 	lua_pushinteger(L, buttonId);
@@ -474,8 +462,7 @@ bool CreatureEvent::executeTextEdit(const PlayerPtr& player, const ItemPtr& item
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushThing(L, item);
 	LuaScriptInterface::pushString(L, text);
@@ -497,11 +484,9 @@ void CreatureEvent::executeHealthChange(const CreaturePtr& creature, const Creat
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	if (attacker) {
-		LuaScriptInterface::pushSharedPtr(L, attacker);
-		LuaScriptInterface::setCreatureMetatable(L, -1, attacker);
+		LuaScriptInterface::pushCreature(L, attacker);
 	} else {
 		lua_pushnil(L);
 	}
@@ -539,11 +524,9 @@ void CreatureEvent::executeManaChange(const CreaturePtr& creature, const Creatur
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	if (attacker) {
-		LuaScriptInterface::pushSharedPtr(L, attacker);
-		LuaScriptInterface::setCreatureMetatable(L, -1, attacker);
+		LuaScriptInterface::pushCreature(L, attacker);
 	} else {
 		lua_pushnil(L);
 	}
@@ -578,8 +561,7 @@ void CreatureEvent::executeExtendedOpcode(const PlayerPtr& player, uint8_t opcod
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	lua_pushinteger(L, opcode);
 	LuaScriptInterface::pushString(L, buffer);
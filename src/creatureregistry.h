@@ -0,0 +1,179 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_CREATUREREGISTRY_H
+#define FS_CREATUREREGISTRY_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// The creatures of one kind by their id. An id is the base of the kind, the
+// generation of its slot and the slot, so finding one is an index and a
+// comparison, and the id of a creature that is gone no longer matches its
+// slot. The listed creatures are kept side by side for loops over them.
+template <typename T>
+class CreatureRegistry
+{
+	public:
+		using Ptr = std::shared_ptr<T>;
+
+		static constexpr uint32_t IndexBits = 20;
+		static constexpr uint32_t GenerationBits = 10;
+		static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+		static constexpr uint32_t GenerationMask = (1u << GenerationBits) - 1;
+		static constexpr uint32_t IdMask = (1u << (IndexBits + GenerationBits)) - 1;
+
+		explicit CreatureRegistry(uint32_t base) : base(base) {}
+
+		bool owns(uint32_t id) const {
+			return (id & ~IdMask) == base;
+		}
+
+		// hands out the id of creature, it is found once it is inserted, 0 when
+		// every slot is taken
+		uint32_t reserve(const Ptr& creature) {
+			if (freeSlots.empty()) {
+				reclaim();
+			}
+
+			uint32_t index;
+			if (!freeSlots.empty()) {
+				// the oldest free slot first, an id comes back as late as it can
+				index = freeSlots.front();
+				freeSlots.pop_front();
+			} else if (slots.size() <= IndexMask) {
+				index = static_cast<uint32_t>(slots.size());
+				slots.emplace_back();
+			} else {
+				return 0;
+			}
+
+			Slot& slot = slots[index];
+			slot.reserved = true;
+			slot.pending = creature;
+			return makeId(index, slot.generation);
+		}
+
+		bool insert(uint32_t id, Ptr creature) {
+			Slot* slot = getSlot(id);
+			if (!slot || !slot->reserved) {
+				return false;
+			}
+
+			if (slot->listed == Unlisted) {
+				slot->listed = static_cast<uint32_t>(listed.size());
+				listed.push_back(std::move(creature));
+				listedIds.push_back(id);
+			} else {
+				listed[slot->listed] = std::move(creature);
+			}
+			slot->pending.reset();
+			return true;
+		}
+
+		void erase(uint32_t id) {
+			Slot* slot = getSlot(id);
+			if (!slot || !slot->reserved) {
+				return;
+			}
+
+			if (slot->listed != Unlisted) {
+				const uint32_t position = slot->listed;
+				if (position + 1 != listed.size()) {
+					listed[position] = std::move(listed.back());
+					listedIds[position] = listedIds.back();
+					slots[listedIds[position] & IndexMask].listed = position;
+				}
+				listed.pop_back();
+				listedIds.pop_back();
+			}
+			release(id & IndexMask);
+		}
+
+		Ptr find(uint32_t id) const {
+			const Slot* slot = getSlot(id);
+			if (!slot || slot->listed == Unlisted) {
+				return nullptr;
+			}
+			return listed[slot->listed];
+		}
+
+		size_t size() const {
+			return listed.size();
+		}
+
+		typename std::vector<Ptr>::const_iterator begin() const {
+			return listed.begin();
+		}
+
+		typename std::vector<Ptr>::const_iterator end() const {
+			return listed.end();
+		}
+
+	private:
+		static constexpr uint32_t Unlisted = UINT32_MAX;
+
+		struct Slot {
+			// a creature given its id and never inserted lets go of it by expiring
+			std::weak_ptr<T> pending;
+			uint32_t listed = Unlisted;
+			uint32_t generation = 0;
+			bool reserved = false;
+		};
+
+		uint32_t makeId(uint32_t index, uint32_t generation) const {
+			return base | (generation << IndexBits) | index;
+		}
+
+		Slot* getSlot(uint32_t id) {
+			return const_cast<Slot*>(static_cast<const CreatureRegistry*>(this)->getSlot(id));
+		}
+
+		const Slot* getSlot(uint32_t id) const {
+			if (!owns(id)) {
+				return nullptr;
+			}
+
+			const uint32_t index = id & IndexMask;
+			if (index >= slots.size() || slots[index].generation != ((id >> IndexBits) & GenerationMask)) {
+				return nullptr;
+			}
+			return &slots[index];
+		}
+
+		void release(uint32_t index) {
+			Slot& slot = slots[index];
+			slot.pending.reset();
+			slot.listed = Unlisted;
+			slot.reserved = false;
+			slot.generation = (slot.generation + 1) & GenerationMask;
+			freeSlots.push_back(index);
+		}
+
+		// frees the ids of creatures that were given one and are gone without
+		// ever being inserted, looked for once every chunk of new slots
+		void reclaim() {
+			if (slots.empty() || slots.size() % ReclaimInterval != 0) {
+				return;
+			}
+
+			for (uint32_t index = 0; index < slots.size(); ++index) {
+				const Slot& slot = slots[index];
+				if (slot.reserved && slot.listed == Unlisted && slot.pending.expired()) {
+					release(index);
+				}
+			}
+		}
+
+		static constexpr size_t ReclaimInterval = 1024;
+
+		std::vector<Slot> slots;
+		std::deque<uint32_t> freeSlots;
+		std::vector<Ptr> listed;
+		std::vector<uint32_t> listedIds;
+		uint32_t base;
+};
+
+#endif
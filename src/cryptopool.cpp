@@ -0,0 +1,68 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "cryptopool.h"
+#include "threadrole.h"
+#include "tracing.h"
+
+void CryptoPool::start(size_t threadCount)
+{
+	stopping = false;
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&CryptoPool::threadMain, this);
+	}
+}
+
+void CryptoPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(taskLock);
+		stopping = true;
+		tasks.clear();
+	}
+	taskSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+void CryptoPool::addTask(std::function<void()>&& task)
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(taskLock);
+		if (stopping) {
+			return;
+		}
+		tasks.push_back(std::move(task));
+	}
+	taskSignal.notify_one();
+}
+
+void CryptoPool::threadMain()
+{
+	setThreadRole("crypto");
+	std::unique_lock<std::mutex> lockGuard(taskLock);
+	while (true) {
+		taskSignal.wait(lockGuard, [this]() { return stopping || !tasks.empty(); });
+		if (stopping) {
+			return;
+		}
+
+		std::function<void()> task = std::move(tasks.front());
+		tasks.pop_front();
+		lockGuard.unlock();
+
+		{
+			TraceScope trace("handshake", "crypto");
+			task();
+		}
+
+		lockGuard.lock();
+	}
+}
@@ -0,0 +1,40 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_CRYPTOPOOL_H
+#define FS_CRYPTOPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+
+// Worker threads for the RSA step of a login. The first message of every
+// connection is handed over here, so a burst of logins after a restart is
+// decrypted in parallel instead of holding up the network threads, and the
+// connection resumes reading once its handshake has run.
+class CryptoPool
+{
+	public:
+		void start(size_t threadCount);
+		void shutdown();
+
+		bool isRunning() const {
+			return !threads.empty();
+		}
+
+		void addTask(std::function<void()>&& task);
+
+	private:
+		void threadMain();
+
+		std::vector<std::thread> threads;
+		std::deque<std::function<void()>> tasks;
+		std::mutex taskLock;
+		std::condition_variable taskSignal;
+		bool stopping = false;
+};
+
+extern CryptoPool g_cryptoPool;
+
+#endif
@@ -1,5 +1,61 @@
 #include "damagemodifier.h"
 
+uint32_t DamageModifier::setGeneration = 0;
+gtl::flat_hash_map<std::string, uint32_t> DamageModifier::nameIds;
+
+uint32_t DamageModifier::getNameId(std::string_view creatureName)
+{
+	const auto it = nameIds.find(creatureName);
+	return it != nameIds.end() ? it->second : 0;
+}
+
+bool DamageModifier::compile(CompiledModifier& compiled) const
+{
+	if (!isFlatValue() && !isPercent()) {
+		return false;
+	}
+
+	// values read from an old or broken save may be out of range, those match nothing
+	const auto bit = [](const uint32_t value) { return value < 32 ? 1u << value : 0u; };
+
+	// the same rules as appliesToOrigin and appliesToTarget
+	if (m_origin_type == ORIGIN_NONE) {
+		compiled.originMask = ~0u;
+	} else {
+		compiled.originMask = bit(m_origin_type);
+		if (m_origin_type == ORIGIN_AUGMENT) {
+			for (const CombatOrigin origin : {ORIGIN_ABSORB, ORIGIN_RESTORE, ORIGIN_REFLECT, ORIGIN_DEFLECT, ORIGIN_RICOCHET, ORIGIN_PIERCING}) {
+				compiled.originMask |= bit(origin);
+			}
+		}
+	}
+
+	if (m_creature_type == CREATURETYPE_ATTACKABLE) {
+		compiled.creatureTypeMask = ~0u;
+	} else {
+		compiled.creatureTypeMask = bit(m_creature_type);
+		if (m_creature_type == CREATURETYPE_MONSTER || m_creature_type == CREATURETYPE_SUMMON_ALL) {
+			for (const CreatureType_t type : {CREATURETYPE_MONSTER, CREATURETYPE_SUMMON_ALL, CREATURETYPE_SUMMON_OWN, CREATURETYPE_SUMMON_GUILD, CREATURETYPE_SUMMON_HOSTILE, CREATURETYPE_SUMMON_PARTY}) {
+				compiled.creatureTypeMask |= bit(type);
+			}
+		}
+	}
+
+	compiled.raceMask = m_race_type == RACE_NONE ? ~0u : bit(m_race_type);
+
+	if (m_creature_name.empty() || m_creature_name == "none") {
+		compiled.nameId = 0;
+	} else {
+		compiled.nameId = nameIds.try_emplace(m_creature_name, static_cast<uint32_t>(nameIds.size() + 1)).first->second;
+	}
+
+	compiled.damageType = m_damage_type;
+	compiled.value = m_value;
+	compiled.chance = m_chance;
+	compiled.flat = isFlatValue();
+	return true;
+}
+
 std::shared_ptr<DamageModifier> DamageModifier::makeModifier(uint8_t stance, uint8_t modType, uint16_t amount, ModFactor factor, uint8_t chance, CombatType_t combatType, CombatOrigin source, CreatureType_t creatureType, RaceType_t race, std::string_view creatureName) {
 	auto mod = std::make_shared<DamageModifier>(stance, modType, amount, factor, chance, combatType, source, creatureType, race, creatureName.data());
 	return mod;
@@ -7,9 +63,11 @@ std::shared_ptr<DamageModifier> DamageModifier::makeModifier(uint8_t stance, uin
 
 void DamageModifier::setTransformDamageType(CombatType_t damageType) {
 	m_to_damage_type = damageType;
+	invalidateSets();
 }
 
 void DamageModifier::increaseValue(uint16_t amount) {
+	invalidateSets();
 	if ((m_value + amount) <= std::numeric_limits<uint16_t>::max()) {
 		m_value += amount;
 	} else {
@@ -19,6 +77,7 @@ void DamageModifier::increaseValue(uint16_t amount) {
 }
 
 void DamageModifier::decreaseValue(uint16_t amount) {
+	invalidateSets();
 	if (m_value >= amount) {
 		m_value -= amount;
 	}else {
@@ -11,6 +11,7 @@
 #include "otpch.h"
 #include "tools.h"
 #include "fileloader.h"
+#include <gtl/phmap.hpp>
 
 struct ModifierTotals {
 	ModifierTotals() = default;
@@ -135,6 +136,25 @@ enum ModifierStance : uint8_t {
 	DEFENSE_MOD
 };
 
+// a DamageModifier reduced to what a hit checks, each condition a mask or a
+// single compare, see DamageModifier::compile
+struct CompiledModifier {
+	uint32_t originMask = 0;			// bit per CombatOrigin
+	uint32_t creatureTypeMask = 0;		// bit per CreatureType_t
+	uint32_t raceMask = 0;				// bit per RaceType_t
+	uint32_t nameId = 0;				// 0 matches every creature
+	CombatType_t damageType = COMBAT_NONE;	// COMBAT_NONE matches every type
+	uint16_t value = 0;
+	uint8_t chance = 0;
+	bool flat = false;
+
+	bool appliesTo(const CombatType_t damage, const CombatOrigin origin, const CreatureType_t creatureType, const RaceType_t race, const uint32_t targetNameId) const {
+		return (damageType == COMBAT_NONE || damageType == damage) && (originMask & (1u << origin)) != 0 &&
+			(creatureTypeMask & (1u << creatureType)) != 0 && (raceMask & (1u << race)) != 0 &&
+			(nameId == 0 || nameId == targetNameId);
+	}
+};
+
 class DamageModifier : public std::enable_shared_from_this<DamageModifier> {
 
 public:
@@ -158,6 +178,30 @@ public:
 		m_creature_name(creatureName)			// if none, all creatures.
 	{}
 
+	// every field equal, what the stored form of an augment compares
+	bool isSameAs(const DamageModifier& other) const {
+		return m_mod_stance == other.m_mod_stance && m_mod_type == other.m_mod_type && m_value == other.m_value && m_factor == other.m_factor
+			&& m_chance == other.m_chance && m_damage_type == other.m_damage_type && m_to_damage_type == other.m_to_damage_type
+			&& m_origin_type == other.m_origin_type && m_creature_type == other.m_creature_type && m_race_type == other.m_race_type
+			&& m_creature_name == other.m_creature_name;
+	}
+
+	// bumped whenever a modifier changes its stance or type, or one is added to or
+	// removed from an augment, the cached modifier sets of players are then rebuilt
+	static uint32_t getSetGeneration() {
+		return setGeneration;
+	}
+
+	static void invalidateSets() {
+		++setGeneration;
+	}
+
+	// creature names used by modifiers, a name no modifier uses has id 0
+	static uint32_t getNameId(std::string_view creatureName);
+
+	// false for modifiers that are neither flat nor percent, they never apply
+	bool compile(CompiledModifier& compiled) const;
+
 	static std::shared_ptr<DamageModifier> makeModifier(uint8_t stance, uint8_t modType, uint16_t amount, ModFactor factorType, uint8_t chance, CombatType_t combatType = COMBAT_NONE, CombatOrigin source = ORIGIN_NONE, CreatureType_t creatureType = CREATURETYPE_ATTACKABLE, RaceType_t race = RACE_NONE, std::string_view creatureName = "none");
 
 	const uint8_t& getStance() const;
@@ -241,6 +285,9 @@ private:
 	CreatureType_t m_creature_type = CREATURETYPE_ATTACKABLE;
 	RaceType_t m_race_type = RACE_NONE;
 	std::string m_creature_name = "none";
+
+	static uint32_t setGeneration;
+	static gtl::flat_hash_map<std::string, uint32_t> nameIds;
 };
 
 /// Inline Methods' Definitions
@@ -248,47 +295,57 @@ private:
 inline void DamageModifier::setType(uint8_t modType)
 {
 	m_mod_type = modType;
+	invalidateSets();
 }
 
 inline void DamageModifier::setStance(uint8_t stance)
 {
 	m_mod_stance = stance;
+	invalidateSets();
 }
 
 inline void DamageModifier::setValue(uint16_t amount) {
 	m_value = amount;
+	invalidateSets();
 }
 
 inline void DamageModifier::setChance(uint8_t chance)
 {
 	m_chance = chance;
+	invalidateSets();
 }
 
 inline void DamageModifier::setFactor(uint8_t factor)
 {
 	m_factor = static_cast<ModFactor>(factor);
+	invalidateSets();
 }
 
 inline void DamageModifier::setCombatType(CombatType_t combatType) {
 	m_damage_type = combatType;
+	invalidateSets();
 }
 
 inline void DamageModifier::setOriginType(CombatOrigin origin) {
 	m_origin_type = origin;
+	invalidateSets();
 }
 
 inline void DamageModifier::setRaceType(RaceType_t race)
 {
 	m_race_type = race;
+	invalidateSets();
 }
 
 inline void DamageModifier::setCreatureType(CreatureType_t c_type)
 {
 	m_creature_type = c_type;
+	invalidateSets();
 }
 
 inline void DamageModifier::setCreatureName(std::string_view creatureName) {
-	m_creature_name = creatureName.data();
+	m_creature_name = creatureName;
+	invalidateSets();
 }
 
 inline const bool DamageModifier::isPercent() const {
@@ -336,7 +393,7 @@ inline const bool DamageModifier::appliesToTarget(const CreatureType_t creatureT
 		if (m_creature_name.empty() || m_creature_name == "none") {
 			attackableTarget = true;
 		} else {
-			attackableTarget = (m_creature_name == std::string(creatureName.data()));
+			attackableTarget = (m_creature_name == creatureName);
 		}
 	}
 	return attackableTarget;
@@ -5,13 +5,21 @@
 
 #include "configmanager.h"
 #include "database.h"
+#include "querystats.h"
 
 #include <mysql/errmsg.h>
 
 extern ConfigManager g_config;
 
+// errors after which the query is worth sending again
+static bool isConnectionError(unsigned int error)
+{
+	return error == CR_SERVER_LOST || error == CR_SERVER_GONE_ERROR || error == CR_CONN_HOST_ERROR || error == 1053/*ER_SERVER_SHUTDOWN*/ || error == CR_CONNECTION_ERROR;
+}
+
 Database::~Database()
 {
+	closeStatements();
 	if (handle != nullptr) {
 		mysql_close(handle);
 	}
@@ -77,8 +85,9 @@ bool Database::commit()
 	return true;
 }
 
-bool Database::executeQuery(const std::string& query)
+bool Database::executeQuery(const std::string& query, const std::source_location& location/* = std::source_location::current()*/)
 {
+	QueryTimer timer(query, location);
 	bool success = true;
 
 	// executes the query
@@ -104,8 +113,9 @@ bool Database::executeQuery(const std::string& query)
 	return success;
 }
 
-DBResult_ptr Database::storeQuery(const std::string& query)
+DBResult_ptr Database::storeQuery(const std::string& query, const std::source_location& location/* = std::source_location::current()*/)
 {
+	QueryTimer timer(query, location);
 	databaseLock.lock();
 
 	while (mysql_real_query(handle, query.c_str(), query.length()) != 0) {
@@ -145,24 +155,170 @@ DBResult_ptr Database::storeQuery(const std::string& query)
 	return result;
 }
 
-std::string Database::escapeBlob(const char* s, uint32_t length) const
+MYSQL_STMT* Database::getStatement(std::string_view query, unsigned int& error)
 {
-	// the worst case is 2n + 1
-	size_t maxLength = (length * 2) + 1;
+	auto it = statements.find(query);
+	if (it != statements.end()) {
+		return it->second;
+	}
+
+	MYSQL_STMT* stmt = mysql_stmt_init(handle);
+	if (!stmt) {
+		error = mysql_errno(handle);
+		std::cout << "[Error - mysql_stmt_init] Message: " << mysql_error(handle) << std::endl;
+		return nullptr;
+	}
+
+	if (mysql_stmt_prepare(stmt, query.data(), query.length()) != 0) {
+		error = mysql_stmt_errno(stmt);
+		std::cout << "[Error - mysql_stmt_prepare] Query: " << query.substr(0, 256) << std::endl << "Message: " << mysql_stmt_error(stmt) << std::endl;
+		mysql_stmt_close(stmt);
+		return nullptr;
+	}
 
+	// lets the results size their buffers before the rows are fetched
+	decltype(MYSQL_BIND::is_null_value) updateMaxLength = 1;
+	mysql_stmt_attr_set(stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+
+	statements.emplace(query, stmt);
+	return stmt;
+}
+
+MYSQL_STMT* Database::runStatement(std::string_view query, std::initializer_list<DBParam> params)
+{
+	std::vector<MYSQL_BIND> binds(params.size());
+	auto bind = binds.begin();
+	for (const DBParam& param : params) {
+		if (param.type == DBParam::PARAM_TEXT) {
+			bind->buffer_type = MYSQL_TYPE_STRING;
+			bind->buffer = const_cast<char*>(param.text.data());
+			bind->buffer_length = param.text.length();
+		} else {
+			bind->buffer_type = MYSQL_TYPE_LONGLONG;
+			bind->buffer = const_cast<uint64_t*>(&param.integer);
+			bind->is_unsigned = param.type == DBParam::PARAM_UNSIGNED;
+		}
+		++bind;
+	}
+
+	while (true) {
+		unsigned int error = 0;
+		MYSQL_STMT* stmt = getStatement(query, error);
+		if (stmt) {
+			if (mysql_stmt_param_count(stmt) != binds.size()) {
+				std::cout << "[Error - Database::runStatement] Query: " << query.substr(0, 256) << std::endl << "Message: expected " << mysql_stmt_param_count(stmt) << " parameters, got " << binds.size() << std::endl;
+				return nullptr;
+			}
+
+			if ((binds.empty() || mysql_stmt_bind_param(stmt, binds.data()) == 0) && mysql_stmt_execute(stmt) == 0) {
+				return stmt;
+			}
+
+			error = mysql_stmt_errno(stmt);
+			std::cout << "[Error - mysql_stmt_execute] Query: " << query.substr(0, 256) << std::endl << "Message: " << mysql_stmt_error(stmt) << std::endl;
+		}
+
+		if (!isConnectionError(error)) {
+			return nullptr;
+		}
+
+		// the statements went away with the connection, they are prepared again
+		closeStatements();
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+}
+
+void Database::closeStatements()
+{
+	for (const auto& it : statements) {
+		mysql_stmt_close(it.second);
+	}
+	statements.clear();
+}
+
+bool Database::executeStatement(std::string_view query, std::initializer_list<DBParam> params/* = {}*/, const std::source_location& location/* = std::source_location::current()*/)
+{
+	QueryTimer timer(query, location);
+	std::lock_guard<std::recursive_mutex> lockGuard(databaseLock);
+	MYSQL_STMT* stmt = runStatement(query, params);
+	if (!stmt) {
+		return false;
+	}
+
+	mysql_stmt_free_result(stmt);
+	return true;
+}
+
+DBResult_ptr Database::storeStatement(std::string_view query, std::initializer_list<DBParam> params/* = {}*/, const std::source_location& location/* = std::source_location::current()*/)
+{
+	QueryTimer timer(query, location);
+	DBResult_ptr result;
+	{
+		std::lock_guard<std::recursive_mutex> lockGuard(databaseLock);
+		MYSQL_STMT* stmt = runStatement(query, params);
+		if (!stmt) {
+			return nullptr;
+		}
+		result = std::make_shared<DBResult>(stmt);
+	}
+
+	if (!result->hasNext()) {
+		return nullptr;
+	}
+	return result;
+}
+
+DBResult_ptr Database::useQuery(const std::string& query, const std::source_location& location/* = std::source_location::current()*/)
+{
+	// until the rows can be read, walking them is the caller's time
+	QueryTimer timer(query, location);
+	databaseLock.lock();
+
+	while (mysql_real_query(handle, query.c_str(), query.length()) != 0) {
+		std::cout << "[Error - mysql_real_query] Query: " << query << std::endl << "Message: " << mysql_error(handle) << std::endl;
+		if (!isConnectionError(mysql_errno(handle))) {
+			databaseLock.unlock();
+			return nullptr;
+		}
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+
+	MYSQL_RES* res = mysql_use_result(handle);
+	if (res == nullptr) {
+		std::cout << "[Error - mysql_use_result] Query: " << query << std::endl << "Message: " << mysql_error(handle) << std::endl;
+		databaseLock.unlock();
+		return nullptr;
+	}
+
+	// the result keeps the lock until it is freed
+	DBResult_ptr result = std::make_shared<DBResult>(res, handle, databaseLock);
+	if (!result->hasNext()) {
+		return nullptr;
+	}
+	return result;
+}
+
+std::string Database::escapeBlob(const char* s, uint32_t length) const
+{
 	std::string escaped;
-	escaped.reserve(maxLength + 2);
-	escaped.push_back('\'');
+	appendEscapedBlob(escaped, s, length);
+	return escaped;
+}
+
+void Database::appendEscapedBlob(std::string& output, const char* s, size_t length) const
+{
+	// the worst case is 2n + 1, with the quotes around it
+	const size_t offset = output.length();
+	output.resize(offset + (length * 2) + 3);
+	output[offset] = '\'';
 
+	size_t escapedLength = 0;
 	if (length != 0) {
-		char* output = new char[maxLength];
-		auto escaped_length = mysql_real_escape_string(handle, output, s, length);
-		escaped.append(output, escaped_length);
-		delete[] output;
+		escapedLength = mysql_real_escape_string(handle, output.data() + offset + 1, s, length);
 	}
 
-	escaped.push_back('\'');
-	return escaped;
+	output[offset + escapedLength + 1] = '\'';
+	output.resize(offset + escapedLength + 2);
 }
 
 DBResult::DBResult(MYSQL_RES* res)
@@ -180,68 +336,235 @@ DBResult::DBResult(MYSQL_RES* res)
 	row = mysql_fetch_row(handle);
 }
 
+DBResult::DBResult(MYSQL_STMT* stmt) : handle(nullptr), row(nullptr)
+{
+	MYSQL_RES* metadata = mysql_stmt_result_metadata(stmt);
+	if (!metadata) {
+		return;
+	}
+
+	if (mysql_stmt_store_result(stmt) != 0) {
+		std::cout << "[Error - mysql_stmt_store_result] Message: " << mysql_stmt_error(stmt) << std::endl;
+		mysql_free_result(metadata);
+		return;
+	}
+
+	const unsigned int count = mysql_num_fields(metadata);
+	const MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+
+	std::vector<MYSQL_BIND> binds(count);
+	std::vector<uint64_t> integers(count);
+	std::vector<double> reals(count);
+	std::vector<std::string> buffers(count);
+	std::vector<Field::FieldType_t> types(count);
+
+	names.reserve(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		const MYSQL_FIELD& field = fields[i];
+		listNames[names.emplace_back(field.name)] = i;
+
+		MYSQL_BIND& bind = binds[i];
+		bind.is_null = &bind.is_null_value;
+		bind.length = &bind.length_value;
+		switch (field.type) {
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_YEAR:
+				bind.buffer_type = MYSQL_TYPE_LONGLONG;
+				bind.buffer = &integers[i];
+				bind.is_unsigned = (field.flags & UNSIGNED_FLAG) != 0;
+				types[i] = bind.is_unsigned ? Field::FIELD_UNSIGNED : Field::FIELD_SIGNED;
+				break;
+
+			case MYSQL_TYPE_FLOAT:
+			case MYSQL_TYPE_DOUBLE:
+				bind.buffer_type = MYSQL_TYPE_DOUBLE;
+				bind.buffer = &reals[i];
+				types[i] = Field::FIELD_REAL;
+				break;
+
+			default:
+				buffers[i].resize(std::max<unsigned long>(1, field.max_length));
+				bind.buffer_type = MYSQL_TYPE_BLOB;
+				bind.buffer = buffers[i].data();
+				bind.buffer_length = buffers[i].size();
+				types[i] = Field::FIELD_TEXT;
+				break;
+		}
+	}
+	mysql_free_result(metadata);
+
+	if (count != 0 && mysql_stmt_bind_result(stmt, binds.data()) != 0) {
+		std::cout << "[Error - mysql_stmt_bind_result] Message: " << mysql_stmt_error(stmt) << std::endl;
+		mysql_stmt_free_result(stmt);
+		return;
+	}
+
+	rows.reserve(mysql_stmt_num_rows(stmt));
+	int status;
+	while ((status = mysql_stmt_fetch(stmt)) == 0 || status == MYSQL_DATA_TRUNCATED) {
+		auto& fieldRow = rows.emplace_back(count);
+		for (unsigned int i = 0; i < count; ++i) {
+			Field& field = fieldRow[i];
+			if (binds[i].is_null_value) {
+				continue;
+			}
+
+			field.type = types[i];
+			field.integer = integers[i];
+			field.real = reals[i];
+			if (types[i] == Field::FIELD_TEXT) {
+				field.text.assign(buffers[i].data(), std::min<unsigned long>(binds[i].length_value, buffers[i].size()));
+			}
+		}
+	}
+	mysql_stmt_free_result(stmt);
+}
+
+DBResult::DBResult(MYSQL_RES* res, MYSQL* connection, std::recursive_mutex& lock) : DBResult(res)
+{
+	streamHandle = connection;
+	streamLock = &lock;
+}
+
 DBResult::~DBResult()
 {
-	mysql_free_result(handle);
+	if (handle) {
+		// a streamed result reads what is left of it from the connection
+		mysql_free_result(handle);
+	}
+
+	if (streamLock) {
+		streamLock->unlock();
+	}
 }
 
 std::string_view DBResult::getString(std::string_view column) const
 {
-	auto it = listNames.find(column);
-	if (it == listNames.end()) {
+	const size_t index = getColumnIndex(column);
+	if (index == INVALID_COLUMN) {
 		std::cout << "[Error - DBResult::getString] Column '" << column << "' does not exist in result set."
 			<< std::endl;
 		return {};
 	}
+	return getString(index);
+}
+
+std::string_view DBResult::getString(size_t index) const
+{
+	if (index >= listNames.size()) {
+		return {};
+	}
+
+	if (!handle) {
+		const Field& field = rows[current][index];
+		switch (field.type) {
+			case Field::FIELD_SIGNED:
+				field.text = std::to_string(static_cast<int64_t>(field.integer));
+				break;
+			case Field::FIELD_UNSIGNED:
+				field.text = std::to_string(field.integer);
+				break;
+			case Field::FIELD_REAL:
+				field.text = std::to_string(field.real);
+				break;
+			default:
+				break;
+		}
+		return field.text;
+	}
 
-	if (row[it->second] == nullptr) {
+	if (row[index] == nullptr) {
 		return {};
 	}
 
-	auto size = mysql_fetch_lengths(handle)[it->second];
-	return { row[it->second], size };
+	auto size = mysql_fetch_lengths(handle)[index];
+	return { row[index], size };
 }
 
 bool DBResult::hasNext() const
 {
+	if (!handle) {
+		return current < rows.size();
+	}
 	return row != nullptr;
 }
 
 bool DBResult::next()
 {
+	if (!handle) {
+		return ++current < rows.size();
+	}
+
 	row = mysql_fetch_row(handle);
+	if (!row && streamHandle && mysql_errno(streamHandle) != 0) {
+		std::cout << "[Error - mysql_fetch_row] Message: " << mysql_error(streamHandle) << std::endl;
+	}
 	return row != nullptr;
 }
 
 DBInsert::DBInsert(std::string query) : query(std::move(query))
 {
-	this->length = this->query.length();
+	values = this->query;
 }
 
-bool DBInsert::addRow(const std::string& row)
+void DBInsert::reserve(size_t bytes)
 {
-	// adds new row to buffer
-	const size_t rowLength = row.length();
-	length += rowLength;
-	if (length > Database::getInstance().getMaxPacketSize() && !execute()) {
-		return false;
-	}
+	values.reserve(query.length() + std::min<uint64_t>(bytes, Database::getInstance().getMaxPacketSize()));
+}
 
-	if (values.empty()) {
-		values.reserve(rowLength + 2);
-		values.push_back('(');
-		values.append(row);
-		values.push_back(')');
-	} else {
-		values.reserve(values.length() + rowLength + 3);
+void DBInsert::setUpsert(std::string_view assignments)
+{
+	upsert = " ON DUPLICATE KEY UPDATE ";
+	upsert.append(assignments);
+}
+
+void DBInsert::beginRow()
+{
+	rowStart = values.length();
+	if (hasRows()) {
 		values.push_back(',');
-		values.push_back('(');
-		values.append(row);
-		values.push_back(')');
+	}
+	values.push_back('(');
+	firstValue = true;
+}
+
+void DBInsert::addBlob(std::string_view value)
+{
+	addSeparator();
+	Database::getInstance().appendEscapedBlob(values, value.data(), value.length());
+}
+
+bool DBInsert::endRow()
+{
+	values.push_back(')');
+
+	if (holding) {
+		// the row without the separator and parentheses, so where the batches split does not matter
+		const size_t contentStart = rowStart + (rowStart > query.length() ? 2 : 1);
+		for (size_t i = contentStart, end = values.length() - 1; i < end; ++i) {
+			checksum = (checksum ^ static_cast<uint8_t>(values[i])) * 0x100000001B3ULL;
+		}
+		// rows may hold anything, the end of one must not read as part of the next
+		checksum = (checksum ^ (values.length() - 1 - contentStart)) * 0x100000001B3ULL;
+	}
+
+	if (values.length() + upsert.length() > Database::getInstance().getMaxPacketSize() && rowStart > query.length()) {
+		return splitBatch();
 	}
 	return true;
 }
 
+bool DBInsert::addRow(const std::string& row)
+{
+	beginRow();
+	values.append(row);
+	return endRow();
+}
+
 bool DBInsert::addRow(std::ostringstream& row)
 {
 	bool ret = addRow(row.str());
@@ -249,15 +572,58 @@ bool DBInsert::addRow(std::ostringstream& row)
 	return ret;
 }
 
+bool DBInsert::splitBatch()
+{
+	// the last row starts the next batch
+	std::string row = values.substr(rowStart + 1);
+	values.resize(rowStart);
+
+	bool success = true;
+	if (holding) {
+		values.append(upsert);
+		heldValues.push_back(std::move(values));
+	} else {
+		success = sendBatch(Database::getInstance());
+	}
+
+	values.clear();
+	values.reserve(query.length() + row.length());
+	values.append(query);
+	values.append(row);
+	return success;
+}
+
+bool DBInsert::sendBatch(Database& db)
+{
+	values.append(upsert);
+	const bool success = db.executeQuery(values);
+	values.resize(query.length());
+	return success;
+}
+
 bool DBInsert::execute()
 {
-	if (values.empty()) {
+	if (holding || !hasRows()) {
 		return true;
 	}
 
 	// executes buffer
-	bool res = Database::getInstance().executeQuery(query + values);
-	values.clear();
-	length = query.length();
-	return res;
+	return sendBatch(Database::getInstance());
+}
+
+bool DBInsert::release(Database& db)
+{
+	holding = false;
+
+	for (const std::string& batch : heldValues) {
+		if (!db.executeQuery(batch)) {
+			return false;
+		}
+	}
+	heldValues.clear();
+
+	if (!hasRows()) {
+		return true;
+	}
+	return sendBatch(db);
 }
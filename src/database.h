@@ -5,12 +5,42 @@
 #define FS_DATABASE_H
 
 #include "pugicast.h"
+#include "instancecounter.h"
 
+#include <fmt/format.h>
 #include <mysql/mysql.h>
+#include <gtl/phmap.hpp>
+#include <limits>
+#include <source_location>
 
 class DBResult;
 using DBResult_ptr = std::shared_ptr<DBResult>;
 
+// value of a ? placeholder in a prepared statement, it refers to the string it was
+// made of and must not outlive it
+class DBParam
+{
+	public:
+		template <std::integral T>
+		DBParam(T value) : integer(static_cast<uint64_t>(value)), type(std::is_signed_v<T> ? PARAM_SIGNED : PARAM_UNSIGNED) {}
+		DBParam(std::string_view value) : text(value), type(PARAM_TEXT) {}
+		DBParam(const std::string& value) : text(value), type(PARAM_TEXT) {}
+		DBParam(const char* value) : text(value), type(PARAM_TEXT) {}
+
+	private:
+		enum ParamType_t : uint8_t {
+			PARAM_SIGNED,
+			PARAM_UNSIGNED,
+			PARAM_TEXT,
+		};
+
+		std::string_view text;
+		uint64_t integer = 0;
+		ParamType_t type;
+
+	friend class Database;
+};
+
 class Database
 {
 	public:
@@ -43,11 +73,12 @@ class Database
 		 * Executes command.
 		 *
 		 * Executes query which doesn't generates results (eg. INSERT, UPDATE, DELETE...).
+		 * Every query is timed by g_queryStats under the site that sent it.
 		 *
 		 * @param query command
 		 * @return true on success, false on error
 		 */
-		bool executeQuery(const std::string& query);
+		bool executeQuery(const std::string& query, const std::source_location& location = std::source_location::current());
 
 		/**
 		 * Queries database.
@@ -56,7 +87,40 @@ class Database
 		 *
 		 * @return results object (nullptr on error)
 		 */
-		DBResult_ptr storeQuery(const std::string& query);
+		DBResult_ptr storeQuery(const std::string& query, const std::source_location& location = std::source_location::current());
+
+		/**
+		 * Executes a prepared statement.
+		 *
+		 * The statement is prepared on first use and kept for this connection.
+		 * Its ? placeholders are sent in binary form, escaping is not needed.
+		 *
+		 * @param query statement with ? placeholders
+		 * @param params values of the placeholders, in order
+		 * @return true on success, false on error
+		 */
+		bool executeStatement(std::string_view query, std::initializer_list<DBParam> params = {}, const std::source_location& location = std::source_location::current());
+
+		/**
+		 * Queries database with a prepared statement.
+		 *
+		 * @param query statement with ? placeholders
+		 * @param params values of the placeholders, in order
+		 * @return results object (nullptr on error or when there are no rows)
+		 */
+		DBResult_ptr storeStatement(std::string_view query, std::initializer_list<DBParam> params = {}, const std::source_location& location = std::source_location::current());
+
+		/**
+		 * Queries database without buffering the result.
+		 *
+		 * Rows are read from the server as they are walked instead of all at
+		 * once. The connection stays locked to the calling thread until the
+		 * result is freed and no other query may be sent on it meanwhile, so
+		 * walk the rows and release the result without querying in between.
+		 *
+		 * @return results object (nullptr on error or when there are no rows)
+		 */
+		DBResult_ptr useQuery(const std::string& query, const std::source_location& location = std::source_location::current());
 
 		/**
 		 * Escapes string for query.
@@ -79,6 +143,9 @@ class Database
 		 */
 		std::string escapeBlob(const char* s, uint32_t length) const;
 
+		// escapes and quotes s at the end of output
+		void appendEscapedBlob(std::string& output, const char* s, size_t length) const;
+
 		/**
 		 * Retrieve id of last inserted row
 		 *
@@ -113,47 +180,125 @@ class Database
 		bool rollback();
 		bool commit();
 
+		MYSQL_STMT* getStatement(std::string_view query, unsigned int& error);
+		// binds params and runs the statement, databaseLock must be held
+		MYSQL_STMT* runStatement(std::string_view query, std::initializer_list<DBParam> params);
+		void closeStatements();
+
 		MYSQL* handle = nullptr;
 		std::recursive_mutex databaseLock;
 		uint64_t maxPacketSize = 1048576;
+		gtl::flat_hash_map<std::string, MYSQL_STMT*> statements;
 
 	friend class DBTransaction;
 };
 
-class DBResult
+class DBResult : public InstanceCounter<DBResult>
 {
 	public:
 		explicit DBResult(MYSQL_RES* res);
+		// rows of a mysql_use_result, read from the connection one at a time
+		DBResult(MYSQL_RES* res, MYSQL* connection, std::recursive_mutex& lock);
+		// reads every row of an executed statement, the statement can run again afterwards
+		explicit DBResult(MYSQL_STMT* stmt);
 		~DBResult();
 
 		// non-copyable
 		DBResult(const DBResult&) = delete;
 		DBResult& operator=(const DBResult&) = delete;
 
+		static constexpr size_t INVALID_COLUMN = std::numeric_limits<size_t>::max();
+
+		// resolve the columns once before walking many rows, INVALID_COLUMN when missing
+		size_t getColumnIndex(std::string_view column) const
+		{
+			auto it = listNames.find(column);
+			return it != listNames.end() ? it->second : INVALID_COLUMN;
+		}
+
 		template<typename T>
 		T getNumber(std::string_view column) const
 		{
-			auto it = listNames.find(column);
-			if (it == listNames.end()) {
+			const size_t index = getColumnIndex(column);
+			if (index == INVALID_COLUMN) {
 				std::cout << "[Error - DBResult::getNumber] Column '" << column << "' doesn't exist in the result set" << std::endl;
+				return {};
+			}
+			return getNumber<T>(index);
+		}
+
+		template<typename T>
+		T getNumber(size_t index) const
+		{
+			if (index >= listNames.size()) {
+				return {};
 			}
 
-			if (row[it->second] == nullptr) {
+			if (!handle) {
+				return rows[current][index].get<T>();
+			}
+
+			if (row[index] == nullptr) {
 				return {};
 			}
 
-			return pugi::cast<T>(row[it->second]);
+			return pugi::cast<T>(row[index]);
 		}
 
 		std::string_view getString(std::string_view column) const;
+		std::string_view getString(size_t index) const;
 
 		bool hasNext() const;
 		bool next();
 
 	private:
+		// a column of a statement row, numbers stay in binary form
+		struct Field
+		{
+			enum FieldType_t : uint8_t {
+				FIELD_NULL,
+				FIELD_SIGNED,
+				FIELD_UNSIGNED,
+				FIELD_REAL,
+				FIELD_TEXT,
+			};
+
+			template<typename T>
+			T get() const
+			{
+				switch (type) {
+					case FIELD_SIGNED:
+						return static_cast<T>(static_cast<int64_t>(integer));
+					case FIELD_UNSIGNED:
+						return static_cast<T>(integer);
+					case FIELD_REAL:
+						return static_cast<T>(real);
+					case FIELD_TEXT:
+						return pugi::cast<T>(text.c_str());
+					default:
+						return {};
+				}
+			}
+
+			// numbers are only written out when asked for as text
+			mutable std::string text;
+			uint64_t integer = 0;
+			double real = 0;
+			FieldType_t type = FIELD_NULL;
+		};
+
+		// nullptr for statement results, which live in rows instead
 		MYSQL_RES* handle;
 		MYSQL_ROW row;
 
+		// the connection of a streamed result, locked until it is freed
+		MYSQL* streamHandle = nullptr;
+		std::recursive_mutex* streamLock = nullptr;
+
+		std::vector<std::string> names;
+		std::vector<std::vector<Field>> rows;
+		size_t current = 0;
+
 		std::map<std::string_view, size_t> listNames;
 
 	friend class Database;
@@ -170,20 +315,73 @@ class DBInsert
 		bool addRow(std::ostringstream& row);
 		bool execute();
 
+		// rows may also be written one value at a time, strings and blobs are
+		// escaped straight into the batch without a copy of their own
+		void beginRow();
+		template <std::integral T>
+		void addNumber(T value) {
+			addSeparator();
+			fmt::format_to(std::back_inserter(values), "{:d}", value);
+		}
+		void addBlob(std::string_view value);
+		bool endRow();
+
+		// room for about this many bytes of rows, a batch never grows past the packet size
+		void reserve(size_t bytes);
+
+		// makes it INSERT ... ON DUPLICATE KEY UPDATE assignments
+		void setUpsert(std::string_view assignments);
+
+		// keeps every row until release instead of sending them, so the caller
+		// can look at the checksum first and skip the insert entirely
+		void hold() {
+			holding = true;
+		}
+
+		// of the rows added while holding, in order
+		uint64_t getChecksum() const {
+			return checksum;
+		}
+
+		bool release(Database& db = Database::getInstance());
+
 	private:
+		void addSeparator() {
+			if (!firstValue) {
+				values.push_back(',');
+			}
+			firstValue = false;
+		}
+
+		bool hasRows() const {
+			return values.length() > query.length();
+		}
+
+		// ends the batch before the row that starts at rowStart
+		bool splitBatch();
+		bool sendBatch(Database& db);
+
 		std::string query;
+		std::string upsert;
+		// the query followed by the rows of the current batch
 		std::string values;
-		size_t length;
+		// full statements waiting for release
+		std::vector<std::string> heldValues;
+		size_t rowStart = 0;
+		// fnv-1a
+		uint64_t checksum = 0xCBF29CE484222325ULL;
+		bool firstValue = true;
+		bool holding = false;
 };
 
 class DBTransaction
 {
 	public:
-		constexpr DBTransaction() = default;
+		explicit DBTransaction(Database& db = Database::getInstance()) : db(db) {}
 
 		~DBTransaction() {
 			if (state == STATE_START) {
-				Database::getInstance().rollback();
+				db.rollback();
 			}
 		}
 
@@ -193,7 +391,7 @@ class DBTransaction
 
 		bool begin() {
 			state = STATE_START;
-			return Database::getInstance().beginTransaction();
+			return db.beginTransaction();
 		}
 
 		bool commit() {
@@ -202,7 +400,7 @@ class DBTransaction
 			}
 
 			state = STATE_COMMIT;
-			return Database::getInstance().commit();
+			return db.commit();
 		}
 
 	private:
@@ -212,6 +410,7 @@ class DBTransaction
 			STATE_COMMIT,
 		};
 
+		Database& db;
 		TransactionStates_t state = STATE_NO_START;
 };
 
@@ -4,85 +4,192 @@
 #include "otpch.h"
 
 #include "databasetasks.h"
+#include "querystats.h"
 #include "tasks.h"
+#include "threadrole.h"
+#include "tracing.h"
+
+#include <chrono>
 
 extern Dispatcher g_dispatcher;
 
-void DatabaseTasks::start()
+static int64_t getMicroseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void DatabaseTasks::start(size_t workerCount/* = 1*/)
 {
-	db.connect();
-	ThreadHolder::start();
+	workerCount = std::max<size_t>(1, workerCount);
+
+	// connect before any worker runs, start never races with the tasks
+	for (size_t i = 0; i < workerCount; ++i) {
+		auto& db = connections.emplace_back(std::make_unique<Database>());
+		if (!db->connect()) {
+			connections.pop_back();
+			break;
+		}
+	}
+
+	if (connections.empty()) {
+		std::cout << "[Warning - DatabaseTasks::start] No worker could connect to the database." << std::endl;
+		return;
+	}
+
+	state = THREAD_STATE_RUNNING;
+	stats.workers = connections.size();
+	for (auto& db : connections) {
+		threads.emplace_back(&DatabaseTasks::threadMain, this, std::ref(*db));
+	}
 }
 
-void DatabaseTasks::threadMain()
+void DatabaseTasks::stop()
 {
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
-	while (getState() != THREAD_STATE_TERMINATED) {
-		taskLockUnique.lock();
+	std::lock_guard<std::mutex> lockGuard(taskLock);
+	if (state == THREAD_STATE_RUNNING) {
+		state = THREAD_STATE_CLOSING;
+	}
+}
+
+void DatabaseTasks::threadMain(Database& db)
+{
+	setThreadRole("database");
+	QueryStats::setWorkerThread();
+	std::unique_lock<std::mutex> lockGuard(taskLock);
+	while (true) {
+		taskSignal.wait(lockGuard, [this]() { return state == THREAD_STATE_TERMINATED || !tasks.empty(); });
 		if (tasks.empty()) {
-			taskSignal.wait(taskLockUnique);
+			// terminated and nothing left to run
+			return;
 		}
 
-		if (!tasks.empty()) {
-			DatabaseTask task = std::move(tasks.front());
-			tasks.pop_front();
-			taskLockUnique.unlock();
-			runTask(task);
-		} else {
-			taskLockUnique.unlock();
+		DatabaseTask task = std::move(tasks.front());
+		tasks.pop_front();
+		lockGuard.unlock();
+
+		const int64_t started = getMicroseconds();
+		runTask(db, task);
+		const int64_t finished = getMicroseconds();
+
+		lockGuard.lock();
+		++stats.completed;
+		stats.totalWait += started - task.queued;
+		stats.totalRun += finished - started;
+		stats.maxRun = std::max(stats.maxRun, finished - started);
+
+		if (task.key != 0) {
+			// the next task of the key, if any, is free to run now
+			auto it = heldTasks.find(task.key);
+			if (it->second.empty()) {
+				heldTasks.erase(it);
+			} else {
+				tasks.push_back(std::move(it->second.front()));
+				it->second.pop_front();
+				taskSignal.notify_one();
+			}
+		}
+
+		if (--pending == 0) {
+			idleSignal.notify_all();
 		}
 	}
 }
 
-void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/)
+bool DatabaseTasks::enqueue(DatabaseTask&& task)
 {
-	bool signal = false;
-	taskLock.lock();
-	if (getState() == THREAD_STATE_RUNNING) {
-		signal = tasks.empty();
-		tasks.emplace_back(std::move(query), std::move(callback), store);
+	{
+		std::lock_guard<std::mutex> lockGuard(taskLock);
+		if (state != THREAD_STATE_RUNNING) {
+			return false;
+		}
+
+		task.queued = getMicroseconds();
+		stats.maxQueued = std::max(stats.maxQueued, ++pending);
+
+		if (task.key != 0) {
+			auto it = heldTasks.find(task.key);
+			if (it != heldTasks.end()) {
+				it->second.push_back(std::move(task));
+				return true;
+			}
+			heldTasks.emplace(task.key, std::deque<DatabaseTask>());
+		}
+		tasks.push_back(std::move(task));
 	}
-	taskLock.unlock();
+	taskSignal.notify_one();
+	return true;
+}
 
-	if (signal) {
-		taskSignal.notify_one();
+void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/, uint64_t key/* = 0*/, const std::source_location& location/* = std::source_location::current()*/)
+{
+	DatabaseTask task(std::move(query), std::move(callback), store, key);
+	task.location = location;
+	enqueue(std::move(task));
+}
+
+bool DatabaseTasks::addJob(std::function<bool(Database&)> job, std::function<void(bool)> callback/* = nullptr*/, uint64_t key/* = 0*/, DispatcherLane_t lane/* = DISPATCHER_LANE_BACKGROUND*/)
+{
+	std::function<void(DBResult_ptr, bool)> taskCallback;
+	if (callback) {
+		taskCallback = [callback = std::move(callback)](DBResult_ptr, bool success) { callback(success); };
 	}
+
+	DatabaseTask task(std::move(job), std::move(taskCallback), key);
+	task.lane = lane;
+	return enqueue(std::move(task));
 }
 
-void DatabaseTasks::runTask(const DatabaseTask& task)
+void DatabaseTasks::runTask(Database& db, const DatabaseTask& task)
 {
+	TraceScope trace(task.job ? "job" : task.store ? "store query" : "execute query", "database");
 	bool success;
 	DBResult_ptr result;
-	if (task.store) {
-		result = db.storeQuery(task.query);
+	if (task.job) {
+		result = nullptr;
+		success = task.job(db);
+	} else if (task.store) {
+		result = db.storeQuery(task.query, task.location);
 		success = true;
 	} else {
 		result = nullptr;
-		success = db.executeQuery(task.query);
+		success = db.executeQuery(task.query, task.location);
 	}
 
 	if (task.callback) {
-		g_dispatcher.addTask(createTask([=, callback = task.callback]() { callback(result, success); }));
+		g_dispatcher.addTask(createTask([=, callback = task.callback]() { callback(result, success); }, task.lane));
 	}
 }
 
 void DatabaseTasks::flush()
 {
-	std::unique_lock<std::mutex> guard{ taskLock };
-	while (!tasks.empty()) {
-		auto task = std::move(tasks.front());
-		tasks.pop_front();
-		guard.unlock();
-		runTask(task);
-		guard.lock();
-	}
+	std::unique_lock<std::mutex> lockGuard(taskLock);
+	idleSignal.wait(lockGuard, [this]() { return pending == 0 || threads.empty(); });
 }
 
 void DatabaseTasks::shutdown()
 {
-	taskLock.lock();
-	setState(THREAD_STATE_TERMINATED);
-	taskLock.unlock();
+	{
+		std::lock_guard<std::mutex> lockGuard(taskLock);
+		state = THREAD_STATE_TERMINATED;
+	}
+	// the workers run what is left before they leave
+	taskSignal.notify_all();
 	flush();
-	taskSignal.notify_one();
+}
+
+void DatabaseTasks::join()
+{
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+}
+
+DatabaseTasks::Stats DatabaseTasks::getStats() const
+{
+	std::lock_guard<std::mutex> lockGuard(taskLock);
+	Stats current = stats;
+	current.queued = pending;
+	return current;
 }
@@ -5,38 +5,82 @@
 #define FS_DATABASETASKS_H
 
 #include <condition_variable>
-#include "thread_holder_base.h"
+#include <deque>
+#include <gtl/phmap.hpp>
 #include "database.h"
 #include "enums.h"
+#include "tasks.h"
 
 struct DatabaseTask {
-	DatabaseTask(std::string&& query, std::function<void(DBResult_ptr, bool)>&& callback, bool store) :
-		query(std::move(query)), callback(std::move(callback)), store(store) {}
+	DatabaseTask(std::string&& query, std::function<void(DBResult_ptr, bool)>&& callback, bool store, uint64_t key) :
+		query(std::move(query)), callback(std::move(callback)), key(key), store(store) {}
+	DatabaseTask(std::function<bool(Database&)>&& job, std::function<void(DBResult_ptr, bool)>&& callback, uint64_t key) :
+		job(std::move(job)), callback(std::move(callback)), key(key), store(false) {}
 
 	std::string query;
+	// runs instead of query when set, for work that takes more than one statement
+	std::function<bool(Database&)> job;
 	std::function<void(DBResult_ptr, bool)> callback;
+	int64_t queued = 0;
+	// tasks sharing a key other than 0 run one after another in the order they were added
+	uint64_t key;
+	// where the callback is queued on the dispatcher
+	DispatcherLane_t lane = DISPATCHER_LANE_BACKGROUND;
+	// where the task was added, its query is timed under it
+	std::source_location location;
 	bool store;
 };
 
-class DatabaseTasks : public ThreadHolder<DatabaseTasks>
+// Runs queries off the game thread on a number of workers, each with its own
+// connection. Tasks without a key may run in any order and at the same time,
+// tasks with the same key never overlap and keep their order.
+class DatabaseTasks
 {
 	public:
+		struct Stats
+		{
+			size_t workers = 0;
+			// tasks waiting, including the ones held back behind their key
+			size_t queued = 0;
+			size_t maxQueued = 0;
+			uint64_t completed = 0;
+			// microseconds
+			int64_t totalWait = 0;
+			int64_t totalRun = 0;
+			int64_t maxRun = 0;
+		};
+
 		DatabaseTasks() = default;
-		void start();
+		void start(size_t workerCount = 1);
+		void stop();
+		// waits until every task added so far has run
 		void flush();
 		void shutdown();
+		void join();
+
+		void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false, uint64_t key = 0, const std::source_location& location = std::source_location::current());
+		// false when the workers are not running and the job was not queued
+		bool addJob(std::function<bool(Database&)> job, std::function<void(bool)> callback = nullptr, uint64_t key = 0, DispatcherLane_t lane = DISPATCHER_LANE_BACKGROUND);
 
-		void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false);
+		Stats getStats() const;
 
-		void threadMain();
 	private:
-		void runTask(const DatabaseTask& task);
+		bool enqueue(DatabaseTask&& task);
+		void threadMain(Database& db);
+		void runTask(Database& db, const DatabaseTask& task);
 
-		Database db;
-		std::thread thread;
-		std::list<DatabaseTask> tasks;
-		std::mutex taskLock;
+		std::vector<std::unique_ptr<Database>> connections;
+		std::vector<std::thread> threads;
+		std::deque<DatabaseTask> tasks;
+		// keys with a task queued or running, and the tasks waiting for it
+		gtl::flat_hash_map<uint64_t, std::deque<DatabaseTask>> heldTasks;
+		mutable std::mutex taskLock;
 		std::condition_variable taskSignal;
+		std::condition_variable idleSignal;
+		ThreadState state = THREAD_STATE_TERMINATED;
+		// queued, held and running tasks
+		size_t pending = 0;
+		Stats stats;
 };
 
 extern DatabaseTasks g_databaseTasks;
@@ -0,0 +1,65 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "decaywheel.h"
+
+void DecayWheel::add(const ItemPtr& item, int64_t expiry)
+{
+	// the current tick already fired, overdue items go to the next one
+	insert({item, expiry}, currentTick + 1);
+}
+
+void DecayWheel::insert(Entry&& entry, uint64_t minTick)
+{
+	const uint64_t tick = std::max(getTick(entry.expiry), minTick);
+	const uint64_t delta = tick - currentTick;
+
+	size_t level = 0;
+	while (level < DECAY_WHEEL_LEVELS - 1 && delta >= (uint64_t(1) << (DECAY_WHEEL_SLOT_BITS * (level + 1)))) {
+		++level;
+	}
+
+	// beyond the top level, park it in the furthest slot and let it cascade again
+	const uint64_t placed = std::min(tick, currentTick + (uint64_t(1) << (DECAY_WHEEL_SLOT_BITS * DECAY_WHEEL_LEVELS)) - 1);
+	const size_t slot = (placed >> (DECAY_WHEEL_SLOT_BITS * level)) & (DECAY_WHEEL_SLOTS - 1);
+
+	levels[level][slot].push_back(std::move(entry));
+	++levelSizes[level];
+}
+
+void DecayWheel::cascade(size_t level)
+{
+	auto& slot = levels[level][(currentTick >> (DECAY_WHEEL_SLOT_BITS * level)) & (DECAY_WHEEL_SLOTS - 1)];
+	levelSizes[level] -= slot.size();
+
+	std::vector<Entry> entries;
+	entries.swap(slot);
+	for (Entry& entry : entries) {
+		insert(std::move(entry), currentTick);
+	}
+}
+
+void DecayWheel::advance(int64_t now, std::vector<Entry>& expired)
+{
+	// last tick whose time has fully arrived
+	const uint64_t nowTick = now <= epoch ? 0 : (now - epoch) / DECAY_WHEEL_RESOLUTION;
+	while (currentTick < nowTick) {
+		++currentTick;
+
+		// entering a new block of a level, spread its slot over the levels below
+		for (size_t level = DECAY_WHEEL_LEVELS - 1; level > 0; --level) {
+			if ((currentTick & ((uint64_t(1) << (DECAY_WHEEL_SLOT_BITS * level)) - 1)) == 0) {
+				cascade(level);
+			}
+		}
+
+		auto& slot = levels[0][currentTick & (DECAY_WHEEL_SLOTS - 1)];
+		levelSizes[0] -= slot.size();
+		for (Entry& entry : slot) {
+			expired.push_back(std::move(entry));
+		}
+		slot.clear();
+	}
+}
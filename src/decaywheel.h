@@ -0,0 +1,67 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_DECAYWHEEL_H
+#define FS_DECAYWHEEL_H
+
+#include "declarations.h"
+
+#include <array>
+
+// ticks of DECAY_WHEEL_RESOLUTION ms, every level is DECAY_WHEEL_SLOTS times
+// coarser than the one below, together they span ~48 days
+static constexpr int64_t DECAY_WHEEL_RESOLUTION = 250;
+static constexpr size_t DECAY_WHEEL_LEVELS = 4;
+static constexpr size_t DECAY_WHEEL_SLOT_BITS = 6;
+static constexpr size_t DECAY_WHEEL_SLOTS = 1 << DECAY_WHEEL_SLOT_BITS;
+
+// Hierarchical timing wheel keyed by absolute expiry, an item is only looked
+// at again when its level is cascaded or it actually expires
+class DecayWheel
+{
+	public:
+		struct Entry
+		{
+			ItemPtr item;
+			int64_t expiry;
+		};
+
+		explicit DecayWheel(int64_t epoch) : epoch(epoch) {}
+
+		// expiry is an OTSYS_TIME() timestamp
+		void add(const ItemPtr& item, int64_t expiry);
+
+		// moves every entry that is due at now into expired, stale entries
+		// (items rescheduled or stopped meanwhile) are left for the caller to skip
+		void advance(int64_t now, std::vector<Entry>& expired);
+
+		size_t size() const {
+			size_t total = 0;
+			for (size_t count : levelSizes) {
+				total += count;
+			}
+			return total;
+		}
+
+		const std::array<size_t, DECAY_WHEEL_LEVELS>& getLevelSizes() const {
+			return levelSizes;
+		}
+
+	private:
+		uint64_t getTick(int64_t time) const {
+			// rounded up, an entry never fires before its expiry
+			return time <= epoch ? 0 : (time - epoch + DECAY_WHEEL_RESOLUTION - 1) / DECAY_WHEEL_RESOLUTION;
+		}
+
+		void insert(Entry&& entry, uint64_t minTick);
+		void cascade(size_t level);
+
+		std::array<std::array<std::vector<Entry>, DECAY_WHEEL_SLOTS>, DECAY_WHEEL_LEVELS> levels;
+		std::array<size_t, DECAY_WHEEL_LEVELS> levelSizes{};
+
+		int64_t epoch;
+		// last tick that was processed
+		uint64_t currentTick = 0;
+};
+
+#endif
@@ -0,0 +1,104 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "deflatestream.h"
+#include "configmanager.h"
+#include "outputmessage.h"
+
+extern ConfigManager g_config;
+
+namespace {
+
+// compression may use this many nanoseconds per second of all network threads
+constexpr int64_t DEFLATE_TIME_BUDGET = 50'000'000;
+constexpr int64_t DEFLATE_LOAD_INTERVAL = 1'000'000'000;
+
+std::atomic<int> currentLevel{-1};
+std::atomic<int64_t> spentTime{0};
+std::atomic<int64_t> intervalStart{0};
+
+int64_t getSteadyTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+DeflateStream::DeflateStream() : level(getLevel())
+{
+	initialized = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+DeflateStream::~DeflateStream()
+{
+	if (initialized) {
+		deflateEnd(&stream);
+	}
+}
+
+int DeflateStream::getLevel()
+{
+	const int maxLevel = std::clamp<int>(g_config.getNumber(ConfigManager::PACKET_COMPRESSION_LEVEL), 1, 9);
+	int level = currentLevel.load(std::memory_order_relaxed);
+	if (level < 0 || level > maxLevel) {
+		level = maxLevel;
+		currentLevel.store(level, std::memory_order_relaxed);
+	}
+	return level;
+}
+
+void DeflateStream::addTime(int64_t time)
+{
+	spentTime.fetch_add(time, std::memory_order_relaxed);
+
+	const int64_t now = getSteadyTime();
+	int64_t start = intervalStart.load(std::memory_order_relaxed);
+	if (now - start < DEFLATE_LOAD_INTERVAL || !intervalStart.compare_exchange_strong(start, now)) {
+		return;
+	}
+
+	// one thread per interval gets here and moves the level a step
+	const int64_t spent = spentTime.exchange(0, std::memory_order_relaxed);
+	const int level = getLevel();
+	if (spent > DEFLATE_TIME_BUDGET && level > 1) {
+		currentLevel.store(level - 1, std::memory_order_relaxed);
+	} else if (spent < DEFLATE_TIME_BUDGET / 4) {
+		currentLevel.store(level + 1, std::memory_order_relaxed);
+	}
+}
+
+void DeflateStream::compress(OutputMessage& msg)
+{
+	uint8_t* payload = msg.getOutputBuffer();
+	const size_t length = msg.getLength();
+
+	// the flag byte and what follows it, leaving room for the xtea padding
+	const size_t space = NetworkMessage::MAX_BODY_LENGTH - 8;
+	if (!initialized || length < DEFLATE_MIN_LENGTH || deflateBound(&stream, length) + 16 >= space) {
+		std::memmove(payload + 1, payload, length);
+		payload[0] = 0;
+		msg.setPayloadLength(length + 1);
+		return;
+	}
+
+	const int64_t startTime = getSteadyTime();
+	if (const int wantedLevel = getLevel(); wantedLevel != level && deflateParams(&stream, wantedLevel, Z_DEFAULT_STRATEGY) == Z_OK) {
+		level = wantedLevel;
+	}
+
+	// the compressed bytes overwrite the payload, so it is read from a copy
+	thread_local std::vector<uint8_t> input;
+	input.assign(payload, payload + length);
+
+	stream.next_in = input.data();
+	stream.avail_in = length;
+	stream.next_out = payload + 1;
+	stream.avail_out = space - 1;
+	deflate(&stream, Z_SYNC_FLUSH);
+
+	payload[0] = 1;
+	msg.setPayloadLength(space - stream.avail_out);
+	addTime(getSteadyTime() - startTime);
+}
@@ -0,0 +1,41 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_DEFLATESTREAM_H
+#define FS_DEFLATESTREAM_H
+
+#include <zlib.h>
+
+class OutputMessage;
+
+// messages shorter than this are not worth the flush bytes and go out as they are
+static constexpr size_t DEFLATE_MIN_LENGTH = 64;
+
+// Per connection raw deflate stream over the game messages of a client that
+// asked for it. Every message gets a leading byte, 1 if its payload went
+// through the stream and 0 if it did not, so the client only inflates the
+// marked ones and both stream states stay in step. Each compressed message
+// is flushed on its own, the dictionary carries over to the next one.
+class DeflateStream
+{
+	public:
+		DeflateStream();
+		~DeflateStream();
+
+		// non-copyable
+		DeflateStream(const DeflateStream&) = delete;
+		DeflateStream& operator=(const DeflateStream&) = delete;
+
+		void compress(OutputMessage& msg);
+
+	private:
+		// shared by all streams, lowered while compressing takes too long
+		static int getLevel();
+		static void addTime(int64_t time);
+
+		z_stream stream{};
+		int level;
+		bool initialized = false;
+};
+
+#endif
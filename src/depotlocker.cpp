@@ -45,4 +45,5 @@ void DepotLocker::removeInbox(const InboxPtr& inbox)
 		return;
 	}
 	itemlist.erase(cit);
+	invalidatePageEncodings();
 }
@@ -83,6 +83,7 @@ enum itemAttrTypes : uint32_t {
 	ITEM_ATTRIBUTE_CLASSIFICATION = 1 << 27,
 	ITEM_ATTRIBUTE_TIER = 1 << 28,
 	ITEM_ATTRIBUTE_REWARDID = 1 << 29,
+	ITEM_ATTRIBUTE_DURATION_TIMESTAMP = 1 << 30, // runtime only, expiry of an item in the decay wheel
 
 	ITEM_ATTRIBUTE_CUSTOM = 1U << 31
 };
@@ -629,7 +630,22 @@ struct CombatDamage
 
 using MarketOfferList = std::list<MarketOffer>;
 using HistoryMarketOfferList = std::list<HistoryMarketOffer>;
-using ShopInfoList = std::list<ShopInfo>;
+using ShopInfoList = std::vector<ShopInfo>;
+
+// parts of a player saved to their own tables, see IOLoginData::savePlayer
+enum PlayerSaveSection_t : uint8_t {
+	PLAYER_SAVE_SPELLS,
+	PLAYER_SAVE_ITEMS,
+	PLAYER_SAVE_DEPOT_ITEMS,
+	PLAYER_SAVE_REWARD_ITEMS,
+	PLAYER_SAVE_INBOX_ITEMS,
+	PLAYER_SAVE_STORE_INBOX_ITEMS,
+	PLAYER_SAVE_STORAGE,
+	PLAYER_SAVE_AUGMENTS,
+	PLAYER_SAVE_CUSTOM_SKILLS,
+
+	PLAYER_SAVE_LAST
+};
 
 enum MonstersEvent_t : uint8_t {
 	MONSTERS_EVENT_NONE = 0,
@@ -7,9 +7,83 @@
 #include "tools.h"
 #include "item.h"
 #include "player.h"
+#include "monster.h"
 
 #include <set>
 
+namespace {
+
+template<typename T>
+void pushEventArgument(lua_State* L, const T& value)
+{
+	if constexpr (std::is_same_v<T, bool>) {
+		LuaScriptInterface::pushBoolean(L, value);
+	} else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+		lua_pushinteger(L, value);
+	} else if constexpr (std::is_same_v<T, std::string>) {
+		LuaScriptInterface::pushString(L, value);
+	} else if constexpr (std::is_same_v<T, Position>) {
+		LuaScriptInterface::pushPosition(L, value);
+	} else if constexpr (std::is_same_v<T, Outfit_t>) {
+		LuaScriptInterface::pushOutfit(L, value);
+	} else if constexpr (std::is_same_v<T, Party*>) {
+		LuaScriptInterface::pushUserdata<Party>(L, value);
+		LuaScriptInterface::setMetatable(L, -1, "Party");
+	} else {
+		using Type = typename T::element_type;
+		if (!value) {
+			lua_pushnil(L);
+		} else if constexpr (std::is_base_of_v<Creature, Type>) {
+			LuaScriptInterface::pushCreature(L, value);
+		} else if constexpr (std::is_base_of_v<Item, Type>) {
+			LuaScriptInterface::pushItem(L, value);
+		} else {
+			static_assert(std::is_same_v<Type, Cylinder>, "no way to push this event argument");
+			LuaScriptInterface::pushCylinder(L, value);
+		}
+	}
+}
+
+}
+
+template<typename... Args>
+bool Events::callEvent(int32_t scriptId, const char* eventName, const Args&... args)
+{
+	if (!scriptInterface.reserveScriptEnv()) {
+		std::cout << "[Error - Events::" << eventName << "] Call stack overflow" << std::endl;
+		return false;
+	}
+
+	ScriptEnvironment* env = scriptInterface.getScriptEnv();
+	env->setScriptId(scriptId, &scriptInterface);
+
+	lua_State* L = scriptInterface.getLuaState();
+	scriptInterface.pushFunction(scriptId);
+
+	(pushEventArgument(L, args), ...);
+
+	return scriptInterface.callFunction(sizeof...(Args));
+}
+
+template<typename... Args>
+void Events::callVoidEvent(int32_t scriptId, const char* eventName, const Args&... args)
+{
+	if (!scriptInterface.reserveScriptEnv()) {
+		std::cout << "[Error - Events::" << eventName << "] Call stack overflow" << std::endl;
+		return;
+	}
+
+	ScriptEnvironment* env = scriptInterface.getScriptEnv();
+	env->setScriptId(scriptId, &scriptInterface);
+
+	lua_State* L = scriptInterface.getLuaState();
+	scriptInterface.pushFunction(scriptId);
+
+	(pushEventArgument(L, args), ...);
+
+	scriptInterface.callVoidFunction(sizeof...(Args));
+}
+
 Events::Events() :
 	scriptInterface("Event Interface")
 {
@@ -166,24 +240,7 @@ bool Events::eventMonsterOnSpawn(const MonsterPtr& monster, const Position& posi
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::monsterOnSpawn] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.monsterOnSpawn, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.monsterOnSpawn);
-
-	LuaScriptInterface::pushSharedPtr(L, monster);
-	LuaScriptInterface::setMetatable(L, -1, "Monster");
-	LuaScriptInterface::pushPosition(L, position);
-	LuaScriptInterface::pushBoolean(L, startup);
-	LuaScriptInterface::pushBoolean(L, artificial);
-
-	return scriptInterface.callFunction(4);
+	return callEvent(info.monsterOnSpawn, "eventMonsterOnSpawn", monster, position, startup, artificial);
 }
 
 // Creature
@@ -194,23 +251,7 @@ bool Events::eventCreatureOnChangeOutfit(const CreaturePtr& creature, const Outf
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventCreatureOnChangeOutfit] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnChangeOutfit, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnChangeOutfit);
-
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
-
-	LuaScriptInterface::pushOutfit(L, outfit);
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.creatureOnChangeOutfit, "eventCreatureOnChangeOutfit", creature, outfit);
 }
 
 ReturnValue Events::eventCreatureOnAreaCombat(const CreaturePtr& creature, const TilePtr& tile, bool aggressive)
@@ -232,14 +273,12 @@ ReturnValue Events::eventCreatureOnAreaCombat(const CreaturePtr& creature, const
 	scriptInterface.pushFunction(info.creatureOnAreaCombat);
 
 	if (creature) {
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 	} else {
 		lua_pushnil(L);
 	}
 
-	LuaScriptInterface::pushSharedPtr(L, tile);
-	LuaScriptInterface::setMetatable(L, -1, "Tile");
+	LuaScriptInterface::pushSharedPtr(L, tile, LuaData_Tile);
 
 	LuaScriptInterface::pushBoolean(L, aggressive);
 
@@ -275,14 +314,12 @@ ReturnValue Events::eventCreatureOnTargetCombat(const CreaturePtr& creature, con
 	scriptInterface.pushFunction(info.creatureOnTargetCombat);
 
 	if (creature) {
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 	} else {
 		lua_pushnil(L);
 	}
 
-	LuaScriptInterface::pushSharedPtr(L, target);
-	LuaScriptInterface::setCreatureMetatable(L, -1, target);
+	LuaScriptInterface::pushCreature(L, target);
 
 	ReturnValue returnValue;
 	if (scriptInterface.protectedCall(L, 2, 1) != 0) {
@@ -304,27 +341,7 @@ void Events::eventCreatureOnHear(const CreaturePtr& creature, const CreaturePtr&
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventCreatureOnHear] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnHear, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnHear);
-
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
-
-	LuaScriptInterface::pushSharedPtr(L, speaker);
-	LuaScriptInterface::setCreatureMetatable(L, -1, speaker);
-
-	LuaScriptInterface::pushString(L, words);
-	lua_pushinteger(L, type);
-
-	scriptInterface.callVoidFunction(4);
+	callVoidEvent(info.creatureOnHear, "eventCreatureOnHear", creature, speaker, words, type);
 }
 
 void Events::eventCreatureOnAttack(const CreaturePtr& attacker, const CreaturePtr& target, BlockType_t blockType, CombatType_t combatType, CombatOrigin origin, bool criticalDamage, bool leechedDamage)
@@ -334,31 +351,7 @@ void Events::eventCreatureOnAttack(const CreaturePtr& attacker, const CreaturePt
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventCreatureOnAttack] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnAttack, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnAttack);
-
-	LuaScriptInterface::pushSharedPtr(L, attacker);
-	LuaScriptInterface::setCreatureMetatable(L, -1, attacker);
-
-	LuaScriptInterface::pushSharedPtr(L, target);
-	LuaScriptInterface::setCreatureMetatable(L, -1, target);
-
-	lua_pushinteger(L, static_cast<uint8_t>(blockType));
-	lua_pushinteger(L, static_cast<uint8_t>(combatType));
-	lua_pushinteger(L, static_cast<uint8_t>(origin));
-
-	lua_pushboolean(L, criticalDamage);
-	lua_pushboolean(L, leechedDamage);
-
-	scriptInterface.callVoidFunction(7);
+	callVoidEvent(info.creatureOnAttack, "eventCreatureOnAttack", attacker, target, blockType, combatType, origin, criticalDamage, leechedDamage);
 }
 
 void Events::eventCreatureOnDefend(const CreaturePtr& defender, const CreaturePtr& attacker, BlockType_t blockType, CombatType_t combatType, CombatOrigin origin, bool criticalDamage, bool leechedDamage)
@@ -368,31 +361,7 @@ void Events::eventCreatureOnDefend(const CreaturePtr& defender, const CreaturePt
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventCreatureOnDefend] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.creatureOnDefend, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.creatureOnDefend);
-
-	LuaScriptInterface::pushSharedPtr(L, defender);
-	LuaScriptInterface::setCreatureMetatable(L, -1, defender);
-
-	LuaScriptInterface::pushSharedPtr(L, attacker);
-	LuaScriptInterface::setCreatureMetatable(L, -1, attacker);
-
-	lua_pushinteger(L, static_cast<uint8_t>(blockType));
-	lua_pushinteger(L, static_cast<uint8_t>(combatType));
-	lua_pushinteger(L, static_cast<uint8_t>(origin));
-
-	lua_pushboolean(L, criticalDamage);
-	lua_pushboolean(L, leechedDamage);
-
-	scriptInterface.callVoidFunction(7);
+	callVoidEvent(info.creatureOnDefend, "eventCreatureOnDefend", defender, attacker, blockType, combatType, origin, criticalDamage, leechedDamage);
 }
 
 // Party
@@ -403,24 +372,7 @@ bool Events::eventPartyOnJoin(Party* party, const PlayerPtr& player)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPartyOnJoin] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnJoin, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnJoin);
-
-	LuaScriptInterface::pushUserdata<Party>(L, party);
-	LuaScriptInterface::setMetatable(L, -1, "Party");
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.partyOnJoin, "eventPartyOnJoin", party, player);
 }
 
 bool Events::eventPartyOnLeave(Party* party, const PlayerPtr& player)
@@ -430,24 +382,7 @@ bool Events::eventPartyOnLeave(Party* party, const PlayerPtr& player)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPartyOnLeave] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnLeave, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnLeave);
-
-	LuaScriptInterface::pushUserdata<Party>(L, party);
-	LuaScriptInterface::setMetatable(L, -1, "Party");
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.partyOnLeave, "eventPartyOnLeave", party, player);
 }
 
 bool Events::eventPartyOnDisband(Party* party)
@@ -457,21 +392,7 @@ bool Events::eventPartyOnDisband(Party* party)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPartyOnDisband] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnDisband, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnDisband);
-
-	LuaScriptInterface::pushUserdata<Party>(L, party);
-	LuaScriptInterface::setMetatable(L, -1, "Party");
-
-	return scriptInterface.callFunction(1);
+	return callEvent(info.partyOnDisband, "eventPartyOnDisband", party);
 }
 
 void Events::eventPartyOnShareExperience(Party* party, uint64_t& exp)
@@ -514,24 +435,7 @@ bool Events::eventPartyOnInvite(Party* party, const PlayerPtr& player)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPartyOnInvite] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnInvite, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnInvite);
-
-	LuaScriptInterface::pushUserdata<Party>(L, party);
-	LuaScriptInterface::setMetatable(L, -1, "Party");
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.partyOnInvite, "eventPartyOnInvite", party, player);
 }
 
 bool Events::eventPartyOnRevokeInvitation(Party* party, const PlayerPtr& player)
@@ -541,24 +445,7 @@ bool Events::eventPartyOnRevokeInvitation(Party* party, const PlayerPtr& player)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPartyOnRevokeInvitation] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnRevokeInvitation, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnRevokeInvitation);
-
-	LuaScriptInterface::pushUserdata<Party>(L, party);
-	LuaScriptInterface::setMetatable(L, -1, "Party");
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.partyOnRevokeInvitation, "eventPartyOnRevokeInvitation", party, player);
 }
 
 bool Events::eventPartyOnPassLeadership(Party* party, const PlayerPtr& player)
@@ -568,24 +455,7 @@ bool Events::eventPartyOnPassLeadership(Party* party, const PlayerPtr& player)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPartyOnPassLeadership] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.partyOnPassLeadership, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.partyOnPassLeadership);
-
-	LuaScriptInterface::pushUserdata<Party>(L, party);
-	LuaScriptInterface::setMetatable(L, -1, "Party");
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.partyOnPassLeadership, "eventPartyOnPassLeadership", party, player);
 }
 
 // Player
@@ -596,23 +466,7 @@ bool Events::eventPlayerOnBrowseField(const PlayerPtr& player, const Position& p
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnBrowseField] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnBrowseField, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnBrowseField);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushPosition(L, position);
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.playerOnBrowseField, "eventPlayerOnBrowseField", player, position);
 }
 
 void Events::eventPlayerOnLook(const PlayerPtr& player, const Position& position, const ThingPtr& thing, uint8_t stackpos, int32_t lookDistance)
@@ -633,15 +487,12 @@ void Events::eventPlayerOnLook(const PlayerPtr& player, const Position& position
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnLook);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	if (auto creature = thing->getCreature()) {
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 	} else if (auto item = thing->getItem()) {
-		LuaScriptInterface::pushSharedPtr(L, item);
-		LuaScriptInterface::setItemMetatable(L, -1, item);
+		LuaScriptInterface::pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -659,26 +510,7 @@ void Events::eventPlayerOnLookInBattleList(const PlayerPtr& player, const Creatu
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnLookInBattleList] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInBattleList, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInBattleList);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
-
-	lua_pushinteger(L, lookDistance);
-
-	scriptInterface.callVoidFunction(3);
+	callVoidEvent(info.playerOnLookInBattleList, "eventPlayerOnLookInBattleList", player, creature, lookDistance);
 }
 
 void Events::eventPlayerOnLookInTrade(const PlayerPtr& player, const PlayerPtr& partner, const ItemPtr& item, int32_t lookDistance)
@@ -688,29 +520,7 @@ void Events::eventPlayerOnLookInTrade(const PlayerPtr& player, const PlayerPtr&
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnLookInTrade] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnLookInTrade, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnLookInTrade);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, partner);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	lua_pushinteger(L, lookDistance);
-
-	scriptInterface.callVoidFunction(4);
+	callVoidEvent(info.playerOnLookInTrade, "eventPlayerOnLookInTrade", player, partner, item, lookDistance);
 }
 
 bool Events::eventPlayerOnLookInShop(const PlayerPtr& player, const ItemType* itemType, uint8_t count, const std::string& description)
@@ -731,8 +541,7 @@ bool Events::eventPlayerOnLookInShop(const PlayerPtr& player, const ItemType* it
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnLookInShop);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushUserdata<const ItemType>(L, itemType);
 	LuaScriptInterface::setMetatable(L, -1, "ItemType");
@@ -761,11 +570,9 @@ ReturnValue Events::eventPlayerOnMoveItem(const PlayerPtr& player, const ItemPtr
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnMoveItem);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
+	LuaScriptInterface::pushItem(L, item);
 
 	lua_pushinteger(L, count);
 	LuaScriptInterface::pushPosition(L, fromPosition);
@@ -794,31 +601,7 @@ void Events::eventPlayerOnItemMoved(const PlayerPtr& player, const ItemPtr& item
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnItemMoved] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnItemMoved, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnItemMoved);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	lua_pushinteger(L, count);
-	LuaScriptInterface::pushPosition(L, fromPosition);
-	LuaScriptInterface::pushPosition(L, toPosition);
-
-	LuaScriptInterface::pushCylinder(L, fromCylinder);
-	LuaScriptInterface::pushCylinder(L, toCylinder);
-
-	scriptInterface.callVoidFunction(7);
+	callVoidEvent(info.playerOnItemMoved, "eventPlayerOnItemMoved", player, item, count, fromPosition, toPosition, fromCylinder, toCylinder);
 }
 
 bool Events::eventPlayerOnMoveCreature(const PlayerPtr& player, const CreaturePtr& creature, const Position& fromPosition, const Position& toPosition)
@@ -828,27 +611,7 @@ bool Events::eventPlayerOnMoveCreature(const PlayerPtr& player, const CreaturePt
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnMoveCreature] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnMoveCreature, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnMoveCreature);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
-
-	LuaScriptInterface::pushPosition(L, fromPosition);
-	LuaScriptInterface::pushPosition(L, toPosition);
-
-	return scriptInterface.callFunction(4);
+	return callEvent(info.playerOnMoveCreature, "eventPlayerOnMoveCreature", player, creature, fromPosition, toPosition);
 }
 
 void Events::eventPlayerOnReportRuleViolation(const PlayerPtr& player, const std::string& targetName, uint8_t reportType, uint8_t reportReason, const std::string& comment, const std::string& translation)
@@ -858,29 +621,7 @@ void Events::eventPlayerOnReportRuleViolation(const PlayerPtr& player, const std
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnReportRuleViolation] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnReportRuleViolation, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnReportRuleViolation);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushString(L, targetName);
-
-	lua_pushinteger(L, reportType);
-	lua_pushinteger(L, reportReason);
-
-	LuaScriptInterface::pushString(L, comment);
-	LuaScriptInterface::pushString(L, translation);
-
-	scriptInterface.callVoidFunction(6);
+	callVoidEvent(info.playerOnReportRuleViolation, "eventPlayerOnReportRuleViolation", player, targetName, reportType, reportReason, comment, translation);
 }
 
 bool Events::eventPlayerOnReportBug(const PlayerPtr& player, const std::string& message, const Position& position, uint8_t category)
@@ -890,25 +631,7 @@ bool Events::eventPlayerOnReportBug(const PlayerPtr& player, const std::string&
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnReportBug] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnReportBug, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnReportBug);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushString(L, message);
-	LuaScriptInterface::pushPosition(L, position);
-	lua_pushinteger(L, category);
-
-	return scriptInterface.callFunction(4);
+	return callEvent(info.playerOnReportBug, "eventPlayerOnReportBug", player, message, position, category);
 }
 
 bool Events::eventPlayerOnTurn(const PlayerPtr& player, Direction direction)
@@ -918,23 +641,7 @@ bool Events::eventPlayerOnTurn(const PlayerPtr& player, Direction direction)
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnTurn] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTurn, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTurn);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	lua_pushinteger(L, direction);
-
-	return scriptInterface.callFunction(2);
+	return callEvent(info.playerOnTurn, "eventPlayerOnTurn", player, direction);
 }
 
 bool Events::eventPlayerOnTradeRequest(const PlayerPtr& player, const PlayerPtr& target, const ItemPtr& item)
@@ -944,27 +651,7 @@ bool Events::eventPlayerOnTradeRequest(const PlayerPtr& player, const PlayerPtr&
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnTradeRequest] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeRequest, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeRequest);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	return scriptInterface.callFunction(3);
+	return callEvent(info.playerOnTradeRequest, "eventPlayerOnTradeRequest", player, target, item);
 }
 
 bool Events::eventPlayerOnTradeAccept(const PlayerPtr& player, const PlayerPtr& target, const ItemPtr& item, const ItemPtr& targetItem)
@@ -974,30 +661,7 @@ bool Events::eventPlayerOnTradeAccept(const PlayerPtr& player, const PlayerPtr&
 		return true;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnTradeAccept] Call stack overflow" << std::endl;
-		return false;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeAccept, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeAccept);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	LuaScriptInterface::pushSharedPtr(L, targetItem);
-	LuaScriptInterface::setItemMetatable(L, -1, targetItem);
-
-	return scriptInterface.callFunction(4);
+	return callEvent(info.playerOnTradeAccept, "eventPlayerOnTradeAccept", player, target, item, targetItem);
 }
 
 void Events::eventPlayerOnTradeCompleted(const PlayerPtr& player, const PlayerPtr& target, const ItemPtr& item, const ItemPtr& targetItem, bool isSuccess)
@@ -1007,32 +671,7 @@ void Events::eventPlayerOnTradeCompleted(const PlayerPtr& player, const PlayerPt
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnTradeCompleted] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnTradeCompleted, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnTradeCompleted);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, target);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	LuaScriptInterface::pushSharedPtr(L, targetItem);
-	LuaScriptInterface::setItemMetatable(L, -1, targetItem);
-
-	LuaScriptInterface::pushBoolean(L, isSuccess);
-
-	return scriptInterface.callVoidFunction(5);
+	callVoidEvent(info.playerOnTradeCompleted, "eventPlayerOnTradeCompleted", player, target, item, targetItem, isSuccess);
 }
 
 void Events::eventPlayerOnGainExperience(const PlayerPtr& player, const CreaturePtr& source, uint64_t& exp, uint64_t rawExp)
@@ -1054,12 +693,10 @@ void Events::eventPlayerOnGainExperience(const PlayerPtr& player, const Creature
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnGainExperience);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	if (source) {
-		LuaScriptInterface::pushSharedPtr(L, source);
-		LuaScriptInterface::setCreatureMetatable(L, -1, source);
+		LuaScriptInterface::pushCreature(L, source);
 	} else {
 		lua_pushnil(L);
 	}
@@ -1095,8 +732,7 @@ void Events::eventPlayerOnLoseExperience(const PlayerPtr& player, uint64_t& exp)
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnLoseExperience);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	lua_pushinteger(L, exp);
 
@@ -1128,8 +764,7 @@ void Events::eventPlayerOnGainSkillTries(const PlayerPtr& player, skills_t skill
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnGainSkillTries);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	lua_pushinteger(L, skill);
 	lua_pushinteger(L, tries);
@@ -1151,24 +786,7 @@ void Events::eventPlayerOnWrapItem(const PlayerPtr& player, const ItemPtr& item)
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnWrapItem] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnWrapItem, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnWrapItem);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	scriptInterface.callVoidFunction(2);
+	callVoidEvent(info.playerOnWrapItem, "eventPlayerOnWrapItem", player, item);
 }
 
 void Events::eventPlayerOnInventoryUpdate(const PlayerPtr& player, const ItemPtr& item, slots_t slot, bool equip)
@@ -1178,27 +796,7 @@ void Events::eventPlayerOnInventoryUpdate(const PlayerPtr& player, const ItemPtr
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnInventoryUpdate] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnInventoryUpdate, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnInventoryUpdate);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	lua_pushinteger(L, slot);
-	LuaScriptInterface::pushBoolean(L, equip);
-
-	scriptInterface.callVoidFunction(4);
+	callVoidEvent(info.playerOnInventoryUpdate, "eventPlayerOnInventoryUpdate", player, item, slot, equip);
 }
 
 void Events::eventPlayerOnRotateItem(const PlayerPtr& player, const ItemPtr& item)
@@ -1208,24 +806,7 @@ void Events::eventPlayerOnRotateItem(const PlayerPtr& player, const ItemPtr& ite
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventPlayerOnRotateItem] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.playerOnRotateItem, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.playerOnRotateItem);
-
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	scriptInterface.callVoidFunction(2);
+	callVoidEvent(info.playerOnRotateItem, "eventPlayerOnRotateItem", player, item);
 }
 
 bool Events::eventPlayerOnSpellTry(const PlayerPtr& player, const Spell* spell, SpellType_t spellType)
@@ -1246,8 +827,7 @@ bool Events::eventPlayerOnSpellTry(const PlayerPtr& player, const Spell* spell,
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnSpellTry);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushSpell(L, *spell);
 
@@ -1272,8 +852,7 @@ void Events::eventPlayerOnAugment(const PlayerPtr& player, std::shared_ptr<Augme
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnAugment);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushSharedPtr<Augment>(L, augment);
 	LuaScriptInterface::setMetatable(L, -1, "Augment");
@@ -1299,8 +878,7 @@ void Events::eventPlayerOnRemoveAugment(const PlayerPtr& player, std::shared_ptr
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.playerOnRemoveAugment);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushSharedPtr<Augment>(L, augment);
 	LuaScriptInterface::setMetatable(L, -1, "Augment");
@@ -1315,24 +893,7 @@ void Events::eventMonsterOnDropLoot(const MonsterPtr& monster, const ContainerPt
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventMonsterOnDropLoot] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.monsterOnDropLoot, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.monsterOnDropLoot);
-
-	LuaScriptInterface::pushSharedPtr(L, monster);
-	LuaScriptInterface::setMetatable(L, -1, "Monster");
-
-	LuaScriptInterface::pushSharedPtr(L, corpse);
-	LuaScriptInterface::setMetatable(L, -1, "Container");
-
-	scriptInterface.callVoidFunction(2);
+	callVoidEvent(info.monsterOnDropLoot, "eventMonsterOnDropLoot", monster, corpse);
 }
 
 bool Events::eventItemOnImbue(const ItemPtr& item, const std::shared_ptr<Imbuement>& imbuement, bool created)
@@ -1353,8 +914,7 @@ bool Events::eventItemOnImbue(const ItemPtr& item, const std::shared_ptr<Imbueme
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.itemOnImbue);
 
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
+	LuaScriptInterface::pushItem(L, item);
 
 	LuaScriptInterface::pushSharedPtr(L, imbuement);
 	LuaScriptInterface::setMetatable(L, -1, "Imbuement");
@@ -1371,24 +931,7 @@ void Events::eventItemOnRemoveImbue(const ItemPtr& item, ImbuementType imbueType
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventItemOnRemoveImbue] Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.itemOnRemoveImbue, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.itemOnRemoveImbue);
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	lua_pushinteger(L, static_cast<uint8_t>(imbueType));
-	LuaScriptInterface::pushBoolean(L, decayed);
-
-	scriptInterface.callVoidFunction(3);
+	callVoidEvent(info.itemOnRemoveImbue, "eventItemOnRemoveImbue", item, static_cast<uint8_t>(imbueType), decayed);
 }
 
 void Events::eventItemOnAttack(const ItemPtr& item, const PlayerPtr& itemHolder, const CreaturePtr& defender, BlockType_t blockType, CombatType_t combatType, CombatOrigin origin, bool criticalDamage, bool leechedDamage)
@@ -1398,34 +941,7 @@ void Events::eventItemOnAttack(const ItemPtr& item, const PlayerPtr& itemHolder,
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventItemOnAttack Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.itemOnAttack, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.itemOnAttack);
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	LuaScriptInterface::pushSharedPtr(L, itemHolder);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, defender);
-	LuaScriptInterface::setCreatureMetatable(L, -1, defender);
-
-	lua_pushinteger(L, static_cast<uint8_t>(blockType));
-	lua_pushinteger(L, static_cast<uint8_t>(combatType));
-	lua_pushinteger(L, static_cast<uint8_t>(origin));
-
-	lua_pushinteger(L, criticalDamage);
-	lua_pushinteger(L, leechedDamage);
-
-	scriptInterface.callVoidFunction(8);
+	callVoidEvent(info.itemOnAttack, "eventItemOnAttack", item, itemHolder, defender, static_cast<uint8_t>(blockType), static_cast<uint8_t>(combatType), static_cast<uint8_t>(origin), static_cast<uint8_t>(criticalDamage), static_cast<uint8_t>(leechedDamage));
 }
 
 void Events::eventItemOnDefend(const ItemPtr& item, const PlayerPtr& itemHolder, const CreaturePtr& attacker, BlockType_t blockType, CombatType_t combatType, CombatOrigin origin, bool criticalDamage, bool leechedDamage)
@@ -1435,34 +951,7 @@ void Events::eventItemOnDefend(const ItemPtr& item, const PlayerPtr& itemHolder,
 		return;
 	}
 
-	if (!scriptInterface.reserveScriptEnv()) {
-		std::cout << "[Error - Events::eventItemOnDefend Call stack overflow" << std::endl;
-		return;
-	}
-
-	ScriptEnvironment* env = scriptInterface.getScriptEnv();
-	env->setScriptId(info.itemOnDefend, &scriptInterface);
-
-	lua_State* L = scriptInterface.getLuaState();
-	scriptInterface.pushFunction(info.itemOnDefend);
-
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setItemMetatable(L, -1, item);
-
-	LuaScriptInterface::pushSharedPtr(L, itemHolder);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
-
-	LuaScriptInterface::pushSharedPtr(L, attacker);
-	LuaScriptInterface::setCreatureMetatable(L, -1, attacker);
-
-	lua_pushinteger(L, blockType);
-	lua_pushinteger(L, static_cast<uint8_t>(combatType));
-	lua_pushinteger(L, static_cast<uint8_t>(origin));
-
-	lua_pushinteger(L, criticalDamage);
-	lua_pushinteger(L, leechedDamage);
-
-	scriptInterface.callVoidFunction(8);
+	callVoidEvent(info.itemOnDefend, "eventItemOnDefend", item, itemHolder, attacker, blockType, static_cast<uint8_t>(combatType), static_cast<uint8_t>(origin), static_cast<uint8_t>(criticalDamage), static_cast<uint8_t>(leechedDamage));
 }
 
 void Events::eventItemOnAugment(const ItemPtr& item, std::shared_ptr<Augment> augment)
@@ -1483,8 +972,7 @@ void Events::eventItemOnAugment(const ItemPtr& item, std::shared_ptr<Augment> au
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.itemOnAugment);
 
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setMetatable(L, -1, "Item");
+	LuaScriptInterface::pushSharedPtr(L, item, LuaData_Item);
 
 	LuaScriptInterface::pushSharedPtr<Augment>(L, augment);
 	LuaScriptInterface::setMetatable(L, -1, "Augment");
@@ -1510,8 +998,7 @@ void Events::eventItemOnRemoveAugment(const ItemPtr& item, std::shared_ptr<Augme
 	lua_State* L = scriptInterface.getLuaState();
 	scriptInterface.pushFunction(info.itemOnRemoveAugment);
 
-	LuaScriptInterface::pushSharedPtr(L, item);
-	LuaScriptInterface::setMetatable(L, -1, "Item");
+	LuaScriptInterface::pushSharedPtr(L, item, LuaData_Item);
 
 	LuaScriptInterface::pushSharedPtr<Augment>(L, augment);
 	LuaScriptInterface::setMetatable(L, -1, "Augment");
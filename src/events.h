@@ -15,10 +15,58 @@ class Spell;
 
 enum class EventInfoId {
 	// Creature
+	CREATURE_ONCHANGEOUTFIT,
+	CREATURE_ONAREACOMBAT,
+	CREATURE_ONTARGETCOMBAT,
 	CREATURE_ONHEAR,
+	CREATURE_ONATTACK,
+	CREATURE_ONDEFEND,
+
+	// Party
+	PARTY_ONJOIN,
+	PARTY_ONLEAVE,
+	PARTY_ONDISBAND,
+	PARTY_ONSHAREEXPERIENCE,
+	PARTY_ONINVITE,
+	PARTY_ONREVOKEINVITATION,
+	PARTY_ONPASSLEADERSHIP,
+
+	// Player
+	PLAYER_ONBROWSEFIELD,
+	PLAYER_ONLOOK,
+	PLAYER_ONLOOKINBATTLELIST,
+	PLAYER_ONLOOKINTRADE,
+	PLAYER_ONLOOKINSHOP,
+	PLAYER_ONMOVEITEM,
+	PLAYER_ONITEMMOVED,
+	PLAYER_ONMOVECREATURE,
+	PLAYER_ONREPORTRULEVIOLATION,
+	PLAYER_ONREPORTBUG,
+	PLAYER_ONTURN,
+	PLAYER_ONTRADEREQUEST,
+	PLAYER_ONTRADEACCEPT,
+	PLAYER_ONTRADECOMPLETED,
+	PLAYER_ONGAINEXPERIENCE,
+	PLAYER_ONLOSEEXPERIENCE,
+	PLAYER_ONGAINSKILLTRIES,
+	PLAYER_ONWRAPITEM,
+	PLAYER_ONINVENTORYUPDATE,
+	PLAYER_ONROTATEITEM,
+	PLAYER_ONSPELLTRY,
+	PLAYER_ONAUGMENT,
+	PLAYER_ONREMOVEAUGMENT,
 
 	// Monster
-	MONSTER_ONSPAWN
+	MONSTER_ONDROPLOOT,
+	MONSTER_ONSPAWN,
+
+	// Item
+	ITEM_ONIMBUE,
+	ITEM_ONREMOVEIMBUE,
+	ITEM_ONATTACK,
+	ITEM_ONDEFEND,
+	ITEM_ONAUGMENT,
+	ITEM_ONREMOVEAUGMENT
 };
 
 class Events
@@ -141,19 +189,114 @@ class Events
 		void eventItemOnRemoveAugment(const ItemPtr& item, std::shared_ptr<Augment> augment);
 		
 
-		constexpr auto getScriptId(EventInfoId eventInfoId) const {
+		constexpr int32_t getScriptId(EventInfoId eventInfoId) const {
 			switch (eventInfoId)
 			{
+			case EventInfoId::CREATURE_ONCHANGEOUTFIT:
+				return info.creatureOnChangeOutfit;
+			case EventInfoId::CREATURE_ONAREACOMBAT:
+				return info.creatureOnAreaCombat;
+			case EventInfoId::CREATURE_ONTARGETCOMBAT:
+				return info.creatureOnTargetCombat;
 			case EventInfoId::CREATURE_ONHEAR:
 				return info.creatureOnHear;
+			case EventInfoId::CREATURE_ONATTACK:
+				return info.creatureOnAttack;
+			case EventInfoId::CREATURE_ONDEFEND:
+				return info.creatureOnDefend;
+			case EventInfoId::PARTY_ONJOIN:
+				return info.partyOnJoin;
+			case EventInfoId::PARTY_ONLEAVE:
+				return info.partyOnLeave;
+			case EventInfoId::PARTY_ONDISBAND:
+				return info.partyOnDisband;
+			case EventInfoId::PARTY_ONSHAREEXPERIENCE:
+				return info.partyOnShareExperience;
+			case EventInfoId::PARTY_ONINVITE:
+				return info.partyOnInvite;
+			case EventInfoId::PARTY_ONREVOKEINVITATION:
+				return info.partyOnRevokeInvitation;
+			case EventInfoId::PARTY_ONPASSLEADERSHIP:
+				return info.partyOnPassLeadership;
+			case EventInfoId::PLAYER_ONBROWSEFIELD:
+				return info.playerOnBrowseField;
+			case EventInfoId::PLAYER_ONLOOK:
+				return info.playerOnLook;
+			case EventInfoId::PLAYER_ONLOOKINBATTLELIST:
+				return info.playerOnLookInBattleList;
+			case EventInfoId::PLAYER_ONLOOKINTRADE:
+				return info.playerOnLookInTrade;
+			case EventInfoId::PLAYER_ONLOOKINSHOP:
+				return info.playerOnLookInShop;
+			case EventInfoId::PLAYER_ONMOVEITEM:
+				return info.playerOnMoveItem;
+			case EventInfoId::PLAYER_ONITEMMOVED:
+				return info.playerOnItemMoved;
+			case EventInfoId::PLAYER_ONMOVECREATURE:
+				return info.playerOnMoveCreature;
+			case EventInfoId::PLAYER_ONREPORTRULEVIOLATION:
+				return info.playerOnReportRuleViolation;
+			case EventInfoId::PLAYER_ONREPORTBUG:
+				return info.playerOnReportBug;
+			case EventInfoId::PLAYER_ONTURN:
+				return info.playerOnTurn;
+			case EventInfoId::PLAYER_ONTRADEREQUEST:
+				return info.playerOnTradeRequest;
+			case EventInfoId::PLAYER_ONTRADEACCEPT:
+				return info.playerOnTradeAccept;
+			case EventInfoId::PLAYER_ONTRADECOMPLETED:
+				return info.playerOnTradeCompleted;
+			case EventInfoId::PLAYER_ONGAINEXPERIENCE:
+				return info.playerOnGainExperience;
+			case EventInfoId::PLAYER_ONLOSEEXPERIENCE:
+				return info.playerOnLoseExperience;
+			case EventInfoId::PLAYER_ONGAINSKILLTRIES:
+				return info.playerOnGainSkillTries;
+			case EventInfoId::PLAYER_ONWRAPITEM:
+				return info.playerOnWrapItem;
+			case EventInfoId::PLAYER_ONINVENTORYUPDATE:
+				return info.playerOnInventoryUpdate;
+			case EventInfoId::PLAYER_ONROTATEITEM:
+				return info.playerOnRotateItem;
+			case EventInfoId::PLAYER_ONSPELLTRY:
+				return info.playerOnSpellTry;
+			case EventInfoId::PLAYER_ONAUGMENT:
+				return info.playerOnAugment;
+			case EventInfoId::PLAYER_ONREMOVEAUGMENT:
+				return info.playerOnRemoveAugment;
+			case EventInfoId::MONSTER_ONDROPLOOT:
+				return info.monsterOnDropLoot;
 			case EventInfoId::MONSTER_ONSPAWN:
 				return info.monsterOnSpawn;
+			case EventInfoId::ITEM_ONIMBUE:
+				return info.itemOnImbue;
+			case EventInfoId::ITEM_ONREMOVEIMBUE:
+				return info.itemOnRemoveImbue;
+			case EventInfoId::ITEM_ONATTACK:
+				return info.itemOnAttack;
+			case EventInfoId::ITEM_ONDEFEND:
+				return info.itemOnDefend;
+			case EventInfoId::ITEM_ONAUGMENT:
+				return info.itemOnAugment;
+			case EventInfoId::ITEM_ONREMOVEAUGMENT:
+				return info.itemOnRemoveAugment;
 			default:
 				return -1;
 			}
-		};
+		}
+
+		// call sites check this before preparing the arguments of an event nobody listens to
+		constexpr bool hasEvent(EventInfoId eventInfoId) const {
+			return getScriptId(eventInfoId) != -1;
+		}
 
 	private:
+		// pushes the arguments by their type and calls the script, false if it could not be called
+		template<typename... Args>
+		bool callEvent(int32_t scriptId, const char* eventName, const Args&... args);
+		template<typename... Args>
+		void callVoidEvent(int32_t scriptId, const char* eventName, const Args&... args);
+
 		LuaScriptInterface scriptInterface;
 		EventsInfo info;
 };
@@ -33,27 +33,45 @@ static Node& getCurrentNode(const NodeStack& nodeStack) {
 	return *nodeStack.top();
 }
 
-const Node& Loader::parseTree()
+// builds the children of parent from the first child START up to the END of
+// parent, nodes maxDepth levels below parent are deferred
+static void parseNodes(Node& parent, ContentIt it, ContentIt end, size_t maxDepth)
 {
-	auto it = fileContents.begin() + sizeof(Identifier);
-	if (static_cast<uint8_t>(*it) != Node::START) {
-		throw InvalidOTBFormat{};
-	}
-	root.type = *(++it);
-	root.propsBegin = ++it;
 	NodeStack parseStack;
-	parseStack.push(&root);
+	parseStack.push(&parent);
 
-	for (; it != fileContents.end(); ++it) {
+	// nodes open below the deferred node being skipped over
+	size_t skipped = 0;
+	for (; it != end; ++it) {
 		switch(static_cast<uint8_t>(*it)) {
 			case Node::START: {
+				if (skipped != 0) {
+					++skipped;
+					if (++it == end) {
+						throw InvalidOTBFormat{};
+					}
+					break;
+				}
+
 				auto& currentNode = getCurrentNode(parseStack);
+				if (parseStack.size() > maxDepth) {
+					if (!currentNode.deferred) {
+						currentNode.propsEnd = it;
+						currentNode.deferred = true;
+					}
+					skipped = 1;
+					if (++it == end) {
+						throw InvalidOTBFormat{};
+					}
+					break;
+				}
+
 				if (currentNode.children.empty()) {
 					currentNode.propsEnd = it;
 				}
 				currentNode.children.emplace_back();
 				auto& child = currentNode.children.back();
-				if (++it == fileContents.end()) {
+				if (++it == end) {
 					throw InvalidOTBFormat{};
 				}
 				child.type = *it;
@@ -62,15 +80,21 @@ const Node& Loader::parseTree()
 				break;
 			}
 			case Node::END: {
+				if (skipped != 0) {
+					--skipped;
+					break;
+				}
+
 				auto& currentNode = getCurrentNode(parseStack);
-				if (currentNode.children.empty()) {
+				if (currentNode.children.empty() && !currentNode.deferred) {
 					currentNode.propsEnd = it;
 				}
+				currentNode.end = it;
 				parseStack.pop();
 				break;
 			}
 			case Node::ESCAPE: {
-				if (++it == fileContents.end()) {
+				if (++it == end) {
 					throw InvalidOTBFormat{};
 				}
 				break;
@@ -83,16 +107,78 @@ const Node& Loader::parseTree()
 	if (!parseStack.empty()) {
 		throw InvalidOTBFormat{};
 	}
+}
 
+Node& Loader::parseTree(size_t maxDepth)
+{
+	auto it = fileContents.begin() + sizeof(Identifier);
+	if (static_cast<uint8_t>(*it) != Node::START) {
+		throw InvalidOTBFormat{};
+	}
+	root.type = *(++it);
+	root.propsBegin = ++it;
+	parseNodes(root, it, fileContents.end(), maxDepth);
 	return root;
 }
 
+Node Loader::getNode(size_t offset) const
+{
+	if (offset + sizeof(Node::START) + sizeof(Node::type) >= fileContents.size() || static_cast<uint8_t>(fileContents.data()[offset]) != Node::START) {
+		throw InvalidOTBFormat{};
+	}
+
+	Node node;
+	auto it = fileContents.begin() + offset + sizeof(Node::START);
+	node.type = *it;
+	node.propsBegin = ++it;
+
+	// nodes open below node
+	size_t open = 0;
+	for (; it != fileContents.end(); ++it) {
+		switch (static_cast<uint8_t>(*it)) {
+			case Node::START: {
+				if (!node.deferred) {
+					node.propsEnd = it;
+					node.deferred = true;
+				}
+				++open;
+				if (++it == fileContents.end()) {
+					throw InvalidOTBFormat{};
+				}
+				break;
+			}
+			case Node::END: {
+				if (open == 0) {
+					if (!node.deferred) {
+						node.propsEnd = it;
+					}
+					node.end = it;
+					return node;
+				}
+				--open;
+				break;
+			}
+			case Node::ESCAPE: {
+				if (++it == fileContents.end()) {
+					throw InvalidOTBFormat{};
+				}
+				break;
+			}
+			default: {
+				break;
+			}
+		}
+	}
+	throw InvalidOTBFormat{};
+}
+
 bool Loader::getProps(const Node& node, PropStream& props)
 {
 	auto size = std::distance(node.propsBegin, node.propsEnd);
 	if (size == 0) {
 		return false;
 	}
+	thread_local std::vector<char> propBuffer;
 	propBuffer.resize(size);
 	bool lastEscaped = false;
 
@@ -22,7 +22,15 @@ struct Node
 	ChildrenVector children;
 	ContentIt      propsBegin;
 	ContentIt      propsEnd;
+	// the END of the node
+	ContentIt      end;
 	uint8_t           type;
+	// the children are still in the file, see Loader::parseTree
+	bool              deferred = false;
+
+	bool hasChildren() const {
+		return deferred || !children.empty();
+	}
 	enum NodeChar: uint8_t
 	{
 		ESCAPE = 0xFD,
@@ -44,29 +52,145 @@ struct InvalidOTBFormat final : LoadError {
 class Loader {
 	MappedFile     fileContents;
 	Node              root;
-	std::vector<char> propBuffer;
 public:
 	Loader(const std::string& fileName, const Identifier& acceptedIdentifier);
+	// safe to call from several threads, the properties are unescaped into a buffer
+	// of the calling thread that the next call on that thread reuses
 	bool getProps(const Node& node, PropStream& props);
-	const Node& parseTree();
+	// nodes maxDepth levels below the root are deferred, their children stay in
+	// the file and are read with forEachChild
+	Node& parseTree(size_t maxDepth = std::numeric_limits<size_t>::max());
+
+	// where the START of node is in the file
+	size_t getOffset(const Node& node) const {
+		return std::distance(fileContents.begin(), node.propsBegin) - sizeof(Node::START) - sizeof(Node::type);
+	}
+	// the node whose START is at offset, deferred like the ones parseTree leaves
+	Node getNode(size_t offset) const;
+
+	// Calls f(child) for every child of node in file order until f returns false.
+	// The children of a deferred node are read straight from the file, each one
+	// is itself deferred and only valid during its call, so nothing below node
+	// is kept in memory.
+	template <typename F>
+	static bool forEachChild(const Node& node, F&& f) {
+		if (!node.deferred) {
+			for (const Node& child : node.children) {
+				if (!f(child)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		Node child;
+		// nodes open below node
+		size_t open = 0;
+		for (auto it = node.propsEnd; it != node.end; ++it) {
+			switch (static_cast<uint8_t>(*it)) {
+				case Node::START: {
+					if (++it == node.end) {
+						throw InvalidOTBFormat{};
+					}
+
+					if (open == 0) {
+						child.type = *it;
+						child.propsBegin = it + sizeof(Node::type);
+						child.deferred = false;
+					} else if (open == 1 && !child.deferred) {
+						child.propsEnd = std::prev(it);
+						child.deferred = true;
+					}
+					++open;
+					break;
+				}
+				case Node::END: {
+					if (open == 0) {
+						throw InvalidOTBFormat{};
+					}
+
+					if (--open == 0) {
+						if (!child.deferred) {
+							child.propsEnd = it;
+						}
+						child.end = it;
+						if (!f(static_cast<const Node&>(child))) {
+							return false;
+						}
+					}
+					break;
+				}
+				case Node::ESCAPE: {
+					if (++it == node.end) {
+						throw InvalidOTBFormat{};
+					}
+					break;
+				}
+				default: {
+					break;
+				}
+			}
+		}
+
+		if (open != 0) {
+			throw InvalidOTBFormat{};
+		}
+		return true;
+	}
 };
 
 } //namespace OTB
 
+// Both streams read and write fixed width little endian values by default.
+// After beginCompact, integers of 4 bytes and more are written as zigzag
+// varints of their sign extended value, so a value written unsigned reads back
+// the same as a signed one, string lengths become varints and writeKey names
+// repeated keys by their index in a dictionary local to the stream. Smaller
+// integers, floating point values and skip stay fixed width.
 class PropStream
 {
 	public:
 		void init(const char* a, size_t size) {
 			p = a;
 			end = a + size;
+			compact = false;
+			keys.clear();
 		}
 
 		size_t size() const {
 			return end - p;
 		}
 
+		// the bytes not read yet
+		std::string_view getRemaining() const {
+			return {p, size()};
+		}
+
+		// true and the rest is read in the compact encoding when the stream starts with header
+		bool beginCompact(std::string_view header) {
+			if (size() < header.size() || memcmp(p, header.data(), header.size()) != 0) {
+				return false;
+			}
+
+			p += header.size();
+			compact = true;
+			return true;
+		}
+
 		template <typename T>
 		bool read(T& ret) {
+			if constexpr (std::is_integral_v<T> && sizeof(T) >= 4) {
+				if (compact) {
+					uint64_t value;
+					if (!readVarint(value)) {
+						return false;
+					}
+
+					ret = static_cast<T>(static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1)));
+					return true;
+				}
+			}
+
 			if (size() < sizeof(T)) {
 				return false;
 			}
@@ -77,20 +201,53 @@ class PropStream
 		}
 
 		std::pair<std::string_view, bool> readString() {
-			uint16_t strLen;
-			if (!read<uint16_t>(strLen)) {
-				return { "", false };
+			uint64_t strLen;
+			if (compact) {
+				if (!readVarint(strLen)) {
+					return { "", false };
+				}
+			} else {
+				uint16_t fixedLen;
+				if (!read<uint16_t>(fixedLen)) {
+					return { "", false };
+				}
+				strLen = fixedLen;
 			}
 
 			if (size() < strLen) {
 				return { "", false };
 			}
 
-			std::string_view ret{ p, strLen };
+			std::string_view ret{ p, static_cast<size_t>(strLen) };
 			p += strLen;
 			return { ret, true };
 		}
 
+		// a string written by PropWriteStream::writeKey
+		std::pair<std::string_view, bool> readKey() {
+			if (!compact) {
+				return readString();
+			}
+
+			uint64_t index;
+			if (!readVarint(index)) {
+				return { "", false };
+			}
+
+			if (index != 0) {
+				if (index > keys.size()) {
+					return { "", false };
+				}
+				return { keys[index - 1], true };
+			}
+
+			auto ret = readString();
+			if (ret.second) {
+				keys.push_back(ret.first);
+			}
+			return ret;
+		}
+
 		bool skip(size_t n) {
 			if (size() < n) {
 				return false;
@@ -101,8 +258,27 @@ class PropStream
 		}
 
 	private:
+		bool readVarint(uint64_t& ret) {
+			ret = 0;
+			for (uint32_t shift = 0; shift < 64; shift += 7) {
+				if (p == end) {
+					return false;
+				}
+
+				const uint8_t byte = static_cast<uint8_t>(*p++);
+				ret |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) {
+					return true;
+				}
+			}
+			return false;
+		}
+
 		const char* p = nullptr;
 		const char* end = nullptr;
+		// the keys read so far, they point into the stream
+		std::vector<std::string_view> keys;
+		bool compact = false;
 };
 
 class PropWriteStream
@@ -120,10 +296,26 @@ class PropWriteStream
 
 		void clear() {
 			buffer.clear();
+			compact = false;
+			keys.clear();
+		}
+
+		// writes header and everything after it in the compact encoding
+		void beginCompact(std::string_view header) {
+			buffer.insert(buffer.end(), header.begin(), header.end());
+			compact = true;
 		}
 
 		template <typename T>
 		void write(T add) {
+			if constexpr (std::is_integral_v<T> && sizeof(T) >= 4) {
+				if (compact) {
+					const int64_t value = static_cast<int64_t>(add);
+					writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+					return;
+				}
+			}
+
 			char* addr = reinterpret_cast<char*>(&add);
 			std::copy(addr, addr + sizeof(T), std::back_inserter(buffer));
 		}
@@ -131,16 +323,48 @@ class PropWriteStream
 		void writeString(const std::string& str) {
 			size_t strLength = str.size();
 			if (strLength > std::numeric_limits<uint16_t>::max()) {
-				write<uint16_t>(0);
+				strLength = 0;
+			}
+
+			if (compact) {
+				writeVarint(strLength);
+			} else {
+				write(static_cast<uint16_t>(strLength));
+			}
+			std::copy(str.begin(), str.begin() + strLength, std::back_inserter(buffer));
+		}
+
+		// a string that is likely to repeat within the stream, read with PropStream::readKey
+		void writeKey(const std::string& key) {
+			if (!compact) {
+				writeString(key);
+				return;
+			}
+
+			auto it = std::find(keys.begin(), keys.end(), key);
+			if (it != keys.end()) {
+				writeVarint(std::distance(keys.begin(), it) + 1);
 				return;
 			}
 
-			write(static_cast<uint16_t>(strLength));
-			std::copy(str.begin(), str.end(), std::back_inserter(buffer));
+			writeVarint(0);
+			writeString(key);
+			keys.push_back(key);
 		}
 
 	private:
+		void writeVarint(uint64_t value) {
+			while (value >= 0x80) {
+				buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			buffer.push_back(static_cast<char>(value));
+		}
+
 		std::vector<char> buffer;
+		// the keys written so far, by the index they are referred to with
+		std::vector<std::string> keys;
+		bool compact = false;
 };
 
 #endif
@@ -0,0 +1,168 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "flowfield.h"
+#include "map.h"
+#include "creature.h"
+
+#include <queue>
+
+namespace {
+
+constexpr std::array<std::pair<int32_t, int32_t>, 8> flowOffsets = {{
+	{0, -1}, {1, 0}, {0, 1}, {-1, 0},
+	{-1, -1}, {1, -1}, {-1, 1}, {1, 1},
+}};
+
+constexpr std::array<Direction, 8> flowDirections = {
+	DIRECTION_NORTH, DIRECTION_EAST, DIRECTION_SOUTH, DIRECTION_WEST,
+	DIRECTION_NORTHWEST, DIRECTION_NORTHEAST, DIRECTION_SOUTHWEST, DIRECTION_SOUTHEAST,
+};
+
+}
+
+void FlowField::build(const Map& map, const Position& targetPos)
+{
+	this->targetPos = targetPos;
+	costs.fill(UNREACHABLE);
+
+	using Node = std::pair<int32_t, int32_t>;
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node>> open;
+
+	auto isWalkable = [&](int32_t x, int32_t y) {
+		return x >= 0 && x <= 0xFFFF && y >= 0 && y <= 0xFFFF
+		       && !Map::isPathBlocked(map.getTileState(x, y, targetPos.z));
+	};
+
+	// the tiles next to the target are where the chasers stop
+	for (const auto& [offsetX, offsetY] : flowOffsets) {
+		const int32_t x = targetPos.x + offsetX;
+		const int32_t y = targetPos.y + offsetY;
+		if (isWalkable(x, y)) {
+			const int32_t index = getCellIndex(x, y);
+			costs[index] = 0;
+			open.emplace(0, index);
+		}
+	}
+
+	while (!open.empty()) {
+		const auto [cost, index] = open.top();
+		open.pop();
+		if (cost > costs[index]) {
+			continue;
+		}
+
+		const int32_t x = targetPos.x + (index % FLOW_FIELD_SIDE) - FLOW_FIELD_RANGE;
+		const int32_t y = targetPos.y + (index / FLOW_FIELD_SIDE) - FLOW_FIELD_RANGE;
+		for (size_t i = 0; i < flowOffsets.size(); ++i) {
+			const int32_t nextX = x + flowOffsets[i].first;
+			const int32_t nextY = y + flowOffsets[i].second;
+			const int32_t nextIndex = getCellIndex(nextX, nextY);
+			if (nextIndex < 0 || (nextX == targetPos.x && nextY == targetPos.y) || !isWalkable(nextX, nextY)) {
+				continue;
+			}
+
+			// the same step costs as the follow search
+			const int32_t nextCost = cost + (i < 4 ? MAP_NORMALWALKCOST : MAP_DIAGONALWALKCOST);
+			if (nextCost < costs[nextIndex]) {
+				costs[nextIndex] = nextCost;
+				open.emplace(nextCost, nextIndex);
+			}
+		}
+	}
+}
+
+bool FlowField::getPath(Map& map, CreaturePtr& creature, std::vector<Direction>& dirList) const
+{
+	Position pos = creature->getPosition();
+	if (pos.z != targetPos.z) {
+		return false;
+	}
+
+	int32_t index = getCellIndex(pos.x, pos.y);
+	if (index < 0 || costs[index] == UNREACHABLE) {
+		return false;
+	}
+
+	dirList.clear();
+	int32_t cost = costs[index];
+	while (Position::getDistanceX(pos, targetPos) > 1 || Position::getDistanceY(pos, targetPos) > 1) {
+		// every step goes strictly downhill, so this ends
+		int32_t bestIndex = -1;
+		int32_t bestCost = cost;
+		size_t bestStep = 0;
+		for (size_t i = 0; i < flowOffsets.size(); ++i) {
+			const int32_t nextIndex = getCellIndex(pos.x + flowOffsets[i].first, pos.y + flowOffsets[i].second);
+			if (nextIndex < 0 || costs[nextIndex] >= bestCost) {
+				continue;
+			}
+
+			const Position nextPos(pos.x + flowOffsets[i].first, pos.y + flowOffsets[i].second, pos.z);
+			if (!map.canWalkTo(creature, nextPos)) {
+				continue;
+			}
+
+			bestIndex = nextIndex;
+			bestCost = costs[nextIndex];
+			bestStep = i;
+		}
+
+		if (bestIndex < 0) {
+			// walled in by what the field does not see, creatures or fields
+			return false;
+		}
+
+		pos.x += flowOffsets[bestStep].first;
+		pos.y += flowOffsets[bestStep].second;
+		cost = bestCost;
+		dirList.push_back(flowDirections[bestStep]);
+	}
+
+	if (dirList.empty()) {
+		return false;
+	}
+
+	// the next step goes at the back
+	std::reverse(dirList.begin(), dirList.end());
+	return true;
+}
+
+const FlowField* FlowFieldCache::get(const Map& map, uint32_t targetId, const Position& targetPos, uint32_t chaserId)
+{
+	const int64_t now = OTSYS_TIME();
+	if (now - lastCleanup >= FLOW_FIELD_IDLE_TIME) {
+		lastCleanup = now;
+		for (auto it = entries.begin(); it != entries.end();) {
+			if (now - it->second->lastUsed >= FLOW_FIELD_IDLE_TIME) {
+				entries.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	auto& entry = entries[targetId];
+	if (!entry) {
+		entry = std::make_unique<Entry>();
+	}
+
+	entry->lastUsed = now;
+	if (entry->targetPos != targetPos) {
+		entry->targetPos = targetPos;
+		entry->chasers.clear();
+		entry->built = false;
+	}
+
+	if (!entry->built) {
+		entry->chasers.insert(chaserId);
+		if (entry->chasers.size() <= FLOW_FIELD_MIN_CHASERS) {
+			return nullptr;
+		}
+
+		entry->field.build(map, targetPos);
+		entry->built = true;
+	}
+	return &entry->field;
+}
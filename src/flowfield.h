@@ -0,0 +1,73 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_FLOWFIELD_H
+#define FS_FLOWFIELD_H
+
+#include "declarations.h"
+#include "position.h"
+
+#include <array>
+#include <gtl/phmap.hpp>
+
+class Map;
+
+// how far from the target the field reaches, the follow search distance of monsters
+static constexpr int32_t FLOW_FIELD_RANGE = 12;
+static constexpr int32_t FLOW_FIELD_SIDE = FLOW_FIELD_RANGE * 2 + 1;
+// chasers of a target standing still that search on their own before a field is built for them
+static constexpr uint32_t FLOW_FIELD_MIN_CHASERS = 4;
+// fields of targets nobody asked about for this long are dropped
+static constexpr int64_t FLOW_FIELD_IDLE_TIME = 10000;
+
+// Walking cost from every tile around a target to the tiles next to it, over
+// the static walkability of the map. A creature in range follows the costs
+// downhill instead of running its own search; only the tiles it steps on are
+// checked against its own walking rules.
+class FlowField
+{
+	public:
+		void build(const Map& map, const Position& targetPos);
+
+		// steps to a tile next to the target in listWalkDir order, false if the field leads nowhere for creature
+		bool getPath(Map& map, CreaturePtr& creature, std::vector<Direction>& dirList) const;
+
+	private:
+		static constexpr int32_t UNREACHABLE = std::numeric_limits<int32_t>::max();
+
+		int32_t getCellIndex(int32_t x, int32_t y) const {
+			const int32_t dx = x - targetPos.x;
+			const int32_t dy = y - targetPos.y;
+			if (std::abs(dx) > FLOW_FIELD_RANGE || std::abs(dy) > FLOW_FIELD_RANGE) {
+				return -1;
+			}
+			return (dy + FLOW_FIELD_RANGE) * FLOW_FIELD_SIDE + (dx + FLOW_FIELD_RANGE);
+		}
+
+		std::array<int32_t, FLOW_FIELD_SIDE * FLOW_FIELD_SIDE> costs;
+		Position targetPos;
+};
+
+// Flow fields of the targets chased by several creatures at once. A target
+// gets its field once more than FLOW_FIELD_MIN_CHASERS creatures asked for a
+// path to where it stands; moving away starts the count over.
+class FlowFieldCache
+{
+	public:
+		const FlowField* get(const Map& map, uint32_t targetId, const Position& targetPos, uint32_t chaserId);
+
+	private:
+		struct Entry
+		{
+			FlowField field;
+			Position targetPos;
+			int64_t lastUsed = 0;
+			gtl::flat_hash_set<uint32_t> chasers;
+			bool built = false;
+		};
+
+		gtl::flat_hash_map<uint32_t, std::unique_ptr<Entry>> entries;
+		int64_t lastCleanup = 0;
+};
+
+#endif
@@ -15,16 +15,27 @@
 #include "game.h"
 #include "globalevent.h"
 #include "iologindata.h"
+#include "iomapserialize.h"
 #include "iomarket.h"
 #include "items.h"
 #include "monster.h"
 #include "movement.h"
+#include "pathfinding.h"
+#include "thinkpool.h"
+#include "cryptopool.h"
+#include "protocolstatus.h"
 #include "scheduler.h"
 #include "server.h"
+#include "tickprofiler.h"
 #include "spells.h"
 #include "talkaction.h"
 #include "weapons.h"
 #include "script.h"
+#include "luaprofiler.h"
+#include "luaworkers.h"
+#include "logwriter.h"
+#include "webhooks.h"
+#include "worldbus.h"
 
 #include <fmt/format.h>
 
@@ -38,6 +49,7 @@ extern Vocations g_vocations;
 extern GlobalEvents* g_globalEvents;
 extern CreatureEvents* g_creatureEvents;
 extern Events* g_events;
+extern LuaEnvironment g_luaEnvironment;
 extern Monsters g_monsters;
 extern MoveEvents* g_moveEvents;
 extern Weapons* g_weapons;
@@ -57,13 +69,11 @@ Game::Game()
 	offlineTrainingWindow.priority = true;
 
 	curl_global_init(CURL_GLOBAL_ALL);
-	curl = curl_easy_init();
 }
 
 Game::~Game()
 {
 	curl_global_cleanup();
-	curl_easy_cleanup(curl);
 }
 
 void Game::start(ServiceManager* manager)
@@ -74,8 +84,14 @@ void Game::start(ServiceManager* manager)
 	if (g_config.getBoolean(ConfigManager::DEFAULT_WORLD_LIGHT)) {
 		g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, [this]() { checkLight(); }));
 	}
-	g_scheduler.addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, [this]() { checkCreatures(0); }));
+	g_scheduler.addEvent(createSchedulerTask(EVENT_CREATURE_THINK_INTERVAL, [this]() { checkCreatures(0); }, DISPATCHER_LANE_CREATURE));
 	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, [this]() { checkDecay(); }));
+	ProtocolStatus::updateSnapshot();
+	storageJournal.start();
+
+	if (g_config.getNumber(ConfigManager::PLAYER_SAVE_INTERVAL) > 0) {
+		g_scheduler.addEvent(createSchedulerTask(EVENT_PLAYERSAVEINTERVAL, [this]() { checkPlayerSaves(); }));
+	}
 }
 
 GameState_t Game::getGameState() const
@@ -114,7 +130,6 @@ void Game::setGameState(GameState_t newState)
 
 			loadMotdNum();
 			loadPlayersRecord();
-			loadAccountStorageValues();
 
 			g_globalEvents->startup();
 			break;
@@ -140,7 +155,7 @@ void Game::setGameState(GameState_t newState)
 			g_scheduler.stop();
 			g_databaseTasks.stop();
 			g_dispatcher.stop();
-			g_dispatcher_discord.stop();
+			g_webhooks.stop();
 			break;
 		}
 
@@ -166,51 +181,183 @@ void Game::setGameState(GameState_t newState)
 	}
 }
 
+namespace {
+
+// the creature checks are prepared in regions of 64x64 tiles of a floor
+constexpr int32_t CHECK_REGION_BITS = 6;
+
+class SaveGameStateJob final : public DispatcherJob
+{
+	public:
+		explicit SaveGameStateJob(bool savePlayers) {
+			if (g_game.getGameState() == GAME_STATE_NORMAL) {
+				g_game.setGameState(GAME_STATE_MAINTAIN);
+			}
+
+			std::cout << "Saving server..." << std::endl;
+
+			if (!g_game.saveAccountStorageValues()) {
+				std::cout << "[Error - Game::saveGameState] Failed to save account-level storage values." << std::endl;
+			}
+
+			// players that log out meanwhile are saved by the logout itself
+			if (savePlayers) {
+				const auto& players = g_game.getPlayers();
+				playerIds.reserve(players.size());
+				for (const auto& it : players) {
+					playerIds.push_back(it.first);
+				}
+			}
+		}
+
+		bool step() override {
+			switch (stage) {
+				case STAGE_PLAYERS: {
+					if (nextPlayer >= playerIds.size()) {
+						stage = STAGE_HOUSE_INFO;
+						break;
+					}
+
+					if (const auto& player = g_game.getPlayerByID(playerIds[nextPlayer++])) {
+						player->setLoginPosition(player->getPosition());
+						IOLoginData::savePlayerAsync(player);
+					}
+					break;
+				}
+
+				case STAGE_HOUSE_INFO: {
+					stage = STAGE_FINISH;
+					for (uint32_t tries = 0; tries < 3; tries++) {
+						if (IOMapSerialize::saveHouseInfo()) {
+							stage = STAGE_HOUSE_ITEMS;
+							houseItems = std::make_unique<SaveHouseItemsJob>();
+							break;
+						}
+					}
+					break;
+				}
+
+				case STAGE_HOUSE_ITEMS: {
+					if (!houseItems->step()) {
+						break;
+					}
+
+					if (!houseItems->succeeded() && ++houseItemTries < 3) {
+						houseItems = std::make_unique<SaveHouseItemsJob>();
+						break;
+					}
+
+					houseItems.reset();
+					stage = STAGE_FINISH;
+					break;
+				}
+
+				case STAGE_FINISH: {
+					g_databaseTasks.flush();
+
+					if (g_game.getGameState() == GAME_STATE_MAINTAIN) {
+						g_game.setGameState(GAME_STATE_NORMAL);
+					}
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		enum Stage_t {
+			STAGE_PLAYERS,
+			STAGE_HOUSE_INFO,
+			STAGE_HOUSE_ITEMS,
+			STAGE_FINISH,
+		};
+
+		std::vector<uint32_t> playerIds;
+		std::unique_ptr<SaveHouseItemsJob> houseItems;
+		size_t nextPlayer = 0;
+		uint32_t houseItemTries = 0;
+		Stage_t stage = STAGE_PLAYERS;
+};
+
+}
+
 void Game::saveGameState()
 {
-	if (gameState == GAME_STATE_NORMAL) {
-		setGameState(GAME_STATE_MAINTAIN);
+	SaveGameStateJob job(true);
+	job.complete();
+}
+
+void Game::scheduleSaveGameState()
+{
+	// the players are already saved one by one by checkPlayerSaves
+	const bool savePlayers = g_config.getNumber(ConfigManager::PLAYER_SAVE_INTERVAL) <= 0;
+	g_dispatcher.addJob(std::make_unique<SaveGameStateJob>(savePlayers));
+}
+
+void Game::checkPlayerSaves()
+{
+	const int64_t interval = g_config.getNumber(ConfigManager::PLAYER_SAVE_INTERVAL);
+	if (interval <= 0) {
+		return;
 	}
 
-	std::cout << "Saving server..." << std::endl;
+	g_scheduler.addEvent(createSchedulerTask(EVENT_PLAYERSAVEINTERVAL, [this]() { checkPlayerSaves(); }));
 
-	if (!saveAccountStorageValues()) {
-		std::cout << "[Error - Game::saveGameState] Failed to save account-level storage values." << std::endl;
+	// a round saves the players online at its start, evenly over the interval
+	const int64_t now = OTSYS_TIME();
+	if (nextPlayerSave >= playerSaveRound.size() && now - playerSaveRoundStart >= interval) {
+		playerSaveRound.clear();
+		playerSaveRound.reserve(players.size());
+		for (const auto& it : players) {
+			playerSaveRound.push_back(it.first);
+		}
+		nextPlayerSave = 0;
+		playerSaveRoundStart = now;
 	}
 
-	for (const auto& it : players) {
-		it.second->loginPosition = it.second->getPosition();
-		IOLoginData::savePlayer(it.second);
+	const int64_t elapsed = std::min<int64_t>(now - playerSaveRoundStart + EVENT_PLAYERSAVEINTERVAL, interval);
+	const size_t due = static_cast<size_t>(playerSaveRound.size() * elapsed / interval);
+	while (nextPlayerSave < due) {
+		// players that logged out meanwhile were saved by the logout itself
+		if (const auto& player = getPlayerByID(playerSaveRound[nextPlayerSave++])) {
+			player->setLoginPosition(player->getPosition());
+			IOLoginData::savePlayerAsync(player);
+		}
 	}
+}
 
-	Map::save();
+bool Game::loadMainMap(const std::string& filename)
+{
+	if (!loadMainMapTiles(filename)) {
+		return false;
+	}
 
-	g_databaseTasks.flush();
+	loadMainMapWorld();
+	return true;
+}
 
-	if (gameState == GAME_STATE_MAINTAIN) {
-		setGameState(GAME_STATE_NORMAL);
-	}
+bool Game::loadMainMapTiles(const std::string& filename)
+{
+	g_moveEvents->startTileFlags();
+	return map.loadTiles("data/world/" + filename + ".otbm");
 }
 
-bool Game::loadMainMap(const std::string& filename)
+void Game::loadMainMapWorld()
 {
-	if (map.loadMap("data/world/" + filename + ".otbm", true)) {
-		for (auto& [id, house] : g_game.map.houses.getHouses()) {
-			for (auto& tile : house->getTiles()) {
-				if (auto itemlist = tile->getItemList()) {
-					for (auto& item : *itemlist) {
-						if (item->getDoor() && !house->getDoorByPosition(item->getPosition())) {
-							if (item->getDoor()->getDoorId() != 0) {
-								house->addDoor(item->getDoor());
-							}
+	map.loadWorld(true);
+	for (auto& [id, house] : g_game.map.houses.getHouses()) {
+		for (auto& tile : house->getTiles()) {
+			if (auto itemlist = tile->getItemList()) {
+				for (auto& item : *itemlist) {
+					if (item->getDoor() && !house->getDoorByPosition(item->getPosition())) {
+						if (item->getDoor()->getDoorId() != 0) {
+							house->addDoor(item->getDoor());
 						}
 					}
 				}
 			}
 		}
-		return true;
 	}
-	return false;
 }
 
 void Game::loadMap(const std::string& path)
@@ -381,9 +528,9 @@ CreaturePtr Game::getCreatureByID(const uint32_t id)
 {
 	if (id <= Player::playerAutoID) {
 		return getPlayerByID(id);
-	} else if (id <= Monster::monsterAutoID) {
+	} else if (monsters.owns(id)) {
 		return getMonsterByID(id);
-	} else if (id <= Npc::npcAutoID) {
+	} else if (npcs.owns(id)) {
 		return getNpcByID(id);
 	}
 	return nullptr;
@@ -394,12 +541,7 @@ MonsterPtr Game::getMonsterByID(const uint32_t id)
 	if (id == 0) {
 		return nullptr;
 	}
-
-	const auto it = monsters.find(id);
-	if (it == monsters.end()) {
-		return nullptr;
-	}
-	return it->second;
+	return monsters.find(id);
 }
 
 NpcPtr Game::getNpcByID(const uint32_t id)
@@ -407,12 +549,7 @@ NpcPtr Game::getNpcByID(const uint32_t id)
 	if (id == 0) {
 		return nullptr;
 	}
-
-	const auto it = npcs.find(id);
-	if (it == npcs.end()) {
-		return nullptr;
-	}
-	return it->second;
+	return npcs.find(id);
 }
 
 PlayerPtr Game::getPlayerByID(const uint32_t id)
@@ -443,22 +580,21 @@ CreaturePtr Game::getCreatureByName(const std::string& s)
 		}
 	}
 
-	auto equalCreatureName = [&](const std::pair<uint32_t, CreaturePtr>& it) {
-		auto name = it.second->getName();
-		return lowerCaseName.size() == name.size() && std::equal(lowerCaseName.begin(), lowerCaseName.end(), name.begin(), [](char a, char b) {
-			return a == std::tolower(b);
-		});
-	};
+	// monster and npc names are interned, one that was never interned names none of them
+	const uint32_t nameId = InternedString::findId(lowerCaseName);
+	if (nameId == 0) {
+		return nullptr;
+	}
 
 	{
-		if (const auto it = std::ranges::find_if(npcs, equalCreatureName); it != npcs.end()) {
-			return it->second;
+		if (const auto it = std::ranges::find_if(npcs, [nameId](const NpcPtr& npc) { return npc->getNameId() == nameId; }); it != npcs.end()) {
+			return *it;
 		}
 	}
 
 	{
-		if (const auto it = std::ranges::find_if(monsters, equalCreatureName); it != monsters.end()) {
-			return it->second;
+		if (const auto it = std::ranges::find_if(monsters, [nameId](const MonsterPtr& monster) { return monster->getNameId() == nameId; }); it != monsters.end()) {
+			return *it;
 		}
 	}
 
@@ -471,9 +607,13 @@ NpcPtr Game::getNpcByName(const std::string& s) const
 		return nullptr;
 	}
 
-	const char* npcName = s.c_str();
-	for (const auto& val : npcs | std::views::values) {
-		if (caseInsensitiveEqual(npcName, val->getName())) {
+	const uint32_t nameId = InternedString::findId(s);
+	if (nameId == 0) {
+		return nullptr;
+	}
+
+	for (const auto& val : npcs) {
+		if (val->getNameId() == nameId) {
 			return val;
 		}
 	}
@@ -566,13 +706,13 @@ bool Game::placeCreature(CreaturePtr creature, const Position& pos, bool extende
 
 	SpectatorVec spectators;
 	map.getSpectators(spectators, creature->getPosition(), true);
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto tmpPlayer = spectator->getPlayer()) {
 			tmpPlayer->sendCreatureAppear(creature, creature->getPosition(), magicEffect);
 		}
 	}
 
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		spectator->onCreatureAppear(creature, true);
 	}
 
@@ -596,7 +736,7 @@ bool Game::removeCreature(CreaturePtr creature, bool isLogout/* = true*/)
 
 	SpectatorVec spectators;
 	map.getSpectators(spectators, tile->getPosition(), true);
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto player = spectator->getPlayer()) {
 			oldStackPosVector.push_back(player->canSeeCreature(creature) ? tile->getClientIndexOfCreature(player, creature) : -1);
 		}
@@ -608,14 +748,14 @@ bool Game::removeCreature(CreaturePtr creature, bool isLogout/* = true*/)
 
 	//send to client
 	size_t i = 0;
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto player = spectator->getPlayer()) {
 			player->sendRemoveTileCreature(creature, tilePosition, oldStackPosVector[i++]);
 		}
 	}
 
 	//event method
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		spectator->onRemoveCreature(creature, isLogout);
 	}
 
@@ -848,9 +988,9 @@ ReturnValue Game::internalMoveCreature(CreaturePtr creature, const Direction dir
 
 		//try to go down
 		if (currentPos.z != 7 && currentPos.z == destPos.z) {
-			auto tmpTile = map.getTile(destPos.x, destPos.y, destPos.z);
-			if (tmpTile == nullptr || (tmpTile->getGround() == nullptr && !tmpTile->hasFlag(TILESTATE_BLOCKSOLID))) {
-				tmpTile = map.getTile(destPos.x, destPos.y, destPos.z + 1);
+			// nearly every step lands on ground, the bits tell without fetching the tile
+			if ((map.getTileState(destPos.x, destPos.y, destPos.z) & (TILESTATEBIT_GROUND | TILESTATEBIT_BLOCKSOLID)) == 0) {
+				auto tmpTile = map.getTile(destPos.x, destPos.y, destPos.z + 1);
 				if (tmpTile && tmpTile->hasHeight(3) && !tmpTile->hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID)) {
 					flags |= FLAG_IGNOREBLOCKITEM | FLAG_IGNOREBLOCKCREATURE;
 					player->setDirection(direction);
@@ -1352,6 +1492,61 @@ ReturnValue Game::internalMoveItem(CylinderPtr fromCylinder,
 	return ret;
 }
 
+ReturnValue Game::internalMoveItems(CylinderPtr fromCylinder, CylinderPtr toCylinder, const ItemVector& items, uint32_t flags /*= 0*/, CreaturePtr actor /*= nullptr*/)
+{
+	uint32_t movedCount = 0;
+	return internalMoveItems(fromCylinder, toCylinder, items, flags, actor, movedCount);
+}
+
+ReturnValue Game::internalMoveItems(CylinderPtr fromCylinder, CylinderPtr toCylinder, const ItemVector& items, uint32_t flags, CreaturePtr actor, uint32_t& movedCount)
+{
+	movedCount = 0;
+	if (fromCylinder == nullptr || toCylinder == nullptr) {
+		return RETURNVALUE_NOTPOSSIBLE;
+	}
+
+	if (const auto fromTile = fromCylinder->getTile()) {
+		if (const auto it = browseFields.find(fromTile); it != browseFields.end() && it->second == fromCylinder) {
+			fromCylinder = fromTile;
+		}
+	}
+
+	if (ContainerPtr toContainer = std::dynamic_pointer_cast<Container>(toCylinder)) {
+		if (toContainer->isRewardCorpse() || toContainer->getID() == ITEM_REWARD_CONTAINER) {
+			return RETURNVALUE_NOTPOSSIBLE;
+		}
+	}
+
+	ReturnValue ret = RETURNVALUE_NOERROR;
+	bool full = false;
+	for (const auto& item : items) {
+		// a script run by an earlier move may have taken it elsewhere
+		if (!item || item->isRemoved() || item->getParent() != fromCylinder) {
+			continue;
+		}
+
+		// with no room left only what stacks onto what is there still fits
+		if (full && !item->isStackable()) {
+			continue;
+		}
+
+		const ReturnValue itemRet = internalMoveItem(fromCylinder, toCylinder, INDEX_WHEREEVER, item, item->getItemCount(), std::nullopt, flags, actor);
+		if (itemRet == RETURNVALUE_NOERROR) {
+			++movedCount;
+			continue;
+		}
+
+		if (itemRet == RETURNVALUE_CONTAINERNOTENOUGHROOM || itemRet == RETURNVALUE_NOTENOUGHROOM) {
+			full = true;
+		}
+
+		if (ret == RETURNVALUE_NOERROR) {
+			ret = itemRet;
+		}
+	}
+	return ret;
+}
+
 ReturnValue Game::internalAddItem(CylinderPtr toCylinder, ItemPtr item, int32_t index /*= INDEX_WHEREEVER*/,
                                   uint32_t flags/* = 0*/, bool test/* = false*/)
 {
@@ -1473,10 +1668,8 @@ ReturnValue Game::internalRemoveItem(ItemPtr item, int32_t count /*= -1*/, bool
 		cylinder->removeThing(item, count);
 
 		if (item->isRemoved()) {
+			// a pending decay entry is dropped once it expires
 			item->onRemoved();
-			if (item->canDecay()) {
-				decayItems->remove(item);
-			}
 		}
 		cylinder->postRemoveNotification(item, nullptr, index);
 	}
@@ -2093,7 +2286,7 @@ void Game::playerCloseNpcChannel(const uint32_t playerId)
 
 	SpectatorVec spectators;
 	map.getSpectators(spectators, player->getPosition());
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto npc = spectator->getNpc()) {
 			npc->onPlayerCloseChannel(player);
 		}
@@ -2699,7 +2892,7 @@ void Game::playerRequestTrade(const uint32_t playerId, const Position& pos, uint
 		return;
 	}
 
-	if (g_config.getBoolean(ConfigManager::ONLY_INVITED_CAN_MOVE_HOUSE_ITEMS)) {
+	if (g_config.getSnapshot().onlyInvitedCanMoveHouseItems) {
 		if (tradeItem->getTile()->isHouseTile()) {
 			if (!tradeItem->getTopParent()->getCreature() && !tradeItem->getTile()->getHouse()->isInvited(player)) {
 				player->sendCancelMessage(RETURNVALUE_PLAYERISNOTINVITED);
@@ -3156,6 +3349,10 @@ void Game::playerLookInShop(const uint32_t playerId, const uint16_t spriteId, co
 		return;
 	}
 
+	if (!g_events->hasEvent(EventInfoId::PLAYER_ONLOOKINSHOP)) {
+		return;
+	}
+
 	const std::string& description = Item::getDescription(it, 1, nullptr, subType);
 	g_events->eventPlayerOnLookInShop(player, &it, subType, description);
 }
@@ -3270,7 +3467,7 @@ void Game::playerSetAttackedCreature(const uint32_t playerId, const uint32_t cre
 	}
 
 	player->setAttackedCreature(attackCreature);
-	g_dispatcher.addTask(createTask([this, id = player->getID()]() { updateCreatureWalk(id); }));
+	g_dispatcher.addTask(createTask([this, id = player->getID()]() { updateCreatureWalk(id); }, DISPATCHER_LANE_CREATURE));
 }
 
 void Game::playerFollowCreature(const uint32_t playerId, const uint32_t creatureId)
@@ -3281,7 +3478,7 @@ void Game::playerFollowCreature(const uint32_t playerId, const uint32_t creature
 	}
 
 	player->setAttackedCreature(nullptr);
-	g_dispatcher.addTask(createTask([this, id = player->getID()]() { updateCreatureWalk(id); }));
+	g_dispatcher.addTask(createTask([this, id = player->getID()]() { updateCreatureWalk(id); }, DISPATCHER_LANE_CREATURE));
 	player->setFollowCreature(getCreatureByID(creatureId));
 }
 
@@ -4588,7 +4785,7 @@ void Game::playerWhisper(const PlayerPtr& player, const std::string& text)
 	              Map::maxClientViewportY, Map::maxClientViewportY);
 
 	//send to client
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto spectatorPlayer = spectator->getPlayer()) {
 			if (!Position::areInRange<1, 1>(player->getPosition(), spectatorPlayer->getPosition())) {
 				spectatorPlayer->sendCreatureSay(player, TALKTYPE_WHISPER, "pspsps");
@@ -4599,7 +4796,7 @@ void Game::playerWhisper(const PlayerPtr& player, const std::string& text)
 	}
 
 	//event method
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		spectator->onCreatureSay(player, TALKTYPE_WHISPER, text);
 	}
 }
@@ -4638,7 +4835,7 @@ bool Game::playerSpeakTo(const PlayerPtr& player, SpeakClasses type, const std::
                          const std::string& text)
 {
 	const auto toPlayer = getPlayerByName(receiver);
-	if (!toPlayer) {
+	if (!toPlayer && !g_worldBus.isRemoteOnline(receiver)) {
 		player->sendTextMessage(MESSAGE_STATUS_SMALL, "A player with this name is not online.");
 		return false;
 	}
@@ -4670,6 +4867,13 @@ bool Game::playerSpeakTo(const PlayerPtr& player, SpeakClasses type, const std::
 		}
 	}
 
+	// online on another world
+	if (!toPlayer) {
+		g_worldBus.publishPrivateMessage(player, type, receiver, text);
+		player->sendTextMessage(MESSAGE_STATUS_SMALL, fmt::format("Message sent to {:s}.", receiver));
+		return true;
+	}
+
 	toPlayer->sendPrivateMessage(player, type, text);
 	toPlayer->onCreatureSay(player, type, text);
 
@@ -4685,7 +4889,7 @@ void Game::playerSpeakToNpc(const PlayerPtr& player, const std::string& text)
 {
 	SpectatorVec spectators;
 	map.getSpectators(spectators, player->getPosition());
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (spectator->getNpc()) {
 			spectator->onCreatureSay(player, TALKTYPE_PRIVATE_PN, text);
 		}
@@ -4713,11 +4917,8 @@ bool Game::internalCreatureTurn(const CreaturePtr& creature, const Direction dir
 	creature->setDirection(dir);
 
 	//send to client
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendCreatureTurn(creature);
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendCreatureTurn(creature);
 	}
 	return true;
 }
@@ -4733,38 +4934,39 @@ bool Game::internalCreatureSay(const CreaturePtr& creature, const SpeakClasses t
 		pos = &creature->getPosition();
 	}
 
-	SpectatorVec spectators;
-
+	SpectatorVec localSpectators;
 	if (!spectatorsPtr || spectatorsPtr->empty()) {
-		// This somewhat complex construct ensures that the cached SpectatorVec
-		// is used if available and if it can be used, else a local vector is
-		// used (hopefully the compiler will optimize away the construction of
-		// the temporary when it's not used).
 		if (type != TALKTYPE_YELL && type != TALKTYPE_MONSTER_YELL) {
-			map.getSpectators(spectators, *pos, false, false,
+			map.getSpectators(localSpectators, *pos, false, false,
 			              Map::maxClientViewportX, Map::maxClientViewportX,
 			              Map::maxClientViewportY, Map::maxClientViewportY);
 		} else {
-			map.getSpectators(spectators, *pos, true, false, 18, 18, 14, 14);
+			map.getSpectators(localSpectators, *pos, true, false, 18, 18, 14, 14);
 		}
-	} else {
-		spectators = (*spectatorsPtr);
+		spectatorsPtr = &localSpectators;
 	}
+	const SpectatorVec& spectators = *spectatorsPtr;
 
 	//send to client
-	for (const auto spectator : spectators) {
+	NetworkMessage msg;
+	ProtocolGame::AddCreatureSay(msg, creature, type, text, pos);
+	for (const auto& spectator : spectators) {
 		if (const auto tmpPlayer = spectator->getPlayer()) {
 			if (!ghostMode || tmpPlayer->canSeeCreature(creature)) {
-				tmpPlayer->sendCreatureSay(creature, type, text, pos);
+				tmpPlayer->sendBroadcast(msg);
 			}
 		}
 	}
 
 	//event method
 	if (!echo) {
-		for (const auto spectator : spectators) {
-			spectator->onCreatureSay(creature, type, text);
-			if (creature != spectator) {
+		const bool hearEvent = g_events->hasEvent(EventInfoId::CREATURE_ONHEAR);
+		for (const auto& spectator : spectators) {
+			// players, and monsters and npcs without a say script, do nothing with it
+			if (spectator->listensToSpeech()) {
+				spectator->onCreatureSay(creature, type, text);
+			}
+			if (hearEvent && creature != spectator) {
 				g_events->eventCreatureOnHear(spectator, creature, text, type);
 			}
 		}
@@ -4806,42 +5008,140 @@ void Game::addCreatureCheck(const CreaturePtr& creature)
 		return;
 	}
 
+	const uint8_t bucket = uniform_random(0, EVENT_CREATURECOUNT - 1);
+	auto& checkCreatureList = checkCreatureLists[bucket];
 	creature->inCheckCreaturesVector = true;
-	checkCreatureLists[uniform_random(0, EVENT_CREATURECOUNT - 1)].push_back(creature);
+	creature->checkCreatureBucket = bucket;
+	creature->checkCreatureIndex = checkCreatureList.size();
+	checkCreatureList.push_back(creature);
 }
 
 void Game::removeCreatureCheck(const CreaturePtr& creature)
 {
-	if (creature->inCheckCreaturesVector) {
-		creature->creatureCheck = false;
+	if (!creature->inCheckCreaturesVector) {
+		return;
+	}
+
+	creature->creatureCheck = false;
+	if (creature->checkCreatureBucket == checkCreatureBucket) {
+		// checkCreatures is walking this bucket, it drops the creature itself
+		return;
+	}
+
+	auto& checkCreatureList = checkCreatureLists[creature->checkCreatureBucket];
+	const uint32_t index = creature->checkCreatureIndex;
+	if (index != checkCreatureList.size() - 1) {
+		checkCreatureList[index] = std::move(checkCreatureList.back());
+		checkCreatureList[index]->checkCreatureIndex = index;
 	}
+	creature->inCheckCreaturesVector = false;
+	checkCreatureList.pop_back();
 }
 
 void Game::checkCreatures(const size_t index)
 {
-	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, [=, this]() { checkCreatures((index + 1) % EVENT_CREATURECOUNT); }));
+	TickPhaseTimer timer(TICK_PHASE_CREATURES);
+	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, [=, this]() { checkCreatures((index + 1) % EVENT_CREATURECOUNT); }, DISPATCHER_LANE_CREATURE));
 
+	checkCreatureBucket = index;
+
+	// indexed on purpose, thinking creatures may append to this very bucket
 	auto& checkCreatureList = checkCreatureLists[index];
-	auto it = checkCreatureList.begin();
-	const auto end = checkCreatureList.end();
-	while (it != end) {
-		if (const auto creature = *it; creature->creatureCheck) {
+	if (g_thinkPool.isRunning()) {
+		prepareCreatureChecks(checkCreatureList);
+	}
+
+	size_t i = 0;
+	while (i < checkCreatureList.size()) {
+		// the list keeps the creature alive, no need to copy the shared pointer
+		Creature* creature = checkCreatureList[i].get();
+		if (creature->creatureCheck) {
 			if (creature->getHealth() > 0) {
+				TickSourceTimer source(creature);
 				creature->onThink(EVENT_CREATURE_THINK_INTERVAL);
 				creature->onAttacking(EVENT_CREATURE_THINK_INTERVAL);
 				creature->executeConditions(EVENT_CREATURE_THINK_INTERVAL);
 			}
-			++it;
+			++i;
 		} else {
 			creature->inCheckCreaturesVector = false;
-			it = checkCreatureList.erase(it);
-			// ReleaseCreature(creature);
+			if (i != checkCreatureList.size() - 1) {
+				checkCreatureList[i] = std::move(checkCreatureList.back());
+				checkCreatureList[i]->checkCreatureIndex = i;
+			}
+			checkCreatureList.pop_back();
 		}
 	}
 
+	checkCreatureBucket = -1;
+
 	cleanup();
 }
 
+void Game::prepareCreatureChecks(const std::vector<CreaturePtr>& creatures)
+{
+	// the monsters are split by region, a worker collects the lines of a whole region at a time
+	for (CheckRegion& region : checkCreatureRegions) {
+		region.monsters.clear();
+		region.sightLines.clear();
+	}
+	checkCreatureRegionIndex.clear();
+
+	size_t regionCount = 0;
+	for (const auto& creature : creatures) {
+		if (!creature->creatureCheck || creature->getHealth() <= 0) {
+			continue;
+		}
+
+		Monster* monster = creature->getMonster().get();
+		if (!monster) {
+			continue;
+		}
+
+		const Position& pos = monster->getPosition();
+		const uint32_t key = (pos.x >> CHECK_REGION_BITS) | ((pos.y >> CHECK_REGION_BITS) << 10) | (static_cast<uint32_t>(pos.z) << 20);
+		const auto [it, inserted] = checkCreatureRegionIndex.try_emplace(key, regionCount);
+		if (inserted && ++regionCount > checkCreatureRegions.size()) {
+			checkCreatureRegions.emplace_back();
+		}
+		checkCreatureRegions[it->second].monsters.push_back(monster);
+	}
+
+	// the lines targeting and attacking will trace from each monster to the targets it keeps
+	g_thinkPool.parallelFor(regionCount, [this](size_t i) {
+		CheckRegion& region = checkCreatureRegions[i];
+		for (Monster* monster : region.monsters) {
+			const Position& pos = monster->getPosition();
+			for (const auto& weakTarget : monster->getTargetList()) {
+				const auto target = weakTarget.lock();
+				if (!target) {
+					continue;
+				}
+
+				const Position& targetPos = target->getPosition();
+				// neighbours see each other without a trace
+				if (targetPos.z != pos.z || (Position::getDistanceX(pos, targetPos) < 2 && Position::getDistanceY(pos, targetPos) < 2)) {
+					continue;
+				}
+				region.sightLines.push_back({pos.x, pos.y, targetPos.x, targetPos.y, pos.z});
+			}
+		}
+	}, 1);
+
+	checkCreatureSightLines.clear();
+	for (size_t i = 0; i < regionCount; ++i) {
+		const auto& lines = checkCreatureRegions[i].sightLines;
+		checkCreatureSightLines.insert(checkCreatureSightLines.end(), lines.begin(), lines.end());
+	}
+
+	// a crowd that left a corner of the map does not keep its region around forever
+	if (checkCreatureRegions.size() > regionCount * 2 + 64) {
+		checkCreatureRegions.resize(regionCount);
+	}
+
+	map.prepareSightLines(checkCreatureSightLines);
+}
+
 void Game::changeSpeed(const CreaturePtr& creature, const int32_t varSpeedDelta)
 {
 	int32_t varSpeed = creature->getSpeed() - creature->getBaseSpeed();
@@ -4850,11 +5150,17 @@ void Game::changeSpeed(const CreaturePtr& creature, const int32_t varSpeedDelta)
 	creature->setSpeed(varSpeed);
 
 	//send to clients
-	SpectatorVec spectators;
+	SpectatorView spectators;
 	map.getSpectators(spectators, creature->getPosition(), false, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendChangeSpeed(creature, creature->getStepSpeed());
+	if (spectators.empty()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddChangeSpeed(msg, creature, creature->getStepSpeed());
+	for (Creature* spectator : spectators) {
+		assert(dynamic_cast<Player*>(spectator) != nullptr);
+		static_cast<Player*>(spectator)->sendBroadcast(msg);
 	}
 }
 
@@ -4871,33 +5177,24 @@ void Game::internalCreatureChangeOutfit(const CreaturePtr& creature, const Outfi
 	}
 
 	//send to clients
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendCreatureChangeOutfit(creature, outfit);
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendCreatureChangeOutfit(creature, outfit);
 	}
 }
 
 void Game::internalCreatureChangeVisible(const CreaturePtr& creature, bool visible)
 {
 	//send to clients
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendCreatureChangeVisible(creature, visible);
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendCreatureChangeVisible(creature, visible);
 	}
 }
 
 void Game::changeLight(const CreatureConstPtr& creature)
 {
 	//send to clients
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendCreatureLight(creature);
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendCreatureLight(creature);
 	}
 }
 
@@ -4959,7 +5256,7 @@ bool Game::combatBlockHit(CombatDamage& damage, const CreaturePtr& attacker, con
 			g_events->eventCreatureOnAttack(attacker, target, primaryBlockType, damage.primary.type, damage.origin, damage.critical, damage.leeched);
 			g_events->eventCreatureOnDefend(target, attacker, primaryBlockType, damage.primary.type, damage.origin, damage.critical, damage.leeched);
 
-			if (const auto& aggressor = attacker->getPlayer()) {
+			if (const auto& aggressor = attacker->getPlayer(); aggressor && g_events->hasEvent(EventInfoId::ITEM_ONATTACK)) {
 				for (int32_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_LAST; ++slot) {
 					const auto& item = aggressor->getInventoryItem(static_cast<slots_t>(slot));
 					if ((!item) or (item->getAttack() <= 0) ) {
@@ -4969,7 +5266,7 @@ bool Game::combatBlockHit(CombatDamage& damage, const CreaturePtr& attacker, con
 				}
 			}
 
-			if (const auto& victim = target->getPlayer()) {
+			if (const auto& victim = target->getPlayer(); victim && g_events->hasEvent(EventInfoId::ITEM_ONDEFEND)) {
 				for (int32_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_LAST; ++slot) {
 					const auto& item = victim->getInventoryItem(static_cast<slots_t>(slot));
 					if ((!item) or (item->getDefense() <= 0 and item->getArmor() <= 0)  ){
@@ -4992,7 +5289,7 @@ bool Game::combatBlockHit(CombatDamage& damage, const CreaturePtr& attacker, con
 			g_events->eventCreatureOnAttack(attacker, target, secondaryBlockType, damage.secondary.type, damage.origin, damage.critical, damage.leeched);
 			g_events->eventCreatureOnDefend(target, attacker, secondaryBlockType, damage.secondary.type, damage.origin, damage.critical, damage.leeched);
 
-			if (const auto aggressor = attacker->getPlayer()) {
+			if (const auto aggressor = attacker->getPlayer(); aggressor && g_events->hasEvent(EventInfoId::ITEM_ONATTACK)) {
 				for (int32_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_LAST; ++slot) {
 					const auto item = aggressor->getInventoryItem(static_cast<slots_t>(slot));
 					if (!item) {
@@ -5004,7 +5301,7 @@ bool Game::combatBlockHit(CombatDamage& damage, const CreaturePtr& attacker, con
 				}
 			}
 
-			if (const auto victim = target->getPlayer()) {
+			if (const auto victim = target->getPlayer(); victim && g_events->hasEvent(EventInfoId::ITEM_ONDEFEND)) {
 				for (int32_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_LAST; ++slot) {
 					const auto item = victim->getInventoryItem(static_cast<slots_t>(slot));
 					if (!item) {
@@ -5173,8 +5470,7 @@ bool Game::combatChangeHealth(const CreaturePtr& attacker, const CreaturePtr& ta
 						int32_t dx = targetPos.x - monsterPos.x;
 						int32_t dy = targetPos.y - monsterPos.y;
 						if (dx * dx + dy * dy < 49) { // 7^2 = 49
-							uint32_t playerGuid = targetPlayer->getGUID();
-							rewardBossTracking[monsterId].playerScoreTable[playerGuid].damageTaken += realHealthChange * g_config.getFloat(ConfigManager::REWARD_RATE_HEALING_DONE);
+							rewardBossTracking[monsterId].addDamageTaken(targetPlayer->getGUID(), realHealthChange * g_config.getFloat(ConfigManager::REWARD_RATE_HEALING_DONE));
 						}
 					}
 				}
@@ -5204,7 +5500,7 @@ bool Game::combatChangeHealth(const CreaturePtr& attacker, const CreaturePtr& ta
 			message.primary.color = TEXTCOLOR_PASTELRED;
 
 			SpectatorVec spectators;
-			map.getSpectators(spectators, targetPos, false, true);
+			getCombatSpectators(spectators, targetPos, false);
 
 			for (const auto& spectator : spectators) {
 				auto spectatorPlayer = std::static_pointer_cast<Player>(spectator);
@@ -5246,7 +5542,7 @@ bool Game::combatChangeHealth(const CreaturePtr& attacker, const CreaturePtr& ta
 		message.position = targetPos;
 
 		SpectatorVec spectators;
-		map.getSpectators(spectators, targetPos, true, true);
+		getCombatSpectators(spectators, targetPos, true);
 
 		if (targetPlayer && targetPlayer->hasCondition(CONDITION_MANASHIELD) && damage.primary.type != COMBAT_UNDEFINEDDAMAGE) {
 			if (int32_t manaDamage = std::min<int32_t>(targetPlayer->getMana(), healthChange); manaDamage != 0) {
@@ -5401,25 +5697,17 @@ bool Game::combatChangeHealth(const CreaturePtr& attacker, const CreaturePtr& ta
 
 		// Reward boss tracking: player attacking boss
 		if (target && target->getMonster() && target->getMonster()->isRewardBoss()) {
-			uint32_t monsterId = target->getMonster()->getID();
-			if (!rewardBossTracking.contains(monsterId)) {
-				rewardBossTracking[monsterId] = RewardBossContributionInfo();
-			}
+			auto& contributions = rewardBossTracking[target->getMonster()->getID()];
 			if (attackerPlayer) {
-				uint32_t playerGuid = attackerPlayer->getGUID();
-				rewardBossTracking[monsterId].playerScoreTable[playerGuid].damageDone += realDamage * g_config.getFloat(ConfigManager::REWARD_RATE_DAMAGE_DONE);
+				contributions.addDamageDone(attackerPlayer->getGUID(), realDamage * g_config.getFloat(ConfigManager::REWARD_RATE_DAMAGE_DONE));
 			}
 		}
 
 		// Reward boss tracking: boss attacking player
 		if (attacker && attacker->getMonster() && attacker->getMonster()->isRewardBoss()) {
-			uint32_t monsterId = attacker->getMonster()->getID();
-			if (!rewardBossTracking.contains(monsterId)) {
-				rewardBossTracking[monsterId] = RewardBossContributionInfo();
-			}
+			auto& contributions = rewardBossTracking[attacker->getMonster()->getID()];
 			if (target && target->getPlayer()) {
-				uint32_t playerGuid = target->getPlayer()->getGUID();
-				rewardBossTracking[monsterId].playerScoreTable[playerGuid].damageTaken += realDamage * g_config.getFloat(ConfigManager::REWARD_RATE_DAMAGE_TAKEN);
+				contributions.addDamageTaken(target->getPlayer()->getGUID(), realDamage * g_config.getFloat(ConfigManager::REWARD_RATE_DAMAGE_TAKEN));
 			}
 		}
 
@@ -5434,7 +5722,7 @@ bool Game::combatChangeHealth(const CreaturePtr& attacker, const CreaturePtr& ta
 
 		// Apply damage and update spectators
 		target->drainHealth(attacker, realDamage);
-		addCreatureHealth(spectators, target);
+		addCombatHealth(spectators, target);
 	}
 
 	return true;
@@ -5540,7 +5828,7 @@ bool Game::combatChangeMana(const CreaturePtr& attacker, const CreaturePtr& targ
 		message.primary.color = TEXTCOLOR_BLUE;
 
 		SpectatorVec spectators;
-		map.getSpectators(spectators, targetPos, false, true);
+		getCombatSpectators(spectators, targetPos, false);
 		for (const auto& spectator : spectators) {
 			PlayerPtr spectatorPlayer = std::static_pointer_cast<Player>(spectator);
 			if (spectatorPlayer == attackerPlayer && attackerPlayer != targetPlayer) {
@@ -5571,122 +5859,280 @@ bool Game::combatChangeMana(const CreaturePtr& attacker, const CreaturePtr& targ
 	return true;
 }
 
+void Game::beginCombatBatch(const SpectatorVec& spectators)
+{
+	combatBatches.emplace_back().spectators = spectators;
+}
+
+void Game::endCombatBatch()
+{
+	if (combatBatches.empty()) {
+		return;
+	}
+
+	const CombatBatch batch = std::move(combatBatches.back());
+	combatBatches.pop_back();
+	if (batch.healthTargets.empty()) {
+		return;
+	}
+
+	// one message per viewer with the bars of every target it sees
+	for (const auto& spectator : batch.spectators) {
+		const auto& player = spectator->getPlayer();
+		if (!player || player->isRemoved()) {
+			continue;
+		}
+
+		NetworkMessage msg;
+		for (const auto& target : batch.healthTargets) {
+			if (!target->isRemoved() && map.isInSpectatorRange(target->getPosition(), player->getPosition())) {
+				ProtocolGame::AddCreatureHealth(msg, target);
+			}
+		}
+
+		if (msg.getLength() != 0) {
+			player->sendBroadcast(msg);
+		}
+	}
+}
+
+void Game::getCombatSpectators(SpectatorVec& spectators, const Position& pos, const bool multifloor)
+{
+	if (combatBatches.empty()) {
+		map.getSpectators(spectators, pos, multifloor, true);
+		return;
+	}
+
+	for (const auto& spectator : combatBatches.back().spectators) {
+		if (map.isInSpectatorRange(pos, spectator->getPosition(), multifloor)) {
+			spectators.emplace_back(spectator);
+		}
+	}
+}
+
+void Game::addCombatHealth(const SpectatorVec& spectators, const CreaturePtr& target)
+{
+	if (combatBatches.empty()) {
+		addCreatureHealth(spectators, target);
+		return;
+	}
+
+	auto& targets = combatBatches.back().healthTargets;
+	if (std::ranges::find(targets, target) == targets.end()) {
+		targets.emplace_back(target);
+	}
+}
+
 void Game::addCreatureHealth(const CreatureConstPtr& target)
 {
-	SpectatorVec spectators;
-	map.getSpectators(spectators, target->getPosition(), true, true);
-	addCreatureHealth(spectators, target);
+	const auto& observers = target->getObservers();
+	if (observers.empty()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddCreatureHealth(msg, target);
+	for (Player* spectator : observers) {
+		spectator->sendBroadcast(msg);
+	}
 }
 
 void Game::addCreatureHealth(const SpectatorVec& spectators, const CreatureConstPtr& target)
 {
-	for (const auto spectator : spectators) {
+	NetworkMessage msg;
+	ProtocolGame::AddCreatureHealth(msg, target);
+	for (const auto& spectator : spectators) {
 		if (const auto tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendCreatureHealth(target);
+			tmpPlayer->sendBroadcast(msg);
 		}
 	}
 }
 
 void Game::addMagicEffect(const Position& pos, const uint8_t effect)
 {
-	SpectatorVec spectators;
+	if (g_config.getBoolean(ConfigManager::COALESCE_EFFECTS)) {
+		pendingMagicEffects.emplace_back(pos, effect);
+		if (!effectFlushScheduled) {
+			effectFlushScheduled = true;
+			g_dispatcher.addTask(createTask([this]() { flushEffects(); }));
+		}
+		return;
+	}
+	broadcastMagicEffect(pos, effect);
+}
+
+void Game::broadcastMagicEffect(const Position& pos, const uint8_t effect)
+{
+	SpectatorView spectators;
 	map.getSpectators(spectators, pos, true, true);
-	addMagicEffect(spectators, pos, effect);
+	if (spectators.empty()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddMagicEffect(msg, pos, effect);
+	for (Creature* spectator : spectators) {
+		static_cast<Player*>(spectator)->sendMagicEffect(pos, msg);
+	}
 }
 
 void Game::addMagicEffect(const SpectatorVec& spectators, const Position& pos, const uint8_t effect)
 {
-	for (const auto spectator : spectators) {
+	NetworkMessage msg;
+	ProtocolGame::AddMagicEffect(msg, pos, effect);
+	for (const auto& spectator : spectators) {
 		if (const auto tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendMagicEffect(pos, effect);
+			tmpPlayer->sendMagicEffect(pos, msg);
 		}
 	}
 }
 
 void Game::addDistanceEffect(const Position& fromPos, const Position& toPos, const uint8_t effect)
 {
-	SpectatorVec spectators, toPosSpectators;
+	if (g_config.getBoolean(ConfigManager::COALESCE_EFFECTS)) {
+		pendingDistanceEffects.emplace_back(fromPos, toPos, effect);
+		if (!effectFlushScheduled) {
+			effectFlushScheduled = true;
+			g_dispatcher.addTask(createTask([this]() { flushEffects(); }));
+		}
+		return;
+	}
+	broadcastDistanceEffect(fromPos, toPos, effect);
+}
+
+void Game::broadcastDistanceEffect(const Position& fromPos, const Position& toPos, const uint8_t effect)
+{
+	SpectatorView spectators;
 	map.getSpectators(spectators, fromPos, true, true);
-	map.getSpectators(toPosSpectators, toPos, true, true);
-	spectators.addSpectators(toPosSpectators);
+	map.getSpectators(spectators, toPos, true, true);
+	if (spectators.empty()) {
+		return;
+	}
 
-	addDistanceEffect(spectators, fromPos, toPos, effect);
+	NetworkMessage msg;
+	ProtocolGame::AddDistanceShoot(msg, fromPos, toPos, effect);
+	for (Creature* spectator : spectators) {
+		static_cast<Player*>(spectator)->sendDistanceShoot(fromPos, toPos, msg);
+	}
 }
 
 void Game::addDistanceEffect(const SpectatorVec& spectators, const Position& fromPos, const Position& toPos, uint8_t effect)
 {
-	for (const auto spectator : spectators) {
+	NetworkMessage msg;
+	ProtocolGame::AddDistanceShoot(msg, fromPos, toPos, effect);
+	for (const auto& spectator : spectators) {
 		if (const auto tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendDistanceShoot(fromPos, toPos, effect);
+			tmpPlayer->sendDistanceShoot(fromPos, toPos, msg);
 		}
 	}
 }
 
-void Game::setAccountStorageValue(const uint32_t accountId, const uint32_t key, const int32_t value)
+void Game::flushEffects()
 {
-	if (value == -1) {
-		accountStorageMap[accountId].erase(key);
-		return;
+	effectFlushScheduled = false;
+
+	// an area spell cast many times over in one round leaves the same effects
+	std::sort(pendingMagicEffects.begin(), pendingMagicEffects.end());
+	const auto magicEnd = std::unique(pendingMagicEffects.begin(), pendingMagicEffects.end());
+	for (auto it = pendingMagicEffects.begin(); it != magicEnd; ++it) {
+		broadcastMagicEffect(it->first, it->second);
 	}
+	pendingMagicEffects.clear();
 
-	accountStorageMap[accountId][key] = value;
+	std::sort(pendingDistanceEffects.begin(), pendingDistanceEffects.end());
+	const auto distanceEnd = std::unique(pendingDistanceEffects.begin(), pendingDistanceEffects.end());
+	for (auto it = pendingDistanceEffects.begin(); it != distanceEnd; ++it) {
+		broadcastDistanceEffect(std::get<0>(*it), std::get<1>(*it), std::get<2>(*it));
+	}
+	pendingDistanceEffects.clear();
 }
 
-int32_t Game::getAccountStorageValue(const uint32_t accountId, const uint32_t key) const
+void Game::addPlayerUpdate(const PlayerPtr& player)
 {
-	const auto& accountMapIt = accountStorageMap.find(accountId);
-	if (accountMapIt != accountStorageMap.end()) {
-		const auto& storageMapIt = accountMapIt->second.find(key);
-		if (storageMapIt != accountMapIt->second.end()) {
-			return storageMapIt->second;
-		}
+	pendingPlayerUpdates.push_back(player);
+	if (!playerUpdateFlushScheduled) {
+		playerUpdateFlushScheduled = true;
+		g_dispatcher.addTask(createTask([this]() { flushPlayerUpdates(); }));
 	}
-	return -1;
 }
 
-void Game::loadAccountStorageValues()
+void Game::flushPlayerUpdates()
 {
-	Database& db = Database::getInstance();
+	playerUpdateFlushScheduled = false;
 
-	DBResult_ptr result;
-	if ((result = db.storeQuery("SELECT `account_id`, `key`, `value` FROM `account_storage`"))) {
-		do {
-			g_game.setAccountStorageValue(result->getNumber<uint32_t>("account_id"), result->getNumber<uint32_t>("key"), result->getNumber<int32_t>("value"));
-		} while (result->next());
+	// a combat round or a change of equipment asks for the stats many times over
+	std::vector<PlayerPtr> updates;
+	updates.swap(pendingPlayerUpdates);
+	for (const auto& player : updates) {
+		player->sendPendingUpdates();
 	}
 }
 
-bool Game::saveAccountStorageValues() const
+void Game::setAccountStorageValue(const uint32_t accountId, const uint32_t key, const int32_t value)
 {
-	DBTransaction transaction;
-	Database& db = Database::getInstance();
+	storageJournal.record(STORAGE_TABLE_ACCOUNT, accountId, key, value);
+	if (value == -1) {
+		getAccountStorage(accountId).erase(key);
+		return;
+	}
 
-	if (!transaction.begin()) {
-		return false;
+	getAccountStorage(accountId)[key] = value;
+}
+
+int32_t Game::getAccountStorageValue(const uint32_t accountId, const uint32_t key)
+{
+	const auto& storage = getAccountStorage(accountId);
+	const auto it = storage.find(key);
+	return it != storage.end() ? it->second : -1;
+}
+
+void Game::loadAccountStorage(uint32_t accountId, const DBResult_ptr& result)
+{
+	const auto [it, inserted] = accountStorageMap.try_emplace(accountId);
+	if (!inserted) {
+		return;
 	}
 
-	if (!db.executeQuery("DELETE FROM `account_storage`")) {
-		return false;
+	auto& storage = it->second;
+	if (result) {
+		do {
+			storage[result->getNumber<uint32_t>("key")] = result->getNumber<int32_t>("value");
+		} while (result->next());
 	}
 
-	for (const auto& accountIt : g_game.accountStorageMap) {
-		if (accountIt.second.empty()) {
-			continue;
+	// changes that did not reach the table yet are newer than its rows
+	storageJournal.forEachChange(STORAGE_TABLE_ACCOUNT, accountId, [&storage](uint32_t key, int32_t value) {
+		if (value == -1) {
+			storage.erase(key);
+		} else {
+			storage[key] = value;
 		}
+	});
+}
 
-		DBInsert accountStorageQuery("INSERT INTO `account_storage` (`account_id`, `key`, `value`) VALUES");
-		for (const auto& storageIt : accountIt.second) {
-			if (!accountStorageQuery.addRow(fmt::format("{:d}, {:d}, {:d}", accountIt.first, storageIt.first, storageIt.second))) {
-				return false;
-			}
-		}
+gtl::flat_hash_map<uint32_t, int32_t>& Game::getAccountStorage(uint32_t accountId)
+{
+	auto it = accountStorageMap.find(accountId);
+	if (it == accountStorageMap.end()) {
+		loadAccountStorage(accountId, Database::getInstance().storeQuery(fmt::format("SELECT `key`, `value` FROM `account_storage` WHERE `account_id` = {:d}", accountId)));
+		it = accountStorageMap.find(accountId);
+	}
+	return it->second;
+}
 
-		if (!accountStorageQuery.execute()) {
-			return false;
+bool Game::saveAccountStorageValues()
+{
+	// the values of accounts without a character online are read again when a script asks
+	for (auto it = accountStorageMap.begin(); it != accountStorageMap.end();) {
+		if (!accountPlayers.contains(it->first)) {
+			accountStorageMap.erase(it++);
+		} else {
+			++it;
 		}
 	}
 
-	return transaction.commit();
+	// every change is in the journal, only those are written
+	return storageJournal.flush();
 }
 
 void Game::startDecay(const ItemPtr& item)
@@ -5721,60 +6167,55 @@ void Game::internalDecayItem(const ItemPtr& item)
 
 void Game::checkDecay()
 {
+	TickPhaseTimer timer(TICK_PHASE_DECAY);
 	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, [=, this]() { checkDecay(); }));
 
-	const size_t bucket = (lastBucket + 1) % EVENT_DECAY_BUCKETS;
+	decayWheel.advance(OTSYS_TIME(), expiredDecays);
+	for (const auto& [item, expiry] : expiredDecays) {
+		// stopped or rescheduled since this entry was added
+		if (item->getDecaying() != DECAYING_TRUE || item->getDurationTimestamp() != expiry) {
+			continue;
+		}
 
-	auto it = decayItems[bucket].begin();
-	const auto end = decayItems[bucket].end();
-	while (it != end) {
-		const auto item = *it;
 		if (!item->canDecay()) {
 			item->setDecaying(DECAYING_FALSE);
-			// ReleaseItem(item);
-			it = decayItems[bucket].erase(it);
 			continue;
 		}
 
-		int32_t duration = item->getDuration();
-		const int32_t decreaseTime = std::min<int32_t>(EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS, duration);
-
-		duration -= decreaseTime;
-		item->decreaseDuration(decreaseTime);
-
-		if (duration <= 0) {
-			it = decayItems[bucket].erase(it);
-			internalDecayItem(item);
-			// ReleaseItem(item);
-		} else if (duration < EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-			it = decayItems[bucket].erase(it);
-			if (const size_t newBucket = (bucket + ((duration + EVENT_DECAYINTERVAL / 2) / 1000)) % EVENT_DECAY_BUCKETS; newBucket == bucket) {
-				internalDecayItem(item);
-				// ReleaseItem(item);
-			} else {
-				decayItems[newBucket].push_back(item);
-			}
-		} else {
-			++it;
-		}
+		// out of the wheel, nothing is left of the duration
+		item->removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
+		item->setIntAttr(ITEM_ATTRIBUTE_DURATION, 0);
+		internalDecayItem(item);
 	}
+	expiredDecays.clear();
 
-	lastBucket = bucket;
 	cleanup();
 }
 
 void Game::checkLight()
 {
+	TickPhaseTimer timer(TICK_PHASE_LIGHT);
 	g_scheduler.addEvent(createSchedulerTask(EVENT_LIGHTINTERVAL, [=, this]() { checkLight(); }));
 	uint8_t previousLightLevel = lightLevel;
 	updateWorldLightLevel();
 	
 	if (previousLightLevel != lightLevel) {
-		LightInfo lightInfo = getWorldLightInfo();
+		broadcastWorldLight(getWorldLightInfo());
+	}
+}
 
-		for (const auto& val : players | std::views::values) {
-			val->sendWorldLight(lightInfo);
-		}
+void Game::broadcastWorldLight(LightInfo lightInfo) const
+{
+	if (players.empty()) {
+		return;
+	}
+
+	NetworkMessage msg;
+	ProtocolGame::AddWorldLight(msg, lightInfo.level, lightInfo.color);
+	NetworkMessage accessMsg;
+	ProtocolGame::AddWorldLight(accessMsg, 0xFF, lightInfo.color);
+	for (const auto& player : players | std::views::values) {
+		player->sendBroadcast(player->isAccessPlayer() ? accessMsg : msg);
 	}
 }
 
@@ -5824,10 +6265,21 @@ void Game::shutdown()
 {
 	std::cout << "Shutting down..." << std::flush;
 
+	const std::string& profile = g_luaProfiler.stop();
+	if (!profile.empty()) {
+		std::cout << " Lua profile written to " << profile << "..." << std::flush;
+	}
+
 	g_scheduler.shutdown();
+	storageJournal.flush();
 	g_databaseTasks.shutdown();
+	g_pathfinder.shutdown();
+	g_luaWorkers.shutdown();
+	g_thinkPool.shutdown();
+	g_cryptoPool.shutdown();
 	g_dispatcher.shutdown();
-	g_dispatcher_discord.shutdown();
+	g_webhooks.shutdown();
+	g_logWriter.shutdown();
 	map.spawns.clear();
 	raids.clear();
 
@@ -5845,13 +6297,16 @@ void Game::shutdown()
 void Game::cleanup()
 {
 	//free memory
-	for (const auto item : toDecayItems) {
-		const uint32_t dur = item->getDuration();
-		if (dur >= EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-			decayItems[lastBucket].push_back(item);
-		} else {
-			decayItems[(lastBucket + 1 + dur / 1000) % EVENT_DECAY_BUCKETS].push_back(item);
+	const int64_t now = OTSYS_TIME();
+	for (const auto& item : toDecayItems) {
+		// already waiting in the wheel, or stopped before it got there
+		if (item->getDecaying() != DECAYING_TRUE || item->hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
+			continue;
 		}
+
+		const int64_t expiry = now + item->getDuration();
+		item->setDurationTimestamp(expiry);
+		decayWheel.add(item, expiry);
 	}
 	toDecayItems.clear();
 }
@@ -5867,24 +6322,16 @@ void Game::broadcastMessage(const std::string& text, const MessageClasses type)
 void Game::updateCreatureWalkthrough(const CreatureConstPtr& creature)
 {
 	//send to clients
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-
-		const PlayerPtr spectatorPlayer = std::static_pointer_cast<Player>(spectator);
-		spectatorPlayer->sendCreatureWalkthrough(creature, spectatorPlayer->canWalkthroughEx(creature));
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendCreatureWalkthrough(creature, spectator->canWalkthroughEx(creature));
 	}
 }
 
 void Game::notifySpectators(const CreatureConstPtr& creature)
 {
 	// send to clients
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendUpdateTileCreature(creature);
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendUpdateTileCreature(creature);
 	}
 }
 
@@ -5894,21 +6341,15 @@ void Game::updateCreatureSkull(const CreatureConstPtr& creature)
 		return;
 	}
 
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendCreatureSkull(creature);
+	for (Player* spectator : creature->getObservers()) {
+		spectator->sendCreatureSkull(creature);
 	}
 }
 
 void Game::updatePlayerShield(const PlayerPtr& player)
 {
-	SpectatorVec spectators;
-	map.getSpectators(spectators, player->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
-		std::static_pointer_cast<Player>(spectator)->sendCreatureShield(player);
+	for (Player* spectator : player->getObservers()) {
+		spectator->sendCreatureShield(player);
 	}
 }
 
@@ -5917,10 +6358,8 @@ void Game::updatePlayerHelpers(const PlayerConstPtr& player)
 	uint32_t creatureId = player->getID();
 	uint16_t helpers = player->getHelpers();
 
-	SpectatorVec spectators;
-	map.getSpectators(spectators, player->getPosition(), true, true);
-	for (const auto spectator : spectators) {
-		spectator->getPlayer()->sendCreatureHelpers(creatureId, helpers);
+	for (Player* spectator : player->getObservers()) {
+		spectator->sendCreatureHelpers(creatureId, helpers);
 	}
 }
 
@@ -5940,21 +6379,17 @@ void Game::updateCreatureType(const CreaturePtr& creature)
 	}
 
 	//send to clients
-	SpectatorVec spectators;
-	map.getSpectators(spectators, creature->getPosition(), true, true);
-
 	if (creatureType == CREATURETYPE_SUMMON_HOSTILE) {
-		for (const auto spectator : spectators) {
-			const auto player = spectator->getPlayer();
-			if (masterPlayer == player) {
-				player->sendCreatureType(creatureId, CREATURETYPE_SUMMON_OWN);
+		for (Player* spectator : creature->getObservers()) {
+			if (masterPlayer.get() == spectator) {
+				spectator->sendCreatureType(creatureId, CREATURETYPE_SUMMON_OWN);
 			} else {
-				player->sendCreatureType(creatureId, creatureType);
+				spectator->sendCreatureType(creatureId, creatureType);
 			}
 		}
 	} else {
-		for (const auto spectator : spectators) {
-			spectator->getPlayer()->sendCreatureType(creatureId, creatureType);
+		for (Player* spectator : creature->getObservers()) {
+			spectator->sendCreatureType(creatureId, creatureType);
 		}
 	}
 }
@@ -6213,11 +6648,8 @@ void Game::playerDebugAssert(const uint32_t playerId, const std::string& assertL
 	}
 
 	// TODO: move debug assertions to database
-	if (const auto file = fopen("client_assertions.txt", "a")) {
-		fprintf(file, "----- %s - %s (%s) -----\n", formatDate(time(nullptr)).c_str(), player->getName().c_str(), convertIPToString(player->getIP()).c_str());
-		fprintf(file, "%s\n%s\n%s\n%s\n", assertLine.c_str(), date.c_str(), description.c_str(), comment.c_str());
-		fclose(file);
-	}
+	g_logWriter.write("client_assertions.txt", fmt::format("----- {:s} - {:s} ({:s}) -----\n{:s}\n{:s}\n{:s}\n{:s}\n", formatDate(time(nullptr)),
+		player->getName(), convertIPToString(player->getIP()), assertLine, date, description, comment));
 }
 
 void Game::playerLeaveMarket(const uint32_t playerId)
@@ -6370,7 +6802,7 @@ void Game::playerCreateMarketOffer(const uint32_t playerId, uint8_t type, const
 		const auto debitBank = fee - debitCash;
 		CylinderPtr c_player = player;
 		removeMoney(c_player, debitCash);
-		player->bankBalance -= debitBank;
+		player->setBankBalance(player->getBankBalance() - debitBank);
 	} else {
 		uint64_t totalPrice = static_cast<uint64_t>(price) * amount;
 		totalPrice += fee;
@@ -6382,7 +6814,7 @@ void Game::playerCreateMarketOffer(const uint32_t playerId, uint8_t type, const
 		const auto debitBank = totalPrice - debitCash;
 		CylinderPtr c_player = player;
 		removeMoney(c_player, debitCash);
-		player->bankBalance -= debitBank;
+		player->setBankBalance(player->getBankBalance() - debitBank);
 	}
 
 	IOMarket::createOffer(player->getGUID(), static_cast<MarketAction_t>(type), it.id, amount, price, anonymous);
@@ -6410,7 +6842,7 @@ void Game::playerCancelMarketOffer(const uint32_t playerId, const uint32_t times
 	}
 
 	if (offer.type == MARKETACTION_BUY) {
-		player->bankBalance += static_cast<uint64_t>(offer.price) * offer.amount;
+		player->setBankBalance(player->getBankBalance() + static_cast<uint64_t>(offer.price) * offer.amount);
 		player->sendMarketEnter();
 	} else {
 		const ItemType& it = Item::items[offer.itemId];
@@ -6521,7 +6953,7 @@ void Game::playerAcceptMarketOffer(const uint32_t playerId, const uint32_t times
 			}
 		}
 
-		player->bankBalance += totalPrice;
+		player->setBankBalance(player->getBankBalance() + totalPrice);
 
 		if (it.stackable) {
 			uint16_t tmpAmount = amount;
@@ -6566,7 +6998,7 @@ void Game::playerAcceptMarketOffer(const uint32_t playerId, const uint32_t times
 		const auto debitBank = totalPrice - debitCash;
 		CylinderPtr coinholder = player;
 		removeMoney(coinholder, debitCash);
-		player->bankBalance -= debitBank;
+		player->setBankBalance(player->getBankBalance() - debitBank);
 
 		if (it.stackable) {
 			uint16_t tmpAmount = amount;
@@ -6600,7 +7032,7 @@ void Game::playerAcceptMarketOffer(const uint32_t playerId, const uint32_t times
 		}
 
 		if (const auto& sellerPlayer = getPlayerByGUID(offer.playerId)) {
-			sellerPlayer->bankBalance += totalPrice;
+			sellerPlayer->setBankBalance(sellerPlayer->getBankBalance() + totalPrice);
 		} else {
 			IOLoginData::increaseBankBalance(offer.playerId, totalPrice);
 		}
@@ -6770,6 +7202,7 @@ void Game::addPlayer(PlayerPtr player)
 	mappedPlayerGuids[player->getGUID()] = player;
 	wildcardTree.insert(lowercase_name);
 	players[player->getID()] = player;
+	++accountPlayers[player->getAccount()];
 }
 
 void Game::removePlayer(const PlayerPtr& player)
@@ -6779,11 +7212,35 @@ void Game::removePlayer(const PlayerPtr& player)
 	mappedPlayerGuids.erase(player->getGUID());
 	wildcardTree.remove(lowercase_name);
 	players.erase(player->getID());
+
+	// the last character of the account takes its storage values along
+	if (auto it = accountPlayers.find(player->getAccount()); it != accountPlayers.end() && --it->second == 0) {
+		accountPlayers.erase(it);
+		accountStorageMap.erase(player->getAccount());
+	}
+}
+
+uint32_t Game::reserveNpcId(const NpcPtr& npc)
+{
+	const uint32_t id = npcs.reserve(npc);
+	if (id == 0) {
+		std::cout << "[Error - Game::reserveNpcId] Out of npc ids." << std::endl;
+	}
+	return id;
+}
+
+uint32_t Game::reserveMonsterId(const MonsterPtr& monster)
+{
+	const uint32_t id = monsters.reserve(monster);
+	if (id == 0) {
+		std::cout << "[Error - Game::reserveMonsterId] Out of monster ids." << std::endl;
+	}
+	return id;
 }
 
 void Game::addNpc(const NpcPtr& npc)
 {
-	npcs[npc->getID()] = npc;
+	npcs.insert(npc->getID(), npc);
 }
 
 void Game::removeNpc(const NpcPtr& npc)
@@ -6793,7 +7250,8 @@ void Game::removeNpc(const NpcPtr& npc)
 
 void Game::addMonster(MonsterPtr monster)
 {
-	monsters[monster->getID()] = monster;
+	const uint32_t id = monster->getID();
+	monsters.insert(id, std::move(monster));
 }
 
 void Game::removeMonster(const MonsterPtr& monster)
@@ -6875,7 +7333,13 @@ bool Game::reload(const ReloadTypes_t reloadType)
 			return true;
 	   }
 		case RELOAD_TYPE_CHAT: return g_chat->load();
-		case RELOAD_TYPE_CONFIG: return g_config.reload();
+		case RELOAD_TYPE_CONFIG: {
+			if (!g_config.reload()) {
+				return false;
+			}
+			g_luaEnvironment.setGarbageCollector(g_config.getString(ConfigManager::LUA_GC_MODE), g_config.getNumber(ConfigManager::LUA_GC_PAUSE), g_config.getNumber(ConfigManager::LUA_GC_STEP_MULTIPLIER));
+			return true;
+		}
 		case RELOAD_TYPE_CREATURESCRIPTS: {
 			g_creatureEvents->reload();
 			g_creatureEvents->removeInvalidEvents();
@@ -6883,7 +7347,17 @@ bool Game::reload(const ReloadTypes_t reloadType)
 		}
 		case RELOAD_TYPE_EVENTS: return g_events->load();
 		case RELOAD_TYPE_GLOBALEVENTS: return g_globalEvents->reload();
-		case RELOAD_TYPE_ITEMS: return Item::items.reload();
+		case RELOAD_TYPE_ITEMS: {
+			// the game goes on while the files are read, the new items take over once they are
+			const int64_t start = OTSYS_TIME();
+			return Item::items.reloadAsync([start](bool loaded) {
+				if (loaded) {
+					std::cout << ">> Items reloaded in " << (OTSYS_TIME() - start) / 1000. << " s" << std::endl;
+				} else {
+					std::cout << "[Error - Game::reload] Failed to reload items, the old ones stay." << std::endl;
+				}
+			});
+		}
 		case RELOAD_TYPE_MONSTERS: return g_monsters.reload();
 		case RELOAD_TYPE_MOUNTS: return mounts.reload();
 		case RELOAD_TYPE_MOVEMENTS: return g_moveEvents->reload();
@@ -6984,3 +7458,23 @@ void Game::resetDamageTracking(const uint32_t monsterId)
 {
 	rewardBossTracking.erase(monsterId);
 }
+
+void Game::RewardBossContributionInfo::add(const uint32_t playerGuid, int32_t PlayerScoreInfo::* field, const int32_t value)
+{
+	const auto [it, inserted] = slots.try_emplace(playerGuid, static_cast<uint32_t>(scores.size()));
+	if (inserted) {
+		playerGuids.push_back(playerGuid);
+		scores.emplace_back();
+	}
+
+	PlayerScoreInfo& score = scores[it->second];
+	score.*field += value;
+	totalScore += value;
+
+	// the first to reach the top score keeps it
+	const int32_t playerScore = score.damageDone + score.damageTaken + score.healingDone;
+	if (playerScore > topScore) {
+		topScore = playerScore;
+		topSlot = it->second;
+	}
+}
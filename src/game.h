@@ -4,8 +4,6 @@
 #ifndef FS_GAME_H
 #define FS_GAME_H
 
-#include <curl/curl.h>
-
 #include "account.h"
 #include "combat.h"
 #include "groups.h"
@@ -17,7 +15,10 @@
 #include "raids.h"
 #include "npc.h"
 #include "wildcardtree.h"
+#include "decaywheel.h"
 #include "quests.h"
+#include "storagejournal.h"
+#include "creatureregistry.h"
 
 #include <gtl/phmap.hpp>
 
@@ -62,7 +63,7 @@ static constexpr int32_t PLAYER_NAME_LENGTH = 25;
 static constexpr int32_t EVENT_LIGHTINTERVAL = 10000;
 static constexpr int32_t EVENT_WORLDTIMEINTERVAL = 2500;
 static constexpr int32_t EVENT_DECAYINTERVAL = 250;
-static constexpr int32_t EVENT_DECAY_BUCKETS = 4;
+static constexpr int32_t EVENT_PLAYERSAVEINTERVAL = 1000;
 static constexpr int32_t MOVE_CREATURE_INTERVAL = 1000;
 static constexpr int32_t RANGE_MOVE_CREATURE_INTERVAL = 1500;
 static constexpr int32_t RANGE_MOVE_ITEM_INTERVAL = 400;
@@ -95,6 +96,9 @@ class Game
 		void forceRemoveCondition(uint32_t creatureId, ConditionType_t type);
 
 		bool loadMainMap(const std::string& filename);
+		// loadMainMap in two steps, the tiles may load on another thread while monsters load
+		bool loadMainMapTiles(const std::string& filename);
+		void loadMainMapWorld();
 		void loadMap(const std::string& path);
 
 		/**
@@ -128,11 +132,26 @@ class Game
 
 		// Struct to store contribution info for a rewardboss
 		struct RewardBossContributionInfo {
-			gtl::node_hash_map<uint32_t, PlayerScoreInfo> playerScoreTable;  // Map of player GUIDs to PlayerScoreInfo
+			void addDamageDone(uint32_t playerGuid, int32_t value) { add(playerGuid, &PlayerScoreInfo::damageDone, value); }
+			void addDamageTaken(uint32_t playerGuid, int32_t value) { add(playerGuid, &PlayerScoreInfo::damageTaken, value); }
+			void addHealingDone(uint32_t playerGuid, int32_t value) { add(playerGuid, &PlayerScoreInfo::healingDone, value); }
+
+			// a slot per player in the order of their first contribution, the same index in both
+			std::vector<uint32_t> playerGuids;
+			std::vector<PlayerScoreInfo> scores;
+			gtl::flat_hash_map<uint32_t, uint32_t> slots;
+
+			// kept up to date with every contribution, for the distribution at death
+			int32_t totalScore = 0;
+			int32_t topScore = 0;
+			uint32_t topSlot = 0;
+
+			private:
+				void add(uint32_t playerGuid, int32_t PlayerScoreInfo::* field, int32_t value);
 		};
 
 		// Map to track the contributions of players to different rewardbosses
-		gtl::node_hash_map<uint32_t, RewardBossContributionInfo> rewardBossTracking;
+		gtl::flat_hash_map<uint32_t, RewardBossContributionInfo> rewardBossTracking;
 
 		void resetDamageTracking(uint32_t monsterId);  // Function to reset damage tracking for a specific monster
 
@@ -235,7 +254,7 @@ class Game
 		void executeDeath(uint32_t creatureId);
 
 		void addCreatureCheck(const CreaturePtr& creature);
-		static void removeCreatureCheck(const CreaturePtr& creature);
+		void removeCreatureCheck(const CreaturePtr& creature);
 
 		size_t getPlayersOnline() const {
 			return players.size();
@@ -260,12 +279,12 @@ class Game
 		void setWorldLightInfo(LightInfo lightInfo) {
 			lightLevel = lightInfo.level;
 			lightColor = lightInfo.color;
-			for (const auto& it : players) {
-				it.second->sendWorldLight(lightInfo);
-			}
+			broadcastWorldLight(lightInfo);
 		}
 
 		void updateWorldLightLevel();
+		// encoded once, for the players and once for the staff that sees everything lit
+		void broadcastWorldLight(LightInfo lightInfo) const;
 
 		// Guild stuff
 		const std::unordered_map<uint32_t, Guild_ptr>& getGuilds() const { return guilds; }
@@ -279,6 +298,10 @@ class Game
 		ReturnValue internalMoveItem(CylinderPtr fromCylinder, CylinderPtr toCylinder, int32_t index,
 		                             ItemPtr item, uint32_t count, std::optional<std::reference_wrapper<ItemPtr>> _moveItem, uint32_t flags = 0, CreaturePtr actor = nullptr, ItemPtr tradeItem = nullptr, const Position* fromPos = nullptr, const Position* toPos = nullptr);
 							// another spot to use a ref wrapper and possibly optional for ItemPtr* above
+		// moves what it can of items from fromCylinder to toCylinder wherever they fit,
+		// returns the first failure, the checks that hold for all of them done once
+		ReturnValue internalMoveItems(CylinderPtr fromCylinder, CylinderPtr toCylinder, const ItemVector& items, uint32_t flags = 0, CreaturePtr actor = nullptr);
+		ReturnValue internalMoveItems(CylinderPtr fromCylinder, CylinderPtr toCylinder, const ItemVector& items, uint32_t flags, CreaturePtr actor, uint32_t& movedCount);
 
 		ReturnValue internalAddItem(CylinderPtr toCylinder, ItemPtr item, int32_t index = INDEX_WHEREEVER,
 		                            uint32_t flags = 0, bool test = false);
@@ -473,13 +496,19 @@ class Game
 		GameState_t getGameState() const;
 		void setGameState(GameState_t newState);
 		void saveGameState();
+		// same as saveGameState() but spread over several dispatcher cycles
+		void scheduleSaveGameState();
 
 		//Events
 		void checkCreatureWalk(uint32_t creatureId);
 		void updateCreatureWalk(uint32_t creatureId);
 		void checkCreatureAttack(uint32_t creatureId);
 		void checkCreatures(size_t index);
+		// the read only work of a bucket, done on the think pool before its creatures think
+		void prepareCreatureChecks(const std::vector<CreaturePtr>& creatures);
 		void checkLight();
+		// the rolling player saves of playerSaveInterval
+		void checkPlayerSaves();
 
 		bool combatBlockHit(CombatDamage& damage, const CreaturePtr& attacker, const CreaturePtr& target, bool checkDefense, bool checkArmor, bool field, bool ignoreResistances = false);
 
@@ -488,6 +517,11 @@ class Game
 		bool combatChangeHealth(const CreaturePtr& attacker, const CreaturePtr& target, CombatDamage& damage);
 		bool combatChangeMana(const CreaturePtr& attacker, const CreaturePtr& target, CombatDamage& damage);
 
+		// the hits of an area cast until endCombatBatch pick their viewers from
+		// the spectators of the whole area, the health bars go out once at the end
+		void beginCombatBatch(const SpectatorVec& spectators);
+		void endCombatBatch();
+
 		//animation help functions
 		void addCreatureHealth(const CreatureConstPtr& target);
 		static void addCreatureHealth(const SpectatorVec& spectators, const CreatureConstPtr& target);
@@ -497,11 +531,21 @@ class Game
 		static void addDistanceEffect(const SpectatorVec& spectators, const Position& fromPos, const Position& toPos, uint8_t effect);
 
 		void setAccountStorageValue(const uint32_t accountId, const uint32_t key, const int32_t value);
-		int32_t getAccountStorageValue(const uint32_t accountId, const uint32_t key) const;
-		void loadAccountStorageValues();
-		bool saveAccountStorageValues() const;
+		int32_t getAccountStorageValue(const uint32_t accountId, const uint32_t key);
+		// the rows read with a character of the account, unless the values are here already
+		void loadAccountStorage(uint32_t accountId, const DBResult_ptr& result);
+		// writes the storage values of accounts and players changed since the last flush,
+		// and lets go of the accounts without a character online
+		bool saveAccountStorageValues();
+
+		StorageJournal& getStorageJournal() {
+			return storageJournal;
+		}
 
 		void startDecay(const ItemPtr& item);
+		const DecayWheel& getDecayWheel() const {
+			return decayWheel;
+		}
 
 		int16_t getWorldTime() const { return worldTime; }
 		void updateWorldTime();
@@ -515,12 +559,23 @@ class Game
 		void sendOfflineTrainingDialog(const PlayerPtr& player) const;
 
 		const gtl::node_hash_map<uint32_t, PlayerPtr>& getPlayers() const { return players; }
-		const std::map<uint32_t, NpcPtr>& getNpcs() const { return npcs; }
-		const std::map<uint32_t, MonsterPtr>& getMonsters() const { return monsters; }
+		const CreatureRegistry<Npc>& getNpcs() const { return npcs; }
+		const CreatureRegistry<Monster>& getMonsters() const { return monsters; }
 
 		void addPlayer(PlayerPtr player);
 		void removePlayer(const PlayerPtr& player);
 
+		// player has stats or skills to send, they go out once with flushPlayerUpdates
+		void addPlayerUpdate(const PlayerPtr& player);
+		void flushPlayerUpdates();
+
+		// reads the values of an account nobody asked about yet
+		gtl::flat_hash_map<uint32_t, int32_t>& getAccountStorage(uint32_t accountId);
+
+		// the ids of monsters and npcs come from their registry, they are found by it once listed
+		uint32_t reserveNpcId(const NpcPtr& npc);
+		uint32_t reserveMonsterId(const MonsterPtr& monster);
+
 		void addNpc(const NpcPtr& npc);
 		void removeNpc(const NpcPtr& npc);
 
@@ -549,7 +604,7 @@ class Game
 
 		std::forward_list<ItemPtr> toDecayItems;
 
-		std::unordered_set<TilePtr> getTilesToClean() const {
+		const std::unordered_set<TilePtr>& getTilesToClean() const {
 			return tilesToClean;
 		}
 	
@@ -602,8 +657,6 @@ class Game
 			doAccountManagerLogin(player);
 		}
 
-		CURL* curl;
-
 	private:
 		bool playerSaySpell(const PlayerPtr& player, SpeakClasses type, const std::string& text);
 		void playerWhisper(const PlayerPtr& player, const std::string& text);
@@ -614,6 +667,13 @@ class Game
 		void checkDecay();
 		void internalDecayItem(const ItemPtr& item);
 
+		void broadcastMagicEffect(const Position& pos, uint8_t effect);
+		void broadcastDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect);
+		void flushEffects();
+		// the players a hit at pos is shown to, from the running combat batch if any
+		void getCombatSpectators(SpectatorVec& spectators, const Position& pos, bool multifloor);
+		void addCombatHealth(const SpectatorVec& spectators, const CreaturePtr& target);
+
 		std::unordered_map<uint32_t, Guild_ptr> guilds;
 
 		gtl::node_hash_map<uint32_t, PlayerPtr> players;
@@ -623,17 +683,53 @@ class Game
 		std::vector<ItemPtr> loaded_tile_items;
 		std::vector<CharacterOption> character_options;
 		gtl::node_hash_map<uint16_t, ItemPtr> uniqueItems;
+		// the accounts with a character online, and the ones scripts asked about since the last save
 		gtl::node_hash_map<uint32_t, gtl::flat_hash_map<uint32_t, int32_t>> accountStorageMap;
-
-		std::list<ItemPtr> decayItems[EVENT_DECAY_BUCKETS];
-		std::list<CreaturePtr> checkCreatureLists[EVENT_CREATURECOUNT];
-	
-		size_t lastBucket = 0;
+		// characters online by account
+		gtl::flat_hash_map<uint32_t, uint32_t> accountPlayers;
+		StorageJournal storageJournal;
+
+		// the players of the running round of checkPlayerSaves, saved in this order
+		std::vector<uint32_t> playerSaveRound;
+		size_t nextPlayerSave = 0;
+		int64_t playerSaveRoundStart = 0;
+
+		DecayWheel decayWheel{OTSYS_TIME()};
+		std::vector<DecayWheel::Entry> expiredDecays;
+		// dense buckets, every creature knows its slot so removal is a swap with the last one
+		std::vector<CreaturePtr> checkCreatureLists[EVENT_CREATURECOUNT];
+		// bucket being walked by checkCreatures, removals from it are deferred to the walk
+		int32_t checkCreatureBucket = -1;
+
+		// effects waiting for flushEffects with coalesceEffects, sent once each
+		std::vector<std::pair<Position, uint8_t>> pendingMagicEffects;
+		std::vector<std::tuple<Position, Position, uint8_t>> pendingDistanceEffects;
+		bool effectFlushScheduled = false;
+
+		// players waiting for flushPlayerUpdates, each listed once
+		std::vector<PlayerPtr> pendingPlayerUpdates;
+		bool playerUpdateFlushScheduled = false;
+
+		struct CombatBatch {
+			SpectatorVec spectators;
+			std::vector<CreatureConstPtr> healthTargets;
+		};
+		// a hit may start an area cast of its own, the innermost one is last
+		std::vector<CombatBatch> combatBatches;
+		// sight lines of the bucket traced ahead on the think pool
+		std::vector<SightLineJob> checkCreatureSightLines;
+		// the monsters of the bucket by region of the map and the lines each region collects
+		struct CheckRegion {
+			std::vector<Monster*> monsters;
+			std::vector<SightLineJob> sightLines;
+		};
+		std::vector<CheckRegion> checkCreatureRegions;
+		gtl::flat_hash_map<uint32_t, size_t> checkCreatureRegionIndex;
 
 		WildcardTreeNode wildcardTree { false };
 
-		std::map<uint32_t, NpcPtr> npcs;
-		std::map<uint32_t, MonsterPtr> monsters;
+		CreatureRegistry<Npc> npcs { 0x80000000 };
+		CreatureRegistry<Monster> monsters { 0x40000000 };
 
 		//list of items that are in trading state, mapped to the player
 		std::map<ItemPtr, uint32_t> tradeItems;
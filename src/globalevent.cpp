@@ -8,6 +8,7 @@
 #include "tools.h"
 #include "scheduler.h"
 #include "pugicast.h"
+#include "tickprofiler.h"
 
 extern ConfigManager g_config;
 
@@ -43,6 +44,8 @@ void GlobalEvents::clear(bool fromLua)
 	clearMap(thinkMap, fromLua);
 	clearMap(serverMap, fromLua);
 	clearMap(timerMap, fromLua);
+	rebuildQueues();
+	++generation;
 
 	reInitState(fromLua);
 }
@@ -57,12 +60,24 @@ Event_ptr GlobalEvents::getEvent(const std::string& nodeName)
 
 bool GlobalEvents::registerEvent(Event_ptr event, const pugi::xml_node&)
 {
-	GlobalEvent_ptr globalEvent{static_cast<GlobalEvent*>(event.release())}; //event is guaranteed to be a GlobalEvent
+	//event is guaranteed to be a GlobalEvent
+	return addEvent(GlobalEvent_ptr{static_cast<GlobalEvent*>(event.release())});
+}
+
+bool GlobalEvents::registerLuaEvent(GlobalEvent* event)
+{
+	return addEvent(GlobalEvent_ptr{event});
+}
+
+bool GlobalEvents::addEvent(GlobalEvent_ptr globalEvent)
+{
 	if (globalEvent->getEventType() == GLOBALEVENT_TIMER) {
 		auto result = timerMap.emplace(globalEvent->getName(), std::move(*globalEvent));
 		if (result.second) {
-			if (timerEventId == 0) {
-				timerEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, [this]() { timer(); }));
+			GlobalEvent& event = result.first->second;
+			timerQueue.push({event.getNextExecution(), &event});
+			if (timerEventId == 0 || timerQueue.top().event == &event) {
+				scheduleTimer();
 			}
 			return true;
 		}
@@ -74,8 +89,10 @@ bool GlobalEvents::registerEvent(Event_ptr event, const pugi::xml_node&)
 	} else { // think event
 		auto result = thinkMap.emplace(globalEvent->getName(), std::move(*globalEvent));
 		if (result.second) {
-			if (thinkEventId == 0) {
-				thinkEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, [this]() { think(); }));
+			GlobalEvent& event = result.first->second;
+			thinkQueue.push({event.getNextExecution(), &event});
+			if (thinkEventId == 0 || thinkQueue.top().event == &event) {
+				scheduleThink();
 			}
 			return true;
 		}
@@ -85,34 +102,50 @@ bool GlobalEvents::registerEvent(Event_ptr event, const pugi::xml_node&)
 	return false;
 }
 
-bool GlobalEvents::registerLuaEvent(GlobalEvent* event)
+bool GlobalEventDeadline::operator>(const GlobalEventDeadline& other) const
 {
-	GlobalEvent_ptr globalEvent{ event };
-	if (globalEvent->getEventType() == GLOBALEVENT_TIMER) {
-		auto result = timerMap.emplace(globalEvent->getName(), std::move(*globalEvent));
-		if (result.second) {
-			if (timerEventId == 0) {
-				timerEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, [this]() { timer(); }));
-			}
-			return true;
-		}
-	} else if (globalEvent->getEventType() != GLOBALEVENT_NONE) {
-		auto result = serverMap.emplace(globalEvent->getName(), std::move(*globalEvent));
-		if (result.second) {
-			return true;
-		}
-	} else { // think event
-		auto result = thinkMap.emplace(globalEvent->getName(), std::move(*globalEvent));
-		if (result.second) {
-			if (thinkEventId == 0) {
-				thinkEventId = g_scheduler.addEvent(createSchedulerTask(SCHEDULER_MINTICKS, [this]() { think(); }));
-			}
-			return true;
-		}
+	// events due together run in the order of their names
+	if (time != other.time) {
+		return time > other.time;
 	}
+	return event->getName() > other.event->getName();
+}
 
-	std::cout << "[Warning - GlobalEvents::configureEvent] Duplicate registered globalevent with name: " << globalEvent->getName() << std::endl;
-	return false;
+void GlobalEvents::rebuildQueues()
+{
+	timerQueue = {};
+	for (auto& it : timerMap) {
+		timerQueue.push({it.second.getNextExecution(), &it.second});
+	}
+
+	thinkQueue = {};
+	for (auto& it : thinkMap) {
+		thinkQueue.push({it.second.getNextExecution(), &it.second});
+	}
+}
+
+void GlobalEvents::scheduleTimer()
+{
+	g_scheduler.stopEvent(timerEventId);
+	timerEventId = 0;
+	if (timerQueue.empty()) {
+		return;
+	}
+
+	const int64_t delay = timerQueue.top().time - time(nullptr);
+	timerEventId = g_scheduler.addEvent(createSchedulerTask(std::max<int64_t>(1000, delay * 1000), [this]() { timer(); }, DISPATCHER_LANE_BACKGROUND));
+}
+
+void GlobalEvents::scheduleThink()
+{
+	g_scheduler.stopEvent(thinkEventId);
+	thinkEventId = 0;
+	if (thinkQueue.empty()) {
+		return;
+	}
+
+	const int64_t delay = thinkQueue.top().time - OTSYS_TIME();
+	thinkEventId = g_scheduler.addEvent(createSchedulerTask(std::max<int64_t>(SCHEDULER_MINTICKS, delay), [this]() { think(); }, DISPATCHER_LANE_BACKGROUND));
 }
 
 void GlobalEvents::startup() const
@@ -132,75 +165,64 @@ void GlobalEvents::save() const
 
 void GlobalEvents::timer()
 {
+	TickPhaseTimer phaseTimer(TICK_PHASE_GLOBALEVENTS);
+	timerEventId = 0;
 	time_t now = time(nullptr);
 
-	int64_t nextScheduledTime = std::numeric_limits<int64_t>::max();
-
-	auto it = timerMap.begin();
-	while (it != timerMap.end()) {
-		GlobalEvent& globalEvent = it->second;
-
-		int64_t nextExecutionTime = globalEvent.getNextExecution() - now;
-		if (nextExecutionTime > 0) {
-			if (nextExecutionTime < nextScheduledTime) {
-				nextScheduledTime = nextExecutionTime;
-			}
+	// the due ones run once each, even if they are behind by more than a day
+	std::vector<GlobalEvent*> dueEvents;
+	while (!timerQueue.empty() && timerQueue.top().time <= now) {
+		dueEvents.push_back(timerQueue.top().event);
+		timerQueue.pop();
+	}
 
-			++it;
-			continue;
+	const uint32_t currentGeneration = generation;
+	for (GlobalEvent* globalEvent : dueEvents) {
+		const bool executed = globalEvent->executeEvent();
+		if (generation != currentGeneration) {
+			return;
 		}
 
-		if (!globalEvent.executeEvent()) {
-			it = timerMap.erase(it);
+		if (!executed) {
+			const std::string name = globalEvent->getName();
+			timerMap.erase(name);
 			continue;
 		}
 
-		nextExecutionTime = 86400;
-		if (nextExecutionTime < nextScheduledTime) {
-			nextScheduledTime = nextExecutionTime;
-		}
-
-		globalEvent.setNextExecution(globalEvent.getNextExecution() + nextExecutionTime);
-
-		++it;
+		globalEvent->setNextExecution(globalEvent->getNextExecution() + 86400);
+		timerQueue.push({globalEvent->getNextExecution(), globalEvent});
 	}
 
-	if (nextScheduledTime != std::numeric_limits<int64_t>::max()) {
-		timerEventId = g_scheduler.addEvent(createSchedulerTask(std::max<int64_t>(1000, nextScheduledTime * 1000), [this]() { timer(); }));
-	}
+	scheduleTimer();
 }
 
 void GlobalEvents::think()
 {
+	TickPhaseTimer timer(TICK_PHASE_GLOBALEVENTS);
+	thinkEventId = 0;
 	int64_t now = OTSYS_TIME();
 
-	int64_t nextScheduledTime = std::numeric_limits<int64_t>::max();
-	for (auto& it : thinkMap) {
-		GlobalEvent& globalEvent = it.second;
-
-		int64_t nextExecutionTime = globalEvent.getNextExecution() - now;
-		if (nextExecutionTime > 0) {
-			if (nextExecutionTime < nextScheduledTime) {
-				nextScheduledTime = nextExecutionTime;
-			}
-			continue;
-		}
+	std::vector<GlobalEvent*> dueEvents;
+	while (!thinkQueue.empty() && thinkQueue.top().time <= now) {
+		dueEvents.push_back(thinkQueue.top().event);
+		thinkQueue.pop();
+	}
 
-		if (!globalEvent.executeEvent()) {
-			std::cout << "[Error - GlobalEvents::think] Failed to execute event: " << globalEvent.getName() << std::endl;
+	const uint32_t currentGeneration = generation;
+	for (GlobalEvent* globalEvent : dueEvents) {
+		if (!globalEvent->executeEvent()) {
+			std::cout << "[Error - GlobalEvents::think] Failed to execute event: " << globalEvent->getName() << std::endl;
 		}
 
-		nextExecutionTime = globalEvent.getInterval();
-		if (nextExecutionTime < nextScheduledTime) {
-			nextScheduledTime = nextExecutionTime;
+		if (generation != currentGeneration) {
+			return;
 		}
 
-		globalEvent.setNextExecution(globalEvent.getNextExecution() + nextExecutionTime);
+		globalEvent->setNextExecution(globalEvent->getNextExecution() + globalEvent->getInterval());
+		thinkQueue.push({globalEvent->getNextExecution(), globalEvent});
 	}
 
-	if (nextScheduledTime != std::numeric_limits<int64_t>::max()) {
-		thinkEventId = g_scheduler.addEvent(createSchedulerTask(nextScheduledTime, [this]() { think(); }));
-	}
+	scheduleThink();
 }
 
 void GlobalEvents::execute(GlobalEvent_t type) const
@@ -21,6 +21,15 @@ class GlobalEvent;
 using GlobalEvent_ptr = std::unique_ptr<GlobalEvent>;
 using GlobalEventMap = std::map<std::string, GlobalEvent>;
 
+// an event of timerMap or thinkMap by the time it runs next, the nearest first
+struct GlobalEventDeadline {
+	int64_t time;
+	GlobalEvent* event;
+
+	bool operator>(const GlobalEventDeadline& other) const;
+};
+using GlobalEventQueue = std::priority_queue<GlobalEventDeadline, std::vector<GlobalEventDeadline>, std::greater<>>;
+
 class GlobalEvents final : public BaseEvents
 {
 	public:
@@ -49,6 +58,11 @@ class GlobalEvents final : public BaseEvents
 
 		Event_ptr getEvent(const std::string& nodeName) override;
 		bool registerEvent(Event_ptr event, const pugi::xml_node& node) override;
+		bool addEvent(GlobalEvent_ptr globalEvent);
+
+		void rebuildQueues();
+		void scheduleTimer();
+		void scheduleThink();
 
 		LuaScriptInterface& getScriptInterface() override {
 			return scriptInterface;
@@ -57,7 +71,10 @@ class GlobalEvents final : public BaseEvents
 		LuaScriptInterface scriptInterface;
 
 		GlobalEventMap thinkMap, serverMap, timerMap;
+		GlobalEventQueue thinkQueue, timerQueue;
 		int32_t thinkEventId = 0, timerEventId = 0;
+		// changes on every clear, the events an event ran before it are gone
+		uint32_t generation = 0;
 };
 
 class GlobalEvent final : public Event
@@ -91,15 +91,20 @@ bool Groups::load()
 	} catch (const std::exception& e) {
 		std::cerr << "Failed to load groups.toml - " << e.what() << std::endl;
 	}
+
+	groupIndex.clear();
+	for (Group& group : groups) {
+		if (group.id >= groupIndex.size()) {
+			groupIndex.resize(group.id + 1);
+		}
+		if (!groupIndex[group.id]) {
+			groupIndex[group.id] = &group;
+		}
+	}
 	return true;
 }
 
 Group* Groups::getGroup(uint16_t id)
 {
-	for (Group& group : groups) {
-		if (group.id == id) {
-			return &group;
-		}
-	}
-	return nullptr;
+	return id < groupIndex.size() ? groupIndex[id] : nullptr;
 }
@@ -22,6 +22,8 @@ class Groups {
 
 	private:
 		std::vector<Group> groups;
+		// by id, the first group of each id
+		std::vector<Group*> groupIndex;
 };
 
 #endif
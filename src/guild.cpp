@@ -19,7 +19,7 @@ void Guild::addMember(const PlayerPtr& player)
 
 void Guild::removeMember(const PlayerPtr& player)
 {
-	membersOnline.remove(player);
+	std::erase(membersOnline, player);
 	for (const auto member : membersOnline) {
 		g_game.updatePlayerHelpers(member);
 	}
@@ -66,7 +66,10 @@ bool Guild::addWar(uint32_t guildId, GuildWar& war)
 	if (isInWar(guildId))
 		return false;
 
-	m_mGuildWars.emplace(guildId, std::move(war));
+	const auto [it, inserted] = m_mGuildWars.emplace(guildId, std::move(war));
+	if (isWarActive(it->second)) {
+		warEnemies.insert(guildId);
+	}
 	return true;
 }
 
@@ -76,43 +79,12 @@ bool Guild::removeWar(uint32_t guildId)
 		return false;
 
 	m_mGuildWars.erase(guildId);
+	warEnemies.erase(guildId);
 	return true;
 }
 
-bool Guild::isWarActive(const GuildWar* war) {
-    return (war->status == WAR_ACTIVE || war->status == WAR_WITHDRAW_PROPOSED);
-}
-
-bool Guild::isInWar(uint32_t enemyGuildId)
-{
-	if (m_mGuildWars.find(enemyGuildId) == m_mGuildWars.end())
-		return false;
-
-	const auto& war = getWar(enemyGuildId);
-	if(!war) {
-		return false;
-	}
-
-	if(!isWarActive(war)) {
-		return false;
-	}
-
-	return true;
-}
-
-bool Guild::isInAnyWar()
-{
-	if (m_mGuildWars.empty()) {
-		return false;
-	}
-
-	for (const auto& warEntry : m_mGuildWars) {
-		if(isWarActive(&warEntry.second)) {
-			return true;
-		}
-	}
-
-	return false;
+bool Guild::isWarActive(const GuildWar& war) {
+    return (war.status == WAR_ACTIVE || war.status == WAR_WITHDRAW_PROPOSED);
 }
 
 bool IOGuild::loadGuilds()
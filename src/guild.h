@@ -5,6 +5,8 @@
 #define FS_GUILD_H
 #include "creature.h"
 
+#include <gtl/phmap.hpp>
+
 class Player;
 
 enum WarStatus : uint8_t {
@@ -58,7 +60,7 @@ class Guild
 			return name;
 		}
 	
-		const std::list<PlayerPtr>& getMembersOnline() const {
+		const std::vector<PlayerPtr>& getMembersOnline() const {
 			return membersOnline;
 		}
 	
@@ -97,21 +99,29 @@ class Guild
 
 		bool addWar(uint32_t guildId, GuildWar& war);
 		bool removeWar(uint32_t guildId);
-		bool isInWar(uint32_t guildId);
-		bool isInAnyWar();
-		GuildWar* getWar(uint32_t enemyGuildId) {
+
+		// asked for every hit and every creature sent, answered from the
+		// guilds at active war kept aside as wars start and end
+		bool isInWar(uint32_t guildId) const {
+			return warEnemies.contains(guildId);
+		}
+		bool isInAnyWar() const {
+			return !warEnemies.empty();
+		}
+
+		const GuildWar* getWar(uint32_t enemyGuildId) const {
 			auto it = m_mGuildWars.find(enemyGuildId);
 			return (it != m_mGuildWars.end()) ? &it->second : nullptr;
 		}
-		GuildWarMap& getWars() {
+		const GuildWarMap& getWars() const {
 			return m_mGuildWars;
 		}
 
 	private:
 		// Helper function for other methods checking war participation
-		bool isWarActive(const GuildWar* war);
+		static bool isWarActive(const GuildWar& war);
 
-		std::list<PlayerPtr> membersOnline;
+		std::vector<PlayerPtr> membersOnline;
 		std::vector<GuildRank_ptr> ranks;
 		std::string name;
 		std::string motd;
@@ -120,6 +130,7 @@ class Guild
 
 		uint64_t guildBankBalance = 0;
 		GuildWarMap m_mGuildWars;
+		gtl::flat_hash_set<uint32_t> warEnemies;
 };
 
 using Guild_ptr = std::shared_ptr<Guild>;
@@ -10,12 +10,69 @@
 #include "game.h"
 #include "configmanager.h"
 #include "bed.h"
+#include "inbox.h"
+#include "scheduler.h"
 
 #include <fmt/format.h>
 
 extern ConfigManager g_config;
 extern Game g_game;
 
+namespace {
+
+// the items an inbox of their own holds reach the inbox of guid, wherever they are
+void sendToInbox(uint32_t guid, const InboxPtr& items)
+{
+	if (const auto player = g_game.getPlayerByGUID(guid)) {
+		const auto& itemList = items->getItemList();
+		g_game.internalMoveItems(items, player->getInbox(), ItemVector(itemList.begin(), itemList.end()), FLAG_NOLIMIT);
+		return;
+	}
+
+	// a login reading the inbox right now would not see the rows
+	if (IOLoginData::isLoadingPlayer(guid)) {
+		g_scheduler.addEvent(createSchedulerTask(100, [guid, items]() { sendToInbox(guid, items); }));
+		return;
+	}
+
+	for (const auto& item : items->getItemList()) {
+		IOLoginData::addInboxItemAsync(guid, item);
+	}
+}
+
+// evictions move items, kick players and wake sleepers, a few houses per dispatcher task
+constexpr size_t EVICTIONS_PER_TASK = 16;
+
+void evictHouses(const std::shared_ptr<std::vector<House*>>& houses, size_t next)
+{
+	const size_t end = std::min(next + EVICTIONS_PER_TASK, houses->size());
+	for (size_t i = next; i < end; ++i) {
+		(*houses)[i]->setOwner(0);
+	}
+
+	if (end < houses->size()) {
+		g_dispatcher.addTask(createTask([houses, end]() { evictHouses(houses, end); }));
+	}
+}
+
+time_t getRentPeriodEnd(RentPeriod_t rentPeriod, time_t currentTime)
+{
+	switch (rentPeriod) {
+		case RENTPERIOD_DAILY:
+			return currentTime + 24 * 60 * 60;
+		case RENTPERIOD_WEEKLY:
+			return currentTime + 24 * 60 * 60 * 7;
+		case RENTPERIOD_MONTHLY:
+			return currentTime + 24 * 60 * 60 * 30;
+		case RENTPERIOD_YEARLY:
+			return currentTime + 24 * 60 * 60 * 365;
+		default:
+			return currentTime;
+	}
+}
+
+}
+
 House::House(const uint32_t houseId) : id(houseId) {}
 
 void House::addTile(const TilePtr& tile)
@@ -128,15 +185,26 @@ AccessHouseLevel_t House::getHouseAccessLevel(const PlayerConstPtr& player) cons
 		return HOUSE_OWNER;
 	}
 
-	if (subOwnerList.isInList(player)) {
-		return HOUSE_SUBOWNER;
+	const auto& rank = player->getGuildRank();
+	const uint32_t rankId = rank ? rank->id : 0;
+	const uint64_t key = (static_cast<uint64_t>(rankId) << 32) | player->getGUID();
+	if (const auto it = listAccess.find(key); it != listAccess.end()) {
+		return it->second;
 	}
 
-	if (guestList.isInList(player)) {
-		return HOUSE_GUEST;
+	AccessHouseLevel_t level = HOUSE_NOT_INVITED;
+	if (subOwnerList.isInList(player->getGUID(), rankId)) {
+		level = HOUSE_SUBOWNER;
+	} else if (guestList.isInList(player->getGUID(), rankId)) {
+		level = HOUSE_GUEST;
 	}
 
-	return HOUSE_NOT_INVITED;
+	// visitors come and go, a house keeps no more of them than this
+	if (listAccess.size() >= 1024) {
+		listAccess.clear();
+	}
+	listAccess.emplace(key, level);
+	return level;
 }
 
 bool House::kickPlayer(const PlayerPtr& player, const PlayerPtr& target)
@@ -165,8 +233,10 @@ void House::setAccessList(const uint32_t listId, const std::string_view textlist
 {
 	if (listId == GUEST_LIST) {
 		guestList.parseList(textlist);
+		listAccess.clear();
 	} else if (listId == SUBOWNER_LIST) {
 		subOwnerList.parseList(textlist);
+		listAccess.clear();
 	} else {
 		if (const auto door = getDoorByNumber(listId)) {
 			door->setAccessList(textlist);
@@ -198,13 +268,10 @@ bool House::transferToDepot() const
 	if (const auto player = g_game.getPlayerByGUID(owner)) {
 		transferToDepot(player);
 	} else {
-		const PlayerPtr tmpPlayer = std::make_shared<Player>(nullptr);
-		if (!IOLoginData::loadPlayerById(tmpPlayer, owner)) {
-			return false;
-		}
-
-		transferToDepot(tmpPlayer);
-		IOLoginData::savePlayer(tmpPlayer);
+		// only the rows of the items go to the database, the owner is never loaded
+		const auto inbox = std::make_shared<Inbox>(ITEM_INBOX);
+		transferToInbox(inbox);
+		sendToInbox(owner, inbox);
 	}
 	return true;
 }
@@ -215,6 +282,12 @@ bool House::transferToDepot(const PlayerPtr& player) const
 		return false;
 	}
 
+	transferToInbox(player->getInbox());
+	return true;
+}
+
+void House::transferToInbox(CylinderPtr inbox) const
+{
 	ItemList moveItemList;
 	for (const auto tile : houseTiles) {
 		if (const auto items = tile->getItemList()) {
@@ -232,12 +305,10 @@ bool House::transferToDepot(const PlayerPtr& player) const
 		}
 	}
 	
-	CylinderPtr inbox = player->getInbox();
 	for (const auto item : moveItemList) {
 		CylinderPtr parent = item->getParent();
 		g_game.internalMoveItem(parent, inbox, INDEX_WHEREEVER, item, item->getItemCount(), std::nullopt, FLAG_NOLIMIT);
 	}
-	return true;
 }
 
 bool House::getAccessList(const uint32_t listId, std::string& list) const
@@ -484,6 +555,11 @@ bool AccessList::isInList(const PlayerConstPtr& player) const
 	return rank && guildRankList.contains(rank->id);
 }
 
+bool AccessList::isInList(const uint32_t guid, const uint32_t rankId) const
+{
+	return allowEveryone || playerList.contains(guid) || (rankId != 0 && guildRankList.contains(rankId));
+}
+
 void AccessList::getList(std::string& list) const
 {
 	list = this->list;
@@ -619,91 +695,106 @@ void Houses::payHouses(const RentPeriod_t rentPeriod) const
 		return;
 	}
 
-	time_t currentTime = time(nullptr);
-	for (const auto& val : houseMap | std::views::values) {
-		House* house = val;
-		if (house->getOwner() == 0) {
+	const time_t currentTime = time(nullptr);
+	std::vector<House*> dueHouses;
+	std::string ownerIds;
+	for (const auto& house : houseMap | std::views::values) {
+		if (house->getOwner() == 0 || house->getRent() == 0 || house->getPaidUntil() > currentTime) {
 			continue;
 		}
 
-		const uint32_t rent = house->getRent();
-		if (rent == 0 || house->getPaidUntil() > currentTime) {
+		if (!g_game.map.towns.getTown(house->getTownId())) {
 			continue;
 		}
 
-		const uint32_t ownerId = house->getOwner();
-		const auto town = g_game.map.towns.getTown(house->getTownId());
-		if (!town) {
-			continue;
+		if (!dueHouses.empty()) {
+			ownerIds.push_back(',');
 		}
+		fmt::format_to(std::back_inserter(ownerIds), "{:d}", house->getOwner());
+		dueHouses.push_back(house);
+	}
+
+	if (dueHouses.empty()) {
+		return;
+	}
+
+	// one read for the balances of every owner, none of them is loaded
+	Database& db = Database::getInstance();
+	gtl::flat_hash_map<uint32_t, uint64_t> balances;
+	if (DBResult_ptr result = db.storeQuery(fmt::format("SELECT `id`, `balance` FROM `players` WHERE `id` IN ({:s})", ownerIds))) {
+		do {
+			balances.emplace(result->getNumber<uint32_t>("id"), result->getNumber<uint64_t>("balance"));
+		} while (result->next());
+	}
+
+	// an owner of several houses pays them from one balance, in the order of the houses
+	gtl::flat_hash_map<uint32_t, uint64_t> charges;
+	auto evictions = std::make_shared<std::vector<House*>>();
+	for (House* house : dueHouses) {
+		const uint32_t ownerId = house->getOwner();
+		const uint32_t rent = house->getRent();
 
-		PlayerPtr player = std::make_shared<Player>(nullptr);
-		if (!IOLoginData::loadPlayerById(player, ownerId)) {
+		auto it = balances.find(ownerId);
+		if (it == balances.end()) {
 			// Player doesn't exist, reset house owner
 			house->setOwner(0);
 			continue;
 		}
 
-		if (player->getBankBalance() >= rent) {
-			player->setBankBalance(player->getBankBalance() - rent);
+		if (it->second >= rent) {
+			it->second -= rent;
+			charges[ownerId] += rent;
+			house->setPaidUntil(getRentPeriodEnd(rentPeriod, currentTime));
+			house->setPayRentWarnings(0);
+		} else if (house->getPayRentWarnings() < 7) {
+			int32_t daysLeft = 7 - house->getPayRentWarnings();
 
-			time_t paidUntil = currentTime;
+			std::string period;
 			switch (rentPeriod) {
 				case RENTPERIOD_DAILY:
-					paidUntil += 24 * 60 * 60;
+					period = "daily";
 					break;
+
 				case RENTPERIOD_WEEKLY:
-					paidUntil += 24 * 60 * 60 * 7;
+					period = "weekly";
 					break;
+
 				case RENTPERIOD_MONTHLY:
-					paidUntil += 24 * 60 * 60 * 30;
+					period = "monthly";
 					break;
+
 				case RENTPERIOD_YEARLY:
-					paidUntil += 24 * 60 * 60 * 365;
+					period = "annual";
 					break;
+
 				default:
 					break;
 			}
 
-			house->setPaidUntil(paidUntil);
-			house->setPayRentWarnings(0);
+			const auto letter = Item::CreateItem(ITEM_LETTER_STAMPED);
+			letter->setText(fmt::format("Warning! \nThe {:s} rent of {:d} gold for your house \"{:s}\" is payable. Have it within {:d} days or you will lose this house.", period, house->getRent(), house->getName(), daysLeft));
+			IOLoginData::addInboxItemAsync(ownerId, letter);
+			house->setPayRentWarnings(house->getPayRentWarnings() + 1);
 		} else {
-			if (house->getPayRentWarnings() < 7) {
-				int32_t daysLeft = 7 - house->getPayRentWarnings();
-
-				auto letter = Item::CreateItem(ITEM_LETTER_STAMPED);
-				std::string period;
-
-				switch (rentPeriod) {
-					case RENTPERIOD_DAILY:
-						period = "daily";
-						break;
-
-					case RENTPERIOD_WEEKLY:
-						period = "weekly";
-						break;
-
-					case RENTPERIOD_MONTHLY:
-						period = "monthly";
-						break;
-
-					case RENTPERIOD_YEARLY:
-						period = "annual";
-						break;
-
-					default:
-						break;
-				}
+			evictions->push_back(house);
+		}
+	}
 
-				letter->setText(fmt::format("Warning! \nThe {:s} rent of {:d} gold for your house \"{:s}\" is payable. Have it within {:d} days or you will lose this house.", period, house->getRent(), house->getName(), daysLeft));
-				CylinderPtr inbox = player->getInbox();
-				g_game.internalAddItem(inbox, letter, INDEX_WHEREEVER, FLAG_NOLIMIT);
-				house->setPayRentWarnings(house->getPayRentWarnings() + 1);
-			} else {
-				house->setOwner(0, true, player);
+	// one update for every owner who paid, a balance that no longer covers it is left alone
+	if (!charges.empty()) {
+		std::string amounts;
+		std::string payerIds;
+		for (const auto& [ownerId, amount] : charges) {
+			fmt::format_to(std::back_inserter(amounts), " WHEN {:d} THEN {:d}", ownerId, amount);
+			if (!payerIds.empty()) {
+				payerIds.push_back(',');
 			}
+			fmt::format_to(std::back_inserter(payerIds), "{:d}", ownerId);
 		}
+		db.executeQuery(fmt::format("UPDATE `players` SET `balance` = `balance` - CASE `id`{0:s} END WHERE `id` IN ({1:s}) AND `balance` >= CASE `id`{0:s} END", amounts, payerIds));
+	}
 
-		IOLoginData::savePlayer(player);
+	if (!evictions->empty()) {
+		g_dispatcher.addTask(createTask([evictions]() { evictHouses(evictions, 0); }));
 	}
 }
@@ -7,6 +7,7 @@
 #include <ranges>
 #include <set>
 #include <unordered_set>
+#include <gtl/phmap.hpp>
 
 #include "container.h"
 #include "position.h"
@@ -24,13 +25,15 @@ class AccessList
 		void addGuildRank(const std::string& name, const std::string& rankName);
 
 		bool isInList(const PlayerConstPtr& player) const;
+		// rankId is 0 for a player without guild
+		bool isInList(uint32_t guid, uint32_t rankId) const;
 
 		void getList(std::string& list) const;
 
 	private:
 		std::string list;
-		std::unordered_set<uint32_t> playerList;
-		std::unordered_set<uint32_t> guildRankList;
+		gtl::flat_hash_set<uint32_t> playerList;
+		gtl::flat_hash_set<uint32_t> guildRankList;
 		bool allowEveryone = false;
 };
 
@@ -222,12 +225,26 @@ class House
 			return static_cast<uint32_t>(std::ceil(bedsList.size() / 2.)); //each bed takes 2 sqms of space, ceil is just for bad maps
 		}
 
+		// of the tile store rows of this house as last loaded or saved, the
+		// rows are only written again when this no longer matches
+		uint64_t getItemsChecksum() const {
+			return itemsChecksum;
+		}
+		void setItemsChecksum(uint64_t checksum) {
+			itemsChecksum = checksum;
+		}
+
 	private:
 		bool transferToDepot() const;
 		bool transferToDepot(const PlayerPtr& player) const;
+		// what can be picked up in the house, and what its fixed containers hold
+		void transferToInbox(CylinderPtr inbox) const;
 
 		AccessList guestList;
 		AccessList subOwnerList;
+		// what the guest and sub owner lists give a guid and guild rank pair,
+		// worked out on the first check and forgotten when a list changes
+		mutable gtl::flat_hash_map<uint64_t, AccessHouseLevel_t> listAccess;
 
 		Container transfer_container{ITEM_LOCKER1};
 
@@ -241,6 +258,7 @@ class House
 		HouseTransferItemPtr transferItem = nullptr;
 
 		time_t paidUntil = 0;
+		uint64_t itemsChecksum = 0;
 
 		uint32_t id;
 		uint32_t owner = 0;
@@ -307,8 +325,14 @@ class Houses
 			return houseMap;
 		}
 
+		// houses the tile store has rows of but the map does not know, the rows go with the next save
+		std::vector<uint32_t>& getStaleItemHouses() {
+			return staleItemHouses;
+		}
+
 	private:
 		HouseMap houseMap;
+		std::vector<uint32_t> staleItemHouses;
 };
 
 #endif
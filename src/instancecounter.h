@@ -0,0 +1,39 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_INSTANCECOUNTER_H
+#define FS_INSTANCECOUNTER_H
+
+#include <atomic>
+#include <cstddef>
+
+// Counts the live objects of T, a class derives from InstanceCounter<T> to be
+// counted. It adds no size, and objects are made and destroyed on any thread.
+template <typename T>
+class InstanceCounter
+{
+	public:
+		static size_t getInstanceCount() {
+			return count.load(std::memory_order_relaxed);
+		}
+
+	protected:
+		InstanceCounter() {
+			count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		InstanceCounter(const InstanceCounter&) {
+			count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		InstanceCounter& operator=(const InstanceCounter&) = default;
+
+		~InstanceCounter() {
+			count.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+	private:
+		static inline std::atomic<size_t> count{0};
+};
+
+#endif
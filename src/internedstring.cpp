@@ -0,0 +1,60 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "internedstring.h"
+#include "tools.h"
+
+#include <deque>
+#include <mutex>
+#include <gtl/phmap.hpp>
+
+const InternedString::Entry InternedString::emptyEntry;
+
+struct InternedString::Table
+{
+	std::mutex lock;
+	// entries never move or go away, the maps and every InternedString point into it
+	std::deque<Entry> entries;
+	gtl::flat_hash_map<std::string_view, const Entry*> byText;
+	gtl::flat_hash_map<std::string, uint32_t> idsByLowerCase;
+};
+
+InternedString::Table& InternedString::getTable()
+{
+	// never destroyed, creatures going away at exit may still hold its strings
+	static Table* table = new Table();
+	return *table;
+}
+
+uint32_t InternedString::findId(std::string_view text)
+{
+	if (text.empty()) {
+		return 0;
+	}
+
+	const std::string lowerCase = asLowerCaseString(std::string(text));
+	Table& table = getTable();
+	std::lock_guard<std::mutex> lock(table.lock);
+	const auto it = table.idsByLowerCase.find(lowerCase);
+	return it != table.idsByLowerCase.end() ? it->second : 0;
+}
+
+const InternedString::Entry* InternedString::intern(std::string_view text)
+{
+	if (text.empty()) {
+		return &emptyEntry;
+	}
+
+	Table& table = getTable();
+	std::lock_guard<std::mutex> lock(table.lock);
+	if (const auto it = table.byText.find(text); it != table.byText.end()) {
+		return it->second;
+	}
+
+	const auto [idIt, inserted] = table.idsByLowerCase.try_emplace(asLowerCaseString(std::string(text)), static_cast<uint32_t>(table.idsByLowerCase.size() + 1));
+	const Entry& entry = table.entries.emplace_back(Entry{std::string(text), idIt->second});
+	table.byText.emplace(entry.text, &entry);
+	return &entry;
+}
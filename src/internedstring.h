@@ -0,0 +1,56 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_INTERNEDSTRING_H
+#define FS_INTERNEDSTRING_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A string kept once for the whole run in a shared table, copies of it are a
+// pointer. Strings that are equal ignoring case share an id, so names compare
+// as integers.
+class InternedString
+{
+	public:
+		InternedString() = default;
+		explicit InternedString(std::string_view text) : entry(intern(text)) {}
+
+		const std::string& str() const {
+			return entry->text;
+		}
+
+		// 0 for the empty string
+		uint32_t id() const {
+			return entry->id;
+		}
+
+		bool empty() const {
+			return entry->text.empty();
+		}
+
+		bool operator==(const InternedString& other) const {
+			return entry == other.entry;
+		}
+
+		// the id of the strings equal to text ignoring case, 0 when none was interned
+		static uint32_t findId(std::string_view text);
+
+	private:
+		struct Entry {
+			std::string text;
+			uint32_t id = 0;
+		};
+
+		struct Table;
+
+		static Table& getTable();
+		static const Entry* intern(std::string_view text);
+
+		static const Entry emptyEntry;
+
+		const Entry* entry = &emptyEntry;
+};
+
+#endif
@@ -7,11 +7,73 @@
 #include "configmanager.h"
 #include "game.h"
 #include "accountmanager.h"
+#include "databasetasks.h"
+#include "playerjournal.h"
 
+#include <condition_variable>
 #include <fmt/format.h>
 
 extern ConfigManager g_config;
+
+namespace {
+
+// saves queued by savePlayerAsync that did not reach the database yet, by guid
+std::mutex pendingSaveLock;
+std::condition_variable pendingSaveSignal;
+gtl::flat_hash_map<uint32_t, uint32_t> pendingSaves;
+
+// what lazyDepotLoading leaves in the database at login, until the player opens it
+const std::bitset<PLAYER_SAVE_LAST> lazySections = (1u << PLAYER_SAVE_DEPOT_ITEMS) | (1u << PLAYER_SAVE_REWARD_ITEMS) | (1u << PLAYER_SAVE_INBOX_ITEMS);
+
+// logins loadPlayerAsync has not handed over yet, by guid, dispatcher thread
+gtl::flat_hash_map<uint32_t, uint32_t> loadingPlayers;
+
+void finishLoading(uint32_t guid)
+{
+	if (auto it = loadingPlayers.find(guid); it != loadingPlayers.end() && --it->second == 0) {
+		loadingPlayers.erase(it);
+	}
+}
+
+}
+
+// by PlayerSaveSection_t
+static constexpr std::array<std::string_view, PLAYER_SAVE_LAST> saveSectionTables = {
+	"player_spells",
+	"player_items",
+	"player_depotitems",
+	"player_rewarditems",
+	"player_inboxitems",
+	"player_storeinboxitems",
+	"player_storage",
+	"player_augments",
+	"player_custom_skills",
+};
 extern Game g_game;
+extern Dispatcher g_dispatcher;
+
+static constexpr std::string_view selectPlayerById = "SELECT `id`, `name`, `account_id`, `group_id`, `sex`, `vocation`, `experience`, `level`, `maglevel`, `health`, `healthmax`, `blessings`, `mana`, `manamax`, `manaspent`, `soul`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `posx`, `posy`, `posz`, `cap`, `lastlogin`, `lastlogout`, `lastip`, `conditions`, `skulltime`, `skull`, `town_id`, `balance`, `offlinetraining_time`, `offlinetraining_skill`, `stamina`, `skill_fist`, `skill_fist_tries`, `skill_club`, `skill_club_tries`, `skill_sword`, `skill_sword_tries`, `skill_axe`, `skill_axe_tries`, `skill_dist`, `skill_dist_tries`, `skill_shielding`, `skill_shielding_tries`, `skill_fishing`, `skill_fishing_tries`, `direction` FROM `players` WHERE `id` = ?";
+static constexpr std::string_view selectPlayerByName = "SELECT `id`, `name`, `account_id`, `group_id`, `sex`, `vocation`, `experience`, `level`, `maglevel`, `health`, `healthmax`, `blessings`, `mana`, `manamax`, `manaspent`, `soul`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `posx`, `posy`, `posz`, `cap`, `lastlogin`, `lastlogout`, `lastip`, `conditions`, `skulltime`, `skull`, `town_id`, `balance`, `offlinetraining_time`, `offlinetraining_skill`, `stamina`, `skill_fist`, `skill_fist_tries`, `skill_club`, `skill_club_tries`, `skill_sword`, `skill_sword_tries`, `skill_axe`, `skill_axe_tries`, `skill_dist`, `skill_dist_tries`, `skill_shielding`, `skill_shielding_tries`, `skill_fishing`, `skill_fishing_tries`, `direction` FROM `players` WHERE `name` = ?";
+
+// by PlayerSaveSection_t, the rows loadPlayer reads back
+static constexpr std::array<std::string_view, PLAYER_SAVE_LAST> loadSectionQueries = {
+	"SELECT `player_id`, `name` FROM `player_spells` WHERE `player_id` = ?",
+	"SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills` FROM `player_items` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	"SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_depotitems` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	"SELECT `sid`, `pid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_rewarditems` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	"SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_inboxitems` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	"SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_storeinboxitems` WHERE `player_id` = ? ORDER BY `sid` DESC",
+	"SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = ?",
+	"SELECT `player_id`, `augments` FROM `player_augments` WHERE `player_id` = ?",
+	"SELECT `player_id`, `skills` FROM `player_custom_skills` WHERE `player_id` = ?",
+};
+
+// the sections loadPlayerAsync reads on jobs of their own, the larger tables
+static constexpr std::array<std::pair<size_t, size_t>, 3> parallelLoadSections = {{
+	{PLAYER_SAVE_ITEMS, PLAYER_SAVE_DEPOT_ITEMS},
+	{PLAYER_SAVE_DEPOT_ITEMS, PLAYER_SAVE_STORAGE},
+	{PLAYER_SAVE_STORAGE, PLAYER_SAVE_AUGMENTS},
+}};
 
 #include <chrono>
 #include <thread>
@@ -25,7 +87,7 @@ Account IOLoginData::loadAccount(uint32_t accno)
 {
 	Account account;
 
-	DBResult_ptr result = Database::getInstance().storeQuery(fmt::format("SELECT `id`, `name`, `password`, `type`, `premium_ends_at` FROM `accounts` WHERE `id` = {:d}", accno));
+	DBResult_ptr result = Database::getInstance().storeStatement("SELECT `id`, `name`, `password`, `type`, `premium_ends_at` FROM `accounts` WHERE `id` = ?", {accno});
 	if (!result) {
 		return account;
 	}
@@ -66,11 +128,9 @@ std::string decodeSecret(const std::string_view secret)
 	return key;
 }
 
-bool IOLoginData::loginserverAuthentication(const std::string& name, const std::string& password, Account& account)
+bool IOLoginData::loginserverAuthentication(Database& db, const std::string& name, const std::string& password, Account& account)
 {
-	Database& db = Database::getInstance();
-
-	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `id`, `name`, `password`, `secret`, `type`, `premium_ends_at` FROM `accounts` WHERE `name` = {:s}", db.escapeString(name)));
+	DBResult_ptr result = db.storeStatement("SELECT `id`, `name`, `password`, `secret`, `type`, `premium_ends_at` FROM `accounts` WHERE `name` = ?", {name});
 	if (!result) {
 		return false;
 	}
@@ -87,24 +147,22 @@ bool IOLoginData::loginserverAuthentication(const std::string& name, const std::
 
 	if (g_config.getBoolean(ConfigManager::ENABLE_ACCOUNT_MANAGER) and account.id != AccountManager::ID) {
 		account.characters.push_back(AccountManager::NAME);
+		account.characterWorlds.push_back(g_config.getNumber(ConfigManager::WORLD_ID));
 	}
 
-	result = db.storeQuery(fmt::format("SELECT `name` FROM `players` WHERE `account_id` = {:d} AND `deletion` = 0 ORDER BY `name` ASC", account.id));
+	result = db.storeStatement("SELECT `name`, `world_id` FROM `players` WHERE `account_id` = ? AND `deletion` = 0 ORDER BY `name` ASC", {account.id});
 	if (result) {
 		do {
 			account.characters.emplace_back(result->getString("name"));
+			account.characterWorlds.push_back(result->getNumber<uint32_t>("world_id"));
 		} while (result->next());
 	}
 	return true;
 }
 
-std::pair<uint32_t, uint32_t> IOLoginData::gameworldAuthentication(std::string_view accountName, std::string_view password,	std::string_view characterName,	std::string_view token, uint32_t tokenTime)
+std::pair<uint32_t, uint32_t> IOLoginData::gameworldAuthentication(Database& db, std::string_view accountName, std::string_view password,	std::string_view characterName,	std::string_view token, uint32_t tokenTime)
 {
-	Database& db = Database::getInstance();
-
-	DBResult_ptr result = db.storeQuery(fmt::format(
-		"SELECT `a`.`id` AS `account_id`, `a`.`password`, `a`.`secret`, `p`.`id` AS `character_id` FROM `accounts` `a` JOIN `players` `p` ON `a`.`id` = `p`.`account_id` WHERE (`a`.`name` = {:s} OR `a`.`email` = {:s}) AND `p`.`name` = {:s} AND `p`.`deletion` = 0",
-		db.escapeString(accountName), db.escapeString(accountName), db.escapeString(characterName)));
+	DBResult_ptr result = db.storeStatement("SELECT `a`.`id` AS `account_id`, `a`.`password`, `a`.`secret`, `p`.`id` AS `character_id` FROM `accounts` `a` JOIN `players` `p` ON `a`.`id` = `p`.`account_id` WHERE (`a`.`name` = ? OR `a`.`email` = ?) AND `p`.`name` = ? AND `p`.`deletion` = 0", {accountName, accountName, characterName});
 	if (!result) {
 		return {};
 	}
@@ -148,36 +206,9 @@ void IOLoginData::loadPlayerAugments(std::vector<std::shared_ptr<Augment>>& augm
 		PropStream augmentStream;
 		augmentStream.init(augmentData.data(), augmentData.size());
 
-		uint32_t augmentCount = 0;
-
-		if (!augmentStream.read<uint32_t>(augmentCount)) {
-			return;
-		}
-
-		// Additional validation on augmentCount
-		if (augmentCount > MAX_AUGMENT_COUNT) {
-			std::cout << "ERROR: Augment count too high for player " << playerID << ": " << augmentCount << std::endl;
-			return;
-		}
-
-		augmentList.reserve(augmentCount);
-
-		for (uint32_t i = 0; i < augmentCount; ++i) {
-			auto augment = std::make_shared<Augment>();
-
-			try {
-				if (!augment->unserialize(augmentStream)) {
-					std::cout << "WARNING: Failed to unserialize augment " << i
-						<< " for player " << playerID << std::endl;
-					return;
-				}
-				augmentList.emplace_back(augment);
-			}
-			catch (const std::exception& e) {
-				std::cout << "ERROR: Exception while unserializing augment " << i
-					<< " for player " << playerID << ": " << e.what() << std::endl;
-				return;
-			}
+		// what was read before a failure is kept, as before
+		if (!Augments::Unserialize(augmentStream, augmentList, MAX_AUGMENT_COUNT)) {
+			std::cout << "WARNING: Failed to unserialize the augments of player " << playerID << std::endl;
 		}
 	}
 	catch (const std::exception& e) {
@@ -186,7 +217,7 @@ void IOLoginData::loadPlayerAugments(std::vector<std::shared_ptr<Augment>>& augm
 	}
 }
 
-void IOLoginData::serializeCustomSkills(const PlayerConstPtr player, DBInsert query, PropWriteStream& binary_stream)
+void IOLoginData::serializeCustomSkills(const PlayerConstPtr player, DBInsert& query, PropWriteStream& binary_stream)
 {
 	binary_stream.write<uint32_t>(player->getCustomSkills().size());
 	for (const auto& [name, skill] : player->getCustomSkills())
@@ -203,7 +234,7 @@ void IOLoginData::serializeCustomSkills(const PlayerConstPtr player, DBInsert qu
 	}
 }
 
-void IOLoginData::serializeCustomSkills(const ItemConstPtr item, DBInsert query, PropWriteStream& binary_stream)
+void IOLoginData::serializeCustomSkills(const ItemConstPtr item, DBInsert& query, PropWriteStream& binary_stream)
 {
 	binary_stream.write<uint32_t>(item->getCustomSkills().size());
 	for (const auto& [name, skill] : item->getCustomSkills())
@@ -269,8 +300,7 @@ SkillRegistry IOLoginData::deserializeCustomSkills(PropStream binary_stream)
 		}
 
 		auto skill = Components::Skills::CustomSkill::make_skill(formula, max_level, multiplier, difficulty, threshold);
-		skill->addPoints(current_points);
-		skill->setBonus(bonus_level);
+		skill->restore(current_level, current_points, bonus_level);
 
 		skill_set.emplace(std::string(name), skill);
 	}
@@ -279,7 +309,6 @@ SkillRegistry IOLoginData::deserializeCustomSkills(PropStream binary_stream)
 
 bool IOLoginData::savePlayerCustomSkills(const PlayerConstPtr& player, DBInsert& query_insert, PropWriteStream& binary_stream) 
 {
-	const Database& db = Database::getInstance();
 	auto& skills = player->getCustomSkills();
 	const uint32_t skill_count = skills.size();
 	binary_stream.clear();
@@ -288,7 +317,10 @@ bool IOLoginData::savePlayerCustomSkills(const PlayerConstPtr& player, DBInsert&
 
 	auto skills_blob = binary_stream.getStream();
 
-	if (not query_insert.addRow(fmt::format("{:d}, {:s}", player->getGUID(), db.escapeString(skills_blob)))) 
+	query_insert.beginRow();
+	query_insert.addNumber(player->getGUID());
+	query_insert.addBlob(skills_blob);
+	if (!query_insert.endRow()) 
 	{
 		return false;
 	}
@@ -332,12 +364,10 @@ void IOLoginData::setAccountType(uint32_t accountId, AccountType_t accountType)
 	Database::getInstance().executeQuery(fmt::format("UPDATE `accounts` SET `type` = {:d} WHERE `id` = {:d}", static_cast<uint16_t>(accountType), accountId));
 }
 
-std::pair<uint32_t, uint32_t> IOLoginData::getAccountIdByAccountName(std::string_view accountName,
+std::pair<uint32_t, uint32_t> IOLoginData::getAccountIdByAccountName(Database& db, std::string_view accountName,
 	std::string_view password,
 	std::string_view characterName)
 {
-	Database& db = Database::getInstance();
-
 	DBResult_ptr result = db.storeQuery(
 		fmt::format("SELECT `id`, `password` FROM `accounts` WHERE `name` = {:s}", db.escapeString(accountName)));
 	if (!result) {
@@ -362,22 +392,25 @@ std::pair<uint32_t, uint32_t> IOLoginData::getAccountIdByAccountName(std::string
 
 void IOLoginData::updateOnlineStatus(uint32_t guid, bool login)
 {
-	if (g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
+	// simulated players have no character
+	if (guid == 0 || g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
 		return;
 	}
 
 	if (login) {
-		Database::getInstance().executeQuery(fmt::format("INSERT INTO `players_online` VALUES ({:d})", guid));
+		Database::getInstance().executeStatement("INSERT INTO `players_online` VALUES (?)", {guid});
 	} else {
-		Database::getInstance().executeQuery(fmt::format("DELETE FROM `players_online` WHERE `player_id` = {:d}", guid));
+		Database::getInstance().executeStatement("DELETE FROM `players_online` WHERE `player_id` = ?", {guid});
 	}
 }
 
-bool IOLoginData::preloadPlayer(const PlayerPtr& player)
+DBResult_ptr IOLoginData::selectPreload(Database& db, uint32_t guid)
 {
-	Database& db = Database::getInstance();
+	return db.storeStatement("SELECT `p`.`name`, `p`.`account_id`, `p`.`group_id`, `p`.`world_id`, `a`.`type`, `a`.`premium_ends_at` FROM `players` AS `p` JOIN `accounts` AS `a` ON `a`.`id` = `p`.`account_id` WHERE `p`.`id` = ? AND `p`.`deletion` = 0", {guid});
+}
 
-	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `p`.`name`, `p`.`account_id`, `p`.`group_id`, `a`.`type`, `a`.`premium_ends_at` FROM `players` AS `p` JOIN `accounts` AS `a` ON `a`.`id` = `p`.`account_id` WHERE `p`.`id` = {:d} AND `p`.`deletion` = 0", player->getGUID()));
+bool IOLoginData::preloadPlayer(const PlayerPtr& player, const DBResult_ptr& result)
+{
 	if (!result) {
 		return false;
 	}
@@ -398,13 +431,13 @@ bool IOLoginData::preloadPlayer(const PlayerPtr& player)
 bool IOLoginData::loadPlayerById(const PlayerPtr& player, uint32_t id)
 {
 	Database& db = Database::getInstance();
-	return loadPlayer(player, db.storeQuery(fmt::format("SELECT `id`, `name`, `account_id`, `group_id`, `sex`, `vocation`, `experience`, `level`, `maglevel`, `health`, `healthmax`, `blessings`, `mana`, `manamax`, `manaspent`, `soul`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `posx`, `posy`, `posz`, `cap`, `lastlogin`, `lastlogout`, `lastip`, `conditions`, `skulltime`, `skull`, `town_id`, `balance`, `offlinetraining_time`, `offlinetraining_skill`, `stamina`, `skill_fist`, `skill_fist_tries`, `skill_club`, `skill_club_tries`, `skill_sword`, `skill_sword_tries`, `skill_axe`, `skill_axe_tries`, `skill_dist`, `skill_dist_tries`, `skill_shielding`, `skill_shielding_tries`, `skill_fishing`, `skill_fishing_tries`, `direction` FROM `players` WHERE `id` = {:d}", id)));
+	return loadPlayer(player, db.storeStatement(selectPlayerById, {id}));
 }
 
 bool IOLoginData::loadPlayerByName(const PlayerPtr& player, const std::string& name)
 {
 	Database& db = Database::getInstance();
-	return loadPlayer(player, db.storeQuery(fmt::format("SELECT `id`, `name`, `account_id`, `group_id`, `sex`, `vocation`, `experience`, `level`, `maglevel`, `health`, `healthmax`, `blessings`, `mana`, `manamax`, `manaspent`, `soul`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `posx`, `posy`, `posz`, `cap`, `lastlogin`, `lastlogout`, `lastip`, `conditions`, `skulltime`, `skull`, `town_id`, `balance`, `offlinetraining_time`, `offlinetraining_skill`, `stamina`, `skill_fist`, `skill_fist_tries`, `skill_club`, `skill_club_tries`, `skill_sword`, `skill_sword_tries`, `skill_axe`, `skill_axe_tries`, `skill_dist`, `skill_dist_tries`, `skill_shielding`, `skill_shielding_tries`, `skill_fishing`, `skill_fishing_tries`, `direction` FROM `players` WHERE `name` = {:s}", db.escapeString(name))));
+	return loadPlayer(player, db.storeStatement(selectPlayerByName, {name}));
 }
 
 bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
@@ -413,18 +446,234 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 		return false;
 	}
 
+	// the rows read so far may be older than a save that was still on its way
+	if (const uint32_t guid = result->getNumber<uint32_t>("id"); waitForPendingSave(guid)) {
+		return loadPlayerById(player, guid);
+	}
+
+	Database& db = Database::getInstance();
+
+	PlayerLoadData data;
+	data.player = std::move(result);
+	fetchPlayerDetails(db, data);
+	fetchPlayerSections(db, data, PLAYER_SAVE_SPELLS, PLAYER_SAVE_LAST);
+	return buildPlayer(player, data);
+}
+
+void IOLoginData::loadPlayerAsync(const PlayerPtr& player, uint32_t guid, std::function<void(bool)> callback)
+{
+	struct PlayerLoad
+	{
+		PlayerLoadData data;
+		PlayerPtr player;
+		std::function<void(bool)> callback;
+		// jobs still reading, the last one hands the player to the dispatcher
+		std::atomic<size_t> parts{parallelLoadSections.size() + 1};
+	};
+
+	auto load = std::make_shared<PlayerLoad>();
+	load->player = player;
+	load->callback = std::move(callback);
+	++loadingPlayers[guid];
+
+	const bool lazy = g_config.getBoolean(ConfigManager::LAZY_DEPOT_LOADING);
+	auto finish = [lazy, guid](const std::shared_ptr<PlayerLoad>& load) {
+		if (--load->parts != 0) {
+			return;
+		}
+
+		g_dispatcher.addTask(createTask([load, lazy, guid]() {
+			finishLoading(guid);
+			const bool loaded = load->data.player && buildPlayer(load->player, load->data);
+			if (loaded && lazy) {
+				load->player->unloadedSections = lazySections;
+			}
+			load->callback(loaded);
+		}, DISPATCHER_LANE_PLAYER));
+	};
+
+	// keyed by guid, so it runs after the saves of the player that are still queued
+	auto job = [load, finish, guid, lazy](Database& db) {
+		load->data.player = db.storeStatement(selectPlayerById, {guid});
+		if (!load->data.player) {
+			load->parts -= parallelLoadSections.size();
+			finish(load);
+			return false;
+		}
+
+		for (const auto& [first, last] : parallelLoadSections) {
+			auto part = [load, finish, first, last, lazy](Database& db) {
+				fetchPlayerSections(db, load->data, first, last, lazy);
+				finish(load);
+				return true;
+			};
+
+			if (!g_databaseTasks.addJob(part)) {
+				part(db);
+			}
+		}
+
+		fetchPlayerDetails(db, load->data);
+		fetchPlayerSections(db, load->data, PLAYER_SAVE_SPELLS, PLAYER_SAVE_ITEMS);
+		fetchPlayerSections(db, load->data, PLAYER_SAVE_AUGMENTS, PLAYER_SAVE_LAST);
+		finish(load);
+		return true;
+	};
+
+	if (!g_databaseTasks.addJob(job, nullptr, guid)) {
+		finishLoading(guid);
+		load->callback(loadPlayerById(player, guid));
+	}
+}
+
+bool IOLoginData::isLoadingPlayer(uint32_t guid)
+{
+	return loadingPlayers.contains(guid);
+}
+
+void IOLoginData::loadPlayerSectionsAsync(const PlayerPtr& player, std::function<void()> callback)
+{
+	if (!player->hasUnloadedSections()) {
+		callback();
+		return;
+	}
+
+	// one read for everybody who asks before it is back
+	player->sectionCallbacks.push_back(std::move(callback));
+	if (player->sectionCallbacks.size() > 1) {
+		return;
+	}
+
+	auto data = std::make_shared<PlayerLoadData>();
+	const auto sections = player->unloadedSections;
+	const uint32_t guid = player->getGUID();
+
+	auto finish = [player, data]() {
+		buildUnloadedSections(player, *data);
+		for (const auto& callback : std::exchange(player->sectionCallbacks, {})) {
+			callback();
+		}
+	};
+
+	// keyed by guid like the saves, those still queued are written first
+	const bool queued = g_databaseTasks.addJob([data, sections, guid](Database& db) {
+		for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+			if (sections[section]) {
+				data->sections[section] = db.storeStatement(loadSectionQueries[section], {guid});
+			}
+		}
+		return true;
+	}, [finish](bool) { finish(); }, guid, DISPATCHER_LANE_PLAYER);
+
+	if (!queued) {
+		loadPlayerSections(player);
+		finish();
+	}
+}
+
+void IOLoginData::loadPlayerSections(const PlayerPtr& player)
+{
+	if (!player->hasUnloadedSections()) {
+		return;
+	}
+
+	waitForPendingSave(player->getGUID());
+
 	Database& db = Database::getInstance();
+	PlayerLoadData data;
+	for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+		if (player->unloadedSections[section]) {
+			data.sections[section] = db.storeStatement(loadSectionQueries[section], {player->getGUID()});
+		}
+	}
+	buildUnloadedSections(player, data);
+}
+
+void IOLoginData::buildUnloadedSections(const PlayerPtr& player, const PlayerLoadData& data)
+{
+	if (!player->hasUnloadedSections()) {
+		return;
+	}
+
+	// a section loaded meanwhile, by a save that could not wait, keeps what it has
+	PlayerLoadData missing;
+	std::bitset<PLAYER_SAVE_LAST> merged;
+	for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+		if (player->unloadedSections[section]) {
+			missing.sections[section] = data.sections[section];
+			merged[section] = !isSectionEmpty(player, section);
+		}
+	}
+
+	const auto loaded = player->unloadedSections;
+	player->unloadedSections.reset();
+	buildItemSections(player, missing);
+	player->updateInventoryWeight();
+
+	// the rows read are what the tables hold, unless mail or loot reached the section before them
+	std::vector<DBInsert> sections;
+	PropWriteStream propWriteStream;
+	const bool built = buildSaveSections(player, sections, propWriteStream);
+	for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+		if (loaded[section]) {
+			player->savedChecksums[section] = built && !merged[section] ? sections[section].getChecksum() : 0;
+		}
+	}
+}
+
+bool IOLoginData::isSectionEmpty(const PlayerConstPtr& player, size_t section)
+{
+	switch (section) {
+		case PLAYER_SAVE_DEPOT_ITEMS:
+			return std::ranges::all_of(player->depotChests, [](const auto& it) { return it.second->empty(); });
+		case PLAYER_SAVE_REWARD_ITEMS:
+			return !player->rewardChest || player->rewardChest->empty();
+		case PLAYER_SAVE_INBOX_ITEMS:
+			return player->inbox->empty();
+		default:
+			return true;
+	}
+}
+
+void IOLoginData::fetchPlayerDetails(Database& db, PlayerLoadData& data)
+{
+	const uint32_t guid = data.player->getNumber<uint32_t>("id");
+	const uint32_t accountId = data.player->getNumber<uint32_t>("account_id");
+
+	data.account = db.storeStatement("SELECT `type`, `premium_ends_at` FROM `accounts` WHERE `id` = ?", {accountId});
+	if ((data.guildMembership = db.storeStatement("SELECT `guild_id`, `rank_id`, `nick` FROM `guild_membership` WHERE `player_id` = ?", {guid}))) {
+		data.guildMembers = db.storeStatement("SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = ?", {data.guildMembership->getNumber<uint32_t>("guild_id")});
+	}
+	data.vipList = db.storeStatement("SELECT `player_id` FROM `account_viplist` WHERE `account_id` = ?", {accountId});
+	data.accountStorage = db.storeStatement("SELECT `key`, `value` FROM `account_storage` WHERE `account_id` = ?", {accountId});
+}
+
+void IOLoginData::fetchPlayerSections(Database& db, PlayerLoadData& data, size_t first, size_t last, bool lazy/* = false*/)
+{
+	const uint32_t guid = data.player->getNumber<uint32_t>("id");
+	for (size_t section = first; section < last; ++section) {
+		if (lazy && lazySections[section]) {
+			continue;
+		}
+		data.sections[section] = db.storeStatement(loadSectionQueries[section], {guid});
+	}
+}
 
-	uint32_t accno = result->getNumber<uint32_t>("account_id");
-	Account acc = loadAccount(accno);
+bool IOLoginData::buildPlayer(const PlayerPtr& player, const PlayerLoadData& data)
+{
+	DBResult_ptr result = data.player;
 
 	player->setGUID(result->getNumber<uint32_t>("id"));
 	player->name = result->getString("name");
-	player->accountNumber = accno;
-
-	player->accountType = acc.accountType;
+	player->accountNumber = result->getNumber<uint32_t>("account_id");
 
-	player->premiumEndsAt = acc.premiumEndsAt;
+	if (data.account) {
+		player->accountType = static_cast<AccountType_t>(data.account->getNumber<int32_t>("type"));
+		player->premiumEndsAt = data.account->getNumber<time_t>("premium_ends_at");
+	} else {
+		player->accountType = ACCOUNT_TYPE_NORMAL;
+		player->premiumEndsAt = 0;
+	}
 
 	Group* group = g_game.groups.getGroup(result->getNumber<uint16_t>("group_id"));
 	if (!group) {
@@ -558,7 +807,7 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 		player->skills[i].percent = Player::getPercentLevel(skillTries, nextSkillTries);
 	}
 
-	if ((result = db.storeQuery(fmt::format("SELECT `guild_id`, `rank_id`, `nick` FROM `guild_membership` WHERE `player_id` = {:d}", player->getGUID())))) {
+	if ((result = data.guildMembership)) {
 		uint32_t guildId = result->getNumber<uint32_t>("guild_id");
 		uint32_t playerRankId = result->getNumber<uint32_t>("rank_id");
 		player->guildNick = result->getString("nick");
@@ -577,7 +826,7 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 			player->guild = guild;
 			GuildRank_ptr rank = guild->getRankById(playerRankId);
 			if (!rank) {
-				if ((result = db.storeQuery(fmt::format("SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = {:d}", playerRankId)))) {
+				if ((result = Database::getInstance().storeStatement("SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = ?", {playerRankId}))) {
 					guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
 				}
 
@@ -589,22 +838,22 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 
 			player->guildRank = rank;
 
-			if ((result = db.storeQuery(fmt::format("SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = {:d}", guildId)))) {
+			if ((result = data.guildMembers)) {
 				guild->setMemberCount(result->getNumber<uint32_t>("members"));
 			}
 		}
 	}
 
-	if ((result = db.storeQuery(fmt::format("SELECT `player_id`, `name` FROM `player_spells` WHERE `player_id` = {:d}", player->getGUID())))) {
+	if ((result = data.sections[PLAYER_SAVE_SPELLS])) {
 		do {
-			player->learnedInstantSpellList.emplace_front(result->getString("name"));
+			player->learnInstantSpell(std::string(result->getString("name")));
 		} while (result->next());
 	}
 
 	//load inventory items
 	ItemMap itemMap;
 
-	if ((result = db.storeQuery(fmt::format("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills` FROM `player_items` WHERE `player_id` = {:d} ORDER BY `sid` DESC", player->getGUID())))) {
+	if ((result = data.sections[PLAYER_SAVE_ITEMS])) {
 		loadItems(itemMap, result);
 
 		for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
@@ -627,10 +876,104 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 		}
 	}
 
-	//load depot items
-	itemMap.clear();
+	buildItemSections(player, data);
+
+	//load storage map
+	if ((result = data.sections[PLAYER_SAVE_STORAGE])) {
+		do {
+			player->addStorageValue(result->getNumber<uint32_t>("key"), result->getNumber<int32_t>("value"), true);
+		} while (result->next());
+	}
+
+	// changes that did not reach the table yet are newer than its rows
+	g_game.getStorageJournal().forEachChange(STORAGE_TABLE_PLAYER, player->getGUID(), [&player](uint32_t key, int32_t value) {
+		player->addStorageValue(key, value, true);
+	});
+	g_game.loadAccountStorage(player->getAccount(), data.accountStorage);
+
+	if ((result = data.sections[PLAYER_SAVE_AUGMENTS])) {
+		try {
+			std::vector<std::shared_ptr<Augment>> augments;
+			IOLoginData::loadPlayerAugments(augments, result);
+
+			if (!augments.empty()) {
+				for (auto& augment : augments) {
+					if (augment) {
+						player->addAugment(augment);
+					}
+				}
+			}
+		}
+		catch (const std::exception& e) {
+			std::cout << "ERROR: Failed to process loaded augments: " << e.what() << std::endl;
+		}
+	}
+
+	// I used a lambda with immediate execution in order to be able to return early in case of corrupt data or failed loading
+	[&]() -> void 
+		{
+		if ((result = data.sections[PLAYER_SAVE_CUSTOM_SKILLS])) {
+			try
+			{
+				if (not result) 
+				{
+					std::cout << "ERROR: Null result in loading player custom skills" << std::endl;
+					return;
+				}
+
+				uint32_t player_id = result->getNumber<uint32_t>("player_id");
+				auto skill_data = result->getString("skills");
+
+				if (skill_data.empty()) 
+				{
+					return;
+				}
+				
+				PropStream binary_stream;
+				binary_stream.init(skill_data.data(), skill_data.size());
+
+				if (auto skill_set = IOLoginData::deserializeCustomSkills(binary_stream); skill_set.size() > 0)
+				{
+					player->setCustomSkills(std::move(skill_set));
+				}
+
+			}
+			catch (const std::exception& e) 
+			{
+				std::cout << "ERROR: Failed to load custom skills : " << e.what() << std::endl;
+			}
+		}
+		}();
+
+	//load vip list
+	if ((result = data.vipList)) {
+		do {
+			player->addVIPInternal(result->getNumber<uint32_t>("player_id"));
+		} while (result->next());
+	}
+
+	player->updateBaseSpeed();
+	player->updateInventoryWeight();
+	player->updateItemsLight(true);
+
+	// what was just loaded is what the tables hold, the first save skips what did not change since
+	std::vector<DBInsert> sections;
+	PropWriteStream propWriteStream;
+	if (buildSaveSections(player, sections, propWriteStream)) {
+		for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+			player->savedChecksums[section] = sections[section].getChecksum();
+		}
+	}
+	return true;
+}
+
+void IOLoginData::buildItemSections(const PlayerPtr& player, const PlayerLoadData& data)
+{
+	ItemMap itemMap;
+	DBResult_ptr result;
 
-	if ((result = db.storeQuery(fmt::format("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_depotitems` WHERE `player_id` = {:d} ORDER BY `sid` DESC", player->getGUID())))) {
+	//load depot items
+	if ((result = data.sections[PLAYER_SAVE_DEPOT_ITEMS])) {
 		loadItems(itemMap, result);
 
 		for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
@@ -658,7 +1001,7 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 	// Load reward items
 	itemMap.clear();
 
-	if ((result = db.storeQuery(fmt::format("SELECT `sid`, `pid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_rewarditems` WHERE `player_id` = {:d} ORDER BY `sid` DESC", player->getGUID())))) {
+	if ((result = data.sections[PLAYER_SAVE_REWARD_ITEMS])) {
 		loadItems(itemMap, result);
 
 		for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
@@ -684,7 +1027,7 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 	//load inbox items
 	itemMap.clear();
 
-	if ((result = db.storeQuery(fmt::format("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_inboxitems` WHERE `player_id` = {:d} ORDER BY `sid` DESC", player->getGUID())))) {
+	if ((result = data.sections[PLAYER_SAVE_INBOX_ITEMS])) {
 		loadItems(itemMap, result);
 
 		for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
@@ -710,7 +1053,7 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 	//load store inbox items
 	itemMap.clear();
 
-	if ((result = db.storeQuery(fmt::format("SELECT `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments` FROM `player_storeinboxitems` WHERE `player_id` = {:d} ORDER BY `sid` DESC", player->getGUID())))) {
+	if ((result = data.sections[PLAYER_SAVE_STORE_INBOX_ITEMS])) {
 		loadItems(itemMap, result);
 
 		for (ItemMap::const_reverse_iterator it = itemMap.rbegin(), end = itemMap.rend(); it != end; ++it) {
@@ -732,108 +1075,40 @@ bool IOLoginData::loadPlayer(const PlayerPtr& player, DBResult_ptr result)
 			}
 		}
 	}
+}
 
-	//load storage map
-	if ((result = db.storeQuery(fmt::format("SELECT `key`, `value` FROM `player_storage` WHERE `player_id` = {:d}", player->getGUID())))) {
-		do {
-			player->addStorageValue(result->getNumber<uint32_t>("key"), result->getNumber<int32_t>("value"), true);
-		} while (result->next());
-	}
-
-	if ((result = db.storeQuery(fmt::format("SELECT `player_id`, `augments` FROM `player_augments` WHERE `player_id` = {:d}", player->getGUID())))) {
-		try {
-			std::vector<std::shared_ptr<Augment>> augments;
-			IOLoginData::loadPlayerAugments(augments, result);
+std::string_view IOLoginData::serializeItemAttributes(const ItemConstPtr& item, PropWriteStream& propWriteStream)
+{
+	propWriteStream.clear();
+	propWriteStream.beginCompact(ITEM_ATTRIBUTES_COMPACT_HEADER);
+	item->serializeAttr(propWriteStream);
 
-			if (!augments.empty()) {
-				for (auto& augment : augments) {
-					if (augment) {
-						player->addAugment(augment);
-					}
-				}
-			}
-		}
-		catch (const std::exception& e) {
-			std::cout << "ERROR: Failed to process loaded augments: " << e.what() << std::endl;
-		}
+	const auto attributesData = propWriteStream.getStream();
+	if (attributesData.size() == ITEM_ATTRIBUTES_COMPACT_HEADER.size()) {
+		return {};
 	}
+	return attributesData;
+}
 
-	// I used a lambda with immediate execution in order to be able to return early in case of corrupt data or failed loading
-	[&]() -> void 
-		{
-		if ((result = db.storeQuery(fmt::format("SELECT `player_id`, `skills` FROM `player_custom_skills` WHERE `player_id` = {:d}", player->getGUID())))) {
-			try
-			{
-				if (not result) 
-				{
-					std::cout << "ERROR: Null result in loading player custom skills" << std::endl;
-					return;
-				}
+bool IOLoginData::saveItems(const PlayerConstPtr& player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& propWriteStream)
+{
+	using ContainerBlock = std::pair<ContainerPtr, int32_t>;
+	std::vector<ContainerBlock> containers;
+	containers.reserve(32);
 
-				uint32_t player_id = result->getNumber<uint32_t>("player_id");
-				auto skill_data = result->getString("skills");
+	int32_t runningId = 100;
 
-				if (skill_data.empty()) 
-				{
-					return;
-				}
-				
-				PropStream binary_stream;
-				binary_stream.init(skill_data.data(), skill_data.size());
+	for (const auto& it : itemList) {
+		int32_t pid = it.first;
+		auto item = it.second;
+		++runningId;
 
-				if (auto skill_set = IOLoginData::deserializeCustomSkills(binary_stream); skill_set.size() > 0)
-				{
-					player->setCustomSkills(std::move(skill_set));
-				}
-
-			}
-			catch (const std::exception& e) 
-			{
-				std::cout << "ERROR: Failed to load custom skills : " << e.what() << std::endl;
-			}
-		}
-		}();
-
-	//load vip list
-	if ((result = db.storeQuery(fmt::format("SELECT `player_id` FROM `account_viplist` WHERE `account_id` = {:d}", player->getAccount())))) {
-		do {
-			player->addVIPInternal(result->getNumber<uint32_t>("player_id"));
-		} while (result->next());
-	}
-
-	player->updateBaseSpeed();
-	player->updateInventoryWeight();
-	player->updateItemsLight(true);
-	return true;
-}
-
-bool IOLoginData::saveItems(const PlayerConstPtr& player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& propWriteStream)
-{
-	using ContainerBlock = std::pair<ContainerPtr, int32_t>;
-	std::vector<ContainerBlock> containers;
-	containers.reserve(32);
-
-	int32_t runningId = 100;
-
-	Database& db = Database::getInstance();
-
-	for (const auto& it : itemList) {
-		int32_t pid = it.first;
-		auto item = it.second;
-		++runningId;
-
-		propWriteStream.clear();
-		item->serializeAttr(propWriteStream);
-		const auto attributesData = propWriteStream.getStream();
+		const auto attributesData = serializeItemAttributes(item, propWriteStream);
 
 		auto augmentStream = PropWriteStream();
 		const auto& augments = item->getAugments();
 		augmentStream.clear();
-		augmentStream.write<uint32_t>(augments.size());
-
-		for (const auto& augment : augments) {
-			augment->serialize(augmentStream);
-		}
+		Augments::Serialize(augmentStream, augments);
 
 		const auto augmentsData = augmentStream.getStream();
 
@@ -843,11 +1118,16 @@ bool IOLoginData::saveItems(const PlayerConstPtr& player, const ItemBlockList& i
 
 		const auto& skill_data = skill_stream.getStream();
 
-		if (!query_insert.addRow(fmt::format("{:d}, {:d}, {:d}, {:d}, {:d}, {:s}, {:s}, {:s}",
-			player->getGUID(), pid, runningId, item->getID(), item->getSubType(),
-			db.escapeString(attributesData),
-			db.escapeString(augmentsData),
-			db.escapeString(skill_data)))) {
+		query_insert.beginRow();
+		query_insert.addNumber(player->getGUID());
+		query_insert.addNumber(pid);
+		query_insert.addNumber(runningId);
+		query_insert.addNumber(item->getID());
+		query_insert.addNumber(item->getSubType());
+		query_insert.addBlob(attributesData);
+		query_insert.addBlob(augmentsData);
+		query_insert.addBlob(skill_data);
+		if (!query_insert.endRow()) {
 			return false;
 		}
 
@@ -864,18 +1144,12 @@ bool IOLoginData::saveItems(const PlayerConstPtr& player, const ItemBlockList& i
 		for (auto item : container->getItemList()) {
 			++runningId;
 
-			propWriteStream.clear();
-			item->serializeAttr(propWriteStream);
-			auto attributesData = propWriteStream.getStream();
+			auto attributesData = serializeItemAttributes(item, propWriteStream);
 
 			auto augmentStream = PropWriteStream();
 			const auto& augments = item->getAugments();
 			augmentStream.clear();
-			augmentStream.write<uint32_t>(augments.size());
-
-			for (const auto& augment : augments) {
-				augment->serialize(augmentStream);
-			}
+			Augments::Serialize(augmentStream, augments);
 
 			auto augmentsData = augmentStream.getStream();
 
@@ -886,11 +1160,16 @@ bool IOLoginData::saveItems(const PlayerConstPtr& player, const ItemBlockList& i
 
 			const auto& skill_data = skill_stream.getStream();
 
-			if (!query_insert.addRow(fmt::format("{:d}, {:d}, {:d}, {:d}, {:d}, {:s}, {:s}, {:s}",
-				player->getGUID(), parentId, runningId, item->getID(), item->getSubType(),
-				db.escapeString(attributesData),
-				db.escapeString(augmentsData),
-				db.escapeString(skill_data)))) {
+			query_insert.beginRow();
+			query_insert.addNumber(player->getGUID());
+			query_insert.addNumber(parentId);
+			query_insert.addNumber(runningId);
+			query_insert.addNumber(item->getID());
+			query_insert.addNumber(item->getSubType());
+			query_insert.addBlob(attributesData);
+			query_insert.addBlob(augmentsData);
+			query_insert.addBlob(skill_data);
+			if (!query_insert.endRow()) {
 				return false;
 			}
 
@@ -904,11 +1183,9 @@ bool IOLoginData::saveItems(const PlayerConstPtr& player, const ItemBlockList& i
 }
 
 bool IOLoginData::saveAugments(const PlayerConstPtr& player, DBInsert& query_insert, PropWriteStream& augmentStream) {
-	const Database& db = Database::getInstance();
 	auto& augments = player->getPlayerAugments();
 	const uint32_t augmentCount = augments.size();
 	augmentStream.clear();
-	augmentStream.write<uint32_t>(augmentCount);
 
 	// Cap the max augments at a reasonable limit
 	if (augmentCount > MAX_AUGMENT_COUNT) {
@@ -917,9 +1194,7 @@ bool IOLoginData::saveAugments(const PlayerConstPtr& player, DBInsert& query_ins
 		return false;
 	}
 
-	for (auto& augment : augments) {
-		augment->serialize(augmentStream);
-	}
+	Augments::Serialize(augmentStream, augments);
 
 	auto augmentsData = augmentStream.getStream();
 
@@ -930,7 +1205,10 @@ bool IOLoginData::saveAugments(const PlayerConstPtr& player, DBInsert& query_ins
 		return false;
 	}
 
-	if (!query_insert.addRow(fmt::format("{:d}, {:s}", player->getGUID(), db.escapeString(augmentsData)))) {
+	query_insert.beginRow();
+	query_insert.addNumber(player->getGUID());
+	query_insert.addBlob(augmentsData);
+	if (!query_insert.endRow()) {
 		return false;
 	}
 
@@ -945,23 +1223,16 @@ bool IOLoginData::addRewardItems(uint32_t playerID, const ItemBlockList& itemLis
 	std::vector<ContainerBlock> containers;
 	containers.reserve(32);
 	int32_t runningId = 100;
-	Database& db = Database::getInstance();
-
 	for (const auto& it : itemList) {
 		int32_t pid = it.first;
 		const auto item = it.second;
 		++runningId;
-		propWriteStream.clear();
-		item->serializeAttr(propWriteStream);
-		const auto attributesData = propWriteStream.getStream();
+		const auto attributesData = serializeItemAttributes(item, propWriteStream);
 
 		auto augmentStream = PropWriteStream();
 		const auto& augments = item->getAugments();
 		augmentStream.clear();
-		augmentStream.write(augments.size());
-		for (const auto& augment : augments) {
-			augment->serialize(augmentStream);
-		}
+		Augments::Serialize(augmentStream, augments);
 		const auto augmentsData = augmentStream.getStream();
 
 
@@ -972,11 +1243,16 @@ bool IOLoginData::addRewardItems(uint32_t playerID, const ItemBlockList& itemLis
 
 		const auto& skill_data = skill_stream.getStream();
 
-		if (!query_insert.addRow(fmt::format("{:d}, {:d}, {:d}, {:d}, {:d}, {:s}, {:s}, {:s}",
-			playerID, pid, runningId, item->getID(), item->getSubType(),
-			db.escapeString(attributesData),
-			db.escapeString(augmentsData),
-			db.escapeString(skill_data)))) {
+		query_insert.beginRow();
+		query_insert.addNumber(playerID);
+		query_insert.addNumber(pid);
+		query_insert.addNumber(runningId);
+		query_insert.addNumber(item->getID());
+		query_insert.addNumber(item->getSubType());
+		query_insert.addBlob(attributesData);
+		query_insert.addBlob(augmentsData);
+		query_insert.addBlob(skill_data);
+		if (!query_insert.endRow()) {
 			return false;
 		}
 
@@ -992,17 +1268,12 @@ bool IOLoginData::addRewardItems(uint32_t playerID, const ItemBlockList& itemLis
 
 		for (auto item : container->getItemList()) {
 			++runningId;
-			propWriteStream.clear();
-			item->serializeAttr(propWriteStream);
-			auto attributesData = propWriteStream.getStream();
+			auto attributesData = serializeItemAttributes(item, propWriteStream);
 
 			auto augmentStream = PropWriteStream();
 			const auto& augments = item->getAugments();
 			augmentStream.clear();
-			augmentStream.write(augments.size());
-			for (const auto& augment : augments) {
-				augment->serialize(augmentStream);
-			}
+			Augments::Serialize(augmentStream, augments);
 			auto augmentsData = augmentStream.getStream();
 
 			auto skill_stream = PropWriteStream();
@@ -1012,11 +1283,16 @@ bool IOLoginData::addRewardItems(uint32_t playerID, const ItemBlockList& itemLis
 
 			const auto& skill_data = skill_stream.getStream();
 
-			if (!query_insert.addRow(fmt::format("{:d}, {:d}, {:d}, {:d}, {:d}, {:s}, {:s}, {:s}",
-				playerID, parentId, runningId, item->getID(), item->getSubType(),
-				db.escapeString(attributesData),
-				db.escapeString(augmentsData),
-				db.escapeString(skill_data)))) {
+			query_insert.beginRow();
+			query_insert.addNumber(playerID);
+			query_insert.addNumber(parentId);
+			query_insert.addNumber(runningId);
+			query_insert.addNumber(item->getID());
+			query_insert.addNumber(item->getSubType());
+			query_insert.addBlob(attributesData);
+			query_insert.addBlob(augmentsData);
+			query_insert.addBlob(skill_data);
+			if (!query_insert.endRow()) {
 				return false;
 			}
 
@@ -1029,24 +1305,220 @@ bool IOLoginData::addRewardItems(uint32_t playerID, const ItemBlockList& itemLis
 	return query_insert.execute();
 }
 
+void IOLoginData::addInboxItemAsync(uint32_t guid, const ItemPtr& item)
+{
+	Database& db = Database::getInstance();
+	auto query = std::make_shared<DBInsert>("INSERT INTO `player_inboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
+	PropWriteStream propWriteStream;
+
+	// the item and what it holds with their rows but the ids, the sids count from 1
+	// and the pid of the item is 0, the inbox
+	struct InboxRow
+	{
+		uint32_t pid;
+		std::string values;
+	};
+	auto rows = std::make_shared<std::vector<InboxRow>>();
 
-bool IOLoginData::savePlayer(const PlayerPtr& player)
+	std::vector<std::pair<ItemPtr, uint32_t>> items = {{item, 0}};
+	for (size_t i = 0; i < items.size(); ++i) {
+		const auto [current, pid] = items[i];
+
+		const auto attributesData = serializeItemAttributes(current, propWriteStream);
+		std::string values = fmt::format("{:d}, {:d}, {:s}, ", current->getID(), current->getSubType(), db.escapeBlob(attributesData.data(), attributesData.size()));
+
+		PropWriteStream augmentStream;
+		const auto& augments = current->getAugments();
+		Augments::Serialize(augmentStream, augments);
+		const auto augmentsData = augmentStream.getStream();
+		values += db.escapeBlob(augmentsData.data(), augmentsData.size());
+
+		PropWriteStream skillStream;
+		IOLoginData::serializeCustomSkills(current, *query, skillStream);
+		const auto skillData = skillStream.getStream();
+		values += ", ";
+		values += db.escapeBlob(skillData.data(), skillData.size());
+
+		rows->push_back({pid, std::move(values)});
+
+		if (const auto container = current->getContainer()) {
+			for (const auto& containerItem : container->getItemList()) {
+				items.emplace_back(containerItem, i + 1);
+			}
+		}
+	}
+
+	// keyed by guid, so it lands after the saves of the player that are still queued and
+	// before their next login reads the inbox
+	auto job = [guid, query, rows](Database& db) {
+		// no row when the player no longer exists
+		DBResult_ptr result = db.storeQuery(fmt::format("SELECT (SELECT MAX(`sid`) FROM `player_inboxitems` WHERE `player_id` = {0:d}) AS `sid` FROM `players` WHERE `id` = {0:d}", guid));
+		if (!result) {
+			return false;
+		}
+
+		const uint32_t firstSid = std::max<uint32_t>(result->getNumber<uint32_t>("sid"), 100) + 1;
+
+		query->hold();
+		for (size_t i = 0; i < rows->size(); ++i) {
+			const InboxRow& row = (*rows)[i];
+			const uint32_t pid = row.pid == 0 ? 0 : firstSid + row.pid - 1;
+			if (!query->addRow(fmt::format("{:d}, {:d}, {:d}, {:s}", guid, pid, firstSid + i, row.values))) {
+				return false;
+			}
+		}
+		return query->release(db);
+	};
+
+	if (!g_databaseTasks.addJob(job, nullptr, guid)) {
+		job(db);
+	}
+}
+
+bool IOLoginData::buildSaveSections(const PlayerPtr& player, std::vector<DBInsert>& sections, PropWriteStream& propWriteStream)
 {
-	if (player->getHealth() <= 0) {
-		player->changeHealth(1);
+	sections.reserve(PLAYER_SAVE_LAST);
+
+	// learned spells
+	DBInsert& spellsQuery = sections.emplace_back("INSERT INTO `player_spells` (`player_id`, `name` ) VALUES ");
+	spellsQuery.hold();
+	for (const InternedString& spell : player->learnedInstantSpells) {
+		spellsQuery.beginRow();
+		spellsQuery.addNumber(player->getGUID());
+		spellsQuery.addBlob(spell.str());
+		if (!spellsQuery.endRow()) {
+			return false;
+		}
 	}
 
-	Database& db = Database::getInstance();
+	//item saving
+	DBInsert& itemsQuery = sections.emplace_back("INSERT INTO `player_items` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills` ) VALUES ");
+	itemsQuery.hold();
 
-	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `save` FROM `players` WHERE `id` = {:d}", player->getGUID()));
-	if (!result) {
+	ItemBlockList itemList;
+	for (int32_t slotId = CONST_SLOT_FIRST; slotId <= CONST_SLOT_LAST; ++slotId) {
+		if (auto item = player->inventory[slotId]) {
+			itemList.emplace_back(slotId, item);
+		}
+	}
+
+	if (!saveItems(player, itemList, itemsQuery, propWriteStream)) {
 		return false;
 	}
 
-	if (result->getNumber<uint16_t>("save") == 0) {
-		return db.executeQuery(fmt::format("UPDATE `players` SET `lastlogin` = {:d}, `lastip` = {:d} WHERE `id` = {:d}", player->lastLoginSaved, player->lastIP, player->getGUID()));
+	//save depot items
+	DBInsert& depotQuery = sections.emplace_back("INSERT INTO `player_depotitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
+	depotQuery.hold();
+	itemList.clear();
+
+	for (const auto& it : player->depotChests) {
+		for (auto item : it.second->getItemList()) {
+			itemList.emplace_back(it.first, item);
+		}
+	}
+
+	if (!saveItems(player, itemList, depotQuery, propWriteStream)) {
+		return false;
+	}
+
+	// save reward items
+	DBInsert& rewardQuery = sections.emplace_back("INSERT INTO `player_rewarditems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
+	rewardQuery.hold();
+	itemList.clear();
+
+	for (auto item : player->getRewardChest()->getItemList()) {
+		itemList.emplace_back(0, item);
+	}
+
+	if (!saveItems(player, itemList, rewardQuery, propWriteStream)) {
+		return false;
+	}
+
+	//save inbox items
+	DBInsert& inboxQuery = sections.emplace_back("INSERT INTO `player_inboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`,  `augments`, `skills`) VALUES ");
+	inboxQuery.hold();
+	itemList.clear();
+
+	for (auto item : player->getInbox()->getItemList()) {
+		itemList.emplace_back(0, item);
+	}
+
+	if (!saveItems(player, itemList, inboxQuery, propWriteStream)) {
+		return false;
+	}
+
+	//save store inbox items
+	DBInsert& storeInboxQuery = sections.emplace_back("INSERT INTO `player_storeinboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
+	storeInboxQuery.hold();
+	itemList.clear();
+
+	for (auto item : player->getStoreInbox()->getItemList()) {
+		itemList.emplace_back(0, item);
+	}
+
+	if (!saveItems(player, itemList, storeInboxQuery, propWriteStream)) {
+		return false;
+	}
+
+	DBInsert& storageQuery = sections.emplace_back("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ");
+	storageQuery.hold();
+	player->genReservedStorageRange();
+
+	// only the reserved range, the other keys are written by the storage journal
+	bool storageWritten = true;
+	player->storageMap.forEach([&](uint32_t key, int32_t value) {
+		if (!storageWritten || !IS_IN_KEYRANGE(key, RESERVED_RANGE)) {
+			return;
+		}
+
+		storageQuery.beginRow();
+		storageQuery.addNumber(player->getGUID());
+		storageQuery.addNumber(key);
+		storageQuery.addNumber(value);
+		storageWritten = storageQuery.endRow();
+	});
+
+	if (!storageWritten) {
+		return false;
+	}
+
+	DBInsert& augmentQuery = sections.emplace_back("INSERT INTO `player_augments` (`player_id`, `augments`) VALUES ");
+	augmentQuery.hold();
+	PropWriteStream augmentStream;
+
+	// Size check before proceeding
+	if (!saveAugments(player, augmentQuery, augmentStream)) {
+		return false;
+	}
+
+	DBInsert& skill_query = sections.emplace_back("INSERT INTO `player_custom_skills` (`player_id`, `skills`) VALUES ");
+	skill_query.hold();
+	PropWriteStream binary_stream;
+
+	savePlayerCustomSkills(player, skill_query, binary_stream);
+	return true;
+}
+
+bool IOLoginData::preparePlayerSave(const PlayerPtr& player, PlayerSaveData& save)
+{
+	if (player->getHealth() <= 0) {
+		player->changeHealth(1);
 	}
 
+	// an unloaded section is left as it is in the table, unless something was
+	// put into it since, then the rows are read here to be written with it
+	for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+		if (player->unloadedSections[section] && !isSectionEmpty(player, section)) {
+			loadPlayerSections(player);
+			break;
+		}
+	}
+
+	Database& db = Database::getInstance();
+
+	save.guid = player->getGUID();
+	save.loginQuery = fmt::format("UPDATE `players` SET `lastlogin` = {:d}, `lastip` = {:d} WHERE `id` = {:d}", player->lastLoginSaved, player->lastIP, player->getGUID());
+
 	//serialize conditions
 	PropWriteStream propWriteStream;
 	for (auto condition : player->conditions) {
@@ -1140,159 +1612,175 @@ bool IOLoginData::savePlayer(const PlayerPtr& player)
 	}
 	query << "`blessings` = " << player->blessings.to_ulong();
 	query << " WHERE `id` = " << player->getGUID();
+	save.playerQuery = query.str();
 
-	DBTransaction transaction;
-	if (!transaction.begin()) {
+	// every section is built here and only rewritten when its rows differ
+	// from the ones this player object saved or was loaded with
+	if (!buildSaveSections(player, save.sections, propWriteStream)) {
 		return false;
 	}
 
-	if (!db.executeQuery(query.str())) {
-		return false;
+	for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+		save.checksums[section] = save.sections[section].getChecksum();
+		// the rows of an unloaded section are not in the player to be written again
+		save.changed[section] = save.checksums[section] != player->savedChecksums[section] && !player->unloadedSections[section];
 	}
+	return true;
+}
 
-	// learned spells
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_spells` WHERE `player_id` = {:d}", player->getGUID()))) {
+bool IOLoginData::writePlayerSave(Database& db, PlayerSaveData& save)
+{
+	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `save` FROM `players` WHERE `id` = {:d}", save.guid));
+	if (!result) {
 		return false;
 	}
 
-	DBInsert spellsQuery("INSERT INTO `player_spells` (`player_id`, `name` ) VALUES ");
-	for (const std::string& spellName : player->learnedInstantSpellList) {
-		if (!spellsQuery.addRow(fmt::format("{:d}, {:s}", player->getGUID(), db.escapeString(spellName)))) {
-			return false;
-		}
+	if (result->getNumber<uint16_t>("save") == 0) {
+		return db.executeQuery(save.loginQuery);
 	}
 
-	if (!spellsQuery.execute()) {
+	DBTransaction transaction(db);
+	if (!transaction.begin()) {
 		return false;
 	}
 
-	//item saving
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_items` WHERE `player_id` = {:d}", player->getGUID()))) {
+	if (!db.executeQuery(save.playerQuery)) {
 		return false;
 	}
 
-	DBInsert itemsQuery("INSERT INTO `player_items` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills` ) VALUES ");
-
-	ItemBlockList itemList;
-	for (int32_t slotId = CONST_SLOT_FIRST; slotId <= CONST_SLOT_LAST; ++slotId) {
-		if (auto item = player->inventory[slotId]) {
-			itemList.emplace_back(slotId, item);
+	for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+		if (!save.changed[section]) {
+			continue;
 		}
-	}
-
-	if (!saveItems(player, itemList, itemsQuery, propWriteStream)) {
-		return false;
-	}
 
-	//save depot items
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_depotitems` WHERE `player_id` = {:d}", player->getGUID()))) {
-		return false;
-	}
+		std::string query = fmt::format("DELETE FROM `{:s}` WHERE `player_id` = {:d}", saveSectionTables[section], save.guid);
+		if (section == PLAYER_SAVE_STORAGE) {
+			query += fmt::format(" AND `key` BETWEEN {:d} AND {:d}", PSTRG_RESERVED_RANGE_START, PSTRG_RESERVED_RANGE_START + PSTRG_RESERVED_RANGE_SIZE);
+		}
 
-	DBInsert depotQuery("INSERT INTO `player_depotitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
-	itemList.clear();
+		if (!db.executeQuery(query)) {
+			return false;
+		}
 
-	for (const auto& it : player->depotChests) {
-		for (auto item : it.second->getItemList()) {
-			itemList.emplace_back(it.first, item);
+		if (!save.sections[section].release(db)) {
+			return false;
 		}
 	}
 
-	if (!saveItems(player, itemList, depotQuery, propWriteStream)) {
-		return false;
-	}
+	//End the transaction
+	return transaction.commit();
+}
 
-	// save reward items
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_rewarditems` WHERE `player_id` = {:d}", player->getGUID()))) {
-		return false;
+bool IOLoginData::savePlayer(const PlayerPtr& player)
+{
+	// simulated players have no character
+	if (player->getGUID() == 0) {
+		return true;
 	}
 
-	DBInsert rewardQuery("INSERT INTO `player_rewarditems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
-	itemList.clear();
-
-	for (auto item : player->getRewardChest()->getItemList()) {
-		itemList.emplace_back(0, item);
-	}
+	// a queued save of this player must not land after this one
+	waitForPendingSave(player->getGUID());
 
-	if (!saveItems(player, itemList, rewardQuery, propWriteStream)) {
+	PlayerSaveData save;
+	const uint64_t journalSequence = g_playerJournal.getSequence();
+	if (!preparePlayerSave(player, save)) {
 		return false;
 	}
 
-
-	//save inbox items
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_inboxitems` WHERE `player_id` = {:d}", player->getGUID()))) {
+	g_playerJournal.waitDurable(journalSequence);
+	if (!writePlayerSave(Database::getInstance(), save)) {
 		return false;
 	}
 
-	DBInsert inboxQuery("INSERT INTO `player_inboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`,  `augments`, `skills`) VALUES ");
-	itemList.clear();
-
-	for (auto item : player->getInbox()->getItemList()) {
-		itemList.emplace_back(0, item);
-	}
-
-	if (!saveItems(player, itemList, inboxQuery, propWriteStream)) {
-		return false;
-	}
+	player->savedChecksums = save.checksums;
+	g_playerJournal.recordPlayerSaved(save.guid, journalSequence);
+	return true;
+}
 
-	//save store inbox items
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_storeinboxitems` WHERE `player_id` = {:d}", player->getGUID()))) {
-		return false;
+void IOLoginData::savePlayerAsync(const PlayerPtr& player)
+{
+	if (player->getGUID() == 0) {
+		return;
 	}
 
-	DBInsert storeInboxQuery("INSERT INTO `player_storeinboxitems` (`player_id`, `pid`, `sid`, `itemtype`, `count`, `attributes`, `augments`, `skills`) VALUES ");
-	itemList.clear();
-
-	for (auto item : player->getStoreInbox()->getItemList()) {
-		itemList.emplace_back(0, item);
+	auto save = std::make_shared<PlayerSaveData>();
+	// the save holds every journal record up to here
+	const uint64_t journalSequence = g_playerJournal.getSequence();
+	if (!preparePlayerSave(player, *save)) {
+		std::cout << "Error while saving player: " << player->getName() << std::endl;
+		return;
 	}
 
-	if (!saveItems(player, itemList, storeInboxQuery, propWriteStream)) {
-		return false;
-	}
+	// later saves compare against this one, a failure below makes them write the sections again
+	const auto changed = save->changed;
+	player->savedChecksums = save->checksums;
 
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_storage` WHERE `player_id` = {:d}", player->getGUID()))) {
-		return false;
+	{
+		std::lock_guard<std::mutex> lockGuard(pendingSaveLock);
+		++pendingSaves[save->guid];
 	}
 
-	DBInsert storageQuery("INSERT INTO `player_storage` (`player_id`, `key`, `value`) VALUES ");
-	player->genReservedStorageRange();
-
-	for (const auto& it : player->storageMap) {
-		if (!storageQuery.addRow(fmt::format("{:d}, {:d}, {:d}", player->getGUID(), it.first, it.second))) {
-			return false;
+	const auto finish = [guid = save->guid]() {
+		{
+			std::lock_guard<std::mutex> lockGuard(pendingSaveLock);
+			auto it = pendingSaves.find(guid);
+			if (--it->second == 0) {
+				pendingSaves.erase(it);
+			}
 		}
-	}
-
-	if (!storageQuery.execute()) {
-		return false;
-	}
-
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_augments` WHERE `player_id` = {:d}", player->getGUID()))) {
-		return false;
-	}
-
-	DBInsert augmentQuery("INSERT INTO `player_augments` (`player_id`, `augments`) VALUES ");
-	PropWriteStream augmentStream;
+		pendingSaveSignal.notify_all();
+	};
+
+	const bool queued = g_databaseTasks.addJob(
+		[save, finish, journalSequence](Database& db) {
+			// the journal comes first, a crash then never finds the database ahead of it
+			g_playerJournal.waitDurable(journalSequence);
+			bool saved = false;
+			for (uint32_t tries = 0; tries < 3 && !saved; ++tries) {
+				saved = writePlayerSave(db, *save);
+			}
+			finish();
+			return saved;
+		},
+		[guid = save->guid, changed, journalSequence](bool saved) {
+			if (saved) {
+				g_playerJournal.recordPlayerSaved(guid, journalSequence);
+				return;
+			}
 
-	// Size check before proceeding
-	if (!saveAugments(player, augmentQuery, augmentStream)) {
-		return false;
+			std::cout << "Error while saving player: " << getNameByGuid(guid) << std::endl;
+			if (const auto& player = g_game.getPlayerByGUID(guid)) {
+				for (size_t section = 0; section < PLAYER_SAVE_LAST; ++section) {
+					if (changed[section]) {
+						player->savedChecksums[section] = 0;
+					}
+				}
+			}
+		}, save->guid);
+
+	if (!queued) {
+		// the database thread is stopping, write it here
+		g_playerJournal.waitDurable(journalSequence);
+		const bool saved = writePlayerSave(Database::getInstance(), *save);
+		finish();
+		if (saved) {
+			g_playerJournal.recordPlayerSaved(save->guid, journalSequence);
+		} else {
+			std::cout << "Error while saving player: " << player->getName() << std::endl;
+			player->savedChecksums.fill(0);
+		}
 	}
+}
 
-
-	if (!db.executeQuery(fmt::format("DELETE FROM `player_custom_skills` WHERE `player_id` = {:d}", player->getGUID()))) {
+bool IOLoginData::waitForPendingSave(uint32_t guid)
+{
+	std::unique_lock<std::mutex> lockGuard(pendingSaveLock);
+	if (!pendingSaves.contains(guid)) {
 		return false;
 	}
 
-	DBInsert skill_query("INSERT INTO `player_custom_skills` (`player_id`, `skills`) VALUES ");
-	PropWriteStream binary_stream;
-
-	savePlayerCustomSkills(player, skill_query, binary_stream);
-
-
-	//End the transaction
-	return transaction.commit();
+	pendingSaveSignal.wait(lockGuard, [guid]() { return !pendingSaves.contains(guid); });
+	return true;
 }
 
 std::string IOLoginData::getNameByGuid(uint32_t guid)
@@ -1307,8 +1795,11 @@ std::string IOLoginData::getNameByGuid(uint32_t guid)
 
 uint32_t IOLoginData::getGuidByName(const std::string& name)
 {
-	Database& db = Database::getInstance();
+	return getGuidByName(Database::getInstance(), name);
+}
 
+uint32_t IOLoginData::getGuidByName(Database& db, const std::string& name)
+{
 	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `id` FROM `players` WHERE `name` = {:s}", db.escapeString(name)));
 	if (!result) {
 		return 0;
@@ -1355,24 +1846,33 @@ bool IOLoginData::formatPlayerName(std::string& name)
 
 void IOLoginData::loadItems(ItemMap& itemMap, const DBResult_ptr& result)
 {
-	Database& db = Database::getInstance();
+	// not every item table has skills, a missing column reads as empty
+	const size_t sidColumn = result->getColumnIndex("sid");
+	const size_t pidColumn = result->getColumnIndex("pid");
+	const size_t typeColumn = result->getColumnIndex("itemtype");
+	const size_t countColumn = result->getColumnIndex("count");
+	const size_t attributesColumn = result->getColumnIndex("attributes");
+	const size_t augmentsColumn = result->getColumnIndex("augments");
+	const size_t skillsColumn = result->getColumnIndex("skills");
 
 	do {
-		uint32_t sid = result->getNumber<uint32_t>("sid");
-		uint32_t pid = result->getNumber<uint32_t>("pid");
-		uint16_t type = result->getNumber<uint16_t>("itemtype");
-		uint16_t count = result->getNumber<uint16_t>("count");
+		uint32_t sid = result->getNumber<uint32_t>(sidColumn);
+		uint32_t pid = result->getNumber<uint32_t>(pidColumn);
+		uint16_t type = result->getNumber<uint16_t>(typeColumn);
+		uint16_t count = result->getNumber<uint16_t>(countColumn);
 
 		// Load the attributes field
-		auto attr = result->getString("attributes");
+		auto attr = result->getString(attributesColumn);
 		PropStream propStream;
 		propStream.init(attr.data(), attr.size());
+		// rows written before the compact format have no header and read as they are
+		propStream.beginCompact(ITEM_ATTRIBUTES_COMPACT_HEADER);
 
-		auto augmentData = result->getString("augments");
+		auto augmentData = result->getString(augmentsColumn);
 		PropStream augmentStream;
 		augmentStream.init(augmentData.data(), augmentData.size());
 
-		auto skill_data = result->getString("skills");
+		auto skill_data = result->getString(skillsColumn);
 		PropStream skill_stream;
 		skill_stream.init(skill_data.data(), skill_data.size());
 
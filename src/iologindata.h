@@ -10,27 +10,68 @@
 
 using ItemBlockList = std::list<std::pair<int32_t, ItemPtr>>;
 
+// a player save as it is built on the dispatcher, ready to be written anywhere
+struct PlayerSaveData
+{
+	uint32_t guid = 0;
+	std::string playerQuery;
+	// the only update for players whose `save` is 0
+	std::string loginQuery;
+	std::vector<DBInsert> sections;
+	std::array<uint64_t, PLAYER_SAVE_LAST> checksums{};
+	std::bitset<PLAYER_SAVE_LAST> changed;
+};
+
+// the rows of a player, read on the database workers and turned into the player on the dispatcher
+struct PlayerLoadData
+{
+	DBResult_ptr player;
+	DBResult_ptr account;
+	DBResult_ptr guildMembership;
+	DBResult_ptr guildMembers;
+	DBResult_ptr vipList;
+	DBResult_ptr accountStorage;
+	// by PlayerSaveSection_t
+	std::array<DBResult_ptr, PLAYER_SAVE_LAST> sections;
+};
+
 class IOLoginData
 {
 	public:
 		static Account loadAccount(uint32_t accno);
 
-		static bool loginserverAuthentication(const std::string& name, const std::string& password, Account& account);
-		static std::pair<uint32_t, uint32_t> gameworldAuthentication(std::string_view accountName, std::string_view password, std::string_view characterName, std::string_view token, uint32_t tokenTime);
+		// the login lookups take the connection to run on, they are called from the database workers
+		static bool loginserverAuthentication(Database& db, const std::string& name, const std::string& password, Account& account);
+		static std::pair<uint32_t, uint32_t> gameworldAuthentication(Database& db, std::string_view accountName, std::string_view password, std::string_view characterName, std::string_view token, uint32_t tokenTime);
 		static uint32_t getAccountIdByPlayerName(const std::string& playerName);
 		static uint32_t getAccountIdByPlayerId(uint32_t playerId);
 
 		static AccountType_t getAccountType(uint32_t accountId);
 		static void setAccountType(uint32_t accountId, AccountType_t accountType);
-		static std::pair<uint32_t, uint32_t> getAccountIdByAccountName(std::string_view accountName, std::string_view password, std::string_view characterName);
+		static std::pair<uint32_t, uint32_t> getAccountIdByAccountName(Database& db, std::string_view accountName, std::string_view password, std::string_view characterName);
 		static void updateOnlineStatus(uint32_t guid, bool login);
-		static bool preloadPlayer(const PlayerPtr& player);
+		// the row preloadPlayer reads the name, account and group from
+		static DBResult_ptr selectPreload(Database& db, uint32_t guid);
+		static bool preloadPlayer(const PlayerPtr& player, const DBResult_ptr& result);
 
 		static bool loadPlayerById(const PlayerPtr& player, uint32_t id);
 		static bool loadPlayerByName(const PlayerPtr& player, const std::string& name);
 		static bool loadPlayer(const PlayerPtr& player, DBResult_ptr result);
+		// reads the player on the database workers, the larger tables at the same time, and
+		// fills it on the dispatcher before callback is told whether that worked
+		static void loadPlayerAsync(const PlayerPtr& player, uint32_t guid, std::function<void(bool)> callback);
+		// dispatcher thread, true while a login of guid is still loading
+		static bool isLoadingPlayer(uint32_t guid);
+		// what lazyDepotLoading left in the database, read on the database workers,
+		// callback runs on the dispatcher once it is in the player
+		static void loadPlayerSectionsAsync(const PlayerPtr& player, std::function<void()> callback);
+		// the same on this thread, for what can not wait
+		static void loadPlayerSections(const PlayerPtr& player);
 		static bool savePlayer(const PlayerPtr& player);
+		// builds the save here and writes it on the database thread
+		static void savePlayerAsync(const PlayerPtr& player);
 		static uint32_t getGuidByName(const std::string& name);
+		static uint32_t getGuidByName(Database& db, const std::string& name);
 		static bool getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name);
 		static std::string getNameByGuid(uint32_t guid);
 		static bool formatPlayerName(std::string& name);
@@ -45,6 +86,9 @@ class IOLoginData
 		static void updatePremiumTime(uint32_t accountId, time_t endTime);
 
 		static bool addRewardItems(uint32_t playerId, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& propWriteStream);
+		// writes item and its contents here, appends them to the inbox of a player who is
+		// not online on the database thread, where their next login finds them
+		static void addInboxItemAsync(uint32_t guid, const ItemPtr& item);
 
 		static bool accountExists(const std::string& accountName);
 
@@ -52,11 +96,28 @@ class IOLoginData
 		using ItemMap = std::map<uint32_t, std::pair<ItemPtr, uint32_t>>;
 
 		static void loadItems(ItemMap& itemMap, const DBResult_ptr& result);
+		// account, guild membership and vip list of data.player
+		static void fetchPlayerDetails(Database& db, PlayerLoadData& data);
+		static void fetchPlayerSections(Database& db, PlayerLoadData& data, size_t first, size_t last, bool lazy = false);
+		static bool buildPlayer(const PlayerPtr& player, const PlayerLoadData& data);
+		// the depot, reward, inbox and store inbox rows of data
+		static void buildItemSections(const PlayerPtr& player, const PlayerLoadData& data);
+		// the rows of the sections the player is still missing, merged with what reached them since login
+		static void buildUnloadedSections(const PlayerPtr& player, const PlayerLoadData& data);
+		static bool isSectionEmpty(const PlayerConstPtr& player, size_t section);
+		// attributes of item in the compact format, empty when it has none
+		static std::string_view serializeItemAttributes(const ItemConstPtr& item, PropWriteStream& propWriteStream);
 		static bool saveItems(const PlayerConstPtr& player, const ItemBlockList& itemList, DBInsert& query_insert, PropWriteStream& propWriteStream);
+		// the held inserts of every PlayerSaveSection_t, in order
+		static bool buildSaveSections(const PlayerPtr& player, std::vector<DBInsert>& sections, PropWriteStream& propWriteStream);
+		static bool preparePlayerSave(const PlayerPtr& player, PlayerSaveData& save);
+		static bool writePlayerSave(Database& db, PlayerSaveData& save);
+		// blocks until the queued saves of guid are written, true if there were any
+		static bool waitForPendingSave(uint32_t guid);
 		static bool saveAugments(const PlayerConstPtr& player, DBInsert& query_insert, PropWriteStream& augmentStream);
 		static void loadPlayerAugments(std::vector<std::shared_ptr<Augment>>& augmentList, const DBResult_ptr& result);
-		static void serializeCustomSkills(const PlayerConstPtr player, DBInsert query, PropWriteStream& binary_stream);
-		static void serializeCustomSkills(const ItemConstPtr item, DBInsert query, PropWriteStream& binary_stream);
+		static void serializeCustomSkills(const PlayerConstPtr player, DBInsert& query, PropWriteStream& binary_stream);
+		static void serializeCustomSkills(const ItemConstPtr item, DBInsert& query, PropWriteStream& binary_stream);
 		static SkillRegistry deserializeCustomSkills(PropStream binary_stream);
 		static bool savePlayerCustomSkills(const PlayerConstPtr& player, DBInsert& query_insert, PropWriteStream& binary_stream);
 };
@@ -6,7 +6,9 @@
 #include "iomap.h"
 
 #include "bed.h"
+#include "thinkpool.h"
 
+#include <fstream>
 #include <fmt/format.h>
 
 /*
@@ -47,13 +49,117 @@ TilePtr IOMap::createTile(ItemPtr& ground, uint16_t x, uint16_t y, uint8_t z)
 	return tile;
 }
 
+uint32_t IOMap::getTileFlags(const uint32_t otbmFlags)
+{
+	uint32_t tileflags = TILESTATE_NONE;
+	if ((otbmFlags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
+		tileflags |= TILESTATE_PROTECTIONZONE;
+	} else if ((otbmFlags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
+		tileflags |= TILESTATE_NOPVPZONE;
+	} else if ((otbmFlags & OTBM_TILEFLAG_PVPZONE) != 0) {
+		tileflags |= TILESTATE_PVPZONE;
+	}
+
+	if ((otbmFlags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
+		tileflags |= TILESTATE_NOLOGOUT;
+	}
+	return tileflags;
+}
+
+void IOMap::addMapItem(TilePtr& tile, ItemPtr& ground, ItemPtr& item, uint16_t x, uint16_t y, uint8_t z)
+{
+	if (item->getItemCount() == 0) {
+		item->setItemCount(1);
+	}
+
+	if (tile) {
+		tile->internalAddThing(item);
+		item->startDecaying();
+		item->setLoadedFromMap(true);
+	} else if (item->isGroundTile()) {
+		ground = std::move(item);
+	} else {
+		tile = createTile(ground, x, y, z);
+		tile->internalAddThing(item);
+		item->startDecaying();
+		item->setLoadedFromMap(true);
+	}
+}
+
+bool IOMap::readStaticTile(PropStream propStream, uint32_t& tileflags, std::vector<uint16_t>& itemIds)
+{
+	itemIds.clear();
+
+	uint8_t attribute;
+	while (propStream.read<uint8_t>(attribute)) {
+		switch (attribute) {
+			case OTBM_ATTR_TILE_FLAGS: {
+				uint32_t flags;
+				if (!propStream.read<uint32_t>(flags)) {
+					return false;
+				}
+				tileflags |= getTileFlags(flags);
+				break;
+			}
+
+			case OTBM_ATTR_ITEM: {
+				uint16_t id;
+				if (!propStream.read<uint16_t>(id) || !StaticTileLayer::isStaticItem(id)) {
+					return false;
+				}
+				itemIds.push_back(id);
+				break;
+			}
+
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+TilePtr IOMap::createStaticTile(uint16_t x, uint16_t y, uint8_t z, uint32_t tileflags, const std::vector<uint16_t>& itemIds)
+{
+	TilePtr tile = nullptr;
+	ItemPtr ground_item = nullptr;
+	for (const uint16_t id : itemIds) {
+		auto item = Item::CreateItem(id, 0);
+		addMapItem(tile, ground_item, item, x, y, z);
+	}
+
+	if (!tile) {
+		tile = createTile(ground_item, x, y, z);
+	}
+
+	tile->setFlag(static_cast<tileflags_t>(tileflags));
+	return tile;
+}
+
 bool IOMap::loadMap(Map* map, const std::filesystem::path& fileName)
 {
 	const auto start = OTSYS_TIME();
 	try {
 		OTB::Loader loader{ fileName.string(), OTB::Identifier{{'O', 'T', 'B', 'M'}} };
 
-		const auto& root = loader.parseTree();
+		const bool lazyTiles = g_config.getBoolean(ConfigManager::LAZY_MAP_TILES);
+		const bool useSnapshot = g_config.getBoolean(ConfigManager::MAP_SNAPSHOT);
+		const std::filesystem::path snapshotFile = fileName.string() + ".snapshot";
+		const uint64_t snapshotKey = useSnapshot ? getSnapshotKey(fileName, lazyTiles) : 0;
+
+		if (MapSnapshot snapshot; useSnapshot && readSnapshot(snapshotFile, snapshotKey, snapshot)) {
+			if (!loadSnapshot(loader, snapshot, *map)) {
+				// the map file changed in a way the key did not catch, the next start reads it again
+				std::error_code ec;
+				std::filesystem::remove(snapshotFile, ec);
+				return false;
+			}
+
+			std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds, from snapshot." << std::endl;
+			return true;
+		}
+
+		// the map data is read from the file as it comes
+		auto& root = loader.parseTree(1);
 		PropStream propStream;
 		if (!loader.getProps(root, propStream)) {
 			setLastErrorString("Could not read root property.");
@@ -101,33 +207,49 @@ bool IOMap::loadMap(Map* map, const std::filesystem::path& fileName)
 			return false;
 		}
 
-		const auto& mapNode = root.children[0];
+		auto& mapNode = root.children[0];
 
 		[[unlikely]] if (!parseMapDataAttributes(loader, mapNode, *map, fileName)) {
 			return false;
 		}
 
-		for (const auto& mapDataNode : mapNode.children) {
+		// only where each tile area is in the file is kept until the areas are read
+		std::vector<OTB::Node> tileAreaNodes;
+		const bool mapDataRead = OTB::Loader::forEachChild(mapNode, [&](const OTB::Node& mapDataNode) {
 			switch (mapDataNode.type) {
 			case OTBM_TILE_AREA:
-				[[unlikely]] if (!parseTileArea(loader, mapDataNode, *map)) {
-					return false;
-				}
-				break;
+				tileAreaNodes.push_back(mapDataNode);
+				return true;
 			case OTBM_TOWNS:
-				[[unlikely]] if (!parseTowns(loader, mapDataNode, *map)) {
-					return false;
-				}
-				break;
+				return parseTowns(loader, mapDataNode, *map);
 			case OTBM_WAYPOINTS:
-				[[unlikely]] if (headerVersion > 1 && !parseWaypoints(loader, mapDataNode, *map)) {
-					return false;
-				}
-				break;
+				return headerVersion <= 1 || parseWaypoints(loader, mapDataNode, *map);
 			[[unlikely]] default:
 				setLastErrorString("Unknown map node.");
 				return false;
 			}
+		});
+
+		[[unlikely]] if (!mapDataRead) {
+			return false;
+		}
+
+		PropWriteStream snapshot;
+		if (useSnapshot) {
+			beginSnapshot(snapshot, snapshotKey, *map);
+		}
+
+		const bool tilesRead = parseTileAreas(tileAreaNodes.size(), [&](size_t i, TileAreaBatch& batch) {
+			readTileArea(loader, tileAreaNodes[i], lazyTiles, batch);
+		}, *map, useSnapshot ? &snapshot : nullptr);
+
+		[[unlikely]] if (!tilesRead) {
+			return false;
+		}
+
+		if (useSnapshot) {
+			snapshot.write<uint8_t>(0);
+			saveSnapshot(snapshotFile, snapshot);
 		}
 	}
 	catch (const OTB::InvalidOTBFormat& err) {
@@ -186,187 +308,546 @@ bool IOMap::parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode
 	return true;
 }
 
-bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map)
+bool IOMap::parseTileAreas(size_t count, const std::function<void(size_t, TileAreaBatch&)>& read, Map& map, PropWriteStream* snapshot)
+{
+	// the loading thread helps, so it reads on its own when there are no threads
+	ThinkPool pool;
+	pool.start(std::max<int32_t>(0, g_config.getNumber(ConfigManager::MAP_LOAD_THREADS)));
+
+	std::vector<TileAreaBatch> batches(std::min(count, TILE_AREA_WINDOW));
+	bool success = true;
+	for (size_t first = 0; success && first < count; first += TILE_AREA_WINDOW) {
+		const size_t windowSize = std::min(TILE_AREA_WINDOW, count - first);
+		pool.parallelFor(windowSize, [&](size_t i) {
+			batches[i].clear();
+			read(first + i, batches[i]);
+		});
+
+		// in file order, a position listed twice ends up as it did when read serially
+		for (size_t i = 0; i < windowSize; ++i) {
+			if (!batches[i].error.empty()) {
+				setLastErrorString(batches[i].error);
+				success = false;
+				break;
+			}
+
+			if (!placeTileArea(batches[i], map)) {
+				success = false;
+				break;
+			}
+
+			if (snapshot) {
+				writeSnapshotArea(*snapshot, batches[i]);
+			}
+		}
+	}
+
+	pool.shutdown();
+	return success;
+}
+
+bool IOMap::readTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, bool lazyTiles, TileAreaBatch& batch)
 {
 	PropStream propStream;
 	if (!loader.getProps(tileAreaNode, propStream)) {
-		setLastErrorString("Invalid map node.");
+		batch.error = "Invalid map node.";
 		return false;
 	}
 
 	OTBM_Destination_coords area_coord;
 	if (!propStream.read(area_coord)) {
-		setLastErrorString("Invalid map node.");
+		batch.error = "Invalid map node.";
 		return false;
 	}
 
 	const uint16_t base_x = area_coord.x;
 	const uint16_t base_y = area_coord.y;
-	const uint16_t z = area_coord.z;
+	const uint8_t z = area_coord.z;
+	batch.baseX = base_x;
+	batch.baseY = base_y;
+	batch.z = z;
+
+	std::vector<uint16_t> staticItemIds;
+	try {
+		// the tiles are read from the file as they come, their nodes are never kept
+		return OTB::Loader::forEachChild(tileAreaNode, [&](const OTB::Node& tileNode) {
+			return readTile(loader, tileNode, base_x, base_y, z, lazyTiles, staticItemIds, batch);
+		});
+	} catch (const OTB::InvalidOTBFormat& err) {
+		batch.error = err.what();
+		return false;
+	}
+}
+
+bool IOMap::readTile(OTB::Loader& loader, const OTB::Node& tileNode, uint16_t base_x, uint16_t base_y, uint8_t z, bool lazyTiles, std::vector<uint16_t>& staticItemIds, TileAreaBatch& batch)
+{
+	if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
+		batch.error = "Unknown tile node.";
+		return false;
+	}
+
+	PropStream propStream;
+	if (!loader.getProps(tileNode, propStream)) {
+		batch.error = "Could not read node data.";
+		return false;
+	}
+
+	OTBM_Tile_coords tile_coord;
+	if (!propStream.read(tile_coord)) {
+		batch.error = "Could not read tile position.";
+		return false;
+	}
+
+	LoadedTile tile{};
+	tile.offset = static_cast<uint32_t>(loader.getOffset(tileNode));
+	tile.x = base_x + tile_coord.x;
+	tile.y = base_y + tile_coord.y;
+	tile.z = z;
+	tile.flags = TILESTATE_NONE;
+	tile.isHouseTile = (tileNode.type == OTBM_HOUSETILE);
+
+	const uint16_t x = tile.x;
+	const uint16_t y = tile.y;
+	if (lazyTiles && !tile.isHouseTile && !tileNode.hasChildren()) {
+		// read from a copy, a tile that turns out not to be static is loaded as usual
+		uint32_t staticFlags = TILESTATE_NONE;
+		if (readStaticTile(propStream, staticFlags, staticItemIds)) {
+			tile.flags = staticFlags;
+			tile.isStatic = true;
+			tile.firstItem = static_cast<uint32_t>(batch.staticItemIds.size());
+			batch.staticItemIds.push_back(staticItemIds);
+			batch.tiles.push_back(tile);
+			return true;
+		}
+	}
+
+	if (tile.isHouseTile && !propStream.read<uint32_t>(tile.houseId)) {
+		batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Could not read house id.", x, y, z);
+		return false;
+	}
+
+	tile.firstItem = static_cast<uint32_t>(batch.items.size());
+
+	uint8_t attribute;
+	//read tile attributes
+	while (propStream.read<uint8_t>(attribute)) {
+		switch (attribute) {
+			case OTBM_ATTR_TILE_FLAGS: {
+				uint32_t flags;
+				if (!propStream.read<uint32_t>(flags)) {
+					batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to read tile flags.", x, y, z);
+					return false;
+				}
+
+				tile.flags |= getTileFlags(flags);
+				break;
+			}
+
+			case OTBM_ATTR_ITEM: {
+				auto item = Item::CreateItem(propStream);
+				if (!item) {
+					batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to create item.", x, y, z);
+					return false;
+				}
+
+				batch.items.push_back(std::move(item));
+				break;
+			}
+
+			default:
+				batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Unknown tile attribute.", x, y, z);
+				return false;
+		}
+	}
+
+	const bool itemsRead = OTB::Loader::forEachChild(tileNode, [&](const OTB::Node& itemNode) {
+		if (itemNode.type != OTBM_ITEM) {
+			batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Unknown node type.", x, y, z);
+			return false;
+		}
 
-	for (const auto& tileNode : tileAreaNode.children | std::views::all) {
-		if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
-			setLastErrorString("Unknown tile node.");
+		PropStream stream;
+		if (!loader.getProps(itemNode, stream)) {
+			batch.error = "Invalid item node.";
 			return false;
 		}
 
-		if (!loader.getProps(tileNode, propStream)) {
-			setLastErrorString("Could not read node data.");
+		auto item = Item::CreateItem(stream);
+		if (!item) {
+			batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to create item.", x, y, z);
 			return false;
 		}
 
-		OTBM_Tile_coords tile_coord;
-		if (!propStream.read(tile_coord)) {
-			setLastErrorString("Could not read tile position.");
+		if (item->getBed()) {
+			batch.deferredAttributes.emplace_back(static_cast<uint32_t>(batch.items.size()), stream.getRemaining());
+		} else if (!item->unserializeItemNode(loader, itemNode, stream)) {
+			batch.error = fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to load item {:d}.", x, y, z, item->getID());
 			return false;
 		}
 
-		uint16_t x = base_x + tile_coord.x;
-		uint16_t y = base_y + tile_coord.y;
+		batch.items.push_back(std::move(item));
+		return true;
+	});
+	if (!itemsRead) {
+		return false;
+	}
+
+	tile.itemCount = static_cast<uint32_t>(batch.items.size()) - tile.firstItem;
+	batch.tiles.push_back(tile);
+	return true;
+}
+
+bool IOMap::placeTileArea(TileAreaBatch& batch, Map& map)
+{
+	auto deferred = batch.deferredAttributes.begin();
+	for (const LoadedTile& loadedTile : batch.tiles) {
+		const uint16_t x = loadedTile.x;
+		const uint16_t y = loadedTile.y;
+		const uint8_t z = loadedTile.z;
+
+		if (loadedTile.isStatic) {
+			const auto& staticItemIds = batch.staticItemIds[loadedTile.firstItem];
+			map.staticTiles.add(x, y, z, loadedTile.flags, staticItemIds);
+			map.tileStates.set(x, y, z, Map::getTileStateBits(staticItemIds));
+			continue;
+		}
 
-		bool isHouseTile = (tileNode.type == OTBM_HOUSETILE);
 		TilePtr tile = nullptr;
 		ItemPtr ground_item = nullptr;
-		uint32_t tileflags = TILESTATE_NONE;
 
-		if (isHouseTile) {
-			uint32_t houseId;
-			if (!propStream.read<uint32_t>(houseId)) {
-				setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Could not read house id.", x, y, z));
-				return false;
-			}
-
-			const auto house = map.houses.addHouse(houseId);
+		if (loadedTile.isHouseTile) {
+			const auto house = map.houses.addHouse(loadedTile.houseId);
 			if (!house) {
-				setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Could not create house id: {:d}", x, y, z, houseId));
+				setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Could not create house id: {:d}", x, y, z, loadedTile.houseId));
 				return false;
 			}
-			
+
 			auto houseTile = std::make_shared<Tile>(x, y, z, house);
 			tile = houseTile;
 			house->addTile(houseTile);
 		}
 
-		uint8_t attribute;
-		//read tile attributes
-		while (propStream.read<uint8_t>(attribute)) {
-			switch (attribute) {
-				case OTBM_ATTR_TILE_FLAGS: {
-					uint32_t flags;
-					if (!propStream.read<uint32_t>(flags)) {
-						setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to read tile flags.", x, y, z));
-						return false;
-					}
-
-					if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
-						tileflags |= TILESTATE_PROTECTIONZONE;
-					} else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
-						tileflags |= TILESTATE_NOPVPZONE;
-					} else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
-						tileflags |= TILESTATE_PVPZONE;
-					}
-
-					if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
-						tileflags |= TILESTATE_NOLOGOUT;
-					}
-					break;
-				}
+		for (uint32_t index = loadedTile.firstItem, last = index + loadedTile.itemCount; index < last; ++index) {
+			auto& item = batch.items[index];
+			if (deferred != batch.deferredAttributes.end() && deferred->first == index) {
+				PropStream stream;
+				stream.init(deferred->second.data(), deferred->second.size());
+				++deferred;
 
-				case OTBM_ATTR_ITEM: {
-					auto item = Item::CreateItem(propStream);
-					if (!item) {
-						setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to create item.", x, y, z));
-						return false;
-					}
-
-					if (isHouseTile && item->isMoveable()) {
-						std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;;
-					} else {
-						if (item->getItemCount() == 0) {
-							item->setItemCount(1);
-						}
-
-						if (tile) {
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						} else if (item->isGroundTile()) {
-							ground_item = std::move(item);
-						} else {
-							tile = createTile(ground_item, x, y, z);
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						}
-					}
-					break;
+				if (!item->unserializeAttr(stream)) {
+					setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to load item {:d}.", x, y, z, item->getID()));
+					return false;
 				}
+			}
 
-				default:
-					setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Unknown tile attribute.", x, y, z));
-					return false;
+			if (loadedTile.isHouseTile && item->isMoveable()) {
+				std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
+			} else {
+				addMapItem(tile, ground_item, item, x, y, z);
 			}
 		}
 
-		for (const auto& itemNode : tileNode.children | std::views::all) {
-			if (itemNode.type != OTBM_ITEM) {
-				setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Unknown node type.", x, y, z));
+		if (!tile) {
+			tile = createTile(ground_item, x, y, z);
+		}
+
+		tile->setFlag(static_cast<tileflags_t>(loadedTile.flags));
+
+		map.setTile(x, y, z, tile);
+	}
+	return true;
+}
+
+bool IOMap::readSnapshotArea(OTB::Loader& loader, const SnapshotArea& area, TileAreaBatch& batch)
+{
+	batch.baseX = area.baseX;
+	batch.baseY = area.baseY;
+	batch.z = area.z;
+
+	std::vector<uint16_t> staticItemIds;
+	try {
+		for (const uint32_t offset : area.tileOffsets) {
+			if (!readTile(loader, loader.getNode(offset), area.baseX, area.baseY, area.z, false, staticItemIds, batch)) {
 				return false;
 			}
+		}
+	} catch (const OTB::InvalidOTBFormat& err) {
+		batch.error = err.what();
+		return false;
+	}
+	return true;
+}
 
-			PropStream stream;
-			if (!loader.getProps(itemNode, stream)) {
-				setLastErrorString("Invalid item node.");
+uint64_t IOMap::getSnapshotKey(const std::filesystem::path& fileName, bool lazyTiles)
+{
+	// fnv-1a
+	uint64_t key = 0xCBF29CE484222325ULL;
+	const auto add = [&key](uint64_t value) {
+		for (size_t i = 0; i < sizeof(value); ++i) {
+			key = (key ^ ((value >> (i * 8)) & 0xFF)) * 0x100000001B3ULL;
+		}
+	};
+
+	// size and modification time stand for the contents, hashing them would read the whole file
+	std::error_code ec;
+	add(std::filesystem::file_size(fileName, ec));
+	add(std::filesystem::last_write_time(fileName, ec).time_since_epoch().count());
+	add(lazyTiles);
+
+	add(Item::items.majorVersion);
+	add(Item::items.minorVersion);
+	add(Item::items.buildNumber);
+	for (size_t id = 0; id < Item::items.size(); ++id) {
+		add(StaticTileLayer::isStaticItem(static_cast<uint16_t>(id)));
+	}
+	return key;
+}
+
+bool IOMap::readSnapshot(const std::filesystem::path& snapshotFile, uint64_t key, MapSnapshot& snapshot)
+{
+	std::error_code ec;
+	if (!std::filesystem::exists(snapshotFile, ec)) {
+		return false;
+	}
+
+	OTB::MappedFile file;
+	try {
+		file.open(snapshotFile.string());
+	} catch (const std::exception&) {
+		return false;
+	}
+
+	PropStream stream;
+	stream.init(file.data(), file.size());
+
+	uint64_t snapshotKey;
+	if (!stream.beginCompact(MAP_SNAPSHOT_HEADER) || !stream.read<uint64_t>(snapshotKey) || snapshotKey != key) {
+		return false;
+	}
+
+	const auto readPosition = [&stream](Position& position) {
+		return stream.read<uint16_t>(position.x) && stream.read<uint16_t>(position.y) && stream.read<uint8_t>(position.z);
+	};
+
+	if (!stream.read<uint32_t>(snapshot.width) || !stream.read<uint32_t>(snapshot.height)) {
+		return false;
+	}
+
+	auto [spawnFile, spawnOk] = stream.readString();
+	auto [houseFile, houseOk] = stream.readString();
+	if (!spawnOk || !houseOk) {
+		return false;
+	}
+	snapshot.spawnFile = spawnFile;
+	snapshot.houseFile = houseFile;
+
+	uint32_t townCount;
+	if (!stream.read<uint32_t>(townCount)) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < townCount; ++i) {
+		MapSnapshot::Town& town = snapshot.towns.emplace_back();
+		if (!stream.read<uint32_t>(town.id)) {
+			return false;
+		}
+
+		auto [name, ok] = stream.readString();
+		if (!ok || !readPosition(town.templePosition)) {
+			return false;
+		}
+		town.name = name;
+	}
+
+	uint32_t waypointCount;
+	if (!stream.read<uint32_t>(waypointCount)) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < waypointCount; ++i) {
+		auto [name, ok] = stream.readString();
+		Position position;
+		if (!ok || !readPosition(position)) {
+			return false;
+		}
+		snapshot.waypoints.emplace_back(name, position);
+	}
+
+	// every area is led by a 1, a 0 ends the list
+	uint8_t more;
+	while (stream.read<uint8_t>(more) && more != 0) {
+		SnapshotArea area{};
+		uint32_t tileCount;
+		if (!stream.read<uint16_t>(area.baseX) || !stream.read<uint16_t>(area.baseY) || !stream.read<uint8_t>(area.z) || !stream.read<uint32_t>(tileCount)) {
+			return false;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < tileCount; ++i) {
+			uint8_t isStatic;
+			if (!stream.read<uint8_t>(isStatic)) {
 				return false;
 			}
 
-			auto item = Item::CreateItem(stream);
-			if (!item) {
-				setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to create item.", x, y, z));
-				return false;
+			if (isStatic == 0) {
+				// offsets are kept as the distance to the previous tile of the area
+				uint32_t distance;
+				if (!stream.read<uint32_t>(distance)) {
+					return false;
+				}
+
+				offset += distance;
+				area.tileOffsets.push_back(offset);
+				continue;
 			}
 
-			if (!item->unserializeItemNode(loader, itemNode, stream)) {
-				setLastErrorString(fmt::format("[x:{:d}, y:{:d}, z:{:d}] Failed to load item {:d}.", x, y, z, item->getID()));
+			uint8_t x, y;
+			uint32_t flags, itemCount;
+			if (!stream.read<uint8_t>(x) || !stream.read<uint8_t>(y) || !stream.read<uint32_t>(flags) || !stream.read<uint32_t>(itemCount) || itemCount > std::numeric_limits<uint16_t>::max()) {
 				return false;
 			}
 
-			if (isHouseTile && item->isMoveable()) {
-				std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
-			} else {
-				if (item->getItemCount() == 0) {
-					item->setItemCount(1);
-				}
-
-				if (tile) {
-					tile->internalAddThing(item);
-					item->startDecaying();
-					item->setLoadedFromMap(true);
-				} else if (item->isGroundTile()) {
-					ground_item = std::move(item);
-				} else {
-					tile = createTile(ground_item, x, y, z);
-					tile->internalAddThing(item);
-					item->startDecaying();
-					item->setLoadedFromMap(true);
+			snapshot.staticTiles.push_back({flags, static_cast<uint32_t>(snapshot.staticItemIds.size()), static_cast<uint16_t>(itemCount), static_cast<uint16_t>(area.baseX + x), static_cast<uint16_t>(area.baseY + y), area.z});
+			for (uint32_t item = 0; item < itemCount; ++item) {
+				uint16_t id;
+				if (!stream.read<uint16_t>(id)) {
+					return false;
 				}
+				snapshot.staticItemIds.push_back(id);
 			}
 		}
 
-		if (!tile) {
-			tile = createTile(ground_item, x, y, z);
+		if (!area.tileOffsets.empty()) {
+			snapshot.areas.push_back(std::move(area));
 		}
+	}
 
-		tile->setFlag(static_cast<tileflags_t>(tileflags));
+	// nothing is left after the end of the list of a complete snapshot
+	return more == 0 && stream.size() == 0;
+}
 
-		map.setTile(x, y, z, tile);
+bool IOMap::loadSnapshot(OTB::Loader& loader, const MapSnapshot& snapshot, Map& map)
+{
+	map.width = snapshot.width;
+	map.height = snapshot.height;
+	std::cout << "> Map size: " << map.width << "x" << map.height << '.' << std::endl;
+
+	map.spawnfile = snapshot.spawnFile;
+	map.housefile = snapshot.houseFile;
+
+	for (const MapSnapshot::Town& snapshotTown : snapshot.towns) {
+		auto town = map.towns.getTown(snapshotTown.id);
+		if (!town) {
+			town = new Town(snapshotTown.id);
+			map.towns.addTown(snapshotTown.id, town);
+		}
+
+		town->setName(snapshotTown.name);
+		town->setTemplePos(snapshotTown.templePosition);
+	}
+
+	for (const auto& [name, position] : snapshot.waypoints) {
+		map.waypoints[name] = position;
+	}
+
+	std::vector<uint16_t> itemIds;
+	for (const MapSnapshot::StaticTile& tile : snapshot.staticTiles) {
+		const auto first = snapshot.staticItemIds.begin() + tile.firstItem;
+		itemIds.assign(first, first + tile.itemCount);
+		map.staticTiles.add(tile.x, tile.y, tile.z, tile.flags, itemIds);
+		map.tileStates.set(tile.x, tile.y, tile.z, Map::getTileStateBits(itemIds));
+	}
+
+	return parseTileAreas(snapshot.areas.size(), [&](size_t i, TileAreaBatch& batch) {
+		readSnapshotArea(loader, snapshot.areas[i], batch);
+	}, map, nullptr);
+}
+
+void IOMap::beginSnapshot(PropWriteStream& stream, uint64_t key, const Map& map)
+{
+	const auto writePosition = [&stream](const Position& position) {
+		stream.write<uint16_t>(position.x);
+		stream.write<uint16_t>(position.y);
+		stream.write<uint8_t>(position.z);
+	};
+
+	stream.beginCompact(MAP_SNAPSHOT_HEADER);
+	stream.write<uint64_t>(key);
+	stream.write<uint32_t>(map.width);
+	stream.write<uint32_t>(map.height);
+	stream.writeString(map.spawnfile.string());
+	stream.writeString(map.housefile.string());
+
+	const TownMap& towns = map.towns.getTowns();
+	stream.write<uint32_t>(static_cast<uint32_t>(towns.size()));
+	for (const auto& [townId, town] : towns) {
+		stream.write<uint32_t>(townId);
+		stream.writeString(town->getName());
+		writePosition(town->getTemplePosition());
+	}
+
+	stream.write<uint32_t>(static_cast<uint32_t>(map.waypoints.size()));
+	for (const auto& [name, position] : map.waypoints) {
+		stream.writeString(name);
+		writePosition(position);
+	}
+}
+
+void IOMap::writeSnapshotArea(PropWriteStream& stream, const TileAreaBatch& batch)
+{
+	if (batch.tiles.empty()) {
+		return;
+	}
+
+	stream.write<uint8_t>(1);
+	stream.write<uint16_t>(batch.baseX);
+	stream.write<uint16_t>(batch.baseY);
+	stream.write<uint8_t>(batch.z);
+	stream.write<uint32_t>(static_cast<uint32_t>(batch.tiles.size()));
+
+	uint32_t offset = 0;
+	for (const LoadedTile& tile : batch.tiles) {
+		stream.write<uint8_t>(tile.isStatic);
+		if (!tile.isStatic) {
+			stream.write<uint32_t>(tile.offset - offset);
+			offset = tile.offset;
+			continue;
+		}
+
+		const auto& itemIds = batch.staticItemIds[tile.firstItem];
+		stream.write<uint8_t>(static_cast<uint8_t>(tile.x - batch.baseX));
+		stream.write<uint8_t>(static_cast<uint8_t>(tile.y - batch.baseY));
+		stream.write<uint32_t>(tile.flags);
+		stream.write<uint32_t>(static_cast<uint32_t>(itemIds.size()));
+		for (const uint16_t id : itemIds) {
+			stream.write<uint16_t>(id);
+		}
+	}
+}
+
+void IOMap::saveSnapshot(const std::filesystem::path& snapshotFile, const PropWriteStream& stream)
+{
+	// written next to the snapshot and moved over it, a crash never leaves half a file behind
+	const std::filesystem::path temporaryFile = snapshotFile.string() + ".tmp";
+	{
+		std::ofstream file(temporaryFile, std::ios::binary | std::ios::trunc);
+		const auto data = stream.getStream();
+		if (!file || !file.write(data.data(), data.size())) {
+			std::cout << "[Warning - IOMap::saveSnapshot] Could not write " << temporaryFile << '.' << std::endl;
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporaryFile, snapshotFile, ec);
+	if (ec) {
+		std::cout << "[Warning - IOMap::saveSnapshot] Could not replace " << snapshotFile << ": " << ec.message() << std::endl;
 	}
-	return true;
 }
 
 bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map)
 {
-	for (const auto& townNode : townsNode.children | std::views::all) {
+	return OTB::Loader::forEachChild(townsNode, [&](const OTB::Node& townNode) {
 		PropStream propStream;
 		if (townNode.type != OTBM_TOWN) {
 			setLastErrorString("Unknown town node.");
@@ -405,14 +886,14 @@ bool IOMap::parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map
 		}
 
 		town->setTemplePos(Position(town_coords.x, town_coords.y, town_coords.z));
-	}
-	return true;
+		return true;
+	});
 }
 
 bool IOMap::parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map)
 {
 	PropStream propStream;
-	for (const auto& node : waypointsNode.children | std::views::all) {
+	return OTB::Loader::forEachChild(waypointsNode, [&](const OTB::Node& node) {
 		if (node.type != OTBM_WAYPOINT) {
 			setLastErrorString("Unknown waypoint node.");
 			return false;
@@ -436,7 +917,7 @@ bool IOMap::parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode,
 		}
 
 		map.waypoints[std::string{ name }] = Position(waypoint_coords.x, waypoint_coords.y, waypoint_coords.z);
-	}
-	return true;
+		return true;
+	});
 }
 
@@ -86,13 +86,107 @@ struct OTBM_Tile_coords {
 
 #pragma pack()
 
+// tile areas read before their tiles are placed on the map
+static constexpr size_t TILE_AREA_WINDOW = 1024;
+
+// leads a map snapshot, the last byte is its version
+static constexpr std::string_view MAP_SNAPSHOT_HEADER{"BTMS\x01", 5};
+
 class IOMap
 {
+	// a tile read from a tile area, items and staticItemIds of its batch from firstItem on
+	struct LoadedTile
+	{
+		uint32_t firstItem;
+		uint32_t itemCount;
+		uint32_t houseId;
+		uint32_t flags;
+		// where the tile node is in the map file
+		uint32_t offset;
+		uint16_t x;
+		uint16_t y;
+		uint8_t z;
+		bool isHouseTile;
+		bool isStatic;
+	};
+
+	// What one thread read from a tile area. Nothing in it is on the map yet,
+	// placing the tiles, adding the houses and starting decay is left to the
+	// thread loading the map.
+	struct TileAreaBatch
+	{
+		void clear() {
+			tiles.clear();
+			items.clear();
+			staticItemIds.clear();
+			deferredAttributes.clear();
+			error.clear();
+		}
+
+		std::vector<LoadedTile> tiles;
+		std::vector<ItemPtr> items;
+		uint16_t baseX = 0;
+		uint16_t baseY = 0;
+		uint8_t z = 0;
+		std::vector<std::vector<uint16_t>> staticItemIds;
+		// attributes of beds by index in items, reading them looks up the sleeper
+		std::vector<std::pair<uint32_t, std::string>> deferredAttributes;
+		std::string error;
+	};
+
+	// the tiles of an area that are not static, by where their nodes are in the map file
+	struct SnapshotArea
+	{
+		std::vector<uint32_t> tileOffsets;
+		uint16_t baseX;
+		uint16_t baseY;
+		uint8_t z;
+	};
+
+	// What a snapshot holds: the map data attributes, towns and waypoints, the
+	// static tiles and where the other tiles are in the map file. A map loaded
+	// from it never walks the file, only the nodes of those tiles are read.
+	struct MapSnapshot
+	{
+		struct Town
+		{
+			std::string name;
+			Position templePosition;
+			uint32_t id;
+		};
+
+		struct StaticTile
+		{
+			uint32_t flags;
+			uint32_t firstItem;
+			uint16_t itemCount;
+			uint16_t x;
+			uint16_t y;
+			uint8_t z;
+		};
+
+		std::string spawnFile;
+		std::string houseFile;
+		std::vector<Town> towns;
+		std::vector<std::pair<std::string, Position>> waypoints;
+		std::vector<StaticTile> staticTiles;
+		std::vector<uint16_t> staticItemIds;
+		std::vector<SnapshotArea> areas;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
 	static TilePtr createTile(ItemPtr& ground, uint16_t x, uint16_t y, uint8_t z);
+	static void addMapItem(TilePtr& tile, ItemPtr& ground, ItemPtr& item, uint16_t x, uint16_t y, uint8_t z);
+	static uint32_t getTileFlags(uint32_t otbmFlags);
+	static bool readStaticTile(PropStream propStream, uint32_t& tileflags, std::vector<uint16_t>& itemIds);
 
 	public:
 		bool loadMap(Map* map, const std::filesystem::path& fileName);
 
+		// builds the tile a StaticTileLayer record describes
+		static TilePtr createStaticTile(uint16_t x, uint16_t y, uint8_t z, uint32_t tileflags, const std::vector<uint16_t>& itemIds);
+
 		/* Load the spawns
 		 * \param map pointer to the Map class
 		 * \returns Returns true if the spawns were loaded successfully
@@ -135,7 +229,22 @@ class IOMap
 		bool parseMapDataAttributes(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const std::filesystem::path& fileName);
 		bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
 		bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
-		bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map);
+		// read(i, batch) reads area i into batch on any thread, the tiles are placed
+		// in order by this thread and written to snapshot when there is one
+		bool parseTileAreas(size_t count, const std::function<void(size_t, TileAreaBatch&)>& read, Map& map, PropWriteStream* snapshot);
+		// safe to run for different areas at once, false with batch.error set on failure
+		static bool readTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, bool lazyTiles, TileAreaBatch& batch);
+		static bool readSnapshotArea(OTB::Loader& loader, const SnapshotArea& area, TileAreaBatch& batch);
+		static bool readTile(OTB::Loader& loader, const OTB::Node& tileNode, uint16_t base_x, uint16_t base_y, uint8_t z, bool lazyTiles, std::vector<uint16_t>& staticItemIds, TileAreaBatch& batch);
+		bool placeTileArea(TileAreaBatch& batch, Map& map);
+
+		// changes with the map file and with the item types that decide what is static
+		static uint64_t getSnapshotKey(const std::filesystem::path& fileName, bool lazyTiles);
+		static bool readSnapshot(const std::filesystem::path& snapshotFile, uint64_t key, MapSnapshot& snapshot);
+		bool loadSnapshot(OTB::Loader& loader, const MapSnapshot& snapshot, Map& map);
+		static void beginSnapshot(PropWriteStream& stream, uint64_t key, const Map& map);
+		static void writeSnapshotArea(PropWriteStream& stream, const TileAreaBatch& batch);
+		static void saveSnapshot(const std::filesystem::path& snapshotFile, const PropWriteStream& stream);
 		std::string errorString;
 };
 
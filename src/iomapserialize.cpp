@@ -8,6 +8,7 @@
 #include "bed.h"
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
 extern Game g_game;
 
@@ -15,16 +16,29 @@ void IOMapSerialize::loadHouseItems(Map* map)
 {
 	int64_t start = OTSYS_TIME();
 
-	DBResult_ptr result = Database::getInstance().storeQuery("SELECT `data` FROM `tile_store`");
+	// streamed, the store may be far bigger than what is needed to hold one tile
+	DBResult_ptr result = Database::getInstance().useQuery("SELECT `house_id`, `data` FROM `tile_store`");
 	if (!result) {
 		return;
 	}
 
+	const size_t houseIdColumn = result->getColumnIndex("house_id");
+	const size_t dataColumn = result->getColumnIndex("data");
 	do {
+		auto attr = result->getString(dataColumn);
+
+		// every row counts, also the ones that fail to load, so a house whose
+		// rows no longer match the map is written again on the next save
+		const uint32_t houseId = result->getNumber<uint32_t>(houseIdColumn);
+		if (House* house = map->houses.getHouse(houseId)) {
+			house->setItemsChecksum(house->getItemsChecksum() + getRowChecksum(attr));
+		} else if (auto& stale = map->houses.getStaleItemHouses(); std::find(stale.begin(), stale.end(), houseId) == stale.end()) {
+			stale.push_back(houseId);
+		}
 
-		auto attr = result->getString("data");
 		PropStream propStream;
 		propStream.init(attr.data(), attr.size());
+		propStream.beginCompact(TILE_COMPACT_HEADER);
 
 		uint16_t x, y;
 		uint8_t z;
@@ -51,7 +65,53 @@ void IOMapSerialize::loadHouseItems(Map* map)
 
 bool IOMapSerialize::saveHouseItems()
 {
-	int64_t start = OTSYS_TIME();
+	SaveHouseItemsJob job;
+	job.complete();
+	return job.succeeded();
+}
+
+SaveHouseItemsJob::SaveHouseItemsJob() : start(OTSYS_TIME())
+{
+	const auto& houseMap = g_game.map.houses.getHouses();
+	houses.reserve(houseMap.size());
+	for (const auto& it : houseMap) {
+		houses.push_back(it.second);
+	}
+	stmt.hold();
+}
+
+bool SaveHouseItemsJob::step()
+{
+	if (nextHouse >= houses.size()) {
+		success = write();
+		std::cout << "> Saved items of " << changed.size() << " of " << houses.size() << " houses in: " <<
+		          (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
+		return true;
+	}
+
+	House* house = houses[nextHouse++];
+	const uint64_t checksum = IOMapSerialize::serializeHouse(stream, house, rows);
+	if (checksum == house->getItemsChecksum()) {
+		return false;
+	}
+
+	for (const std::string& row : rows) {
+		stmt.beginRow();
+		stmt.addNumber(house->getId());
+		stmt.addBlob(row);
+		stmt.endRow();
+	}
+	changed.emplace_back(house, checksum);
+	return false;
+}
+
+bool SaveHouseItemsJob::write()
+{
+	std::vector<uint32_t>& stale = g_game.map.houses.getStaleItemHouses();
+	if (changed.empty() && stale.empty()) {
+		return true;
+	}
+
 	Database& db = Database::getInstance();
 
 	//Start the transaction
@@ -60,38 +120,54 @@ bool IOMapSerialize::saveHouseItems()
 		return false;
 	}
 
-	//clear old tile data
-	if (!db.executeQuery("DELETE FROM `tile_store`")) {
-		return false;
+	//clear old tile data of the houses that changed
+	std::vector<uint32_t> houseIds = stale;
+	houseIds.reserve(houseIds.size() + changed.size());
+	for (const auto& [house, checksum] : changed) {
+		houseIds.push_back(house->getId());
 	}
 
-	DBInsert stmt("INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
-
-	PropWriteStream stream;
-	for (const auto& it : g_game.map.houses.getHouses()) {
-		//save house items
-		House* house = it.second;
-		for (auto tile : house->getTiles()) {
-			saveTile(stream, tile);
-
-			if (auto attributes = stream.getStream(); !attributes.empty()) {
-				if (!stmt.addRow(fmt::format("{:d}, {:s}", house->getId(), db.escapeString(attributes)))) {
-					return false;
-				}
-				stream.clear();
-			}
-		}
+	if (!db.executeQuery(fmt::format("DELETE FROM `tile_store` WHERE `house_id` IN ({:d})", fmt::join(houseIds, ",")))) {
+		return false;
 	}
 
-	if (!stmt.execute()) {
+	if (!stmt.release()) {
 		return false;
 	}
 
 	//End the transaction
-	bool success = transaction.commit();
-	std::cout << "> Saved house items in: " <<
-	          (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
-	return success;
+	if (!transaction.commit()) {
+		return false;
+	}
+
+	for (const auto& [house, checksum] : changed) {
+		house->setItemsChecksum(checksum);
+	}
+	stale.clear();
+	return true;
+}
+
+uint64_t IOMapSerialize::getRowChecksum(std::string_view data)
+{
+	return std::hash<std::string_view>{}(data);
+}
+
+uint64_t IOMapSerialize::serializeHouse(PropWriteStream& stream, const House* house, std::vector<std::string>& rows)
+{
+	rows.clear();
+
+	// summed, the rows are read back in no particular order
+	uint64_t checksum = 0;
+	for (const auto& tile : house->getTiles()) {
+		saveTile(stream, tile);
+
+		if (auto attributes = stream.getStream(); !attributes.empty()) {
+			checksum += getRowChecksum(attributes);
+			rows.emplace_back(attributes);
+			stream.clear();
+		}
+	}
+	return checksum;
 }
 
 bool IOMapSerialize::loadContainer(PropStream& propStream, const ContainerPtr& container)
@@ -233,6 +309,8 @@ void IOMapSerialize::saveTile(PropWriteStream& stream, const TilePtr& tile)
 	}
 
 	if (!items.empty()) {
+		stream.beginCompact(TILE_COMPACT_HEADER);
+
 		const Position& tilePosition = tile->getPosition();
 		stream.write<uint16_t>(tilePosition.x);
 		stream.write<uint16_t>(tilePosition.y);
@@ -286,15 +364,30 @@ bool IOMapSerialize::saveHouseInfo()
 		return false;
 	}
 
+	// one upsert for every house instead of a lookup and a write each
+	DBInsert houseStmt("INSERT INTO `houses` (`id`, `owner`, `paid`, `warnings`, `name`, `town_id`, `rent`, `size`, `beds`) VALUES ");
+	houseStmt.setUpsert("`owner` = VALUES(`owner`), `paid` = VALUES(`paid`), `warnings` = VALUES(`warnings`), `name` = VALUES(`name`), `town_id` = VALUES(`town_id`), `rent` = VALUES(`rent`), `size` = VALUES(`size`), `beds` = VALUES(`beds`)");
 	for (const auto& val : g_game.map.houses.getHouses() | std::views::values) {
 		const auto house = val;
-		if (DBResult_ptr result = db.storeQuery(fmt::format("SELECT `id` FROM `houses` WHERE `id` = {:d}", house->getId()))) {
-			db.executeQuery(fmt::format("UPDATE `houses` SET `owner` = {:d}, `paid` = {:d}, `warnings` = {:d}, `name` = {:s}, `town_id` = {:d}, `rent` = {:d}, `size` = {:d}, `beds` = {:d} WHERE `id` = {:d}", house->getOwner(), house->getPaidUntil(), house->getPayRentWarnings(), db.escapeString(house->getName()), house->getTownId(), house->getRent(), house->getTiles().size(), house->getBedCount(), house->getId()));
-		} else {
-			db.executeQuery(fmt::format("INSERT INTO `houses` (`id`, `owner`, `paid`, `warnings`, `name`, `town_id`, `rent`, `size`, `beds`) VALUES ({:d}, {:d}, {:d}, {:d}, {:s}, {:d}, {:d}, {:d}, {:d})", house->getId(), house->getOwner(), house->getPaidUntil(), house->getPayRentWarnings(), db.escapeString(house->getName()), house->getTownId(), house->getRent(), house->getTiles().size(), house->getBedCount()));
+		houseStmt.beginRow();
+		houseStmt.addNumber(house->getId());
+		houseStmt.addNumber(house->getOwner());
+		houseStmt.addNumber(house->getPaidUntil());
+		houseStmt.addNumber(house->getPayRentWarnings());
+		houseStmt.addBlob(house->getName());
+		houseStmt.addNumber(house->getTownId());
+		houseStmt.addNumber(house->getRent());
+		houseStmt.addNumber(house->getTiles().size());
+		houseStmt.addNumber(house->getBedCount());
+		if (!houseStmt.endRow()) {
+			return false;
 		}
 	}
 
+	if (!houseStmt.execute()) {
+		return false;
+	}
+
 	DBInsert stmt("INSERT INTO `house_lists` (`house_id` , `listid` , `list`) VALUES ");
 
 	for (const auto& val : g_game.map.houses.getHouses() | std::views::values) {
@@ -302,7 +395,11 @@ bool IOMapSerialize::saveHouseInfo()
 
 		std::string listText;
 		if (house->getAccessList(GUEST_LIST, listText) && !listText.empty()) {
-			if (!stmt.addRow(fmt::format("{:d}, {:d}, {:s}", house->getId(), Titan::to_underlying(GUEST_LIST), db.escapeString(listText)))) {
+			stmt.beginRow();
+			stmt.addNumber(house->getId());
+			stmt.addNumber(Titan::to_underlying(GUEST_LIST));
+			stmt.addBlob(listText);
+			if (!stmt.endRow()) {
 				return false;
 			}
 
@@ -310,7 +407,11 @@ bool IOMapSerialize::saveHouseInfo()
 		}
 
 		if (house->getAccessList(SUBOWNER_LIST, listText) && !listText.empty()) {
-			if (!stmt.addRow(fmt::format("{:d}, {:d}, {:s}", house->getId(), Titan::to_underlying(SUBOWNER_LIST), db.escapeString(listText)))) {
+			stmt.beginRow();
+			stmt.addNumber(house->getId());
+			stmt.addNumber(Titan::to_underlying(SUBOWNER_LIST));
+			stmt.addBlob(listText);
+			if (!stmt.endRow()) {
 				return false;
 			}
 
@@ -319,7 +420,11 @@ bool IOMapSerialize::saveHouseInfo()
 
 		for (const auto door : house->getDoors()) {
 			if (door->getAccessList(listText) && !listText.empty()) {
-				if (!stmt.addRow(fmt::format("{:d}, {:d}, {:s}", house->getId(), door->getDoorId(), db.escapeString(listText)))) {
+				stmt.beginRow();
+				stmt.addNumber(house->getId());
+				stmt.addNumber(door->getDoorId());
+				stmt.addBlob(listText);
+				if (!stmt.endRow()) {
 					return false;
 				}
 
@@ -339,6 +444,13 @@ bool IOMapSerialize::saveHouse(House* house)
 {
 	Database& db = Database::getInstance();
 
+	PropWriteStream stream;
+	std::vector<std::string> rows;
+	const uint64_t checksum = serializeHouse(stream, house, rows);
+	if (checksum == house->getItemsChecksum()) {
+		return true;
+	}
+
 	//Start the transaction
 	DBTransaction transaction;
 	if (!transaction.begin()) {
@@ -353,16 +465,12 @@ bool IOMapSerialize::saveHouse(House* house)
 	}
 
 	DBInsert stmt("INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
-
-	PropWriteStream stream;
-	for (const auto tile : house->getTiles()) {
-		saveTile(stream, tile);
-
-		if (auto attributes = stream.getStream(); attributes.size() > 0) {
-			if (!stmt.addRow(fmt::format("{:d}, {:s}", houseId, db.escapeString(attributes)))) {
-				return false;
-			}
-			stream.clear();
+	for (const std::string& row : rows) {
+		stmt.beginRow();
+		stmt.addNumber(houseId);
+		stmt.addBlob(row);
+		if (!stmt.endRow()) {
+			return false;
 		}
 	}
 
@@ -371,5 +479,10 @@ bool IOMapSerialize::saveHouse(House* house)
 	}
 
 	//End the transaction
-	return transaction.commit();
+	if (!transaction.commit()) {
+		return false;
+	}
+
+	house->setItemsChecksum(checksum);
+	return true;
 }
@@ -7,6 +7,10 @@
 #include "database.h"
 #include "map.h"
 #include "house.h"
+#include "tasks.h"
+
+// leads every saved tile in the compact format, no map reaches x 65535
+static constexpr std::string_view TILE_COMPACT_HEADER{"\xFF\xFF\x01", 3};
 
 class IOMapSerialize
 {
@@ -19,11 +23,46 @@ class IOMapSerialize
 		static bool saveHouse(House* house);
 
 	private:
+		friend class SaveHouseItemsJob;
+
 		static void saveItem(PropWriteStream& stream, const ItemPtr& item);
 		static void saveTile(PropWriteStream& stream, const TilePtr& tile);
 
+		// fills rows with the tile store rows of house, returns their checksum
+		static uint64_t serializeHouse(PropWriteStream& stream, const House* house, std::vector<std::string>& rows);
+		static uint64_t getRowChecksum(std::string_view data);
+
 		static bool loadContainer(PropStream& propStream, const ContainerPtr& container);
 		static bool loadItem(PropStream& propStream, const CylinderPtr& parent);
 };
 
+// Serializes one house per step and writes the houses whose rows changed
+// since they were loaded or last saved in a single transaction at the end,
+// the database only sees a complete snapshot
+class SaveHouseItemsJob final : public DispatcherJob
+{
+	public:
+		SaveHouseItemsJob();
+
+		bool step() override;
+
+		bool succeeded() const {
+			return success;
+		}
+
+	private:
+		bool write();
+
+		std::vector<House*> houses;
+		// with the checksum of their new rows, set once the rows are committed
+		std::vector<std::pair<House*, uint64_t>> changed;
+		std::vector<std::string> rows;
+		size_t nextHouse = 0;
+		// held until write, it only reaches the database inside the transaction
+		DBInsert stmt{"INSERT INTO `tile_store` (`house_id`, `data`) VALUES "};
+		PropWriteStream stream;
+		int64_t start;
+		bool success = false;
+};
+
 #endif
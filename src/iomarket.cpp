@@ -16,31 +16,25 @@
 extern ConfigManager g_config;
 extern Game g_game;
 
+// market writes share a key so they reach the table in the order they were made
+static constexpr uint64_t MARKET_TASK_KEY = (1ULL << 63) | 1;
+
 MarketOfferList IOMarket::getActiveOffers(MarketAction_t action, uint16_t itemId)
 {
 	MarketOfferList offerList;
 
-	DBResult_ptr result = Database::getInstance().storeQuery(fmt::format("SELECT `id`, `amount`, `price`, `created`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `sale` = {:d} AND `itemtype` = {:d}", Titan::to_underlying(action), itemId));
-	if (!result) {
-		return offerList;
-	}
-
 	const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-	do {
+	getInstance().orderBook.forEachOffer(action, itemId, [&](const MarketOrder& order) {
 		MarketOffer offer;
-		offer.amount = result->getNumber<uint16_t>("amount");
-		offer.price = result->getNumber<uint32_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-		offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
+		offer.amount = order.amount;
+		offer.price = order.price;
+		offer.timestamp = order.created + marketOfferDuration;
+		offer.counter = order.id & 0xFFFF;
 		offer.itemId = itemId;
-		if (result->getNumber<uint16_t>("anonymous") == 0) {
-			offer.playerName = result->getString("player_name");
-		} else {
-			offer.playerName = "Anonymous";
-		}
-		offerList.push_back(offer);
-	} while (result->next());
+		offer.playerName = order.anonymous ? "Anonymous" : order.playerName;
+		offerList.push_back(std::move(offer));
+	});
 	return offerList;
 }
 
@@ -50,20 +44,19 @@ MarketOfferList IOMarket::getOwnOffers(MarketAction_t action, uint32_t playerId)
 
 	const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-	DBResult_ptr result = Database::getInstance().storeQuery(fmt::format("SELECT `id`, `amount`, `price`, `created`, `itemtype` FROM `market_offers` WHERE `player_id` = {:d} AND `sale` = {:d}", playerId, Titan::to_underlying(action)));
-	if (!result) {
-		return offerList;
-	}
+	getInstance().orderBook.forEachOwnOffer(playerId, [&](const MarketOrder& order) {
+		if (order.type != action) {
+			return;
+		}
 
-	do {
 		MarketOffer offer;
-		offer.amount = result->getNumber<uint16_t>("amount");
-		offer.price = result->getNumber<uint32_t>("price");
-		offer.timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-		offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-		offer.itemId = result->getNumber<uint16_t>("itemtype");
-		offerList.push_back(offer);
-	} while (result->next());
+		offer.amount = order.amount;
+		offer.price = order.price;
+		offer.timestamp = order.created + marketOfferDuration;
+		offer.counter = order.id & 0xFFFF;
+		offer.itemId = order.itemId;
+		offerList.push_back(std::move(offer));
+	});
 	return offerList;
 }
 
@@ -71,7 +64,7 @@ HistoryMarketOfferList IOMarket::getOwnHistory(MarketAction_t action, uint32_t p
 {
 	HistoryMarketOfferList offerList;
 
-	DBResult_ptr result = Database::getInstance().storeQuery(fmt::format("SELECT `itemtype`, `amount`, `price`, `expires_at`, `state` FROM `market_history` WHERE `player_id` = {:d} AND `sale` = {:d}", playerId, Titan::to_underlying(action)));
+	DBResult_ptr result = Database::getInstance().storeStatement("SELECT `itemtype`, `amount`, `price`, `expires_at`, `state` FROM `market_history` WHERE `player_id` = ? AND `sale` = ?", {playerId, Titan::to_underlying(action)});
 	if (!result) {
 		return offerList;
 	}
@@ -95,140 +88,170 @@ HistoryMarketOfferList IOMarket::getOwnHistory(MarketAction_t action, uint32_t p
 	return offerList;
 }
 
-void IOMarket::processExpiredOffers(const DBResult_ptr& result, bool)
+void IOMarket::processExpiredOffer(const MarketOrder& order)
 {
-	if (!result) {
-		return;
-	}
-
-	do {
-		if (!IOMarket::moveOfferToHistory(result->getNumber<uint32_t>("id"), OFFERSTATE_EXPIRED)) {
-			continue;
+	const uint32_t playerId = order.playerId;
+	const uint16_t amount = order.amount;
+	if (order.type == MARKETACTION_SELL) {
+		const ItemType& itemType = Item::items[order.itemId];
+		if (itemType.id == 0) {
+			return;
 		}
 
-		const uint32_t playerId = result->getNumber<uint32_t>("player_id");
-		const uint16_t amount = result->getNumber<uint16_t>("amount");
-		if (result->getNumber<uint16_t>("sale") == 1) {
-			const ItemType& itemType = Item::items[result->getNumber<uint16_t>("itemtype")];
-			if (itemType.id == 0) {
-				continue;
+		auto player = g_game.getPlayerByGUID(playerId);
+		if (!player) {
+			player = std::make_shared<Player>(nullptr);
+			if (!IOLoginData::loadPlayerById(player, playerId)) {
+				return;
 			}
+		}
 
-			auto player = g_game.getPlayerByGUID(playerId);
-			if (!player) {
-				player = std::make_shared<Player>(nullptr);
-				if (!IOLoginData::loadPlayerById(player, playerId)) {
-					continue;
+		if (itemType.stackable) {
+			uint16_t tmpAmount = amount;
+			while (tmpAmount > 0) {
+				uint16_t stackCount = std::min<uint16_t>(100, tmpAmount);
+				auto item = Item::CreateItem(itemType.id, stackCount);
+				if (CylinderPtr inbox = player->getInbox(); g_game.internalAddItem(inbox, item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+					break;
 				}
-			}
-
-			if (itemType.stackable) {
-				uint16_t tmpAmount = amount;
-				while (tmpAmount > 0) {
-					uint16_t stackCount = std::min<uint16_t>(100, tmpAmount);
-					auto item = Item::CreateItem(itemType.id, stackCount);
-					if (CylinderPtr inbox = player->getInbox(); g_game.internalAddItem(inbox, item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
-						break;
-					}
 
-					tmpAmount -= stackCount;
-				}
+				tmpAmount -= stackCount;
+			}
+		} else {
+			int32_t subType;
+			if (itemType.charges != 0) {
+				subType = itemType.charges;
 			} else {
-				int32_t subType;
-				if (itemType.charges != 0) {
-					subType = itemType.charges;
-				} else {
-					subType = -1;
-				}
+				subType = -1;
+			}
 
-				for (uint16_t i = 0; i < amount; ++i) {
-					auto item = Item::CreateItem(itemType.id, subType);
-					if (CylinderPtr inbox = player->getInbox(); g_game.internalAddItem(inbox, item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
-						break;
-					}
+			for (uint16_t i = 0; i < amount; ++i) {
+				auto item = Item::CreateItem(itemType.id, subType);
+				if (CylinderPtr inbox = player->getInbox(); g_game.internalAddItem(inbox, item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+					break;
 				}
 			}
+		}
 
-			if (player->isOffline()) {
-				IOLoginData::savePlayer(player);
-			}
-		} else {
-			uint64_t totalPrice = result->getNumber<uint64_t>("price") * amount;
+		if (player->isOffline()) {
+			IOLoginData::savePlayer(player);
+		}
+	} else {
+		uint64_t totalPrice = static_cast<uint64_t>(order.price) * amount;
 
-			if (const auto player = g_game.getPlayerByGUID(playerId)) {
-				player->setBankBalance(player->getBankBalance() + totalPrice);
-			} else {
-				IOLoginData::increaseBankBalance(playerId, totalPrice);
-			}
+		if (const auto player = g_game.getPlayerByGUID(playerId)) {
+			player->setBankBalance(player->getBankBalance() + totalPrice);
+		} else {
+			IOLoginData::increaseBankBalance(playerId, totalPrice);
 		}
-	} while (result->next());
+	}
 }
 
 void IOMarket::checkExpiredOffers()
 {
-	const time_t lastExpireDate = time(nullptr) - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
+	IOMarket& market = getInstance();
+	market.expiryEvent = 0;
+
+	const uint32_t lastExpireDate = time(nullptr) - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
+	while (const MarketOrder* oldest = market.orderBook.getOldest()) {
+		if (oldest->created > lastExpireDate) {
+			break;
+		}
+
+		const MarketOrder order = *oldest;
+		moveOfferToHistory(order.id, OFFERSTATE_EXPIRED);
+		processExpiredOffer(order);
+	}
+
+	scheduleExpiry();
+}
 
-	g_databaseTasks.addTask(fmt::format("SELECT `id`, `amount`, `price`, `itemtype`, `player_id`, `sale` FROM `market_offers` WHERE `created` <= {:d}", lastExpireDate), IOMarket::processExpiredOffers, true);
+void IOMarket::scheduleExpiry()
+{
+	IOMarket& market = getInstance();
+	if (market.expiryEvent != 0 || g_config.getNumber(ConfigManager::CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES) <= 0) {
+		return;
+	}
 
-	int32_t checkExpiredMarketOffersEachMinutes = g_config.getNumber(ConfigManager::CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES);
-	if (checkExpiredMarketOffersEachMinutes <= 0) {
+	const MarketOrder* oldest = market.orderBook.getOldest();
+	if (!oldest) {
 		return;
 	}
 
-	g_scheduler.addEvent(createSchedulerTask(checkExpiredMarketOffersEachMinutes * 60 * 1000, &IOMarket::checkExpiredOffers));
+	const int64_t expiresAt = static_cast<int64_t>(oldest->created) + g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
+	const int64_t delay = std::max<int64_t>(1, expiresAt - time(nullptr) + 1) * 1000;
+	market.expiryEvent = g_scheduler.addEvent(createSchedulerTask(static_cast<uint32_t>(std::min<int64_t>(delay, std::numeric_limits<int32_t>::max())), &IOMarket::checkExpiredOffers, DISPATCHER_LANE_BACKGROUND));
 }
 
 uint32_t IOMarket::getPlayerOfferCount(uint32_t playerId)
 {
-	DBResult_ptr result = Database::getInstance().storeQuery(fmt::format("SELECT COUNT(*) AS `count` FROM `market_offers` WHERE `player_id` = {:d}", playerId));
-	if (!result) {
-		return 0;
-	}
-	return result->getNumber<int32_t>("count");
+	return getInstance().orderBook.getOfferCount(playerId);
 }
 
 MarketOfferEx IOMarket::getOfferByCounter(uint32_t timestamp, uint16_t counter)
 {
 	MarketOfferEx offer;
 
-	const int32_t created = timestamp - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
+	const uint32_t created = timestamp - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-	DBResult_ptr result = Database::getInstance().storeQuery(fmt::format("SELECT `id`, `sale`, `itemtype`, `amount`, `created`, `price`, `player_id`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `created` = {:d} AND (`id` & 65535) = {:d} LIMIT 1", created, counter));
-	if (!result) {
+	const MarketOrder* order = getInstance().orderBook.findByCounter(created, counter);
+	if (!order) {
 		offer.id = 0;
 		offer.playerId = 0;
 		return offer;
 	}
 
-	offer.id = result->getNumber<uint32_t>("id");
-	offer.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
-	offer.amount = result->getNumber<uint16_t>("amount");
-	offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-	offer.timestamp = result->getNumber<uint32_t>("created");
-	offer.price = result->getNumber<uint32_t>("price");
-	offer.itemId = result->getNumber<uint16_t>("itemtype");
-	offer.playerId = result->getNumber<uint32_t>("player_id");
-	if (result->getNumber<uint16_t>("anonymous") == 0) {
-		offer.playerName = result->getString("player_name");
-	} else {
-		offer.playerName = "Anonymous";
-	}
+	offer.id = order->id;
+	offer.type = order->type;
+	offer.amount = order->amount;
+	offer.counter = order->id & 0xFFFF;
+	offer.timestamp = order->created;
+	offer.price = order->price;
+	offer.itemId = order->itemId;
+	offer.playerId = order->playerId;
+	offer.playerName = order->anonymous ? "Anonymous" : order->playerName;
 	return offer;
 }
 
 void IOMarket::createOffer(uint32_t playerId, MarketAction_t action, uint32_t itemId, uint16_t amount, uint32_t price, bool anonymous)
 {
-	Database::getInstance().executeQuery(fmt::format("INSERT INTO `market_offers` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `created`, `anonymous`) VALUES ({:d}, {:d}, {:d}, {:d}, {:d}, {:d}, {:d})", playerId, Titan::to_underlying(action), itemId, amount, price, time(nullptr), anonymous));
+	IOMarket& market = getInstance();
+
+	MarketOrder order;
+	order.id = ++market.lastOfferId;
+	order.playerId = playerId;
+	order.created = time(nullptr);
+	order.price = price;
+	order.itemId = itemId;
+	order.amount = amount;
+	order.type = action;
+	order.anonymous = anonymous;
+	if (const auto player = g_game.getPlayerByGUID(playerId)) {
+		order.playerName = player->getName();
+	} else {
+		order.playerName = IOLoginData::getNameByGuid(playerId);
+	}
+
+	g_databaseTasks.addTask(fmt::format("INSERT INTO `market_offers` (`id`, `player_id`, `sale`, `itemtype`, `amount`, `price`, `created`, `anonymous`) VALUES ({:d}, {:d}, {:d}, {:d}, {:d}, {:d}, {:d}, {:d})", order.id, playerId, Titan::to_underlying(action), itemId, amount, price, order.created, anonymous), nullptr, false, MARKET_TASK_KEY);
+	market.orderBook.add(std::move(order));
+	scheduleExpiry();
 }
 
 void IOMarket::acceptOffer(uint32_t offerId, uint16_t amount)
 {
-	Database::getInstance().executeQuery(fmt::format("UPDATE `market_offers` SET `amount` = `amount` - {:d} WHERE `id` = {:d}", amount, offerId));
+	MarketOrder* order = getInstance().orderBook.find(offerId);
+	if (!order) {
+		return;
+	}
+
+	order->amount -= std::min(amount, order->amount);
+	g_databaseTasks.addTask(fmt::format("UPDATE `market_offers` SET `amount` = `amount` - {:d} WHERE `id` = {:d}", amount, offerId), nullptr, false, MARKET_TASK_KEY);
 }
 
 void IOMarket::deleteOffer(uint32_t offerId)
 {
-	Database::getInstance().executeQuery(fmt::format("DELETE FROM `market_offers` WHERE `id` = {:d}", offerId));
+	getInstance().orderBook.remove(offerId);
+	g_databaseTasks.addTask(fmt::format("DELETE FROM `market_offers` WHERE `id` = {:d}", offerId), nullptr, false, MARKET_TASK_KEY);
 }
 
 void IOMarket::appendHistory(uint32_t playerId, MarketAction_t action, uint16_t itemId, uint16_t amount, uint32_t price, time_t timestamp, MarketOfferState_t state)
@@ -240,19 +263,48 @@ bool IOMarket::moveOfferToHistory(uint32_t offerId, MarketOfferState_t state)
 {
 	const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-	Database& db = Database::getInstance();
-
-	DBResult_ptr result = db.storeQuery(fmt::format("SELECT `player_id`, `sale`, `itemtype`, `amount`, `price`, `created` FROM `market_offers` WHERE `id` = {:d}", offerId));
-	if (!result) {
+	const MarketOrder* order = getInstance().orderBook.find(offerId);
+	if (!order) {
 		return false;
 	}
 
-	if (!db.executeQuery(fmt::format("DELETE FROM `market_offers` WHERE `id` = {:d}", offerId))) {
-		return false;
+	appendHistory(order->playerId, order->type, order->itemId, order->amount, order->price, order->created + marketOfferDuration, state);
+	deleteOffer(offerId);
+	return true;
+}
+
+void IOMarket::loadOffers()
+{
+	DBResult_ptr result = Database::getInstance().storeQuery("SELECT `o`.`id`, `o`.`player_id`, `o`.`sale`, `o`.`itemtype`, `o`.`amount`, `o`.`created`, `o`.`anonymous`, `o`.`price`, `p`.`name` FROM `market_offers` AS `o` LEFT JOIN `players` AS `p` ON `p`.`id` = `o`.`player_id`");
+	if (!result) {
+		return;
 	}
 
-	appendHistory(result->getNumber<uint32_t>("player_id"), static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale")), result->getNumber<uint16_t>("itemtype"), result->getNumber<uint16_t>("amount"), result->getNumber<uint32_t>("price"), result->getNumber<uint32_t>("created") + marketOfferDuration, state);
-	return true;
+	const size_t idColumn = result->getColumnIndex("id");
+	const size_t playerColumn = result->getColumnIndex("player_id");
+	const size_t saleColumn = result->getColumnIndex("sale");
+	const size_t typeColumn = result->getColumnIndex("itemtype");
+	const size_t amountColumn = result->getColumnIndex("amount");
+	const size_t createdColumn = result->getColumnIndex("created");
+	const size_t anonymousColumn = result->getColumnIndex("anonymous");
+	const size_t priceColumn = result->getColumnIndex("price");
+	const size_t nameColumn = result->getColumnIndex("name");
+
+	do {
+		MarketOrder order;
+		order.id = result->getNumber<uint32_t>(idColumn);
+		order.playerId = result->getNumber<uint32_t>(playerColumn);
+		order.type = result->getNumber<uint16_t>(saleColumn) == 1 ? MARKETACTION_SELL : MARKETACTION_BUY;
+		order.itemId = result->getNumber<uint16_t>(typeColumn);
+		order.amount = result->getNumber<uint16_t>(amountColumn);
+		order.created = result->getNumber<uint32_t>(createdColumn);
+		order.anonymous = result->getNumber<uint16_t>(anonymousColumn) != 0;
+		order.price = result->getNumber<uint32_t>(priceColumn);
+		order.playerName = result->getString(nameColumn);
+
+		lastOfferId = std::max(lastOfferId, order.id);
+		orderBook.add(std::move(order));
+	} while (result->next());
 }
 
 void IOMarket::updateStatistics()
@@ -262,18 +314,25 @@ void IOMarket::updateStatistics()
 		return;
 	}
 
+	const size_t saleColumn = result->getColumnIndex("sale");
+	const size_t typeColumn = result->getColumnIndex("itemtype");
+	const size_t numColumn = result->getColumnIndex("num");
+	const size_t minColumn = result->getColumnIndex("min");
+	const size_t sumColumn = result->getColumnIndex("sum");
+	const size_t maxColumn = result->getColumnIndex("max");
+
 	do {
 		MarketStatistics* statistics;
-		if (result->getNumber<uint16_t>("sale") == MARKETACTION_BUY) {
-			statistics = &purchaseStatistics[result->getNumber<uint16_t>("itemtype")];
+		if (result->getNumber<uint16_t>(saleColumn) == MARKETACTION_BUY) {
+			statistics = &purchaseStatistics[result->getNumber<uint16_t>(typeColumn)];
 		} else {
-			statistics = &saleStatistics[result->getNumber<uint16_t>("itemtype")];
+			statistics = &saleStatistics[result->getNumber<uint16_t>(typeColumn)];
 		}
 
-		statistics->numTransactions = result->getNumber<uint32_t>("num");
-		statistics->lowestPrice = result->getNumber<uint32_t>("min");
-		statistics->totalPrice = result->getNumber<uint64_t>("sum");
-		statistics->highestPrice = result->getNumber<uint32_t>("max");
+		statistics->numTransactions = result->getNumber<uint32_t>(numColumn);
+		statistics->lowestPrice = result->getNumber<uint32_t>(minColumn);
+		statistics->totalPrice = result->getNumber<uint64_t>(sumColumn);
+		statistics->highestPrice = result->getNumber<uint32_t>(maxColumn);
 	} while (result->next());
 }
 
@@ -6,7 +6,11 @@
 
 #include "enums.h"
 #include "database.h"
+#include "marketorderbook.h"
 
+// The active offers are kept in memory, loaded once at startup, and every
+// change to them is written to `market_offers` on the database thread in the
+// order it happened. The history stays in the database.
 class IOMarket
 {
 	public:
@@ -19,7 +23,6 @@ class IOMarket
 		static MarketOfferList getOwnOffers(MarketAction_t action, uint32_t playerId);
 		static HistoryMarketOfferList getOwnHistory(MarketAction_t action, uint32_t playerId);
 
-		static void processExpiredOffers(const DBResult_ptr& result, bool);
 		static void checkExpiredOffers();
 
 		static uint32_t getPlayerOfferCount(uint32_t playerId);
@@ -32,6 +35,7 @@ class IOMarket
 		static void appendHistory(uint32_t playerId, MarketAction_t type, uint16_t itemId, uint16_t amount, uint32_t price, time_t timestamp, MarketOfferState_t state);
 		static bool moveOfferToHistory(uint32_t offerId, MarketOfferState_t state);
 
+		void loadOffers();
 		void updateStatistics();
 
 		MarketStatistics* getPurchaseStatistics(uint16_t itemId);
@@ -40,6 +44,16 @@ class IOMarket
 	private:
 		IOMarket() = default;
 
+		// hands back the items or the money of an offer that ran out
+		static void processExpiredOffer(const MarketOrder& order);
+		// at the time the oldest offer runs out
+		static void scheduleExpiry();
+
+		MarketOrderBook orderBook;
+		// ids are given out here so the client can name an offer before its row is written
+		uint32_t lastOfferId = 0;
+		uint32_t expiryEvent = 0;
+
 		std::map<uint16_t, MarketStatistics> purchaseStatistics;
 		std::map<uint16_t, MarketStatistics> saleStatistics;
 };
@@ -212,6 +212,12 @@ ItemPtr Item::clone() const
 	auto item = Item::CreateItem(id, count);
 	if (attributes) {
 		item->attributes.reset(new ItemAttributes(*attributes));
+		if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
+			// the copy gets its own slot in the decay wheel
+			item->setIntAttr(ITEM_ATTRIBUTE_DURATION, item->getDuration());
+			item->removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
+		}
+
 		if (item->getDuration() > 0) {
 			item->setDecaying(DECAYING_TRUE);
 			g_game.toDecayItems.push_front(item);
@@ -254,7 +260,7 @@ bool Item::equals(const ItemConstPtr& otherItem) const
 			}
 		} else {
 			for (const auto& otherAttribute : otherAttributeList) {
-				if (attribute.type == otherAttribute.type && *attribute.value.custom != *otherAttribute.value.custom) {
+				if (attribute.type == otherAttribute.type && attribute.value.custom != otherAttribute.value.custom && attribute.value.custom->map != otherAttribute.value.custom->map) {
 					return false;
 				}
 			}
@@ -298,6 +304,7 @@ void Item::setID(uint16_t newid)
 	if (newDuration == 0 && !it.stopTime && it.decayTo < 0) {
 		removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
 		removeAttribute(ITEM_ATTRIBUTE_DURATION);
+		removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
 	}
 
 	removeAttribute(ITEM_ATTRIBUTE_CORPSEOWNER);
@@ -305,6 +312,19 @@ void Item::setID(uint16_t newid)
 	if (newDuration > 0 && (!prevIt.stopTime || !hasAttribute(ITEM_ATTRIBUTE_DURATION))) {
 		setDecaying(DECAYING_FALSE);
 		setDuration(newDuration);
+	} else if (hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP) && !canDecay()) {
+		// e.g. a ring taken off, freeze the remaining time right away
+		setDecaying(DECAYING_FALSE);
+	}
+}
+
+void Item::setDuration(int32_t time)
+{
+	setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
+	if (hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
+		// already in the decay wheel, schedule it again for the new expiry
+		removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
+		g_game.toDecayItems.push_front(getItem());
 	}
 }
 
@@ -703,7 +723,8 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 
 		//Bed class
 		case ATTR_SLEEPERGUID: {
-			if (!propStream.skip(4)) {
+			uint32_t value;
+			if (!propStream.read<uint32_t>(value)) {
 				std::cout << "Failed to read : Sleeper GUID \n";
 				return ATTR_READ_ERROR;
 			}
@@ -711,7 +732,8 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 		}
 
 		case ATTR_SLEEPSTART: {
-			if (!propStream.skip(4)) {
+			uint32_t value;
+			if (!propStream.read<uint32_t>(value)) {
 				std::cout << "Failed to read : Sleep Start \n";
 				return ATTR_READ_ERROR;
 			}
@@ -742,7 +764,7 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
 
 			for (uint64_t i = 0; i < size; i++) {
 				// Unserialize key type and value
-				auto [key, ok] = propStream.readString();
+				auto [key, ok] = propStream.readKey();
 				if (!ok) {
 					std::cout << "Failed to read : Custom Attribute Key \n";
 					return ATTR_READ_ERROR;
@@ -846,25 +868,18 @@ bool Item::unserializeAttr(PropStream& propStream)
 
 bool Item::unserializeAugments(PropStream& propStream)
 {
-	uint32_t augmentCount = 0;
-
-	if (!propStream.read<uint32_t>(augmentCount)) {
+	std::vector<std::shared_ptr<Augment>> stored;
+	const bool result = Augments::Unserialize(propStream, stored, std::numeric_limits<uint32_t>::max());
+	if (!result && stored.empty()) {
 		std::cout << "WARNING: Failed to read augment count in IOLoginData::loadItems" << std::endl;
-		return false;
 	}
 
-	for (uint32_t i = 0; i < augmentCount; ++i) {
-		auto augment = std::make_shared<Augment>();
-		bool result = augment->unserialize(propStream);
-		if (!result) {
-			return result;
-		} else {
-			if (!hasAugment(augment->getName())) {
-				this->addAugment(augment);
-			}
+	for (const auto& augment : stored) {
+		if (!hasAugment(augment->getName())) {
+			this->addAugment(augment);
 		}
 	}
-	return true;
+	return result;
 }
 
 bool Item::unserializeItemNode(OTB::Loader&, const OTB::Node&, PropStream& propStream)
@@ -920,7 +935,7 @@ void Item::serializeAttr(PropWriteStream& propWriteStream) const
 
 	if (hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
 		propWriteStream.write<uint8_t>(ATTR_DURATION);
-		propWriteStream.write<uint32_t>(getIntAttr(ITEM_ATTRIBUTE_DURATION));
+		propWriteStream.write<uint32_t>(getDuration());
 	}
 
 	ItemDecayState_t decayState = getDecaying();
@@ -1004,7 +1019,7 @@ void Item::serializeAttr(PropWriteStream& propWriteStream) const
 		propWriteStream.write<uint8_t>(ATTR_CUSTOM_ATTRIBUTES);
 		propWriteStream.write<uint64_t>(static_cast<uint64_t>(customAttrMap->size()));
 		for (const auto& entry : *customAttrMap) {
-			propWriteStream.writeString(entry.first);
+			propWriteStream.writeKey(entry.first);
 			entry.second.serialize(propWriteStream);
 		}
 	}
@@ -1448,6 +1463,16 @@ std::string Item::getWeightDescription() const
 	return getWeightDescription(weight);
 }
 
+void Item::setActionId(uint16_t n)
+{
+	if (n < 100) {
+		n = 100;
+	}
+
+	setIntAttr(ITEM_ATTRIBUTE_ACTIONID, n);
+	flagMoveEventTile();
+}
+
 void Item::setUniqueId(uint16_t n)
 {
 	if (hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
@@ -1456,6 +1481,15 @@ void Item::setUniqueId(uint16_t n)
 
 	if (g_game.addUniqueItem(n, getItem())) {
 		getAttributes()->setUniqueId(n);
+		flagMoveEventTile();
+	}
+}
+
+void Item::flagMoveEventTile()
+{
+	// the tile was flagged when the item came without the id
+	if (const auto tile = std::dynamic_pointer_cast<Tile>(getParent())) {
+		tile->setFlag(TILESTATE_MOVEEVENT);
 	}
 }
 
@@ -1842,7 +1876,10 @@ const bool Item::addAugment(const std::shared_ptr<Augment>& augment)
 	}
 
 	augments.push_back(augment);
-	g_events->eventItemOnAugment(getItem(), augment);
+	DamageModifier::invalidateSets();
+	if (g_events->hasEvent(EventInfoId::ITEM_ONAUGMENT)) {
+		g_events->eventItemOnAugment(getItem(), augment);
+	}
 	return true;
 }
 
@@ -1850,7 +1887,10 @@ const bool Item::addAugment(std::string_view augmentName)
 {
 	if (auto augment = Augments::GetAugment(augmentName)) {
 		augments.emplace_back(augment);
-		g_events->eventItemOnAugment(std::dynamic_pointer_cast<Item>(shared_from_this()), augment);
+		DamageModifier::invalidateSets();
+		if (g_events->hasEvent(EventInfoId::ITEM_ONAUGMENT)) {
+			g_events->eventItemOnAugment(getItem(), augment);
+		}
 		return true;
 	}
 	return false;
@@ -1860,24 +1900,27 @@ const bool Item::removeAugment(std::shared_ptr<Augment>& augment)
 {
 	auto originalSize = augments.size();
 	std::erase(augments, augment);
+	DamageModifier::invalidateSets();
 	const auto removed = (augments.size() - originalSize) > 0 ? true : false;
-	if (removed) {
-		g_events->eventItemOnRemoveAugment(std::dynamic_pointer_cast<Item>(shared_from_this()), augment);
+	if (removed && g_events->hasEvent(EventInfoId::ITEM_ONREMOVEAUGMENT)) {
+		g_events->eventItemOnRemoveAugment(getItem(), augment);
 	}
 	return removed;
 }
 
 const bool Item::removeAugment(std::string_view name) {
 	auto originalSize = augments.size();
+	const bool removeEvent = g_events->hasEvent(EventInfoId::ITEM_ONREMOVEAUGMENT);
     
 	std::erase_if(augments,
-          [this, &name](const std::shared_ptr<Augment>& augment) {
+          [this, &name, removeEvent](const std::shared_ptr<Augment>& augment) {
               const auto match = augment->getName() == name;
-              if (match) {
+              if (match && removeEvent) {
 	              g_events->eventItemOnRemoveAugment(std::dynamic_pointer_cast<Item>(shared_from_this()), augment);
               }
               return match;
           });
+	DamageModifier::invalidateSets();
         
 	return augments.size() < originalSize;
 }
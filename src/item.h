@@ -12,9 +12,12 @@
 #include "imbuement.h"
 #include "augments.h"
 #include "declarations.h"
+#include "instancecounter.h"
 
 #include <typeinfo>
 #include <boost/variant.hpp>
+#include <boost/container/small_vector.hpp>
+#include <atomic>
 #include <deque>
 #include <gtl/phmap.hpp>
 
@@ -104,6 +107,9 @@ enum AttrTypes_t {
 	ATTR_REWARDID = 45
 };
 
+// leads the compact attribute blobs stored in the database, no attribute type is 0xFE
+static constexpr std::string_view ITEM_ATTRIBUTES_COMPACT_HEADER{"\xFE\x01", 2};
+
 enum Attr_ReadValue {
 	ATTR_READ_CONTINUE,
 	ATTR_READ_ERROR,
@@ -372,12 +378,25 @@ class ItemAttributes
 
 		typedef gtl::node_hash_map<std::string, CustomAttribute> CustomAttributeMap;
 
+		// shared by the copies of an item until one of them changes it
+		struct SharedCustomAttributeMap
+		{
+			CustomAttributeMap map;
+			std::atomic<uint32_t> references{1};
+
+			static void release(SharedCustomAttributeMap* custom) {
+				if (custom && custom->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					delete custom;
+				}
+			}
+		};
+
 		struct Attribute
 		{
 			union {
 				int64_t integer;
 				std::string* string;
-				CustomAttributeMap* custom;
+				SharedCustomAttributeMap* custom;
 			} value;
 			itemAttrTypes type;
 
@@ -391,13 +410,16 @@ class ItemAttributes
 				} else if (ItemAttributes::isStrAttrType(type)) {
 					value.string = new std::string(*i.value.string);
 				} else if (ItemAttributes::isCustomAttrType(type)) {
-					value.custom = new CustomAttributeMap(*i.value.custom);
+					value.custom = i.value.custom;
+					if (value.custom) {
+						value.custom->references.fetch_add(1, std::memory_order_relaxed);
+					}
 				} else {
 					memset(&value, 0, sizeof(value));
 				}
 			}
 			
-			Attribute(Attribute&& attribute) : value(attribute.value), type(attribute.type) {
+			Attribute(Attribute&& attribute) noexcept : value(attribute.value), type(attribute.type) {
 				memset(&attribute.value, 0, sizeof(value));
 				attribute.type = ITEM_ATTRIBUTE_NONE;
 			}
@@ -406,7 +428,7 @@ class ItemAttributes
 				if (ItemAttributes::isStrAttrType(type)) {
 					delete value.string;
 				} else if (ItemAttributes::isCustomAttrType(type)) {
-					delete value.custom;
+					SharedCustomAttributeMap::release(value.custom);
 				}
 			}
 			
@@ -420,7 +442,7 @@ class ItemAttributes
 					if (ItemAttributes::isStrAttrType(type)) {
 						delete value.string;
 					} else if (ItemAttributes::isCustomAttrType(type)) {
-						delete value.custom;
+						SharedCustomAttributeMap::release(value.custom);
 					}
 
 					value = other.value;
@@ -438,7 +460,10 @@ class ItemAttributes
 			}
 		};
 
-		std::vector<Attribute> attributes;
+		// most items carry one to three attributes, those stay inline
+		using AttributeList = boost::container::small_vector<Attribute, 3>;
+
+		AttributeList attributes;
 		uint32_t attributeBits = 0;
 
 		const std::string& getStrAttr(itemAttrTypes type) const;
@@ -451,12 +476,24 @@ class ItemAttributes
 		const Attribute* getExistingAttr(itemAttrTypes type) const;
 		Attribute& getAttr(itemAttrTypes type);
 
-		CustomAttributeMap* getCustomAttributeMap() {
-			if (!hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				return nullptr;
+		const CustomAttributeMap* getCustomAttributeMap() const {
+			if (const Attribute* attr = getExistingAttr(ITEM_ATTRIBUTE_CUSTOM); attr && attr->value.custom) {
+				return &attr->value.custom->map;
 			}
+			return nullptr;
+		}
 
-			return getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom;
+		// the map of this item alone, copied first while other items still share it
+		CustomAttributeMap& getUniqueCustomAttributeMap() {
+			SharedCustomAttributeMap*& custom = getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom;
+			if (!custom) {
+				custom = new SharedCustomAttributeMap();
+			} else if (custom->references.load(std::memory_order_acquire) != 1) {
+				auto copy = new SharedCustomAttributeMap{custom->map};
+				SharedCustomAttributeMap::release(custom);
+				custom = copy;
+			}
+			return custom->map;
 		}
 
 		template<typename R>
@@ -473,25 +510,17 @@ class ItemAttributes
 		template<typename R>
 		void setCustomAttribute(std::string_view key, R value)
 		{
-
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
-			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
-			}
+			CustomAttributeMap& customAttrMap = getUniqueCustomAttributeMap();
 			auto lowercaseKey = boost::algorithm::to_lower_copy(std::string{ key });
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->emplace(lowercaseKey, value);
+			customAttrMap.erase(lowercaseKey);
+			customAttrMap.emplace(lowercaseKey, value);
 		}
 
 		void setCustomAttribute(std::string_view key, const CustomAttribute& value) {
-
-			if (hasAttribute(ITEM_ATTRIBUTE_CUSTOM)) {
-				removeCustomAttribute(key);
-			} else {
-				getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom = new CustomAttributeMap();
-			}
+			CustomAttributeMap& customAttrMap = getUniqueCustomAttributeMap();
 			auto lowercaseKey = boost::algorithm::to_lower_copy(std::string{ key });
-			getAttr(ITEM_ATTRIBUTE_CUSTOM).value.custom->emplace(lowercaseKey, value);
+			customAttrMap.erase(lowercaseKey);
+			customAttrMap.emplace(lowercaseKey, value);
 		}
 
 		const CustomAttribute* getCustomAttribute(int64_t key) {
@@ -516,10 +545,10 @@ class ItemAttributes
 		}
 
 		bool removeCustomAttribute(std::string_view key) {
-			if (CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
+			if (const CustomAttributeMap* customAttrMap = getCustomAttributeMap()) {
 				auto lowercaseKey = boost::algorithm::to_lower_copy(std::string{ key });
-				if (auto it = customAttrMap->find(lowercaseKey); it != customAttrMap->end()) {
-					customAttrMap->erase(it);
+				if (customAttrMap->contains(lowercaseKey)) {
+					getUniqueCustomAttributeMap().erase(lowercaseKey);
 					return true;
 				}
 			}
@@ -531,7 +560,7 @@ class ItemAttributes
 			| ITEM_ATTRIBUTE_ARMOR | ITEM_ATTRIBUTE_HITCHANCE | ITEM_ATTRIBUTE_SHOOTRANGE | ITEM_ATTRIBUTE_OWNER
 			| ITEM_ATTRIBUTE_DURATION | ITEM_ATTRIBUTE_DECAYSTATE | ITEM_ATTRIBUTE_CORPSEOWNER | ITEM_ATTRIBUTE_CHARGES
 			| ITEM_ATTRIBUTE_FLUIDTYPE | ITEM_ATTRIBUTE_DOORID | ITEM_ATTRIBUTE_DECAYTO | ITEM_ATTRIBUTE_WRAPID | ITEM_ATTRIBUTE_STOREITEM
-			| ITEM_ATTRIBUTE_ATTACK_SPEED | ITEM_ATTRIBUTE_REWARDID;
+			| ITEM_ATTRIBUTE_ATTACK_SPEED | ITEM_ATTRIBUTE_REWARDID | ITEM_ATTRIBUTE_DURATION_TIMESTAMP;
 		static constexpr uint32_t stringAttributeTypes = ITEM_ATTRIBUTE_DESCRIPTION | ITEM_ATTRIBUTE_TEXT | ITEM_ATTRIBUTE_WRITER
 			| ITEM_ATTRIBUTE_NAME | ITEM_ATTRIBUTE_ARTICLE | ITEM_ATTRIBUTE_PLURALNAME | ITEM_ATTRIBUTE_CLASSIFICATION | ITEM_ATTRIBUTE_TIER;
 
@@ -546,14 +575,14 @@ class ItemAttributes
 			return (type & ITEM_ATTRIBUTE_CUSTOM) == type;
 		}
 
-		const std::vector<Attribute>& getList() const {
+		const AttributeList& getList() const {
 			return attributes;
 		}
 
 	friend class Item;
 };
 
-class Item : virtual public Thing, public SharedObject
+class Item : virtual public Thing, public SharedObject, public InstanceCounter<Item>
 {
 	public:
 		//Factory member to create item of right type based on type
@@ -766,13 +795,7 @@ class Item : virtual public Thing, public SharedObject
 			return getStrAttr(ITEM_ATTRIBUTE_WRITER);
 		}
 
-		void setActionId(uint16_t n) {
-			if (n < 100) {
-				n = 100;
-			}
-
-			setIntAttr(ITEM_ATTRIBUTE_ACTIONID, n);
-		}
+		void setActionId(uint16_t n);
 	
 		uint16_t getActionId() const {
 			if (!attributes) {
@@ -832,9 +855,7 @@ class Item : virtual public Thing, public SharedObject
 			return getIntAttr(ITEM_ATTRIBUTE_CORPSEOWNER);
 		}
 
-		void setDuration(int32_t time) {
-			setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
-		}
+		void setDuration(int32_t time);
 	
 		void decreaseDuration(int32_t time) {
 			increaseIntAttr(ITEM_ATTRIBUTE_DURATION, -time);
@@ -844,10 +865,31 @@ class Item : virtual public Thing, public SharedObject
 			if (!attributes) {
 				return 0;
 			}
+
+			// while waiting in the decay wheel only the expiry is kept up to date
+			if (hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
+				return std::max<int64_t>(0, getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP) - OTSYS_TIME());
+			}
 			return getIntAttr(ITEM_ATTRIBUTE_DURATION);
 		}
 
+		void setDurationTimestamp(int64_t timestamp) {
+			setIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP, timestamp);
+		}
+
+		int64_t getDurationTimestamp() const {
+			if (!attributes) {
+				return 0;
+			}
+			return getIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
+		}
+
 		void setDecaying(ItemDecayState_t decayState) {
+			if (decayState != DECAYING_TRUE && hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
+				// stopped early, keep whatever time was left
+				setIntAttr(ITEM_ATTRIBUTE_DURATION, getDuration());
+				removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
+			}
 			setIntAttr(ITEM_ATTRIBUTE_DECAYSTATE, decayState);
 		}
 	
@@ -1108,6 +1150,8 @@ class Item : virtual public Thing, public SharedObject
 		void setSubType(uint16_t n);
 
 		void setUniqueId(uint16_t n);
+		// marks the tile the item lies on as one with a move event for it
+		void flagMoveEventTile();
 
 		void setDefaultDuration() {
 			uint32_t duration = getDefaultDuration();
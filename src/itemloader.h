@@ -4,7 +4,7 @@
 #ifndef FS_ITEMLOADER_H
 #define FS_ITEMLOADER_H
 
-enum itemgroup_t {
+enum itemgroup_t : uint8_t {
 	ITEM_GROUP_NONE,
 
 	ITEM_GROUP_GROUND,
@@ -7,13 +7,19 @@
 #include "spells.h"
 #include "movement.h"
 #include "weapons.h"
+#include "configmanager.h"
+#include "thinkpool.h"
+#include "tasks.h"
 
 #include <toml++/toml.hpp>
 #include <filesystem>
+#include <fmt/format.h>
 #include "tools.h"
 
 extern MoveEvents* g_moveEvents;
 extern Weapons* g_weapons;
+extern ConfigManager g_config;
+extern Dispatcher g_dispatcher;
 
 gtl::flat_hash_map<uint32_t, SkillRegistry> item_skills;
 gtl::flat_hash_map<uint32_t, ItemBuff> item_buffs, item_debuffs;
@@ -241,7 +247,6 @@ static std::optional<ItemBuff> getItemDebuff(uint32_t item_id)
 Items::Items()
 {
 	items.reserve(30000);
-	nameToItems.reserve(30000);
 }
 
 void Items::clear()
@@ -253,6 +258,70 @@ void Items::clear()
 	inventory.clear();
 }
 
+void Items::applyExtras()
+{
+	for (const auto& [id, result] : pendingExtras) {
+		for (const auto& [name, skill] : result.skills) {
+			addItemSkill(id, name, skill);
+		}
+		for (const ItemBuff& buff : result.buffs) {
+			addItemBuff(id, buff);
+		}
+		for (const ItemBuff& debuff : result.debuffs) {
+			addItemDebuff(id, debuff);
+		}
+	}
+	pendingExtras.clear();
+}
+
+void Items::swap(Items& other)
+{
+	std::swap(items, other.items);
+	std::swap(nameToItems, other.nameToItems);
+	std::swap(inventory, other.inventory);
+	std::swap(clientIdToServerIdMap, other.clientIdToServerIdMap);
+	std::swap(currencyItems, other.currencyItems);
+	std::swap(pendingExtras, other.pendingExtras);
+	std::swap(majorVersion, other.majorVersion);
+	std::swap(minorVersion, other.minorVersion);
+	std::swap(buildNumber, other.buildNumber);
+}
+
+bool Items::reloadAsync(std::function<void(bool)> callback)
+{
+	if (reloading) {
+		return false;
+	}
+	reloading = true;
+
+	// nothing but the new instance is touched until it is handed to the dispatcher
+	std::thread([this, callback = std::move(callback)]() {
+		auto next = std::make_shared<Items>();
+		next->deferExtras = true;
+
+		bool loaded = false;
+		try {
+			loaded = next->loadFromOtb("data/items/items.otb") && next->loadFromToml();
+		} catch (const std::exception& e) {
+			std::cout << "[Error - Items::reloadAsync] " << e.what() << std::endl;
+		}
+
+		g_dispatcher.addTask(createTask([this, next, loaded, callback]() {
+			reloading = false;
+			if (loaded) {
+				// between two tasks, no ItemType reference of the old tables is still held
+				swap(*next);
+				applyExtras();
+				g_moveEvents->reload();
+				g_weapons->reload();
+				g_weapons->loadDefaults();
+			}
+			callback(loaded);
+		}));
+	}).detach();
+	return true;
+}
+
 bool Items::reload()
 {
 	clear();
@@ -516,6 +585,20 @@ bool Items::loadFromToml()
         return false;
     }
 
+    const int64_t start = OTSYS_TIME();
+
+    struct Definition
+    {
+        const toml::table* table;
+        uint16_t id;
+        ItemTomlResult result;
+    };
+
+    // the tables stay alive until every definition read from them is parsed
+    std::vector<toml::table> files;
+    std::vector<Definition> definitions;
+    uint16_t maxId = 0;
+
     bool success = true;
     for (const auto& entry : fs::directory_iterator(itemsDir)) {
         if (entry.path().extension() != ".toml") {
@@ -523,7 +606,7 @@ bool Items::loadFromToml()
         }
 
         try {
-            toml::table tbl = toml::parse_file(entry.path().string());
+            const toml::table& tbl = files.emplace_back(toml::parse_file(entry.path().string()));
             auto itemsArray = tbl["items"].as_array(); // Changed from "item" to "items"
             if (!itemsArray) {
                 std::cout << "[Warning - Items::loadFromToml] No 'items' array in " << entry.path() << std::endl;
@@ -539,7 +622,8 @@ bool Items::loadFromToml()
                 const toml::table& itemTable = *item.as_table();
                 if (auto idNode = itemTable["id"]) {
                     uint16_t id = static_cast<uint16_t>(idNode.as_integer()->get());
-                    parseItemToml(itemTable, id);
+                    definitions.emplace_back(&itemTable, id);
+                    maxId = std::max(maxId, id);
                 } else if (auto fromIdNode = itemTable["fromid"], toIdNode = itemTable["toid"]; fromIdNode && toIdNode) {
                     uint16_t fromId = static_cast<uint16_t>(fromIdNode.as_integer()->get());
                     uint16_t toId = static_cast<uint16_t>(toIdNode.as_integer()->get());
@@ -547,9 +631,10 @@ bool Items::loadFromToml()
                         std::cout << "[Warning - Items::loadFromToml] fromid (" << fromId << ") > toid (" << toId << ") in " << entry.path() << std::endl;
                         continue;
                     }
-                    for (uint16_t id = fromId; id <= toId; ++id) {
-                        parseItemToml(itemTable, id);
+                    for (uint32_t id = fromId; id <= toId; ++id) {
+                        definitions.emplace_back(&itemTable, static_cast<uint16_t>(id));
                     }
+                    maxId = std::max(maxId, toId);
                 } else {
                     std::cout << "[Warning - Items::loadFromToml] Missing id or fromid/toid in " << entry.path() << std::endl;
                 }
@@ -564,10 +649,73 @@ bool Items::loadFromToml()
         return false;
     }
 
+    if (!definitions.empty() && maxId >= items.size()) {
+        items.resize(maxId + 1);
+    }
+
+    // every definition of an id lands in the same bucket, in file order, so the
+    // buckets never share an ItemType and see duplicates just like one pass would
+    static constexpr size_t ITEM_TOML_BUCKETS = 256;
+    std::vector<std::vector<Definition*>> buckets(ITEM_TOML_BUCKETS);
+    for (Definition& definition : definitions) {
+        buckets[definition.id % ITEM_TOML_BUCKETS].push_back(&definition);
+    }
+
+    ThinkPool pool;
+    pool.start(std::max<int32_t>(0, g_config.getNumber(ConfigManager::ITEM_LOAD_THREADS)));
+    pool.parallelFor(buckets.size(), [&](size_t i) {
+        for (Definition* definition : buckets[i]) {
+            parseItemToml(*definition->table, definition->id, definition->result);
+        }
+    });
+    pool.shutdown();
+
+    for (Definition& definition : definitions) {
+        ItemTomlResult& result = definition.result;
+        if (!result.warnings.empty()) {
+            std::cout << result.warnings << std::flush;
+        }
+
+        if (result.worth != 0) {
+            if (currencyItems.emplace(result.worth, definition.id).second) {
+                items[definition.id].worth = result.worth;
+            } else {
+                std::cout << "[Warning - Items::parseItemToml] Duplicate currency worth " << result.worth << " for item " << definition.id << std::endl;
+            }
+        }
+    }
+
+    std::cout << "> Loaded " << definitions.size() << " item definitions in: " << (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
+
+    // the skills and buffs are kept apart from the item types, a reload adds them once it swaps in
+    for (Definition& definition : definitions) {
+        ItemTomlResult& result = definition.result;
+        if (!result.skills.empty() || !result.buffs.empty() || !result.debuffs.empty()) {
+            pendingExtras.emplace_back(definition.id, std::move(result));
+        }
+    }
+    if (!deferExtras) {
+        applyExtras();
+    }
+
     buildInventoryList();
+    buildNameIndex();
     return true;
 }
 
+void Items::buildNameIndex()
+{
+	// from the final names, a duplicate definition may have renamed an item
+	nameToItems.clear();
+	for (const auto& type : items) {
+		if (type.id != 0 && !type.name.empty()) {
+			nameToItems.emplace_back(asLowerCaseString(type.name), type.id);
+		}
+	}
+	std::sort(nameToItems.begin(), nameToItems.end());
+	nameToItems.shrink_to_fit();
+}
+
 void Items::buildInventoryList()
 {
     inventory.clear();
@@ -586,18 +734,14 @@ void Items::buildInventoryList()
     std::sort(inventory.begin(), inventory.end());
 }
 
-void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
+void Items::parseItemToml(const toml::table& itemTable, uint16_t id, ItemTomlResult& result)
 {
-    if (id >= items.size()) {
-        items.resize(id + 1);
-    }
-
     ItemType& it = items[id];
     if (it.id == 0) {
         it.id = id;
     }
     else if (!it.name.empty()) {
-        std::cout << "[Warning - Items::parseItemToml] Duplicate item definition for id: " << id << std::endl;
+        result.warnings += fmt::format("[Warning - Items::parseItemToml] Duplicate item definition for id: {:d}\n", id);
         return;
     }
 
@@ -614,7 +758,6 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
         else if (keyStr == "name") {
             if (value.is_string()) {
                 it.name = value.as_string()->get();
-                nameToItems.emplace(asLowerCaseString(it.name), id);
             }
             continue;
         }
@@ -648,7 +791,7 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
 
                         if (not name.empty()) {
                             auto customSkill = Components::Skills::CustomSkill::make_skill(formula, threshold, difficulty, multiplier);
-                            Items::addItemSkill(id, name, customSkill);
+                            result.skills.emplace_back(name, customSkill);
                             continue;
                         }
                     }
@@ -673,12 +816,12 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
 
                         if (auto buff_type = buffs["type"].as_string()->get() == "debuff")
                         {
-                            addItemDebuff(id, { name, value });
+                            result.debuffs.emplace_back(name, value);
                             continue;
                         }
                         else
                         {
-                            addItemBuff(id, {name, value});
+                            result.buffs.emplace_back(name, value);
                             continue;
                         }
                     }
@@ -689,7 +832,7 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
 
         auto parseAttribute = ItemParseAttributesMap.find(keyStr);
         if (parseAttribute == ItemParseAttributesMap.end()) {
-            std::cout << "[Warning - Items::parseItemToml] Unknown attribute '" << key << "' for item id: " << id << std::endl;
+            result.warnings += fmt::format("[Warning - Items::parseItemToml] Unknown attribute '{:s}' for item id: {:d}\n", key.str(), id);
             continue;
         }
 
@@ -742,7 +885,7 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
             if (value.is_integer()) {
                 it.attackSpeed = static_cast<uint32_t>(value.as_integer()->get());
                 if (it.attackSpeed > 0 && it.attackSpeed < 100) {
-                    std::cout << "[Warning - Items::parseItemToml] AttackSpeed < 100 for item " << id << ", setting to 100" << std::endl;
+                    result.warnings += fmt::format("[Warning - Items::parseItemToml] AttackSpeed < 100 for item {:d}, setting to 100\n", id);
                     it.attackSpeed = 100;
                 }
             }
@@ -1100,7 +1243,7 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
 
                     if (damage != 0) {
                         if (start > 0) {
-                            std::list<int32_t> damageList;
+                            std::vector<int32_t> damageList;
                             ConditionDamage::generateDamageList(damage, start, damageList);
                             for (int32_t damageValue : damageList) {
                                 it.conditionDamage->addDamage(1, ticks, -damageValue);
@@ -1206,13 +1349,8 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
 
         case ITEM_PARSE_WORTH:
             if (value.is_integer()) {
-                uint64_t worth = static_cast<uint64_t>(value.as_integer()->get());
-                if (currencyItems.emplace(worth, id).second) {
-                    it.worth = worth;
-                }
-                else {
-                    std::cout << "[Warning - Items::parseItemToml] Duplicate currency worth " << worth << " for item " << id << std::endl;
-                }
+                // currencies are claimed in file order once all items are parsed
+                result.worth = static_cast<uint64_t>(value.as_integer()->get());
             }
             break;
 
@@ -1234,7 +1372,7 @@ void Items::parseItemToml(const toml::table& itemTable, uint16_t id)
 
     // Validate transform attributes for non-bed items
     if ((it.transformToFree || it.transformToOnUse[PLAYERSEX_FEMALE] || it.transformToOnUse[PLAYERSEX_MALE]) && it.type != ITEM_TYPE_BED) {
-        std::cout << "[Warning - Items::parseItemToml] Item " << id << " has transform attributes but is not a bed" << std::endl;
+        result.warnings += fmt::format("[Warning - Items::parseItemToml] Item {:d} has transform attributes but is not a bed\n", id);
     }
 }
 
@@ -1264,12 +1402,40 @@ const ItemType& Items::getItemIdByClientId(uint16_t spriteId) const
 	return items.front();
 }
 
-uint16_t Items::getItemIdByName(const std::string& name)
+namespace {
+
+// lowers both sides as they are compared, the keys are lowercase already but the
+// name looked for is not, as unsigned chars like the std::string compare the keys
+// are sorted by
+struct NameLess
 {
-	auto result = nameToItems.find(asLowerCaseString(name));
+	static bool less(std::string_view lhs, std::string_view rhs) {
+		return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+			return static_cast<unsigned char>(tolower(a)) < static_cast<unsigned char>(tolower(b));
+		});
+	}
 
-	if (result == nameToItems.end())
+	bool operator()(const Items::NameMap::value_type& entry, std::string_view name) const {
+		return less(entry.first, name);
+	}
+
+	bool operator()(std::string_view name, const Items::NameMap::value_type& entry) const {
+		return less(name, entry.first);
+	}
+};
+
+}
+
+uint16_t Items::getItemIdByName(std::string_view name) const
+{
+	auto [first, last] = getItemIdsByName(name);
+	if (first == last) {
 		return 0;
+	}
+	return first->second;
+}
 
-	return result->second;
+Items::NameRange Items::getItemIdsByName(std::string_view name) const
+{
+	return std::equal_range(nameToItems.begin(), nameToItems.end(), name, NameLess{});
 }
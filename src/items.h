@@ -38,7 +38,7 @@ enum SlotPositionBits : uint32_t {
 	SLOTP_HAND = (SLOTP_LEFT | SLOTP_RIGHT)
 };
 
-enum ItemTypes_t {
+enum ItemTypes_t : uint8_t {
 	ITEM_TYPE_NONE,
 	ITEM_TYPE_DEPOT,
 	ITEM_TYPE_MAILBOX,
@@ -297,12 +297,65 @@ class ItemType
 			return str;
 		}
 
+		// looked at whenever a tile, a move or a fight checks an item, kept
+		// together at the front so those checks touch one or two cache lines
 		itemgroup_t group = ITEM_GROUP_NONE;
 		ItemTypes_t type = ITEM_TYPE_NONE;
 		uint16_t id = 0;
 		uint16_t clientId = 0;
+		uint8_t floorChange = 0;
+		uint8_t alwaysOnTopOrder = 0;
+		uint8_t lightLevel = 0;
+		uint8_t lightColor = 0;
+
 		bool stackable = false;
 		bool isAnimation = false;
+		bool forceUse = false;
+		bool forceSerialize = false;
+		bool hasHeight = false;
+		bool walkStack = true;
+		bool blockSolid = false;
+		bool blockPickupable = false;
+		bool blockProjectile = false;
+		bool blockPathFind = false;
+		bool allowPickupable = false;
+		bool pickupable = false;
+		bool rotatable = false;
+		bool useable = false;
+		bool moveable = false;
+		bool alwaysOnTop = false;
+		bool isVertical = false;
+		bool isHorizontal = false;
+		bool isHangable = false;
+		bool lookThrough = false;
+		bool stopTime = false;
+		bool showCount = true;
+		bool storeItem = false;
+		bool replaceable = true;
+
+		uint32_t weight = 0;
+		uint32_t charges = 0;
+		uint32_t decayTime = 0;
+		int32_t decayTo = -1;
+		uint16_t slotPosition = SLOTP_HAND;
+		uint16_t maxItems = 8;
+
+		WeaponType_t weaponType = WEAPON_NONE;
+		Ammo_t ammoType = AMMO_NONE;
+		ShootType_t shootType = CONST_ANI_NONE;
+		uint8_t shootRange = 1;
+		int8_t hitChance = 0;
+		int32_t maxHitChance = -1;
+		int32_t attack = 0;
+		int32_t defense = 0;
+		int32_t extraDefense = 0;
+		int32_t armor = 0;
+		uint32_t attackSpeed = 0;
+		CombatType_t combatType = COMBAT_NONE;
+
+		std::unique_ptr<Abilities> abilities;
+
+		// the rest is for descriptions, scripts and loading
 
 		std::string name;
 		std::string article;
@@ -313,31 +366,18 @@ class ItemType
 		std::string runeSpellName;
 		std::string vocationString;
 
-		std::unique_ptr<Abilities> abilities;
 		std::unique_ptr<ConditionDamage> conditionDamage;
 		std::unordered_set<std::string> augments;
 
-		uint32_t attackSpeed = 0;
-		uint32_t weight = 0;
 		uint32_t levelDoor = 0;
-		uint32_t decayTime = 0;
 		uint32_t wieldInfo = 0;
 		uint32_t minReqLevel = 0;
 		uint32_t minReqMagicLevel = 0;
-		uint32_t charges = 0;
-		int32_t maxHitChance = -1;
-		int32_t decayTo = -1;
-		int32_t attack = 0;
-		int32_t defense = 0;
-		int32_t extraDefense = 0;
-		int32_t armor = 0;
 		uint16_t rotateTo = 0;
 		int32_t runeMagLevel = 0;
 		int32_t runeLevel = 0;
 		uint64_t worth = 0;
 
-		CombatType_t combatType = COMBAT_NONE;
-
 		uint16_t transformToOnUse[2] = {0, 0};
 		uint16_t transformToFree = 0;
 		uint16_t destroyTo = 0;
@@ -345,8 +385,6 @@ class ItemType
 		uint16_t writeOnceItemId = 0;
 		uint16_t transformEquipTo = 0;
 		uint16_t transformDeEquipTo = 0;
-		uint16_t maxItems = 8;
-		uint16_t slotPosition = SLOTP_HAND;
 		uint16_t equipSlot = SLOTP_HAND;
 		uint16_t speed = 0;
 		uint16_t wareId = 0;
@@ -354,53 +392,23 @@ class ItemType
 
 		MagicEffectClasses magicEffect = CONST_ME_NONE;
 		Direction bedPartnerDir = DIRECTION_NONE;
-		WeaponType_t weaponType = WEAPON_NONE;
-		Ammo_t ammoType = AMMO_NONE;
-		ShootType_t shootType = CONST_ANI_NONE;
 		RaceType_t corpseType = RACE_NONE;
 		FluidTypes_t fluidSource = FLUID_NONE;
 
-		uint8_t floorChange = 0;
-		uint8_t alwaysOnTopOrder = 0;
-		uint8_t lightLevel = 0;
-		uint8_t lightColor = 0;
-		uint8_t shootRange = 1;
-		int8_t hitChance = 0;
-
-		bool storeItem = false;
-		bool forceUse = false;
-		bool forceSerialize = false;
-		bool hasHeight = false;
-		bool walkStack = true;
-		bool blockSolid = false;
-		bool blockPickupable = false;
-		bool blockProjectile = false;
-		bool blockPathFind = false;
-		bool allowPickupable = false;
 		bool showDuration = false;
 		bool showCharges = false;
 		bool showAttributes = true;
-		bool replaceable = true;
-		bool pickupable = false;
-		bool rotatable = false;
-		bool useable = false;
-		bool moveable = false;
-		bool alwaysOnTop = false;
 		bool canReadText = false;
 		bool canWriteText = false;
-		bool isVertical = false;
-		bool isHorizontal = false;
-		bool isHangable = false;
 		bool allowDistRead = false;
-		bool lookThrough = false;
-		bool stopTime = false;
-		bool showCount = true;
 };
 
 class Items
 {
 	public:
-		using NameMap = std::unordered_multimap<std::string, uint16_t>;
+		// lowercase names with their ids, sorted by name and then id
+		using NameMap = std::vector<std::pair<std::string, uint16_t>>;
+		using NameRange = std::pair<NameMap::const_iterator, NameMap::const_iterator>;
 		using InventoryVector = std::vector<uint16_t>;
 
 		using CurrencyMap = std::map<uint64_t, uint16_t, std::greater<uint64_t>>;
@@ -416,6 +424,9 @@ class Items
 		Items& operator=(const Items&) = delete;
 
 		bool reload();
+		// reads the item files on a thread of its own and swaps them in on the dispatcher,
+		// callback is told whether that worked, false if a reload is already running
+		bool reloadAsync(std::function<void(bool)> callback);
 		void clear();
 
 		bool loadFromOtb(const std::string& file);
@@ -428,14 +439,16 @@ class Items
 		ItemType& getItemType(size_t id);
 		const ItemType& getItemIdByClientId(uint16_t spriteId) const;
 
-		uint16_t getItemIdByName(const std::string& name);
+		// name in any case, the lowest id when several items share it
+		uint16_t getItemIdByName(std::string_view name) const;
+		// every item called name in any case, lowest id first
+		NameRange getItemIdsByName(std::string_view name) const;
 
 		uint32_t majorVersion = 0;
 		uint32_t minorVersion = 0;
 		uint32_t buildNumber = 0;
 
 		bool loadFromToml();
-		void parseItemToml(const toml::table& itemTable, uint16_t id);
 
 		void buildInventoryList();
 	
@@ -447,11 +460,34 @@ class Items
 			return items.size();
 		}
 
-		NameMap nameToItems;
 		CurrencyMap currencyItems;
 
 	private:
+		// what parsing one item definition changes besides its own ItemType,
+		// applied in file order once every definition is parsed
+		struct ItemTomlResult
+		{
+			std::vector<std::pair<std::string, std::shared_ptr<CustomSkill>>> skills;
+			std::vector<ItemBuff> buffs;
+			std::vector<ItemBuff> debuffs;
+			std::string warnings;
+			uint64_t worth = 0;
+		};
+
+		// items already holds id, only the ItemType of id is written to
+		void parseItemToml(const toml::table& itemTable, uint16_t id, ItemTomlResult& result);
+		void buildNameIndex();
+		// hands the skills and buffs of the items to their tables, which the instances share
+		void applyExtras();
+		void swap(Items& other);
+
+		std::vector<std::pair<uint16_t, ItemTomlResult>> pendingExtras;
+		// a reload fills a second instance, which keeps its skills and buffs until it is swapped in
+		bool deferExtras = false;
+		bool reloading = false;
+
 		std::vector<ItemType> items;
+		NameMap nameToItems;
 		InventoryVector inventory;
 		class ClientIdToServerIdMap
 		{
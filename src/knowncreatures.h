@@ -0,0 +1,72 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_KNOWNCREATURES_H
+#define FS_KNOWNCREATURES_H
+
+#include <gtl/phmap.hpp>
+
+// how many creatures the client keeps, it is told which one to forget beyond that
+static constexpr size_t KNOWN_CREATURES_MAX = 1300;
+
+// The creatures a client has been sent. Entries sit on a clock: a lookup
+// marks its entry as used, and evicting a creature to make room clears the
+// marks under the hand until it finds one that was neither used since the
+// last pass nor is still in use, so a slot is found in amortised constant time.
+class KnownCreatureList
+{
+	public:
+		// true if id was already known, otherwise it is added and removed is
+		// set to the creature the client must forget, 0 for none
+		template <typename InUse>
+		bool checkKnown(uint32_t id, uint32_t& removed, InUse&& inUse) {
+			if (const auto it = slots.find(id); it != slots.end()) {
+				entries[it->second].used = true;
+				return true;
+			}
+
+			removed = 0;
+			if (entries.size() < KNOWN_CREATURES_MAX) {
+				slots.emplace(id, entries.size());
+				entries.push_back({id, true});
+				return false;
+			}
+
+			// two passes clear every mark, after that anyone goes
+			size_t slot = hand;
+			for (size_t i = 0; i < entries.size() * 2; ++i, slot = next(slot)) {
+				Entry& entry = entries[slot];
+				if (entry.used) {
+					entry.used = false;
+				} else if (inUse(entry.id)) {
+					entry.used = true;
+				} else {
+					break;
+				}
+			}
+
+			removed = entries[slot].id;
+			slots.erase(removed);
+			slots.emplace(id, slot);
+			entries[slot] = {id, true};
+			hand = next(slot);
+			return false;
+		}
+
+	private:
+		struct Entry
+		{
+			uint32_t id;
+			bool used;
+		};
+
+		size_t next(size_t slot) const {
+			return slot + 1 < entries.size() ? slot + 1 : 0;
+		}
+
+		gtl::flat_hash_map<uint32_t, size_t> slots;
+		std::vector<Entry> entries;
+		size_t hand = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "logwriter.h"
+#include "threadrole.h"
+
+#include <fstream>
+
+LogWriter g_logWriter;
+
+void LogWriter::write(std::string file, std::string text)
+{
+	std::unique_lock<std::mutex> lockGuard(recordLock);
+	if (getState() != THREAD_STATE_RUNNING) {
+		lockGuard.unlock();
+		std::vector<Record> batch;
+		batch.push_back({std::move(file), std::move(text)});
+		writeBatch(batch);
+		return;
+	}
+
+	const bool wasEmpty = records.empty();
+	records.push_back({std::move(file), std::move(text)});
+	if (wasEmpty) {
+		recordSignal.notify_one();
+	}
+}
+
+void LogWriter::shutdown()
+{
+	std::lock_guard<std::mutex> lockGuard(recordLock);
+	setState(THREAD_STATE_TERMINATED);
+	recordSignal.notify_one();
+}
+
+void LogWriter::threadMain()
+{
+	setThreadRole("log writer");
+	std::vector<Record> batch;
+	std::unique_lock<std::mutex> lockGuard(recordLock);
+	while (true) {
+		recordSignal.wait(lockGuard, [this]() { return !records.empty() || getState() == THREAD_STATE_TERMINATED; });
+		if (records.empty()) {
+			break;
+		}
+
+		batch.swap(records);
+		lockGuard.unlock();
+		writeBatch(batch);
+		batch.clear();
+		lockGuard.lock();
+	}
+}
+
+void LogWriter::writeBatch(std::vector<Record>& batch)
+{
+	// grouped by file, the records of one file keep their order
+	std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) { return a.file < b.file; });
+
+	std::ofstream out;
+	const std::string* current = nullptr;
+	for (const Record& record : batch) {
+		if (!current || *current != record.file) {
+			out.close();
+			out.clear();
+			current = &record.file;
+			out.open(record.file, std::ios::app);
+			if (!out) {
+				std::cout << "[Warning - LogWriter::writeBatch] Can not open " << record.file << " for writing." << std::endl;
+			}
+		}
+
+		if (out) {
+			out << record.text;
+		}
+	}
+}
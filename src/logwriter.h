@@ -0,0 +1,46 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_LOGWRITER_H
+#define FS_LOGWRITER_H
+
+#include "thread_holder_base.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Appends text to log files on a thread of its own, so chat, command and
+// report logs never wait on the disk. Records are taken in batches, each
+// file of a batch is opened once and gets its records in the order they
+// were added. Before the thread starts and once it is shut down, records are
+// written right away by the caller.
+class LogWriter : public ThreadHolder<LogWriter>
+{
+	public:
+		// any thread
+		void write(std::string file, std::string text);
+
+		// writes what is queued and stops the thread
+		void shutdown();
+
+		void threadMain();
+
+	private:
+		struct Record
+		{
+			std::string file;
+			std::string text;
+		};
+
+		static void writeBatch(std::vector<Record>& batch);
+
+		std::mutex recordLock;
+		std::condition_variable recordSignal;
+		std::vector<Record> records;
+};
+
+extern LogWriter g_logWriter;
+
+#endif
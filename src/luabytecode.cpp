@@ -0,0 +1,183 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "luabytecode.h"
+#include "luascript.h"
+
+#include <fmt/format.h>
+#include <fstream>
+
+LuaBytecodeCache g_luaBytecodeCache;
+
+namespace {
+
+constexpr char CACHE_DIRECTORY[] = "data/cache/lua";
+constexpr char CACHE_MAGIC[4] = {'B', 'T', 'L', 'C'};
+
+// the layout of a cache file and the Lua that wrote it, files of another are compiled again
+#ifdef LUAJIT_VERSION
+constexpr uint32_t CACHE_VERSION = (1 << 16) | 0x8000 | LUA_VERSION_NUM;
+#else
+constexpr uint32_t CACHE_VERSION = (1 << 16) | LUA_VERSION_NUM;
+#endif
+
+uint64_t hashBytes(std::string_view bytes)
+{
+	// fnv-1a
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (const char c : bytes) {
+		hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+int writeChunk(lua_State*, const void* data, size_t size, void* userdata)
+{
+	static_cast<std::string*>(userdata)->append(static_cast<const char*>(data), size);
+	return 0;
+}
+
+bool readSource(const std::string& file, std::string& source)
+{
+	std::ifstream in(file, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	source.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return !in.bad();
+}
+
+}
+
+int LuaBytecodeCache::load(lua_State* L, const std::string& file, bool& cached)
+{
+	cached = false;
+
+	std::error_code ec;
+	const uint64_t size = std::filesystem::file_size(file, ec);
+	const int64_t modified = ec ? 0 : std::filesystem::last_write_time(file, ec).time_since_epoch().count();
+	if (ec) {
+		// luaL_loadfile tells why it can not be read
+		return luaL_loadfile(L, file.c_str());
+	}
+
+	auto it = entries.find(file);
+	if (it == entries.end()) {
+		// first load of this run, an earlier one may have left the chunk behind
+		it = entries.emplace(file, Entry{}).first;
+		readCacheFile(getCacheFile(file), it->second);
+	}
+
+	Entry& entry = it->second;
+	const std::string chunkName = '@' + file;
+	const auto loadEntry = [&]() {
+		if (entry.bytecode.empty()) {
+			return false;
+		}
+
+		if (luaL_loadbuffer(L, entry.bytecode.data(), entry.bytecode.size(), chunkName.c_str()) != 0) {
+			lua_pop(L, 1);
+			return false;
+		}
+		cached = true;
+		return true;
+	};
+
+	if (entry.size == size && entry.modified == modified && loadEntry()) {
+		return 0;
+	}
+
+	std::string source;
+	if (!readSource(file, source) || source.starts_with('#') || source.starts_with("\xEF\xBB\xBF")) {
+		// luaL_loadfile skips a first comment line and the byte order mark, leave those files to it
+		entries.erase(it);
+		return luaL_loadfile(L, file.c_str());
+	}
+
+	const uint64_t hash = hashBytes(source);
+	if (entry.hash == hash && loadEntry()) {
+		// only touched, the new time spares hashing it next time
+		entry.size = size;
+		entry.modified = modified;
+		writeCacheFile(getCacheFile(file), entry);
+		return 0;
+	}
+
+	const int ret = luaL_loadbuffer(L, source.data(), source.size(), chunkName.c_str());
+	if (ret != 0) {
+		entries.erase(it);
+		return ret;
+	}
+
+	entry = Entry{modified, size, hash, {}};
+	// debug information stays, errors keep pointing at lines of the source
+#if LUA_VERSION_NUM >= 503
+	lua_dump(L, writeChunk, &entry.bytecode, 0);
+#else
+	lua_dump(L, writeChunk, &entry.bytecode);
+#endif
+	writeCacheFile(getCacheFile(file), entry);
+	return 0;
+}
+
+std::filesystem::path LuaBytecodeCache::getCacheFile(const std::string& file)
+{
+	return std::filesystem::path(CACHE_DIRECTORY) / fmt::format("{:016x}.luac", hashBytes(file));
+}
+
+bool LuaBytecodeCache::readCacheFile(const std::filesystem::path& cacheFile, Entry& entry)
+{
+	std::ifstream in(cacheFile, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	char magic[sizeof(CACHE_MAGIC)];
+	uint32_t version;
+	Entry read;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	in.read(reinterpret_cast<char*>(&read.modified), sizeof(read.modified));
+	in.read(reinterpret_cast<char*>(&read.size), sizeof(read.size));
+	in.read(reinterpret_cast<char*>(&read.hash), sizeof(read.hash));
+	if (!in || !std::equal(magic, magic + sizeof(magic), CACHE_MAGIC) || version != CACHE_VERSION) {
+		return false;
+	}
+
+	read.bytecode.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	if (in.bad()) {
+		return false;
+	}
+
+	entry = std::move(read);
+	return true;
+}
+
+void LuaBytecodeCache::writeCacheFile(const std::filesystem::path& cacheFile, const Entry& entry)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(cacheFile.parent_path(), ec);
+
+	// written next to the cache file and moved over it, a crash never leaves half a chunk behind
+	const std::filesystem::path temporaryFile = cacheFile.string() + ".tmp";
+	{
+		std::ofstream out(temporaryFile, std::ios::binary | std::ios::trunc);
+		out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		out.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+		out.write(reinterpret_cast<const char*>(&entry.modified), sizeof(entry.modified));
+		out.write(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
+		out.write(reinterpret_cast<const char*>(&entry.hash), sizeof(entry.hash));
+		if (!out || !out.write(entry.bytecode.data(), entry.bytecode.size())) {
+			std::cout << "[Warning - LuaBytecodeCache::writeCacheFile] Could not write " << temporaryFile << '.' << std::endl;
+			return;
+		}
+	}
+
+	std::filesystem::rename(temporaryFile, cacheFile, ec);
+	if (ec) {
+		std::cout << "[Warning - LuaBytecodeCache::writeCacheFile] Could not replace " << cacheFile << ": " << ec.message() << std::endl;
+	}
+}
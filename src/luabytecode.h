@@ -0,0 +1,40 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_LUABYTECODE_H
+#define FS_LUABYTECODE_H
+
+#include <filesystem>
+#include <gtl/phmap.hpp>
+
+struct lua_State;
+
+// Keeps the compiled chunks of the script files, so a start or a /reload does
+// not parse the files that did not change again. The chunks are remembered in
+// memory and in data/cache/lua, keyed by the size and modification time of the
+// source or, when only those moved, its hash. Bytecode the running Lua does
+// not accept is compiled again from the source.
+class LuaBytecodeCache
+{
+	public:
+		// pushes the chunk of file like luaL_loadfile, cached tells whether it was compiled before
+		int load(lua_State* L, const std::string& file, bool& cached);
+
+	private:
+		struct Entry {
+			int64_t modified = 0;
+			uint64_t size = 0;
+			uint64_t hash = 0;
+			std::string bytecode;
+		};
+
+		static std::filesystem::path getCacheFile(const std::string& file);
+		static bool readCacheFile(const std::filesystem::path& cacheFile, Entry& entry);
+		static void writeCacheFile(const std::filesystem::path& cacheFile, const Entry& entry);
+
+		gtl::flat_hash_map<std::string, Entry> entries;
+};
+
+extern LuaBytecodeCache g_luaBytecodeCache;
+
+#endif
@@ -0,0 +1,86 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "luaffi.h"
+
+#ifdef LUAJIT_FFI
+
+#include "player.h"
+#include "item.h"
+
+namespace {
+
+template<class T>
+const T* getFfiObject(const void* userdata)
+{
+	if (!userdata) {
+		return nullptr;
+	}
+	return static_cast<const std::shared_ptr<T>*>(userdata)->get();
+}
+
+}
+
+bool blacktek_creature_get_position(const void* creature, BlackTekPosition* position)
+{
+	const Creature* object = getFfiObject<Creature>(creature);
+	if (!object) {
+		return false;
+	}
+
+	const Position& pos = object->getPosition();
+	position->x = pos.x;
+	position->y = pos.y;
+	position->z = pos.z;
+	return true;
+}
+
+bool blacktek_creature_get_health(const void* creature, int32_t* health)
+{
+	const Creature* object = getFfiObject<Creature>(creature);
+	if (!object) {
+		return false;
+	}
+
+	*health = object->getHealth();
+	return true;
+}
+
+bool blacktek_creature_get_max_health(const void* creature, int32_t* health)
+{
+	const Creature* object = getFfiObject<Creature>(creature);
+	if (!object) {
+		return false;
+	}
+
+	*health = object->getMaxHealth();
+	return true;
+}
+
+bool blacktek_player_get_storage_value(const void* player, uint32_t key, int32_t* value)
+{
+	const Player* object = getFfiObject<Player>(player);
+	if (!object) {
+		return false;
+	}
+
+	if (!object->getStorageValue(key, *value)) {
+		*value = -1;
+	}
+	return true;
+}
+
+bool blacktek_item_get_id(const void* item, uint16_t* id)
+{
+	const Item* object = getFfiObject<Item>(item);
+	if (!object) {
+		return false;
+	}
+
+	*id = object->getID();
+	return true;
+}
+
+#endif
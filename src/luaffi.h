@@ -0,0 +1,36 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_LUAFFI_H
+#define FS_LUAFFI_H
+
+// Plain C accessors for the methods scripts call the most, built with the
+// luajit-ffi premake option. data/lib/core/ffi.lua declares them to the LuaJIT
+// FFI and puts them in place of the matching Lua C functions, which LuaJIT
+// can not compile into its traces. They take the userdata of the object as
+// it is, the same shared_ptr getSharedPtr reads, and return false when it
+// holds no object. The declarations in ffi.lua must match these.
+#ifdef LUAJIT_FFI
+
+#ifdef _WIN32
+#define BLACKTEK_FFI extern "C" __declspec(dllexport)
+#else
+#define BLACKTEK_FFI extern "C" __attribute__((visibility("default"), used))
+#endif
+
+struct BlackTekPosition
+{
+	uint16_t x;
+	uint16_t y;
+	uint8_t z;
+};
+
+BLACKTEK_FFI bool blacktek_creature_get_position(const void* creature, BlackTekPosition* position);
+BLACKTEK_FFI bool blacktek_creature_get_health(const void* creature, int32_t* health);
+BLACKTEK_FFI bool blacktek_creature_get_max_health(const void* creature, int32_t* health);
+BLACKTEK_FFI bool blacktek_player_get_storage_value(const void* player, uint32_t key, int32_t* value);
+BLACKTEK_FFI bool blacktek_item_get_id(const void* item, uint16_t* id);
+
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "luaprofiler.h"
+#include "luascript.h"
+
+#include <fmt/chrono.h>
+#include <fstream>
+
+LuaProfiler g_luaProfiler;
+
+void LuaProfiler::start(lua_State* L)
+{
+	if (isRunning() || !L) {
+		return;
+	}
+
+	calls.clear();
+	stacks.clear();
+	running.clear();
+	started = std::chrono::steady_clock::now();
+	luaState = L;
+	lua_sethook(L, hook, LUA_MASKCOUNT, SAMPLE_INSTRUCTIONS);
+}
+
+std::string LuaProfiler::stop()
+{
+	if (!isRunning()) {
+		return {};
+	}
+
+	lua_sethook(luaState, nullptr, 0, 0);
+	luaState = nullptr;
+	running.clear();
+
+	const std::string name = fmt::format("data/logs/lua-profile-{:%Y%m%d-%H%M%S}", fmt::localtime(time(nullptr)));
+	const std::string stacksFile = name + ".folded";
+	std::ofstream stacksOut(stacksFile, std::ios::trunc);
+	if (!stacksOut) {
+		std::cout << "[Warning - LuaProfiler::stop] Can not open " << stacksFile << " for writing." << std::endl;
+		return {};
+	}
+
+	for (const auto& [stack, count] : stacks) {
+		stacksOut << stack << ' ' << count << '\n';
+	}
+
+	std::vector<const std::pair<const std::string, CallStats>*> sorted;
+	sorted.reserve(calls.size());
+	for (const auto& entry : calls) {
+		sorted.push_back(&entry);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const auto* lhs, const auto* rhs) {
+		return lhs->second.total > rhs->second.total;
+	});
+
+	std::ofstream callsOut(name + ".txt", std::ios::trunc);
+	const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+	callsOut << fmt::format("profiled for {:d} ms, the time of a call includes the scripts it calls\n", duration.count());
+	callsOut << fmt::format("{:>12s} {:>10s} {:>10s} {:>10s}  {:s}\n", "total ms", "calls", "avg us", "max us", "script");
+	for (const auto* entry : sorted) {
+		const CallStats& stats = entry->second;
+		callsOut << fmt::format("{:>12.3f} {:>10d} {:>10.1f} {:>10.1f}  {:s}\n",
+			stats.total.count() / 1e6, stats.calls, stats.total.count() / 1e3 / stats.calls, stats.longest.count() / 1e3, entry->first);
+	}
+	return stacksFile;
+}
+
+void LuaProfiler::enterCall(const std::string& file)
+{
+	running.push_back({&*calls.try_emplace(file).first, std::chrono::steady_clock::now()});
+}
+
+void LuaProfiler::leaveCall()
+{
+	// stop may have been called by the script that just returned
+	if (running.empty()) {
+		return;
+	}
+
+	const RunningCall call = running.back();
+	running.pop_back();
+
+	CallStats& stats = call.entry->second;
+	const auto elapsed = std::chrono::steady_clock::now() - call.start;
+	++stats.calls;
+	stats.total += elapsed;
+	stats.longest = std::max<std::chrono::nanoseconds>(stats.longest, elapsed);
+}
+
+void LuaProfiler::hook(lua_State* L, lua_Debug*)
+{
+	g_luaProfiler.sample(L);
+}
+
+void LuaProfiler::sample(lua_State* L)
+{
+	// frames are collected innermost first, folded stacks list them outermost first
+	std::vector<std::string> frames;
+	lua_Debug ar;
+	for (int level = 0; lua_getstack(L, level, &ar) != 0; ++level) {
+		if (lua_getinfo(L, "Sn", &ar) == 0) {
+			break;
+		}
+
+		std::string frame;
+		if (ar.what && std::strcmp(ar.what, "C") == 0) {
+			frame = "[C]";
+		} else {
+			frame = fmt::format("{:s}:{:d}", ar.short_src, ar.linedefined);
+		}
+		if (ar.name) {
+			frame = fmt::format("{:s} {:s}", ar.name, frame);
+		}
+		std::replace(frame.begin(), frame.end(), ';', ':');
+		frames.push_back(std::move(frame));
+	}
+
+	std::string stack = running.empty() ? "(no script)" : running.back().entry->first;
+	std::replace(stack.begin(), stack.end(), ';', ':');
+	for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+		stack.push_back(';');
+		stack.append(*it);
+	}
+	++stacks[stack];
+}
@@ -0,0 +1,60 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_LUAPROFILER_H
+#define FS_LUAPROFILER_H
+
+#include <chrono>
+
+struct lua_State;
+struct lua_Debug;
+
+// Finds the scripts that keep the dispatcher busy. While running it times
+// every protected call by the script file it belongs to and samples the Lua
+// call stack every SAMPLE_INSTRUCTIONS virtual machine instructions. stop
+// writes both to data/logs: the samples as folded stacks, one
+// "script;frame;frame count" line each, ready for flamegraph.pl or speedscope,
+// and the calls as a table sorted by the time spent in them.
+// Lua only runs on the dispatcher thread, so does the profiler.
+class LuaProfiler
+{
+	public:
+		static constexpr int SAMPLE_INSTRUCTIONS = 1000;
+
+		void start(lua_State* L);
+		// the path of the folded stacks, empty when not running
+		std::string stop();
+
+		bool isRunning() const {
+			return luaState != nullptr;
+		}
+
+		// around every protected call while running, file is the script it runs
+		void enterCall(const std::string& file);
+		void leaveCall();
+
+	private:
+		struct CallStats {
+			uint64_t calls = 0;
+			std::chrono::nanoseconds total{0};
+			std::chrono::nanoseconds longest{0};
+		};
+
+		struct RunningCall {
+			std::pair<const std::string, CallStats>* entry;
+			std::chrono::steady_clock::time_point start;
+		};
+
+		static void hook(lua_State* L, lua_Debug* ar);
+		void sample(lua_State* L);
+
+		std::map<std::string, CallStats> calls;
+		std::map<std::string, uint64_t> stacks;
+		std::vector<RunningCall> running;
+		std::chrono::steady_clock::time_point started;
+		lua_State* luaState = nullptr;
+};
+
+extern LuaProfiler g_luaProfiler;
+
+#endif
@@ -22,6 +22,7 @@
 #include "monster.h"
 #include "scheduler.h"
 #include "databasetasks.h"
+#include "pathfinding.h"
 #include "events.h"
 #include "movement.h"
 #include "globalevent.h"
@@ -30,6 +31,17 @@
 #include "luavariant.h"
 #include "augments.h"
 #include "zones.h"
+#include "luaprofiler.h"
+#include "luaworkers.h"
+#include "luabytecode.h"
+#include "memoryreport.h"
+#include "logwriter.h"
+#include "tickprofiler.h"
+#include "tracing.h"
+#include "querystats.h"
+#include "allocprofiler.h"
+#include "ban.h"
+#include "webhooks.h"
 
 extern Chat* g_chat;
 extern Game g_game;
@@ -256,8 +268,11 @@ std::string LuaScriptInterface::getErrorDesc(ErrorCode_t code)
 ScriptEnvironment LuaScriptInterface::scriptEnv[16];
 int32_t LuaScriptInterface::scriptEnvIndex = -1;
 
+lua_Alloc LuaScriptInterface::defaultAllocator = nullptr;
+
 LuaScriptInterface::LuaScriptInterface(std::string interfaceName) : interfaceName(std::move(interfaceName))
 {
+	getInterfaceList().push_back(this);
 	if (!g_luaEnvironment.getLuaState()) {
 		g_luaEnvironment.initState();
 	}
@@ -266,6 +281,26 @@ LuaScriptInterface::LuaScriptInterface(std::string interfaceName) : interfaceNam
 LuaScriptInterface::~LuaScriptInterface()
 {
 	closeState();
+	std::erase(getInterfaceList(), this);
+}
+
+std::vector<LuaScriptInterface*>& LuaScriptInterface::getInterfaceList()
+{
+	// never destroyed, interfaces with static storage leave it at exit in any order
+	static auto* interfaces = new std::vector<LuaScriptInterface*>();
+	return *interfaces;
+}
+
+void* LuaScriptInterface::allocate(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	// a new block passes the type of the object in osize
+	const size_t previous = ptr ? osize : 0;
+	if (nsize > previous && scriptEnvIndex >= 0 && scriptEnvIndex < 16) {
+		if (LuaScriptInterface* scriptInterface = scriptEnv[scriptEnvIndex].getScriptInterface()) {
+			scriptInterface->allocatedBytes += nsize - previous;
+		}
+	}
+	return defaultAllocator(ud, ptr, osize, nsize);
 }
 
 bool LuaScriptInterface::reInitState()
@@ -274,17 +309,49 @@ bool LuaScriptInterface::reInitState()
 	g_luaEnvironment.clearAreaObjects(this);
 
 	closeState();
+	loadStats = {};
 	return initState();
 }
 
 /// Same as lua_pcall, but adds stack trace to error strings in called function.
 int LuaScriptInterface::protectedCall(lua_State* L, int nargs, int nresults)
 {
+	TickPhaseTimer timer(TICK_PHASE_LUA);
+	PlayerLuaTimer playerTimer;
+	std::string_view scriptFile;
+	if ((TickProfiler::isActive() || TraceRecorder::isRecording()) && scriptEnvIndex >= 0) {
+		int32_t scriptId = 0;
+		int32_t callbackId = 0;
+		bool timerEvent = false;
+		LuaScriptInterface* scriptInterface = nullptr;
+		getScriptEnv()->getEventInfo(scriptId, scriptInterface, callbackId, timerEvent);
+		if (scriptInterface) {
+			scriptFile = scriptInterface->getFileById(scriptId);
+		}
+	}
+	TickSourceTimer source(scriptFile);
+	TraceScope trace(TraceRecorder::isRecording() ? g_traceRecorder.intern(scriptFile.empty() ? "(unknown script)" : scriptFile) : nullptr, "lua");
+
 	int error_index = lua_gettop(L) - nargs;
 	lua_pushcfunction(L, luaErrorHandler);
 	lua_insert(L, error_index);
 
-	int ret = lua_pcall(L, nargs, nresults, error_index);
+	int ret;
+	if (g_luaProfiler.isRunning()) {
+		int32_t scriptId = 0;
+		int32_t callbackId = 0;
+		bool timerEvent = false;
+		LuaScriptInterface* scriptInterface = nullptr;
+		if (scriptEnvIndex >= 0) {
+			getScriptEnv()->getEventInfo(scriptId, scriptInterface, callbackId, timerEvent);
+		}
+
+		g_luaProfiler.enterCall(scriptInterface ? scriptInterface->getFileById(scriptId) : "(unknown script)");
+		ret = lua_pcall(L, nargs, nresults, error_index);
+		g_luaProfiler.leaveCall();
+	} else {
+		ret = lua_pcall(L, nargs, nresults, error_index);
+	}
 	lua_remove(L, error_index);
 	return ret;
 }
@@ -292,12 +359,21 @@ int LuaScriptInterface::protectedCall(lua_State* L, int nargs, int nresults)
 int32_t LuaScriptInterface::loadFile(const std::string& file, NpcPtr npc /* = std::nullopt*/)
 {
 	//loads file as a chunk at stack top
-	int ret = luaL_loadfile(luaState, file.c_str());
+	const auto loadStart = std::chrono::steady_clock::now();
+	bool cached = false;
+	int ret = g_config.getBoolean(ConfigManager::LUA_BYTECODE_CACHE) ? g_luaBytecodeCache.load(luaState, file, cached) : luaL_loadfile(luaState, file.c_str());
+	const auto runStart = std::chrono::steady_clock::now();
+	loadStats.loadTime += std::chrono::duration_cast<std::chrono::microseconds>(runStart - loadStart).count();
 	if (ret != 0) {
 		lastLuaError = popString(luaState);
 		return -1;
 	}
 
+	++loadStats.files;
+	if (cached) {
+		++loadStats.cachedFiles;
+	}
+
 	//check that it is loaded as a function
 	if (!isFunction(luaState, -1)) {
 		lua_pop(luaState, 1);
@@ -317,6 +393,7 @@ int32_t LuaScriptInterface::loadFile(const std::string& file, NpcPtr npc /* = st
 
 	//execute it
 	ret = protectedCall(luaState, 0, 0);
+	loadStats.runTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - runStart).count();
 	if (ret != 0) {
 		reportError(nullptr, popString(luaState));
 		resetScriptEnv();
@@ -587,11 +664,9 @@ void LuaScriptInterface::pushThing(lua_State* L, const ThingPtr& thing)
 	}
 
 	if (auto item = thing->getItem()) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else if (auto creature = thing->getCreature()) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+		pushCreature(L, creature);
 	} else {
 		lua_pushnil(L);
 	}
@@ -600,14 +675,11 @@ void LuaScriptInterface::pushThing(lua_State* L, const ThingPtr& thing)
 void LuaScriptInterface::pushCylinder(lua_State* L, const CylinderPtr& cylinder)
 {
 	if (auto creature = cylinder->getCreature()) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+		pushCreature(L, creature);
 	} else if (auto parentItem = cylinder->getItem()) {
-		pushSharedPtr(L, parentItem);
-		setItemMetatable(L, -1, parentItem);
+		pushItem(L, parentItem);
 	} else if (auto tile = cylinder->getTile()) {
-		pushSharedPtr(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushSharedPtr(L, tile, LuaData_Tile);
 	} else if (cylinder == VirtualCylinder::virtualCylinder) {
 		pushBoolean(L, true);
 	} else {
@@ -683,28 +755,90 @@ void LuaScriptInterface::setWeakMetatable(lua_State* L, int32_t index, const std
 	lua_setmetatable(L, index - 1);
 }
 
-void LuaScriptInterface::setItemMetatable(lua_State* L, int32_t index, const ItemConstPtr& item)
+namespace {
+
+// only its address is used, as the registry key of the userdata cache
+const char userdataCacheKey = 0;
+
+// pushes the metatable of type, looked up by name once per state and kept in the cache at cache
+void pushTypeMetatable(lua_State* L, int cache, LuaDataType type)
 {
-	if (item->getContainer()) {
-		luaL_getmetatable(L, "Container");
-	} else if (item->getTeleport()) {
-		luaL_getmetatable(L, "Teleport");
-	} else {
-		luaL_getmetatable(L, "Item");
+	static constexpr std::array<const char*, LuaData_Tile + 1> metatableNames = {
+		nullptr, "Item", "Container", "Teleport", "Player", "Monster", "Npc", "Tile"
+	};
+
+	lua_rawgeti(L, cache, type);
+	if (!lua_isnil(L, -1)) {
+		return;
+	}
+
+	lua_pop(L, 1);
+	luaL_getmetatable(L, metatableNames[type]);
+	if (!lua_isnil(L, -1)) {
+		lua_pushvalue(L, -1);
+		lua_rawseti(L, cache, type);
 	}
-	lua_setmetatable(L, index - 1);
 }
 
-void LuaScriptInterface::setCreatureMetatable(lua_State* L, int32_t index, const CreatureConstPtr& creature)
+}
+
+void LuaScriptInterface::pushUserdataCache(lua_State* L)
 {
-	if (creature->getPlayer()) {
-		luaL_getmetatable(L, "Player");
-	} else if (creature->getMonster()) {
-		luaL_getmetatable(L, "Monster");
-	} else {
-		luaL_getmetatable(L, "Npc");
+	lua_pushlightuserdata(L, const_cast<char*>(&userdataCacheKey));
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if (lua_istable(L, -1)) {
+		return;
 	}
-	lua_setmetatable(L, index - 1);
+
+	lua_pop(L, 1);
+	lua_newtable(L);
+
+	lua_newtable(L);
+	lua_pushstring(L, "v");
+	lua_setfield(L, -2, "__mode");
+	lua_setmetatable(L, -2);
+
+	lua_pushlightuserdata(L, const_cast<char*>(&userdataCacheKey));
+	lua_pushvalue(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+bool LuaScriptInterface::pushCachedUserdata(lua_State* L, const void* key, LuaDataType type)
+{
+	pushUserdataCache(L);
+	const int cache = lua_gettop(L);
+
+	lua_pushlightuserdata(L, const_cast<void*>(key));
+	lua_rawget(L, cache);
+
+	// item:moveTo may have pointed the userdata at the item it merged into
+	void* userdata = lua_touserdata(L, -1);
+	if (userdata && *static_cast<void**>(userdata) == key && lua_getmetatable(L, -1)) {
+		pushTypeMetatable(L, cache, type);
+		const bool sameMetatable = lua_rawequal(L, -1, -2);
+		lua_pop(L, 2);
+		if (sameMetatable) {
+			lua_remove(L, cache);
+			return true;
+		}
+	}
+
+	lua_settop(L, cache - 1);
+	return false;
+}
+
+void LuaScriptInterface::cacheUserdata(lua_State* L, const void* key, LuaDataType type)
+{
+	pushUserdataCache(L);
+	const int cache = lua_gettop(L);
+
+	pushTypeMetatable(L, cache, type);
+	lua_setmetatable(L, cache - 1);
+
+	lua_pushlightuserdata(L, const_cast<void*>(key));
+	lua_pushvalue(L, cache - 1);
+	lua_rawset(L, cache);
+	lua_pop(L, 1);
 }
 
 // Get
@@ -2085,11 +2219,46 @@ void LuaScriptInterface::registerFunctions()
 	registerEnumIn("configKeys", ConfigManager::MAP_AUTHOR);
 	registerEnumIn("configKeys", ConfigManager::AUGMENT_CRITICAL_ANIMATION);
 	registerEnumIn("configKeys", ConfigManager::ACCOUNT_MANAGER_AUTH);
+	registerEnumIn("configKeys", ConfigManager::PACKET_CAPTURE_FILE);
+	registerEnumIn("configKeys", ConfigManager::LUA_GC_MODE);
+	registerEnumIn("configKeys", ConfigManager::THREAD_AFFINITY);
 	registerEnumIn("configKeys", ConfigManager::ENABLE_ACCOUNT_MANAGER);
 	registerEnumIn("configKeys", ConfigManager::ENABLE_NO_PASS_LOGIN);
+	registerEnumIn("configKeys", ConfigManager::LAZY_MAP_TILES);
+	registerEnumIn("configKeys", ConfigManager::MAP_SNAPSHOT);
+	registerEnumIn("configKeys", ConfigManager::DROP_FLOOD_PACKETS);
+	registerEnumIn("configKeys", ConfigManager::PACKET_COMPRESSION);
+	registerEnumIn("configKeys", ConfigManager::COALESCE_EFFECTS);
+	registerEnumIn("configKeys", ConfigManager::LUA_PROFILER);
+	registerEnumIn("configKeys", ConfigManager::LUA_BYTECODE_CACHE);
 	registerEnumIn("configKeys", ConfigManager::ACCOUNT_MANAGER_POS_X);
 	registerEnumIn("configKeys", ConfigManager::ACCOUNT_MANAGER_POS_Y);
 	registerEnumIn("configKeys", ConfigManager::ACCOUNT_MANAGER_POS_Z);
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_WEIGHT_PLAYER);
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_WEIGHT_CREATURE);
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_WEIGHT_DEFAULT);
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_WEIGHT_BACKGROUND);
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_JOB_BUDGET);
+	registerEnumIn("configKeys", ConfigManager::PATHFINDING_THREADS);
+	registerEnumIn("configKeys", ConfigManager::MONSTER_THINK_THREADS);
+	registerEnumIn("configKeys", ConfigManager::NETWORK_THREADS);
+	registerEnumIn("configKeys", ConfigManager::CRYPTO_THREADS);
+	registerEnumIn("configKeys", ConfigManager::MAX_PACKET_BURST);
+	registerEnumIn("configKeys", ConfigManager::MAX_PACKETS_PER_SECOND_PER_IP);
+	registerEnumIn("configKeys", ConfigManager::PACKET_COMPRESSION_LEVEL);
+	registerEnumIn("configKeys", ConfigManager::STATUS_CACHE_INTERVAL);
+	registerEnumIn("configKeys", ConfigManager::DATABASE_WORKERS);
+	registerEnumIn("configKeys", ConfigManager::STORAGE_FLUSH_INTERVAL);
+	registerEnumIn("configKeys", ConfigManager::PLAYER_SAVE_INTERVAL);
+	registerEnumIn("configKeys", ConfigManager::DISPATCHER_REALTIME_PRIORITY);
+	registerEnumIn("configKeys", ConfigManager::STORAGE_HOT_RANGE_START);
+	registerEnumIn("configKeys", ConfigManager::STORAGE_HOT_RANGE_SIZE);
+	registerEnumIn("configKeys", ConfigManager::MAP_LOAD_THREADS);
+	registerEnumIn("configKeys", ConfigManager::ITEM_LOAD_THREADS);
+	registerEnumIn("configKeys", ConfigManager::LUA_WORKER_THREADS);
+	registerEnumIn("configKeys", ConfigManager::LUA_GC_PAUSE);
+	registerEnumIn("configKeys", ConfigManager::LUA_GC_STEP_MULTIPLIER);
+	registerEnumIn("configKeys", ConfigManager::LUA_GC_IDLE_STEP);
 
 
 	registerEnumIn("configKeys", ConfigManager::SQL_PORT);
@@ -2163,6 +2332,11 @@ void LuaScriptInterface::registerFunctions()
 	registerTable("Game");
 
 	registerMethod("Game", "getSpectators", LuaScriptInterface::luaGameGetSpectators);
+	registerMethod("Game", "getSpectatorPositions", LuaScriptInterface::luaGameGetSpectatorPositions);
+	registerMethod("Game", "getSpectatorHealth", LuaScriptInterface::luaGameGetSpectatorHealth);
+	registerMethod("Game", "getAreaPositions", LuaScriptInterface::luaGameGetAreaPositions);
+	registerMethod("Game", "getAreaHealth", LuaScriptInterface::luaGameGetAreaHealth);
+	registerMethod("Game", "iterateSpectators", LuaScriptInterface::luaGameIterateSpectators);
 	registerMethod("Game", "getPlayers", LuaScriptInterface::luaGameGetPlayers);
 	registerMethod("Game", "getNpcs", LuaScriptInterface::luaGameGetNpcs);
 	registerMethod("Game", "getMonsters", LuaScriptInterface::luaGameGetMonsters);
@@ -2209,6 +2383,35 @@ void LuaScriptInterface::registerFunctions()
 	registerMethod("Game", "saveAccountStorageValues", LuaScriptInterface::luaGameSaveAccountStorageValues);
 
 	registerMethod("Game", "sendDiscordMessage", LuaScriptInterface::luaGameSendDiscordWebhook);
+	registerMethod("Game", "getWebhookStats", LuaScriptInterface::luaGameGetWebhookStats);
+
+	registerMethod("Game", "getDispatcherStats", LuaScriptInterface::luaGameGetDispatcherStats);
+	registerMethod("Game", "resetDispatcherStats", LuaScriptInterface::luaGameResetDispatcherStats);
+	registerMethod("Game", "getQueryStats", LuaScriptInterface::luaGameGetQueryStats);
+	registerMethod("Game", "resetQueryStats", LuaScriptInterface::luaGameResetQueryStats);
+	registerMethod("Game", "getAllocationStats", LuaScriptInterface::luaGameGetAllocationStats);
+	registerMethod("Game", "getPlayerCosts", LuaScriptInterface::luaGameGetPlayerCosts);
+	registerMethod("Game", "clearBanCache", LuaScriptInterface::luaGameClearBanCache);
+	registerMethod("Game", "getTickBudget", LuaScriptInterface::luaGameGetTickBudget);
+	registerMethod("Game", "setTickProfiler", LuaScriptInterface::luaGameSetTickProfiler);
+	registerMethod("Game", "getDecayStats", LuaScriptInterface::luaGameGetDecayStats);
+	registerMethod("Game", "getFollowPathStats", LuaScriptInterface::luaGameGetFollowPathStats);
+	registerMethod("Game", "getMonsterActivity", LuaScriptInterface::luaGameGetMonsterActivity);
+	registerMethod("Game", "getNetworkWriteStats", LuaScriptInterface::luaGameGetNetworkWriteStats);
+	registerMethod("Game", "getPacketStats", LuaScriptInterface::luaGameGetPacketStats);
+	registerMethod("Game", "getWaitListStats", LuaScriptInterface::luaGameGetWaitListStats);
+	registerMethod("Game", "getDatabaseTaskStats", LuaScriptInterface::luaGameGetDatabaseTaskStats);
+	registerMethod("Game", "startLuaProfiler", LuaScriptInterface::luaGameStartLuaProfiler);
+	registerMethod("Game", "stopLuaProfiler", LuaScriptInterface::luaGameStopLuaProfiler);
+	registerMethod("Game", "startTrace", LuaScriptInterface::luaGameStartTrace);
+	registerMethod("Game", "callWorker", LuaScriptInterface::luaGameCallWorker);
+	registerMethod("Game", "setLuaGarbageCollector", LuaScriptInterface::luaGameSetLuaGarbageCollector);
+	registerMethod("Game", "getLuaGarbageCollectorStats", LuaScriptInterface::luaGameGetLuaGarbageCollectorStats);
+	registerMethod("Game", "getScriptLoadStats", LuaScriptInterface::luaGameGetScriptLoadStats);
+	registerMethod("Game", "getMemoryReport", LuaScriptInterface::luaGameGetMemoryReport);
+	registerMethod("Game", "writeLog", LuaScriptInterface::luaGameWriteLog);
+	registerMethod("Game", "getNpcStats", LuaScriptInterface::luaGameGetNpcStats);
+	registerMethod("Game", "getPendingTimers", LuaScriptInterface::luaGameGetPendingTimers);
 
 	// Variant
 	registerClass("Variant", "", LuaScriptInterface::luaVariantCreate);
@@ -2485,6 +2688,8 @@ void LuaScriptInterface::registerFunctions()
 	registerMethod("Container", "addItem", LuaScriptInterface::luaContainerAddItem);
 	registerMethod("Container", "addItemEx", LuaScriptInterface::luaContainerAddItemEx);
 	registerMethod("Container", "getCorpseOwner", LuaScriptInterface::luaContainerGetCorpseOwner);
+	registerMethod("Container", "moveItemsTo", LuaScriptInterface::luaContainerMoveItemsTo);
+	registerMethod("Container", "createLoot", LuaScriptInterface::luaContainerCreateLoot);
 
 	// Teleport
 	registerClass("Teleport", "Item", LuaScriptInterface::luaTeleportCreate);
@@ -2692,6 +2897,8 @@ void LuaScriptInterface::registerFunctions()
 
 	registerMethod("Player", "getStorageValue", LuaScriptInterface::luaPlayerGetStorageValue);
 	registerMethod("Player", "setStorageValue", LuaScriptInterface::luaPlayerSetStorageValue);
+	registerMethod("Player", "getStorageValues", LuaScriptInterface::luaPlayerGetStorageValues);
+	registerMethod("Player", "setStorageValues", LuaScriptInterface::luaPlayerSetStorageValues);
 
 	registerMethod("Player", "addItem", LuaScriptInterface::luaPlayerAddItem);
 	registerMethod("Player", "addItemEx", LuaScriptInterface::luaPlayerAddItemEx);
@@ -2736,6 +2943,7 @@ void LuaScriptInterface::registerFunctions()
 	registerMethod("Player", "learnSpell", LuaScriptInterface::luaPlayerLearnSpell);
 	registerMethod("Player", "forgetSpell", LuaScriptInterface::luaPlayerForgetSpell);
 	registerMethod("Player", "hasLearnedSpell", LuaScriptInterface::luaPlayerHasLearnedSpell);
+	registerMethod("Player", "getMemoryUsage", LuaScriptInterface::luaPlayerGetMemoryUsage);
 
 	registerMethod("Player", "sendTutorial", LuaScriptInterface::luaPlayerSendTutorial);
 	registerMethod("Player", "addMapMark", LuaScriptInterface::luaPlayerAddMapMark);
@@ -3998,7 +4206,8 @@ int LuaScriptInterface::luaAddEvent(lua_State* L)
 		}
 	}
 
-	LuaTimerEventDesc eventDesc;
+	const uint32_t index = g_luaEnvironment.acquireTimerEvent();
+	LuaTimerEventDesc& eventDesc = g_luaEnvironment.timerEvents[index];
 	eventDesc.parameters.reserve(parameters - 2); // safe to use -2 since we garanteed that there is at least two parameters
 	for (int i = 0; i < parameters - 2; ++i) {
 		eventDesc.parameters.push_back(luaL_ref(L, LUA_REGISTRYINDEX));
@@ -4007,14 +4216,12 @@ int LuaScriptInterface::luaAddEvent(lua_State* L)
 	uint32_t delay = std::max<uint32_t>(100, getNumber<uint32_t>(L, 2));
 	lua_pop(L, 1);
 
+	ScriptEnvironment* env = getScriptEnv();
 	eventDesc.function = luaL_ref(L, LUA_REGISTRYINDEX);
-	eventDesc.scriptId = getScriptEnv()->getScriptId();
+	eventDesc.scriptId = env->getScriptId();
+	eventDesc.scriptInterface = env->getScriptInterface();
 
-	auto& lastTimerEventId = g_luaEnvironment.lastEventTimerId;
-	eventDesc.eventId = g_scheduler.addEvent(createSchedulerTask(delay, [=]() { g_luaEnvironment.executeTimerEvent(lastTimerEventId); }));
-
-	g_luaEnvironment.timerEvents.emplace(lastTimerEventId, std::move(eventDesc));
-	lua_pushinteger(L, lastTimerEventId++);
+	lua_pushinteger(L, g_luaEnvironment.startTimerEvent(index, delay));
 	return 1;
 }
 
@@ -4022,39 +4229,33 @@ int LuaScriptInterface::luaStopEvent(lua_State* L)
 {
 	//stopEvent(eventid)
 	uint32_t eventId = getNumber<uint32_t>(L, 1);
-
-	auto& timerEvents = g_luaEnvironment.timerEvents;
-	auto it = timerEvents.find(eventId);
-	if (it == timerEvents.end()) {
-		pushBoolean(L, false);
-		return 1;
-	}
-
-	LuaTimerEventDesc timerEventDesc = std::move(it->second);
-	timerEvents.erase(it);
-
-	g_scheduler.stopEvent(timerEventDesc.eventId);
-	luaL_unref(L, LUA_REGISTRYINDEX, timerEventDesc.function);
-
-	for (auto parameter : timerEventDesc.parameters) {
-		luaL_unref(L, LUA_REGISTRYINDEX, parameter);
-	}
-
-	pushBoolean(L, true);
+	pushBoolean(L, g_luaEnvironment.stopTimerEvent(eventId));
 	return 1;
 }
 
 int LuaScriptInterface::luaSaveServer(lua_State* L)
 {
+	//saveServer([sliced = false])
 	g_globalEvents->save();
-	g_game.saveGameState();
+	if (getBoolean(L, 1, false)) {
+		g_game.scheduleSaveGameState();
+	} else {
+		g_game.saveGameState();
+	}
 	pushBoolean(L, true);
 	return 1;
 }
 
 int LuaScriptInterface::luaCleanMap(lua_State* L)
 {
-	lua_pushinteger(L, g_game.map.clean());
+	//cleanMap([sliced = false])
+	if (getBoolean(L, 1, false)) {
+		// the removed item count is only reported in the console once done
+		g_game.map.scheduleClean();
+		lua_pushinteger(L, 0);
+	} else {
+		lua_pushinteger(L, g_game.map.clean());
+	}
 	return 1;
 }
 
@@ -4596,14 +4797,195 @@ int LuaScriptInterface::luaGameGetSpectators(lua_State* L)
 	lua_createtable(L, spectators.size(), 0);
 
 	int index = 0;
-	for (auto creature : spectators) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+	for (const auto& creature : spectators) {
+		pushCreature(L, creature);
+		lua_rawseti(L, -2, ++index);
+	}
+	return 1;
+}
+
+
+namespace {
+
+// the creatures standing on the tiles of an area, the way a spell cast from
+// centerPos at targetPos would lay it out, without its sight checks
+void getAreaCreatures(SpectatorView& creatures, const AreaCombat& area, const Position& centerPos, const Position& targetPos)
+{
+	if (targetPos.z >= MAP_MAX_LAYERS) {
+		return;
+	}
+
+	Map::TileLookupHint hint;
+	for (const AreaOffset& offset : area.getOffsets(centerPos, targetPos)) {
+		const int32_t x = targetPos.x + offset.x;
+		const int32_t y = targetPos.y + offset.y;
+		if (x < 0 || x > std::numeric_limits<uint16_t>::max() || y < 0 || y > std::numeric_limits<uint16_t>::max()) {
+			continue;
+		}
+
+		const auto tile = g_game.map.getTile(x, y, targetPos.z, hint);
+		if (!tile) {
+			continue;
+		}
+
+		if (const auto& tileCreatures = tile->getCreatures()) {
+			for (const auto& creature : *tileCreatures) {
+				creatures.emplace_back(creature.get());
+			}
+		}
+	}
+}
+
+enum class PackedFields { POSITION, HEALTH };
+
+// one flat array instead of a creature object per entry, {id, x, y, z, ...}
+// for positions and {id, health, maxHealth, ...} for health
+void pushPackedCreatures(lua_State* L, const SpectatorView& creatures, PackedFields fields)
+{
+	const int stride = fields == PackedFields::POSITION ? 4 : 3;
+	lua_createtable(L, creatures.size() * stride, 0);
+
+	int index = 0;
+	for (const Creature* creature : creatures) {
+		lua_pushinteger(L, creature->getID());
 		lua_rawseti(L, -2, ++index);
+
+		if (fields == PackedFields::POSITION) {
+			const Position& position = creature->getPosition();
+			lua_pushinteger(L, position.x);
+			lua_rawseti(L, -2, ++index);
+			lua_pushinteger(L, position.y);
+			lua_rawseti(L, -2, ++index);
+			lua_pushinteger(L, position.z);
+			lua_rawseti(L, -2, ++index);
+		} else {
+			lua_pushinteger(L, creature->getHealth());
+			lua_rawseti(L, -2, ++index);
+			lua_pushinteger(L, creature->getMaxHealth());
+			lua_rawseti(L, -2, ++index);
+		}
 	}
+}
+
+int pushSpectatorFields(lua_State* L, PackedFields fields)
+{
+	const Position& position = LuaScriptInterface::getPosition(L, 1);
+	bool multifloor = LuaScriptInterface::getBoolean(L, 2, false);
+	bool onlyPlayers = LuaScriptInterface::getBoolean(L, 3, false);
+	int32_t minRangeX = LuaScriptInterface::getNumber<int32_t>(L, 4, 0);
+	int32_t maxRangeX = LuaScriptInterface::getNumber<int32_t>(L, 5, 0);
+	int32_t minRangeY = LuaScriptInterface::getNumber<int32_t>(L, 6, 0);
+	int32_t maxRangeY = LuaScriptInterface::getNumber<int32_t>(L, 7, 0);
+
+	SpectatorView spectators;
+	g_game.map.getSpectators(spectators, position, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
+	pushPackedCreatures(L, spectators, fields);
 	return 1;
 }
 
+int pushAreaFields(lua_State* L, const AreaCombat& area, PackedFields fields)
+{
+	const Position& targetPos = LuaScriptInterface::getPosition(L, 2);
+	const Position& centerPos = lua_gettop(L) >= 3 ? LuaScriptInterface::getPosition(L, 3) : targetPos;
+
+	SpectatorView creatures;
+	getAreaCreatures(creatures, area, centerPos, targetPos);
+	pushPackedCreatures(L, creatures, fields);
+	return 1;
+}
+
+struct SpectatorIterator {
+	SpectatorVec spectators;
+	size_t next = 0;
+};
+
+constexpr const char* SPECTATOR_ITERATOR = "SpectatorIterator";
+
+int luaSpectatorIteratorDelete(lua_State* L)
+{
+	static_cast<SpectatorIterator*>(lua_touserdata(L, 1))->~SpectatorIterator();
+	return 0;
+}
+
+int luaSpectatorIteratorNext(lua_State* L)
+{
+	auto iterator = static_cast<SpectatorIterator*>(lua_touserdata(L, lua_upvalueindex(1)));
+	// the loop body may have removed some of them
+	while (iterator->next < iterator->spectators.size()) {
+		const CreaturePtr& creature = *(iterator->spectators.begin() + iterator->next++);
+		if (!creature->isRemoved()) {
+			LuaScriptInterface::pushCreature(L, creature);
+			return 1;
+		}
+	}
+
+	// done, let the creatures go before the iterator is collected
+	iterator->spectators = {};
+	lua_pushnil(L);
+	return 1;
+}
+
+}
+
+int LuaScriptInterface::luaGameGetSpectatorPositions(lua_State* L)
+{
+	// Game.getSpectatorPositions(position[, multifloor = false[, onlyPlayer = false[, minRangeX = 0[, maxRangeX = 0[, minRangeY = 0[, maxRangeY = 0]]]]]])
+	return pushSpectatorFields(L, PackedFields::POSITION);
+}
+
+int LuaScriptInterface::luaGameGetSpectatorHealth(lua_State* L)
+{
+	// Game.getSpectatorHealth(position[, multifloor = false[, onlyPlayer = false[, minRangeX = 0[, maxRangeX = 0[, minRangeY = 0[, maxRangeY = 0]]]]]])
+	return pushSpectatorFields(L, PackedFields::HEALTH);
+}
+
+int LuaScriptInterface::luaGameGetAreaPositions(lua_State* L)
+{
+	// Game.getAreaPositions(area, position[, casterPosition = position])
+	const AreaCombat* area = g_luaEnvironment.getAreaObject(getNumber<uint32_t>(L, 1));
+	if (!area) {
+		reportErrorFunc(L, getErrorDesc(LUA_ERROR_AREA_NOT_FOUND));
+		pushBoolean(L, false);
+		return 1;
+	}
+	return pushAreaFields(L, *area, PackedFields::POSITION);
+}
+
+int LuaScriptInterface::luaGameGetAreaHealth(lua_State* L)
+{
+	// Game.getAreaHealth(area, position[, casterPosition = position])
+	const AreaCombat* area = g_luaEnvironment.getAreaObject(getNumber<uint32_t>(L, 1));
+	if (!area) {
+		reportErrorFunc(L, getErrorDesc(LUA_ERROR_AREA_NOT_FOUND));
+		pushBoolean(L, false);
+		return 1;
+	}
+	return pushAreaFields(L, *area, PackedFields::HEALTH);
+}
+
+int LuaScriptInterface::luaGameIterateSpectators(lua_State* L)
+{
+	// for creature in Game.iterateSpectators(position[, multifloor = false[, onlyPlayer = false[, minRangeX = 0[, maxRangeX = 0[, minRangeY = 0[, maxRangeY = 0]]]]]]) do
+	const Position& position = getPosition(L, 1);
+	bool multifloor = getBoolean(L, 2, false);
+	bool onlyPlayers = getBoolean(L, 3, false);
+	int32_t minRangeX = getNumber<int32_t>(L, 4, 0);
+	int32_t maxRangeX = getNumber<int32_t>(L, 5, 0);
+	int32_t minRangeY = getNumber<int32_t>(L, 6, 0);
+	int32_t maxRangeY = getNumber<int32_t>(L, 7, 0);
+
+	auto iterator = new (lua_newuserdata(L, sizeof(SpectatorIterator))) SpectatorIterator;
+	g_game.map.getSpectators(iterator->spectators, position, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
+
+	if (luaL_newmetatable(L, SPECTATOR_ITERATOR) != 0) {
+		lua_pushcfunction(L, luaSpectatorIteratorDelete);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_setmetatable(L, -2);
+
+	lua_pushcclosure(L, luaSpectatorIteratorNext, 1);
+	return 1;
+}
 int LuaScriptInterface::luaGameGetPlayers(lua_State* L)
 {
 	// Game.getPlayers()
@@ -4611,8 +4993,7 @@ int LuaScriptInterface::luaGameGetPlayers(lua_State* L)
 
 	int index = 0;
 	for (const auto& val : g_game.getPlayers() | std::views::values) {
-		pushSharedPtr(L, val);
-		setMetatable(L, -1, "Player");
+		pushSharedPtr(L, val, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -4624,9 +5005,8 @@ int LuaScriptInterface::luaGameGetNpcs(lua_State* L)
 	lua_createtable(L, g_game.getNpcsOnline(), 0);
 
 	int index = 0;
-	for (const auto& val : g_game.getNpcs() | std::views::values) {
-		pushSharedPtr(L, val);
-		setMetatable(L, -1, "Npc");
+	for (const auto& val : g_game.getNpcs()) {
+		pushSharedPtr(L, val, LuaData_Npc);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -4638,9 +5018,8 @@ int LuaScriptInterface::luaGameGetMonsters(lua_State* L)
 	lua_createtable(L, g_game.getMonstersOnline(), 0);
 
 	int index = 0;
-	for (const auto& val : g_game.getMonsters() | std::views::values) {
-		pushSharedPtr(L, val);
-		setMetatable(L, -1, "Monster");
+	for (const auto& val : g_game.getMonsters()) {
+		pushSharedPtr(L, val, LuaData_Monster);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -4905,8 +5284,7 @@ int LuaScriptInterface::luaGameCreateItem(lua_State* L)
 		item->setParent(VirtualCylinder::virtualCylinder);
 	}
 
-	pushSharedPtr(L, item);
-	setItemMetatable(L, -1, item);
+	pushItem(L, item);
 	return 1;
 }
 
@@ -4946,8 +5324,7 @@ int LuaScriptInterface::luaGameCreateContainer(lua_State* L)
 		container->setParent(VirtualCylinder::virtualCylinder);
 	}
 
-	pushSharedPtr(L, container);
-	setMetatable(L, -1, "Container");
+	pushSharedPtr(L, container, LuaData_Container);
 	return 1;
 }
 
@@ -4966,8 +5343,7 @@ int LuaScriptInterface::luaGameCreateMonster(lua_State* L)
 	MagicEffectClasses magicEffect = getNumber<MagicEffectClasses>(L, 5, CONST_ME_TELEPORT);
 	if (g_events->eventMonsterOnSpawn(monster, position, false, true) || force) {
 		if (g_game.placeCreature(monster, position, extended, force, magicEffect)) {
-			pushSharedPtr(L, monster);
-			setMetatable(L, -1, "Monster");
+			pushSharedPtr(L, monster, LuaData_Monster);
 		} else {
 			lua_pushnil(L);
 		}
@@ -4991,8 +5367,7 @@ int LuaScriptInterface::luaGameCreateNpc(lua_State* L)
 	bool force = getBoolean(L, 4, false);
 	MagicEffectClasses magicEffect = getNumber<MagicEffectClasses>(L, 5, CONST_ME_TELEPORT);
 	if (g_game.placeCreature(npc, position, extended, force, magicEffect)) {
-		pushSharedPtr(L, npc);
-		setMetatable(L, -1, "Npc");
+		pushSharedPtr(L, npc, LuaData_Npc);
 	} else {
 		npc.reset();
 		lua_pushnil(L);
@@ -5022,8 +5397,7 @@ int LuaScriptInterface::luaGameCreateTile(lua_State* L)
 		g_game.map.setTile(position, tile);
 	}
 
-	pushSharedPtr(L, tile);
-	setMetatable(L, -1, "Tile");
+	pushSharedPtr(L, tile, LuaData_Tile);
 	return 1;
 }
 
@@ -5049,8 +5423,10 @@ int LuaScriptInterface::luaGameCreateMonsterType(lua_State* L)
 		monsterType->nameDescription = "a " + name;
 	} else {
 		monsterType->info.lootItems.clear();
+		monsterType->compileLoot();
 		monsterType->info.attackSpells.clear();
 		monsterType->info.defenseSpells.clear();
+		monsterType->compileSpells();
 		monsterType->info.scripts.clear();
 		monsterType->info.thinkEvent = -1;
 		monsterType->info.creatureAppearEvent = -1;
@@ -5161,8 +5537,6 @@ int LuaScriptInterface::luaGameSendDiscordWebhook(lua_State* L)
 	if (token.length() > 0 && msg.length() > 0 && messageType >= 0) {
 		// "{\"content\": null,\"embeds\":[{\"title\": \"testing\",\"description\": \"tetsign\",\"color\": 4062976}],\"attachments\": []}"
 		std::string field;
-		struct curl_slist* headers = nullptr;
-		headers = curl_slist_append(headers, "Content-Type: application/json");
 
 		switch (messageType) {
 		case DiscordMessageType::MESSAGE_NORMAL:
@@ -5210,20 +5584,549 @@ int LuaScriptInterface::luaGameSendDiscordWebhook(lua_State* L)
 			return 1;
 		}
 
-		auto curl = g_game.curl;
+		pushBoolean(L, g_webhooks.send(std::move(token), std::move(field)));
+		return 1;
+	}
+
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetWebhookStats(lua_State* L)
+{
+	// Game.getWebhookStats()
+	const Webhooks::Stats stats = g_webhooks.getStats();
+	lua_createtable(L, 0, 5);
+	setField(L, "sent", stats.sent);
+	setField(L, "failed", stats.failed);
+	setField(L, "retried", stats.retried);
+	setField(L, "dropped", stats.dropped);
+	setField(L, "queued", stats.queued);
+	return 1;
+}
+
+namespace {
+
+void pushLatencyHistogram(lua_State* L, const LatencyHistogram& histogram)
+{
+	lua_createtable(L, 0, 4);
+	LuaScriptInterface::setField(L, "count", histogram.getCount());
+	LuaScriptInterface::setField(L, "p50", histogram.getPercentile(50));
+	LuaScriptInterface::setField(L, "p99", histogram.getPercentile(99));
+	LuaScriptInterface::setField(L, "max", histogram.getMax());
+}
+
+}
+
+int LuaScriptInterface::luaGameGetDispatcherStats(lua_State* L)
+{
+	// Game.getDispatcherStats()
+	// all durations are in microseconds
+	const TaskStats& stats = g_dispatcher.getStats();
+
+	lua_createtable(L, 0, 5);
+	setField(L, "queueSize", g_dispatcher.getQueueSize());
+	setField(L, "expired", stats.getExpired());
+
+	pushLatencyHistogram(L, stats.getWaitTime());
+	lua_setfield(L, -2, "wait");
+
+	pushLatencyHistogram(L, stats.getExecutionTime());
+	lua_setfield(L, -2, "execution");
+
+	const auto& sites = stats.getSites();
+	lua_createtable(L, sites.size(), 0);
+
+	int index = 0;
+	for (const auto& [site, histogram] : sites) {
+		pushLatencyHistogram(L, histogram);
+		setField(L, "file", std::string(site.file));
+		setField(L, "line", site.line);
+		setField(L, "function", std::string(site.function));
+		lua_rawseti(L, -2, ++index);
+	}
+	lua_setfield(L, -2, "sites");
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetDispatcherStats(lua_State* L)
+{
+	// Game.resetDispatcherStats()
+	g_dispatcher.getStats().reset();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetQueryStats(lua_State* L)
+{
+	// Game.getQueryStats()
+	// one entry per query shape, all durations are in microseconds
+	const auto shapes = g_queryStats.getShapes();
+	lua_createtable(L, shapes.size(), 0);
+
+	int index = 0;
+	for (const auto& [query, shape] : shapes) {
+		pushLatencyHistogram(L, shape.latency);
+		setField(L, "query", query);
+		setField(L, "blocking", shape.blocking);
+		setField(L, "dispatcher", shape.dispatcher);
+		setField(L, "file", std::string(shape.site.file));
+		setField(L, "line", shape.site.line);
+		setField(L, "function", std::string(shape.site.function));
+		lua_rawseti(L, -2, ++index);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameResetQueryStats(lua_State* L)
+{
+	// Game.resetQueryStats()
+	g_queryStats.reset();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetAllocationStats(lua_State* L)
+{
+	// Game.getAllocationStats()
+	// labels stays empty unless the server was built with --alloc-profiler
+	const auto& rates = g_allocationProfiler.getLastSecond();
+	lua_createtable(L, 0, 3);
+	setField(L, "allocator", std::string(AllocationProfiler::getAllocatorName()));
+	pushBoolean(L, AllocationProfiler::isBuiltIn());
+	lua_setfield(L, -2, "profiler");
+
+	lua_createtable(L, rates.size(), 0);
+	int index = 0;
+	for (const AllocationRate& rate : rates) {
+		lua_createtable(L, 0, 5);
+		setField(L, "label", rate.label);
+		setField(L, "allocations", rate.allocations);
+		setField(L, "bytes", rate.bytes);
+		setField(L, "totalAllocations", rate.totalAllocations);
+		setField(L, "totalBytes", rate.totalBytes);
+		lua_rawseti(L, -2, ++index);
+	}
+	lua_setfield(L, -2, "labels");
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetPlayerCosts(lua_State* L)
+{
+	// Game.getPlayerCosts([limit = 10[, sortBy = "dispatcher"]])
+	// since login, sortBy is one of dispatcher, lua, path, received, sent and packets
+	const size_t limit = getNumber<size_t>(L, 1, 10);
+	const std::string sortBy = getString(L, 2, "dispatcher");
+
+	using CostKey = uint64_t (*)(const PlayerCost&);
+	CostKey key = [](const PlayerCost& cost) { return static_cast<uint64_t>(cost.dispatcherTime); };
+	if (sortBy == "lua") {
+		key = [](const PlayerCost& cost) { return static_cast<uint64_t>(cost.luaTime); };
+	} else if (sortBy == "path") {
+		key = [](const PlayerCost& cost) { return cost.pathNodes; };
+	} else if (sortBy == "received") {
+		key = [](const PlayerCost& cost) { return cost.bytesReceived.load(std::memory_order_relaxed); };
+	} else if (sortBy == "sent") {
+		key = [](const PlayerCost& cost) { return cost.bytesSent.load(std::memory_order_relaxed); };
+	} else if (sortBy == "packets") {
+		key = [](const PlayerCost& cost) { return cost.packets.load(std::memory_order_relaxed); };
+	}
+
+	std::vector<std::pair<uint64_t, PlayerPtr>> players;
+	players.reserve(g_game.getPlayersOnline());
+	for (const auto& [id, player] : g_game.getPlayers()) {
+		players.emplace_back(key(*player->getCost()), player);
+	}
+
+	const size_t count = std::min(limit, players.size());
+	std::partial_sort(players.begin(), players.begin() + count, players.end(), [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+
+	const auto now = std::chrono::steady_clock::now();
+	lua_createtable(L, count, 0);
+	for (size_t i = 0; i < count; ++i) {
+		const PlayerPtr& player = players[i].second;
+		const PlayerCost& cost = *player->getCost();
+		lua_createtable(L, 0, 9);
+		setField(L, "name", player->getName());
+		setField(L, "id", player->getID());
+		setField(L, "seconds", std::chrono::duration_cast<std::chrono::seconds>(now - cost.since).count());
+		setField(L, "bytesReceived", cost.bytesReceived.load(std::memory_order_relaxed));
+		setField(L, "bytesSent", cost.bytesSent.load(std::memory_order_relaxed));
+		setField(L, "packets", cost.packets.load(std::memory_order_relaxed));
+		// microseconds
+		setField(L, "dispatcherTime", cost.dispatcherTime / 1000);
+		setField(L, "luaTime", cost.luaTime / 1000);
+		setField(L, "pathNodes", cost.pathNodes);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameClearBanCache(lua_State* L)
+{
+	// Game.clearBanCache()
+	// after writing to account_bans, ip_bans or player_namelocks
+	IOBan::clearCache();
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetTickBudget(lua_State* L)
+{
+	// Game.getTickBudget()
+	// the last second measured, all durations are in microseconds
+	const TickBudget& budget = g_tickProfiler.getLastSecond();
+
+	lua_createtable(L, 0, 7);
+	setField(L, "window", budget.window / 1000);
+	setField(L, "busy", budget.busy / 1000);
+	setField(L, "maxBatch", budget.maxBatch / 1000);
+	setField(L, "batches", budget.batches);
+	setField(L, "slowBatches", budget.slowBatches);
+
+	lua_createtable(L, 0, TICK_PHASE_LAST);
+	for (size_t i = 0; i < TICK_PHASE_LAST; ++i) {
+		setField(L, TickProfiler::getPhaseName(static_cast<TickPhase_t>(i)), budget.phases[i] / 1000);
+	}
+	lua_setfield(L, -2, "phases");
+
+	lua_createtable(L, budget.sources.size(), 0);
+	int index = 0;
+	for (const auto& [name, time] : budget.sources) {
+		lua_createtable(L, 0, 2);
+		setField(L, "name", name);
+		setField(L, "time", time / 1000);
+		lua_rawseti(L, -2, ++index);
+	}
+	lua_setfield(L, -2, "sources");
+	return 1;
+}
+
+int LuaScriptInterface::luaGameSetTickProfiler(lua_State* L)
+{
+	// Game.setTickProfiler(enabled)
+	g_tickProfiler.setEnabled(getBoolean(L, 1));
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameStartLuaProfiler(lua_State* L)
+{
+	// Game.startLuaProfiler()
+	if (g_luaProfiler.isRunning()) {
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	g_luaProfiler.start(g_luaEnvironment.getLuaState());
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameStopLuaProfiler(lua_State* L)
+{
+	// Game.stopLuaProfiler()
+	const std::string& file = g_luaProfiler.stop();
+	if (file.empty()) {
+		lua_pushnil(L);
+	} else {
+		pushString(L, file);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameStartTrace(lua_State* L)
+{
+	// Game.startTrace([seconds = 10])
+	const std::string file = g_traceRecorder.start(getNumber<uint32_t>(L, 1, 10));
+	if (file.empty()) {
+		lua_pushnil(L);
+	} else {
+		pushString(L, file);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameSetLuaGarbageCollector(lua_State* L)
+{
+	// Game.setLuaGarbageCollector(mode[, pause = 0[, stepMultiplier = 0]])
+	// a value of 0 keeps what Lua uses
+	pushBoolean(L, g_luaEnvironment.setGarbageCollector(getString(L, 1), getNumber<int32_t>(L, 2, 0), getNumber<int32_t>(L, 3, 0)));
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetLuaGarbageCollectorStats(lua_State* L)
+{
+	// Game.getLuaGarbageCollectorStats()
+	// allocated holds the bytes the scripts of each interface allocated, by interface name
+	const LuaEnvironment::GarbageCollectorStats& stats = g_luaEnvironment.getGarbageCollectorStats();
+	lua_createtable(L, 0, 6);
+	setField(L, "mode", g_luaEnvironment.getGarbageCollectorMode());
+	setField(L, "memory", lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0));
+	setField(L, "idleSteps", stats.idleSteps);
+	setField(L, "idleCycles", stats.idleCycles);
+	setField(L, "idleTime", std::chrono::duration_cast<std::chrono::microseconds>(stats.idleTime).count());
+
+	std::map<std::string, uint64_t> allocated;
+	for (const LuaScriptInterface* scriptInterface : getInterfaces()) {
+		allocated[scriptInterface->getInterfaceName()] += scriptInterface->getAllocatedBytes();
+	}
+
+	lua_createtable(L, 0, allocated.size());
+	for (const auto& [name, bytes] : allocated) {
+		setField(L, name.c_str(), bytes);
+	}
+	lua_setfield(L, -2, "allocated");
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetScriptLoadStats(lua_State* L)
+{
+	// Game.getScriptLoadStats()
+	// by interface name, the files loaded since its last reload and the microseconds it took
+	std::map<std::string, LoadStats> interfaces;
+	for (const LuaScriptInterface* scriptInterface : getInterfaces()) {
+		const LoadStats& stats = scriptInterface->getLoadStats();
+		LoadStats& total = interfaces[scriptInterface->getInterfaceName()];
+		total.files += stats.files;
+		total.cachedFiles += stats.cachedFiles;
+		total.loadTime += stats.loadTime;
+		total.runTime += stats.runTime;
+	}
+
+	lua_createtable(L, 0, interfaces.size());
+	for (const auto& [name, stats] : interfaces) {
+		lua_createtable(L, 0, 4);
+		setField(L, "files", stats.files);
+		setField(L, "cachedFiles", stats.cachedFiles);
+		setField(L, "loadTime", stats.loadTime);
+		setField(L, "runTime", stats.runTime);
+		lua_setfield(L, -2, name.c_str());
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetMemoryReport(lua_State* L)
+{
+	// Game.getMemoryReport()
+	// by subsystem, the live objects and about the bytes they hold
+	const std::vector<MemoryReportEntry> report = collectMemoryReport();
+	lua_createtable(L, 0, report.size());
+	for (const MemoryReportEntry& entry : report) {
+		lua_createtable(L, 0, 2);
+		setField(L, "count", entry.count);
+		setField(L, "bytes", entry.bytes);
+		lua_setfield(L, -2, entry.name);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameWriteLog(lua_State* L)
+{
+	// Game.writeLog(file, text)
+	// appended on the log writer thread, the script does not wait for the disk
+	g_logWriter.write(getString(L, 1), getString(L, 2));
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetNpcStats(lua_State* L)
+{
+	// Game.getNpcStats()
+	const NpcStats& stats = Npcs::getStats();
+	lua_createtable(L, 0, 5);
+	setField(L, "thinks", stats.thinks);
+	setField(L, "thinkTime", stats.thinkTime);
+	setField(L, "says", stats.says);
+	setField(L, "sayTime", stats.sayTime);
+	setField(L, "saysFiltered", stats.saysFiltered);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetPendingTimers(lua_State* L)
+{
+	// Game.getPendingTimers()
+	// the addEvent timers that did not fire yet, by the script that added them
+	const auto pending = g_luaEnvironment.getPendingTimerEvents();
+	lua_createtable(L, 0, pending.size());
+	for (const auto& [script, count] : pending) {
+		setField(L, script.c_str(), count);
+	}
+	return 1;
+}
+
+int LuaScriptInterface::luaGameCallWorker(lua_State* L)
+{
+	// Game.callWorker(functionName, callback, ...)
+	// callback(success, ...) gets what the function returned, or the error message
+	if (!g_luaWorkers.isRunning()) {
+		reportErrorFunc(L, "There are no worker states, set luaWorkerThreads in config.lua.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	if (!isFunction(L, 2)) {
+		reportErrorFunc(L, "callback parameter should be a function.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	LuaMessage arguments;
+	const int parameters = lua_gettop(L);
+	for (int i = 3; i <= parameters; ++i) {
+		if (!LuaMessageValue::read(L, i, arguments.emplace_back())) {
+			reportErrorFunc(L, fmt::format("Argument #{:d} can not be passed to a worker, only nil, booleans, numbers, strings and tables of those can.", i));
+			pushBoolean(L, false);
+			return 1;
+		}
+	}
+
+	lua_pushvalue(L, 2);
+	const int32_t callback = luaL_ref(L, LUA_REGISTRYINDEX);
+	const int32_t scriptId = getScriptEnv()->getScriptId();
+
+	g_luaWorkers.call(getString(L, 1), std::move(arguments), [callback, scriptId](bool success, const LuaMessage& results) {
+		lua_State* L = g_luaEnvironment.getLuaState();
+		if (!L) {
+			return;
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, callback);
+		luaL_unref(L, LUA_REGISTRYINDEX, callback);
+		pushBoolean(L, success);
+		for (const LuaMessageValue& result : results) {
+			LuaMessageValue::push(L, result);
+		}
+
+		if (!reserveScriptEnv()) {
+			lua_pop(L, results.size() + 2);
+			std::cout << "[Error - LuaScriptInterface::luaGameCallWorker] Call stack overflow" << std::endl;
+			return;
+		}
+
+		ScriptEnvironment* env = getScriptEnv();
+		env->setTimerEvent();
+		env->setScriptId(scriptId, &g_luaEnvironment);
+		g_luaEnvironment.callVoidFunction(results.size() + 1);
+	});
+
+	pushBoolean(L, true);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetDecayStats(lua_State* L)
+{
+	// Game.getDecayStats()
+	// levels[1] holds decays due within 16 seconds, every next level spans 64 times more
+	const DecayWheel& decayWheel = g_game.getDecayWheel();
+
+	lua_createtable(L, 0, 2);
+	setField(L, "pending", decayWheel.size());
+
+	const auto& levelSizes = decayWheel.getLevelSizes();
+	lua_createtable(L, levelSizes.size(), 0);
+	for (size_t level = 0; level < levelSizes.size(); ++level) {
+		lua_pushinteger(L, levelSizes[level]);
+		lua_rawseti(L, -2, level + 1);
+	}
+	lua_setfield(L, -2, "levels");
+	return 1;
+}
 
-		g_dispatcher_discord.addTask(createTask([curl, token, field, headers]() {
-			curl_easy_setopt(curl, CURLOPT_URL, token.data());
-			curl_easy_setopt(curl, CURLOPT_POSTFIELDS, field.data());
-			curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+int LuaScriptInterface::luaGameGetFollowPathStats(lua_State* L)
+{
+	// Game.getFollowPathStats()
+	const FollowPathStats& stats = g_pathfinder.getFollowStats();
 
-			auto response = curl_easy_perform(curl);
+	lua_createtable(L, 0, 4);
+	setField(L, "kept", stats.kept);
+	setField(L, "repaired", stats.repaired);
+	setField(L, "flowField", stats.flowField);
+	setField(L, "searched", stats.searched);
+	return 1;
+}
 
-			if (response != CURLE_OK)
-				std::cout << "Curl failed - reason: " << curl_easy_strerror(response) << std::endl;
-		}));
+int LuaScriptInterface::luaGameGetMonsterActivity(lua_State* L)
+{
+	// Game.getMonsterActivity()
+	uint32_t sleeping = 0;
+	const auto& monsters = g_game.getMonsters();
+	for (const auto& monster : monsters) {
+		if (monster->getIdleStatus()) {
+			++sleeping;
+		}
 	}
 
+	lua_createtable(L, 0, 2);
+	setField(L, "awake", monsters.size() - sleeping);
+	setField(L, "sleeping", sleeping);
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetNetworkWriteStats(lua_State* L)
+{
+	// Game.getNetworkWriteStats()
+	const ConnectionWriteStats& stats = ConnectionManager::getInstance().getWriteStats();
+
+	lua_createtable(L, 0, 3);
+	setField(L, "writes", stats.writes.load());
+	setField(L, "messages", stats.messages.load());
+	setField(L, "bytes", stats.bytes.load());
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetPacketStats(lua_State* L)
+{
+	// Game.getPacketStats([limit = 10])
+	const size_t limit = getNumber<size_t>(L, 1, 10);
+	const PacketStats& stats = ProtocolGame::getPacketStats();
+
+	const auto pushTop = [L](const std::vector<OpcodeSummary>& top) {
+		lua_createtable(L, top.size(), 0);
+		int index = 0;
+		for (const OpcodeSummary& summary : top) {
+			lua_createtable(L, 0, 4);
+			setField(L, "opcode", static_cast<uint32_t>(summary.opcode));
+			setField(L, "count", summary.count);
+			setField(L, "bytes", summary.bytes);
+			setField(L, "time", summary.time);
+			lua_rawseti(L, -2, ++index);
+		}
+	};
+
+	lua_createtable(L, 0, 2);
+	pushTop(stats.getTopReceived(limit));
+	lua_setfield(L, -2, "received");
+	pushTop(stats.getTopSent(limit));
+	lua_setfield(L, -2, "sent");
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetWaitListStats(lua_State* L)
+{
+	// Game.getWaitListStats()
+	const WaitList& waitList = ProtocolGame::getWaitList();
+	lua_createtable(L, 0, 6);
+	setField(L, "size", waitList.size());
+	setField(L, "priority", waitList.getPrioritySize());
+	setField(L, "longestWait", waitList.getLongestWait(OTSYS_TIME()));
+	setField(L, "averageWait", waitList.getAverageWait());
+	setField(L, "admitted", waitList.getAdmittedCount());
+	setField(L, "timedOut", waitList.getTimedOutCount());
+	return 1;
+}
+
+int LuaScriptInterface::luaGameGetDatabaseTaskStats(lua_State* L)
+{
+	// Game.getDatabaseTaskStats()
+	const DatabaseTasks::Stats stats = g_databaseTasks.getStats();
+	lua_createtable(L, 0, 7);
+	setField(L, "workers", stats.workers);
+	setField(L, "queued", stats.queued);
+	setField(L, "maxQueued", stats.maxQueued);
+	setField(L, "completed", stats.completed);
+	setField(L, "averageWait", stats.completed != 0 ? stats.totalWait / static_cast<int64_t>(stats.completed) : 0);
+	setField(L, "averageRun", stats.completed != 0 ? stats.totalRun / static_cast<int64_t>(stats.completed) : 0);
+	setField(L, "maxRun", stats.maxRun);
 	return 1;
 }
 
@@ -5434,11 +6337,11 @@ int LuaScriptInterface::luaPositionGetZones(lua_State* L)
 	if (isTable(L, 1))
 	{
 		auto position = getPosition(L, 1);
-		auto zones = Zones::getZonesByPosition(position);
+		const auto zones = Zones::getZoneIdsByPosition(position);
 		auto index = 0;
 		lua_createtable(L, zones.size(), 0);
 
-		for (auto& zone : zones)
+		for (const int zone : zones)
 		{
 			lua_pushnumber(L, zone);
 			lua_rawseti(L, -2, ++index);
@@ -5457,7 +6360,7 @@ int LuaScriptInterface::luaPositionHasZone(lua_State* L)
 	if (isTable(L, 1))
 	{
 		auto position = getPosition(L, 1);
-		auto zones = Zones::getZonesByPosition(position);
+		const auto zones = Zones::getZoneIdsByPosition(position);
 		if (zones.empty()) 
 		{
 			pushBoolean(L, false);
@@ -5487,8 +6390,7 @@ int LuaScriptInterface::luaTileCreate(lua_State* L)
 	}
 
 	if (tile) {
-		pushSharedPtr(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushSharedPtr(L, tile, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5537,8 +6439,7 @@ int LuaScriptInterface::luaTileGetGround(lua_State* L)
 	// tile:getGround()
 	auto tile = getSharedPtr<Tile>(L, 1);
 	if (tile && tile->getGround()) {
-		pushSharedPtr(L, tile->getGround());
-		setItemMetatable(L, -1, tile->getGround());
+		pushItem(L, tile->getGround());
 	} else {
 		lua_pushnil(L);
 	}
@@ -5562,11 +6463,9 @@ int LuaScriptInterface::luaTileGetThing(lua_State* L)
 	}
 
 	if (const auto creature = thing->getCreature()) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+		pushCreature(L, creature);
 	} else if (const auto item = thing->getItem()) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5601,11 +6500,9 @@ int LuaScriptInterface::luaTileGetTopVisibleThing(lua_State* L)
 	}
 
 	if (const auto visibleCreature = thing->getCreature()) {
-		pushSharedPtr(L, visibleCreature);
-		setCreatureMetatable(L, -1, visibleCreature);
+		pushCreature(L, visibleCreature);
 	} else if (const auto visibleItem = thing->getItem()) {
-		pushSharedPtr(L, visibleItem);
-		setItemMetatable(L, -1, visibleItem);
+		pushItem(L, visibleItem);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5622,8 +6519,7 @@ int LuaScriptInterface::luaTileGetTopTopItem(lua_State* L)
 	}
 
 	if (const auto item = tile->getTopTopItem()) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5640,8 +6536,7 @@ int LuaScriptInterface::luaTileGetTopDownItem(lua_State* L)
 	}
 
 	if (const auto item = tile->getTopDownItem()) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5658,8 +6553,7 @@ int LuaScriptInterface::luaTileGetFieldItem(lua_State* L)
 	}
 
 	if (const auto item = tile->getFieldItem()) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5688,8 +6582,7 @@ int LuaScriptInterface::luaTileGetItemById(lua_State* L)
 	int32_t subType = getNumber<int32_t>(L, 3, -1);
 
 	if (const auto item = g_game.findItemOfType(tile, itemId, false, subType)) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5740,8 +6633,7 @@ int LuaScriptInterface::luaTileGetItemByType(lua_State* L)
 	if (const auto item = tile->getGround()) {
 		const ItemType& it = Item::items[item->getID()];
 		if (it.type == itemType) {
-			pushSharedPtr(L, item);
-			setItemMetatable(L, -1, item);
+			pushItem(L, item);
 			return 1;
 		}
 	}
@@ -5750,8 +6642,7 @@ int LuaScriptInterface::luaTileGetItemByType(lua_State* L)
 		for (const auto item : *items) {
 			const ItemType& it = Item::items[item->getID()];
 			if (it.type == itemType) {
-				pushSharedPtr(L, item);
-				setItemMetatable(L, -1, item);
+				pushItem(L, item);
 				return 1;
 			}
 		}
@@ -5778,8 +6669,7 @@ int LuaScriptInterface::luaTileGetItemByTopOrder(lua_State* L)
 		return 1;
 	}
 
-	pushSharedPtr(L, item);
-	setItemMetatable(L, -1, item);
+	pushItem(L, item);
 	return 1;
 }
 
@@ -5824,8 +6714,7 @@ int LuaScriptInterface::luaTileGetBottomCreature(lua_State* L)
 		return 1;
 	}
 
-	pushSharedPtr(L, creature);
-	setCreatureMetatable(L, -1, creature);
+	pushCreature(L, creature);
 	return 1;
 }
 
@@ -5844,8 +6733,7 @@ int LuaScriptInterface::luaTileGetTopCreature(lua_State* L)
 		return 1;
 	}
 
-	pushSharedPtr(L, creature);
-	setCreatureMetatable(L, -1, creature);
+	pushCreature(L, creature);
 	return 1;
 }
 
@@ -5865,8 +6753,7 @@ int LuaScriptInterface::luaTileGetBottomVisibleCreature(lua_State* L)
 	}
 
 	if (const auto visibleCreature = tile->getBottomVisibleCreature(creature)) {
-		pushSharedPtr(L, visibleCreature);
-		setCreatureMetatable(L, -1, visibleCreature);
+		pushCreature(L, visibleCreature);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5889,8 +6776,7 @@ int LuaScriptInterface::luaTileGetTopVisibleCreature(lua_State* L)
 	}
 
 	if (const auto visibleCreature = tile->getTopVisibleCreature(creature)) {
-		pushSharedPtr(L, visibleCreature);
-		setCreatureMetatable(L, -1, visibleCreature);
+		pushCreature(L, visibleCreature);
 	} else {
 		lua_pushnil(L);
 	}
@@ -5916,8 +6802,7 @@ int LuaScriptInterface::luaTileGetItems(lua_State* L)
 
 	int index = 0;
 	for (const auto item : *itemVector) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -5979,8 +6864,7 @@ int LuaScriptInterface::luaTileGetCreatures(lua_State* L)
 
 	int index = 0;
 	for (const auto creature : *creatureVector) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+		pushCreature(L, creature);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -6086,8 +6970,7 @@ int LuaScriptInterface::luaTileAddItem(lua_State* L)
 	CylinderPtr holder = tile;
 	ReturnValue ret = g_game.internalAddItem(holder, item, INDEX_WHEREEVER, flags);
 	if (ret == RETURNVALUE_NOERROR) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		item.reset();
 		lua_pushnil(L);
@@ -6704,8 +7587,7 @@ int LuaScriptInterface::luaItemCreate(lua_State* L)
 	uint32_t id = getNumber<uint32_t>(L, 2);
 
 	if (const auto item = getScriptEnv()->getItemByUID(id)) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -6794,8 +7676,7 @@ int LuaScriptInterface::luaItemClone(lua_State* L)
 	getScriptEnv()->addTempItem(clone);
 	clone->setParent(VirtualCylinder::virtualCylinder);
 
-	pushSharedPtr(L, clone);
-	setItemMetatable(L, -1, clone);
+	pushItem(L, clone);
 	return 1;
 }
 
@@ -6842,8 +7723,7 @@ int LuaScriptInterface::luaItemSplit(lua_State* L)
 	splitItem->setParent(VirtualCylinder::virtualCylinder);
 	env->addTempItem(splitItem);
 
-	pushSharedPtr(L, splitItem);
-	setItemMetatable(L, -1, splitItem);
+	pushItem(L, splitItem);
 	return 1;
 }
 
@@ -7019,8 +7899,7 @@ int LuaScriptInterface::luaItemGetTile(lua_State* L)
 	}
 
 	if (const auto tile = item->getTile()) {
-		pushSharedPtr(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushSharedPtr(L, tile, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -7067,7 +7946,9 @@ int LuaScriptInterface::luaItemGetAttribute(lua_State* L)
 		attribute = ITEM_ATTRIBUTE_NONE;
 	}
 
-	if (ItemAttributes::isIntAttrType(attribute)) {
+	if (attribute == ITEM_ATTRIBUTE_DURATION) {
+		lua_pushinteger(L, item->getDuration());
+	} else if (ItemAttributes::isIntAttrType(attribute)) {
 		lua_pushinteger(L, item->getIntAttr(attribute));
 	} else if (ItemAttributes::isStrAttrType(attribute)) {
 		pushString(L, item->getStrAttr(attribute));
@@ -7102,7 +7983,20 @@ int LuaScriptInterface::luaItemSetAttribute(lua_State* L)
 			return 1;
 		}
 
-		item->setIntAttr(attribute, getNumber<int32_t>(L, 3));
+		if (attribute == ITEM_ATTRIBUTE_DURATION_TIMESTAMP) {
+			reportErrorFunc(L, "Attempt to set protected key \"durationtimestamp\"");
+			pushBoolean(L, false);
+			return 1;
+		}
+
+		if (attribute == ITEM_ATTRIBUTE_DURATION) {
+			item->setDuration(getNumber<int32_t>(L, 3));
+		} else {
+			item->setIntAttr(attribute, getNumber<int32_t>(L, 3));
+			if (attribute == ITEM_ATTRIBUTE_ACTIONID) {
+				item->flagMoveEventTile();
+			}
+		}
 		pushBoolean(L, true);
 	} else if (ItemAttributes::isStrAttrType(attribute)) {
 		item->setStrAttr(attribute, getString(L, 3));
@@ -7133,6 +8027,10 @@ int LuaScriptInterface::luaItemRemoveAttribute(lua_State* L)
 
 	bool ret = attribute != ITEM_ATTRIBUTE_UNIQUEID;
 	if (ret) {
+		if (attribute == ITEM_ATTRIBUTE_DURATION) {
+			// no duration means no decay, drop the pending one as well
+			item->setDecaying(DECAYING_FALSE);
+		}
 		item->removeAttribute(attribute);
 	} else {
 		reportErrorFunc(L, "Attempt to erase protected key \"uid\"");
@@ -8736,8 +9634,7 @@ int LuaScriptInterface::luaContainerCreate(lua_State* L)
 	const uint32_t id = getNumber<uint32_t>(L, 2);
 
 	if (const auto container = getScriptEnv()->getContainerByUID(id)) {
-		pushSharedPtr(L, container);
-		setMetatable(L, -1, "Container");
+		pushSharedPtr(L, container, LuaData_Container);
 	} else {
 		lua_pushnil(L);
 	}
@@ -8817,8 +9714,7 @@ int LuaScriptInterface::luaContainerGetItem(lua_State* L)
 
 	uint32_t index = getNumber<uint32_t>(L, 2);
 	if (const auto item = container->getItemByIndex(index)) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -8908,12 +9804,10 @@ int LuaScriptInterface::luaContainerAddItem(lua_State* L)
 
 		if (hasTable) {
 			lua_pushinteger(L, i);
-			pushSharedPtr(L, item);
-			setItemMetatable(L, -1, item);
+			pushItem(L, item);
 			lua_settable(L, -3);
 		} else {
-			pushSharedPtr(L, item);
-			setItemMetatable(L, -1, item);
+			pushItem(L, item);
 		}
 	}
 	return 1;
@@ -8962,6 +9856,62 @@ int LuaScriptInterface::luaContainerGetCorpseOwner(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaContainerMoveItemsTo(lua_State* L)
+{
+	// container:moveItemsTo(position or cylinder[, flags = 0])
+	const auto container = getSharedPtr<Container>(L, 1);
+	if (!container) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	CylinderPtr toCylinder;
+	if (isUserdata(L, 2)) {
+		switch (getUserdataType(L, 2)) {
+			case LuaData_Container:
+				toCylinder = getSharedPtr<Container>(L, 2);
+				break;
+			case LuaData_Player:
+				toCylinder = getSharedPtr<Player>(L, 2);
+				break;
+			case LuaData_Tile:
+				toCylinder = getSharedPtr<Tile>(L, 2);
+				break;
+			default:
+				toCylinder = nullptr;
+				break;
+		}
+	} else {
+		toCylinder = g_game.map.getTile(getPosition(L, 2));
+	}
+
+	if (!toCylinder || toCylinder == container) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	// a corpse looted in one go, returns the number of items moved
+	const auto& itemList = container->getItemList();
+	uint32_t movedCount = 0;
+	g_game.internalMoveItems(container, toCylinder, ItemVector(itemList.begin(), itemList.end()), getNumber<uint32_t>(L, 3, 0), nullptr, movedCount);
+	lua_pushinteger(L, movedCount);
+	return 1;
+}
+
+int LuaScriptInterface::luaContainerCreateLoot(lua_State* L)
+{
+	// container:createLoot(monsterType)
+	const auto container = getSharedPtr<Container>(L, 1);
+	MonsterType* monsterType = getUserdata<MonsterType>(L, 2);
+	if (!container || !monsterType) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	pushBoolean(L, monsterType->createLoot(container));
+	return 1;
+}
+
 int LuaScriptInterface::luaContainerGetItemCountById(lua_State* L)
 {
 	// container:getItemCountById(itemId[, subType = -1])
@@ -9014,8 +9964,7 @@ int LuaScriptInterface::luaContainerGetItems(lua_State* L)
 
 	int index = 0;
 	for (const auto item : items) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -9028,8 +9977,7 @@ int LuaScriptInterface::luaTeleportCreate(lua_State* L)
 	const uint32_t id = getNumber<uint32_t>(L, 2);
 
 	if (const auto item = getScriptEnv()->getItemByUID(id); item && item->getTeleport()) {
-		pushSharedPtr(L, item);
-		setMetatable(L, -1, "Teleport");
+		pushSharedPtr(L, item, LuaData_Teleport);
 	} else {
 		lua_pushnil(L);
 	}
@@ -9087,8 +10035,7 @@ int LuaScriptInterface::luaCreatureCreate(lua_State* L)
 	}
 
 	if (creature) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+		pushCreature(L, creature);
 	} else {
 		lua_pushnil(L);
 	}
@@ -9309,8 +10256,7 @@ int LuaScriptInterface::luaCreatureGetTarget(lua_State* L)
 	}
 
 	if (const auto target = creature->getAttackedCreature()) {
-		pushSharedPtr(L, target);
-		setCreatureMetatable(L, -1, target);
+		pushCreature(L, target);
 	} else {
 		lua_pushnil(L);
 	}
@@ -9338,8 +10284,7 @@ int LuaScriptInterface::luaCreatureGetFollowCreature(lua_State* L)
 	}
 
 	if (const auto followCreature = creature->getFollowCreature()) {
-		pushSharedPtr(L, followCreature);
-		setCreatureMetatable(L, -1, followCreature);
+		pushCreature(L, followCreature);
 	} else {
 		lua_pushnil(L);
 	}
@@ -9372,8 +10317,7 @@ int LuaScriptInterface::luaCreatureGetMaster(lua_State* L)
 		return 1;
 	}
 
-	pushSharedPtr(L, master);
-	setCreatureMetatable(L, -1, master);
+	pushCreature(L, master);
 	return 1;
 }
 
@@ -9509,8 +10453,7 @@ int LuaScriptInterface::luaCreatureGetTile(lua_State* L)
 	}
 
 	if (const auto tile = creature->getTile()) {
-		pushSharedPtr(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushSharedPtr(L, tile, LuaData_Tile);
 	} else {
 		lua_pushnil(L);
 	}
@@ -9935,8 +10878,7 @@ int LuaScriptInterface::luaCreatureGetSummons(lua_State* L)
 
 	int index = 0;
 	for (const auto summon : creature->getSummons()) {
-		pushSharedPtr(L, summon);
-		setCreatureMetatable(L, -1, summon);
+		pushCreature(L, summon);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -10522,8 +11464,7 @@ int LuaScriptInterface::luaPlayerCreate(lua_State* L)
 	}
 
 	if (player) {
-		pushSharedPtr(L, player);
-		setMetatable(L, -1, "Player");
+		pushSharedPtr(L, player, LuaData_Player);
 	} else {
 		lua_pushnil(L);
 	}
@@ -10680,12 +11621,14 @@ int LuaScriptInterface::luaPlayerGetDepotChest(lua_State* L)
 		return 1;
 	}
 
+	// scripts read them right away, they can not wait for the database workers
+	IOLoginData::loadPlayerSections(player);
+
 	const uint32_t depotId = getNumber<uint32_t>(L, 2);
 	const bool autoCreate = getBoolean(L, 3, true);
 
 	if (const auto depotChest = player->getDepotChest(depotId, autoCreate)) {
-		pushSharedPtr(L, depotChest);
-		setItemMetatable(L, -1, depotChest);
+		pushItem(L, depotChest);
 	} else {
 		pushBoolean(L, false);
 	}
@@ -10701,9 +11644,11 @@ int LuaScriptInterface::luaPlayerGetInbox(lua_State* L)
 		return 1;
 	}
 
+	// scripts read them right away, they can not wait for the database workers
+	IOLoginData::loadPlayerSections(player);
+
 	if (const auto inbox = player->getInbox()) {
-		pushSharedPtr(L, inbox);
-		setItemMetatable(L, -1, inbox);
+		pushItem(L, inbox);
 	} else {
 		pushBoolean(L, false);
 	}
@@ -10719,9 +11664,11 @@ int LuaScriptInterface::luaPlayerGetRewardChest(lua_State* L)
 		return 1;
 	}
 
+	// scripts read them right away, they can not wait for the database workers
+	IOLoginData::loadPlayerSections(player);
+
 	if (const auto rewardChest = player->getRewardChest()) {
-		pushSharedPtr(L, rewardChest);
-		setItemMetatable(L, -1, rewardChest);
+		pushItem(L, rewardChest);
 	}
 	else {
 		pushBoolean(L, false);
@@ -11190,8 +12137,7 @@ int LuaScriptInterface::luaPlayerGetItemById(lua_State* L)
 	const int32_t subType = getNumber<int32_t>(L, 4, -1);
 
 	if (const auto item = g_game.findItemOfType(player, itemId, deepSearch, subType)) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -11545,6 +12491,85 @@ int LuaScriptInterface::luaPlayerSetStorageValue(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaPlayerGetStorageValues(lua_State* L)
+{
+	// player:getStorageValues(key, ...) or player:getStorageValues({keys})
+	// the values in the order of the keys, as values or in a table like the keys were given
+	const auto player = getSharedPtr<Player>(L, 1);
+	if (!player) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	if (isTable(L, 2)) {
+		const int length = static_cast<int>(lua_rawlen(L, 2));
+		lua_createtable(L, length, 0);
+		for (int i = 1; i <= length; ++i) {
+			lua_rawgeti(L, 2, i);
+			const uint32_t key = getNumber<uint32_t>(L, -1);
+			lua_pop(L, 1);
+
+			int32_t value;
+			player->getStorageValue(key, value);
+			lua_pushinteger(L, value);
+			lua_rawseti(L, -2, i);
+		}
+		return 1;
+	}
+
+	const int parameters = lua_gettop(L);
+	if (!lua_checkstack(L, parameters)) {
+		reportErrorFunc(L, "Too many storage keys.");
+		lua_pushnil(L);
+		return 1;
+	}
+
+	for (int i = 2; i <= parameters; ++i) {
+		int32_t value;
+		player->getStorageValue(getNumber<uint32_t>(L, i), value);
+		lua_pushinteger(L, value);
+	}
+	return parameters - 1;
+}
+
+int LuaScriptInterface::luaPlayerSetStorageValues(lua_State* L)
+{
+	// player:setStorageValues({[key] = value, ...})
+	const auto player = getSharedPtr<Player>(L, 1);
+	if (!player) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	if (!isTable(L, 2)) {
+		reportErrorFunc(L, "values parameter should be a table.");
+		pushBoolean(L, false);
+		return 1;
+	}
+
+	// checked up front, a reserved key leaves every value as it was
+	std::vector<std::pair<uint32_t, int32_t>> values;
+	lua_pushnil(L);
+	while (lua_next(L, 2) != 0) {
+		const uint32_t key = getNumber<uint32_t>(L, -2);
+		if (IS_IN_KEYRANGE(key, RESERVED_RANGE)) {
+			lua_pop(L, 2);
+			reportErrorFunc(L, fmt::format("Accessing reserved range: {:d}", key));
+			pushBoolean(L, false);
+			return 1;
+		}
+
+		values.emplace_back(key, getNumber<int32_t>(L, -1));
+		lua_pop(L, 1);
+	}
+
+	for (const auto& [key, value] : values) {
+		player->addStorageValue(key, value);
+	}
+	pushBoolean(L, true);
+	return 1;
+}
+
 int LuaScriptInterface::luaPlayerAddItem(lua_State* L)
 {
 	// player:addItem(itemId[, count = 1[, canDropOnMap = true[, subType = 1[, slot = CONST_SLOT_WHEREEVER]]]])
@@ -11620,12 +12645,10 @@ int LuaScriptInterface::luaPlayerAddItem(lua_State* L)
 
 		if (hasTable) {
 			lua_pushinteger(L, i);
-			pushSharedPtr(L, item);
-			setItemMetatable(L, -1, item);
+			pushItem(L, item);
 			lua_settable(L, -3);
 		} else {
-			pushSharedPtr(L, item);
-			setItemMetatable(L, -1, item);
+			pushItem(L, item);
 		}
 	}
 	return 1;
@@ -11919,8 +12942,7 @@ int LuaScriptInterface::luaPlayerGetSlotItem(lua_State* L)
 	}
 
 	if (const auto item = thing->getItem()) {
-		pushSharedPtr(L, item);
-		setItemMetatable(L, -1, item);
+		pushItem(L, item);
 	} else {
 		lua_pushnil(L);
 	}
@@ -12256,6 +13278,28 @@ int LuaScriptInterface::luaPlayerHasLearnedSpell(lua_State* L)
 	return 1;
 }
 
+int LuaScriptInterface::luaPlayerGetMemoryUsage(lua_State* L)
+{
+	// player:getMemoryUsage()
+	const auto player = getSharedPtr<Player>(L, 1);
+	if (!player) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	const Player::MemoryUsage usage = player->getMemoryUsage();
+	lua_createtable(L, 0, 8);
+	setField(L, "openContainers", usage.openContainers);
+	setField(L, "depotChests", usage.depotChests);
+	setField(L, "shopItems", usage.shopItems);
+	setField(L, "learnedSpells", usage.learnedSpells);
+	setField(L, "outfits", usage.outfits);
+	setField(L, "vipList", usage.vipList);
+	setField(L, "attackedSet", usage.attackedSet);
+	setField(L, "conditions", usage.conditions);
+	return 1;
+}
+
 int LuaScriptInterface::luaPlayerSendTutorial(lua_State* L)
 {
 	// player:sendTutorial(tutorialId)
@@ -12418,7 +13462,7 @@ int LuaScriptInterface::luaPlayerSetGhostMode(lua_State* L)
 
 	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, position, true, true);
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
 
 		PlayerPtr spectatorPlayer = std::static_pointer_cast<Player>(spectator);
@@ -12483,8 +13527,7 @@ int LuaScriptInterface::luaPlayerGetContainerById(lua_State* L)
 	}
 
 	if (const auto container = player->getContainerByID(getNumber<uint8_t>(L, 2))) {
-		pushSharedPtr(L, container);
-		setMetatable(L, -1, "Container");
+		pushSharedPtr(L, container, LuaData_Container);
 	} else {
 		lua_pushnil(L);
 	}
@@ -12589,8 +13632,7 @@ int LuaScriptInterface::luaPlayerGetStoreInbox(lua_State* L)
 		return 1;
 	}
 
-	pushSharedPtr(L, storeInbox);
-	setMetatable(L, -1, "Container");
+	pushSharedPtr(L, storeInbox, LuaData_Container);
 	return 1;
 }
 
@@ -12665,8 +13707,7 @@ int LuaScriptInterface::luaPlayerGetEquipment(lua_State* L)
 	lua_newtable(L);
 	int index = 1;
 	for (const auto& item : equipment) {
-		pushSharedPtr(L, item);
-		setMetatable(L, -1, "Item");
+		pushSharedPtr(L, item, LuaData_Item);
 		lua_rawseti(L, -2, index++);
 	}
 	return 1;
@@ -12800,8 +13841,7 @@ int LuaScriptInterface::luaMonsterCreate(lua_State* L)
 	}
 
 	if (monster) {
-		pushSharedPtr(L, monster);
-		setMetatable(L, -1, "Monster");
+		pushSharedPtr(L, monster, LuaData_Monster);
 	} else {
 		lua_pushnil(L);
 	}
@@ -13022,8 +14062,7 @@ int LuaScriptInterface::luaMonsterGetFriendList(lua_State* L)
 
 	int index = 0;
 	for (const auto creature : friendList) {
-		pushSharedPtr(L, creature);
-		setCreatureMetatable(L, -1, creature);
+		pushCreature(L, creature);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -13098,8 +14137,7 @@ int LuaScriptInterface::luaMonsterGetTargetList(lua_State* L)
 	int index = 0;
 	for (const auto weakTarget : targetList) {
 		if (auto creature = weakTarget.lock()) {
-			pushSharedPtr(L, creature);
-			setCreatureMetatable(L, -1, creature);
+			pushCreature(L, creature);
 			lua_rawseti(L, -2, ++index);
 		}
 	}
@@ -13193,8 +14231,7 @@ int LuaScriptInterface::luaNpcCreate(lua_State* L)
 	}
 
 	if (npc) {
-		pushSharedPtr(L, npc);
-		setMetatable(L, -1, "Npc");
+		pushSharedPtr(L, npc, LuaData_Npc);
 	} else {
 		lua_pushnil(L);
 	}
@@ -13282,8 +14319,7 @@ int LuaScriptInterface::luaNpcGetSpectators(lua_State* L)
 	int index = 0;
 
 	for (const auto& spectatorPlayer : npc->getSpectators()) {
-		pushSharedPtr(L, spectatorPlayer);
-		setMetatable(L, -1, "Player");
+		pushSharedPtr(L, spectatorPlayer, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -13340,8 +14376,7 @@ int LuaScriptInterface::luaGuildGetMembersOnline(lua_State* L)
 
 	int index = 0;
 	for (const auto player : members) {
-		pushSharedPtr(L, player);
-		setMetatable(L, -1, "Player");
+		pushSharedPtr(L, player, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -14068,8 +15103,7 @@ int LuaScriptInterface::luaHouseGetBeds(lua_State* L)
 
 	int index = 0;
 	for (const auto bedItem : beds) {
-		pushSharedPtr(L, bedItem);
-		setItemMetatable(L, -1, bedItem);
+		pushItem(L, bedItem);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -14100,8 +15134,7 @@ int LuaScriptInterface::luaHouseGetDoors(lua_State* L)
 
 	int index = 0;
 	for (const auto door : doors) {
-		pushSharedPtr(L, door);
-		setItemMetatable(L, -1, door);
+		pushItem(L, door);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -14149,8 +15182,7 @@ int LuaScriptInterface::luaHouseGetTiles(lua_State* L)
 
 	int index = 0;
 	for (const auto tile : tiles) {
-		pushSharedPtr(L, tile);
-		setMetatable(L, -1, "Tile");
+		pushSharedPtr(L, tile, LuaData_Tile);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -14172,8 +15204,7 @@ int LuaScriptInterface::luaHouseGetItems(lua_State* L)
 	for (const auto tile : tiles) {
 		if(const auto itemVector = tile->getItemList()) {
 			for(const auto item : *itemVector) {
-				pushSharedPtr(L, item);
-				setItemMetatable(L, -1, item);
+				pushItem(L, item);
 				lua_rawseti(L, -2, ++index);
 			}
 		}
@@ -15240,7 +16271,11 @@ int LuaScriptInterface::luaCombatSetCallback(lua_State* L)
 	}
 
 	const std::string& function = getString(L, 3);
-	pushBoolean(L, callback->loadCallBack(getScriptEnv()->getScriptInterface(), function));
+	const bool loaded = callback->loadCallBack(getScriptEnv()->getScriptInterface(), function);
+	if (loaded && key == CALLBACK_PARAM_LEVELMAGICVALUE) {
+		static_cast<ValueCallback*>(callback)->compile();
+	}
+	pushBoolean(L, loaded);
 	return 1;
 }
 
@@ -16139,6 +17174,7 @@ int LuaScriptInterface::luaMonsterTypeAddAttack(lua_State* L)
 			spellBlock_t sb;
 			if (g_monsters.deserializeSpell(spell, sb, monsterType->name)) {
 				monsterType->info.attackSpells.push_back(std::move(sb));
+				monsterType->compileSpells();
 			} else {
 				std::cout << monsterType->name << std::endl;
 				std::cout << "[Warning - Monsters::loadMonster] Cant load spell. " << spell->name << std::endl;
@@ -16720,9 +17756,9 @@ int LuaScriptInterface::luaLootSetId(lua_State* L)
 			loot->lootBlock.id = getNumber<uint16_t>(L, 2);
 		} else {
 			auto name = getString(L, 2);
-			auto ids = Item::items.nameToItems.equal_range(asLowerCaseString(name));
+			auto ids = Item::items.getItemIdsByName(name);
 
-			if (ids.first == Item::items.nameToItems.cend()) {
+			if (ids.first == ids.second) {
 				std::cout << "[Warning - Loot:setId] Unknown loot item \"" << name << "\". " << std::endl;
 				pushBoolean(L, false);
 				return 1;
@@ -17452,8 +18488,7 @@ int LuaScriptInterface::luaPartyGetLeader(lua_State* L)
 	}
 
 	if (const auto leader = party->getLeader()) {
-		pushSharedPtr(L, leader);
-		setMetatable(L, -1, "Player");
+		pushSharedPtr(L, leader, LuaData_Player);
 	} else {
 		lua_pushnil(L);
 	}
@@ -17485,8 +18520,7 @@ int LuaScriptInterface::luaPartyGetMembers(lua_State* L)
 	int index = 0;
 	lua_createtable(L, party->getMemberCount(), 0);
 	for (const auto player : party->getMembers()) {
-		pushSharedPtr(L, player);
-		setMetatable(L, -1, "Player");
+		pushSharedPtr(L, player, LuaData_Player);
 		lua_rawseti(L, -2, ++index);
 	}
 	return 1;
@@ -17512,8 +18546,7 @@ int LuaScriptInterface::luaPartyGetInvitees(lua_State* L)
 
 		int index = 0;
 		for (const auto player : party->getInvitees()) {
-			pushSharedPtr(L, player);
-			setMetatable(L, -1, "Player");
+			pushSharedPtr(L, player, LuaData_Player);
 			lua_rawseti(L, -2, ++index);
 		}
 	} else {
@@ -20243,8 +21276,7 @@ int LuaScriptInterface::luaZoneCreatures(lua_State* L)
 						continue;
 					}
 
-					pushSharedPtr(L, creature);
-					setCreatureMetatable(L, -1, creature);
+					pushCreature(L, creature);
 					lua_rawseti(L, -2, ++index);
 				}
 			}
@@ -20269,8 +21301,7 @@ int LuaScriptInterface::luaZoneGrounds(lua_State* L)
 			{
 				if (auto ground = tile->getGround()) 
 				{
-					pushSharedPtr(L, ground);
-					setItemMetatable(L, -1, ground);
+					pushItem(L, ground);
 					lua_rawseti(L, -2, ++index);
 				}
 			}
@@ -20310,8 +21341,7 @@ int LuaScriptInterface::luaZoneItems(lua_State* L)
 							continue;
 						}
 
-						pushSharedPtr(L, item);
-						setItemMetatable(L, -1, item);
+						pushItem(L, item);
 						lua_rawseti(L, -2, ++index);
 					}
 				}
@@ -20348,8 +21378,7 @@ int LuaScriptInterface::luaZoneTiles(lua_State* L)
 				{
 					continue;
 				}
-				pushSharedPtr(L, tile);
-				setMetatable(L, -1, "Tile");
+				pushSharedPtr(L, tile, LuaData_Tile);
 				lua_rawseti(L, -2, ++index);
 			}
 		}
@@ -20500,13 +21529,88 @@ bool LuaEnvironment::initState()
 		return false;
 	}
 
+#ifndef LUAJIT_VERSION
+	void* allocatorData;
+	defaultAllocator = lua_getallocf(luaState, &allocatorData);
+	lua_setallocf(luaState, allocate, allocatorData);
+#endif
+
 	luaL_openlibs(luaState);
 	registerFunctions();
 
+	// empty before the config is loaded
+	if (const std::string& mode = g_config.getString(ConfigManager::LUA_GC_MODE); !mode.empty()) {
+		setGarbageCollector(mode, g_config.getNumber(ConfigManager::LUA_GC_PAUSE), g_config.getNumber(ConfigManager::LUA_GC_STEP_MULTIPLIER));
+	}
+
 	runningEventId = EVENT_ID_USER;
 	return true;
 }
 
+bool LuaEnvironment::setGarbageCollector(std::string_view mode, int32_t pause, int32_t stepMultiplier)
+{
+	if (!luaState) {
+		return false;
+	}
+
+	if (mode == "generational") {
+#if LUA_VERSION_NUM >= 504
+		lua_gc(luaState, LUA_GCGEN, 0, 0);
+		gcMode = mode;
+		return true;
+#else
+		std::cout << "[Warning - LuaEnvironment::setGarbageCollector] The generational collector needs Lua 5.4, keeping the incremental one." << std::endl;
+		mode = "incremental";
+#endif
+	}
+
+	if (mode != "incremental") {
+		std::cout << "[Warning - LuaEnvironment::setGarbageCollector] Unknown collector mode: " << mode << std::endl;
+		return false;
+	}
+
+#if LUA_VERSION_NUM >= 504
+	lua_gc(luaState, LUA_GCINC, std::max<int32_t>(0, pause), std::max<int32_t>(0, stepMultiplier), 0);
+#else
+	if (pause > 0) {
+		lua_gc(luaState, LUA_GCSETPAUSE, pause);
+	}
+	if (stepMultiplier > 0) {
+		lua_gc(luaState, LUA_GCSETSTEPMUL, stepMultiplier);
+	}
+#endif
+	gcMode = mode;
+	return true;
+}
+
+bool LuaEnvironment::collectIdleStep()
+{
+	const int32_t stepSize = g_config.getNumber(ConfigManager::LUA_GC_IDLE_STEP);
+	if (!luaState || stepSize <= 0) {
+		return false;
+	}
+
+	// a finished cycle waits for the scripts to allocate another step before the next one starts
+	const int32_t kilobytes = lua_gc(luaState, LUA_GCCOUNT, 0);
+	if (idleCycleKilobytes != 0 && kilobytes < idleCycleKilobytes + stepSize) {
+		return false;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const bool finished = lua_gc(luaState, LUA_GCSTEP, stepSize) != 0;
+	gcStats.idleTime += std::chrono::steady_clock::now() - start;
+	++gcStats.idleSteps;
+
+	if (finished) {
+		++gcStats.idleCycles;
+		idleCycleKilobytes = lua_gc(luaState, LUA_GCCOUNT, 0);
+		return false;
+	}
+
+	idleCycleKilobytes = 0;
+	return true;
+}
+
 bool LuaEnvironment::reInitState()
 {
 	// TODO: get children, reload children
@@ -20528,17 +21632,24 @@ bool LuaEnvironment::closeState()
 		clearAreaObjects(areaEntry.first);
 	}
 
-	for (auto& timerEntry : timerEvents) {
-		LuaTimerEventDesc timerEventDesc = std::move(timerEntry.second);
+	for (const auto& [eventId, index] : timerEventIndexes) {
+		const LuaTimerEventDesc& timerEventDesc = timerEvents[index];
 		for (int32_t parameter : timerEventDesc.parameters) {
 			luaL_unref(luaState, LUA_REGISTRYINDEX, parameter);
 		}
 		luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
 	}
 
+	g_scheduler.stopEvent(armedSchedulerEvent);
+	armedSchedulerEvent = 0;
+	++timerGeneration;
+
 	combatIdMap.clear();
 	areaIdMap.clear();
 	timerEvents.clear();
+	freeTimerEvents.clear();
+	timerEventIndexes.clear();
+	timerDeadlines = {};
 	cacheFiles.clear();
 
 	lua_close(luaState);
@@ -20621,15 +21732,109 @@ void LuaEnvironment::clearAreaObjects(LuaScriptInterface* interface)
 	it->second.clear();
 }
 
-void LuaEnvironment::executeTimerEvent(uint32_t eventIndex)
+uint32_t LuaEnvironment::acquireTimerEvent()
+{
+	if (freeTimerEvents.empty()) {
+		timerEvents.emplace_back();
+		return timerEvents.size() - 1;
+	}
+
+	const uint32_t index = freeTimerEvents.back();
+	freeTimerEvents.pop_back();
+	return index;
+}
+
+uint32_t LuaEnvironment::startTimerEvent(uint32_t index, uint32_t delay)
+{
+	// 0 is never handed out, stopEvent would take it for a missing timer
+	if (lastEventTimerId == 0) {
+		++lastEventTimerId;
+	}
+
+	const uint32_t eventId = lastEventTimerId++;
+	timerEvents[index].eventId = eventId;
+	timerEventIndexes[eventId] = index;
+	timerDeadlines.push({std::chrono::steady_clock::now() + std::chrono::milliseconds(delay), eventId, index});
+	armTimerEvents();
+	return eventId;
+}
+
+bool LuaEnvironment::stopTimerEvent(uint32_t eventId)
+{
+	auto it = timerEventIndexes.find(eventId);
+	if (it == timerEventIndexes.end()) {
+		return false;
+	}
+
+	const uint32_t index = it->second;
+	timerEventIndexes.erase(it);
+	releaseTimerEvent(index);
+	return true;
+}
+
+void LuaEnvironment::releaseTimerEvent(uint32_t index)
+{
+	LuaTimerEventDesc& timerEventDesc = timerEvents[index];
+	luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
+	for (auto parameter : timerEventDesc.parameters) {
+		luaL_unref(luaState, LUA_REGISTRYINDEX, parameter);
+	}
+
+	timerEventDesc.parameters.clear();
+	timerEventDesc.function = -1;
+	timerEventDesc.scriptInterface = nullptr;
+	timerEventDesc.eventId = 0;
+	freeTimerEvents.push_back(index);
+}
+
+void LuaEnvironment::armTimerEvents()
+{
+	while (!timerDeadlines.empty() && timerEvents[timerDeadlines.top().index].eventId != timerDeadlines.top().eventId) {
+		timerDeadlines.pop();
+	}
+
+	if (timerDeadlines.empty()) {
+		return;
+	}
+
+	const auto deadline = timerDeadlines.top().deadline;
+	if (armedSchedulerEvent != 0) {
+		if (armedDeadline <= deadline) {
+			return;
+		}
+		g_scheduler.stopEvent(armedSchedulerEvent);
+	}
+
+	const auto delay = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+	armedDeadline = deadline;
+	armedSchedulerEvent = g_scheduler.addEvent(createSchedulerTask(static_cast<uint32_t>(std::max<int64_t>(0, delay)), []() { g_luaEnvironment.executeTimerEvents(); }));
+}
+
+void LuaEnvironment::executeTimerEvents()
+{
+	armedSchedulerEvent = 0;
+
+	const auto until = std::chrono::steady_clock::now() + TIMER_BATCH_WINDOW;
+	const uint32_t generation = timerGeneration;
+	while (!timerDeadlines.empty() && timerDeadlines.top().deadline <= until && generation == timerGeneration) {
+		const LuaTimerDeadline due = timerDeadlines.top();
+		timerDeadlines.pop();
+		executeTimerEvent(due);
+	}
+	armTimerEvents();
+}
+
+void LuaEnvironment::executeTimerEvent(const LuaTimerDeadline& due)
 {
-	auto it = timerEvents.find(eventIndex);
-	if (it == timerEvents.end()) {
+	LuaTimerEventDesc& timerEventDesc = timerEvents[due.index];
+	if (timerEventDesc.eventId != due.eventId) {
+		// stopped meanwhile
 		return;
 	}
 
-	LuaTimerEventDesc timerEventDesc = std::move(it->second);
-	timerEvents.erase(it);
+	// gone before the call, stopEvent from within the callback finds nothing
+	timerEventIndexes.erase(due.eventId);
+	timerEventDesc.eventId = 0;
 
 	//push function
 	lua_rawgeti(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
@@ -20640,6 +21845,7 @@ void LuaEnvironment::executeTimerEvent(uint32_t eventIndex)
 	}
 
 	//call the function
+	const uint32_t generation = timerGeneration;
 	if (reserveScriptEnv()) {
 		ScriptEnvironment* env = getScriptEnv();
 		env->setTimerEvent();
@@ -20649,9 +21855,26 @@ void LuaEnvironment::executeTimerEvent(uint32_t eventIndex)
 		std::cout << "[Error - LuaScriptInterface::executeTimerEvent] Call stack overflow" << std::endl;
 	}
 
-	//free resources
-	luaL_unref(luaState, LUA_REGISTRYINDEX, timerEventDesc.function);
-	for (auto parameter : timerEventDesc.parameters) {
-		luaL_unref(luaState, LUA_REGISTRYINDEX, parameter);
+	//free resources, unless the state went away with them
+	if (generation == timerGeneration) {
+		releaseTimerEvent(due.index);
+	}
+}
+
+std::map<std::string, uint32_t> LuaEnvironment::getPendingTimerEvents() const
+{
+	const auto& interfaces = getInterfaces();
+	std::map<std::string, uint32_t> pending;
+	for (const auto& [eventId, index] : timerEventIndexes) {
+		const LuaTimerEventDesc& timerEventDesc = timerEvents[index];
+		LuaScriptInterface* scriptInterface = timerEventDesc.scriptInterface;
+		if (!scriptInterface || std::find(interfaces.begin(), interfaces.end(), scriptInterface) == interfaces.end()) {
+			++pending["(unloaded script)"];
+		} else if (timerEventDesc.scriptId == EVENT_ID_LOADING) {
+			++pending[scriptInterface->getInterfaceName() + " (while loading)"];
+		} else {
+			++pending[scriptInterface->getFileById(timerEventDesc.scriptId)];
+		}
 	}
+	return pending;
 }
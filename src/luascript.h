@@ -29,6 +29,8 @@
 #include <fmt/format.h>
 #include "declarations.h"
 #include <gtl/phmap.hpp>
+#include <deque>
+#include <queue>
 
 class AreaCombat;
 class Combat;
@@ -82,12 +84,26 @@ struct LuaTimerEventDesc {
 	int32_t scriptId = -1;
 	int32_t function = -1;
 	std::vector<int32_t> parameters;
+	// only to name the script in the pending timer counts, checked against the live interfaces
+	LuaScriptInterface* scriptInterface = nullptr;
+	// the id scripts hold, 0 while the entry is unused
 	uint32_t eventId = 0;
 
 	LuaTimerEventDesc() = default;
 	LuaTimerEventDesc(LuaTimerEventDesc&& other) = default;
 };
 
+struct LuaTimerDeadline {
+	std::chrono::steady_clock::time_point deadline;
+	uint32_t eventId;
+	uint32_t index;
+
+	// timers due at the same time fire in the order they were added
+	bool operator>(const LuaTimerDeadline& other) const {
+		return deadline != other.deadline ? deadline > other.deadline : eventId > other.eventId;
+	}
+};
+
 class ScriptEnvironment
 {
 	public:
@@ -201,6 +217,30 @@ class LuaScriptInterface
 		virtual bool initState();
 		bool reInitState();
 
+		// bytes Lua allocated while a script of this interface ran, LuaJIT keeps its own allocator
+		uint64_t getAllocatedBytes() const {
+			return allocatedBytes;
+		}
+
+		struct LoadStats {
+			uint32_t files = 0;
+			// taken from the bytecode cache instead of compiled
+			uint32_t cachedFiles = 0;
+			// microseconds spent on compiling or reading the chunks, and on running them
+			int64_t loadTime = 0;
+			int64_t runTime = 0;
+		};
+
+		// the script files loaded since the interface was last initialized
+		const LoadStats& getLoadStats() const {
+			return loadStats;
+		}
+
+		// every interface alive, for the allocation statistics
+		static const std::vector<LuaScriptInterface*>& getInterfaces() {
+			return getInterfaceList();
+		}
+
 		int32_t loadFile(const std::string& file, NpcPtr npc = nullptr);
 
 		const std::string& getFileById(int32_t scriptId);
@@ -267,13 +307,48 @@ class LuaScriptInterface
 			new (lua_newuserdata(L, sizeof(T))) T(std::move(value));
 		}
 
+		// pushes value with the metatable of type, reusing the userdata Lua still
+		// holds for the same object and metatable instead of allocating another
+		template<class T>
+		static void pushSharedPtr(lua_State* L, const T& value, LuaDataType type)
+		{
+			const void* key = value.get();
+			if (pushCachedUserdata(L, key, type)) {
+				return;
+			}
+
+			new (lua_newuserdata(L, sizeof(T))) T(value);
+			cacheUserdata(L, key, type);
+		}
+
+		template<class T>
+		static void pushItem(lua_State* L, const T& item)
+		{
+			if (item->getContainer()) {
+				pushSharedPtr(L, item, LuaData_Container);
+			} else if (item->getTeleport()) {
+				pushSharedPtr(L, item, LuaData_Teleport);
+			} else {
+				pushSharedPtr(L, item, LuaData_Item);
+			}
+		}
+
+		template<class T>
+		static void pushCreature(lua_State* L, const T& creature)
+		{
+			if (creature->getPlayer()) {
+				pushSharedPtr(L, creature, LuaData_Player);
+			} else if (creature->getMonster()) {
+				pushSharedPtr(L, creature, LuaData_Monster);
+			} else {
+				pushSharedPtr(L, creature, LuaData_Npc);
+			}
+		}
+
 		// Metatables
 		static void setMetatable(lua_State* L, int32_t index, const std::string& name);
 		static void setWeakMetatable(lua_State* L, int32_t index, const std::string& name);
 
-		static void setItemMetatable(lua_State* L, int32_t index, const ItemConstPtr& item);
-		static void setCreatureMetatable(lua_State* L, int32_t index, const CreatureConstPtr& creature);
-
 		// Get
 		template<typename T>
 		static typename std::enable_if<std::is_enum<T>::value, T>::type
@@ -488,6 +563,14 @@ class LuaScriptInterface
 
 		static std::string getStackTrace(lua_State* L, const std::string& error_desc);
 
+		// table of the registry holding the userdata pushed by object pointer,
+		// weak so it never keeps one alive, and the metatables at LuaDataType
+		static void pushUserdataCache(lua_State* L);
+		// pushes the userdata cached for key when it still holds key and has the metatable of type
+		static bool pushCachedUserdata(lua_State* L, const void* key, LuaDataType type);
+		// gives the new userdata on top the metatable of type and caches it for key
+		static void cacheUserdata(lua_State* L, const void* key, LuaDataType type);
+
 		static bool getArea(lua_State* L, std::vector<uint32_t>& vec, uint32_t& rows);
 
 		//lua functions
@@ -588,6 +671,11 @@ class LuaScriptInterface
 
 		// Game
 		static int luaGameGetSpectators(lua_State* L);
+		static int luaGameGetSpectatorPositions(lua_State* L);
+		static int luaGameGetSpectatorHealth(lua_State* L);
+		static int luaGameGetAreaPositions(lua_State* L);
+		static int luaGameGetAreaHealth(lua_State* L);
+		static int luaGameIterateSpectators(lua_State* L);
 		static int luaGameGetPlayers(lua_State* L);
 		static int luaGameGetNpcs(lua_State* L);
 		static int luaGameGetMonsters(lua_State* L);
@@ -634,6 +722,35 @@ class LuaScriptInterface
 		static int luaGameSaveAccountStorageValues(lua_State* L);
 
 		static int luaGameSendDiscordWebhook(lua_State* L);
+		static int luaGameGetWebhookStats(lua_State* L);
+
+		static int luaGameGetDispatcherStats(lua_State* L);
+		static int luaGameResetDispatcherStats(lua_State* L);
+		static int luaGameGetQueryStats(lua_State* L);
+		static int luaGameResetQueryStats(lua_State* L);
+		static int luaGameGetAllocationStats(lua_State* L);
+		static int luaGameGetPlayerCosts(lua_State* L);
+		static int luaGameClearBanCache(lua_State* L);
+		static int luaGameGetTickBudget(lua_State* L);
+		static int luaGameSetTickProfiler(lua_State* L);
+		static int luaGameGetDecayStats(lua_State* L);
+		static int luaGameGetFollowPathStats(lua_State* L);
+		static int luaGameGetMonsterActivity(lua_State* L);
+		static int luaGameGetNetworkWriteStats(lua_State* L);
+		static int luaGameGetPacketStats(lua_State* L);
+		static int luaGameGetWaitListStats(lua_State* L);
+		static int luaGameGetDatabaseTaskStats(lua_State* L);
+		static int luaGameStartLuaProfiler(lua_State* L);
+		static int luaGameStopLuaProfiler(lua_State* L);
+		static int luaGameStartTrace(lua_State* L);
+		static int luaGameSetLuaGarbageCollector(lua_State* L);
+		static int luaGameGetLuaGarbageCollectorStats(lua_State* L);
+		static int luaGameGetScriptLoadStats(lua_State* L);
+		static int luaGameGetMemoryReport(lua_State* L);
+		static int luaGameWriteLog(lua_State* L);
+		static int luaGameGetNpcStats(lua_State* L);
+		static int luaGameGetPendingTimers(lua_State* L);
+		static int luaGameCallWorker(lua_State* L);
 
 		// Variant
 		static int luaVariantCreate(lua_State* L);
@@ -902,6 +1019,8 @@ class LuaScriptInterface
 		static int luaContainerAddItem(lua_State* L);
 		static int luaContainerAddItemEx(lua_State* L);
 		static int luaContainerGetCorpseOwner(lua_State* L);
+		static int luaContainerMoveItemsTo(lua_State* L);
+		static int luaContainerCreateLoot(lua_State* L);
 
 		// Teleport
 		static int luaTeleportCreate(lua_State* L);
@@ -1106,6 +1225,8 @@ class LuaScriptInterface
 
 		static int luaPlayerGetStorageValue(lua_State* L);
 		static int luaPlayerSetStorageValue(lua_State* L);
+		static int luaPlayerGetStorageValues(lua_State* L);
+		static int luaPlayerSetStorageValues(lua_State* L);
 
 		static int luaPlayerAddItem(lua_State* L);
 		static int luaPlayerAddItemEx(lua_State* L);
@@ -1151,6 +1272,7 @@ class LuaScriptInterface
 		static int luaPlayerLearnSpell(lua_State* L);
 		static int luaPlayerForgetSpell(lua_State* L);
 		static int luaPlayerHasLearnedSpell(lua_State* L);
+		static int luaPlayerGetMemoryUsage(lua_State* L);
 
 		static int luaPlayerSendTutorial(lua_State* L);
 		static int luaPlayerAddMapMark(lua_State* L);
@@ -1789,6 +1911,16 @@ class LuaScriptInterface
 		static int32_t scriptEnvIndex;
 
 		std::string loadingFile;
+
+		static std::vector<LuaScriptInterface*>& getInterfaceList();
+		// counts what the running interface allocates, then hands over to the allocator of the state
+		static void* allocate(void* ud, void* ptr, size_t osize, size_t nsize);
+
+		static lua_Alloc defaultAllocator;
+		uint64_t allocatedBytes = 0;
+		LoadStats loadStats;
+
+		friend class LuaEnvironment;
 };
 
 class LuaEnvironment : public LuaScriptInterface
@@ -1815,10 +1947,53 @@ class LuaEnvironment : public LuaScriptInterface
 		uint32_t createAreaObject(LuaScriptInterface* interface);
 		void clearAreaObjects(LuaScriptInterface* interface);
 
+		struct GarbageCollectorStats {
+			uint64_t idleSteps = 0;
+			uint64_t idleCycles = 0;
+			std::chrono::nanoseconds idleTime{0};
+		};
+
+		// mode is "incremental" or, on Lua 5.4, "generational", a value of 0 keeps what Lua uses
+		bool setGarbageCollector(std::string_view mode, int32_t pause, int32_t stepMultiplier);
+		const std::string& getGarbageCollectorMode() const {
+			return gcMode;
+		}
+
+		// dispatcher idle hook, one step of the collector, true while it wants to take another
+		bool collectIdleStep();
+		const GarbageCollectorStats& getGarbageCollectorStats() const {
+			return gcStats;
+		}
+
+		// addEvent timers waiting to fire, by the file of the script that added them
+		std::map<std::string, uint32_t> getPendingTimerEvents() const;
+
 	private:
-		void executeTimerEvent(uint32_t eventIndex);
+		// timers due this close after each other fire in the same dispatcher task
+		static constexpr auto TIMER_BATCH_WINDOW = std::chrono::milliseconds(10);
+
+		// an unused entry, its parameters keep the capacity earlier timers gave them
+		uint32_t acquireTimerEvent();
+		uint32_t startTimerEvent(uint32_t index, uint32_t delay);
+		bool stopTimerEvent(uint32_t eventId);
+		void releaseTimerEvent(uint32_t index);
+		void armTimerEvents();
+		void executeTimerEvents();
+		void executeTimerEvent(const LuaTimerDeadline& due);
+
+		// entries are reused once their timer fired or was stopped, a deque keeps
+		// them in place while the callbacks add more
+		std::deque<LuaTimerEventDesc> timerEvents;
+		std::vector<uint32_t> freeTimerEvents;
+		gtl::flat_hash_map<uint32_t, uint32_t> timerEventIndexes;
+		// stopped timers stay in here until they come up and are skipped
+		std::priority_queue<LuaTimerDeadline, std::vector<LuaTimerDeadline>, std::greater<>> timerDeadlines;
+		// one scheduler event, for the earliest timer
+		std::chrono::steady_clock::time_point armedDeadline;
+		uint32_t armedSchedulerEvent = 0;
+		// counts the states closed, a callback reloading the libraries drops every timer
+		uint32_t timerGeneration = 0;
 
-		gtl::node_hash_map<uint32_t, LuaTimerEventDesc> timerEvents;
 		gtl::node_hash_map<uint32_t, Combat_ptr> combatMap;
 		gtl::node_hash_map<uint32_t, AreaCombat*> areaMap;
 
@@ -1827,6 +2002,11 @@ class LuaEnvironment : public LuaScriptInterface
 
 		LuaScriptInterface* testInterface = nullptr;
 
+		GarbageCollectorStats gcStats;
+		std::string gcMode = "incremental";
+		// the memory in use when the idle steps last finished a cycle
+		int32_t idleCycleKilobytes = 0;
+
 		uint32_t lastEventTimerId = 1;
 		uint32_t lastCombatId = 0;
 		uint32_t lastAreaId = 0;
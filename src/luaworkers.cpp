@@ -0,0 +1,220 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "luaworkers.h"
+#include "luascript.h"
+#include "tasks.h"
+#include "threadrole.h"
+#include "tracing.h"
+
+#include <filesystem>
+
+extern Dispatcher g_dispatcher;
+
+LuaWorkers g_luaWorkers;
+
+bool LuaMessageValue::read(lua_State* L, int index, LuaMessageValue& value, int depth/* = 0*/)
+{
+	switch (lua_type(L, index)) {
+		case LUA_TNIL:
+			value.value = std::monostate{};
+			return true;
+
+		case LUA_TBOOLEAN:
+			value.value = lua_toboolean(L, index) != 0;
+			return true;
+
+		case LUA_TNUMBER:
+#if LUA_VERSION_NUM >= 503
+			if (lua_isinteger(L, index)) {
+				value.value = static_cast<int64_t>(lua_tointeger(L, index));
+				return true;
+			}
+#endif
+			value.value = static_cast<double>(lua_tonumber(L, index));
+			return true;
+
+		case LUA_TSTRING: {
+			size_t length;
+			const char* string = lua_tolstring(L, index, &length);
+			value.value = std::string(string, length);
+			return true;
+		}
+
+		case LUA_TTABLE: {
+			if (depth >= MAX_DEPTH) {
+				return false;
+			}
+
+			if (index < 0) {
+				index = lua_gettop(L) + index + 1;
+			}
+
+			Table table;
+			lua_pushnil(L);
+			while (lua_next(L, index) != 0) {
+				LuaMessageValue& key = table.entries.emplace_back();
+				LuaMessageValue& entry = table.entries.emplace_back();
+				if (!read(L, -2, key, depth + 1) || !read(L, -1, entry, depth + 1)) {
+					lua_pop(L, 2);
+					return false;
+				}
+				lua_pop(L, 1);
+			}
+			value.value = std::move(table);
+			return true;
+		}
+
+		default:
+			// functions, userdata and threads belong to the state they live in
+			return false;
+	}
+}
+
+void LuaMessageValue::push(lua_State* L, const LuaMessageValue& value)
+{
+	std::visit([L](const auto& content) {
+		using T = std::decay_t<decltype(content)>;
+		if constexpr (std::is_same_v<T, std::monostate>) {
+			lua_pushnil(L);
+		} else if constexpr (std::is_same_v<T, bool>) {
+			lua_pushboolean(L, content);
+		} else if constexpr (std::is_same_v<T, int64_t>) {
+			lua_pushinteger(L, content);
+		} else if constexpr (std::is_same_v<T, double>) {
+			lua_pushnumber(L, content);
+		} else if constexpr (std::is_same_v<T, std::string>) {
+			lua_pushlstring(L, content.data(), content.size());
+		} else {
+			lua_createtable(L, 0, content.entries.size() / 2);
+			for (size_t i = 0; i + 1 < content.entries.size(); i += 2) {
+				push(L, content.entries[i]);
+				push(L, content.entries[i + 1]);
+				lua_rawset(L, -3);
+			}
+		}
+	}, value.value);
+}
+
+bool LuaWorkers::start(size_t threadCount)
+{
+	std::vector<std::filesystem::path> files;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator("data/workers", error)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".lua") {
+			files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	std::vector<lua_State*> states;
+	for (size_t i = 0; i < threadCount; ++i) {
+		lua_State* L = luaL_newstate();
+		if (!L) {
+			break;
+		}
+
+		luaL_openlibs(L);
+		states.push_back(L);
+		for (const auto& file : files) {
+			if (luaL_dofile(L, file.string().c_str()) != 0) {
+				std::cout << "[Error - LuaWorkers::start] " << LuaScriptInterface::popString(L) << std::endl;
+				for (lua_State* state : states) {
+					lua_close(state);
+				}
+				return false;
+			}
+		}
+	}
+
+	stopping = false;
+	for (lua_State* L : states) {
+		threads.emplace_back(&LuaWorkers::threadMain, this, L);
+	}
+	return true;
+}
+
+void LuaWorkers::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(callLock);
+		stopping = true;
+		calls.clear();
+	}
+	callSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+void LuaWorkers::call(std::string function, LuaMessage arguments, Callback callback)
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(callLock);
+		if (stopping) {
+			return;
+		}
+		calls.push_back({std::move(function), std::move(arguments), std::move(callback)});
+	}
+	callSignal.notify_one();
+}
+
+void LuaWorkers::threadMain(lua_State* L)
+{
+	setThreadRole("lua worker");
+	std::unique_lock<std::mutex> lockGuard(callLock);
+	while (true) {
+		callSignal.wait(lockGuard, [this]() { return stopping || !calls.empty(); });
+		if (stopping) {
+			break;
+		}
+
+		Call call = std::move(calls.front());
+		calls.pop_front();
+		lockGuard.unlock();
+
+		bool success = false;
+		LuaMessage results;
+		const int top = lua_gettop(L);
+		lua_getglobal(L, call.function.c_str());
+		if (!lua_isfunction(L, -1)) {
+			lua_settop(L, top);
+			results.emplace_back().value = fmt::format("worker function {:s} does not exist", call.function);
+		} else {
+			TraceScope trace(TraceRecorder::isRecording() ? g_traceRecorder.intern(call.function) : nullptr, "lua worker");
+			for (const LuaMessageValue& argument : call.arguments) {
+				LuaMessageValue::push(L, argument);
+			}
+
+			if (lua_pcall(L, call.arguments.size(), LUA_MULTRET, 0) != 0) {
+				results.emplace_back().value = LuaScriptInterface::popString(L);
+			} else {
+				success = true;
+				for (int index = top + 1; index <= lua_gettop(L); ++index) {
+					if (!LuaMessageValue::read(L, index, results.emplace_back())) {
+						success = false;
+						results.clear();
+						results.emplace_back().value = fmt::format("worker function {:s} returned a value that can not leave its state", call.function);
+						break;
+					}
+				}
+			}
+			lua_settop(L, top);
+		}
+
+		g_dispatcher.addTask([callback = std::move(call.callback), success, results = std::move(results)]() {
+			callback(success, results);
+		}, DISPATCHER_LANE_BACKGROUND);
+
+		lockGuard.lock();
+	}
+	lockGuard.unlock();
+
+	lua_close(L);
+}
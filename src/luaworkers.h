@@ -0,0 +1,76 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_LUAWORKERS_H
+#define FS_LUAWORKERS_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <variant>
+
+struct lua_State;
+
+// A Lua value copied out of one state to be pushed into another: nil,
+// booleans, numbers, strings and tables of those. A table keeps its keys
+// and values one after the other.
+struct LuaMessageValue
+{
+	struct Table
+	{
+		std::vector<LuaMessageValue> entries;
+	};
+
+	static constexpr int MAX_DEPTH = 16;
+
+	std::variant<std::monostate, bool, int64_t, double, std::string, Table> value;
+
+	// false when the value, or something in it, can not be copied
+	static bool read(lua_State* L, int index, LuaMessageValue& value, int depth = 0);
+	static void push(lua_State* L, const LuaMessageValue& value);
+};
+
+using LuaMessage = std::vector<LuaMessageValue>;
+
+// Lua states of their own, one per worker thread, for script work that needs
+// nothing of the game but what it is given. Every state runs the files of
+// data/workers at start and sees none of the game API. Scripts hand a call to
+// a global function there with Game.callWorker and get its results back as a
+// callback on the dispatcher, that message is all the two sides share.
+class LuaWorkers
+{
+	public:
+		using Callback = std::function<void(bool success, const LuaMessage& results)>;
+
+		// false if a worker script failed to load, no thread runs then
+		bool start(size_t threadCount);
+		void shutdown();
+
+		bool isRunning() const {
+			return !threads.empty();
+		}
+
+		// callback runs on the dispatcher, with the error message as result when the call failed
+		void call(std::string function, LuaMessage arguments, Callback callback);
+
+	private:
+		struct Call
+		{
+			std::string function;
+			LuaMessage arguments;
+			Callback callback;
+		};
+
+		void threadMain(lua_State* L);
+
+		std::vector<std::thread> threads;
+		std::deque<Call> calls;
+		std::mutex callLock;
+		std::condition_variable callSignal;
+		bool stopping = false;
+};
+
+extern LuaWorkers g_luaWorkers;
+
+#endif
@@ -4,11 +4,66 @@
 #include "otpch.h"
 
 #include "mailbox.h"
+#include "databasetasks.h"
 #include "game.h"
+#include "inbox.h"
 #include "iologindata.h"
+#include "scheduler.h"
 
 extern Game g_game;
 
+namespace {
+
+bool deliverItem(const ItemPtr& item, const PlayerPtr& player)
+{
+	CylinderPtr newParent = CylinderPtr(item->getParent());
+	CylinderPtr inbox = CylinderPtr(player->getInbox());
+	if (g_game.internalMoveItem(newParent, inbox, INDEX_WHEREEVER,
+	                            item, item->getItemCount(), std::nullopt, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+		return false;
+	}
+
+	g_game.transformItem(item, item->getID() + 1);
+	player->onReceiveMail();
+	return true;
+}
+
+// the item has waited where it was dropped for the database to find guid
+void deliverOfflineItem(const ItemPtr& item, const CylinderPtr& parent, uint32_t guid)
+{
+	// no such player or somebody took it in the meantime, it stays where it is
+	if (guid == 0 || item->isRemoved() || item->getParent() != parent) {
+		return;
+	}
+
+	if (const auto player = g_game.getPlayerByGUID(guid)) {
+		deliverItem(item, player);
+		return;
+	}
+
+	// a login reading the inbox right now would not see the rows
+	if (IOLoginData::isLoadingPlayer(guid)) {
+		g_scheduler.addEvent(createSchedulerTask(100, [item, parent, guid]() { deliverOfflineItem(item, parent, guid); }));
+		return;
+	}
+
+	// stamped in an inbox of its own, then only its rows go to the database
+	const auto inbox = std::make_shared<Inbox>(ITEM_INBOX);
+	CylinderPtr newParent = parent;
+	CylinderPtr holder = inbox;
+	if (g_game.internalMoveItem(newParent, holder, INDEX_WHEREEVER,
+	                            item, item->getItemCount(), std::nullopt, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+		return;
+	}
+
+	g_game.transformItem(item, item->getID() + 1);
+	for (const auto& parcel : inbox->getItemList()) {
+		IOLoginData::addInboxItemAsync(guid, parcel);
+	}
+}
+
+}
+
 ReturnValue Mailbox::queryAdd(int32_t, const ThingPtr& thing, uint32_t, uint32_t, CreaturePtr)
 {
 	if (const auto& item = thing->getItem(); item && Mailbox::canSend(item)) {
@@ -84,29 +139,17 @@ bool Mailbox::sendItem(const ItemPtr& item) const
 	}
 
 	if (const auto player = g_game.getPlayerByName(receiver)) {
-		CylinderPtr newParent = CylinderPtr(item->getParent());
-		CylinderPtr inbox = CylinderPtr(player->getInbox());
-		if (g_game.internalMoveItem(newParent, inbox, INDEX_WHEREEVER,
-		                            item, item->getItemCount(), std::nullopt, FLAG_NOLIMIT) == RETURNVALUE_NOERROR) {
-			g_game.transformItem(item, item->getID() + 1);
-			player->onReceiveMail();
-			return true;
-		}
-	} else {
-		PlayerPtr tmpPlayer(nullptr);
-		if (!IOLoginData::loadPlayerByName(tmpPlayer, receiver)) {
-			return false;
-		}
-		CylinderPtr newParent = CylinderPtr(item->getParent());
-		CylinderPtr inbox = CylinderPtr(tmpPlayer->getInbox());
-		if (g_game.internalMoveItem(newParent, inbox, INDEX_WHEREEVER,
-		                            item, item->getItemCount(), std::nullopt, FLAG_NOLIMIT) == RETURNVALUE_NOERROR) {
-			g_game.transformItem(item, item->getID() + 1);
-			IOLoginData::savePlayer(tmpPlayer);
-			return true;
-		}
+		return deliverItem(item, player);
 	}
-	return false;
+
+	// the receiver is looked up on the database thread, the item stays until then
+	auto guid = std::make_shared<uint32_t>(0);
+	return g_databaseTasks.addJob([guid, receiver](Database& db) {
+		*guid = IOLoginData::getGuidByName(db, receiver);
+		return true;
+	}, [item, parent = item->getParent(), guid](bool) {
+		deliverOfflineItem(item, parent, *guid);
+	}, 0, DISPATCHER_LANE_PLAYER);
 }
 
 bool Mailbox::getReceiver(const ItemPtr& item, std::string& name) const
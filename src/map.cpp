@@ -9,17 +9,44 @@
 #include "creature.h"
 #include "game.h"
 #include "monster.h"
+#include "pathfinding.h"
+#include "tickprofiler.h"
+#include "thinkpool.h"
+
+#include <bit>
+#include <queue>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 extern Game g_game;
+extern Dispatcher g_dispatcher;
 
 bool Map::loadMap(const std::string& identifier, bool loadHouses)
+{
+	if (!loadTiles(identifier)) {
+		return false;
+	}
+
+	loadWorld(loadHouses);
+	return true;
+}
+
+bool Map::loadTiles(const std::string& identifier)
 {
 	IOMap loader;
 	if (!loader.loadMap(this, identifier)) {
 		std::cout << "[Fatal - Map::loadMap] " << loader.getLastErrorString() << std::endl;
 		return false;
 	}
+	return true;
+}
 
+void Map::loadWorld(bool loadHouses)
+{
 	if (!IOMap::loadSpawns(this)) {
 		std::cout << "[Warning - Map::loadMap] Failed to load spawn data." << std::endl;
 	}
@@ -32,7 +59,17 @@ bool Map::loadMap(const std::string& identifier, bool loadHouses)
 		IOMapSerialize::loadHouseInfo();
 		IOMapSerialize::loadHouseItems(this);
 	}
-	return true;
+
+	navigation.build(*this);
+	std::cout << "> Navigation graph: " << navigation.getSectorCount() << " sectors, " << navigation.getAreaCount() << " areas." << std::endl;
+
+	if (!staticTiles.empty()) {
+		std::cout << "> Static tiles: " << staticTiles.size() << " kept packed, " << (staticTiles.getMemoryUsage() >> 20) << " MB." << std::endl;
+	}
+
+#ifdef DENSE_TILE_STORE
+	std::cout << "> Dense tile store: " << tileRegions.getRegionCount() << " regions, " << (tileRegions.getMemoryUsage() >> 20) << " MB." << std::endl;
+#endif
 }
 
 bool Map::save()
@@ -59,22 +96,88 @@ bool Map::save()
 	return saved;
 }
 
+const TilePtr* Map::findTile(const uint16_t x, const uint16_t y, const uint8_t z) const
+{
+	if (z >= MAP_MAX_LAYERS) {
+		return nullptr;
+	}
+
+#ifdef DENSE_TILE_STORE
+	if (const TilePtr* tile = tileRegions.find(x, y, z); tile && *tile) {
+		return tile;
+	}
+#else
+	if (const auto leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y)) {
+		if (const auto floor = leaf->getFloor(z)) {
+			if (const auto& tile = floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK]) {
+				return &tile;
+			}
+		}
+	}
+#endif
+	return nullptr;
+}
+
 TilePtr Map::getTile(const uint16_t x, const uint16_t y, const uint8_t z)
 {
 	if (z >= MAP_MAX_LAYERS) {
 		return nullptr;
 	}
 
-	auto leaf = QTreeNode::getLeafStatic< QTreeLeafNode*, QTreeNode*>(&root, x, y);
-	if (!leaf) {
+	if (const TilePtr* tile = findTile(x, y, z)) {
+		return *tile;
+	}
+
+	// static tiles become real ones the first time they are asked for
+	return staticTiles.empty() ? nullptr : loadStaticTile(x, y, z);
+}
+
+TilePtr Map::getTile(const uint16_t x, const uint16_t y, const uint8_t z, TileLookupHint& hint)
+{
+#ifdef DENSE_TILE_STORE
+	return getTile(x, y, z);
+#else
+	if (z >= MAP_MAX_LAYERS) {
 		return nullptr;
 	}
 
-	auto floor = leaf->getFloor(z);
-	if (!floor) {
+	const uint32_t blockX = x >> FLOOR_BITS;
+	const uint32_t blockY = y >> FLOOR_BITS;
+	if (blockX != hint.blockX || blockY != hint.blockY) {
+		hint.leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+		hint.blockX = blockX;
+		hint.blockY = blockY;
+	}
+
+	if (hint.leaf) {
+		if (const auto floor = hint.leaf->getFloor(z)) {
+			if (const auto& tile = floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK]) {
+				return tile;
+			}
+		}
+	}
+
+	if (staticTiles.empty()) {
 		return nullptr;
 	}
-	return floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK];
+
+	// it may have created the leaf
+	hint = {};
+	return loadStaticTile(x, y, z);
+#endif
+}
+
+TilePtr Map::loadStaticTile(const uint16_t x, const uint16_t y, const uint8_t z)
+{
+	uint32_t flags;
+	std::vector<uint16_t> itemIds;
+	if (!staticTiles.take(x, y, z, flags, itemIds)) {
+		return nullptr;
+	}
+
+	TilePtr tile = IOMap::createStaticTile(x, y, z, flags, itemIds);
+	setTile(x, y, z, tile);
+	return tile;
 }
 
 void Map::setTile(const uint16_t x, const uint16_t y, const uint8_t z, TilePtr& newTile)
@@ -86,6 +189,9 @@ void Map::setTile(const uint16_t x, const uint16_t y, const uint8_t z, TilePtr&
 
 	QTreeLeafNode::newLeaf = false;
 	const auto& leaf = root.createLeaf(x, y, 15);
+#ifdef SPECTATOR_GRID
+	spectatorGrid.addSector(Position(x, y, z));
+#endif
 
 	if (QTreeLeafNode::newLeaf) {
 		//update north
@@ -109,11 +215,16 @@ void Map::setTile(const uint16_t x, const uint16_t y, const uint8_t z, TilePtr&
 		}
 	}
 
+#ifdef DENSE_TILE_STORE
+	// the leaf still holds the creatures, only the tiles move out of it
+	if (auto& tile = tileRegions.create(x, y, z)) {
+#else
 	const auto& floor = leaf->createFloor(z);
 	const uint32_t offsetX = x & FLOOR_MASK;
 	const uint32_t offsetY = y & FLOOR_MASK;
 
 	if (auto& tile = floor->tiles[offsetX][offsetY]) {
+#endif
 		if (const auto& items = newTile->getItemList()) {
 			for (auto it = items->rbegin(), end = items->rend(); it != end; ++it) {
 				tile->addThing(*it);
@@ -125,17 +236,27 @@ void Map::setTile(const uint16_t x, const uint16_t y, const uint8_t z, TilePtr&
 			tile->addThing(ground);
 			newTile->setGround(nullptr);
 		}
+		updateTileState(*tile);
 	} else {
 		tile = newTile;
+		updateTileState(*tile);
 	}
 }
 
-void Map::removeTile(const uint16_t x, const uint16_t y, const uint8_t z) const
+void Map::removeTile(const uint16_t x, const uint16_t y, const uint8_t z)
 {
 	if (z >= MAP_MAX_LAYERS) {
 		return;
 	}
 
+#ifdef DENSE_TILE_STORE
+	const TilePtr* slot = tileRegions.find(x, y, z);
+	if (!slot) {
+		return;
+	}
+
+	if (const auto& tile = *slot) {
+#else
 	const auto& leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
 	if (!leaf) {
 		return;
@@ -147,6 +268,7 @@ void Map::removeTile(const uint16_t x, const uint16_t y, const uint8_t z) const
 	}
 
 	if (const auto& tile = floor->tiles[x & FLOOR_MASK][y & FLOOR_MASK]) {
+#endif
 		if (const auto& creatures = tile->getCreatures()) {
 			for (int32_t i = creatures->size(); --i >= 0;) {
 				if (const auto& player = (*creatures)[i]->getPlayer()) {
@@ -167,6 +289,7 @@ void Map::removeTile(const uint16_t x, const uint16_t y, const uint8_t z) const
 			g_game.internalRemoveItem(ground);
 			tile->setGround(nullptr);
 		}
+		updateTileState(*tile);
 	}
 }
 
@@ -218,6 +341,11 @@ bool Map::placeCreature(const Position& centerPos, CreaturePtr creature, bool ex
 		for (const auto& it : relList) {
 			Position tryPos(centerPos.x + it.first, centerPos.y + it.second, centerPos.z);
 
+			// queryAdd refuses these for every creature, the bits tell without fetching the tile
+			if (isPlacementBlocked(getTileState(tryPos.x, tryPos.y, tryPos.z))) {
+				continue;
+			}
+
 			tile = getTile(tryPos.x, tryPos.y, tryPos.z);
 			if (!tile || (placeInPZ && !tile->hasFlag(TILESTATE_PROTECTIONZONE))) {
 				continue;
@@ -243,7 +371,17 @@ bool Map::placeCreature(const Position& centerPos, CreaturePtr creature, bool ex
 	toCylinder->internalAddThing(creature);
 
 	const Position& dest = toCylinder->getPosition();
-	getQTNode(dest.x, dest.y)->addCreature(creature);
+	getQTNode(dest.x, dest.y)->addCreature(creature, dest);
+#ifdef SPECTATOR_GRID
+	spectatorGrid.addCreature(creature, dest);
+#endif
+
+	SpectatorVec observers;
+	getSpectators(observers, dest, true, true);
+	setObservers(creature, observers);
+	if (const auto& player = creature->getPlayer()) {
+		refreshObservedCreatures(player.get());
+	}
 	return true;
 }
 
@@ -284,12 +422,23 @@ void Map::moveCreature(CreaturePtr& creature, const TilePtr& newTile, bool force
 	// Switch the node ownership
 	if (leaf != new_leaf) {
 		leaf->removeCreature(creature);
-		new_leaf->addCreature(creature);
+		new_leaf->addCreature(creature, newPos);
+	} else {
+		leaf->moveCreature(creature, newPos);
 	}
+#ifdef SPECTATOR_GRID
+	spectatorGrid.moveCreature(creature, oldPos, newPos);
+#endif
 
 	//add the creature
 	newTile->addThing(creature);
 
+	// newPosSpectators is everything around newPos, the players in it are its observers
+	setObservers(creature, newPosSpectators);
+	if (const auto& player = creature->getPlayer()) {
+		refreshObservedCreatures(player.get());
+	}
+
 	if (!teleport) {
 		if (oldPos.y > newPos.y) {
 			creature->setDirection(DIRECTION_NORTH);
@@ -324,7 +473,80 @@ void Map::moveCreature(CreaturePtr& creature, const TilePtr& newTile, bool force
 	newTile->postAddNotification(creature, oldTile, 0);
 }
 
-void Map::getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos, const int32_t minRangeX, const int32_t maxRangeX, const int32_t minRangeY, const int32_t maxRangeY, const int32_t minRangeZ, const int32_t maxRangeZ, const bool onlyPlayers) const
+namespace {
+
+// bounds of a spectator scan in the shifted coordinates of LeafCreatureList,
+// a value v is inside when uint16_t(v - low) <= width
+struct LeafScanBounds
+{
+	uint16_t lowX, widthX;
+	uint16_t lowY, widthY;
+	uint16_t lowZ, widthZ;
+
+	bool contains(uint16_t x, uint16_t y, uint16_t z) const {
+		return static_cast<uint16_t>(x - lowX) <= widthX && static_cast<uint16_t>(y - lowY) <= widthY && static_cast<uint16_t>(z - lowZ) <= widthZ;
+	}
+};
+
+void scanLeafCreatures(SpectatorVec& spectators, const LeafCreatureList& list, const LeafScanBounds& bounds)
+{
+	const size_t count = list.creatures.size();
+	const uint16_t* xs = list.x.data();
+	const uint16_t* ys = list.y.data();
+	const uint16_t* zs = list.z.data();
+	size_t i = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+	// unsigned v - low <= width, as a saturating subtract that leaves zero
+	const __m128i lowX = _mm_set1_epi16(bounds.lowX), widthX = _mm_set1_epi16(bounds.widthX);
+	const __m128i lowY = _mm_set1_epi16(bounds.lowY), widthY = _mm_set1_epi16(bounds.widthY);
+	const __m128i lowZ = _mm_set1_epi16(bounds.lowZ), widthZ = _mm_set1_epi16(bounds.widthZ);
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= count; i += 8) {
+		const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xs + i));
+		const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + i));
+		const __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(zs + i));
+		__m128i outside = _mm_subs_epu16(_mm_sub_epi16(x, lowX), widthX);
+		outside = _mm_or_si128(outside, _mm_subs_epu16(_mm_sub_epi16(y, lowY), widthY));
+		outside = _mm_or_si128(outside, _mm_subs_epu16(_mm_sub_epi16(z, lowZ), widthZ));
+
+		// two mask bits per lane
+		uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi16(outside, zero));
+		while (mask != 0) {
+			spectators.emplace_back(list.creatures[i + (std::countr_zero(mask) >> 1)]);
+			mask &= mask - 1;
+			mask &= mask - 1;
+		}
+	}
+#elif defined(__aarch64__)
+	static constexpr uint16_t laneBits[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+	const uint16x8_t bits = vld1q_u16(laneBits);
+	const uint16x8_t lowX = vdupq_n_u16(bounds.lowX), widthX = vdupq_n_u16(bounds.widthX);
+	const uint16x8_t lowY = vdupq_n_u16(bounds.lowY), widthY = vdupq_n_u16(bounds.widthY);
+	const uint16x8_t lowZ = vdupq_n_u16(bounds.lowZ), widthZ = vdupq_n_u16(bounds.widthZ);
+	for (; i + 8 <= count; i += 8) {
+		uint16x8_t inside = vcleq_u16(vsubq_u16(vld1q_u16(xs + i), lowX), widthX);
+		inside = vandq_u16(inside, vcleq_u16(vsubq_u16(vld1q_u16(ys + i), lowY), widthY));
+		inside = vandq_u16(inside, vcleq_u16(vsubq_u16(vld1q_u16(zs + i), lowZ), widthZ));
+
+		uint32_t mask = vaddvq_u16(vandq_u16(inside, bits));
+		while (mask != 0) {
+			spectators.emplace_back(list.creatures[i + std::countr_zero(mask)]);
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (bounds.contains(xs[i], ys[i], zs[i])) {
+			spectators.emplace_back(list.creatures[i]);
+		}
+	}
+}
+
+}
+
+void Map::getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos, const int32_t minRangeX, const int32_t maxRangeX, const int32_t minRangeY, const int32_t maxRangeY, const int32_t minRangeZ, const int32_t maxRangeZ, const bool onlyPlayers, const ChunkKey* cacheKey/* = nullptr*/) const
 {
     const auto min_y = centerPos.y + minRangeY;
     const auto min_x = centerPos.x + minRangeX;
@@ -346,32 +568,49 @@ void Map::getSpectatorsInternal(SpectatorVec& spectators, const Position& center
         max_x + maxoffset
     };
 
+    // x - offsetZ is x + z - centerPos.z, the list stores x + z
+    const LeafScanBounds bounds{
+        static_cast<uint16_t>(cache_values[2] + centerPos.z), static_cast<uint16_t>(cache_values[3] - cache_values[2]),
+        static_cast<uint16_t>(cache_values[0] + centerPos.z), static_cast<uint16_t>(cache_values[1] - cache_values[0]),
+        static_cast<uint16_t>(minRangeZ), static_cast<uint16_t>(maxRangeZ - minRangeZ)
+    };
+
     const int32_t startx1 = x1 - (x1 % FLOOR_SIZE);
     const int32_t starty1 = y1 - (y1 % FLOOR_SIZE);
     const int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
     const int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
 
+#ifdef SPECTATOR_GRID
+    {
+        std::unique_lock<std::mutex> leafLock(spectatorLeafLock, std::defer_lock);
+        if (cacheKey) {
+            leafLock.lock();
+        }
+
+        // the same per floor window the leaf walk below filters with
+        spectatorGrid.getSpectators(spectators, centerPos, cache_values[2], cache_values[3], cache_values[0], cache_values[1], minRangeZ, maxRangeZ, onlyPlayers, cacheKey);
+        return;
+    }
+#endif
+
     const auto& startLeaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, starty1);
     auto leafS = startLeaf;
 
+    std::unique_lock<std::mutex> leafLock(spectatorLeafLock, std::defer_lock);
+    if (cacheKey) {
+        leafLock.lock();
+    }
+
     for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
         const QTreeLeafNode* leafE = leafS;
         for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
             if (leafE) {
-                const auto& node_list = (onlyPlayers ? leafE->player_list : leafE->creature_list);
-                std::ranges::for_each(node_list, [&](const CreaturePtr& creature) {
-                    const Position& cpos = creature->getPosition();
-                    if (minRangeZ > cpos.z || maxRangeZ < cpos.z) {
-                        return;
-                    }
-
-                    const int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-                    if ((cache_values[0] + offsetZ) > cpos.y || (cache_values[1] + offsetZ) < cpos.y || (cache_values[2] + offsetZ) > cpos.x || (cache_values[3] + offsetZ) < cpos.x) {
-                        return;
-                    }
+                if (cacheKey) {
+                    // a creature entering or leaving this leaf invalidates the cached result
+                    leafE->spectatorCacheKeys.insert(*cacheKey);
+                }
 
-                    spectators.emplace_back(creature);
-                });
+                scanLeafCreatures(spectators, onlyPlayers ? leafE->player_list : leafE->creature_list, bounds);
                 leafE = leafE->leafE;
             } else {
                 leafE = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, nx + FLOOR_SIZE, ny);
@@ -386,8 +625,21 @@ void Map::getSpectatorsInternal(SpectatorVec& spectators, const Position& center
     }
 }
 
+bool Map::mayHaveCreaturesNear(const Position& centerPos, const bool monsters, const int32_t rangeX,
+                               const int32_t rangeY) const
+{
+	// spectators on other floors are looked for shifted by the floor difference
+	const int32_t floorOffset = MAP_MAX_LAYERS;
+	const uint32_t minX = std::max<int32_t>(0, centerPos.x - rangeX - floorOffset);
+	const uint32_t minY = std::max<int32_t>(0, centerPos.y - rangeY - floorOffset);
+	const uint32_t maxX = std::min<int32_t>(0xFFFF, centerPos.x + rangeX + floorOffset);
+	const uint32_t maxY = std::min<int32_t>(0xFFFF, centerPos.y + rangeY + floorOffset);
+	return root.hasCreaturesIn(0, 0, 0x10000, minX, minY, maxX, maxY, monsters);
+}
+
 void Map::getSpectators(SpectatorVec& spectators, const Position& centerPos, const bool multifloor /*= false*/, bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
 {
+    TickPhaseTimer timer(TICK_PHASE_SPECTATORS);
     if (centerPos.z >= MAP_MAX_LAYERS) {
         return;
     }
@@ -400,26 +652,41 @@ void Map::getSpectators(SpectatorVec& spectators, const Position& centerPos, con
     minRangeY = (minRangeY == 0 ? -maxViewportY : -minRangeY);
     maxRangeY = (maxRangeY == 0 ? maxViewportY : maxRangeY);
 
-    chunkKey.minRangeX = minRangeX;
-	chunkKey.maxRangeX = maxRangeX;
-	chunkKey.minRangeY = minRangeY;
-	chunkKey.maxRangeY = maxRangeY;
-	chunkKey.x = centerPos.x;
-	chunkKey.y = centerPos.y;
-	chunkKey.z = centerPos.z;
-	chunkKey.multifloor = multifloor;
-	chunkKey.onlyPlayers = onlyPlayers;
-
-    if (const auto it = chunksSpectatorCache.find(chunkKey); it != chunksSpectatorCache.end()) {
-		if (!spectators.empty()) {
-			spectators.addSpectators(it->second);
-		} else {
-			spectators = it->second;
-		}
-		foundCache = true;
-	} else {
-		cacheResult = true;
-	}
+    const ChunkKey chunkKey{minRangeX, maxRangeX, minRangeY, maxRangeY, centerPos.x, centerPos.y, centerPos.z, multifloor, onlyPlayers};
+
+    // the same question asked again in this task gets the same answer, without locks
+    const bool taskMemo = g_dispatcher.isCurrentThread();
+    if (taskMemo) {
+        if (taskSpectatorsCycle != g_dispatcher.getDispatcherCycle()) {
+            taskSpectators.clear();
+            taskSpectatorsCycle = g_dispatcher.getDispatcherCycle();
+        } else if (const auto it = taskSpectators.find(chunkKey); it != taskSpectators.end()) {
+            if (!spectators.empty()) {
+                spectators.addSpectators(it->second);
+            } else {
+                spectators = it->second;
+            }
+            spectatorCacheHits.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    const bool memoize = taskMemo && spectators.empty();
+
+    ChunkCacheShard& shard = getChunkCacheShard(chunkKey);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.lock);
+        if (const auto it = shard.entries.find(chunkKey); it != shard.entries.end()) {
+            if (!spectators.empty()) {
+                spectators.addSpectators(it->second);
+            } else {
+                spectators = it->second;
+            }
+            foundCache = true;
+        } else {
+            cacheResult = true;
+        }
+    }
 
     if (minRangeX == -maxViewportX && maxRangeX == maxViewportX && minRangeY == -maxViewportY && maxRangeY == maxViewportY && multifloor) {
         if (onlyPlayers) {
@@ -448,38 +715,258 @@ void Map::getSpectators(SpectatorVec& spectators, const Position& centerPos, con
         }
     }
 
-    if (!foundCache) {
+    if (foundCache) {
+        spectatorCacheHits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        spectatorCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
         int32_t minRangeZ;
         int32_t maxRangeZ;
-
-        if (multifloor) {
-            if (centerPos.z > 7) {
-                //underground (8->15)
-                minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-                maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-            } else if (centerPos.z == 6) {
-                minRangeZ = 0;
-                maxRangeZ = 8;
-            } else if (centerPos.z == 7) {
-                minRangeZ = 0;
-                maxRangeZ = 9;
-            } else {
-                minRangeZ = 0;
-                maxRangeZ = 7;
-            }
+        getSpectatorFloors(centerPos, multifloor, minRangeZ, maxRangeZ);
+
+        if (!cacheResult) {
+            getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+        } else if (spectators.empty()) {
+            getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers, &chunkKey);
+            std::unique_lock<std::shared_mutex> lock(shard.lock);
+            shard.entries.emplace(chunkKey, spectators);
         } else {
-            minRangeZ = centerPos.z;
-            maxRangeZ = centerPos.z;
+            // cache only what this area holds, not what the caller passed in
+            SpectatorVec found;
+            getSpectatorsInternal(found, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers, &chunkKey);
+            spectators.addSpectators(found);
+            std::unique_lock<std::shared_mutex> lock(shard.lock);
+            shard.entries.emplace(chunkKey, std::move(found));
         }
+    }
 
-        getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
-
-        if (cacheResult) {
-            chunksSpectatorCache.emplace(chunkKey, spectators);
-        }
+    if (memoize) {
+        taskSpectators.emplace(chunkKey, spectators);
     }
 }
 
+void Map::getEnteringSpectators(SpectatorVec& spectators, const Position& oldPos, const Position& newPos) const
+{
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloors(newPos, true, minRangeZ, maxRangeZ);
+
+	// only the leading column and row came into range, the row leaves out the corner the column has
+	int32_t minRangeX = -maxViewportX;
+	int32_t maxRangeX = maxViewportX;
+	if (newPos.x > oldPos.x) {
+		getSpectatorsInternal(spectators, newPos, maxViewportX, maxViewportX, -maxViewportY, maxViewportY, minRangeZ, maxRangeZ, false);
+		maxRangeX = maxViewportX - 1;
+	} else if (newPos.x < oldPos.x) {
+		getSpectatorsInternal(spectators, newPos, -maxViewportX, -maxViewportX, -maxViewportY, maxViewportY, minRangeZ, maxRangeZ, false);
+		minRangeX = -maxViewportX + 1;
+	}
+
+	if (newPos.y > oldPos.y) {
+		getSpectatorsInternal(spectators, newPos, minRangeX, maxRangeX, maxViewportY, maxViewportY, minRangeZ, maxRangeZ, false);
+	} else if (newPos.y < oldPos.y) {
+		getSpectatorsInternal(spectators, newPos, minRangeX, maxRangeX, -maxViewportY, -maxViewportY, minRangeZ, maxRangeZ, false);
+	}
+}
+
+void Map::getSpectatorFloors(const Position& centerPos, const bool multifloor, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+	if (multifloor) {
+		if (centerPos.z > 7) {
+			//underground (8->15)
+			minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+			maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
+		} else if (centerPos.z == 6) {
+			minRangeZ = 0;
+			maxRangeZ = 8;
+		} else if (centerPos.z == 7) {
+			minRangeZ = 0;
+			maxRangeZ = 9;
+		} else {
+			minRangeZ = 0;
+			maxRangeZ = 7;
+		}
+	} else {
+		minRangeZ = centerPos.z;
+		maxRangeZ = centerPos.z;
+	}
+}
+
+void Map::getSpectators(SpectatorView& spectators, const Position& centerPos, const bool multifloor /*= false*/, const bool onlyPlayers /*= false*/, const int32_t minRangeX /*= 0*/, const int32_t maxRangeX /*= 0*/, const int32_t minRangeY /*= 0*/, const int32_t maxRangeY /*= 0*/)
+{
+	TickPhaseTimer timer(TICK_PHASE_SPECTATORS);
+	if (centerPos.z >= MAP_MAX_LAYERS) {
+		return;
+	}
+
+	// normalized like the owning overload so both share cache entries
+	const ChunkKey chunkKey{
+		minRangeX == 0 ? -maxViewportX : -minRangeX, maxRangeX == 0 ? maxViewportX : maxRangeX,
+		minRangeY == 0 ? -maxViewportY : -minRangeY, maxRangeY == 0 ? maxViewportY : maxRangeY,
+		centerPos.x, centerPos.y, centerPos.z, multifloor, onlyPlayers
+	};
+	ChunkCacheShard& shard = getChunkCacheShard(chunkKey);
+
+	{
+		std::shared_lock<std::shared_mutex> lock(shard.lock);
+		if (const auto it = shard.entries.find(chunkKey); it != shard.entries.end()) {
+			spectators.addSpectators(it->second);
+			spectatorCacheHits.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	// a miss builds the owning cache entry, the creatures stay referenced by it
+	SpectatorVec found;
+	getSpectators(found, centerPos, multifloor, onlyPlayers, minRangeX, maxRangeX, minRangeY, maxRangeY);
+	spectators.addSpectators(found);
+}
+
+void Map::clearChunkSpectatorCache(const Position& pos)
+{
+	taskSpectators.clear();
+
+#ifdef SPECTATOR_GRID
+	std::lock_guard<std::mutex> leafLock(spectatorLeafLock);
+	std::vector<ChunkKey> keys;
+	spectatorGrid.takeCacheKeys(pos, keys);
+	for (const ChunkKey& key : keys) {
+		ChunkCacheShard& shard = getChunkCacheShard(key);
+		std::unique_lock<std::shared_mutex> lock(shard.lock);
+		shard.entries.erase(key);
+	}
+#else
+	const QTreeLeafNode* leaf = getQTNode(pos.x, pos.y);
+	if (!leaf) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> leafLock(spectatorLeafLock);
+	for (const ChunkKey& key : leaf->spectatorCacheKeys) {
+		ChunkCacheShard& shard = getChunkCacheShard(key);
+		std::unique_lock<std::shared_mutex> lock(shard.lock);
+		shard.entries.erase(key);
+	}
+	leaf->spectatorCacheKeys.clear();
+#endif
+}
+
+bool Map::isInSpectatorRange(const Position& centerPos, const Position& pos, const bool multifloor/* = true*/) const
+{
+	int32_t minRangeZ, maxRangeZ;
+	getSpectatorFloors(centerPos, multifloor, minRangeZ, maxRangeZ);
+	if (pos.z < minRangeZ || pos.z > maxRangeZ) {
+		return false;
+	}
+
+	// the window getSpectatorsInternal filters the default viewport with
+	const int32_t minoffset = centerPos.getZ() - maxRangeZ;
+	const int32_t maxoffset = centerPos.getZ() - minRangeZ;
+	const int32_t offsetZ = Position::getOffsetZ(centerPos, pos);
+	if (pos.x < centerPos.x - maxViewportX + minoffset + offsetZ || pos.x > centerPos.x + maxViewportX + maxoffset + offsetZ ||
+	    pos.y < centerPos.y - maxViewportY + minoffset + offsetZ || pos.y > centerPos.y + maxViewportY + maxoffset + offsetZ) {
+		return false;
+	}
+
+#ifndef SPECTATOR_GRID
+	// and the leaves it walks
+	const int32_t x1 = std::clamp<int32_t>(centerPos.x - maxViewportX + minoffset, 0, 0xFFFF);
+	const int32_t y1 = std::clamp<int32_t>(centerPos.y - maxViewportY + minoffset, 0, 0xFFFF);
+	const int32_t x2 = std::clamp<int32_t>(centerPos.x + maxViewportX + maxoffset, 0, 0xFFFF);
+	const int32_t y2 = std::clamp<int32_t>(centerPos.y + maxViewportY + maxoffset, 0, 0xFFFF);
+	if (pos.x < x1 - (x1 % FLOOR_SIZE) || pos.x >= x2 - (x2 % FLOOR_SIZE) + FLOOR_SIZE ||
+	    pos.y < y1 - (y1 % FLOOR_SIZE) || pos.y >= y2 - (y2 % FLOOR_SIZE) + FLOOR_SIZE) {
+		return false;
+	}
+#endif
+	return true;
+}
+
+namespace {
+
+template <typename T>
+void eraseObserverLink(std::vector<T*>& list, const T* value)
+{
+	if (const auto it = std::ranges::find(list, value); it != list.end()) {
+		*it = list.back();
+		list.pop_back();
+	}
+}
+
+}
+
+void Map::setObservers(const CreaturePtr& creature, const SpectatorVec& spectators)
+{
+	Creature* observed = creature.get();
+	for (Player* player : observed->observers) {
+		eraseObserverLink(player->observedCreatures, observed);
+	}
+	observed->observers.clear();
+
+	for (const auto& spectator : spectators) {
+		if (spectator == creature) {
+			continue;
+		}
+
+		if (const auto& player = spectator->getPlayer()) {
+			observed->observers.push_back(player.get());
+			player->observedCreatures.push_back(observed);
+		}
+	}
+
+	// the spectators may have been gathered before the creature arrived
+	if (const auto& player = creature->getPlayer()) {
+		observed->observers.push_back(player.get());
+		player->observedCreatures.push_back(observed);
+	}
+}
+
+void Map::refreshObservedCreatures(Player* player)
+{
+	const Position& playerPos = player->getPosition();
+
+	auto& observedCreatures = player->observedCreatures;
+	for (size_t i = 0; i < observedCreatures.size();) {
+		Creature* creature = observedCreatures[i];
+		if (creature != player && !isInSpectatorRange(creature->getPosition(), playerPos)) {
+			eraseObserverLink(creature->observers, player);
+			observedCreatures[i] = observedCreatures.back();
+			observedCreatures.pop_back();
+		} else {
+			++i;
+		}
+	}
+
+	SpectatorVec candidates;
+	getSpectators(candidates, playerPos, true, false, OBSERVER_SEARCH_RANGE, OBSERVER_SEARCH_RANGE, OBSERVER_SEARCH_RANGE, OBSERVER_SEARCH_RANGE);
+	for (const auto& candidate : candidates) {
+		Creature* creature = candidate.get();
+		if (creature == player || !isInSpectatorRange(creature->getPosition(), playerPos)) {
+			continue;
+		}
+
+		if (std::ranges::find(creature->observers, player) == creature->observers.end()) {
+			creature->observers.push_back(player);
+			observedCreatures.push_back(creature);
+		}
+	}
+}
+
+void Map::removeObservers(Creature* creature)
+{
+	for (Player* player : creature->observers) {
+		eraseObserverLink(player->observedCreatures, creature);
+	}
+	creature->observers.clear();
+
+	if (Player* player = dynamic_cast<Player*>(creature)) {
+		for (Creature* observed : player->observedCreatures) {
+			eraseObserverLink(observed->observers, player);
+		}
+		player->observedCreatures.clear();
+	}
+}
+
 void Map::clearSpectatorCache()
 {
 	spectatorCache.clear();
@@ -490,6 +977,31 @@ void Map::clearPlayersSpectatorCache()
 	playersSpectatorCache.clear();
 }
 
+size_t Map::getSpectatorCacheUsage(size_t& entries)
+{
+	// a node of the maps is counted as its value and two pointers
+	size_t bytes = 0;
+	const auto add = [&](const auto& key, const SpectatorVec& spectators) {
+		++entries;
+		bytes += sizeof(key) + sizeof(SpectatorVec) + 2 * sizeof(void*) + spectators.capacity() * sizeof(CreaturePtr);
+	};
+
+	entries = 0;
+	for (const SpectatorCache* cache : {&spectatorCache, &playersSpectatorCache}) {
+		for (const auto& [pos, spectators] : *cache) {
+			add(pos, spectators);
+		}
+	}
+
+	for (ChunkCacheShard& shard : chunksSpectatorCache) {
+		std::shared_lock<std::shared_mutex> lock(shard.lock);
+		for (const auto& [key, spectators] : shard.entries) {
+			add(key, spectators);
+		}
+	}
+	return bytes;
+}
+
 bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, const bool checkLineOfSight /*= true*/, const bool sameFloor /*= false*/,
                            const int32_t rangex /*= Map::maxClientViewportX*/, const int32_t rangey /*= Map::maxClientViewportY*/)
 {
@@ -502,21 +1014,112 @@ bool Map::canThrowObjectTo(const Position& fromPos, const Position& toPos, const
 
 bool Map::isTileClear(const uint16_t x, const uint16_t y, const uint8_t z, const bool blockFloor /*= false*/)
 {
-	auto tile = getTile(x, y, z);
-	if (!tile) {
+	const uint8_t state = getTileState(x, y, z);
+	if (!(state & TILESTATEBIT_EXISTS)) {
 		return true;
 	}
 
-	if (blockFloor && tile->getGround()) {
+	if (blockFloor && (state & TILESTATEBIT_GROUND)) {
 		return false;
 	}
 
-	return !tile->hasProperty(CONST_PROP_BLOCKPROJECTILE);
+	return !(state & TILESTATEBIT_BLOCKPROJECTILE);
+}
+
+void Map::updateTileState(const Tile& tile)
+{
+	// temporary tiles built for combat areas and scripts share positions with real ones
+	const Position& pos = tile.getPosition();
+	if (const TilePtr* placed = findTile(pos.x, pos.y, pos.z); placed && placed->get() == &tile) {
+		tileEncodings.invalidate(pos);
+		const uint8_t bits = getTileStateBits(tile);
+		if (navigation.isBuilt() && isPathBlocked(bits) != isPathBlocked(tileStates.get(pos.x, pos.y, pos.z))) {
+			// doors opening and closing
+			navigation.invalidate(pos);
+		}
+		tileStates.set(pos.x, pos.y, pos.z, bits);
+	}
+}
+
+uint8_t Map::getTileStateBits(const Tile& tile)
+{
+	uint8_t bits = TILESTATEBIT_EXISTS;
+	if (tile.getGround()) {
+		bits |= TILESTATEBIT_GROUND;
+	}
+	if (tile.hasFlag(TILESTATE_BLOCKSOLID)) {
+		bits |= TILESTATEBIT_BLOCKSOLID;
+	}
+	if (tile.hasFlag(TILESTATE_BLOCKPATH)) {
+		bits |= TILESTATEBIT_BLOCKPATH;
+	}
+	if (tile.hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		bits |= TILESTATEBIT_BLOCKPROJECTILE;
+	}
+	if (tile.hasFlag(TILESTATE_FLOORCHANGE)) {
+		bits |= TILESTATEBIT_FLOORCHANGE;
+	}
+	if (tile.hasFlag(TILESTATE_TELEPORT)) {
+		bits |= TILESTATEBIT_TELEPORT;
+	}
+	return bits;
+}
+
+uint8_t Map::getTileStateBits(const std::vector<uint16_t>& itemIds)
+{
+	// mirrors what Tile::internalAddThing keeps when the tile is built from these ids
+	uint8_t bits = TILESTATEBIT_EXISTS;
+	for (const uint16_t id : itemIds) {
+		const ItemType& it = Item::items[id];
+		if (it.isGroundTile()) {
+			if (bits & TILESTATEBIT_GROUND) {
+				continue;
+			}
+			bits |= TILESTATEBIT_GROUND;
+		}
+
+		if (it.blockSolid) {
+			bits |= TILESTATEBIT_BLOCKSOLID;
+		}
+		if (it.blockPathFind) {
+			bits |= TILESTATEBIT_BLOCKPATH;
+		}
+		if (it.blockProjectile) {
+			bits |= TILESTATEBIT_BLOCKPROJECTILE;
+		}
+		if (it.floorChange != 0) {
+			bits |= TILESTATEBIT_FLOORCHANGE;
+		}
+	}
+	return bits;
 }
 
 namespace {
 
-bool checkSteepLine(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint8_t z)
+// reads the projectile plane of one floor, keeping the row of the last lookup
+// since consecutive steps of a line mostly stay on it
+class SightLineReader
+{
+	public:
+		SightLineReader(const TileStateMap& states, uint8_t z) : states(states), z(z) {}
+
+		bool isClear(const uint16_t x, const uint16_t y) {
+			const uint32_t rowKey = (static_cast<uint32_t>(y) << 10) | (x >> TILESTATE_REGION_BITS);
+			if (rowKey != lastRowKey) {
+				lastRowKey = rowKey;
+				row = states.getRow(x, y, z, TILESTATEPLANE_BLOCKPROJECTILE);
+			}
+			return !row || ((*row >> (x & TILESTATE_REGION_MASK)) & 1) == 0;
+		}
+
+	private:
+		const TileStateMap& states;
+		const TileStateMap::Row* row = nullptr;
+		uint32_t lastRowKey = std::numeric_limits<uint32_t>::max();
+		uint8_t z;
+};
+
+bool checkSteepLine(SightLineReader& reader, const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1)
 {
 	const float dx = x1 - x0;
 	const float slope = (dx == 0) ? 1 : (y1 - y0) / dx;
@@ -524,7 +1127,7 @@ bool checkSteepLine(const uint16_t x0, const uint16_t y0, const uint16_t x1, con
 
 	for (uint16_t x = x0 + 1; x < x1; ++x) {
 		//0.1 is necessary to avoid loss of precision during calculation
-		if (!g_game.map.isTileClear(std::floor(yi + 0.1), x, z)) {
+		if (!reader.isClear(std::floor(yi + 0.1), x)) {
 			return false;
 		}
 		yi += slope;
@@ -533,7 +1136,7 @@ bool checkSteepLine(const uint16_t x0, const uint16_t y0, const uint16_t x1, con
 	return true;
 }
 
-bool checkSlightLine(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint8_t z)
+bool checkSlightLine(SightLineReader& reader, const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1)
 {
 	const float dx = x1 - x0;
 	const float slope = (dx == 0) ? 1 : (y1 - y0) / dx;
@@ -541,7 +1144,7 @@ bool checkSlightLine(const uint16_t x0, const uint16_t y0, const uint16_t x1, co
 
 	for (uint16_t x = x0 + 1; x < x1; ++x) {
 		//0.1 is necessary to avoid loss of precision during calculation
-		if (!g_game.map.isTileClear(x, std::floor(yi + 0.1), z)) {
+		if (!reader.isClear(x, std::floor(yi + 0.1))) {
 			return false;
 		}
 		yi += slope;
@@ -558,18 +1161,51 @@ bool Map::checkSightLine(const uint16_t x0, const uint16_t y0, const uint16_t x1
 		return true;
 	}
 
+	const uint32_t generation = tileStates.getSightGeneration();
+	if (bool clear; sightLineMemo.find(x0, y0, x1, y1, z, generation, clear)) {
+		return clear;
+	}
+
+	const bool clear = traceSightLine(x0, y0, x1, y1, z);
+	sightLineMemo.insert(x0, y0, x1, y1, z, generation, clear);
+	return clear;
+}
+
+bool Map::traceSightLine(const uint16_t x0, const uint16_t y0, const uint16_t x1, const uint16_t y1, const uint8_t z) const
+{
+	SightLineReader reader(tileStates, z);
 	if (std::abs(y1 - y0) > std::abs(x1 - x0)) {
 		if (y1 > y0) {
-			return checkSteepLine(y0, x0, y1, x1, z);
+			return checkSteepLine(reader, y0, x0, y1, x1);
 		}
-		return checkSteepLine(y1, x1, y0, x0, z);
+		return checkSteepLine(reader, y1, x1, y0, x0);
+	} else if (x0 > x1) {
+		return checkSlightLine(reader, x1, y1, x0, y0);
 	}
+	return checkSlightLine(reader, x0, y0, x1, y1);
+}
+
+void Map::prepareSightLines(std::vector<SightLineJob>& jobs)
+{
+	const uint32_t generation = tileStates.getSightGeneration();
+	std::erase_if(jobs, [&](const SightLineJob& job) {
+		bool clear;
+		return sightLineMemo.find(job.x0, job.y0, job.x1, job.y1, job.z, generation, clear);
+	});
 
-	if (x0 > x1) {
-		return checkSlightLine(x1, y1, x0, y0, z);
+	if (jobs.size() < THINK_POOL_MIN_JOBS) {
+		return;
 	}
 
-	return checkSlightLine(x0, y0, x1, y1, z);
+	// tracing only reads the tile states, the memo is filled back here on the game thread
+	g_thinkPool.parallelFor(jobs.size(), [&](size_t i) {
+		SightLineJob& job = jobs[i];
+		job.clear = traceSightLine(job.x0, job.y0, job.x1, job.y1, job.z);
+	});
+
+	for (const SightLineJob& job : jobs) {
+		sightLineMemo.insert(job.x0, job.y0, job.x1, job.y1, job.z, generation, job.clear);
+	}
 }
 
 bool Map::isSightClear(const Position& fromPos, const Position& toPos, const bool sameFloor /*= false*/)
@@ -656,6 +1292,11 @@ TilePtr Map::canWalkTo(CreaturePtr& creature, const Position& pos)
 	}
 
 	//used for non-cached tiles
+	if (pos != creature->getPosition() && isPathBlocked(getTileState(pos.x, pos.y, pos.z))) {
+		// queryAdd would refuse it anyway, no need to look at the tile
+		return nullptr;
+	}
+
 	const auto& tile = getTile(pos.x, pos.y, pos.z);
 	if (creature->getTile() != tile) {
 		if (!tile) {
@@ -674,193 +1315,233 @@ TilePtr Map::canWalkTo(CreaturePtr& creature, const Position& pos)
 	return tile;
 }
 
-bool Map::getPathMatching(CreaturePtr& creature, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp)
-{
-	Position pos = creature->getPosition();
-	Position endPos;
-
-	AStarNodes nodes(pos.x, pos.y);
-
-	int32_t bestMatch = 0;
+namespace {
 
-	static int_fast32_t dirNeighbors[8][5][2] = {
-		{{-1, 0}, {0, 1}, {1, 0}, {1, 1}, {-1, 1}},
-		{{-1, 0}, {0, 1}, {0, -1}, {-1, -1}, {-1, 1}},
-		{{-1, 0}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}},
-		{{0, 1}, {1, 0}, {0, -1}, {1, -1}, {1, 1}},
-		{{1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}},
-		{{-1, 0}, {0, -1}, {-1, -1}, {1, -1}, {-1, 1}},
-		{{0, 1}, {1, 0}, {1, -1}, {1, 1}, {-1, 1}},
-		{{-1, 0}, {0, 1}, {-1, -1}, {1, 1}, {-1, 1}}
-	};
-	static int_fast32_t allNeighbors[8][2] = {
-		{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
-	};
+// the live map as seen by creature, the dispatcher side of findPathMatching
+class MapPathSource
+{
+	public:
+		MapPathSource(Map& map, CreaturePtr& creature, const FrozenPathingConditionCall& pathCondition) :
+			map(map), creature(creature), pathCondition(pathCondition) {}
+
+		bool getStepCost(const Position& pos, const bool known, int_fast32_t& extraCost) {
+			const TilePtr tile = known ? map.getTile(pos.x, pos.y, pos.z) : map.canWalkTo(creature, pos);
+			if (!tile) {
+				return false;
+			}
 
-	const Position startPos = pos;
+			extraCost = AStarNodes::getTileWalkCost(creature, tile);
+			return true;
+		}
 
-	AStarNode* found = nullptr;
-	while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100) {
-		const auto& n = nodes.getBestNode();
-		if (!n) {
-			if (found) {
-				break;
-			}
-			return false;
+		bool isMatching(const Position& startPos, const Position& testPos, const FindPathParams& fpp, int32_t& bestMatchDist) {
+			// once for every node the search expands
+			++expanded;
+			return pathCondition(startPos, testPos, fpp, bestMatchDist);
 		}
 
-		const int_fast32_t x = n->x;
-		const int_fast32_t y = n->y;
-		pos.x = x;
-		pos.y = y;
-		if (pathCondition(startPos, pos, fpp, bestMatch)) {
-			found = n;
-			endPos = pos;
-			if (bestMatch == 0) {
-				break;
-			}
+		bool isInRange(const Position& startPos, const Position& testPos, const FindPathParams& fpp) const {
+			return pathCondition.isInRange(startPos, testPos, fpp);
 		}
 
-		uint_fast32_t dirCount;
-		int_fast32_t* neighbors;
-		if (n->parent) {
-			const int_fast32_t offset_x = n->parent->x - x;
-			const int_fast32_t offset_y = n->parent->y - y;
-			if (offset_y == 0) {
-				if (offset_x == -1) {
-					neighbors = *dirNeighbors[DIRECTION_WEST];
-				} else {
-					neighbors = *dirNeighbors[DIRECTION_EAST];
-				}
-			} else if (!fpp.allowDiagonal || offset_x == 0) {
-				if (offset_y == -1) {
-					neighbors = *dirNeighbors[DIRECTION_NORTH];
-				} else {
-					neighbors = *dirNeighbors[DIRECTION_SOUTH];
-				}
-			} else if (offset_y == -1) {
-				if (offset_x == -1) {
-					neighbors = *dirNeighbors[DIRECTION_NORTHWEST];
-				} else {
-					neighbors = *dirNeighbors[DIRECTION_NORTHEAST];
-				}
-			} else if (offset_x == -1) {
-				neighbors = *dirNeighbors[DIRECTION_SOUTHWEST];
-			} else {
-				neighbors = *dirNeighbors[DIRECTION_SOUTHEAST];
-			}
-			dirCount = fpp.allowDiagonal ? 5 : 3;
-		} else {
-			dirCount = 8;
-			neighbors = *allNeighbors;
+		uint64_t getExpanded() const {
+			return expanded;
 		}
 
-		const int_fast32_t f = n->f;
-		for (uint_fast32_t i = 0; i < dirCount; ++i) {
-			pos.x = x + *neighbors++;
-			pos.y = y + *neighbors++;
+	private:
+		Map& map;
+		CreaturePtr& creature;
+		const FrozenPathingConditionCall& pathCondition;
+		uint64_t expanded = 0;
+};
 
-			if (fpp.maxSearchDist != 0 && (Position::getDistanceX(startPos, pos) > fpp.maxSearchDist || Position::getDistanceY(startPos, pos) > fpp.maxSearchDist)) {
-				continue;
-			}
+}
 
-			if (fpp.keepDistance && !pathCondition.isInRange(startPos, pos, fpp)) {
-				continue;
-			}
+bool Map::getPathMatching(CreaturePtr& creature, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp)
+{
+	return getPathMatching(creature, creature->getPosition(), dirList, pathCondition, fpp);
+}
 
-			auto neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
-			TilePtr tile = neighborNode ? getTile(pos.x, pos.y, pos.z) : canWalkTo(creature, pos);
+bool Map::getPathMatching(CreaturePtr& creature, const Position& startPos, std::vector<Direction>& dirList, const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp)
+{
+	TickPhaseTimer timer(TICK_PHASE_PATHFINDING);
+	MapPathSource source(*this, creature, pathCondition);
+	const bool found = findPathMatching(source, startPos, dirList, fpp);
+	if (const auto& player = creature->getPlayer()) {
+		player->getCost()->pathNodes += source.getExpanded();
+	}
+	return found;
+}
 
-			if (!tile) 
-			{
-				continue;
-			}
-			
-			//The cost (g) for this neighbor
-			const int_fast32_t cost = AStarNodes::getMapWalkCost(n, pos);
-			const int_fast32_t extraCost = AStarNodes::getTileWalkCost(creature, tile);
-			const int_fast32_t newf = f + cost + extraCost;
-
-			if (neighborNode) {
-				if (neighborNode->f <= newf) {
-					//The node on the closed/open list is cheaper than this one
-					continue;
-				}
+bool Map::getLongPath(CreaturePtr& creature, const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp)
+{
+	const Position& startPos = creature->getPosition();
 
-				neighborNode->f = newf;
-				neighborNode->parent = n;
-				nodes.openNode(neighborNode);
-			} else {
-				//Does not exist in the open/closed list, create a new node
-				neighborNode = nodes.createOpenNode(n, pos.x, pos.y, newf);
-				if (!neighborNode) {
-					if (found) {
-						break;
-					}
-					return false;
-				}
-			}
+	std::vector<Position> waypoints;
+	if (!navigation.findRoute(*this, startPos, targetPos, waypoints)) {
+		return false;
+	}
+
+	// walked in this order, each one is a stack like dirList
+	std::vector<std::vector<Direction>> segments;
+	Position pos = startPos;
+	for (const Position& waypoint : waypoints) {
+		if (!getLocalPath(creature, pos, waypoint, 0, fpp.allowDiagonal, segments.emplace_back(), pos)) {
+			return false;
 		}
+	}
 
-		nodes.closeNode(n);
+	if (Position::getDistanceX(pos, targetPos) > NAVIGATION_FINAL_RANGE || Position::getDistanceY(pos, targetPos) > NAVIGATION_FINAL_RANGE) {
+		if (!getLocalPath(creature, pos, targetPos, NAVIGATION_FINAL_RANGE, fpp.allowDiagonal, segments.emplace_back(), pos)) {
+			return false;
+		}
 	}
 
-	if (!found) {
+	if (!getPathMatching(creature, pos, segments.emplace_back(), FrozenPathingConditionCall(targetPos), fpp)) {
 		return false;
 	}
 
-	int_fast32_t prevx = endPos.x;
-	int_fast32_t prevy = endPos.y;
+	// the next step goes last
+	dirList.clear();
+	for (auto it = segments.rbegin(), end = segments.rend(); it != end; ++it) {
+		dirList.insert(dirList.end(), it->begin(), it->end());
+	}
+	return true;
+}
 
-	found = found->parent;
-	while (found) {
-		pos.x = found->x;
-		pos.y = found->y;
+bool Map::getLocalPath(CreaturePtr& creature, const Position& from, const Position& to, const int32_t stopDistance, const bool allowDiagonal,
+                       std::vector<Direction>& dirList, Position& reached)
+{
+	// room to go around whatever lies between them
+	static constexpr int32_t margin = NAVIGATION_SECTOR_SIZE / 4;
+	static constexpr int32_t maxSide = NAVIGATION_SECTOR_SIZE * 4;
+
+	const int32_t minX = std::max<int32_t>(0, std::min(from.x, to.x) - margin);
+	const int32_t minY = std::max<int32_t>(0, std::min(from.y, to.y) - margin);
+	const int32_t maxX = std::min<int32_t>(0xFFFF, std::max(from.x, to.x) + margin);
+	const int32_t maxY = std::min<int32_t>(0xFFFF, std::max(from.y, to.y) + margin);
+	const int32_t width = maxX - minX + 1;
+	const int32_t height = maxY - minY + 1;
+	if (width > maxSide || height > maxSide) {
+		return false;
+	}
 
-		const int_fast32_t dx = pos.getX() - prevx;
-		const int_fast32_t dy = pos.getY() - prevy;
+	static constexpr int8_t stepX[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
+	static constexpr int8_t stepY[8] = {0, 1, 0, -1, -1, -1, 1, 1};
+	static constexpr Direction stepDirections[8] = {
+		DIRECTION_WEST, DIRECTION_SOUTH, DIRECTION_EAST, DIRECTION_NORTH,
+		DIRECTION_NORTHWEST, DIRECTION_NORTHEAST, DIRECTION_SOUTHEAST, DIRECTION_SOUTHWEST
+	};
+
+	enum : uint8_t { CELL_UNKNOWN, CELL_WALKABLE, CELL_BLOCKED };
+
+	const size_t cellCount = width * height;
+	std::vector<int32_t> costs(cellCount, std::numeric_limits<int32_t>::max());
+	std::vector<int32_t> extraCosts(cellCount, 0);
+	std::vector<uint8_t> cellStates(cellCount, CELL_UNKNOWN);
+	std::vector<uint8_t> steps(cellCount, 0);
+	std::vector<bool> closed(cellCount, false);
+
+	const auto getIndex = [=](int32_t x, int32_t y) {
+		return static_cast<size_t>((y - minY) * width + (x - minX));
+	};
+
+	// diagonal steps cost more than two straight ones, so this never overestimates
+	const auto estimate = [&](int32_t x, int32_t y) {
+		return MAP_NORMALWALKCOST * (std::max(0, std::abs(x - to.x) - stopDistance) + std::max(0, std::abs(y - to.y) - stopDistance));
+	};
 
-		prevx = pos.x;
-		prevy = pos.y;
+	using QueueEntry = std::pair<int32_t, uint32_t>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> open;
 
-		if (dx == 1 && dy == 1) {
-			dirList.push_back(DIRECTION_NORTHWEST);
-		} else if (dx == -1 && dy == 1) {
-			dirList.push_back(DIRECTION_NORTHEAST);
-		} else if (dx == 1 && dy == -1) {
-			dirList.push_back(DIRECTION_SOUTHWEST);
-		} else if (dx == -1 && dy == -1) {
-			dirList.push_back(DIRECTION_SOUTHEAST);
-		} else if (dx == 1) {
-			dirList.push_back(DIRECTION_WEST);
-		} else if (dx == -1) {
-			dirList.push_back(DIRECTION_EAST);
-		} else if (dy == 1) {
-			dirList.push_back(DIRECTION_NORTH);
-		} else if (dy == -1) {
-			dirList.push_back(DIRECTION_SOUTH);
+	const size_t startIndex = getIndex(from.x, from.y);
+	costs[startIndex] = 0;
+	cellStates[startIndex] = CELL_WALKABLE;
+	open.emplace(estimate(from.x, from.y), startIndex);
+
+	Position pos(0, 0, from.z);
+	while (!open.empty()) {
+		const size_t index = open.top().second;
+		open.pop();
+		if (closed[index]) {
+			continue;
 		}
+		closed[index] = true;
+
+		const int32_t x = minX + static_cast<int32_t>(index % width);
+		const int32_t y = minY + static_cast<int32_t>(index / width);
+		if (std::abs(x - to.x) <= stopDistance && std::abs(y - to.y) <= stopDistance) {
+			reached = Position(x, y, from.z);
+
+			size_t current = index;
+			int32_t currentX = x;
+			int32_t currentY = y;
+			while (current != startIndex) {
+				const uint8_t step = steps[current];
+				dirList.push_back(stepDirections[step]);
+				currentX -= stepX[step];
+				currentY -= stepY[step];
+				current = getIndex(currentX, currentY);
+			}
+			return true;
+		}
+
+		const int32_t cost = costs[index];
+		for (uint8_t step = 0, stepCount = allowDiagonal ? 8 : 4; step < stepCount; ++step) {
+			const int32_t nx = x + stepX[step];
+			const int32_t ny = y + stepY[step];
+			if (nx < minX || nx > maxX || ny < minY || ny > maxY) {
+				continue;
+			}
+
+			const size_t next = getIndex(nx, ny);
+			if (closed[next]) {
+				continue;
+			}
+
+			if (cellStates[next] == CELL_UNKNOWN) {
+				pos.x = nx;
+				pos.y = ny;
+				if (const TilePtr tile = canWalkTo(creature, pos)) {
+					cellStates[next] = CELL_WALKABLE;
+					extraCosts[next] = AStarNodes::getTileWalkCost(creature, tile);
+				} else {
+					cellStates[next] = CELL_BLOCKED;
+				}
+			}
+
+			if (cellStates[next] != CELL_WALKABLE) {
+				continue;
+			}
 
-		found = found->parent;
+			const int32_t newCost = cost + (step < 4 ? MAP_NORMALWALKCOST : MAP_DIAGONALWALKCOST) + extraCosts[next];
+			if (newCost < costs[next]) {
+				costs[next] = newCost;
+				steps[next] = step;
+				open.emplace(newCost + estimate(nx, ny), next);
+			}
+		}
 	}
-	return true;
+	return false;
 }
 
 // AStarNodes
 
 AStarNodes::AStarNodes(uint32_t x, uint32_t y)
-	: nodes(), openNodes()
 {
+	std::fill(std::begin(nodeTable), std::end(nodeTable), -1);
+
 	curNode = 1;
 	closedNodes = 0;
-	openNodes[0] = true;
+	openCount = 0;
 
 	AStarNode& startNode = nodes[0];
 	startNode.parent = nullptr;
 	startNode.x = x;
 	startNode.y = y;
 	startNode.f = 0;
-	nodeTable[(x << 16) | y] = nodes;
+	nodeTable[getTableSlot(x, y)] = 0;
+	pushOpenNode(0);
 }
 
 AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
@@ -870,43 +1551,49 @@ AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y,
 	}
 
 	const size_t retNode = curNode++;
-	openNodes[retNode] = true;
+
+	size_t slot = getTableSlot(x, y);
+	while (nodeTable[slot] >= 0) {
+		slot = (slot + 1) & (NODE_TABLE_SIZE - 1);
+	}
+	nodeTable[slot] = retNode;
 
 	AStarNode* node = nodes + retNode;
-	nodeTable[(x << 16) | y] = node;
 	node->parent = parent;
 	node->x = x;
 	node->y = y;
 	node->f = f;
+	pushOpenNode(retNode);
 	return node;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
-	if (curNode == 0) {
+	if (openCount == 0) {
 		return nullptr;
 	}
-
-	int32_t best_node_f = std::numeric_limits<int32_t>::max();
-	int32_t best_node = -1;
-	for (size_t i = 0; i < curNode; i++) {
-		if (openNodes[i] && nodes[i].f < best_node_f) {
-			best_node_f = nodes[i].f;
-			best_node = i;
-		}
-	}
-
-	if (best_node >= 0) {
-		return nodes + best_node;
-	}
-	return nullptr;
+	return nodes + openHeap[0];
 }
 
 void AStarNodes::closeNode(const AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	openNodes[index] = false;
+
+	const int16_t heapPos = heapPositions[index];
+	if (heapPos >= 0) {
+		// fill the hole with the last node and let it settle either way
+		heapPositions[index] = -1;
+		if (static_cast<size_t>(heapPos) != --openCount) {
+			const uint16_t moved = openHeap[openCount];
+			openHeap[heapPos] = moved;
+			heapPositions[moved] = heapPos;
+			siftUp(heapPos);
+			if (heapPositions[moved] == heapPos) {
+				siftDown(heapPos);
+			}
+		}
+	}
 	++closedNodes;
 }
 
@@ -914,9 +1601,12 @@ void AStarNodes::openNode(const AStarNode* node)
 {
 	size_t index = node - nodes;
 	assert(index < MAX_NODES);
-	if (!openNodes[index]) {
-		openNodes[index] = true;
+	if (heapPositions[index] < 0) {
+		pushOpenNode(index);
 		--closedNodes;
+	} else {
+		// only ever called after lowering f
+		siftUp(heapPositions[index]);
 	}
 }
 
@@ -927,11 +1617,70 @@ int_fast32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(const uint32_t x, const uint32_t y)
 {
-	auto it = nodeTable.find((x << 16) | y);
-	if (it == nodeTable.end()) {
-		return nullptr;
+	for (size_t slot = getTableSlot(x, y); nodeTable[slot] >= 0; slot = (slot + 1) & (NODE_TABLE_SIZE - 1)) {
+		AStarNode* node = nodes + nodeTable[slot];
+		if (node->x == x && node->y == y) {
+			return node;
+		}
 	}
-	return it->second;
+	return nullptr;
+}
+
+bool AStarNodes::isBetterNode(const uint16_t a, const uint16_t b) const
+{
+	// ties go to the older node, as the former linear scan did
+	return nodes[a].f < nodes[b].f || (nodes[a].f == nodes[b].f && a < b);
+}
+
+void AStarNodes::pushOpenNode(const uint16_t index)
+{
+	openHeap[openCount] = index;
+	heapPositions[index] = openCount;
+	siftUp(openCount++);
+}
+
+void AStarNodes::siftUp(size_t heapPos)
+{
+	const uint16_t index = openHeap[heapPos];
+	while (heapPos > 0) {
+		const size_t parentPos = (heapPos - 1) / 2;
+		if (!isBetterNode(index, openHeap[parentPos])) {
+			break;
+		}
+
+		openHeap[heapPos] = openHeap[parentPos];
+		heapPositions[openHeap[heapPos]] = heapPos;
+		heapPos = parentPos;
+	}
+
+	openHeap[heapPos] = index;
+	heapPositions[index] = heapPos;
+}
+
+void AStarNodes::siftDown(size_t heapPos)
+{
+	const uint16_t index = openHeap[heapPos];
+	while (true) {
+		size_t childPos = heapPos * 2 + 1;
+		if (childPos >= openCount) {
+			break;
+		}
+
+		if (childPos + 1 < openCount && isBetterNode(openHeap[childPos + 1], openHeap[childPos])) {
+			++childPos;
+		}
+
+		if (!isBetterNode(openHeap[childPos], index)) {
+			break;
+		}
+
+		openHeap[heapPos] = openHeap[childPos];
+		heapPositions[openHeap[heapPos]] = heapPos;
+		heapPos = childPos;
+	}
+
+	openHeap[heapPos] = index;
+	heapPositions[index] = heapPos;
 }
 
 int_fast32_t AStarNodes::getMapWalkCost(const AStarNode* node, const Position& neighborPos)
@@ -1002,12 +1751,61 @@ QTreeLeafNode* QTreeNode::createLeaf(const uint32_t x, const uint32_t y, const u
 				child[index] = new QTreeLeafNode();
 				QTreeLeafNode::newLeaf = true;
 			}
+			child[index]->parent = this;
 		}
 		return child[index]->createLeaf(x * 2, y * 2, level - 1);
 	}
 	return static_cast<QTreeLeafNode*>(this);
 }
 
+bool QTreeNode::hasCreaturesIn(const uint32_t nodeX, const uint32_t nodeY, const uint32_t size, const uint32_t minX,
+                               const uint32_t minY, const uint32_t maxX, const uint32_t maxY, const bool monsters) const
+{
+	if ((monsters ? this->monsters : players) == 0) {
+		return false;
+	}
+
+	// a leaf, or a node the area covers whole, holds some in the area
+	if (leaf || (minX <= nodeX && minY <= nodeY && maxX >= nodeX + size - 1 && maxY >= nodeY + size - 1)) {
+		return true;
+	}
+
+	const uint32_t half = size / 2;
+	for (uint32_t index = 0; index < 4; ++index) {
+		const QTreeNode* node = child[index];
+		if (!node) {
+			continue;
+		}
+
+		const uint32_t x = nodeX + ((index & 1) ? half : 0);
+		const uint32_t y = nodeY + ((index & 2) ? half : 0);
+		if (x > maxX || y > maxY || x + half - 1 < minX || y + half - 1 < minY) {
+			continue;
+		}
+
+		if (node->hasCreaturesIn(x, y, half, minX, minY, maxX, maxY, monsters)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void QTreeNode::updateCounts(const CreaturePtr& c, const int32_t change)
+{
+	uint32_t QTreeNode::* count;
+	if (c->getPlayer()) {
+		count = &QTreeNode::players;
+	} else if (c->getMonster()) {
+		count = &QTreeNode::monsters;
+	} else {
+		return;
+	}
+
+	for (QTreeNode* node = this; node; node = node->parent) {
+		node->*count += change;
+	}
+}
+
 // QTreeLeafNode
 bool QTreeLeafNode::newLeaf = false;
 
@@ -1026,69 +1824,149 @@ Floor* QTreeLeafNode::createFloor(const uint32_t z)
 	return array[z];
 }
 
-void QTreeLeafNode::addCreature(const CreaturePtr& c)
+void QTreeLeafNode::addCreature(const CreaturePtr& c, const Position& pos)
 {
-	creature_list.push_back(c);
+	creature_list.add(c, pos);
 
 	if (c->getPlayer()) {
-		player_list.push_back(c);
+		player_list.add(c, pos);
 	}
+	updateCounts(c, 1);
 }
 
 void QTreeLeafNode::removeCreature(const CreaturePtr& c)
 {
-	auto iter = std::ranges::find(creature_list, c);
-	assert(iter != creature_list.end());
-	*iter = creature_list.back();
-	creature_list.pop_back();
+	creature_list.remove(c);
 
 	if (c->getPlayer()) {
-		iter = std::ranges::find(player_list, c);
-		assert(iter != player_list.end());
-		*iter = player_list.back();
-		player_list.pop_back();
+		player_list.remove(c);
 	}
+	updateCounts(c, -1);
 }
 
-uint32_t Map::clean()
+void QTreeLeafNode::moveCreature(const CreaturePtr& c, const Position& pos)
 {
-	const uint64_t start = OTSYS_TIME();
-	size_t tiles = 0;
+	creature_list.update(c, pos);
 
-	if (g_game.getGameState() == GAME_STATE_NORMAL) {
-		g_game.setGameState(GAME_STATE_MAINTAIN);
+	if (c->getPlayer()) {
+		player_list.update(c, pos);
 	}
+}
 
-	std::vector<ItemPtr> toRemove;
+// LeafCreatureList
+void LeafCreatureList::add(const CreaturePtr& c, const Position& pos)
+{
+	creatures.push_back(c);
+	x.push_back(pos.x + pos.z);
+	y.push_back(pos.y + pos.z);
+	z.push_back(pos.z);
+}
 
-	for (const auto& tile : g_game.getTilesToClean()) {
-		if (!tile) {
-			continue;
+void LeafCreatureList::remove(const CreaturePtr& c)
+{
+	const auto iter = std::ranges::find(creatures, c);
+	assert(iter != creatures.end());
+	const size_t index = iter - creatures.begin();
+
+	*iter = creatures.back();
+	creatures.pop_back();
+	x[index] = x.back();
+	x.pop_back();
+	y[index] = y.back();
+	y.pop_back();
+	z[index] = z.back();
+	z.pop_back();
+}
+
+void LeafCreatureList::update(const CreaturePtr& c, const Position& pos)
+{
+	const auto iter = std::ranges::find(creatures, c);
+	assert(iter != creatures.end());
+	const size_t index = iter - creatures.begin();
+
+	x[index] = pos.x + pos.z;
+	y[index] = pos.y + pos.z;
+	z[index] = pos.z;
+}
+
+namespace {
+
+class CleanMapJob final : public DispatcherJob
+{
+	public:
+		CleanMapJob() : start(OTSYS_TIME()) {
+			if (g_game.getGameState() == GAME_STATE_NORMAL) {
+				g_game.setGameState(GAME_STATE_MAINTAIN);
+			}
+
+			// tiles that get dirty while we are still busy are left for the next clean
+			const auto& tilesToClean = g_game.getTilesToClean();
+			tiles.assign(tilesToClean.begin(), tilesToClean.end());
+			g_game.clearTilesToClean();
 		}
 
-		if (const auto& items = tile->getItemList()) {
-			++tiles;
-			for (const auto& item : *items) {
-				if (item->isCleanable()) {
-					toRemove.emplace_back(item);
+		bool step() override {
+			if (nextTile >= tiles.size()) {
+				finish();
+				return true;
+			}
+
+			const TilePtr& tile = tiles[nextTile++];
+			if (!tile) {
+				return false;
+			}
+
+			if (const auto& items = tile->getItemList()) {
+				++cleanedTiles;
+
+				toRemove.clear();
+				for (const auto& item : *items) {
+					if (item->isCleanable()) {
+						toRemove.emplace_back(item);
+					}
 				}
+
+				for (const auto& item : toRemove) {
+					g_game.internalRemoveItem(item, -1);
+				}
+				count += toRemove.size();
+			}
+			return false;
+		}
+
+		size_t getCount() const {
+			return count;
+		}
+
+	private:
+		void finish() const {
+			if (g_game.getGameState() == GAME_STATE_MAINTAIN) {
+				g_game.setGameState(GAME_STATE_NORMAL);
 			}
+
+			std::cout << "> CLEAN: Removed " << count << " item" << (count != 1 ? "s" : "")
+				<< " from " << cleanedTiles << " tile" << (cleanedTiles != 1 ? "s" : "") << " in "
+				<< (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
 		}
-	}
 
-	for (const auto& item : toRemove) {
-		g_game.internalRemoveItem(item, -1);
-	}
+		std::vector<TilePtr> tiles;
+		std::vector<ItemPtr> toRemove;
+		size_t nextTile = 0;
+		size_t cleanedTiles = 0;
+		size_t count = 0;
+		uint64_t start;
+};
 
-	const size_t count = toRemove.size();
-	g_game.clearTilesToClean();
+}
 
-	if (g_game.getGameState() == GAME_STATE_MAINTAIN) {
-		g_game.setGameState(GAME_STATE_NORMAL);
-	}
+uint32_t Map::clean()
+{
+	CleanMapJob job;
+	job.complete();
+	return job.getCount();
+}
 
-	std::cout << "> CLEAN: Removed " << count << " item" << (count != 1 ? "s" : "")
-		<< " from " << tiles << " tile" << (tiles != 1 ? "s" : "") << " in "
-		<< (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
-	return count;
+void Map::scheduleClean()
+{
+	g_dispatcher.addJob(std::make_unique<CleanMapJob>());
 }
@@ -13,8 +13,17 @@
 #include "town.h"
 #include "house.h"
 #include "spawn.h"
-
+#include "spectatorgrid.h"
+#include "statictiles.h"
+#include "tileregions.h"
+#include "tilestates.h"
+#include "navigation.h"
+#include "flowfield.h"
+#include "tileencoding.h"
+
+#include <atomic>
 #include <gtl/phmap.hpp>
+#include <shared_mutex>
 
 class Creature;
 class Player;
@@ -32,51 +41,27 @@ struct AStarNode {
 };
 
 static constexpr int32_t MAX_NODES = 512;
+// position to node table, kept at most half full
+static constexpr int32_t NODE_TABLE_BITS = 10;
+static constexpr int32_t NODE_TABLE_SIZE = (1 << NODE_TABLE_BITS);
 
 static constexpr int32_t MAP_NORMALWALKCOST = 10;
 static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
 
-struct alignas(16) ChunkKey {
-	int32_t minRangeX, maxRangeX, minRangeY, maxRangeY;
-	uint16_t x, y;
-	uint8_t z;
-	bool multifloor, onlyPlayers;
+using ChunkCache = gtl::node_hash_map<ChunkKey, SpectatorVec, ChunkKeyHash, ChunkKeyEqual>;
 
-	bool operator==(const ChunkKey& other) const noexcept {
-		return std::memcmp(this, &other, sizeof(ChunkKey)) == 0;
-	}
-};
+// every shard has its own lock so spectator queries may run from several threads
+static constexpr size_t SPECTATOR_CACHE_SHARDS = 16;
 
-static ChunkKey chunkKey;
-
-struct ChunkKeyHash {
-	std::size_t operator()(const ChunkKey& key) const noexcept {
-		std::size_t hash = 0;
-		hash_combine(hash, key.minRangeX, key.maxRangeX, key.minRangeY, key.maxRangeY,
-					 key.x, key.y, key.z, key.multifloor, key.onlyPlayers);
-		return hash;
-	}
-
-private:
-	template <typename... Args>
-	static void hash_combine(std::size_t& seed, Args&&... args) {
-		(hash_combine_impl(seed, std::forward<Args>(args)), ...);
-	}
-
-	template <typename T>
-	static void hash_combine_impl(std::size_t& seed, const T& v) {
-		seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-	}
-};
+// farthest a player can be from a creature whose spectator query still returns
+// it, widened by the floor shift of the search done around the player
+static constexpr int32_t OBSERVER_SEARCH_RANGE = 32;
 
-struct ChunkKeyEqual {
-	bool operator()(const ChunkKey& lhs, const ChunkKey& rhs) const noexcept {
-		return std::memcmp(&lhs, &rhs, sizeof(ChunkKey)) == 0;
-	}
+struct ChunkCacheShard {
+	std::shared_mutex lock;
+	ChunkCache entries;
 };
 
-using ChunkCache = gtl::node_hash_map<ChunkKey, SpectatorVec, ChunkKeyHash, ChunkKeyEqual>;
-
 class AStarNodes
 {
 	public:
@@ -93,9 +78,23 @@ class AStarNodes
 		static int_fast32_t getTileWalkCost(const CreaturePtr creature, const TileConstPtr& tile);
 
 	private:
+		bool isBetterNode(uint16_t a, uint16_t b) const;
+		void pushOpenNode(uint16_t index);
+		void siftUp(size_t heapPos);
+		void siftDown(size_t heapPos);
+
+		static size_t getTableSlot(uint32_t x, uint32_t y) {
+			return ((((x << 16) | y) * 0x9E3779B1u) >> (32 - NODE_TABLE_BITS));
+		}
+
 		AStarNode nodes[MAX_NODES];
-		bool openNodes[MAX_NODES];
-		gtl::node_hash_map<uint32_t, AStarNode*> nodeTable;
+		// binary min heap of open node indices, see isBetterNode
+		uint16_t openHeap[MAX_NODES];
+		// where each node sits in openHeap, -1 while it is closed
+		int16_t heapPositions[MAX_NODES];
+		// linear probing table of node indices, -1 is empty
+		int16_t nodeTable[NODE_TABLE_SIZE];
+		size_t openCount;
 		size_t curNode;
 		int_fast32_t closedNodes;
 };
@@ -157,7 +156,19 @@ class QTreeNode
 
 		QTreeLeafNode* createLeaf(uint32_t x, uint32_t y, uint32_t level);
 
+		// whether a leaf overlapping the area holds a player, or a monster,
+		// the counts of the nodes skip the empty parts without visiting them
+		bool hasCreaturesIn(uint32_t nodeX, uint32_t nodeY, uint32_t size, uint32_t minX, uint32_t minY,
+		                    uint32_t maxX, uint32_t maxY, bool monsters) const;
+
 	protected:
+		// keeps the counts of this node and the ones above it in step with a
+		// creature entering or leaving a leaf below
+		void updateCounts(const CreaturePtr& c, int32_t change);
+
+		QTreeNode* parent = nullptr;
+		uint32_t players = 0;
+		uint32_t monsters = 0;
 		bool leaf = false;
 
 	private:
@@ -166,6 +177,21 @@ class QTreeNode
 		friend class Map;
 };
 
+// creatures of a leaf next to a copy of their coordinates in the same order,
+// x and y are stored shifted by z so the floor offset of a spectator scan
+// folds into its bounds and a whole block can be tested at once
+struct LeafCreatureList
+{
+	CreatureVector creatures;
+	std::vector<uint16_t> x;
+	std::vector<uint16_t> y;
+	std::vector<uint16_t> z;
+
+	void add(const CreaturePtr& c, const Position& pos);
+	void remove(const CreaturePtr& c);
+	void update(const CreaturePtr& c, const Position& pos);
+};
+
 class QTreeLeafNode final : public QTreeNode
 {
 	public:
@@ -182,16 +208,20 @@ class QTreeLeafNode final : public QTreeNode
 			return array[z];
 		}
 
-		void addCreature(const CreaturePtr& c);
+		void addCreature(const CreaturePtr& c, const Position& pos);
 		void removeCreature(const CreaturePtr& c);
+		// the creature moved to pos without leaving this leaf
+		void moveCreature(const CreaturePtr& c, const Position& pos);
 
 	private:
 		static bool newLeaf;
 		QTreeLeafNode* leafS = nullptr;
 		QTreeLeafNode* leafE = nullptr;
 		Floor* array[MAP_MAX_LAYERS] = {};
-		CreatureVector creature_list;
-		CreatureVector player_list;
+		LeafCreatureList creature_list;
+		LeafCreatureList player_list;
+		// spectator cache entries whose scan went through this leaf
+		mutable gtl::flat_hash_set<ChunkKey, ChunkKeyHash, ChunkKeyEqual> spectatorCacheKeys;
 
 		friend class Map;
 		friend class QTreeNode;
@@ -211,18 +241,31 @@ class Map
 		static constexpr int32_t maxClientViewportY = 6;
 
 		static uint32_t clean();
+		// same as clean() but spread over several dispatcher cycles
+		static void scheduleClean();
 
 		/**
 		  * Load a map.
 		  * \returns true if the map was loaded successfully
 		  */
 		bool loadMap(const std::string& identifier, bool loadHouses);
+		// the tiles of the map file, nothing the scripts or monsters use is touched
+		bool loadTiles(const std::string& identifier);
+		// spawns, houses and the navigation graph of the loaded tiles
+		void loadWorld(bool loadHouses);
 	
 		void clearChunkSpectatorCache()	{
+			taskSpectators.clear();
 			playersSpectatorCache.clear();
-			chunksSpectatorCache.clear();
+			for (ChunkCacheShard& shard : chunksSpectatorCache) {
+				std::unique_lock<std::shared_mutex> lock(shard.lock);
+				shard.entries.clear();
+			}
 		}
 
+		// drops only the cached spectator lists that could contain a creature at pos
+		void clearChunkSpectatorCache(const Position& pos);
+
 		/**
 		  * Save a map.
 		  * \returns true if the map was saved successfully
@@ -239,6 +282,17 @@ class Map
 			return getTile(pos.x, pos.y, pos.z);
 		}
 
+		// the quadtree leaf of the previous lookup, tiles of the same block are
+		// then found without descending the tree again. Reset it after a setTile.
+		struct TileLookupHint {
+			const QTreeLeafNode* leaf = nullptr;
+			uint32_t blockX = std::numeric_limits<uint32_t>::max();
+			uint32_t blockY = std::numeric_limits<uint32_t>::max();
+		};
+
+		// for many tiles close to each other, like the ones of an area
+		TilePtr getTile(uint16_t x, uint16_t y, uint8_t z, TileLookupHint& hint);
+
 		/**
 		  * Set a single tile.
 		  */
@@ -251,7 +305,7 @@ class Map
 		/**
 		  * Removes a single tile.
 		  */
-		void removeTile(uint16_t x, uint16_t y, uint8_t z) const;
+		void removeTile(uint16_t x, uint16_t y, uint8_t z);
 	
 		void removeTile(const Position& pos) {
 			removeTile(pos.x, pos.y, pos.z);
@@ -271,9 +325,31 @@ class Map
 		void getSpectators(SpectatorVec& spectators, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
 		                   int32_t minRangeX = 0, int32_t maxRangeX = 0,
 		                   int32_t minRangeY = 0, int32_t maxRangeY = 0);
+		// false when no player, or monster, can be within range of centerPos
+		// on any floor, a true answer still needs getSpectators to be certain
+		bool mayHaveCreaturesNear(const Position& centerPos, bool monsters, int32_t rangeX = maxViewportX,
+		                          int32_t rangeY = maxViewportY) const;
+		// borrows from the spectator cache, see SpectatorView
+		void getSpectators(SpectatorView& spectators, const Position& centerPos, bool multifloor = false, bool onlyPlayers = false,
+		                   int32_t minRangeX = 0, int32_t maxRangeX = 0,
+		                   int32_t minRangeY = 0, int32_t maxRangeY = 0);
+
+		// creatures around newPos a multifloor query from oldPos would not return, for single steps on one floor
+		void getEnteringSpectators(SpectatorVec& spectators, const Position& oldPos, const Position& newPos) const;
 
 		void clearSpectatorCache();
 		void clearPlayersSpectatorCache();
+		// entries of every spectator cache and about the bytes they hold
+		size_t getSpectatorCacheUsage(size_t& entries);
+
+		// queries answered from a spectator cache and the ones that scanned the map
+		uint64_t getSpectatorCacheHits() const {
+			return spectatorCacheHits.load(std::memory_order_relaxed);
+		}
+
+		uint64_t getSpectatorCacheMisses() const {
+			return spectatorCacheMisses.load(std::memory_order_relaxed);
+		}
 
 		/**
 		  * Checks if you can throw an object to that position
@@ -295,6 +371,35 @@ class Map
 		  */
 		bool isTileClear(uint16_t x, uint16_t y, uint8_t z, bool blockFloor = false);
 
+		/**
+		  * Packed blocking state of a position, a mask of TileStateBits_t that
+		  * can be read without fetching the tile
+		  */
+		uint8_t getTileState(uint16_t x, uint16_t y, uint8_t z) const {
+			return z < MAP_MAX_LAYERS ? tileStates.get(x, y, z) : TILESTATEBIT_NONE;
+		}
+
+		const TileStateMap& getTileStates() const {
+			return tileStates;
+		}
+
+		// re-reads the state of tile if it is the one placed on the map
+		void updateTileState(const Tile& tile);
+		static uint8_t getTileStateBits(const Tile& tile);
+		static uint8_t getTileStateBits(const std::vector<uint16_t>& itemIds);
+
+		// what Tile::queryAdd always refuses for FLAG_PATHFINDING
+		static bool isPathBlocked(uint8_t state) {
+			return (state & (TILESTATEBIT_EXISTS | TILESTATEBIT_GROUND)) != (TILESTATEBIT_EXISTS | TILESTATEBIT_GROUND) ||
+			       (state & (TILESTATEBIT_FLOORCHANGE | TILESTATEBIT_TELEPORT | TILESTATEBIT_BLOCKSOLID)) != 0;
+		}
+
+		// what Tile::queryAdd always refuses for a creature placed without FLAG_IGNOREBLOCKITEM
+		static bool isPlacementBlocked(uint8_t state) {
+			return (state & (TILESTATEBIT_EXISTS | TILESTATEBIT_GROUND)) != (TILESTATEBIT_EXISTS | TILESTATEBIT_GROUND) ||
+			       (state & TILESTATEBIT_BLOCKSOLID) != 0;
+		}
+
 		/**
 		  * Checks if path is clear from fromPos to toPos
 		  * Notice: This only checks a straight line if the path is clear, for path finding use getPathTo.
@@ -304,12 +409,38 @@ class Map
 		  *	\returns The result if there is no obstacles
 		  */
 		bool isSightClear(const Position& fromPos, const Position& toPos, bool sameFloor = false);
-		static bool checkSightLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t z);
+		bool checkSightLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t z);
+		// traces the lines checkSightLine does not remember yet on the think pool and remembers them
+		void prepareSightLines(std::vector<SightLineJob>& jobs);
 
 		TilePtr canWalkTo(CreaturePtr& creature, const Position& pos);
 
 		bool getPathMatching(CreaturePtr& creature, std::vector<Direction>& dirList,
 		                     const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp);
+		// searches as creature but from startPos instead of where it stands
+		bool getPathMatching(CreaturePtr& creature, const Position& startPos, std::vector<Direction>& dirList,
+		                     const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp);
+
+		/**
+		  * Finds a path too long for getPathMatching by following the
+		  * navigation graph from sector to sector, the last few steps are
+		  * left to getPathMatching.
+		  */
+		bool getLongPath(CreaturePtr& creature, const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp);
+
+		// the shared field towards the target once enough creatures chase it, or nullptr
+		const FlowField* getFlowField(uint32_t targetId, const Position& targetPos, uint32_t chaserId) {
+			return flowFields.get(*this, targetId, targetPos, chaserId);
+		}
+
+		// encoded items of recently described tiles, see ProtocolGame::GetTileDescription
+		TileEncodingCache& getTileEncodings() {
+			return tileEncodings;
+		}
+
+		void invalidateTileEncoding(const Position& pos) {
+			tileEncodings.invalidate(pos);
+		}
 
 		std::map<std::string, Position> waypoints;
 
@@ -324,8 +455,28 @@ class Map
 	private:
 		SpectatorCache spectatorCache;
 		SpectatorCache playersSpectatorCache;
-		ChunkCache chunksSpectatorCache;
+		std::array<ChunkCacheShard, SPECTATOR_CACHE_SHARDS> chunksSpectatorCache;
+		// the answers of getSpectators within the running dispatcher task, dispatcher
+		// thread only, emptied when the next task starts or any creature comes or goes
+		ChunkCache taskSpectators;
+		uint64_t taskSpectatorsCycle = 0;
+		// guards the spectatorCacheKeys of every leaf
+		mutable std::mutex spectatorLeafLock;
+		std::atomic<uint64_t> spectatorCacheHits{0};
+		std::atomic<uint64_t> spectatorCacheMisses{0};
 		QTreeNode root;
+#ifdef SPECTATOR_GRID
+		SpectatorGrid spectatorGrid;
+#endif
+#ifdef DENSE_TILE_STORE
+		TileRegionStore tileRegions;
+#endif
+		StaticTileLayer staticTiles;
+		TileStateMap tileStates;
+		SightLineMemo sightLineMemo;
+		NavigationGraph navigation;
+		FlowFieldCache flowFields;
+		TileEncodingCache tileEncodings;
 
 		std::filesystem::path spawnfile;
 		std::filesystem::path housefile;
@@ -337,10 +488,37 @@ class Map
 		void getSpectatorsInternal(SpectatorVec& spectators, const Position& centerPos,
 		                           int32_t minRangeX, int32_t maxRangeX,
 		                           int32_t minRangeY, int32_t maxRangeY,
-		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
+		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers, const ChunkKey* cacheKey = nullptr) const;
+
+		ChunkCacheShard& getChunkCacheShard(const ChunkKey& key) {
+			return chunksSpectatorCache[ChunkKeyHash{}(key) % SPECTATOR_CACHE_SHARDS];
+		}
+
+		// checkSightLine without the memo, safe to call from the think pool
+		bool traceSightLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t z) const;
+
+		// the tile placed at the position, static tiles are not loaded
+		const TilePtr* findTile(uint16_t x, uint16_t y, uint8_t z) const;
+
+		// A* with a distance estimate inside the box around from and to, until within stopDistance of to
+		bool getLocalPath(CreaturePtr& creature, const Position& from, const Position& to, int32_t stopDistance, bool allowDiagonal,
+		                  std::vector<Direction>& dirList, Position& reached);
+		TilePtr loadStaticTile(uint16_t x, uint16_t y, uint8_t z);
+
+		static void getSpectatorFloors(const Position& centerPos, bool multifloor, int32_t& minRangeZ, int32_t& maxRangeZ);
+
+		// whether a spectator query around centerPos would return a creature at pos
+		bool isInSpectatorRange(const Position& centerPos, const Position& pos, bool multifloor = true) const;
+
+		// keep Creature::observers equal to getSpectators(pos, true, true) as creatures come, go and move
+		void setObservers(const CreaturePtr& creature, const SpectatorVec& spectators);
+		void refreshObservedCreatures(Player* player);
+		void removeObservers(Creature* creature);
 
 		friend class Game;
 		friend class IOMap;
+		friend class NavigationGraph;
+		friend class Tile;
 };
 
 #endif
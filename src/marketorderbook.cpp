@@ -0,0 +1,64 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "marketorderbook.h"
+
+void MarketOrderBook::add(MarketOrder&& order)
+{
+	const uint32_t id = order.id;
+	books[order.itemId][order.type].emplace(order.price, id);
+	playerOrders[order.playerId].insert(id);
+	byCreated.emplace(order.created, id);
+	orders.insert_or_assign(id, std::move(order));
+}
+
+void MarketOrderBook::remove(uint32_t id)
+{
+	auto it = orders.find(id);
+	if (it == orders.end()) {
+		return;
+	}
+
+	const MarketOrder& order = it->second;
+	auto book = books.find(order.itemId);
+	book->second[order.type].erase({order.price, id});
+	if (book->second[MARKETACTION_BUY].empty() && book->second[MARKETACTION_SELL].empty()) {
+		books.erase(book);
+	}
+
+	auto own = playerOrders.find(order.playerId);
+	own->second.erase(id);
+	if (own->second.empty()) {
+		playerOrders.erase(own);
+	}
+
+	byCreated.erase({order.created, id});
+	orders.erase(it);
+}
+
+MarketOrder* MarketOrderBook::find(uint32_t id)
+{
+	auto it = orders.find(id);
+	return it != orders.end() ? &it->second : nullptr;
+}
+
+const MarketOrder* MarketOrderBook::findByCounter(uint32_t created, uint16_t counter) const
+{
+	// offers created in the same second are few, walk them
+	for (auto it = byCreated.lower_bound({created, 0}); it != byCreated.end() && it->first == created; ++it) {
+		if ((it->second & 0xFFFF) == counter) {
+			return &orders.at(it->second);
+		}
+	}
+	return nullptr;
+}
+
+const MarketOrder* MarketOrderBook::getOldest() const
+{
+	if (byCreated.empty()) {
+		return nullptr;
+	}
+	return &orders.at(byCreated.begin()->second);
+}
@@ -0,0 +1,95 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_MARKETORDERBOOK_H
+#define FS_MARKETORDERBOOK_H
+
+#include <array>
+#include <gtl/phmap.hpp>
+#include <gtl/btree.hpp>
+#include "enums.h"
+
+// an active offer as it is stored in `market_offers`
+struct MarketOrder
+{
+	std::string playerName;
+	uint32_t id;
+	uint32_t playerId;
+	uint32_t created;
+	uint32_t price;
+	uint16_t itemId;
+	uint16_t amount;
+	MarketAction_t type;
+	bool anonymous;
+};
+
+// The active market offers, by item with both sides sorted by price, by owner
+// and by creation time, so browsing, lookups and expiry never scan the rest.
+// Only used from the dispatcher.
+class MarketOrderBook
+{
+	public:
+		void add(MarketOrder&& order);
+		void remove(uint32_t id);
+
+		MarketOrder* find(uint32_t id);
+		// the client names an offer by its creation time and the low 16 bits of its id
+		const MarketOrder* findByCounter(uint32_t created, uint16_t counter) const;
+		// the offer to expire first, nullptr when there is none
+		const MarketOrder* getOldest() const;
+
+		// calls f(order) for every offer of itemId on one side, best price first
+		template <typename F>
+		void forEachOffer(MarketAction_t type, uint16_t itemId, F&& f) const {
+			auto it = books.find(itemId);
+			if (it == books.end()) {
+				return;
+			}
+
+			const Side& side = it->second[type];
+			if (type == MARKETACTION_BUY) {
+				for (auto entry = side.rbegin(); entry != side.rend(); ++entry) {
+					f(orders.at(entry->second));
+				}
+			} else {
+				for (const auto& entry : side) {
+					f(orders.at(entry.second));
+				}
+			}
+		}
+
+		// calls f(order) for every offer of playerId, oldest first
+		template <typename F>
+		void forEachOwnOffer(uint32_t playerId, F&& f) const {
+			auto it = playerOrders.find(playerId);
+			if (it == playerOrders.end()) {
+				return;
+			}
+
+			for (uint32_t id : it->second) {
+				f(orders.at(id));
+			}
+		}
+
+		size_t getOfferCount(uint32_t playerId) const {
+			auto it = playerOrders.find(playerId);
+			return it != playerOrders.end() ? it->second.size() : 0;
+		}
+
+		bool empty() const {
+			return orders.empty();
+		}
+
+	private:
+		// price and id
+		using Side = gtl::btree_set<std::pair<uint32_t, uint32_t>>;
+
+		gtl::flat_hash_map<uint32_t, MarketOrder> orders;
+		// by item, indexed by MarketAction_t
+		gtl::flat_hash_map<uint16_t, std::array<Side, 2>> books;
+		gtl::flat_hash_map<uint32_t, gtl::btree_set<uint32_t>> playerOrders;
+		// creation time and id
+		gtl::btree_set<std::pair<uint32_t, uint32_t>> byCreated;
+};
+
+#endif
@@ -0,0 +1,59 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "memoryreport.h"
+
+#include "condition.h"
+#include "database.h"
+#include "game.h"
+#include "monster.h"
+#include "npc.h"
+#include "outputmessage.h"
+
+#include <unordered_set>
+
+extern Game g_game;
+
+namespace {
+
+template <typename T>
+MemoryReportEntry countInstances(const char* name)
+{
+	const uint64_t count = T::getInstanceCount();
+	return {name, count, count * sizeof(T)};
+}
+
+}
+
+std::vector<MemoryReportEntry> collectMemoryReport()
+{
+	std::vector<MemoryReportEntry> report;
+	report.reserve(12);
+	report.push_back(countInstances<Item>("items"));
+	report.push_back(countInstances<Tile>("tiles"));
+	report.push_back(countInstances<Player>("players"));
+	report.push_back(countInstances<Monster>("monsters"));
+	report.push_back(countInstances<Npc>("npcs"));
+	report.push_back(countInstances<Condition>("conditions"));
+	report.push_back(countInstances<OutputMessage>("outputMessages"));
+	// buffered rows are held by the client library, only the results are counted
+	report.push_back(countInstances<DBResult>("databaseResults"));
+
+	// several interfaces may share one state
+	std::unordered_set<lua_State*> states;
+	uint64_t luaBytes = 0;
+	for (const LuaScriptInterface* scriptInterface : LuaScriptInterface::getInterfaces()) {
+		lua_State* L = scriptInterface->getLuaState();
+		if (L && states.insert(L).second) {
+			luaBytes += static_cast<uint64_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+		}
+	}
+	report.push_back({"luaStates", states.size(), luaBytes});
+
+	size_t spectatorEntries = 0;
+	const size_t spectatorBytes = g_game.map.getSpectatorCacheUsage(spectatorEntries);
+	report.push_back({"spectatorCaches", spectatorEntries, spectatorBytes});
+	return report;
+}
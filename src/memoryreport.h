@@ -0,0 +1,24 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_MEMORYREPORT_H
+#define FS_MEMORYREPORT_H
+
+#include <cstdint>
+#include <vector>
+
+// Live objects and about the bytes they hold, by subsystem. The bytes of a
+// type are its count times its size, what its members allocate besides is
+// not followed, so they are a floor to compare between reports rather than
+// the whole of it.
+struct MemoryReportEntry
+{
+	const char* name;
+	uint64_t count;
+	uint64_t bytes;
+};
+
+// dispatcher thread
+std::vector<MemoryReportEntry> collectMemoryReport();
+
+#endif
@@ -0,0 +1,252 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "metrics.h"
+#include "configmanager.h"
+#include "connection.h"
+#include "databasetasks.h"
+#include "game.h"
+#include "luascript.h"
+#include "monster.h"
+#include "scheduler.h"
+
+#include <fmt/format.h>
+
+extern ConfigManager g_config;
+extern Game g_game;
+extern LuaEnvironment g_luaEnvironment;
+
+std::mutex MetricsServer::snapshotLock;
+std::shared_ptr<const std::string> MetricsServer::snapshot;
+
+namespace {
+
+// a request line and a few headers, anything longer is not a scrape
+constexpr size_t METRICS_MAX_REQUEST = 4096;
+constexpr uint32_t METRICS_REQUEST_TIMEOUT = 5;
+// latency buckets go up to 2^25 microseconds, about half a minute
+constexpr size_t METRICS_HISTOGRAM_BUCKETS = 26;
+
+class MetricsSession : public std::enable_shared_from_this<MetricsSession>
+{
+	public:
+		explicit MetricsSession(boost::asio::io_context& io_context) : socket(io_context), timer(io_context), request(METRICS_MAX_REQUEST) {}
+
+		boost::asio::ip::tcp::socket& getSocket() {
+			return socket;
+		}
+
+		void start() {
+			timer.expires_after(std::chrono::seconds(METRICS_REQUEST_TIMEOUT));
+			timer.async_wait([thisPtr = std::weak_ptr<MetricsSession>(shared_from_this())](const boost::system::error_code& error) {
+				if (auto session = thisPtr.lock(); session && !error) {
+					session->close();
+				}
+			});
+
+			boost::asio::async_read_until(socket, request, "\r\n\r\n",
+				[thisPtr = shared_from_this()](const boost::system::error_code& error, size_t) { thisPtr->onRead(error); });
+		}
+
+	private:
+		void onRead(const boost::system::error_code& error) {
+			if (error) {
+				close();
+				return;
+			}
+
+			std::istream stream(&request);
+			std::string method, target;
+			stream >> method >> target;
+
+			if (method != "GET") {
+				respond("405 Method Not Allowed", nullptr);
+			} else if (target != "/metrics" && target != "/") {
+				respond("404 Not Found", nullptr);
+			} else if (auto metrics = MetricsServer::getSnapshot()) {
+				respond("200 OK", std::move(metrics));
+			} else {
+				respond("503 Service Unavailable", nullptr);
+			}
+		}
+
+		void respond(const char* status, std::shared_ptr<const std::string> metrics) {
+			body = metrics ? std::move(metrics) : std::make_shared<const std::string>();
+			header = fmt::format("HTTP/1.1 {:s}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: {:d}\r\nConnection: close\r\n\r\n", status, body->size());
+
+			const std::array<boost::asio::const_buffer, 2> buffers = {boost::asio::buffer(header), boost::asio::buffer(*body)};
+			boost::asio::async_write(socket, buffers, [thisPtr = shared_from_this()](const boost::system::error_code&, size_t) { thisPtr->close(); });
+		}
+
+		void close() {
+			timer.cancel();
+			boost::system::error_code error;
+			socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+			socket.close(error);
+		}
+
+		boost::asio::ip::tcp::socket socket;
+		boost::asio::steady_timer timer;
+		boost::asio::streambuf request;
+		std::string header;
+		// the snapshot stays alive until it was written
+		std::shared_ptr<const std::string> body;
+};
+
+void addHeader(std::string& out, std::string_view name, std::string_view type, std::string_view help)
+{
+	out += fmt::format("# HELP {:s} {:s}\n# TYPE {:s} {:s}\n", name, help, name, type);
+}
+
+template <typename T>
+void addMetric(std::string& out, std::string_view name, std::string_view type, std::string_view help, T value)
+{
+	addHeader(out, name, type, help);
+	out += fmt::format("{:s} {}\n", name, value);
+}
+
+void addHistogram(std::string& out, std::string_view name, std::string_view help, const LatencyHistogram& histogram)
+{
+	addHeader(out, name, "histogram", help);
+
+	const auto& buckets = histogram.getBuckets();
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; ++i) {
+		cumulative += buckets[i];
+		out += fmt::format("{:s}_bucket{{le=\"{:g}\"}} {:d}\n", name, (uint64_t{1} << i) / 1e6, cumulative);
+	}
+	out += fmt::format("{:s}_bucket{{le=\"+Inf\"}} {:d}\n", name, histogram.getCount());
+	out += fmt::format("{:s}_sum {:g}\n{:s}_count {:d}\n", name, histogram.getSum() / 1e6, name, histogram.getCount());
+}
+
+}
+
+MetricsServer::~MetricsServer()
+{
+	close();
+}
+
+void MetricsServer::openAcceptor(const std::weak_ptr<MetricsServer>& weakServer, uint16_t port)
+{
+	if (auto server = weakServer.lock()) {
+		server->open(port);
+	}
+}
+
+void MetricsServer::open(uint16_t port)
+{
+	close();
+
+	serverPort = port;
+	pendingStart = false;
+
+	try {
+		if (g_config.getBoolean(ConfigManager::BIND_ONLY_GLOBAL_ADDRESS)) {
+			acceptor.reset(new boost::asio::ip::tcp::acceptor(io_context, boost::asio::ip::tcp::endpoint(
+			            boost::asio::ip::address(boost::asio::ip::make_address(g_config.getString(ConfigManager::IP))), serverPort)));
+		} else {
+			acceptor.reset(new boost::asio::ip::tcp::acceptor(io_context, boost::asio::ip::tcp::endpoint(
+			            boost::asio::ip::address(boost::asio::ip::address_v4(INADDR_ANY)), serverPort)));
+		}
+
+		accept();
+	} catch (boost::system::system_error& e) {
+		std::cout << "[MetricsServer::open] Error: " << e.what() << std::endl;
+
+		pendingStart = true;
+		g_scheduler.addEvent(createSchedulerTask(15000, [=, thisPtr = std::weak_ptr<MetricsServer>(shared_from_this())]() { MetricsServer::openAcceptor(thisPtr, serverPort); }));
+	}
+}
+
+void MetricsServer::close() const
+{
+	if (acceptor && acceptor->is_open()) {
+		boost::system::error_code error;
+		acceptor->close(error);
+	}
+}
+
+void MetricsServer::accept()
+{
+	if (!acceptor) {
+		return;
+	}
+
+	auto session = std::make_shared<MetricsSession>(io_context);
+	acceptor->async_accept(session->getSocket(), [session, thisPtr = shared_from_this()](const boost::system::error_code& error) {
+		if (!error) {
+			session->start();
+			thisPtr->accept();
+		} else if (error != boost::asio::error::operation_aborted && !thisPtr->pendingStart) {
+			thisPtr->close();
+			thisPtr->pendingStart = true;
+			g_scheduler.addEvent(createSchedulerTask(15000, [=]() { MetricsServer::openAcceptor(thisPtr, thisPtr->serverPort); }));
+		}
+	});
+}
+
+std::shared_ptr<const std::string> MetricsServer::getSnapshot()
+{
+	std::lock_guard<std::mutex> lockGuard(snapshotLock);
+	return snapshot;
+}
+
+void MetricsServer::updateSnapshot()
+{
+	std::string out;
+	out.reserve(8192);
+
+	addMetric(out, "blacktek_players_online", "gauge", "Players logged in.", g_game.getPlayersOnline());
+	addMetric(out, "blacktek_monsters_online", "gauge", "Monsters in the world.", g_game.getMonstersOnline());
+	addMetric(out, "blacktek_npcs_online", "gauge", "Npcs in the world.", g_game.getNpcsOnline());
+
+	size_t awakeMonsters = 0;
+	for (const auto& monster : g_game.getMonsters()) {
+		if (!monster->getIdleStatus()) {
+			++awakeMonsters;
+		}
+	}
+	addMetric(out, "blacktek_monsters_awake", "gauge", "Monsters thinking because a player is around.", awakeMonsters);
+
+	const TaskStats& dispatcherStats = g_dispatcher.getStats();
+	addMetric(out, "blacktek_dispatcher_queue_depth", "gauge", "Tasks waiting for the game thread.", g_dispatcher.getQueueSize());
+	addHistogram(out, "blacktek_dispatcher_task_wait_seconds", "Time tasks waited in the queue, one in eight sampled.", dispatcherStats.getWaitTime());
+	addHistogram(out, "blacktek_dispatcher_task_execution_seconds", "Time tasks ran on the game thread, one in eight sampled.", dispatcherStats.getExecutionTime());
+	addMetric(out, "blacktek_dispatcher_expired_tasks_total", "counter", "Tasks dropped after waiting past their expiration.", dispatcherStats.getExpired());
+	addMetric(out, "blacktek_scheduler_pending_events", "gauge", "Events waiting for their deadline.", g_scheduler.getEventCount());
+
+	const DatabaseTasks::Stats databaseStats = g_databaseTasks.getStats();
+	addMetric(out, "blacktek_database_workers", "gauge", "Threads running queries.", databaseStats.workers);
+	addMetric(out, "blacktek_database_queue_depth", "gauge", "Database tasks waiting for a worker.", databaseStats.queued);
+	addMetric(out, "blacktek_database_tasks_total", "counter", "Database tasks completed.", databaseStats.completed);
+	addMetric(out, "blacktek_database_task_wait_seconds_total", "counter", "Time database tasks waited for a worker.", databaseStats.totalWait / 1e6);
+	addMetric(out, "blacktek_database_task_run_seconds_total", "counter", "Time database tasks ran.", databaseStats.totalRun / 1e6);
+	addMetric(out, "blacktek_database_task_run_max_seconds", "gauge", "Longest time a database task ran.", databaseStats.maxRun / 1e6);
+
+	const auto traffic = ConnectionManager::getInstance().getTraffic();
+	addHeader(out, "blacktek_network_received_bytes_total", "counter", "Bytes read from the connections of each protocol.");
+	for (const auto& [protocol, received, sent] : traffic) {
+		out += fmt::format("blacktek_network_received_bytes_total{{protocol=\"{:s}\"}} {:d}\n", protocol, received);
+	}
+	addHeader(out, "blacktek_network_sent_bytes_total", "counter", "Bytes written to the connections of each protocol.");
+	for (const auto& [protocol, received, sent] : traffic) {
+		out += fmt::format("blacktek_network_sent_bytes_total{{protocol=\"{:s}\"}} {:d}\n", protocol, sent);
+	}
+
+	addMetric(out, "blacktek_spectator_cache_hits_total", "counter", "Spectator queries answered from a cache.", g_game.map.getSpectatorCacheHits());
+	addMetric(out, "blacktek_spectator_cache_misses_total", "counter", "Spectator queries that scanned the map.", g_game.map.getSpectatorCacheMisses());
+	addMetric(out, "blacktek_decaying_items", "gauge", "Items waiting to decay.", g_game.getDecayWheel().size());
+
+	lua_State* L = g_luaEnvironment.getLuaState();
+	addMetric(out, "blacktek_lua_memory_bytes", "gauge", "Memory of the main Lua state.", lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0));
+
+	{
+		std::lock_guard<std::mutex> lockGuard(snapshotLock);
+		snapshot = std::make_shared<const std::string>(std::move(out));
+	}
+
+	const int64_t interval = std::max<int64_t>(100, g_config.getNumber(ConfigManager::METRICS_INTERVAL));
+	g_scheduler.addEvent(createSchedulerTask(interval, []() { updateSnapshot(); }, DISPATCHER_LANE_BACKGROUND));
+}
@@ -0,0 +1,44 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_METRICS_H
+#define FS_METRICS_H
+
+// Answers Prometheus scrapes of /metrics over plain HTTP on metricsPort. The
+// metrics are rendered to text on the dispatcher every metricsInterval, a
+// scrape gets the latest text from the network thread, so it never waits for
+// the game thread nor reads its state.
+class MetricsServer : public std::enable_shared_from_this<MetricsServer>
+{
+	public:
+		explicit MetricsServer(boost::asio::io_context& io_context) : io_context(io_context) {}
+		~MetricsServer();
+
+		// non-copyable
+		MetricsServer(const MetricsServer&) = delete;
+		MetricsServer& operator=(const MetricsServer&) = delete;
+
+		static void openAcceptor(const std::weak_ptr<MetricsServer>& weakServer, uint16_t port);
+		void open(uint16_t port);
+		void close() const;
+
+		// dispatcher thread, renders the metrics and schedules the next time
+		static void updateSnapshot();
+		// any thread, null until the first update
+		static std::shared_ptr<const std::string> getSnapshot();
+
+	private:
+		void accept();
+
+		boost::asio::io_context& io_context;
+		std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
+		uint16_t serverPort = 0;
+		bool pendingStart = false;
+
+		static std::mutex snapshotLock;
+		static std::shared_ptr<const std::string> snapshot;
+};
+
+using MetricsServer_ptr = std::shared_ptr<MetricsServer>;
+
+#endif
@@ -18,7 +18,6 @@ extern ConfigManager g_config;
 int32_t Monster::despawnRange;
 int32_t Monster::despawnRadius;
 
-uint32_t Monster::monsterAutoID = 0x40000000;
 
 MonsterPtr Monster::createMonster(const std::string& name)
 {
@@ -30,6 +29,7 @@ MonsterPtr Monster::createMonster(const std::string& name)
 }
 
 Monster::Monster(MonsterType* mType) :
+	name(mType->name),
 	nameDescription(mType->nameDescription),
 	mType(mType)
 {
@@ -57,6 +57,13 @@ Monster::~Monster()
 	clearFriendList();
 }
 
+void Monster::setID()
+{
+	if (id == 0) {
+		id = g_game.reserveMonsterId(getMonster());
+	}
+}
+
 void Monster::addList()
 {
 	g_game.addMonster(getMonster());
@@ -69,10 +76,7 @@ void Monster::removeList()
 
 const std::string& Monster::getName() const
 {
-	if (name.empty()) {
-		return mType->name;
-	}
-	return name;
+	return name.str();
 }
 
 void Monster::setName(const std::string& name)
@@ -81,7 +85,7 @@ void Monster::setName(const std::string& name)
 		return;
 	}
 
-	this->name = name;
+	this->name = InternedString(name.empty() ? mType->name : name);
 
 	// NOTE: Due to how client caches known creatures,
 	// it is not feasible to send creature update to everyone that has ever met it
@@ -94,7 +98,7 @@ const std::string& Monster::getNameDescription() const
 	if (nameDescription.empty()) {
 		return mType->nameDescription;
 	}
-	return nameDescription;
+	return nameDescription.str();
 }
 
 bool Monster::canSee(const Position& pos) const
@@ -139,11 +143,9 @@ void Monster::onCreatureAppear(const CreaturePtr& creature, const bool isLogin)
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureAppearEvent);
 
-		LuaScriptInterface::pushSharedPtr(L, getMonster());
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushSharedPtr(L, getMonster(), LuaData_Monster);
 
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 
 		if (scriptInterface->callFunction(2)) {
 			return;
@@ -181,11 +183,9 @@ void Monster::onRemoveCreature(const CreaturePtr& creature, const bool isLogout)
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureDisappearEvent);
 
-		LuaScriptInterface::pushSharedPtr(L, getMonster());
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushSharedPtr(L, getMonster(), LuaData_Monster);
 
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 
 		if (scriptInterface->callFunction(2)) {
 			return;
@@ -222,11 +222,9 @@ void Monster::onCreatureMove(const CreaturePtr& creature, const TilePtr& newTile
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureMoveEvent);
 
-		LuaScriptInterface::pushSharedPtr(L, getMonster());
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushSharedPtr(L, getMonster(), LuaData_Monster);
 
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 
 		LuaScriptInterface::pushPosition(L, oldPos);
 		LuaScriptInterface::pushPosition(L, newPos);
@@ -241,7 +239,12 @@ void Monster::onCreatureMove(const CreaturePtr& creature, const TilePtr& newTile
 			isMasterInRange = canSee(getMaster()->getPosition());
 		}
 
-		updateTargetList();
+		// summons drop targets they cannot reach and find them again on the next rescan
+		if (teleport || isSummon() || targetListStale || oldPos.z != newPos.z) {
+			updateTargetList();
+		} else {
+			updateTargetListAfterStep(oldPos);
+		}
 		updateIdleStatus();
 	} else {
 		const bool canSeeNewPos = canSee(newPos);
@@ -303,11 +306,9 @@ void Monster::onCreatureSay(const CreaturePtr& creature, SpeakClasses type, cons
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.creatureSayEvent);
 
-		LuaScriptInterface::pushSharedPtr(L, getMonster());
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushSharedPtr(L, getMonster(), LuaData_Monster);
 
-		LuaScriptInterface::pushSharedPtr(L, creature);
-		LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+		LuaScriptInterface::pushCreature(L, creature);
 
 		lua_pushinteger(L, type);
 		LuaScriptInterface::pushString(L, text);
@@ -363,6 +364,32 @@ void Monster::removeTarget(const CreaturePtr& creature)
 
 
 void Monster::updateTargetList()
+{
+	removeUnseenTargets();
+
+	// Update with new spectators
+	SpectatorVec spectators;
+	g_game.map.getSpectators(spectators, position, true);
+	spectators.erase(this->getCreature());
+	for (const auto& spectator : spectators) {
+		onCreatureFound(spectator);
+	}
+	targetListStale = false;
+}
+
+void Monster::updateTargetListAfterStep(const Position& oldPos)
+{
+	removeUnseenTargets();
+
+	// everything else in view was seen from oldPos and came in through onCreatureEnter
+	SpectatorVec spectators;
+	g_game.map.getEnteringSpectators(spectators, oldPos, position);
+	for (const auto& spectator : spectators) {
+		onCreatureFound(spectator);
+	}
+}
+
+void Monster::removeUnseenTargets()
 {
 	auto friendIterator = friendList.begin();
 	while (friendIterator != friendList.end()) {
@@ -386,14 +413,6 @@ void Monster::updateTargetList()
 			++targetIterator;
 		}
 	}
-
-	// Update with new spectators
-	SpectatorVec spectators;
-	g_game.map.getSpectators(spectators, position, true);
-	spectators.erase(this->getCreature());
-	for (const auto& spectator : spectators) {
-		onCreatureFound(spectator);
-	}
 }
 
 void Monster::clearTargetList()
@@ -674,7 +693,7 @@ bool Monster::selectTarget(const CreaturePtr& creature)
 
 	if (isHostile() || isSummon()) {
 		if (setAttackedCreature(creature) && !isSummon()) {
-			g_dispatcher.addTask(createTask([id = getID()]() { g_game.checkCreatureAttack(id); }));
+			g_dispatcher.addTask(createTask([id = getID()]() { g_game.checkCreatureAttack(id); }, DISPATCHER_LANE_CREATURE));
 		}
 	}
 
@@ -688,6 +707,7 @@ void Monster::setIdle(const bool idle)
 		return;
 	}
 
+	const bool changed = isIdle != idle;
 	isIdle = idle;
 
 	if (!isIdle) {
@@ -696,14 +716,33 @@ void Monster::setIdle(const bool idle)
 		onIdleStatus();
 		clearTargetList();
 		clearFriendList();
-		Game::removeCreatureCheck(this->getCreature());
+		targetListStale = true;
+		g_game.removeCreatureCheck(this->getCreature());
+	}
+
+	if (changed) {
+		for (const auto& summon : summons) {
+			if (const auto& summonMonster = summon->getMonster()) {
+				summonMonster->updateIdleStatus();
+			}
+		}
 	}
 }
 
+bool Monster::canSleep() const
+{
+	if (!isSummon()) {
+		return true;
+	}
+
+	const auto& masterMonster = getMaster()->getMonster();
+	return masterMonster && masterMonster->getIdleStatus();
+}
+
 void Monster::updateIdleStatus()
 {
 	bool idle = false;
-	if (!isSummon() && targetList.empty()) {
+	if (targetList.empty() && canSleep()) {
 		// check if there are aggressive conditions
 		idle = std::ranges::find_if(conditions, [](const Condition* condition) {
 			return condition->isAggressive();
@@ -750,8 +789,7 @@ void Monster::onThink(const uint32_t interval)
 		lua_State* L = scriptInterface->getLuaState();
 		scriptInterface->pushFunction(mType->info.thinkEvent);
 
-		LuaScriptInterface::pushUserdata<Monster>(L, this);
-		LuaScriptInterface::setMetatable(L, -1, "Monster");
+		LuaScriptInterface::pushSharedPtr(L, getMonster(), LuaData_Monster);
 
 		lua_pushinteger(L, interval);
 
@@ -827,7 +865,8 @@ void Monster::doAttacking(const uint32_t interval)
 		}
 
 		if (canUseSpell(myPos, targetPos, spellBlock, interval, inRange, resetTicks)) {
-			if (spellBlock.chance >= static_cast<uint32_t>(uniform_random(1, 100))) {
+			// a sure spell needs no roll
+			if (spellBlock.chance >= 100 || spellBlock.chance >= static_cast<uint32_t>(uniform_random(1, 100))) {
 				if (!lookUpdated) {
 					updateLookDirection();
 					lookUpdated = true;
@@ -863,13 +902,9 @@ bool Monster::canUseAttack(const Position& pos, const CreatureConstPtr& target)
 {
 	if (isHostile()) {
 		const Position& targetPos = target->getPosition();
+		// some ranged spell reaches exactly when the widest one does
 		const uint32_t distance = std::max<uint32_t>(Position::getDistanceX(pos, targetPos), Position::getDistanceY(pos, targetPos));
-		for (const spellBlock_t& spellBlock : mType->info.attackSpells) {
-			if (spellBlock.range != 0 && distance <= spellBlock.range) {
-				return g_game.isSightClear(pos, targetPos, true);
-			}
-		}
-		return false;
+		return mType->info.attackRange != 0 && distance <= mType->info.attackRange && g_game.isSightClear(pos, targetPos, true);
 	}
 	return true;
 }
@@ -967,7 +1002,7 @@ void Monster::onThinkDefense(const uint32_t interval)
 			continue;
 		}
 
-		if ((spellBlock.chance >= static_cast<uint32_t>(uniform_random(1, 100)))) {
+		if (spellBlock.chance >= 100 || spellBlock.chance >= static_cast<uint32_t>(uniform_random(1, 100))) {
 			minCombatValue = spellBlock.minCombatValue;
 			maxCombatValue = spellBlock.maxCombatValue;
 			spellBlock.spell->castSpell(this->getMonster(), this->getCreature());
@@ -1857,32 +1892,20 @@ void Monster::death(const CreaturePtr&)
 	// rewardboss
 	if (const auto it = g_game.rewardBossTracking.find(monsterId); it != g_game.rewardBossTracking.end()) {
 		if (isRewardBoss())	{
-			auto& bossScoreTable = it->second;
-			uint32_t topContributerId = 0;
-			int32_t topScore = 0;
-			int32_t totalScore = 0;
-			int32_t totalDamageDone = 0;
-			int32_t totalDamageTaken = 0;
-			int32_t totalHealingDone = 0;
-			const int32_t contributors = bossScoreTable.playerScoreTable.size();
-
-			for (const auto& [playerId, score] : bossScoreTable.playerScoreTable) {
-				const int32_t playerScore = score.damageDone + score.damageTaken + score.healingDone; 
-				totalScore += playerScore;
-				totalDamageDone += score.damageDone;
-				totalDamageTaken += score.damageTaken;
-				totalHealingDone += score.healingDone;
-				
-				if (playerScore > topScore) {
-					topScore = playerScore;
-					topContributerId = playerId;
-				}
-			}
+			// the totals and the top contributor are kept as the contributions come in
+			const Game::RewardBossContributionInfo bossScoreTable = std::move(it->second);
+			g_game.resetDamageTracking(monsterId);
+
+			const int32_t totalScore = bossScoreTable.totalScore;
+			const int32_t contributors = bossScoreTable.scores.size();
+			const uint32_t topContributerId = bossScoreTable.topScore > 0 ? bossScoreTable.playerGuids[bossScoreTable.topSlot] : 0;
 
 			const auto& creatureLoot = mType->info.lootItems;
 			int64_t currentTime = time(nullptr);
 
-			for (const auto& [playerId, score] : bossScoreTable.playerScoreTable) {
+			for (size_t slot = 0; slot < bossScoreTable.scores.size(); ++slot) {
+				const uint32_t playerId = bossScoreTable.playerGuids[slot];
+				const Game::PlayerScoreInfo& score = bossScoreTable.scores[slot];
 
 				const auto contributionScore =
 					(score.damageDone * g_config.getFloat(ConfigManager::REWARD_RATE_DAMAGE_DONE))
@@ -1948,7 +1971,6 @@ void Monster::death(const CreaturePtr&)
 					}
 				}
 			}
-			g_game.resetDamageTracking(monsterId);
 		}
 	}
 
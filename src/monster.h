@@ -6,6 +6,8 @@
 
 #include "tile.h"
 #include "monsters.h"
+#include "internedstring.h"
+#include "instancecounter.h"
 
 class Creature;
 class Game;
@@ -21,7 +23,7 @@ enum TargetSearchType_t {
 	TARGETSEARCH_NEAREST,
 };
 
-class Monster final : public Creature
+class Monster final : public Creature, public InstanceCounter<Monster>
 {
 	public:
 		static MonsterPtr createMonster(const std::string& name);
@@ -43,11 +45,7 @@ class Monster final : public Creature
 			return static_shared_this<const Monster>();
 		}
 
-		void setID() override {
-			if (id == 0) {
-				id = monsterAutoID++;
-			}
-		}
+		void setID() override;
 
 		void addList() override;
 		void removeList() override;
@@ -61,11 +59,16 @@ class Monster final : public Creature
 		const std::string& getNameDescription() const override;
 	
 		void setNameDescription(const std::string& nameDescription) {
-			this->nameDescription = nameDescription;
+			this->nameDescription = InternedString(nameDescription);
 		};
 
 		std::string getDescription(int32_t) const override {
-			return nameDescription + '.';
+			return nameDescription.str() + '.';
+		}
+
+		// the same for every monster whose name is equal ignoring case
+		uint32_t getNameId() const {
+			return name.id();
 		}
 
 		CreatureType_t getType() const override {
@@ -137,6 +140,9 @@ class Monster final : public Creature
 		void onRemoveCreature(const CreaturePtr& creature, bool isLogout) override;
 		void onCreatureMove(const CreaturePtr& creature, const TilePtr& newTile, const Position& newPos, const TilePtr& oldTile, const Position& oldPos, bool teleport) override;
 		void onCreatureSay(const CreaturePtr& creature, SpeakClasses type, const std::string& text) override;
+		bool listensToSpeech() const override {
+			return mType->info.creatureSayEvent != -1;
+		}
 
 		void drainHealth(const CreaturePtr& attacker, int32_t damage) override;
 		void changeHealth(int32_t healthChange, bool sendHealthChange = true) override;
@@ -144,6 +150,10 @@ class Monster final : public Creature
 		bool isWalkingToSpawn() const {
 			return walkingToSpawn;
 		}
+
+		bool getIdleStatus() const {
+			return isIdle;
+		}
 	
 		bool walkToSpawn();
 		void onWalk() override;
@@ -202,14 +212,12 @@ class Monster final : public Creature
 		BlockType_t blockHit(const CreaturePtr& attacker, CombatType_t combatType, int32_t& damage,
 		                     bool checkDefense = false, bool checkArmor = false, bool field = false, bool ignoreResistances = false) override;
 
-		static uint32_t monsterAutoID;
-
 	private:
 		CreatureHashSet friendList;
 		CreatureList targetList;
 
-		std::string name;
-		std::string nameDescription;
+		InternedString name;
+		InternedString nameDescription;
 
 		MonsterType* mType;
 		Spawn* spawn = nullptr;
@@ -234,6 +242,8 @@ class Monster final : public Creature
 		bool isMasterInRange = false;
 		bool randomStepping = false;
 		bool walkingToSpawn = false;
+		// the lists were cleared or never filled, the next own move rescans the whole view
+		bool targetListStale = true;
 
 		void onCreatureEnter(const CreaturePtr& creature);
 		void onCreatureLeave(const CreaturePtr& creature);
@@ -247,6 +257,9 @@ class Monster final : public Creature
 		void removeTarget(const CreaturePtr& creature);
 
 		void updateTargetList();
+		// after a single step only the newly visible edge can hold creatures the lists miss
+		void updateTargetListAfterStep(const Position& oldPos);
+		void removeUnseenTargets();
 		void clearTargetList();
 		void clearFriendList();
 
@@ -255,10 +268,8 @@ class Monster final : public Creature
 
 		void setIdle(bool idle);
 		void updateIdleStatus();
-	
-		bool getIdleStatus() const {
-			return isIdle;
-		}
+		// summons of players follow them everywhere, summons of monsters sleep with their master
+		bool canSleep() const;
 
 		void onAddCondition(ConditionType_t type) override;
 		void onEndCondition(ConditionType_t type) override;
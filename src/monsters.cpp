@@ -20,6 +20,94 @@ extern ConfigManager g_config;
 
 gtl::flat_hash_map<std::string, SkillRegistry> monster_skills;
 
+namespace {
+
+void flattenLoot(const std::vector<LootBlock>& blocks, std::vector<CompiledLoot>& loot)
+{
+	for (const LootBlock& block : blocks) {
+		const ItemType& itemType = Item::items[block.id];
+		const size_t index = loot.size();
+		loot.push_back({block.text, block.chance, std::max<uint32_t>(1, block.countmax), 0, block.subType, block.actionId, block.id,
+		                itemType.stackable, itemType.isFluidContainer(), itemType.isContainer()});
+		if (itemType.isContainer()) {
+			flattenLoot(block.childLoot, loot);
+		}
+		loot[index].childEnd = loot.size();
+	}
+}
+
+// puts item with what was rolled so far, onto a stack of the same kind first as adding it would
+void addLootItem(ItemVector& items, const ItemPtr& item)
+{
+	if (item->isStackable()) {
+		for (const auto& stack : items) {
+			if (stack->getItemCount() < 100 && stack->equals(item)) {
+				const uint16_t count = std::min<uint16_t>(100 - stack->getItemCount(), item->getItemCount());
+				stack->setItemCount(stack->getItemCount() + count);
+				item->setItemCount(item->getItemCount() - count);
+				if (item->getItemCount() == 0) {
+					return;
+				}
+			}
+		}
+	}
+	items.push_back(item);
+}
+
+// rolls the entries of loot from begin up to end into items, up to slots of them
+bool rollLoot(const std::vector<CompiledLoot>& loot, size_t begin, size_t end, uint64_t rate, size_t slots, ItemVector& items)
+{
+	bool created = true;
+	for (size_t i = begin; i < end; i = loot[i].childEnd) {
+		if (items.size() >= slots) {
+			break;
+		}
+
+		const CompiledLoot& entry = loot[i];
+		const uint32_t roll = uniform_random(0, MAX_LOOTCHANCE);
+		if (roll >= entry.chance * rate) {
+			continue;
+		}
+
+		uint32_t count = entry.stackable ? uniform_random(1, entry.countMax) : 1;
+		while (count > 0 && items.size() < slots) {
+			const uint16_t stackCount = std::min<uint32_t>(100, count);
+			count -= stackCount;
+
+			const auto item = Item::CreateItem(entry.id, entry.fluidContainer ? std::max<int32_t>(0, entry.subType) : stackCount);
+			if (!item) {
+				created = false;
+				break;
+			}
+
+			if (entry.container && entry.childEnd > i + 1) {
+				const auto container = item->getContainer();
+				ItemVector contents;
+				created = rollLoot(loot, i + 1, entry.childEnd, rate, container->capacity(), contents) && created;
+				// a bag of loot that rolled nothing is not dropped
+				if (contents.empty()) {
+					continue;
+				}
+				container->addItems(contents);
+			}
+
+			if (entry.subType != -1) {
+				item->setIntAttr(ITEM_ATTRIBUTE_CHARGES, entry.subType);
+			}
+			if (entry.actionId != -1) {
+				item->setActionId(entry.actionId);
+			}
+			if (!entry.text.empty()) {
+				item->setText(entry.text);
+			}
+			addLootItem(items, item);
+		}
+	}
+	return created;
+}
+
+}
+
 bool Monsters::addMonsterSkill(std::string monster_name, std::string_view skill_name, const std::shared_ptr<CustomSkill>& skill)
 {
 	auto& skillMap = monster_skills[monster_name];
@@ -71,6 +159,7 @@ void MonsterType::loadLoot(MonsterType* monsterType, LootBlock lootBlock)
 	} else {
 		monsterType->info.lootItems.push_back(lootBlock);
 	}
+	monsterType->compileLoot();
 }
 
 bool Monsters::loadFromXml(bool reloading /*= false*/)
@@ -1457,9 +1546,42 @@ MonsterType* Monsters::loadMonster(const std::string& file, const std::string& m
 	mType->info.defenseSpells.shrink_to_fit();
 	mType->info.voiceVector.shrink_to_fit();
 	mType->info.scripts.shrink_to_fit();
+	mType->compileSpells();
+	mType->compileLoot();
 	return mType;
 }
 
+void MonsterType::compileSpells()
+{
+	info.attackRange = 0;
+	for (const spellBlock_t& spellBlock : info.attackSpells) {
+		info.attackRange = std::max(info.attackRange, spellBlock.range);
+	}
+}
+
+void MonsterType::compileLoot()
+{
+	info.compiledLoot.clear();
+	flattenLoot(info.lootItems, info.compiledLoot);
+	info.compiledLoot.shrink_to_fit();
+}
+
+bool MonsterType::createLoot(const ContainerPtr& corpse) const
+{
+	const uint64_t rate = std::max<int64_t>(0, g_config.getNumber(ConfigManager::RATE_LOOT));
+	const size_t slots = corpse->capacity() - std::min<size_t>(corpse->capacity(), corpse->size());
+	if (rate == 0 || slots == 0) {
+		return true;
+	}
+
+	// everything is rolled off the map, the corpse takes it in one go
+	ItemVector items;
+	items.reserve(std::min<size_t>(slots, info.compiledLoot.size()));
+	const bool created = rollLoot(info.compiledLoot, 0, info.compiledLoot.size(), rate, slots, items);
+	corpse->addItems(items);
+	return created;
+}
+
 bool MonsterType::loadCallback(LuaScriptInterface* scriptInterface)
 {
 	int32_t id = scriptInterface->getEvent();
@@ -1498,8 +1620,8 @@ bool Monsters::loadLootItem(const pugi::xml_node& node, LootBlock& lootBlock)
     }
     else if ((attr = node.attribute("name"))) {
         std::string name = asLowerCaseString(attr.as_string());
-        auto ids = Item::items.nameToItems.equal_range(name);
-        if (ids.first == Item::items.nameToItems.end()) {
+        auto ids = Item::items.getItemIdsByName(name);
+        if (ids.first == ids.second) {
             std::cout << "[Warning - Monsters::loadMonster] Unknown loot item \"" << name << "\"." << std::endl;
             return false;
         }
@@ -33,6 +33,21 @@ struct LootBlock {
 	}
 };
 
+// a loot block flattened by compileLoot, the entries after it up to childEnd are
+// what its container holds
+struct CompiledLoot {
+	std::string text;
+	uint32_t chance;
+	uint32_t countMax;
+	uint32_t childEnd;
+	int32_t subType;
+	int32_t actionId;
+	uint16_t id;
+	bool stackable;
+	bool fluidContainer;
+	bool container;
+};
+
 class Loot {
 	public:
 		Loot() = default;
@@ -97,6 +112,8 @@ class MonsterType
 		std::vector<voiceBlock_t> voiceVector;
 
 		std::vector<LootBlock> lootItems;
+		// lootItems in the order they are rolled, see compileLoot
+		std::vector<CompiledLoot> compiledLoot;
 		std::vector<std::string> scripts;
 		std::vector<spellBlock_t> attackSpells;
 		std::vector<spellBlock_t> defenseSpells;
@@ -134,6 +151,9 @@ class MonsterType
 		int32_t defense = 0;
 		int32_t armor = 0;
 
+		// widest range of the ranged attack spells, 0 when there are none, see compileSpells
+		uint32_t attackRange = 0;
+
 		bool canPushItems = false;
 		bool canPushCreatures = false;
 		bool pushable = true;
@@ -162,6 +182,12 @@ class MonsterType
 		MonsterType& operator=(const MonsterType&) = delete;
 
 		bool loadCallback(LuaScriptInterface* scriptInterface);
+		// refreshes what the think derives from the spell lists, after they changed
+		void compileSpells();
+		// refreshes compiledLoot, after the loot list changed
+		void compileLoot();
+		// rolls the loot into corpse as far as it has room, false if an item could not be created
+		bool createLoot(const ContainerPtr& corpse) const;
 
 		std::string name;
 		std::string nameDescription;
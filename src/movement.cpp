@@ -12,6 +12,13 @@
 extern Game g_game;
 extern Vocations g_vocations;
 
+namespace {
+
+// the events an item fires for what happens on its tile
+constexpr uint8_t TILE_EVENT_TYPES = (1 << MOVE_EVENT_STEP_IN) | (1 << MOVE_EVENT_STEP_OUT) | (1 << MOVE_EVENT_ADD_ITEM_ITEMTILE) | (1 << MOVE_EVENT_REMOVE_ITEM_ITEMTILE);
+
+}
+
 MoveEvents::MoveEvents() :
 	scriptInterface("MoveEvents Interface")
 {
@@ -61,10 +68,46 @@ void MoveEvents::clear(const bool fromLua)
 	clearMap(actionIdMap, fromLua);
 	clearMap(uniqueIdMap, fromLua);
 	clearPosMap(positionMap, fromLua);
+	updateEventTypes();
 
 	reInitState(fromLua);
 }
 
+void MoveEvents::updateEventTypes()
+{
+	const auto getTypes = [](const MoveEventList& moveEventList) {
+		uint8_t types = 0;
+		for (int eventType = MOVE_EVENT_STEP_IN; eventType < MOVE_EVENT_LAST; ++eventType) {
+			if (!moveEventList.moveEvent[eventType].empty()) {
+				types |= 1 << eventType;
+			}
+		}
+		return types;
+	};
+
+	itemIdEventTypes.assign(itemIdMap.empty() ? 0 : itemIdMap.rbegin()->first + 1, 0);
+	for (const auto& it : itemIdMap) {
+		if (it.first >= 0) {
+			itemIdEventTypes[it.first] = getTypes(it.second);
+		}
+	}
+
+	uniqueIdEventTypes = 0;
+	for (const auto& it : uniqueIdMap) {
+		uniqueIdEventTypes |= getTypes(it.second);
+	}
+
+	actionIdEventTypes = 0;
+	for (const auto& it : actionIdMap) {
+		actionIdEventTypes |= getTypes(it.second);
+	}
+
+	positionEventTypes = 0;
+	for (const auto& it : positionMap) {
+		positionEventTypes |= getTypes(it.second);
+	}
+}
+
 LuaScriptInterface& MoveEvents::getScriptInterface()
 {
 	return scriptInterface;
@@ -309,6 +352,28 @@ bool MoveEvents::registerLuaEvent(MoveEvent* event)
 
 void MoveEvents::addEvent(MoveEvent moveEvent, int32_t id, MoveListMap& map)
 {
+	const uint8_t type = 1 << moveEvent.getEventType();
+	if (&map == &itemIdMap) {
+		if (id >= 0) {
+			if (static_cast<size_t>(id) >= itemIdEventTypes.size()) {
+				itemIdEventTypes.resize(id + 1);
+			}
+			itemIdEventTypes[id] |= type;
+
+			if ((type & TILE_EVENT_TYPES) != 0 && (static_cast<size_t>(id) >= tileEventIds.size() || !tileEventIds[id])) {
+				if (static_cast<size_t>(id) >= tileEventIds.size()) {
+					tileEventIds.resize(id + 1);
+				}
+				tileEventIds[id] = true;
+				tileFlagsStale = tileFlagsStale || tileFlagsStarted;
+			}
+		}
+	} else if (&map == &uniqueIdMap) {
+		uniqueIdEventTypes |= type;
+	} else {
+		actionIdEventTypes |= type;
+	}
+
 	auto it = map.find(id);
 	if (it == map.end()) {
 		MoveEventList moveEventList;
@@ -342,6 +407,10 @@ MoveEvent* MoveEvents::getEvent(const ItemPtr& item, MoveEvent_t eventType, slot
 		default: slotp = 0; break;
 	}
 
+	if (!hasItemIdEvent(item->getID(), 1 << eventType)) {
+		return nullptr;
+	}
+
 	if (const auto it = itemIdMap.find(item->getID()); it != itemIdMap.end()) {
 		std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType];
 		for (MoveEvent& moveEvent : moveEventList) {
@@ -356,8 +425,9 @@ MoveEvent* MoveEvents::getEvent(const ItemPtr& item, MoveEvent_t eventType, slot
 MoveEvent* MoveEvents::getEvent(const ItemPtr& item, MoveEvent_t eventType)
 {
 	MoveListMap::iterator it;
+	const uint8_t type = 1 << eventType;
 
-	if (item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
+	if ((uniqueIdEventTypes & type) != 0 && item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
 		it = uniqueIdMap.find(item->getUniqueId());
 		if (it != uniqueIdMap.end()) {
 			if (std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType]; !moveEventList.empty()) {
@@ -366,7 +436,7 @@ MoveEvent* MoveEvents::getEvent(const ItemPtr& item, MoveEvent_t eventType)
 		}
 	}
 
-	if (item->hasAttribute(ITEM_ATTRIBUTE_ACTIONID)) {
+	if ((actionIdEventTypes & type) != 0 && item->hasAttribute(ITEM_ATTRIBUTE_ACTIONID)) {
 		it = actionIdMap.find(item->getActionId());
 		if (it != actionIdMap.end()) {
 			if (std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType]; !moveEventList.empty()) {
@@ -375,6 +445,10 @@ MoveEvent* MoveEvents::getEvent(const ItemPtr& item, MoveEvent_t eventType)
 		}
 	}
 
+	if (!hasItemIdEvent(item->getID(), type)) {
+		return nullptr;
+	}
+
 	it = itemIdMap.find(item->getID());
 	if (it != itemIdMap.end()) {
 		if (std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType]; !moveEventList.empty()) {
@@ -386,6 +460,8 @@ MoveEvent* MoveEvents::getEvent(const ItemPtr& item, MoveEvent_t eventType)
 
 void MoveEvents::addEvent(MoveEvent moveEvent, const Position& pos, MovePosListMap& map)
 {
+	positionEventTypes |= 1 << moveEvent.getEventType();
+
 	if (const auto it = map.find(pos); it == map.end()) {
 		MoveEventList moveEventList;
 		moveEventList.moveEvent[moveEvent.getEventType()].push_back(std::move(moveEvent));
@@ -402,6 +478,10 @@ void MoveEvents::addEvent(MoveEvent moveEvent, const Position& pos, MovePosListM
 
 MoveEvent* MoveEvents::getEvent(const TileConstPtr& tile, MoveEvent_t eventType)
 {
+	if ((positionEventTypes & (1 << eventType)) == 0) {
+		return nullptr;
+	}
+
 	if (const auto it = positionMap.find(tile->getPosition()); it != positionMap.end()) {
 		if (std::list<MoveEvent>& moveEventList = it->second.moveEvent[eventType]; !moveEventList.empty()) {
 			return &(*moveEventList.begin());
@@ -421,6 +501,11 @@ uint32_t MoveEvents::onCreatureMove(const CreaturePtr& creature, const TilePtr&
 		ret &= moveEvent->fireStepEvent(creature, nullptr, pos);
 	}
 
+	// no item on the tile has an event
+	if (!tileFlagsStale && !tile->hasFlag(TILESTATE_MOVEEVENT)) {
+		return ret;
+	}
+
 	for (size_t i = tile->getFirstIndex(), j = tile->getLastIndex(); i < j; ++i) {
 		auto thing = tile->getThing(i);
 		if (!thing) {
@@ -483,6 +568,10 @@ uint32_t MoveEvents::onItemMove(const ItemPtr& item, const TilePtr& tile, bool i
 		ret &= moveEvent->fireAddRemItem(item, nullptr, tile->getPosition());
 	}
 
+	if (!tileFlagsStale && !tile->hasFlag(TILESTATE_MOVEEVENT)) {
+		return ret;
+	}
+
 	for (size_t i = tile->getFirstIndex(), j = tile->getLastIndex(); i < j; ++i) {
 		const auto& thing = tile->getThing(i);
 		if (!thing) {
@@ -940,8 +1029,7 @@ bool MoveEvent::executeStep(const CreaturePtr& creature, const ItemPtr& item, co
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	LuaScriptInterface::pushThing(L, item);
 	LuaScriptInterface::pushPosition(L, pos);
 	LuaScriptInterface::pushPosition(L, creature->getLastPosition());
@@ -977,8 +1065,7 @@ bool MoveEvent::executeEquip(const PlayerPtr& player, const ItemPtr& item, slots
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	LuaScriptInterface::pushThing(L, item);
 	lua_pushinteger(L, slot);
 	LuaScriptInterface::pushBoolean(L, isCheck);
@@ -9,6 +9,8 @@
 #include "luascript.h"
 #include "vocation.h"
 
+#include <atomic>
+
 extern Vocations g_vocations;
 
 enum MoveEvent_t {
@@ -55,6 +57,15 @@ class MoveEvents final : public BaseEvents
 		bool registerLuaFunction(MoveEvent* event);
 		void clear(bool fromLua) override final;
 
+		// whether item, lying on a tile, may fire a step or item tile event, TILESTATE_MOVEEVENT marks such tiles
+		bool mayHaveTileEvent(const ItemConstPtr& item) const {
+			return (item->getID() < tileEventIds.size() && tileEventIds[item->getID()]) || item->hasAttribute(ITEM_ATTRIBUTE_ACTIONID) || item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+		}
+		// the map tiles are flagged from here on
+		void startTileFlags() {
+			tileFlagsStarted = true;
+		}
+
 	private:
 		using MoveListMap = std::map<int32_t, MoveEventList>;
 		using MovePosListMap = std::map<Position, MoveEventList>;
@@ -73,11 +84,30 @@ class MoveEvents final : public BaseEvents
 
 		MoveEvent* getEvent(const ItemPtr& item, MoveEvent_t eventType, slots_t slot);
 
+		// rebuilds the event type masks from the maps, after some were cleared
+		void updateEventTypes();
+		bool hasItemIdEvent(uint16_t id, uint8_t type) const {
+			return id < itemIdEventTypes.size() && (itemIdEventTypes[id] & type) != 0;
+		}
+
 		MoveListMap uniqueIdMap;
 		MoveListMap actionIdMap;
 		MoveListMap itemIdMap;
 		MovePosListMap positionMap;
 
+		// a bit per MoveEvent_t registered for every item id, and for any unique id,
+		// action id or position, a step where nothing can fire skips the map lookups
+		std::vector<uint8_t> itemIdEventTypes;
+		uint8_t uniqueIdEventTypes = 0;
+		uint8_t actionIdEventTypes = 0;
+		uint8_t positionEventTypes = 0;
+
+		// every item id that had a step or item tile event since the start, the tiles were flagged from it.
+		// an id that gets its first one after the map loaded is on tiles that were not, they are searched in full from then on
+		std::vector<bool> tileEventIds;
+		std::atomic<bool> tileFlagsStarted = false;
+		bool tileFlagsStale = false;
+
 		LuaScriptInterface scriptInterface;
 };
 
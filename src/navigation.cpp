@@ -0,0 +1,372 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "navigation.h"
+#include "map.h"
+
+#include <queue>
+
+namespace {
+
+// sectors are linked forward only while building, these cover every neighbour once
+constexpr std::array<std::pair<int32_t, int32_t>, 4> linkOffsets = {{{1, 0}, {0, 1}, {1, 1}, {-1, 1}}};
+
+// routes give up after this many areas, long before a sane map runs out of them
+constexpr size_t MAX_ROUTE_AREAS = 4096;
+
+}
+
+void NavigationGraph::build(Map& map)
+{
+	sectors.clear();
+	edges.clear();
+	dirtySectors.clear();
+
+	std::vector<Position> bases;
+	map.tileStates.forEachRegion([&bases](uint16_t x, uint16_t y, uint8_t z) {
+		bases.emplace_back(x, y, z);
+	});
+
+	for (const Position& base : bases) {
+		labelSector(map, base.x, base.y, base.z);
+	}
+
+	for (const Position& base : bases) {
+		for (const auto& [offsetX, offsetY] : linkOffsets) {
+			linkSectors(base.x, base.y, base.z, offsetX, offsetY);
+		}
+	}
+
+	built = true;
+}
+
+void NavigationGraph::invalidate(const Position& pos)
+{
+	if (built) {
+		dirtySectors.insert(getSectorKey(pos.x, pos.y, pos.z));
+	}
+}
+
+void NavigationGraph::getWalkableRows(Map& map, const uint16_t baseX, const uint16_t baseY, const uint8_t z, Rows& rows)
+{
+	rows.fill(0);
+
+	const TileStateMap& states = map.tileStates;
+	if (!states.getRow(baseX, baseY, z, TILESTATEPLANE_EXISTS)) {
+		return;
+	}
+
+	// the same tiles Map::isPathBlocked lets through
+	for (int32_t y = 0; y < NAVIGATION_SECTOR_SIZE; ++y) {
+		const uint16_t rowY = baseY + y;
+		rows[y] = *states.getRow(baseX, rowY, z, TILESTATEPLANE_EXISTS) &
+		          *states.getRow(baseX, rowY, z, TILESTATEPLANE_GROUND) &
+		          ~(*states.getRow(baseX, rowY, z, TILESTATEPLANE_BLOCKSOLID) |
+		            *states.getRow(baseX, rowY, z, TILESTATEPLANE_FLOORCHANGE) |
+		            *states.getRow(baseX, rowY, z, TILESTATEPLANE_TELEPORT));
+	}
+
+	// only invited players may enter houses, the graph keeps everyone out
+	for (int32_t y = 0; y < NAVIGATION_SECTOR_SIZE; ++y) {
+		for (uint64_t bits = rows[y]; bits != 0; bits &= bits - 1) {
+			const int32_t x = std::countr_zero(bits);
+			const TilePtr* tile = map.findTile(baseX + x, baseY + y, z);
+			if (tile && (*tile)->getHouse()) {
+				rows[y] &= ~(uint64_t(1) << x);
+			}
+		}
+	}
+}
+
+void NavigationGraph::labelSector(Map& map, const uint16_t baseX, const uint16_t baseY, const uint8_t z)
+{
+	const uint32_t sectorKey = getSectorKey(baseX, baseY, z);
+
+	Rows rows;
+	getWalkableRows(map, baseX, baseY, z, rows);
+	if (std::ranges::all_of(rows, [](uint64_t row) { return row == 0; })) {
+		sectors.erase(sectorKey);
+		return;
+	}
+
+	auto& sector = sectors[sectorKey];
+	if (!sector) {
+		sector = std::make_unique<Sector>();
+	}
+	sector->labels.fill(0);
+	sector->areas = 0;
+
+	std::vector<uint16_t> open;
+	for (int32_t y = 0; y < NAVIGATION_SECTOR_SIZE; ++y) {
+		for (uint64_t bits = rows[y]; bits != 0; bits &= bits - 1) {
+			const int32_t x = std::countr_zero(bits);
+			if (sector->labels[getCellIndex(x, y)] != 0) {
+				continue;
+			}
+
+			// areas past the last label stay out of the graph, long paths there use the plain search
+			if (sector->areas == std::numeric_limits<uint8_t>::max()) {
+				break;
+			}
+
+			const uint8_t label = ++sector->areas;
+			edges.try_emplace(getAreaKey(sectorKey, label));
+
+			sector->labels[getCellIndex(x, y)] = label;
+			open.push_back(getCellIndex(x, y));
+			while (!open.empty()) {
+				const uint16_t cell = open.back();
+				open.pop_back();
+
+				const int32_t cellX = cell & NAVIGATION_SECTOR_MASK;
+				const int32_t cellY = cell >> NAVIGATION_SECTOR_BITS;
+				for (int32_t ny = std::max(0, cellY - 1); ny <= std::min(NAVIGATION_SECTOR_SIZE - 1, cellY + 1); ++ny) {
+					for (int32_t nx = std::max(0, cellX - 1); nx <= std::min(NAVIGATION_SECTOR_SIZE - 1, cellX + 1); ++nx) {
+						uint8_t& neighbour = sector->labels[getCellIndex(nx, ny)];
+						if (neighbour == 0 && ((rows[ny] >> nx) & 1)) {
+							neighbour = label;
+							open.push_back(getCellIndex(nx, ny));
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void NavigationGraph::linkSectors(const uint16_t baseX, const uint16_t baseY, const uint8_t z, const int32_t offsetX, const int32_t offsetY)
+{
+	const int32_t otherX = baseX + offsetX * NAVIGATION_SECTOR_SIZE;
+	const int32_t otherY = baseY + offsetY * NAVIGATION_SECTOR_SIZE;
+	if (otherX < 0 || otherX > 0xFFFF || otherY < 0 || otherY > 0xFFFF) {
+		return;
+	}
+
+	const uint32_t sectorKey = getSectorKey(baseX, baseY, z);
+	const uint32_t otherKey = getSectorKey(otherX, otherY, z);
+	const auto it = sectors.find(sectorKey);
+	const auto otherIt = sectors.find(otherKey);
+	if (it == sectors.end() || otherIt == sectors.end()) {
+		return;
+	}
+
+	const Sector& sector = *it->second;
+	const Sector& other = *otherIt->second;
+
+	// one crossing per pair of areas, the one closest to the middle of the border
+	struct Crossing
+	{
+		int32_t x, y, otherX, otherY;
+		int32_t score;
+	};
+	gtl::flat_hash_map<uint16_t, Crossing> crossings;
+
+	const auto addCrossing = [&](int32_t x, int32_t y, int32_t nx, int32_t ny, int32_t offset) {
+		if (nx < 0 || nx >= NAVIGATION_SECTOR_SIZE || ny < 0 || ny >= NAVIGATION_SECTOR_SIZE) {
+			return;
+		}
+
+		const uint8_t label = sector.labels[getCellIndex(x, y)];
+		const uint8_t otherLabel = other.labels[getCellIndex(nx, ny)];
+		if (label == 0 || otherLabel == 0) {
+			return;
+		}
+
+		const int32_t score = std::abs(offset - NAVIGATION_SECTOR_SIZE / 2);
+		auto [crossing, inserted] = crossings.try_emplace((label << 8) | otherLabel, Crossing{x, y, nx, ny, score});
+		if (!inserted && score < crossing->second.score) {
+			crossing->second = {x, y, nx, ny, score};
+		}
+	};
+
+	constexpr int32_t last = NAVIGATION_SECTOR_SIZE - 1;
+	if (offsetY == 0) {
+		for (int32_t y = 0; y < NAVIGATION_SECTOR_SIZE; ++y) {
+			for (int32_t d = -1; d <= 1; ++d) {
+				addCrossing(last, y, 0, y + d, y);
+			}
+		}
+	} else if (offsetX == 0) {
+		for (int32_t x = 0; x < NAVIGATION_SECTOR_SIZE; ++x) {
+			for (int32_t d = -1; d <= 1; ++d) {
+				addCrossing(x, last, x + d, 0, x);
+			}
+		}
+	} else if (offsetX == 1) {
+		addCrossing(last, last, 0, 0, 0);
+	} else {
+		addCrossing(0, last, last, 0, 0);
+	}
+
+	for (const auto& [labels, crossing] : crossings) {
+		const uint64_t area = getAreaKey(sectorKey, labels >> 8);
+		const uint64_t otherArea = getAreaKey(otherKey, labels & 0xFF);
+		const uint16_t x = baseX + crossing.x;
+		const uint16_t y = baseY + crossing.y;
+		const uint16_t nx = otherX + crossing.otherX;
+		const uint16_t ny = otherY + crossing.otherY;
+		edges[area].push_back({otherArea, x, y, nx, ny});
+		edges[otherArea].push_back({area, nx, ny, x, y});
+	}
+}
+
+void NavigationGraph::unlinkSector(const uint32_t sectorKey)
+{
+	const auto it = sectors.find(sectorKey);
+	if (it == sectors.end()) {
+		return;
+	}
+
+	for (uint8_t label = 1; label <= it->second->areas && label != 0; ++label) {
+		const auto areaIt = edges.find(getAreaKey(sectorKey, label));
+		if (areaIt == edges.end()) {
+			continue;
+		}
+
+		for (const Edge& edge : areaIt->second) {
+			if (const auto otherIt = edges.find(edge.to); otherIt != edges.end()) {
+				std::erase_if(otherIt->second, [sectorKey](const Edge& back) { return (back.to >> 8) == sectorKey; });
+			}
+		}
+		edges.erase(areaIt);
+	}
+}
+
+void NavigationGraph::rebuildSector(Map& map, const uint32_t sectorKey)
+{
+	const uint16_t baseX = (sectorKey & 0x3FF) << NAVIGATION_SECTOR_BITS;
+	const uint16_t baseY = ((sectorKey >> 10) & 0x3FF) << NAVIGATION_SECTOR_BITS;
+	const uint8_t z = sectorKey >> 20;
+
+	unlinkSector(sectorKey);
+	labelSector(map, baseX, baseY, z);
+
+	for (const auto& [offsetX, offsetY] : linkOffsets) {
+		linkSectors(baseX, baseY, z, offsetX, offsetY);
+
+		const int32_t previousX = baseX - offsetX * NAVIGATION_SECTOR_SIZE;
+		const int32_t previousY = baseY - offsetY * NAVIGATION_SECTOR_SIZE;
+		if (previousX >= 0 && previousX <= 0xFFFF && previousY >= 0 && previousY <= 0xFFFF) {
+			linkSectors(previousX, previousY, z, offsetX, offsetY);
+		}
+	}
+}
+
+uint8_t NavigationGraph::getLabel(const uint16_t x, const uint16_t y, const uint8_t z) const
+{
+	const auto it = sectors.find(getSectorKey(x, y, z));
+	return it != sectors.end() ? it->second->labels[getCellIndex(x, y)] : 0;
+}
+
+uint8_t NavigationGraph::getNearbyLabel(const Position& pos) const
+{
+	if (const uint8_t label = getLabel(pos.x, pos.y, pos.z)) {
+		return label;
+	}
+
+	// targets often stand on something blocking, any walkable tile next to them in the same sector will do
+	const uint32_t sectorKey = getSectorKey(pos.x, pos.y, pos.z);
+	for (int32_t dy = -1; dy <= 1; ++dy) {
+		for (int32_t dx = -1; dx <= 1; ++dx) {
+			const int32_t x = pos.x + dx;
+			const int32_t y = pos.y + dy;
+			if (x < 0 || x > 0xFFFF || y < 0 || y > 0xFFFF || getSectorKey(x, y, pos.z) != sectorKey) {
+				continue;
+			}
+
+			if (const uint8_t label = getLabel(x, y, pos.z)) {
+				return label;
+			}
+		}
+	}
+	return 0;
+}
+
+bool NavigationGraph::findRoute(Map& map, const Position& from, const Position& to, std::vector<Position>& waypoints)
+{
+	if (!built || from.z != to.z) {
+		return false;
+	}
+
+	for (const uint32_t sectorKey : dirtySectors) {
+		rebuildSector(map, sectorKey);
+	}
+	dirtySectors.clear();
+
+	const uint8_t fromLabel = getNearbyLabel(from);
+	const uint8_t toLabel = getNearbyLabel(to);
+	if (fromLabel == 0 || toLabel == 0) {
+		return false;
+	}
+
+	const uint64_t startArea = getAreaKey(getSectorKey(from.x, from.y, from.z), fromLabel);
+	const uint64_t goalArea = getAreaKey(getSectorKey(to.x, to.y, to.z), toLabel);
+
+	struct Visit
+	{
+		uint64_t parent;
+		int32_t cost;
+		// where the area was entered
+		uint16_t x, y;
+		bool closed;
+	};
+
+	const auto getDistance = [](int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+		return std::max(std::abs(x0 - x1), std::abs(y0 - y1));
+	};
+
+	gtl::flat_hash_map<uint64_t, Visit> visits;
+	visits[startArea] = {startArea, 0, from.x, from.y, false};
+
+	using QueueEntry = std::pair<int32_t, uint64_t>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> open;
+	open.emplace(getDistance(from.x, from.y, to.x, to.y), startArea);
+
+	size_t expanded = 0;
+	while (!open.empty() && expanded < MAX_ROUTE_AREAS) {
+		const uint64_t area = open.top().second;
+		open.pop();
+
+		Visit& visit = visits[area];
+		if (visit.closed) {
+			continue;
+		}
+		visit.closed = true;
+		++expanded;
+
+		if (area == goalArea) {
+			waypoints.clear();
+			for (uint64_t current = goalArea; current != startArea;) {
+				const Visit& step = visits[current];
+				waypoints.emplace_back(step.x, step.y, from.z);
+				current = step.parent;
+			}
+			std::ranges::reverse(waypoints);
+			return true;
+		}
+
+		const int32_t cost = visit.cost;
+		const uint16_t entryX = visit.x;
+		const uint16_t entryY = visit.y;
+
+		const auto edgesIt = edges.find(area);
+		if (edgesIt == edges.end()) {
+			continue;
+		}
+
+		for (const Edge& edge : edgesIt->second) {
+			const int32_t newCost = cost + getDistance(entryX, entryY, edge.fromX, edge.fromY) + 1;
+			auto [next, inserted] = visits.try_emplace(edge.to, Visit{area, newCost, edge.toX, edge.toY, false});
+			if (!inserted) {
+				if (next->second.closed || next->second.cost <= newCost) {
+					continue;
+				}
+				next->second = {area, newCost, edge.toX, edge.toY, false};
+			}
+			open.emplace(newCost + getDistance(edge.toX, edge.toY, to.x, to.y), edge.to);
+		}
+	}
+	return false;
+}
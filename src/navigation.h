@@ -0,0 +1,97 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_NAVIGATION_H
+#define FS_NAVIGATION_H
+
+#include "position.h"
+#include "tilestates.h"
+
+#include <array>
+#include <gtl/phmap.hpp>
+
+class Map;
+
+// sectors line up with the tile state regions so their rows can be read as they are
+static constexpr int32_t NAVIGATION_SECTOR_BITS = TILESTATE_REGION_BITS;
+static constexpr int32_t NAVIGATION_SECTOR_SIZE = TILESTATE_REGION_SIZE;
+static constexpr int32_t NAVIGATION_SECTOR_MASK = TILESTATE_REGION_MASK;
+
+// paths shorter than this are left to the plain search
+static constexpr int32_t NAVIGATION_MIN_DISTANCE = 32;
+// the route is followed until this close to the target, the plain search picks the last tile
+static constexpr int32_t NAVIGATION_FINAL_RANGE = 8;
+
+// Abstract graph over the static walkability of the map for long paths. Every
+// 64x64 sector is split into its connected walkable areas, and areas of
+// neighbouring sectors touching across the border are linked through one
+// crossing tile. A route is a search over those areas; the creature then walks
+// from crossing to crossing with local searches.
+class NavigationGraph
+{
+	public:
+		void build(Map& map);
+
+		bool isBuilt() const {
+			return built;
+		}
+
+		// the walkability of pos changed, its sector is rebuilt before the next route
+		void invalidate(const Position& pos);
+
+		// crossing tiles from the area of from to the area of to, in walking order
+		bool findRoute(Map& map, const Position& from, const Position& to, std::vector<Position>& waypoints);
+
+		size_t getSectorCount() const {
+			return sectors.size();
+		}
+
+		size_t getAreaCount() const {
+			return edges.size();
+		}
+
+	private:
+		using Rows = std::array<uint64_t, NAVIGATION_SECTOR_SIZE>;
+
+		struct Sector
+		{
+			// 0 is not walkable, areas count up from 1
+			std::array<uint8_t, NAVIGATION_SECTOR_SIZE * NAVIGATION_SECTOR_SIZE> labels{};
+			uint8_t areas = 0;
+		};
+
+		struct Edge
+		{
+			uint64_t to;
+			// last tile in this area and first tile in the next one
+			uint16_t fromX, fromY;
+			uint16_t toX, toY;
+		};
+
+		static uint32_t getSectorKey(uint16_t x, uint16_t y, uint8_t z) {
+			return (static_cast<uint32_t>(z) << 20) | (static_cast<uint32_t>(y >> NAVIGATION_SECTOR_BITS) << 10) | (x >> NAVIGATION_SECTOR_BITS);
+		}
+
+		static uint64_t getAreaKey(uint32_t sectorKey, uint8_t label) {
+			return (static_cast<uint64_t>(sectorKey) << 8) | label;
+		}
+
+		static size_t getCellIndex(uint16_t x, uint16_t y) {
+			return ((y & NAVIGATION_SECTOR_MASK) << NAVIGATION_SECTOR_BITS) | (x & NAVIGATION_SECTOR_MASK);
+		}
+
+		static void getWalkableRows(Map& map, uint16_t baseX, uint16_t baseY, uint8_t z, Rows& rows);
+		void labelSector(Map& map, uint16_t baseX, uint16_t baseY, uint8_t z);
+		void linkSectors(uint16_t baseX, uint16_t baseY, uint8_t z, int32_t offsetX, int32_t offsetY);
+		void unlinkSector(uint32_t sectorKey);
+		void rebuildSector(Map& map, uint32_t sectorKey);
+		uint8_t getLabel(uint16_t x, uint16_t y, uint8_t z) const;
+		uint8_t getNearbyLabel(const Position& pos) const;
+
+		gtl::flat_hash_map<uint32_t, std::unique_ptr<Sector>> sectors;
+		gtl::flat_hash_map<uint64_t, std::vector<Edge>> edges;
+		gtl::flat_hash_set<uint32_t> dirtySectors;
+		bool built = false;
+};
+
+#endif
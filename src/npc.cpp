@@ -10,7 +10,6 @@
 extern Game g_game;
 extern LuaEnvironment g_luaEnvironment;
 
-uint32_t Npc::npcAutoID = 0x80000000;
 
 gtl::flat_hash_map<std::string, SkillRegistry> npc_skills;
 
@@ -47,12 +46,12 @@ SkillRegistry Npcs::getRegisteredSkills(std::string npc_name)
 
 void Npcs::reload()
 {
-	const std::map<uint32_t, NpcPtr>& npcs = g_game.getNpcs();
-	for (const auto& val : npcs | std::views::values) {
+	const auto& npcs = g_game.getNpcs();
+	for (const auto& val : npcs) {
 		val->closeAllShopWindows();
 	}
 
-	for (const auto& val : npcs | std::views::values) {
+	for (const auto& val : npcs) {
 		val->reload();
 	}
 }
@@ -82,6 +81,13 @@ Npc::~Npc()
 	reset();
 }
 
+void Npc::setID()
+{
+	if (id == 0) {
+		id = g_game.reserveNpcId(getNpc());
+	}
+}
+
 void Npc::addList()
 {
 	g_game.addNpc(this->getNpc());
@@ -114,6 +120,7 @@ void Npc::reset()
 	attackable = false;
 	ignoreHeight = false;
 	focusCreature = 0;
+	hearRadius = -1;
 	speechBubble = SPEECHBUBBLE_NONE;
 
 	npcEventHandler.reset();
@@ -163,7 +170,7 @@ bool Npc::loadFromXml()
 		return false;
 	}
 
-	name = npcNode.attribute("name").as_string();
+	name = InternedString(npcNode.attribute("name").as_string());
 	attackable = npcNode.attribute("attackable").as_bool();
 	floorChange = npcNode.attribute("floorchange").as_bool();
 
@@ -266,7 +273,7 @@ bool Npc::loadFromXml()
 			}
 
 			auto npc_skill = Components::Skills::CustomSkill::make_skill(formula, max, multiplier, threshold, difficulty);
-			Npcs::addNpcSkill(name, skill_name, npc_skill);
+			Npcs::addNpcSkill(name.str(), skill_name, npc_skill);
 		}
 	}
 
@@ -314,8 +321,8 @@ bool Npc::canSee(const Position& pos) const
 std::string Npc::getDescription(int32_t) const
 {
 	std::string descr;
-	descr.reserve(name.length() + 1);
-	descr.assign(name);
+	descr.reserve(name.str().length() + 1);
+	descr.assign(name.str());
 	descr.push_back('.');
 	return descr;
 }
@@ -404,9 +411,19 @@ void Npc::onCreatureSay(const CreaturePtr& creature, SpeakClasses type, const st
 
 	//only players for script events
 	if (const auto& player = creature->getPlayer()) {
-		if (npcEventHandler) {
-			npcEventHandler->onCreatureSay(player, type, text);
+		if (!npcEventHandler) {
+			return;
 		}
+
+		if (hearRadius >= 0) {
+			const Position& playerPos = player->getPosition();
+			const Position& npcPos = getPosition();
+			if (playerPos.z != npcPos.z || std::max<int32_t>(Position::getDistanceX(npcPos, playerPos), Position::getDistanceY(npcPos, playerPos)) > hearRadius) {
+				++Npcs::getStats().saysFiltered;
+				return;
+			}
+		}
+		npcEventHandler->onCreatureSay(player, type, text);
 	}
 }
 
@@ -684,6 +701,7 @@ void NpcScriptInterface::registerFunctions() const
 	// metatable
 	registerMethod("Npc", "getParameter", NpcScriptInterface::luaNpcGetParameter);
 	registerMethod("Npc", "setFocus", NpcScriptInterface::luaNpcSetFocus);
+	registerMethod("Npc", "setHearRadius", NpcScriptInterface::luaNpcSetHearRadius);
 
 	registerMethod("Npc", "openShopWindow", NpcScriptInterface::luaNpcOpenShopWindow);
 	registerMethod("Npc", "closeShopWindow", NpcScriptInterface::luaNpcCloseShopWindow);
@@ -869,7 +887,7 @@ int NpcScriptInterface::luaOpenShopWindow(lua_State* L)
 		return 1;
 	}
 
-	std::list<ShopInfo> items;
+	ShopInfoList items;
 	lua_pushnil(L);
 	while (lua_next(L, -2) != 0) {
 		const auto tableIndex = lua_gettop(L);
@@ -1051,6 +1069,18 @@ int NpcScriptInterface::luaNpcSetFocus(lua_State* L)
 	return 1;
 }
 
+int NpcScriptInterface::luaNpcSetHearRadius(lua_State* L)
+{
+	// npc:setHearRadius(radius)
+	if (const auto& npc = getSharedPtr<Npc>(L, 1)) {
+		npc->setHearRadius(getNumber<int32_t>(L, 2));
+		pushBoolean(L, true);
+	} else {
+		lua_pushnil(L);
+	}
+	return 1;
+}
+
 int NpcScriptInterface::luaNpcOpenShopWindow(lua_State* L)
 {
 	// npc:openShopWindow(cid, items, buyCallback, sellCallback)
@@ -1084,7 +1114,7 @@ int NpcScriptInterface::luaNpcOpenShopWindow(lua_State* L)
 		buyCallback = luaL_ref(L, LUA_REGISTRYINDEX);
 	}
 
-	std::list<ShopInfo> items;
+	ShopInfoList items;
 
 	lua_pushnil(L);
 	while (lua_next(L, 3) != 0) {
@@ -1202,8 +1232,7 @@ void NpcEventsHandler::onCreatureAppear(const CreaturePtr& creature)
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(creatureAppearEvent);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	scriptInterface->callFunction(1);
 }
 
@@ -1225,8 +1254,7 @@ void NpcEventsHandler::onCreatureDisappear(const CreaturePtr& creature)
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(creatureDisappearEvent);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	scriptInterface->callFunction(1);
 }
 
@@ -1248,8 +1276,7 @@ void NpcEventsHandler::onCreatureMove(const CreaturePtr& creature, const Positio
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(creatureMoveEvent);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	LuaScriptInterface::pushPosition(L, oldPos);
 	LuaScriptInterface::pushPosition(L, newPos);
 	scriptInterface->callFunction(3);
@@ -1271,13 +1298,17 @@ void NpcEventsHandler::onCreatureSay(const CreaturePtr& creature, SpeakClasses t
 	env->setScriptId(creatureSayEvent, scriptInterface.get());
 	env->setNpc(npc);
 
+	const auto start = std::chrono::steady_clock::now();
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(creatureSayEvent);
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 	lua_pushinteger(L, type);
 	LuaScriptInterface::pushString(L, text);
 	scriptInterface->callFunction(3);
+
+	NpcStats& stats = Npcs::getStats();
+	++stats.says;
+	stats.sayTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
 }
 
 void NpcEventsHandler::onPlayerTrade(const PlayerPtr& player, int32_t callback, uint16_t itemId,
@@ -1299,8 +1330,7 @@ void NpcEventsHandler::onPlayerTrade(const PlayerPtr& player, int32_t callback,
 
 	lua_State* L = scriptInterface->getLuaState();
 	LuaScriptInterface::pushCallback(L, callback);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	lua_pushinteger(L, itemId);
 	lua_pushinteger(L, count);
 	lua_pushinteger(L, amount);
@@ -1327,8 +1357,7 @@ void NpcEventsHandler::onPlayerCloseChannel(const PlayerPtr& player)
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(playerCloseChannelEvent);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	scriptInterface->callFunction(1);
 }
 
@@ -1350,8 +1379,7 @@ void NpcEventsHandler::onPlayerEndTrade(const PlayerPtr& player)
 
 	lua_State* L = scriptInterface->getLuaState();
 	scriptInterface->pushFunction(playerEndTradeEvent);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	scriptInterface->callFunction(1);
 }
 
@@ -1371,6 +1399,11 @@ void NpcEventsHandler::onThink()
 	env->setScriptId(thinkEvent, scriptInterface.get());
 	env->setNpc(npc);
 
+	const auto start = std::chrono::steady_clock::now();
 	scriptInterface->pushFunction(thinkEvent);
 	scriptInterface->callFunction(0);
+
+	NpcStats& stats = Npcs::getStats();
+	++stats.thinks;
+	stats.thinkTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
 }
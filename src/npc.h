@@ -6,6 +6,8 @@
 
 #include "creature.h"
 #include "luascript.h"
+#include "internedstring.h"
+#include "instancecounter.h"
 
 #include <set>
 
@@ -14,9 +16,25 @@ class Player;
 
 extern 	gtl::flat_hash_map<std::string, SkillRegistry> npc_skills;
 
+// what the npc scripts cost, microseconds
+struct NpcStats
+{
+	uint64_t thinks = 0;
+	int64_t thinkTime = 0;
+	uint64_t says = 0;
+	int64_t sayTime = 0;
+	// said beyond the hear radius and never handed to the script
+	uint64_t saysFiltered = 0;
+};
+
 class Npcs
 {
 	public:
+		static NpcStats& getStats() {
+			static NpcStats stats;
+			return stats;
+		}
+
 		static bool addNpcSkill(std::string npc_name, std::string_view skill_name, const std::shared_ptr<CustomSkill>& skill);
 		static std::optional<std::shared_ptr<CustomSkill>> getNpcSkill(std::string_view skill_name, std::string npc_name);
 		static SkillRegistry getRegisteredSkills(std::string npc_name);
@@ -49,6 +67,7 @@ class NpcScriptInterface final : public LuaScriptInterface
 		// metatable
 		static int luaNpcGetParameter(lua_State* L);
 		static int luaNpcSetFocus(lua_State* L);
+		static int luaNpcSetHearRadius(lua_State* L);
 
 		static int luaNpcOpenShopWindow(lua_State* L);
 		static int luaNpcCloseShopWindow(lua_State* L);
@@ -91,7 +110,7 @@ class NpcEventsHandler
 		bool loaded = false;
 };
 
-class Npc final : public Creature
+class Npc final : public Creature, public InstanceCounter<Npc>
 {
 	public:
 		explicit Npc(const std::string& name);
@@ -117,11 +136,7 @@ class Npc final : public Creature
 			return phaseable;
 		}
 
-		void setID() override {
-			if (id == 0) {
-				id = ++npcAutoID;
-			}
-		}
+		void setID() override;
 
 		void removeList() override;
 		void addList() override;
@@ -144,11 +159,16 @@ class Npc final : public Creature
 		}
 
 		const std::string& getName() const override {
-			return name;
+			return name.str();
 		}
 	
 		const std::string& getNameDescription() const override {
-			return name;
+			return name.str();
+		}
+
+		// the same for every npc whose name is equal ignoring case
+		uint32_t getNameId() const {
+			return name.id();
 		}
 
 		CreatureType_t getType() const override {
@@ -196,9 +216,13 @@ class Npc final : public Creature
 		void turnToCreature(const CreaturePtr& creature);
 		void setCreatureFocus(const CreaturePtr& creature);
 
-		auto& getScriptInterface() const { return npcEventHandler->scriptInterface; }
+		// players saying something farther than this, or on another floor,
+		// are not handed to the script, -1 hands every one of them
+		void setHearRadius(int32_t radius) {
+			hearRadius = radius;
+		}
 
-		static uint32_t npcAutoID;
+		auto& getScriptInterface() const { return npcEventHandler->scriptInterface; }
 
 	private:
 		
@@ -209,6 +233,9 @@ class Npc final : public Creature
 		                            const TilePtr& oldTile, const Position& oldPos, bool teleport) override;
 
 		void onCreatureSay(const CreaturePtr& creature, SpeakClasses type, const std::string& text) override;
+		bool listensToSpeech() const override {
+			return npcEventHandler != nullptr;
+		}
 		void onThink(uint32_t interval) override;
 		std::string getDescription(int32_t lookDistance) const override;
 
@@ -243,7 +270,7 @@ class Npc final : public Creature
 		std::set<PlayerPtr> shopPlayerSet;
 		std::set<PlayerPtr> spectators;
 
-		std::string name;
+		InternedString name;
 		std::string filename;
 
 		std::unique_ptr<NpcEventsHandler> npcEventHandler;
@@ -253,6 +280,7 @@ class Npc final : public Creature
 		uint32_t walkTicks;
 		int32_t focusCreature;
 		int32_t masterRadius;
+		int32_t hearRadius = -1;
 
 		uint8_t speechBubble;
 
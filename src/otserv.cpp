@@ -18,19 +18,37 @@
 #include "databasemanager.h"
 #include "scheduler.h"
 #include "databasetasks.h"
+#include "outputmessage.h"
+#include "pathfinding.h"
+#include "thinkpool.h"
+#include "cryptopool.h"
 #include "script.h"
 #include <fstream>
 #include <fmt/color.h>
 #include "augments.h"
 #include "zones.h"
+#include "startuploader.h"
+#include "luaprofiler.h"
+#include "luaworkers.h"
+#include "logwriter.h"
+#include "simulation.h"
+#include "protocolcheck.h"
+#include "tickprofiler.h"
+#include "allocprofiler.h"
+#include "webhooks.h"
+#include "worldbus.h"
+#include "playerjournal.h"
+#include "threadrole.h"
 
 #if __has_include("gitmetadata.h")
 	#include "gitmetadata.h"
 #endif
 
 DatabaseTasks g_databaseTasks;
+Pathfinder g_pathfinder;
+ThinkPool g_thinkPool;
+CryptoPool g_cryptoPool;
 Dispatcher g_dispatcher;
-Dispatcher g_dispatcher_discord;
 Scheduler g_scheduler;
 
 Game g_game;
@@ -38,6 +56,7 @@ ConfigManager g_config;
 Monsters g_monsters;
 Vocations g_vocations;
 extern Scripts* g_scripts;
+extern LuaEnvironment g_luaEnvironment;
 RSA g_RSA;
 
 std::mutex g_loaderLock;
@@ -61,6 +80,8 @@ bool argumentsHandler(const StringVector& args);
 	exit(-1);
 }
 
+// the benchmarks bring their own main and share the rest of the engine
+#ifndef BLACKTEK_BENCH
 int main(int argc, char* argv[])
 {
 	StringVector args = StringVector(argv, argv + argc);
@@ -73,9 +94,16 @@ int main(int argc, char* argv[])
 
 	ServiceManager serviceManager;
 
+	// whatever the batch wrote to clients leaves right after it
+	g_dispatcher.setBatchCompleteHook([](std::chrono::steady_clock::time_point batchStart) {
+		OutputMessagePool::getInstance().sendAll();
+		g_tickProfiler.endBatch(batchStart);
+	});
+	g_dispatcher.setIdleHook([]() { return g_luaEnvironment.collectIdleStep(); });
 	g_dispatcher.start();
 	g_scheduler.start();
-	g_dispatcher_discord.start();
+	g_webhooks.start();
+	g_logWriter.start();
 
 	g_dispatcher.addTask(createTask([=, services = &serviceManager]() { mainLoader(argc, argv, services); }));
 
@@ -84,21 +112,32 @@ int main(int argc, char* argv[])
 	if (serviceManager.is_running()) {
 		std::cout << ">> " << g_config.getString(ConfigManager::SERVER_NAME) << " Server Online!" << std::endl << std::endl;
 		serviceManager.run();
+	} else if (g_simulation.isStarted() || g_protocolCheck.isStarted()) {
+		// the simulation and the protocol check shut the game down once they are over
 	} else {
 		std::cout << ">> No services running. The server is NOT online." << std::endl;
 		g_scheduler.shutdown();
 		g_databaseTasks.shutdown();
+		g_pathfinder.shutdown();
+		g_thinkPool.shutdown();
+		g_cryptoPool.shutdown();
 		g_dispatcher.shutdown();
-		g_dispatcher_discord.shutdown();
+		g_webhooks.shutdown();
+		g_logWriter.shutdown();
 	}
 
 	g_scheduler.join();
 	g_databaseTasks.join();
 	g_dispatcher.join();
-	g_dispatcher_discord.join();
+	g_webhooks.join();
+	g_logWriter.join();
+	// after everything that records or waits on it
+	g_playerJournal.shutdown();
+	g_playerJournal.join();
 
-	return 0;
+	return g_protocolCheck.hasFailed() ? EXIT_FAILURE : 0;
 }
+#endif
 
 #include <fmt/color.h>
 #include <fmt/core.h>
@@ -177,6 +216,12 @@ void mainLoader(int, char*[], ServiceManager* services)
 		return;
 	}
 
+	// these started before the config was read
+	placeThread(g_dispatcher.getNativeHandle(), "dispatcher");
+	placeThread(g_scheduler.getNativeHandle(), "scheduler");
+	placeThread(g_webhooks.getNativeHandle(), "webhooks");
+	placeThread(g_logWriter.getNativeHandle(), "log writer");
+
 #ifdef _WIN32
 	const std::string& defaultPriority = g_config.getString(ConfigManager::DEFAULT_PRIORITY);
 	if (caseInsensitiveEqual(defaultPriority, "high")) {
@@ -211,61 +256,27 @@ void mainLoader(int, char*[], ServiceManager* services)
 		startupErrorMessage("The database you have specified in config.lua is empty, please import the schema.sql to your database.");
 		return;
 	}
-	g_databaseTasks.start();
+	g_databaseTasks.start(std::max<int32_t>(1, g_config.getNumber(ConfigManager::DATABASE_WORKERS)));
+	// kept until the next start, the players online keep their values where they are
+	StorageMap::setHotRange(std::max<int32_t>(0, g_config.getNumber(ConfigManager::STORAGE_HOT_RANGE_START)), std::max<int32_t>(0, g_config.getNumber(ConfigManager::STORAGE_HOT_RANGE_SIZE)));
+	g_pathfinder.start(std::max<int32_t>(0, g_config.getNumber(ConfigManager::PATHFINDING_THREADS)));
+	g_thinkPool.start(std::max<int32_t>(0, g_config.getNumber(ConfigManager::MONSTER_THINK_THREADS)));
+	g_cryptoPool.start(std::max<int32_t>(0, g_config.getNumber(ConfigManager::CRYPTO_THREADS)));
 
 	DatabaseManager::updateDatabase();
 
-	if (g_config.getBoolean(ConfigManager::OPTIMIZE_DATABASE) && !DatabaseManager::optimizeTables()) {
-		std::cout << "> No tables were optimized." << std::endl;
-	}
-
-	//load vocations
-	std::cout << ">> Loading vocations" << std::endl;
-	if (!g_vocations.loadFromToml()) {
-		startupErrorMessage("Unable to load vocations!");
-		return;
-	}
-
-	// load item data
-	std::cout << ">> Loading items" << std::endl;
-	if (!Item::items.loadFromOtb("data/items/items.otb")) {
-		startupErrorMessage("Unable to load items (OTB)!");
-		return;
-	}
-
-	if (!Item::items.loadFromToml()) {
-		startupErrorMessage("Unable to load items (TOML)!");
-		return;
-	}
-
-	std::cout << ">> Loading script systems" << std::endl;
-	if (!ScriptingManager::getInstance().loadScriptSystems()) {
-		startupErrorMessage("Failed to load script systems");
-		return;
-	}
-
-	std::cout << ">> Loading lua scripts" << std::endl;
-	if (!g_scripts->loadScripts("scripts", false, false)) {
-		startupErrorMessage("Failed to load lua scripts");
-		return;
-	}
-
-	std::cout << ">> Loading monsters" << std::endl;
-	if (!g_monsters.loadFromXml()) {
-		startupErrorMessage("Unable to load monsters!");
-		return;
-	}
-
-	std::cout << ">> Loading lua monsters" << std::endl;
-	if (!g_scripts->loadScripts("monster", false, false)) {
-		startupErrorMessage("Failed to load lua monsters");
-		return;
+	const std::string& journalFile = g_config.getString(ConfigManager::JOURNAL_FILE);
+	if (!journalFile.empty()) {
+		std::cout << ">> Replaying the player journal" << std::endl;
+		if (!g_playerJournal.replay(journalFile)) {
+			startupErrorMessage("Failed to write back the player journal " + journalFile + ".");
+			return;
+		}
+		g_playerJournal.start();
 	}
 
-	std::cout << ">> Loading outfits" << std::endl;
-	if (!Outfits::getInstance().load()) {
-		startupErrorMessage("Unable to load outfits!");
-		return;
+	if (g_config.getBoolean(ConfigManager::OPTIMIZE_DATABASE) && !DatabaseManager::optimizeTables()) {
+		std::cout << "> No tables were optimized." << std::endl;
 	}
 
 	std::cout << ">> Checking world type... " << std::flush;
@@ -283,18 +294,59 @@ void mainLoader(int, char*[], ServiceManager* services)
 	}
 	std::cout << asUpperCaseString(worldType) << std::endl;
 
-	std::cout << ">> Loading map" << std::endl;
-	if (!g_game.loadMainMap(g_config.getString(ConfigManager::MAP_NAME))) {
-		startupErrorMessage("Failed to load map");
+	// lua lives on this thread, so every stage running scripts stays on it. scripts change item types
+	// (charges, decay, names) the map tiles are built from, the tiles load next to the monsters instead
+	StartupLoader loader;
+	const auto vocations = loader.add("vocations", "Unable to load vocations!", []() {
+		return g_vocations.loadFromToml();
+	}, {}, true);
+	const auto items = loader.add("items", "Unable to load items!", []() {
+		if (!Item::items.loadFromOtb("data/items/items.otb")) {
+			std::cout << "[Error - mainLoader] Unable to load items (OTB)!" << std::endl;
+			return false;
+		}
+		if (!Item::items.loadFromToml()) {
+			std::cout << "[Error - mainLoader] Unable to load items (TOML)!" << std::endl;
+			return false;
+		}
+		return true;
+	}, {}, true);
+	const auto outfits = loader.add("outfits", "Unable to load outfits!", []() {
+		return Outfits::getInstance().load();
+	}, {}, true);
+	const auto scriptSystems = loader.add("script systems", "Failed to load script systems", []() {
+		return ScriptingManager::getInstance().loadScriptSystems();
+	}, {vocations, items, outfits});
+	const auto luaScripts = loader.add("lua scripts", "Failed to load lua scripts", []() {
+		return g_scripts->loadScripts("scripts", false, false);
+	}, {scriptSystems});
+	const auto monsters = loader.add("monsters", "Unable to load monsters!", []() {
+		return g_monsters.loadFromXml();
+	}, {luaScripts});
+	const auto luaMonsters = loader.add("lua monsters", "Failed to load lua monsters", []() {
+		return g_scripts->loadScripts("monster", false, false);
+	}, {monsters});
+	const auto mapTiles = loader.add("map", "Failed to load map", []() {
+		return g_game.loadMainMapTiles(g_config.getString(ConfigManager::MAP_NAME));
+	}, {luaScripts}, true);
+	loader.add("spawns and houses", "Failed to load map", []() {
+		g_game.loadMainMapWorld();
+		return true;
+	}, {mapTiles, luaMonsters});
+	loader.add("zones", "Failed to load zones", []() {
+		Zones::load();
+		return true;
+	}, {luaMonsters}, true);
+	loader.add("augments", "Failed to load augments", []() {
+		Augments::loadAll();
+		return true;
+	}, {luaMonsters}, true);
+
+	if (!loader.run()) {
+		startupErrorMessage(loader.getErrorMessage());
 		return;
 	}
 
-	std::cout << ">> Loading Zones \n";
-	Zones::load();
-
-	std::cout << ">> Loading augments" << std::endl;
-	Augments::loadAll();
-
 	if (g_config.getBoolean(ConfigManager::ENABLE_ACCOUNT_MANAGER)) {
 		std::cout << ">> Loading Account Manager.. \n";
 		AccountManager::initialize();
@@ -306,15 +358,24 @@ void mainLoader(int, char*[], ServiceManager* services)
 	std::cout << ">> Initializing gamestate" << std::endl;
 	g_game.setGameState(GAME_STATE_INIT);
 
-	// Game client protocols
-	services->add<ProtocolGame>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::GAME_PORT)));
-	services->add<ProtocolLogin>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::LOGIN_PORT)));
+	// a simulation or a protocol check opens no ports, nobody can log in
+	const bool headless = g_simulation.isEnabled() || g_protocolCheck.isEnabled();
+	if (!headless) {
+		// Game client protocols
+		services->add<ProtocolGame>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::GAME_PORT)));
+		services->add<ProtocolLogin>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::LOGIN_PORT)));
+
+		// OT protocols
+		services->add<ProtocolStatus>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::STATUS_PORT)));
 
-	// OT protocols
-	services->add<ProtocolStatus>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::STATUS_PORT)));
+		// Legacy login protocol
+		services->add<ProtocolOld>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::LOGIN_PORT)));
 
-	// Legacy login protocol
-	services->add<ProtocolOld>(static_cast<uint16_t>(g_config.getNumber(ConfigManager::LOGIN_PORT)));
+		// Prometheus scrapes
+		if (services->addMetrics(static_cast<uint16_t>(g_config.getNumber(ConfigManager::METRICS_PORT)))) {
+			MetricsServer::updateSnapshot();
+		}
+	}
 
 	RentPeriod_t rentPeriod;
 	std::string strRentPeriod = asLowerCaseString(g_config.getString(ConfigManager::HOUSE_RENT_PERIOD));
@@ -331,11 +392,22 @@ void mainLoader(int, char*[], ServiceManager* services)
 		rentPeriod = RENTPERIOD_NEVER;
 	}
 
-	g_game.map.houses.payHouses(rentPeriod);
+	// nor does it charge rents or expire offers of real characters
+	if (!headless) {
+		g_game.map.houses.payHouses(rentPeriod);
+	}
 
-	IOMarket::checkExpiredOffers();
+	IOMarket::getInstance().loadOffers();
+	if (!headless) {
+		IOMarket::checkExpiredOffers();
+	}
 	IOMarket::getInstance().updateStatistics();
 
+	// nor is it one of the worlds
+	if (!headless) {
+		g_worldBus.load();
+	}
+
 	std::cout << ">> Loaded all modules, server starting up..." << std::endl;
 
 #ifndef _WIN32
@@ -344,13 +416,43 @@ void mainLoader(int, char*[], ServiceManager* services)
 	}
 #endif
 
+	if (const int32_t workerThreads = g_config.getNumber(ConfigManager::LUA_WORKER_THREADS); workerThreads > 0) {
+		if (!g_luaWorkers.start(workerThreads)) {
+			startupErrorMessage("Failed to load the worker scripts of data/workers.");
+			return;
+		}
+	}
+
+	if (g_config.getBoolean(ConfigManager::LUA_PROFILER)) {
+		g_luaProfiler.start(g_luaEnvironment.getLuaState());
+	}
+
 	g_game.start(services);
 	g_game.setGameState(GAME_STATE_NORMAL);
+
+	// loading is one long task, measuring starts with the first world tick
+	g_tickProfiler.attachThread();
+	g_tickProfiler.setWarningThreshold(std::max<int32_t>(0, g_config.getNumber(ConfigManager::TICK_BUDGET_WARNING)));
+	g_tickProfiler.setEnabled(g_config.getBoolean(ConfigManager::TICK_PROFILER));
+	g_allocationProfiler.start();
+	g_worldBus.start();
+
+	if (g_simulation.isEnabled() && !g_simulation.start()) {
+		startupErrorMessage("Failed to start the simulation.");
+		return;
+	}
+
+	if (g_protocolCheck.isEnabled() && !g_protocolCheck.start()) {
+		startupErrorMessage("Failed to start the protocol check.");
+		return;
+	}
 	g_loaderSignal.notify_all();
 }
 
 bool argumentsHandler(const StringVector& args)
 {
+	uint32_t simulatedPlayers = 0;
+	uint32_t simulatedSeconds = 60;
 	for (const auto& arg : args) {
 		if (arg == "--help") {
 			std::clog << "Usage:\n"
@@ -359,7 +461,12 @@ bool argumentsHandler(const StringVector& args)
 			"\t--ip=$1\t\t\tIP address of the server.\n"
 			"\t\t\t\tShould be equal to the global IP.\n"
 			"\t--login-port=$1\tPort for login server to listen on.\n"
-			"\t--game-port=$1\tPort for game server to listen on.\n";
+			"\t--game-port=$1\tPort for game server to listen on.\n"
+			"\t--simulate=$1\t\tRun $1 simulated players without opening any port\n"
+			"\t\t\t\tand report where the server spent its time.\n"
+			"\t--simulate-time=$1\tSeconds the simulation runs, 60 by default.\n"
+			"\t--protocol-check=$1\tCompare the protocol output of $1 scenarios with\n"
+			"\t\t\t\tand without the encoding fast paths, then exit.\n";
 			return false;
 		} else if (arg == "--version") {
 			printServerVersion();
@@ -376,7 +483,14 @@ bool argumentsHandler(const StringVector& args)
 			g_config.setNumber(ConfigManager::LOGIN_PORT, std::stoi(tmp[1].data()));
 		else if (tmp[0] == "--game-port")
 			g_config.setNumber(ConfigManager::GAME_PORT, std::stoi(tmp[1].data()));
+		else if (tmp[0] == "--simulate")
+			simulatedPlayers = std::stoi(tmp[1].data());
+		else if (tmp[0] == "--simulate-time")
+			simulatedSeconds = std::stoi(tmp[1].data());
+		else if (tmp[0] == "--protocol-check")
+			g_protocolCheck.configure(std::stoi(tmp[1].data()));
 	}
 
+	g_simulation.configure(simulatedPlayers, simulatedSeconds);
 	return true;
 }
@@ -67,27 +67,44 @@ bool Outfits::load()
 	{
 		std::cerr << "Failed to load outfits.toml - " << e.what() << std::endl;
 	}
+	indexLookTypes();
 	return true;
 }
 
+void Outfits::indexLookTypes()
+{
+	for (uint8_t sex = PLAYERSEX_FEMALE; sex <= PLAYERSEX_LAST; sex++) {
+		std::vector<uint16_t>& index = lookTypeIndex[sex];
+		index.clear();
+		for (size_t i = 0; i < outfits[sex].size(); ++i) {
+			const uint16_t lookType = outfits[sex][i].lookType;
+			if (lookType >= index.size()) {
+				index.resize(lookType + 1, 0);
+			}
+
+			// the first one wins, as with the scan it replaces
+			if (index[lookType] == 0) {
+				index[lookType] = static_cast<uint16_t>(i + 1);
+			}
+		}
+	}
+}
+
 
 const Outfit* Outfits::getOutfitByLookType(PlayerSex_t sex, uint16_t lookType) const
 {
-	for (const Outfit& outfit : outfits[sex]) {
-		if (outfit.lookType == lookType) {
-			return &outfit;
-		}
+	const std::vector<uint16_t>& index = lookTypeIndex[sex];
+	if (lookType >= index.size() || index[lookType] == 0) {
+		return nullptr;
 	}
-	return nullptr;
+	return &outfits[sex][index[lookType] - 1];
 }
 
 const Outfit* Outfits::getOutfitByLookType(uint16_t lookType) const
 {
 	for (uint8_t sex = PLAYERSEX_FEMALE; sex <= PLAYERSEX_LAST; sex++) {
-		for (const Outfit& outfit : outfits[sex]) {
-			if (outfit.lookType == lookType) {
-				return &outfit;
-			}
+		if (const Outfit* outfit = getOutfitByLookType(static_cast<PlayerSex_t>(sex), lookType)) {
+			return outfit;
 		}
 	}
 	return nullptr;
@@ -46,7 +46,11 @@ class Outfits
 		}
 
 	private:
+		void indexLookTypes();
+
 		std::vector<Outfit> outfits[PLAYERSEX_LAST + 1];
+		// by look type, the position in outfits plus one, 0 for none
+		std::vector<uint16_t> lookTypeIndex[PLAYERSEX_LAST + 1];
 };
 
 #endif
@@ -6,56 +6,61 @@
 #include "outputmessage.h"
 #include "protocol.h"
 #include "lockfree.h"
-#include "scheduler.h"
-
-extern Scheduler g_scheduler;
+#include "tickprofiler.h"
 
 namespace {
 
 const uint16_t OUTPUTMESSAGE_FREE_LIST_CAPACITY = 2048;
-const std::chrono::milliseconds OUTPUTMESSAGE_AUTOSEND_DELAY {10};
 
-void sendAll(const std::vector<Protocol_ptr>& bufferedProtocols);
+}
 
-void scheduleSendAll(const std::vector<Protocol_ptr>& bufferedProtocols)
+void OutputMessagePool::addProtocolToAutosend(const Protocol_ptr& protocol)
 {
-	g_scheduler.addEvent(createSchedulerTask(OUTPUTMESSAGE_AUTOSEND_DELAY.count(), [&]() { sendAll(bufferedProtocols); }));
+	//dispatcher thread
+	protocol->autosend = true;
+	if (protocol->outputBuffer) {
+		addPendingProtocol(protocol);
+	}
 }
 
-void sendAll(const std::vector<Protocol_ptr>& bufferedProtocols)
+void OutputMessagePool::removeProtocolFromAutosend(const Protocol_ptr& protocol)
 {
 	//dispatcher thread
-	for (auto& protocol : bufferedProtocols) {
-		auto& msg = protocol->getCurrentBuffer();
-		if (msg) {
-			protocol->send(std::move(msg));
-		}
+	protocol->autosend = false;
+	if (!protocol->autosendPending) {
+		return;
 	}
 
-	if (!bufferedProtocols.empty()) {
-		scheduleSendAll(bufferedProtocols);
+	protocol->autosendPending = false;
+	auto it = std::find(pendingProtocols.begin(), pendingProtocols.end(), protocol);
+	if (it != pendingProtocols.end()) {
+		std::swap(*it, pendingProtocols.back());
+		pendingProtocols.pop_back();
 	}
 }
 
-}
-
-void OutputMessagePool::addProtocolToAutosend(Protocol_ptr protocol)
+void OutputMessagePool::addPendingProtocol(const Protocol_ptr& protocol)
 {
 	//dispatcher thread
-	if (bufferedProtocols.empty()) {
-		scheduleSendAll(bufferedProtocols);
+	if (!protocol->autosendPending) {
+		protocol->autosendPending = true;
+		pendingProtocols.push_back(protocol);
 	}
-	bufferedProtocols.emplace_back(protocol);
 }
 
-void OutputMessagePool::removeProtocolFromAutosend(const Protocol_ptr& protocol)
+void OutputMessagePool::sendAll()
 {
+	TickPhaseTimer timer(TICK_PHASE_NETWORK);
 	//dispatcher thread
-	auto it = std::find(bufferedProtocols.begin(), bufferedProtocols.end(), protocol);
-	if (it != bufferedProtocols.end()) {
-		std::swap(*it, bufferedProtocols.back());
-		bufferedProtocols.pop_back();
+	// sending may start new buffers, those wait for the next batch
+	sendingProtocols.swap(pendingProtocols);
+	for (auto& protocol : sendingProtocols) {
+		protocol->autosendPending = false;
+		if (auto& msg = protocol->outputBuffer) {
+			protocol->send(std::move(msg));
+		}
 	}
+	sendingProtocols.clear();
 }
 
 OutputMessage_ptr OutputMessagePool::getOutputMessage()
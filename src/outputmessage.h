@@ -7,10 +7,11 @@
 #include "networkmessage.h"
 #include "connection.h"
 #include "tools.h"
+#include "instancecounter.h"
 
 class Protocol;
 
-class OutputMessage : public NetworkMessage
+class OutputMessage : public NetworkMessage, public InstanceCounter<OutputMessage>
 {
 	public:
 		OutputMessage() = default;
@@ -23,6 +24,21 @@ class OutputMessage : public NetworkMessage
 			return buffer + outputBufferStart;
 		}
 
+		// the payload was rewritten in place and is now length bytes long
+		void setPayloadLength(MsgSize_t length) {
+			info.length = length;
+			info.position = outputBufferStart + length;
+		}
+
+		// once this message is out, the following ones go through a DeflateStream
+		void setStartsCompression() {
+			startsCompression = true;
+		}
+
+		bool getStartsCompression() const {
+			return startsCompression;
+		}
+
 		void writeMessageLength() {
 			add_header(info.length);
 		}
@@ -60,6 +76,7 @@ class OutputMessage : public NetworkMessage
 		}
 
 		MsgSize_t outputBufferStart = INITIAL_BUFFER_POSITION;
+		bool startsCompression = false;
 };
 
 class OutputMessagePool
@@ -76,13 +93,17 @@ class OutputMessagePool
 
 		static OutputMessage_ptr getOutputMessage();
 
-		void addProtocolToAutosend(Protocol_ptr protocol);
+		void addProtocolToAutosend(const Protocol_ptr& protocol);
 		void removeProtocolFromAutosend(const Protocol_ptr& protocol);
+		// protocol started a new output buffer
+		void addPendingProtocol(const Protocol_ptr& protocol);
+		// sends the buffers of the pending protocols, at the end of every dispatcher batch
+		void sendAll();
 	private:
 		OutputMessagePool() = default;
-		//NOTE: A vector is used here because this container is mostly read
-		//and relatively rarely modified (only when a client connects/disconnects)
-		std::vector<Protocol_ptr> bufferedProtocols;
+		// only the autosend protocols holding output, the others are never visited
+		std::vector<Protocol_ptr> pendingProtocols;
+		std::vector<Protocol_ptr> sendingProtocols;
 };
 
 #endif
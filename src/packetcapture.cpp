@@ -0,0 +1,41 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "packetcapture.h"
+#include "configmanager.h"
+
+extern ConfigManager g_config;
+
+void PacketCapture::add(uint32_t guid, const uint8_t* payload, uint16_t length)
+{
+	const std::string& path = g_config.getString(ConfigManager::PACKET_CAPTURE_FILE);
+	if (path.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lockGuard(lock);
+	if (!opened) {
+		opened = true;
+		file.open(path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			std::cout << "[Warning - PacketCapture::add] Can not open " << path << " for writing." << std::endl;
+			return;
+		}
+
+		file.write("BTPC", 4);
+		file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+		start = std::chrono::steady_clock::now();
+	}
+
+	if (!file) {
+		return;
+	}
+
+	const int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+	file.write(reinterpret_cast<const char*>(&guid), sizeof(guid));
+	file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+	file.write(reinterpret_cast<const char*>(payload), length);
+}
@@ -0,0 +1,32 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_PACKETCAPTURE_H
+#define FS_PACKETCAPTURE_H
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+
+// Records the decrypted game packets of every player to packetCaptureFile so
+// a session can be studied or played back. The file starts with "BTPC" and a
+// uint16_t version, then holds one record per packet, all little endian:
+//   int64_t  microseconds since the capture started
+//   uint32_t guid of the player
+//   uint16_t payload length, followed by the payload from the first opcode on
+class PacketCapture
+{
+	public:
+		static constexpr uint16_t VERSION = 1;
+
+		// network threads, turns itself on the first time packetCaptureFile is set
+		void add(uint32_t guid, const uint8_t* payload, uint16_t length);
+
+	private:
+		std::ofstream file;
+		std::chrono::steady_clock::time_point start;
+		std::mutex lock;
+		bool opened = false;
+};
+
+#endif
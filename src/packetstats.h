@@ -0,0 +1,76 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_PACKETSTATS_H
+#define FS_PACKETSTATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <vector>
+
+struct OpcodeSummary
+{
+	uint8_t opcode;
+	uint64_t count;
+	uint64_t bytes;
+	// nanoseconds spent parsing, received opcodes only
+	uint64_t time;
+};
+
+// Counts game packets by their first opcode in both directions. Packets are
+// received on the network threads and sent from the dispatcher, so every
+// counter is atomic.
+class PacketStats
+{
+	public:
+		void addReceived(uint8_t opcode, size_t bytes, uint64_t time) {
+			Counter& counter = received[opcode];
+			counter.count.fetch_add(1, std::memory_order_relaxed);
+			counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			counter.time.fetch_add(time, std::memory_order_relaxed);
+		}
+
+		void addSent(uint8_t opcode, size_t bytes) {
+			Counter& counter = sent[opcode];
+			counter.count.fetch_add(1, std::memory_order_relaxed);
+			counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+		}
+
+		// the limit opcodes that carried the most bytes, largest first
+		std::vector<OpcodeSummary> getTopReceived(size_t limit) const {
+			return getTop(received, limit);
+		}
+
+		std::vector<OpcodeSummary> getTopSent(size_t limit) const {
+			return getTop(sent, limit);
+		}
+
+	private:
+		struct Counter
+		{
+			std::atomic<uint64_t> count{0};
+			std::atomic<uint64_t> bytes{0};
+			std::atomic<uint64_t> time{0};
+		};
+
+		static std::vector<OpcodeSummary> getTop(const std::array<Counter, 256>& counters, size_t limit) {
+			std::vector<OpcodeSummary> top;
+			for (size_t opcode = 0; opcode < counters.size(); ++opcode) {
+				const Counter& counter = counters[opcode];
+				if (const uint64_t count = counter.count.load(std::memory_order_relaxed); count != 0) {
+					top.push_back({static_cast<uint8_t>(opcode), count, counter.bytes.load(std::memory_order_relaxed), counter.time.load(std::memory_order_relaxed)});
+				}
+			}
+
+			limit = std::min(limit, top.size());
+			std::partial_sort(top.begin(), top.begin() + limit, top.end(), [](const OpcodeSummary& a, const OpcodeSummary& b) { return a.bytes > b.bytes; });
+			top.resize(limit);
+			return top;
+		}
+
+		std::array<Counter, 256> received;
+		std::array<Counter, 256> sent;
+};
+
+#endif
@@ -17,6 +17,8 @@ extern Events* g_events;
 Party::Party(const PlayerPtr& leader) : leader(leader)
 {
 	leader->setParty(this);
+	addMemberState(leader);
+	updateLevels();
 }
 
 void Party::disband()
@@ -94,6 +96,8 @@ bool Party::leaveParty(const PlayerPtr& player, bool forceRemove /* = false */)
 	if (const auto& it = std::ranges::find(memberList, player); it != memberList.end()) {
 		memberList.erase(it);
 	}
+	removeMemberState(player);
+	updateLevels();
 
 	player->setParty(nullptr);
 	player->sendClosePrivate(CHANNEL_PARTY);
@@ -114,8 +118,6 @@ bool Party::leaveParty(const PlayerPtr& player, bool forceRemove /* = false */)
 
 	updateSharedExperience();
 
-	clearPlayerPoints(player);
-
 	broadcastPartyMessage(MESSAGE_INFO_DESCR, fmt::format("{:s} has left the party.", player->getName()));
 
 	if (missingLeader || empty()) {
@@ -146,6 +148,8 @@ bool Party::passPartyLeadership(const PlayerPtr& player, bool forceRemove /* = f
 
 	memberList.insert(memberList.begin(), oldLeader);
 
+	// distances are taken from the leader
+	updateRanges();
 	updateSharedExperience();
 
 	for (const auto& member : memberList) {
@@ -194,6 +198,8 @@ bool Party::joinParty(const PlayerPtr& player)
 	player->sendPlayerPartyIcons(leader);
 
 	memberList.push_back(player);
+	addMemberState(player);
+	updateLevels();
 
 	g_game.updatePlayerHelpers(player);
 
@@ -310,7 +316,18 @@ void Party::broadcastPartyMessage(MessageClasses msgClass, const std::string& ms
 void Party::updateSharedExperience()
 {
 	if (sharedExpActive) {
-		bool result = getSharedExperienceStatus() == SHAREDEXP_OK;
+		bool result = !memberList.empty() && levelsInSpread && membersOutOfRange == 0;
+
+		const int64_t inactiveTime = g_config.getNumber(ConfigManager::PZ_LOCKED);
+		activityExpiry = std::numeric_limits<int64_t>::max();
+		for (const MemberState& state : memberStates) {
+			if (!isActive(state)) {
+				result = false;
+			} else if (!state.player->hasFlag(PlayerFlag_NotGainInFight)) {
+				activityExpiry = std::min(activityExpiry, state.ticks + inactiveTime);
+			}
+		}
+
 		if (result != sharedExpEnabled) {
 			sharedExpEnabled = result;
 			updateAllPartyIcons();
@@ -318,6 +335,104 @@ void Party::updateSharedExperience()
 	}
 }
 
+void Party::updateMemberPosition(const PlayerConstPtr& player)
+{
+	if (player == leader) {
+		updateRanges();
+		updateSharedExperience();
+		return;
+	}
+
+	MemberState* state = getMemberState(player.get());
+	if (!state) {
+		return;
+	}
+
+	const bool inRange = isInRange(state->player);
+	if (inRange != state->inRange) {
+		state->inRange = inRange;
+		membersOutOfRange += inRange ? -1 : 1;
+		updateSharedExperience();
+	}
+}
+
+void Party::updateMemberLevel()
+{
+	updateLevels();
+	updateSharedExperience();
+}
+
+Party::MemberState* Party::getMemberState(const Player* player)
+{
+	return const_cast<MemberState*>(static_cast<const Party*>(this)->getMemberState(player));
+}
+
+const Party::MemberState* Party::getMemberState(const Player* player) const
+{
+	const auto it = std::ranges::find(memberStates, player, &MemberState::player);
+	return it != memberStates.end() ? &*it : nullptr;
+}
+
+void Party::addMemberState(const PlayerConstPtr& player)
+{
+	MemberState& state = memberStates.emplace_back(player.get());
+	state.inRange = isInRange(state.player);
+	if (!state.inRange) {
+		++membersOutOfRange;
+	}
+}
+
+void Party::removeMemberState(const PlayerConstPtr& player)
+{
+	const auto it = std::ranges::find(memberStates, player.get(), &MemberState::player);
+	if (it == memberStates.end()) {
+		return;
+	}
+
+	if (!it->inRange) {
+		--membersOutOfRange;
+	}
+	*it = memberStates.back();
+	memberStates.pop_back();
+}
+
+bool Party::isInRange(const Player* player) const
+{
+	return Position::areInRange<EXPERIENCE_SHARE_RANGE, EXPERIENCE_SHARE_RANGE, EXPERIENCE_SHARE_FLOORS>(leader->getPosition(), player->getPosition());
+}
+
+bool Party::isActive(const MemberState& state) const
+{
+	if (state.player->hasFlag(PlayerFlag_NotGainInFight)) {
+		return true;
+	}
+
+	//check if the player has healed/attacked anything recently
+	return state.ticks != 0 && static_cast<uint64_t>(OTSYS_TIME() - state.ticks) <= static_cast<uint64_t>(g_config.getNumber(ConfigManager::PZ_LOCKED));
+}
+
+void Party::updateRanges()
+{
+	membersOutOfRange = 0;
+	for (MemberState& state : memberStates) {
+		state.inRange = isInRange(state.player);
+		if (!state.inRange) {
+			++membersOutOfRange;
+		}
+	}
+}
+
+void Party::updateLevels()
+{
+	highestLevel = 0;
+	for (const MemberState& state : memberStates) {
+		highestLevel = std::max(highestLevel, state.player->getLevel());
+	}
+
+	const uint32_t minLevel = static_cast<uint32_t>(std::ceil((static_cast<float>(highestLevel) * 2) / 3));
+	levelsInSpread = std::ranges::all_of(memberStates, [minLevel](const MemberState& state) { return state.player->getLevel() >= minLevel; });
+}
+
 namespace {
 
 const char* getSharedExpReturnMessage(SharedExpStatus_t value)
@@ -386,33 +501,18 @@ SharedExpStatus_t Party::getMemberSharedExperienceStatus(const PlayerConstPtr& p
 		return SHAREDEXP_EMPTYPARTY;
 	}
 
-	uint32_t highestLevel = leader->getLevel();
-	for (const auto& member : memberList) {
-		if (member->getLevel() > highestLevel) {
-			highestLevel = member->getLevel();
-		}
-	}
-
 	uint32_t minLevel = static_cast<uint32_t>(std::ceil((static_cast<float>(highestLevel) * 2) / 3));
 	if (player->getLevel() < minLevel) {
 		return SHAREDEXP_LEVELDIFFTOOLARGE;
 	}
 
-	if (!Position::areInRange<EXPERIENCE_SHARE_RANGE, EXPERIENCE_SHARE_RANGE, EXPERIENCE_SHARE_FLOORS>(leader->getPosition(), player->getPosition())) {
+	if (!isInRange(player.get())) {
 		return SHAREDEXP_TOOFARAWAY;
 	}
 
-	if (!player->hasFlag(PlayerFlag_NotGainInFight)) {
-		//check if the player has healed/attacked anything recently
-		const auto it = ticksMap.find(player->getID());
-		if (it == ticksMap.end()) {
-			return SHAREDEXP_MEMBERINACTIVE;
-		}
-
-		uint64_t timeDiff = OTSYS_TIME() - it->second;
-		if (timeDiff > static_cast<uint64_t>(g_config.getNumber(ConfigManager::PZ_LOCKED))) {
-			return SHAREDEXP_MEMBERINACTIVE;
-		}
+	const MemberState* state = getMemberState(player.get());
+	if (!state || !isActive(*state)) {
+		return SHAREDEXP_MEMBERINACTIVE;
 	}
 	return SHAREDEXP_OK;
 }
@@ -435,16 +535,28 @@ SharedExpStatus_t Party::getSharedExperienceStatus() const
 
 void Party::updatePlayerTicks(const PlayerPtr& player, const uint32_t points)
 {
-	if (points != 0 && !player->hasFlag(PlayerFlag_NotGainInFight)) {
-		ticksMap[player->getID()] = OTSYS_TIME();
+	if (points == 0 || player->hasFlag(PlayerFlag_NotGainInFight)) {
+		return;
+	}
+
+	MemberState* state = getMemberState(player.get());
+	if (!state) {
+		return;
+	}
+
+	// the status only changes when this member wakes up or another one fell
+	// inactive since the last check
+	const bool wasActive = isActive(*state);
+	state->ticks = OTSYS_TIME();
+	if (!wasActive || state->ticks > activityExpiry) {
 		updateSharedExperience();
 	}
 }
 
 void Party::clearPlayerPoints(const PlayerPtr& player)
 {
-	if (const auto it = ticksMap.find(player->getID()); it != ticksMap.end()) {
-		ticksMap.erase(it);
+	if (MemberState* state = getMemberState(player.get()); state && state->ticks != 0) {
+		state->ticks = 0;
 		updateSharedExperience();
 	}
 }
@@ -82,13 +82,41 @@ class Party
 		SharedExpStatus_t getMemberSharedExperienceStatus(const PlayerConstPtr& player) const;
 		void updateSharedExperience();
 
+		// a member moved, or its level changed
+		void updateMemberPosition(const PlayerConstPtr& player);
+		void updateMemberLevel();
+
 		void updatePlayerTicks(const PlayerPtr& player, uint32_t points);
 		void clearPlayerPoints(const PlayerPtr& player);
 
 	private:
+		// what shared experience needs of the leader and of every member, kept
+		// up to date as they move, level and fight so the checks do not rescan
+		struct MemberState {
+			const Player* player;
+			// when the member last attacked or healed, 0 for never
+			int64_t ticks = 0;
+			bool inRange = true;
+		};
+
 		SharedExpStatus_t getSharedExperienceStatus() const;
 
-		std::map<uint32_t, int64_t> ticksMap;
+		MemberState* getMemberState(const Player* player);
+		const MemberState* getMemberState(const Player* player) const;
+		void addMemberState(const PlayerConstPtr& player);
+		void removeMemberState(const PlayerConstPtr& player);
+		bool isInRange(const Player* player) const;
+		bool isActive(const MemberState& state) const;
+		void updateRanges();
+		void updateLevels();
+
+		std::vector<MemberState> memberStates;
+		// when the first member needing activity turns inactive, as of the last check
+		int64_t activityExpiry = 0;
+		uint32_t highestLevel = 0;
+		uint32_t membersOutOfRange = 0;
+		// every member is within the level spread of the highest
+		bool levelsInSpread = true;
 
 		PlayerVector memberList;
 		PlayerVector inviteList;
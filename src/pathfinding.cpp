@@ -0,0 +1,181 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "pathfinding.h"
+#include "game.h"
+#include "threadrole.h"
+#include "tracing.h"
+
+extern Game g_game;
+extern Dispatcher g_dispatcher;
+
+void PathSnapshot::capture(CreaturePtr& creature, const Position& targetPos, const FindPathParams& fpp)
+{
+	startPos = creature->getPosition();
+	condition = FrozenPathingConditionCall(targetPos);
+	range = fpp.maxSearchDist;
+
+	const int32_t side = range * 2 + 1;
+	cells.assign(side * side, Cell());
+
+	Position pos(0, 0, startPos.z);
+	for (int32_t dy = -range; dy <= range; ++dy) {
+		const int32_t y = startPos.y + dy;
+		if (y < 0 || y > 0xFFFF) {
+			continue;
+		}
+
+		for (int32_t dx = -range; dx <= range; ++dx) {
+			const int32_t x = startPos.x + dx;
+			if (x < 0 || x > 0xFFFF) {
+				continue;
+			}
+
+			pos.x = x;
+			pos.y = y;
+
+			// the search skips these before it looks at the tile
+			if (fpp.keepDistance && !condition.isInRange(startPos, pos, fpp)) {
+				continue;
+			}
+
+			const TilePtr tile = g_game.map.canWalkTo(creature, pos);
+			if (!tile) {
+				continue;
+			}
+
+			Cell& cell = cells[(dy + range) * side + (dx + range)];
+			cell.flags = PATHCELL_WALKABLE;
+			cell.cost = AStarNodes::getTileWalkCost(creature, tile);
+
+			// sight only matters where the path may end
+			if (fpp.clearSight && condition.isInRange(startPos, pos, fpp) && g_game.isSightClear(pos, targetPos, true)) {
+				cell.flags |= PATHCELL_SIGHTCLEAR;
+			}
+		}
+	}
+}
+
+const PathSnapshot::Cell* PathSnapshot::getCell(const Position& pos) const
+{
+	const int32_t dx = pos.x - startPos.x;
+	const int32_t dy = pos.y - startPos.y;
+	if (pos.z != startPos.z || std::abs(dx) > range || std::abs(dy) > range) {
+		return nullptr;
+	}
+	return &cells[(dy + range) * (range * 2 + 1) + (dx + range)];
+}
+
+bool PathSnapshot::getStepCost(const Position& pos, bool, int_fast32_t& extraCost) const
+{
+	// known nodes were walkable when they were found, the start included
+	const Cell* cell = getCell(pos);
+	if (!cell || !(cell->flags & PATHCELL_WALKABLE)) {
+		return false;
+	}
+
+	extraCost = cell->cost;
+	return true;
+}
+
+bool PathSnapshot::isMatching(const Position& startPos, const Position& testPos, const FindPathParams& fpp, int32_t& bestMatchDist) const
+{
+	if (!condition.isInRange(startPos, testPos, fpp)) {
+		return false;
+	}
+
+	if (fpp.clearSight) {
+		const Cell* cell = getCell(testPos);
+		if (!cell || !(cell->flags & PATHCELL_SIGHTCLEAR)) {
+			return false;
+		}
+	}
+
+	return condition.isMatchingDistance(testPos, fpp, bestMatchDist);
+}
+
+void Pathfinder::start(size_t threadCount)
+{
+	stopping = false;
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&Pathfinder::threadMain, this);
+	}
+}
+
+void Pathfinder::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(requestLock);
+		stopping = true;
+		queue.clear();
+		pending.clear();
+	}
+	requestSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+void Pathfinder::addRequest(PathRequest&& request)
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(requestLock);
+		if (stopping) {
+			return;
+		}
+
+		auto [it, inserted] = pending.try_emplace(request.creatureId);
+		it->second = std::move(request);
+		if (!inserted) {
+			// still waiting in the queue, it keeps its place with the newer request
+			return;
+		}
+		queue.push_back(it->first);
+	}
+	requestSignal.notify_one();
+}
+
+void Pathfinder::threadMain()
+{
+	setThreadRole("pathfinding");
+	std::unique_lock<std::mutex> lockGuard(requestLock);
+	while (true) {
+		requestSignal.wait(lockGuard, [this]() { return stopping || !queue.empty(); });
+		if (stopping) {
+			return;
+		}
+
+		const uint32_t creatureId = queue.front();
+		queue.pop_front();
+
+		auto it = pending.find(creatureId);
+		PathRequest request = std::move(it->second);
+		pending.erase(it);
+		lockGuard.unlock();
+
+		PathResult result;
+		result.startPos = request.snapshot.getStartPos();
+		result.creatureId = request.creatureId;
+		result.targetId = request.targetId;
+		result.requestId = request.requestId;
+		result.notifyComplete = request.notifyComplete;
+		{
+			TraceScope trace("path search", "pathfinding");
+			result.found = findPathMatching(request.snapshot, result.startPos, result.dirList, request.fpp);
+		}
+
+		g_dispatcher.addTask(createTask([result = std::move(result)]() mutable {
+			if (const auto& creature = g_game.getCreatureByID(result.creatureId)) {
+				creature->onFollowPathFound(result);
+			}
+		}, DISPATCHER_LANE_CREATURE));
+
+		lockGuard.lock();
+	}
+}
@@ -0,0 +1,296 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_PATHFINDING_H
+#define FS_PATHFINDING_H
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include "creature.h"
+
+// widest maxSearchDist handed to the workers, wider searches stay on the dispatcher
+static constexpr int32_t PATH_SNAPSHOT_MAX_RANGE = 16;
+// how far past the end of a follow path the repair search may look
+static constexpr int32_t FOLLOW_PATH_REPAIR_RANGE = 3;
+
+// A* over whatever the source says about the tiles. Map::getPathMatching asks
+// the live map, the pathfinding workers ask a PathSnapshot.
+template <typename PathSource>
+bool findPathMatching(PathSource& source, const Position& startPos, std::vector<Direction>& dirList, const FindPathParams& fpp)
+{
+	Position pos = startPos;
+	Position endPos;
+
+	AStarNodes nodes(pos.x, pos.y);
+
+	int32_t bestMatch = 0;
+
+	static int_fast32_t dirNeighbors[8][5][2] = {
+		{{-1, 0}, {0, 1}, {1, 0}, {1, 1}, {-1, 1}},
+		{{-1, 0}, {0, 1}, {0, -1}, {-1, -1}, {-1, 1}},
+		{{-1, 0}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}},
+		{{0, 1}, {1, 0}, {0, -1}, {1, -1}, {1, 1}},
+		{{1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}},
+		{{-1, 0}, {0, -1}, {-1, -1}, {1, -1}, {-1, 1}},
+		{{0, 1}, {1, 0}, {1, -1}, {1, 1}, {-1, 1}},
+		{{-1, 0}, {0, 1}, {-1, -1}, {1, 1}, {-1, 1}}
+	};
+	static int_fast32_t allNeighbors[8][2] = {
+		{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+	};
+
+	AStarNode* found = nullptr;
+	while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100) {
+		const auto& n = nodes.getBestNode();
+		if (!n) {
+			if (found) {
+				break;
+			}
+			return false;
+		}
+
+		const int_fast32_t x = n->x;
+		const int_fast32_t y = n->y;
+		pos.x = x;
+		pos.y = y;
+		if (source.isMatching(startPos, pos, fpp, bestMatch)) {
+			found = n;
+			endPos = pos;
+			if (bestMatch == 0) {
+				break;
+			}
+		}
+
+		uint_fast32_t dirCount;
+		int_fast32_t* neighbors;
+		if (n->parent) {
+			const int_fast32_t offset_x = n->parent->x - x;
+			const int_fast32_t offset_y = n->parent->y - y;
+			if (offset_y == 0) {
+				if (offset_x == -1) {
+					neighbors = *dirNeighbors[DIRECTION_WEST];
+				} else {
+					neighbors = *dirNeighbors[DIRECTION_EAST];
+				}
+			} else if (!fpp.allowDiagonal || offset_x == 0) {
+				if (offset_y == -1) {
+					neighbors = *dirNeighbors[DIRECTION_NORTH];
+				} else {
+					neighbors = *dirNeighbors[DIRECTION_SOUTH];
+				}
+			} else if (offset_y == -1) {
+				if (offset_x == -1) {
+					neighbors = *dirNeighbors[DIRECTION_NORTHWEST];
+				} else {
+					neighbors = *dirNeighbors[DIRECTION_NORTHEAST];
+				}
+			} else if (offset_x == -1) {
+				neighbors = *dirNeighbors[DIRECTION_SOUTHWEST];
+			} else {
+				neighbors = *dirNeighbors[DIRECTION_SOUTHEAST];
+			}
+			dirCount = fpp.allowDiagonal ? 5 : 3;
+		} else {
+			dirCount = 8;
+			neighbors = *allNeighbors;
+		}
+
+		const int_fast32_t f = n->f;
+		for (uint_fast32_t i = 0; i < dirCount; ++i) {
+			pos.x = x + *neighbors++;
+			pos.y = y + *neighbors++;
+
+			if (fpp.maxSearchDist != 0 && (Position::getDistanceX(startPos, pos) > fpp.maxSearchDist || Position::getDistanceY(startPos, pos) > fpp.maxSearchDist)) {
+				continue;
+			}
+
+			if (fpp.keepDistance && !source.isInRange(startPos, pos, fpp)) {
+				continue;
+			}
+
+			auto neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
+			int_fast32_t extraCost;
+			if (!source.getStepCost(pos, neighborNode != nullptr, extraCost)) {
+				continue;
+			}
+
+			//The cost (g) for this neighbor
+			const int_fast32_t cost = AStarNodes::getMapWalkCost(n, pos);
+			const int_fast32_t newf = f + cost + extraCost;
+
+			if (neighborNode) {
+				if (neighborNode->f <= newf) {
+					//The node on the closed/open list is cheaper than this one
+					continue;
+				}
+
+				neighborNode->f = newf;
+				neighborNode->parent = n;
+				nodes.openNode(neighborNode);
+			} else {
+				//Does not exist in the open/closed list, create a new node
+				neighborNode = nodes.createOpenNode(n, pos.x, pos.y, newf);
+				if (!neighborNode) {
+					if (found) {
+						break;
+					}
+					return false;
+				}
+			}
+		}
+
+		nodes.closeNode(n);
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	int_fast32_t prevx = endPos.x;
+	int_fast32_t prevy = endPos.y;
+
+	found = found->parent;
+	while (found) {
+		pos.x = found->x;
+		pos.y = found->y;
+
+		const int_fast32_t dx = pos.getX() - prevx;
+		const int_fast32_t dy = pos.getY() - prevy;
+
+		prevx = pos.x;
+		prevy = pos.y;
+
+		if (dx == 1 && dy == 1) {
+			dirList.push_back(DIRECTION_NORTHWEST);
+		} else if (dx == -1 && dy == 1) {
+			dirList.push_back(DIRECTION_NORTHEAST);
+		} else if (dx == 1 && dy == -1) {
+			dirList.push_back(DIRECTION_SOUTHWEST);
+		} else if (dx == -1 && dy == -1) {
+			dirList.push_back(DIRECTION_SOUTHEAST);
+		} else if (dx == 1) {
+			dirList.push_back(DIRECTION_WEST);
+		} else if (dx == -1) {
+			dirList.push_back(DIRECTION_EAST);
+		} else if (dy == 1) {
+			dirList.push_back(DIRECTION_NORTH);
+		} else if (dy == -1) {
+			dirList.push_back(DIRECTION_SOUTH);
+		}
+
+		found = found->parent;
+	}
+	return true;
+}
+
+enum PathCellFlags_t : uint8_t {
+	PATHCELL_WALKABLE = 1 << 0,
+	PATHCELL_SIGHTCLEAR = 1 << 1,
+};
+
+// What a creature may walk on around it, captured on the dispatcher so a
+// search can run on another thread without touching tiles or creatures.
+class PathSnapshot
+{
+	public:
+		void capture(CreaturePtr& creature, const Position& targetPos, const FindPathParams& fpp);
+
+		const Position& getStartPos() const {
+			return startPos;
+		}
+
+		bool getStepCost(const Position& pos, bool known, int_fast32_t& extraCost) const;
+		bool isMatching(const Position& startPos, const Position& testPos, const FindPathParams& fpp, int32_t& bestMatchDist) const;
+		bool isInRange(const Position& startPos, const Position& testPos, const FindPathParams& fpp) const {
+			return condition.isInRange(startPos, testPos, fpp);
+		}
+
+	private:
+		struct Cell
+		{
+			uint8_t flags = 0;
+			uint16_t cost = 0;
+		};
+
+		const Cell* getCell(const Position& pos) const;
+
+		std::vector<Cell> cells;
+		Position startPos;
+		FrozenPathingConditionCall condition{Position()};
+		int32_t range = 0;
+};
+
+// how follow paths were refreshed, only touched on the dispatcher
+struct FollowPathStats {
+	// the remaining path still ends next to the target, possibly cut short
+	uint64_t kept = 0;
+	// a short search from the end of the path reached the target again
+	uint64_t repaired = 0;
+	// walked down the flow field shared by the chasers of the target
+	uint64_t flowField = 0;
+	// full searches from the creature
+	uint64_t searched = 0;
+};
+
+struct PathResult {
+	std::vector<Direction> dirList;
+	Position startPos;
+	uint32_t creatureId = 0;
+	uint32_t targetId = 0;
+	uint32_t requestId = 0;
+	bool found = false;
+	bool notifyComplete = false;
+};
+
+struct PathRequest {
+	PathSnapshot snapshot;
+	FindPathParams fpp;
+	uint32_t creatureId = 0;
+	uint32_t targetId = 0;
+	uint32_t requestId = 0;
+	bool notifyComplete = false;
+};
+
+// Worker threads running follow path searches. Results come back as
+// dispatcher tasks; a creature asking again before its search started only
+// replaces the request it already has queued.
+class Pathfinder
+{
+	public:
+		void start(size_t threadCount);
+		void shutdown();
+
+		bool isRunning() const {
+			return !threads.empty();
+		}
+
+		uint32_t getNextRequestId() {
+			if (++lastRequestId == 0) {
+				++lastRequestId;
+			}
+			return lastRequestId;
+		}
+
+		void addRequest(PathRequest&& request);
+
+		FollowPathStats& getFollowStats() {
+			return followStats;
+		}
+
+	private:
+		void threadMain();
+
+		std::vector<std::thread> threads;
+		std::deque<uint32_t> queue;
+		gtl::flat_hash_map<uint32_t, PathRequest> pending;
+		std::mutex requestLock;
+		std::condition_variable requestSignal;
+		FollowPathStats followStats;
+		uint32_t lastRequestId = 0;
+		bool stopping = false;
+};
+
+extern Pathfinder g_pathfinder;
+
+#endif
@@ -13,8 +13,10 @@
 #include "iologindata.h"
 #include "monster.h"
 #include "movement.h"
+#include "playerjournal.h"
 #include "scheduler.h"
 #include "weapons.h"
+#include "worldbus.h"
 #include "rewardchest.h"
 #include "player.h"
 #include "spells.h"
@@ -1119,7 +1121,9 @@ void Player::addSkillAdvance(skills_t skill, uint64_t count)
 		return;
 	}
 
-	g_events->eventPlayerOnGainSkillTries(this->getPlayer(), skill, count);
+	if (g_events->hasEvent(EventInfoId::PLAYER_ONGAINSKILLTRIES)) {
+		g_events->eventPlayerOnGainSkillTries(this->getPlayer(), skill, count);
+	}
 	if (count == 0) {
 		return;
 	}
@@ -1320,10 +1324,7 @@ void Player::addStorageValue(const uint32_t key, const int32_t value, const bool
 {
 	if (IS_IN_KEYRANGE(key, RESERVED_RANGE)) {
 		if (IS_IN_KEYRANGE(key, OUTFITS_RANGE)) {
-			outfits.emplace_back(
-				value >> 16,
-				value & 0xFF
-			);
+			outfits.emplace(value >> 16, value & 0xFF);
 			return;
 		} else if (IS_IN_KEYRANGE(key, MOUNTS_RANGE)) {
 			// do nothing
@@ -1333,34 +1334,55 @@ void Player::addStorageValue(const uint32_t key, const int32_t value, const bool
 		}
 	}
 
-	if (value != -1) {
+	// the reserved range is rebuilt and written by the player save
+	if (!isLogin && !IS_IN_KEYRANGE(key, RESERVED_RANGE)) {
+		g_game.getStorageJournal().record(STORAGE_TABLE_PLAYER, guid, key, value);
+	}
+
+	// only keys some quest looks at can update the quest log
+	const bool questKey = g_game.quests.isQuestStorageKey(key);
+	if (questKey) {
+		questLogValid = false;
+	}
+
+	if (value != -1 && !isLogin && questKey) {
 		int32_t oldValue;
 		getStorageValue(key, oldValue);
 
-		storageMap[key] = value;
+		storageMap.set(key, value);
 
-		if (!isLogin) {
-			auto currentFrameTime = g_dispatcher.getDispatcherCycle();
-			if (lastQuestlogUpdate != currentFrameTime && g_game.quests.isQuestStorage(key, value, oldValue)) {
-				lastQuestlogUpdate = currentFrameTime;
-				sendTextMessage(MESSAGE_EVENT_ADVANCE, "Your questlog has been updated.");
-			}
+		auto currentFrameTime = g_dispatcher.getDispatcherCycle();
+		if (lastQuestlogUpdate != currentFrameTime && g_game.quests.isQuestStorage(key, value, oldValue)) {
+			lastQuestlogUpdate = currentFrameTime;
+			sendTextMessage(MESSAGE_EVENT_ADVANCE, "Your questlog has been updated.");
 		}
-	} else {
-		storageMap.erase(key);
+		return;
 	}
+
+	storageMap.set(key, value);
 }
 
 bool Player::getStorageValue(const uint32_t key, int32_t& value) const
 {
-	const auto it = storageMap.find(key);
-	if (it == storageMap.end()) {
-		value = -1;
-		return false;
+	return storageMap.get(key, value);
+}
+
+const std::vector<QuestLogEntry>& Player::getQuestLog()
+{
+	if (questLogValid && questLogVersion == g_game.quests.getVersion()) {
+		return questLog;
 	}
 
-	value = it->second;
-	return true;
+	const PlayerPtr player = getPlayer();
+	questLog.clear();
+	for (const Quest& quest : g_game.quests.getQuests()) {
+		if (quest.isStarted(player)) {
+			questLog.push_back({&quest, quest.isCompleted(player)});
+		}
+	}
+	questLogVersion = g_game.quests.getVersion();
+	questLogValid = true;
+	return questLog;
 }
 
 bool Player::canSee(const Position& pos) const
@@ -1394,17 +1416,17 @@ bool Player::canSeeGhostMode(const CreatureConstPtr&) const
 
 bool Player::canWalkthrough(const CreatureConstPtr& creature) const
 {
-	if (group->access || creature->isInGhostMode() || (g_config.getBoolean(ConfigManager::ALLOW_WALKTHROUGH) && creature->getPlayer() && creature->getPlayer()->isAccessPlayer())) {
+	if (group->access || creature->isInGhostMode() || (g_config.getSnapshot().allowWalkthrough && creature->getPlayer() && creature->getPlayer()->isAccessPlayer())) {
 		return true;
 	}
 
 	const auto& player = creature->getPlayer();
-	if (!player || !g_config.getBoolean(ConfigManager::ALLOW_WALKTHROUGH)) {
+	if (!player || !g_config.getSnapshot().allowWalkthrough) {
 		return false;
 	}
 
 	const auto& playerTile = player->getTile();
-	if (!playerTile || (!playerTile->hasFlag(TILESTATE_PROTECTIONZONE) && player->getLevel() > static_cast<uint32_t>(g_config.getNumber(ConfigManager::PROTECTION_LEVEL)))) {
+	if (!playerTile || (!playerTile->hasFlag(TILESTATE_PROTECTIONZONE) && player->getLevel() > g_config.getSnapshot().protectionLevel)) {
 		return false;
 	}
 
@@ -1435,12 +1457,12 @@ bool Player::canWalkthroughEx(const CreatureConstPtr& creature) const
 	}
 
 	const auto& player = creature->getPlayer();
-	if (!player || !g_config.getBoolean(ConfigManager::ALLOW_WALKTHROUGH)) {
+	if (!player || !g_config.getSnapshot().allowWalkthrough) {
 		return false;
 	}
 
 	const auto& playerTile = player->getTile();
-	return playerTile && (playerTile->hasFlag(TILESTATE_PROTECTIONZONE) || player->getLevel() <= static_cast<uint32_t>(g_config.getNumber(ConfigManager::PROTECTION_LEVEL)));
+	return playerTile && (playerTile->hasFlag(TILESTATE_PROTECTIONZONE) || player->getLevel() <= g_config.getSnapshot().protectionLevel);
 }
 
 void Player::onReceiveMail() const
@@ -1545,12 +1567,45 @@ void Player::sendCancelMessage(ReturnValue message) const
 	sendCancelMessage(getReturnMessage(message));
 }
 
-void Player::sendStats()
+void Player::sendStats() const
+{
+	queueUpdate(statsPending);
+}
+
+void Player::sendSkills() const
+{
+	queueUpdate(skillsPending);
+}
+
+void Player::queueUpdate(bool& pending) const
+{
+	if (!client || pending) {
+		return;
+	}
+
+	if (!statsPending && !skillsPending && !saleListPending) {
+		g_game.addPlayerUpdate(std::const_pointer_cast<Player>(getPlayer()));
+	}
+	pending = true;
+}
+
+void Player::sendPendingUpdates()
 {
 	if (client) {
-		client->sendStats();
-		lastStatsTrainingTime = getOfflineTrainingTime() / 60 / 1000;
+		if (skillsPending) {
+			client->sendSkills();
+		}
+		if (statsPending) {
+			client->sendStats();
+			lastStatsTrainingTime = getOfflineTrainingTime() / 60 / 1000;
+		}
+		if (saleListPending && shopOwner) {
+			client->sendSaleItemList(shopItemList);
+		}
 	}
+	statsPending = false;
+	skillsPending = false;
+	saleListPending = false;
 }
 
 void Player::sendPing()
@@ -1921,21 +1976,11 @@ void Player::onRemoveCreature(const CreaturePtr& creature, bool isLogout)
 			IOLoginData::updateOnlineStatus(guid, false);
 		}
 
-		bool saved = false;
-		for (uint32_t tries = 0; tries < 3; ++tries) {
-			if (IOLoginData::savePlayer(this->getPlayer())) {
-				saved = true;
-				break;
-			}
-		}
-
-		if (!saved) {
-			std::cout << "Error while saving player: " << getName() << std::endl;
-		}
+		IOLoginData::savePlayerAsync(this->getPlayer());
 	}
 }
 
-void Player::openShopWindow(const NpcPtr& npc, const std::list<ShopInfo>& shop)
+void Player::openShopWindow(const NpcPtr& npc, const ShopInfoList& shop)
 {
 	shopItemList = shop;
 	sendShop(npc);
@@ -1967,6 +2012,7 @@ bool Player::closeShopWindow(bool sendCloseShopWindow /*= true*/)
 
 void Player::onWalk(Direction& dir)
 {
+	PlayerCostScope scope(cost.get());
 	Creature::onWalk(dir);
 	setNextActionTask(nullptr);
 	setNextAction(OTSYS_TIME() + getStepDuration(dir));
@@ -1979,7 +2025,7 @@ void Player::onCreatureMove(const CreaturePtr& creature, const TilePtr& newTile,
 
 	if (hasFollowPath && (creature == getFollowCreature() || (creature == this->getPlayer() && getFollowCreature()))) {
 		isUpdatingPath = false;
-		g_dispatcher.addTask(createTask([id = getID()]() { g_game.updateCreatureWalk(id); }));
+		g_dispatcher.addTask(createTask([id = getID()]() { g_game.updateCreatureWalk(id); }, DISPATCHER_LANE_CREATURE));
 	}
 
 	if (creature != this->getPlayer()) {
@@ -2015,7 +2061,7 @@ void Player::onCreatureMove(const CreaturePtr& creature, const TilePtr& newTile,
 	}
 
 	if (party) {
-		party->updateSharedExperience();
+		party->updateMemberPosition(this->getPlayer());
 	}
 
 	if (teleport || oldPos.z != newPos.z) {
@@ -2142,6 +2188,9 @@ void Player::setNextWalkActionTask(SchedulerTask* task)
 
 	delete walkTask;
 	walkTask = task;
+	if (walkTask) {
+		walkTask->setLane(DISPATCHER_LANE_PLAYER);
+	}
 }
 
 void Player::setNextActionTask(SchedulerTask* task, bool resetIdleTime /*= true */)
@@ -2152,6 +2201,7 @@ void Player::setNextActionTask(SchedulerTask* task, bool resetIdleTime /*= true
 	}
 
 	if (task) {
+		task->setLane(DISPATCHER_LANE_PLAYER);
 		actionTaskEvent = g_scheduler.addEvent(task);
 		if (resetIdleTime) {
 			this->resetIdleTime();
@@ -2166,6 +2216,7 @@ uint32_t Player::getNextActionTime() const
 
 void Player::onThink(const uint32_t interval)
 {
+	PlayerCostScope scope(cost.get());
 	Creature::onThink(interval);
 
 	sendPing();
@@ -2186,16 +2237,18 @@ void Player::onThink(const uint32_t interval)
 		}
 	}
 
-	// if (isImbued()) { // TODO: Reimplement a check like this to first see if player has any items, then items with imbuements before decaying.
-		for (int32_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_LAST; ++slot) {
-			const auto& item = inventory[slot];
-			if (item && item->hasImbuements()) {
-				item->decayImbuements(hasCondition(CONDITION_INFIGHT));
-				sendSkills();
-				sendStats();
-			}
+	// only the slots that held imbued items when last looked at
+	if (!imbuedSlotsValid) {
+		updateImbuedSlots();
+	}
+	for (uint16_t slots = imbuedSlots; slots != 0; slots &= slots - 1) {
+		const auto& item = inventory[std::countr_zero(slots)];
+		if (item && item->hasImbuements()) {
+			item->decayImbuements(hasCondition(CONDITION_INFIGHT));
+			sendSkills();
+			sendStats();
 		}
-	// } // part of the above TODO:
+	}
 
 	if (g_game.getWorldType() != WORLD_TYPE_PVP_ENFORCED) {
 		checkSkullTicks(interval / 1000);
@@ -2284,7 +2337,9 @@ void Player::addManaSpent(uint64_t amount)
 		return;
 	}
 
-	g_events->eventPlayerOnGainSkillTries(this->getPlayer(), SKILL_MAGLEVEL, amount);
+	if (g_events->hasEvent(EventInfoId::PLAYER_ONGAINSKILLTRIES)) {
+		g_events->eventPlayerOnGainSkillTries(this->getPlayer(), SKILL_MAGLEVEL, amount);
+	}
 	if (amount == 0) {
 		return;
 	}
@@ -2421,6 +2476,8 @@ void Player::addExperience(const CreaturePtr& source, uint64_t exp, bool sendTex
 		}
 	}
 
+	journalExperience(prevLevel != level);
+
 	if (prevLevel != level) {
 		health = getMaxHealth();
 		mana = getMaxMana();
@@ -2431,13 +2488,13 @@ void Player::addExperience(const CreaturePtr& source, uint64_t exp, bool sendTex
 		g_game.changeSpeed(this->getPlayer(), 0);
 		g_game.addCreatureHealth(this->getPlayer());
 
-		const uint32_t protectionLevel = static_cast<uint32_t>(g_config.getNumber(ConfigManager::PROTECTION_LEVEL));
+		const uint32_t protectionLevel = g_config.getSnapshot().protectionLevel;
 		if (prevLevel < protectionLevel && level >= protectionLevel) {
 			g_game.updateCreatureWalkthrough(this->getPlayer());
 		}
 
 		if (party) {
-			party->updateSharedExperience();
+			party->updateMemberLevel();
 		}
 
 		g_creatureEvents->playerAdvance(this->getPlayer(), SKILL_LEVEL, prevLevel, level);
@@ -2453,6 +2510,20 @@ void Player::addExperience(const CreaturePtr& source, uint64_t exp, bool sendTex
 	sendStats();
 }
 
+void Player::journalExperience(bool levelChanged)
+{
+	g_playerJournal.recordExperience(guid, level, experience);
+	if (levelChanged) {
+		g_playerJournal.recordLevelStats(guid, healthMax, manaMax, capacity);
+	}
+}
+
+void Player::setBankBalance(uint64_t balance)
+{
+	bankBalance = balance;
+	g_playerJournal.recordBankBalance(guid, balance);
+}
+
 void Player::removeExperience(uint64_t exp, const bool sendText/* = false*/)
 {
 	if (experience == 0 || exp == 0) {
@@ -2502,6 +2573,8 @@ void Player::removeExperience(uint64_t exp, const bool sendText/* = false*/)
 		currLevelExp = Player::getExpForLevel(level);
 	}
 
+	journalExperience(oldLevel != level);
+
 	if (oldLevel != level) {
 		health = getMaxHealth();
 		mana = getMaxMana();
@@ -2512,13 +2585,13 @@ void Player::removeExperience(uint64_t exp, const bool sendText/* = false*/)
 		g_game.changeSpeed(this->getPlayer(), 0);
 		g_game.addCreatureHealth(this->getPlayer());
 
-		const uint32_t protectionLevel = static_cast<uint32_t>(g_config.getNumber(ConfigManager::PROTECTION_LEVEL));
+		const uint32_t protectionLevel = g_config.getSnapshot().protectionLevel;
 		if (oldLevel >= protectionLevel && level < protectionLevel) {
 			g_game.updateCreatureWalkthrough(this->getPlayer());
 		}
 
 		if (party) {
-			party->updateSharedExperience();
+			party->updateMemberLevel();
 		}
 
 		sendTextMessage(MESSAGE_EVENT_ADVANCE, fmt::format("You were downgraded from Level {:d} to Level {:d}.", oldLevel, level));
@@ -2637,7 +2710,7 @@ void Player::death(const CreaturePtr& lastHitCreature)
 
 		if (lastHitPlayer) {
 			uint32_t sumLevels = 0;
-			uint32_t inFightTicks = g_config.getNumber(ConfigManager::PZ_LOCKED);
+			uint32_t inFightTicks = g_config.getSnapshot().pzLocked;
 			for (const auto& it : damageMap) {
 				CountBlock_t cb = it.second;
 				if ((OTSYS_TIME() - cb.ticks) <= inFightTicks) {
@@ -2692,6 +2765,8 @@ void Player::death(const CreaturePtr& lastHitCreature)
 				capacity = std::max<int32_t>(0, capacity - vocation->getCapGain());
 			}
 
+			journalExperience(oldLevel != level);
+
 			if (oldLevel != level) {
 				sendTextMessage(MESSAGE_EVENT_ADVANCE, fmt::format("You were downgraded from Level {:d} to Level {:d}.", oldLevel, level));
 			}
@@ -2814,7 +2889,7 @@ void Player::addInFightTicks(const bool pzlock /*= false*/)
 		pzLocked = true;
 	}
 
-	const auto& condition = Condition::createCondition(CONDITIONID_DEFAULT, CONDITION_INFIGHT, g_config.getNumber(ConfigManager::PZ_LOCKED), 0);
+	const auto& condition = Condition::createCondition(CONDITIONID_DEFAULT, CONDITION_INFIGHT, g_config.getSnapshot().pzLocked, 0);
 	addCondition(condition);
 }
 
@@ -2825,6 +2900,7 @@ void Player::removeList()
 	for (const auto& it : g_game.getPlayers()) {
 		it.second->notifyStatusChange(this->getPlayer(), VIPSTATUS_OFFLINE);
 	}
+	g_worldBus.publishPresence(this->getPlayer(), false);
 }
 
 void Player::addList()
@@ -2832,6 +2908,7 @@ void Player::addList()
 	for (const auto& it : g_game.getPlayers()) {
 		it.second->notifyStatusChange(this->getPlayer(), VIPSTATUS_ONLINE);
 	}
+	g_worldBus.publishPresence(this->getPlayer(), true);
 
 	g_game.addPlayer(this->getPlayer());
 }
@@ -2847,21 +2924,26 @@ void Player::kickPlayer(bool displayEffect)
 }
 
 void Player::notifyStatusChange(const PlayerPtr& loginPlayer, VipStatus_t status)
+{
+	notifyStatusChange(loginPlayer->guid, loginPlayer->getName(), status);
+}
+
+void Player::notifyStatusChange(uint32_t loginGuid, const std::string& loginName, VipStatus_t status)
 {
 	if (!client) {
 		return;
 	}
 
-	if (const auto& it = VIPList.find(loginPlayer->guid); it == VIPList.end()) {
+	if (const auto& it = VIPList.find(loginGuid); it == VIPList.end()) {
 		return;
 	}
 
-	client->sendUpdatedVIPStatus(loginPlayer->guid, status);
+	client->sendUpdatedVIPStatus(loginGuid, status);
 
 	if (status == VIPSTATUS_ONLINE) {
-		client->sendTextMessage(TextMessage(MESSAGE_STATUS_SMALL, loginPlayer->getName() + " has logged in."));
+		client->sendTextMessage(TextMessage(MESSAGE_STATUS_SMALL, loginName + " has logged in."));
 	} else if (status == VIPSTATUS_OFFLINE) {
-		client->sendTextMessage(TextMessage(MESSAGE_STATUS_SMALL, loginPlayer->getName() + " has logged out."));
+		client->sendTextMessage(TextMessage(MESSAGE_STATUS_SMALL, loginName + " has logged out."));
 	}
 }
 
@@ -2998,7 +3080,7 @@ ReturnValue Player::queryAdd(int32_t index, const ThingPtr& thing, uint32_t coun
 	} else if (slotPosition & SLOTP_TWO_HAND) {
 		ret = RETURNVALUE_PUTTHISOBJECTINBOTHHANDS;
 	} else if ((slotPosition & SLOTP_RIGHT) || (slotPosition & SLOTP_LEFT)) {
-		if (!g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS)) {
+		if (!g_config.getSnapshot().classicEquipmentSlots) {
 			ret = RETURNVALUE_CANNOTBEDRESSED;
 		} else {
 			ret = RETURNVALUE_PUTTHISOBJECTINYOURHAND;
@@ -3036,7 +3118,7 @@ ReturnValue Player::queryAdd(int32_t index, const ThingPtr& thing, uint32_t coun
 
 		case CONST_SLOT_RIGHT: {
 			if (slotPosition & SLOTP_RIGHT) {
-				if (!g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS)) {
+				if (!g_config.getSnapshot().classicEquipmentSlots) {
 					if (item->getWeaponType() != WEAPON_SHIELD && item->getWeaponType() != WEAPON_QUIVER) {
 						ret = RETURNVALUE_CANNOTBEDRESSED;
 					} else {
@@ -3093,7 +3175,7 @@ ReturnValue Player::queryAdd(int32_t index, const ThingPtr& thing, uint32_t coun
 
 		case CONST_SLOT_LEFT: {
 			if (slotPosition & SLOTP_LEFT) {
-				if (!g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS)) {
+				if (!g_config.getSnapshot().classicEquipmentSlots) {
 					WeaponType_t type = item->getWeaponType();
 					const auto& rightItem = inventory[CONST_SLOT_RIGHT];
 					if (type == WEAPON_NONE || type == WEAPON_SHIELD || type == WEAPON_AMMO || type == WEAPON_QUIVER) {
@@ -3168,7 +3250,7 @@ ReturnValue Player::queryAdd(int32_t index, const ThingPtr& thing, uint32_t coun
 		}
 
 		case CONST_SLOT_AMMO: {
-			if ((slotPosition & SLOTP_AMMO) || g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS)) {
+			if ((slotPosition & SLOTP_AMMO) || g_config.getSnapshot().classicEquipmentSlots) {
 				ret = RETURNVALUE_NOERROR;
 			}
 			break;
@@ -3203,7 +3285,7 @@ ReturnValue Player::queryAdd(int32_t index, const ThingPtr& thing, uint32_t coun
 	//need an exchange with source? (destination item is swapped with currently moved item)
 	const auto& inventoryItem = getInventoryItem(static_cast<slots_t>(index));
 	if (inventoryItem && (!inventoryItem->isStackable() || inventoryItem->getID() != item->getID())) {
-		if (!g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS)) {
+		if (!g_config.getSnapshot().classicEquipmentSlots) {
 			const auto& cylinder = item->getTopParent();
 			if (cylinder && (std::dynamic_pointer_cast<const DepotChest>(cylinder) || std::dynamic_pointer_cast<const Player>(cylinder))) {
 				return RETURNVALUE_NEEDEXCHANGE;
@@ -3426,6 +3508,9 @@ void Player::addThing(int32_t index, ThingPtr thing)
 
 	item->setParent(getPlayer());
 	inventory[index] = item;
+	modifierSetsValid = false;
+	imbuedSlotsValid = false;
+	itemTypeCountsValid = false;
 
 	//send to client
 	sendInventoryItem(static_cast<slots_t>(index), item);
@@ -3445,6 +3530,7 @@ void Player::updateThing(ThingPtr thing, uint16_t itemId, uint32_t count)
 
 	item->setID(itemId);
 	item->setSubType(count);
+	itemTypeCountsValid = false;
 
 	//send to client
 	sendInventoryItem(static_cast<slots_t>(index), item);
@@ -3477,6 +3563,9 @@ void Player::replaceThing(uint32_t index, ThingPtr thing)
 	item->setParent(getPlayer());
 
 	inventory[index] = item;
+	modifierSetsValid = false;
+	imbuedSlotsValid = false;
+	itemTypeCountsValid = false;
 }
 
 void Player::removeThing(ThingPtr thing, uint32_t count)
@@ -3501,9 +3590,13 @@ void Player::removeThing(ThingPtr thing, uint32_t count)
 
 			item->clearParent();
 			inventory[index] = nullptr;
+			modifierSetsValid = false;
+			imbuedSlotsValid = false;
+			itemTypeCountsValid = false;
 		} else {
 			uint8_t newCount = static_cast<uint8_t>(std::max<int32_t>(0, item->getItemCount() - count));
 			item->setItemCount(newCount);
+			itemTypeCountsValid = false;
 
 			//send change to client
 			sendInventoryItem(static_cast<slots_t>(index), item);
@@ -3519,6 +3612,9 @@ void Player::removeThing(ThingPtr thing, uint32_t count)
 		onRemoveInventoryItem(item);
 		item->clearParent();
 		inventory[index] = nullptr;
+		modifierSetsValid = false;
+		imbuedSlotsValid = false;
+		itemTypeCountsValid = false;
 	}
 }
 
@@ -3544,6 +3640,12 @@ size_t Player::getLastIndex() const
 
 uint32_t Player::getItemTypeCount(const uint16_t itemId, int32_t subType /*= -1*/) const
 {
+	if (subType == -1) {
+		updateItemTypeCounts();
+		auto it = itemTypeCounts.find(itemId);
+		return it != itemTypeCounts.end() ? it->second : 0;
+	}
+
 	uint32_t count = 0;
 	for (int32_t i = CONST_SLOT_FIRST; i <= CONST_SLOT_LAST; i++) {
 		const auto& item = inventory[i];
@@ -3566,6 +3668,41 @@ uint32_t Player::getItemTypeCount(const uint16_t itemId, int32_t subType /*= -1*
 	return count;
 }
 
+void Player::updateImbuedSlots()
+{
+	imbuedSlots = 0;
+	for (int32_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_LAST; ++slot) {
+		if (const auto& item = inventory[slot]; item && item->hasImbuements()) {
+			imbuedSlots |= 1 << slot;
+		}
+	}
+	imbuedSlotsValid = true;
+}
+
+void Player::updateItemTypeCounts() const
+{
+	if (itemTypeCountsValid) {
+		return;
+	}
+
+	itemTypeCounts.clear();
+	for (int32_t i = CONST_SLOT_FIRST; i <= CONST_SLOT_LAST; i++) {
+		const auto& item = inventory[i];
+		if (!item) {
+			continue;
+		}
+
+		itemTypeCounts[item->getID()] += Item::countByType(item, -1);
+
+		if (const auto& container = item->getContainer()) {
+			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
+				itemTypeCounts[(*it)->getID()] += Item::countByType(*it, -1);
+			}
+		}
+	}
+	itemTypeCountsValid = true;
+}
+
 bool Player::removeItemOfType(const uint16_t itemId, uint32_t amount, int32_t subType, bool ignoreEquipped/* = false*/) const
 {
 	if (amount == 0) {
@@ -3619,19 +3756,9 @@ bool Player::removeItemOfType(const uint16_t itemId, uint32_t amount, int32_t su
 
 gtl::btree_map<uint32_t, uint32_t>& Player::getAllItemTypeCount(gtl::btree_map<uint32_t, uint32_t>& countMap) const
 {
-	for (int32_t i = CONST_SLOT_FIRST; i <= CONST_SLOT_LAST; i++) {
-		const auto& item = inventory[i];
-		if (!item) {
-			continue;
-		}
-
-		countMap[item->getID()] += Item::countByType(item, -1);
-
-		if (const auto& container = item->getContainer()) {
-			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
-				countMap[(*it)->getID()] += Item::countByType(*it, -1);
-			}
-		}
+	updateItemTypeCounts();
+	for (const auto& [itemId, count] : itemTypeCounts) {
+		countMap[itemId] += count;
 	}
 	return countMap;
 }
@@ -3646,10 +3773,17 @@ ThingPtr Player::getThing(size_t index)
 
 void Player::postAddNotification(ThingPtr thing, CylinderPtr oldParent, int32_t index, cylinderlink_t link /*= LINK_OWNER*/)
 {
+	// the equip scripts may already count
+	if (link == LINK_OWNER || link == LINK_TOPPARENT) {
+		itemTypeCountsValid = false;
+	}
+
 	if (link == LINK_OWNER) {
 		//calling movement scripts
 		g_moveEvents->onPlayerEquip(this->getPlayer(), thing->getItem(), static_cast<slots_t>(index), false);
-		g_events->eventPlayerOnInventoryUpdate(this->getPlayer(), thing->getItem(), static_cast<slots_t>(index), true);
+		if (g_events->hasEvent(EventInfoId::PLAYER_ONINVENTORYUPDATE)) {
+			g_events->eventPlayerOnInventoryUpdate(this->getPlayer(), thing->getItem(), static_cast<slots_t>(index), true);
+		}
 		if (isInventorySlot(static_cast<slots_t>(index))) {
 			const auto& item = thing->getItem();
 			if (item && item->hasImbuements()) {
@@ -3706,10 +3840,17 @@ void Player::postAddNotification(ThingPtr thing, CylinderPtr oldParent, int32_t
 
 void Player::postRemoveNotification(ThingPtr thing, CylinderPtr newParent, int32_t index, cylinderlink_t link /*= LINK_OWNER*/)
 {
+	// the equip scripts may already count
+	if (link == LINK_OWNER || link == LINK_TOPPARENT) {
+		itemTypeCountsValid = false;
+	}
+
 	if (link == LINK_OWNER) {
 		//calling movement scripts
 		g_moveEvents->onPlayerDeEquip(this->getPlayer(), thing->getItem(), static_cast<slots_t>(index));
-		g_events->eventPlayerOnInventoryUpdate(this->getPlayer(), thing->getItem(), static_cast<slots_t>(index), false);
+		if (g_events->hasEvent(EventInfoId::PLAYER_ONINVENTORYUPDATE)) {
+			g_events->eventPlayerOnInventoryUpdate(this->getPlayer(), thing->getItem(), static_cast<slots_t>(index), false);
+		}
 		if (isInventorySlot(static_cast<slots_t>(index))) {
 			auto item = thing->getItem();
 			if (item && item->hasImbuements()) {
@@ -3804,9 +3945,8 @@ bool Player::updateSaleShopList(const ItemConstPtr& item)
 		}
 	}
 
-	if (client) {
-		client->sendSaleItemList(shopItemList);
-	}
+	// a move of many items changes the list many times over
+	queueUpdate(saleListPending);
 	return true;
 }
 
@@ -3837,6 +3977,9 @@ void Player::internalAddThing(uint32_t index, ThingPtr thing)
 		}
 
 		inventory[index] = item;
+		modifierSetsValid = false;
+		imbuedSlotsValid = false;
+		itemTypeCountsValid = false;
 		item->setParent(getPlayer());
 	}
 }
@@ -3872,7 +4015,7 @@ bool Player::setAttackedCreature(const CreaturePtr& creature)
 	}
 
 	if (creature) {
-		g_dispatcher.addTask(createTask([id = getID()]() { g_game.checkCreatureAttack(id); }));
+		g_dispatcher.addTask(createTask([id = getID()]() { g_game.checkCreatureAttack(id); }, DISPATCHER_LANE_CREATURE));
 	}
 	return true;
 }
@@ -3928,7 +4071,7 @@ void Player::doAttacking(uint32_t)
 			result = Weapon::useFist(this->getPlayer(), getAttackedCreature());
 		}
 
-		SchedulerTask* task = createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, delay), [id = getID()]() { g_game.checkCreatureAttack(id); });
+		SchedulerTask* task = createSchedulerTask(std::max<uint32_t>(SCHEDULER_MINTICKS, delay), [id = getID()]() { g_game.checkCreatureAttack(id); }, DISPATCHER_LANE_PLAYER);
 		if (!classicSpeed) {
 			setNextActionTask(task, false);
 		} else {
@@ -4414,15 +4557,11 @@ bool Player::canWear(uint32_t lookType, uint8_t addons) const
 		return true;
 	}
 
-	for (const OutfitEntry& outfitEntry : outfits) {
-		if (outfitEntry.lookType == lookType) {
-			if (outfitEntry.addons == addons || outfitEntry.addons == 3 || addons == 0) {
-				return true;
-			}
-			return false; //have lookType on list and addons don't match
-		}
+	auto it = outfits.find(lookType);
+	if (it == outfits.end()) {
+		return false;
 	}
-	return false;
+	return it->second == addons || it->second == 3 || addons == 0;
 }
 
 bool Player::hasOutfit(uint32_t lookType, uint8_t addons) const
@@ -4436,58 +4575,41 @@ bool Player::hasOutfit(uint32_t lookType, uint8_t addons) const
 		return true;
 	}
 
-	for (const OutfitEntry& outfitEntry : outfits) {
-		if (outfitEntry.lookType == lookType) {
-			if (outfitEntry.addons == addons || outfitEntry.addons == 3 || addons == 0){
-				return true;
-			}
-			return false; //have lookType on list and addons don't match
-		}
+	auto it = outfits.find(lookType);
+	if (it == outfits.end()) {
+		return false;
 	}
-	return false;
+	return it->second == addons || it->second == 3 || addons == 0;
 }
 
 void Player::genReservedStorageRange()
 {
 	//generate outfits range
 	uint32_t base_key = PSTRG_OUTFITS_RANGE_START;
-	for (const OutfitEntry& entry : outfits) {
-		storageMap[++base_key] = (entry.lookType << 16) | entry.addons;
+	for (const auto& [lookType, addons] : outfits) {
+		storageMap.set(++base_key, (lookType << 16) | addons);
 	}
 }
 
 void Player::addOutfit(uint16_t lookType, uint8_t addons)
 {
-	for (OutfitEntry& outfitEntry : outfits) {
-		if (outfitEntry.lookType == lookType) {
-			outfitEntry.addons |= addons;
-			return;
-		}
-	}
-	outfits.emplace_back(lookType, addons);
+	outfits[lookType] |= addons;
 }
 
 bool Player::removeOutfit(uint16_t lookType)
 {
-	for (auto it = outfits.begin(), end = outfits.end(); it != end; ++it) {
-		OutfitEntry& entry = *it;
-		if (entry.lookType == lookType) {
-			outfits.erase(it);
-			return true;
-		}
-	}
-	return false;
+	return outfits.erase(lookType) != 0;
 }
 
 bool Player::removeOutfitAddon(uint16_t lookType, uint8_t addons)
 {
-	for (OutfitEntry& outfitEntry : outfits) {
-		if (outfitEntry.lookType == lookType) {
-			outfitEntry.addons &= ~addons;
-			return true;
-		}
+	auto it = outfits.find(lookType);
+	if (it == outfits.end()) {
+		return false;
 	}
-	return false;
+
+	it->second &= ~addons;
+	return true;
 }
 
 bool Player::getOutfitAddons(const Outfit& outfit, uint8_t& addons) const
@@ -4501,12 +4623,8 @@ bool Player::getOutfitAddons(const Outfit& outfit, uint8_t& addons) const
 		return false;
 	}
 
-	for (const OutfitEntry& outfitEntry : outfits) {
-		if (outfitEntry.lookType != outfit.lookType) {
-			continue;
-		}
-
-		addons = outfitEntry.addons;
+	if (auto it = outfits.find(outfit.lookType); it != outfits.end()) {
+		addons = it->second;
 		return true;
 	}
 
@@ -4653,16 +4771,34 @@ double Player::getLostPercent() const
 	return lossPercent * (1 - (percentReduction / 100.)) / 100.;
 }
 
+namespace {
+
+auto findLearnedSpell(const std::vector<InternedString>& spells, uint32_t id)
+{
+	return std::ranges::lower_bound(spells, id, {}, &InternedString::id);
+}
+
+}
+
 void Player::learnInstantSpell(const std::string& spellName)
 {
-	if (!hasLearnedInstantSpell(spellName)) {
-		learnedInstantSpellList.push_front(spellName);
+	InternedString spell(spellName);
+	const auto it = findLearnedSpell(learnedInstantSpells, spell.id());
+	if (it == learnedInstantSpells.end() || it->id() != spell.id()) {
+		learnedInstantSpells.insert(it, std::move(spell));
 	}
 }
 
 void Player::forgetInstantSpell(const std::string& spellName)
 {
-	learnedInstantSpellList.remove(spellName);
+	const uint32_t id = InternedString::findId(spellName);
+	if (id == 0) {
+		return;
+	}
+
+	if (const auto it = findLearnedSpell(learnedInstantSpells, id); it != learnedInstantSpells.end() && it->id() == id) {
+		learnedInstantSpells.erase(it);
+	}
 }
 
 bool Player::hasLearnedInstantSpell(const std::string& spellName) const
@@ -4675,12 +4811,31 @@ bool Player::hasLearnedInstantSpell(const std::string& spellName) const
 		return true;
 	}
 
-	for (const auto& learnedSpellName : learnedInstantSpellList) {
-		if (caseInsensitiveEqual(learnedSpellName, spellName)) {
-			return true;
-		}
+	const uint32_t id = InternedString::findId(spellName);
+	if (id == 0) {
+		return false;
 	}
-	return false;
+
+	const auto it = findLearnedSpell(learnedInstantSpells, id);
+	return it != learnedInstantSpells.end() && it->id() == id;
+}
+
+Player::MemoryUsage Player::getMemoryUsage() const
+{
+	// the btree maps keep their values in nodes, counted by value
+	MemoryUsage usage;
+	usage.openContainers = openContainers.size() * sizeof(decltype(openContainers)::value_type);
+	usage.depotChests = depotChests.size() * sizeof(decltype(depotChests)::value_type);
+	usage.shopItems = shopItemList.capacity() * sizeof(ShopInfo);
+	for (const ShopInfo& shopInfo : shopItemList) {
+		usage.shopItems += shopInfo.realName.capacity();
+	}
+	usage.learnedSpells = learnedInstantSpells.capacity() * sizeof(InternedString);
+	usage.outfits = outfits.bucket_count() * (sizeof(decltype(outfits)::value_type) + 1);
+	usage.vipList = VIPList.bucket_count() * sizeof(void*) + VIPList.size() * (sizeof(uint32_t) + sizeof(void*));
+	usage.attackedSet = attackedSet.bucket_count() * sizeof(void*) + attackedSet.size() * (sizeof(uint32_t) + sizeof(void*));
+	usage.conditions = conditions.slots() * sizeof(Condition*);
+	return usage;
 }
 
 bool Player::isPremium() const
@@ -5044,7 +5199,9 @@ bool Player::addOfflineTrainingTries(skills_t skill, uint64_t tries)
 		oldSkillValue = magLevel;
 		oldPercentToNextLevel = static_cast<long double>(manaSpent * 100) / nextReqMana;
 
-		g_events->eventPlayerOnGainSkillTries(this->getPlayer(), SKILL_MAGLEVEL, tries);
+		if (g_events->hasEvent(EventInfoId::PLAYER_ONGAINSKILLTRIES)) {
+			g_events->eventPlayerOnGainSkillTries(this->getPlayer(), SKILL_MAGLEVEL, tries);
+		}
 		uint32_t currMagLevel = magLevel;
 
 		while ((manaSpent + tries) >= nextReqMana) {
@@ -5096,7 +5253,9 @@ bool Player::addOfflineTrainingTries(skills_t skill, uint64_t tries)
 		oldSkillValue = skills[skill].level;
 		oldPercentToNextLevel = static_cast<long double>(skills[skill].tries * 100) / nextReqTries;
 
-		g_events->eventPlayerOnGainSkillTries(this->getPlayer(), skill, tries);
+		if (g_events->hasEvent(EventInfoId::PLAYER_ONGAINSKILLTRIES)) {
+			g_events->eventPlayerOnGainSkillTries(this->getPlayer(), skill, tries);
+		}
 		uint32_t currSkillLevel = skills[skill].level;
 
 		while ((skills[skill].tries + tries) >= nextReqTries) {
@@ -5181,13 +5340,13 @@ uint16_t Player::getHelpers() const
 	if (guild && party) {
 		std::unordered_set<PlayerPtr> helperSet;
 
-		auto guildMembers = guild->getMembersOnline();
+		const auto& guildMembers = guild->getMembersOnline();
 		helperSet.insert(guildMembers.begin(), guildMembers.end());
 
-		auto partyMembers = party->getMembers();
+		const auto& partyMembers = party->getMembers();
 		helperSet.insert(partyMembers.begin(), partyMembers.end());
 
-		auto partyInvitees = party->getInvitees();
+		const auto& partyInvitees = party->getInvitees();
 		helperSet.insert(partyInvitees.begin(), partyInvitees.end());
 
 		helperSet.insert(party->getLeader());
@@ -5268,6 +5427,7 @@ size_t Player::getMaxDepotItems() const
 const bool Player::addAugment(const std::shared_ptr<Augment>& augment) {
 	if (std::ranges::find(augments, augment) == augments.end()) {
 		augments.push_back(augment);
+		modifierSetsValid = false;
 		g_events->eventPlayerOnAugment(this->getPlayer(), augment);
 		return true;
 	}
@@ -5278,6 +5438,7 @@ const bool Player::addAugment(const std::string_view augmentName) {
 
 	if (auto augment = Augments::GetAugment(augmentName)) {
 		augments.emplace_back(augment);
+		modifierSetsValid = false;
 		g_events->eventPlayerOnAugment(this->getPlayer(), augment);
 		return true;
 	}
@@ -5288,6 +5449,7 @@ const bool Player::removeAugment(const std::shared_ptr<Augment>& augment) {
 	if (const auto it = std::ranges::find(augments, augment); it != augments.end()) {
 		g_events->eventPlayerOnRemoveAugment(this->getPlayer(), augment);
 		augments.erase(it);
+		modifierSetsValid = false;
 		return true;
 	}
 	return false;
@@ -5356,6 +5518,7 @@ const bool Player::removeAugment(std::string_view augmentName) {
 		              }
 		              return augment->getName() == augmentName;
 	              });
+	modifierSetsValid = false;
 	
 	return augments.size() > originalSize;
 }
@@ -5560,6 +5723,7 @@ void Player::removeItemImbuements(const ItemPtr& item) {
 
 
 void Player::removeImbuementEffect(const std::shared_ptr<Imbuement>& imbue) {
+	imbuedSlotsValid = false;
 	
 	if (imbue->isSkill()) {
 		switch (imbue->imbuetype) {
@@ -5622,6 +5786,7 @@ void Player::removeImbuementEffect(const std::shared_ptr<Imbuement>& imbue) {
 }
 
 void Player::addImbuementEffect(const std::shared_ptr<Imbuement>& imbue) {
+	imbuedSlotsValid = false;
 
 	if (imbue->isSkill()) {
 		switch (imbue->imbuetype) {
@@ -5707,97 +5872,89 @@ CreatureType_t Player::getCreatureType(const MonsterPtr& monster) const
 	return creatureType;
 }
 
-static ModifierTotals getValidatedTotals(const std::vector<std::shared_ptr<DamageModifier>>& modifierList, const CombatType_t damageType, const CombatOrigin originType, const CreatureType_t creatureType, const RaceType_t race, const std::string_view creatureName) {
+static ModifierTotals getValidatedTotals(const std::vector<CompiledModifier>& modifierList, const CombatType_t damageType, const CombatOrigin originType, const CreatureType_t creatureType, const RaceType_t race, const uint32_t nameId) {
 	uint16_t percent = 0;
 	uint16_t flat = 0;
-	// to-do: const and auto&
-	for (auto& modifier : modifierList) {
+	for (const CompiledModifier& modifier : modifierList) {
+		if (!modifier.appliesTo(damageType, originType, creatureType, race, nameId)) {
+			continue;
+		}
 
-		if (modifier->appliesToDamage(damageType) && modifier->appliesToOrigin(originType) && modifier->appliesToTarget(creatureType, race, creatureName)) {
-			if (modifier->isFlatValue() && modifier->getChance() == 0 || modifier->isFlatValue() && modifier->getChance() == 100) {
-					flat += modifier->getValue();
-					continue;
-			} else if (modifier->isFlatValue()) {
-				if (modifier->getChance() >= uniform_random(1, 100)) {
-					flat += modifier->getValue();
-					continue;
-				}
-			}
+		if (modifier.chance != 0 && modifier.chance != 100 && modifier.chance < uniform_random(1, 100)) {
+			continue;
+		}
 
-			if (modifier->isPercent() && modifier->getChance() == 0 || modifier->isPercent() && modifier->getChance() == 100) {
-				percent += modifier->getValue();
-				continue;
-			} else if (modifier->isPercent()) {
-				if (modifier->getChance() >= uniform_random(1, 100)) {
-					percent += modifier->getValue();
-					continue;
-				}
-			}
+		if (modifier.flat) {
+			flat += modifier.value;
+		} else {
+			percent += modifier.value;
 		}
 	}
 	percent = std::clamp<uint16_t>(percent, 0, 100);
 	return ModifierTotals(flat, percent);
 }
 
-gtl::node_hash_map <uint8_t, std::vector<std::shared_ptr<DamageModifier>>> Player::getAttackModifiers() const
+void Player::updateModifierSets() const
 {
-	gtl::node_hash_map<uint8_t, std::vector<std::shared_ptr<DamageModifier>>> modifierMap;
+	const bool slotProtection = g_config.getSnapshot().augmentSlotProtection;
+	if (modifierSetsValid && modifierSetGeneration == DamageModifier::getSetGeneration() && modifierSetSlotProtection == slotProtection) {
+		return;
+	}
 
-	if (!augments.empty()) {
-		for (const auto& aug : augments) {
-			for (const auto& mod : aug->getAttackModifiers()) {
-				modifierMap[mod->getType()].emplace_back(mod);
+	for (auto& modifiers : attackModifierSet) {
+		modifiers.clear();
+	}
+	for (auto& modifiers : defenseModifierSet) {
+		modifiers.clear();
+	}
+
+	const auto addModifiers = [this](const std::shared_ptr<Augment>& aug) {
+		CompiledModifier compiled;
+		for (const auto& mod : aug->getAttackModifiers()) {
+			if (mod->getType() < attackModifierSet.size() && mod->compile(compiled)) {
+				attackModifierSet[mod->getType()].push_back(compiled);
 			}
 		}
+		for (const auto& mod : aug->getDefenseModifiers()) {
+			if (mod->getType() < defenseModifierSet.size() && mod->compile(compiled)) {
+				defenseModifierSet[mod->getType()].push_back(compiled);
+			}
+		}
+	};
+
+	for (const auto& aug : augments) {
+		addModifiers(aug);
 	}
 
 	for (uint8_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_RING; ++slot) {
 		if (const auto& item = inventory[slot]; item && !item->getAugments().empty()) {
+			const bool applies = !slotProtection || (item->getEquipSlot() == getPositionForSlot(static_cast<slots_t>(slot))) ||
+				((slot == CONST_SLOT_RIGHT || slot == CONST_SLOT_LEFT) && (item->getWeaponType() != WEAPON_NONE && item->getWeaponType() != WEAPON_AMMO));
+			if (!applies) {
+				continue;
+			}
+
 			for (const auto& aug : item->getAugments()) {
-				if (!g_config.getBoolean(ConfigManager::AUGMENT_SLOT_PROTECTION) || (item->getEquipSlot() == getPositionForSlot(static_cast<slots_t>(slot)))) {
-					for (const auto& mod : aug->getAttackModifiers()) {
-						modifierMap[mod->getType()].emplace_back(mod);
-					}
-				} else if ( g_config.getBoolean(ConfigManager::AUGMENT_SLOT_PROTECTION) && (slot == CONST_SLOT_RIGHT || slot == CONST_SLOT_LEFT) && (item->getWeaponType() != WEAPON_NONE && item->getWeaponType() != WEAPON_AMMO)) {
-					for (const auto& mod : aug->getAttackModifiers()) {
-						modifierMap[mod->getType()].emplace_back(mod);
-					}
-				}
+				addModifiers(aug);
 			}
 		}
 	}
 
-	return modifierMap;
+	modifierSetGeneration = DamageModifier::getSetGeneration();
+	modifierSetSlotProtection = slotProtection;
+	modifierSetsValid = true;
 }
 
-gtl::node_hash_map <uint8_t, std::vector<std::shared_ptr<DamageModifier>>> Player::getDefenseModifiers() const
+const Player::AttackModifierSet& Player::getAttackModifiers() const
 {
-	gtl::node_hash_map<uint8_t, std::vector<std::shared_ptr<DamageModifier>>> modifierMap;
-
-	if (!augments.empty()) {
-		for (const auto& aug : augments) {
-			for (const auto& mod : aug->getDefenseModifiers()) {
-				modifierMap[mod->getType()].emplace_back(mod);
-			}
-		}
-	}
+	updateModifierSets();
+	return attackModifierSet;
+}
 
-	for (uint8_t slot = CONST_SLOT_FIRST; slot <= CONST_SLOT_RING; ++slot) {
-		if (const auto& item = inventory[slot]; item && !item->getAugments().empty()) {
-			for (const auto& aug : item->getAugments()) {
-				if (!g_config.getBoolean(ConfigManager::AUGMENT_SLOT_PROTECTION) || (item->getEquipSlot() == getPositionForSlot(static_cast<slots_t>(slot)))) {
-					for (const auto& mod : aug->getDefenseModifiers()) {
-						modifierMap[mod->getType()].emplace_back(mod);
-					}
-				} else if (g_config.getBoolean(ConfigManager::AUGMENT_SLOT_PROTECTION) && (slot == CONST_SLOT_RIGHT || slot == CONST_SLOT_LEFT) && (item->getWeaponType() != WEAPON_NONE && item->getWeaponType() != WEAPON_AMMO)) {
-					for (const auto& mod : aug->getDefenseModifiers()) {
-						modifierMap[mod->getType()].emplace_back(mod);
-					}
-				}
-			}
-		}
-	}
-	return modifierMap;
+const Player::DefenseModifierSet& Player::getDefenseModifiers() const
+{
+	updateModifierSets();
+	return defenseModifierSet;
 }
 
 gtl::node_hash_map<uint8_t, ModifierTotals> Player::getConvertedTotals(const uint8_t modType, const CombatType_t damageType, const CombatOrigin originType, const CreatureType_t creatureType, const RaceType_t race, const std::string_view creatureName)
@@ -5895,9 +6052,10 @@ gtl::node_hash_map<uint8_t, ModifierTotals> Player::getAttackModifierTotals(cons
 	gtl::node_hash_map<uint8_t, ModifierTotals> modMap;
 	modMap.reserve(ATTACK_MODIFIER_LAST);
 	
-	auto attackMods = getAttackModifiers();
+	const auto& attackMods = getAttackModifiers();
+	const uint32_t nameId = DamageModifier::getNameId(creatureName);
 	for (uint8_t i = ATTACK_MODIFIER_NONE; i < ATTACK_MODIFIER_LAST; ++i) {
-		auto modTotals = getValidatedTotals(attackMods[i], damageType, originType, creatureType, race, creatureName);
+		auto modTotals = getValidatedTotals(attackMods[i], damageType, originType, creatureType, race, nameId);
 		modMap.try_emplace(i, modTotals);
 	}
 	return modMap;
@@ -5909,10 +6067,11 @@ gtl::node_hash_map<uint8_t, ModifierTotals> Player::getDefenseModifierTotals(con
 	gtl::node_hash_map<uint8_t, ModifierTotals> modMap;
 	modMap.reserve(DEFENSE_MODIFIER_LAST);
 	
-	auto defenseMods = getDefenseModifiers();
+	const auto& defenseMods = getDefenseModifiers();
+	const uint32_t nameId = DamageModifier::getNameId(creatureName);
 	// todo: skip reform in this loop
 	for (uint8_t i = DEFENSE_MODIFIER_FIRST; i <= DEFENSE_MODIFIER_LAST; ++i) {
-		auto modTotals = getValidatedTotals(defenseMods[i], damageType, originType, creatureType, race, creatureName);
+		auto modTotals = getValidatedTotals(defenseMods[i], damageType, originType, creatureType, race, nameId);
 		modMap.try_emplace(i, modTotals);
 	}
 	return modMap;
@@ -6070,7 +6229,7 @@ void Player::replenishStaminaFromDamage(std::optional<CreaturePtr> attacker,
 		replenishDamage = std::min<int32_t>(replenishDamage,  originalDamageValue);
 		originalDamage.primary.value += replenishDamage;
 
-		if (!g_config.getBoolean(ConfigManager::AUGMENT_STAMINA_RULE)) {
+		if (!g_config.getSnapshot().augmentStaminaRule) {
 			replenishDamage = replenishDamage / 60;
 		}
 
@@ -6353,13 +6512,13 @@ std::vector<ItemPtr> Player::getEquipment(bool validateSlot) const
 			{
 				if (item->getEquipSlot() == getPositionForSlot(static_cast<slots_t>(slot)))
 				{
-					if (g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS)
+					if (g_config.getSnapshot().classicEquipmentSlots
 						and ((slot == CONST_SLOT_RIGHT or slot == CONST_SLOT_LEFT) and (item->getWeaponType() != WEAPON_NONE and item->getWeaponType() != WEAPON_AMMO))
 						or (slot == CONST_SLOT_AMMO) and (item->getWeaponType() == WEAPON_AMMO or item->getLightInfo().level > 0))
 					{
 						equipment.push_back(item);
 					}
-					else if (!g_config.getBoolean(ConfigManager::CLASSIC_EQUIPMENT_SLOTS))
+					else if (!g_config.getSnapshot().classicEquipmentSlots)
 					{
 						equipment.push_back(item);
 					}
@@ -23,6 +23,9 @@
 #include "rewardchest.h"
 #include "augments.h"
 #include "accountmanager.h"
+#include "storagemap.h"
+#include "internedstring.h"
+#include "instancecounter.h"
 
 #include <bitset>
 #include <optional>
@@ -38,6 +41,7 @@ class Party;
 class SchedulerTask;
 class Bed;
 class Guild;
+class Quest;
 
 constexpr uint16_t MaximumStamina = 2520;
 
@@ -109,11 +113,9 @@ struct OpenContainer {
 	uint16_t index;
 };
 
-struct OutfitEntry {
-	constexpr OutfitEntry(uint16_t lookType, uint8_t addons) : lookType(lookType), addons(addons) {}
-
-	uint16_t lookType;
-	uint8_t addons;
+struct QuestLogEntry {
+	const Quest* quest;
+	bool completed;
 };
 
 static constexpr int16_t MINIMUM_SKILL_LEVEL = 10;
@@ -130,7 +132,7 @@ static constexpr int32_t PLAYER_MAX_SPEED = 1500;
 static constexpr int32_t PLAYER_MIN_SPEED = 10;
 static constexpr int32_t NOTIFY_DEPOT_BOX_RANGE = 1;
 
-class Player final : public Creature, public Cylinder
+class Player final : public Creature, public Cylinder, public InstanceCounter<Player>
 {
 	public:
 		explicit Player(ProtocolGame_ptr p);
@@ -143,6 +145,15 @@ class Player final : public Creature, public Cylinder
 
 		~Player() override;
 
+		const PlayerCost_ptr& getCost() const {
+			return cost;
+		}
+
+		// the depot, the inbox or the reward chest are still in the database, see lazyDepotLoading
+		bool hasUnloadedSections() const {
+			return unloadedSections.any();
+		}
+
 		// non-copyable
 		Player(const Player&) = delete;
 		Player& operator=(const Player&) = delete;
@@ -259,9 +270,7 @@ class Player final : public Creature, public Cylinder
 			return bankBalance;
 		}
 	
-		void setBankBalance(uint64_t balance) {
-			bankBalance = balance;
-		}
+		void setBankBalance(uint64_t balance);
 
 		Guild_ptr getGuild() const {
 			return guild;
@@ -269,7 +278,7 @@ class Player final : public Creature, public Cylinder
 	
 		void setGuild(Guild_ptr guild);
 
-		GuildRank_ptr getGuildRank() const {
+		const GuildRank_ptr& getGuildRank() const {
 			return guildRank;
 		}
 	
@@ -401,6 +410,8 @@ class Player final : public Creature, public Cylinder
 
 		void addStorageValue(const uint32_t key, const int32_t value, const bool isLogin = false);
 		bool getStorageValue(const uint32_t key, int32_t& value) const;
+		// the started quests, read anew after a storage value of some quest changed
+		const std::vector<QuestLogEntry>& getQuestLog();
 		void genReservedStorageRange();
 
 		void setGroup(Group* newGroup) {
@@ -505,6 +516,9 @@ class Player final : public Creature, public Cylinder
 		const Position& getLoginPosition() const {
 			return loginPosition;
 		}
+		void setLoginPosition(const Position& position) {
+			loginPosition = position;
+		}
 	
 		const Position& getTemplePosition() const {
 			return town->getTemplePosition();
@@ -639,6 +653,7 @@ class Player final : public Creature, public Cylinder
 
 		//V.I.P. functions
 		void notifyStatusChange(const PlayerPtr& loginPlayer, VipStatus_t status);
+		void notifyStatusChange(uint32_t loginGuid, const std::string& loginName, VipStatus_t status);
 		bool removeVIP(uint32_t vipGuid);
 		bool addVIP(uint32_t vipGuid, const std::string& vipName, VipStatus_t status);
 		bool addVIPInternal(uint32_t vipGuid);
@@ -657,7 +672,7 @@ class Player final : public Creature, public Cylinder
 		void onWalkComplete() override;
 
 		void stopWalk();
-		void openShopWindow(const NpcPtr& npc, const std::list<ShopInfo>& shop);
+		void openShopWindow(const NpcPtr& npc, const ShopInfoList& shop);
 		bool closeShopWindow(bool sendCloseShopWindow = true);
 		bool updateSaleShopList(const ItemConstPtr& item);
 		bool hasShopItemForSale(uint32_t itemId, uint8_t subType) const;
@@ -898,6 +913,12 @@ class Player final : public Creature, public Cylinder
 				client->sendPrivateMessage(speaker, type, text);
 			}
 		}
+		// from a player on another world
+		void sendPrivateMessage(const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text) const {
+			if (client) {
+				client->sendPrivateMessage(speaker, level, type, text);
+			}
+		}
 	
 		void sendCreatureSquare(const CreatureConstPtr& creature, SquareColor_t color) const {
 			if (client) {
@@ -1123,6 +1144,27 @@ class Player final : public Creature, public Cylinder
 				client->sendMagicEffect(pos, type);
 			}
 		}
+
+		// effect at pos already encoded by ProtocolGame::AddMagicEffect
+		void sendMagicEffect(const Position& pos, const NetworkMessage& msg) const {
+			if (client) {
+				client->sendMagicEffect(pos, msg);
+			}
+		}
+
+		// distance effect already encoded by ProtocolGame::AddDistanceShoot
+		void sendDistanceShoot(const Position& from, const Position& to, const NetworkMessage& msg) const {
+			if (client) {
+				client->sendDistanceShoot(from, to, msg);
+			}
+		}
+
+		// a message encoded once for all spectators
+		void sendBroadcast(const NetworkMessage& msg) const {
+			if (client) {
+				client->sendBroadcast(msg);
+			}
+		}
 	
 		void sendPing();
 	
@@ -1132,7 +1174,8 @@ class Player final : public Creature, public Cylinder
 			}
 		}
 	
-		void sendStats();
+		// queued, sent once at the end of the task with the values of then
+		void sendStats() const;
 	
 		void sendBasicData() const {
 			if (client) {
@@ -1140,11 +1183,9 @@ class Player final : public Creature, public Cylinder
 			}
 		}
 	
-		void sendSkills() const {
-			if (client) {
-				client->sendSkills();
-			}
-		}
+		void sendSkills() const;
+		// what sendStats, sendSkills and updateSaleShopList queued
+		void sendPendingUpdates();
 	
 		void sendTextMessage(MessageClasses mclass, const std::string& message) const {
 			if (client) {
@@ -1370,6 +1411,19 @@ class Player final : public Creature, public Cylinder
 		void forgetInstantSpell(const std::string& spellName);
 		bool hasLearnedInstantSpell(const std::string& spellName) const;
 
+		// bytes held by the containers of this player, for diagnostics
+		struct MemoryUsage {
+			size_t openContainers = 0;
+			size_t depotChests = 0;
+			size_t shopItems = 0;
+			size_t learnedSpells = 0;
+			size_t outfits = 0;
+			size_t vipList = 0;
+			size_t attackedSet = 0;
+			size_t conditions = 0;
+		};
+		MemoryUsage getMemoryUsage() const;
+
 		void updateRegeneration() const;
 
 		void addItemImbuements(const ItemPtr& item);
@@ -1380,8 +1434,11 @@ class Player final : public Creature, public Cylinder
 		CreatureType_t getCreatureType(const MonsterPtr& monster) const;
 
 		// To-do : Make all these methods into const
-		gtl::node_hash_map<uint8_t, std::vector<std::shared_ptr<DamageModifier>>> getAttackModifiers() const;
-		gtl::node_hash_map<uint8_t, std::vector<std::shared_ptr<DamageModifier>>> getDefenseModifiers() const;
+		// the modifiers of the player and its equipment by modifier type, built again only after those changed
+		using AttackModifierSet = std::array<std::vector<CompiledModifier>, ATTACK_MODIFIER_LAST + 1>;
+		using DefenseModifierSet = std::array<std::vector<CompiledModifier>, DEFENSE_MODIFIER_LAST + 1>;
+		const AttackModifierSet& getAttackModifiers() const;
+		const DefenseModifierSet& getDefenseModifiers() const;
 
 		gtl::node_hash_map<uint8_t, ModifierTotals> getConvertedTotals(const uint8_t modType, const CombatType_t damageType, const CombatOrigin originType, const CreatureType_t creatureType, const RaceType_t race, const std::string_view creatureName);
 
@@ -1499,6 +1556,8 @@ class Player final : public Creature, public Cylinder
 		void gainExperience(uint64_t gainExp, const CreaturePtr& source);
 		void addExperience(const CreaturePtr& source, uint64_t exp, bool sendText = false);
 		void removeExperience(uint64_t exp, bool sendText = false);
+		// the maximums only change with the level
+		void journalExperience(bool levelChanged);
 
 		void updateInventoryWeight();
 
@@ -1539,19 +1598,52 @@ class Player final : public Creature, public Cylinder
 		std::unordered_set<uint32_t> attackedSet;
 		std::unordered_set<uint32_t> VIPList;
 
-		std::map<uint8_t, OpenContainer> openContainers;
-		std::map<uint32_t, DepotChestPtr> depotChests;
-		gtl::btree_map<uint32_t, int32_t> storageMap;
+		// window ids are bounded by the client, both fit a single node
+		gtl::btree_map<uint8_t, OpenContainer> openContainers;
+		gtl::btree_map<uint32_t, DepotChestPtr> depotChests;
+		StorageMap storageMap;
+		// checksums of the rows of each section as last saved, 0 before the first save
+		std::array<uint64_t, PLAYER_SAVE_LAST> savedChecksums{};
+		// the sections a lazy login left in the database and what waits for them
+		std::bitset<PLAYER_SAVE_LAST> unloadedSections;
+		std::vector<std::function<void()>> sectionCallbacks;
 
 		std::vector<std::shared_ptr<Augment>> augments;
 
-		std::vector<OutfitEntry> outfits;
+		void updateModifierSets() const;
+
+		mutable AttackModifierSet attackModifierSet;
+		mutable DefenseModifierSet defenseModifierSet;
+		mutable uint32_t modifierSetGeneration = 0;
+		mutable bool modifierSetSlotProtection = false;
+		// cleared whenever the inventory or the augments of the player change
+		mutable bool modifierSetsValid = false;
+
+		void updateImbuedSlots();
+		// a bit per slot whose item has imbuements, cleared when the slots or the imbuements of an equipped item change
+		uint16_t imbuedSlots = 0;
+		bool imbuedSlotsValid = false;
+
+		void updateItemTypeCounts() const;
+		// lists the player with the game for its first pending update
+		void queueUpdate(bool& pending) const;
+
+		// total count by item id of what the player carries, for the shop lists and hotkeys
+		mutable gtl::flat_hash_map<uint16_t, uint32_t> itemTypeCounts;
+		// cleared by every change to the inventory or the containers in it
+		mutable bool itemTypeCountsValid = false;
+
+		// the addons by look type of the outfits the player owns
+		gtl::flat_hash_map<uint16_t, uint8_t> outfits;
+		// creatures whose observers contain this player
+		std::vector<Creature*> observedCreatures;
 
-		std::list<ShopInfo> shopItemList;
+		ShopInfoList shopItemList;
 
 		std::forward_list<Party*> invitePartyList;
 		std::forward_list<uint32_t> modalWindows;
-		std::forward_list<std::string> learnedInstantSpellList;
+		// sorted by id, see InternedString
+		std::vector<InternedString> learnedInstantSpells;
 		std::forward_list<Condition*> storedConditionList; // TODO: This variable is only temporarily used when logging in, get rid of it somehow
 
 		std::string name;
@@ -1573,6 +1665,9 @@ class Player final : public Creature, public Cylinder
 		uint64_t lastAttack = 0;
 		uint64_t bankBalance = 0;
 		uint64_t lastQuestlogUpdate = 0;
+		std::vector<QuestLogEntry> questLog;
+		uint32_t questLogVersion = 0;
+		bool questLogValid = false;
 		int64_t lastFailedFollow = 0;
 		int64_t skullTicks = 0;
 		int64_t lastWalkthroughAttempt = 0;
@@ -1581,6 +1676,7 @@ class Player final : public Creature, public Cylinder
 		int64_t lastPong;
 		int64_t nextAction = 0;
 		ProtocolGame_ptr client;
+		PlayerCost_ptr cost = std::make_shared<PlayerCost>();
 
 		BedItemPtr bedItem = nullptr;
 		Guild_ptr guild = nullptr;
@@ -1632,6 +1728,9 @@ class Player final : public Creature, public Cylinder
 		int32_t idleTime = 0;
 
 		uint16_t lastStatsTrainingTime = 0;
+		mutable bool statsPending = false;
+		mutable bool skillsPending = false;
+		mutable bool saleListPending = false;
 		uint16_t staminaMinutes = 2520;
 		uint16_t maxWriteLen = 0;
 
@@ -1707,6 +1806,8 @@ class Player final : public Creature, public Cylinder
 		friend class Actions;
 		friend class IOLoginData;
 		friend class ProtocolGame;
+		friend class Simulation;
+		friend class ProtocolCheck;
 };
 
 #endif
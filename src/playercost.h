@@ -0,0 +1,90 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_PLAYERCOST_H
+#define FS_PLAYERCOST_H
+
+// What a player has cost the server since they logged in. The traffic is
+// counted by the network threads, the rest while the dispatcher works for
+// the player: their requests, their think and the Lua they trigger there.
+struct PlayerCost
+{
+	std::atomic<uint64_t> bytesReceived{0};
+	std::atomic<uint64_t> bytesSent{0};
+	std::atomic<uint64_t> packets{0};
+
+	// dispatcher thread, nanoseconds
+	int64_t dispatcherTime = 0;
+	int64_t luaTime = 0;
+	uint64_t pathNodes = 0;
+
+	const std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+};
+
+using PlayerCost_ptr = std::shared_ptr<PlayerCost>;
+
+// charges the dispatcher time of the thread to cost until it goes out of
+// scope, and makes cost the one Lua and pathfinding charge in the meantime
+class PlayerCostScope
+{
+	public:
+		explicit PlayerCostScope(PlayerCost* cost) : previous(std::exchange(current, cost)) {
+			// nested scopes of the same player count once
+			if (cost && cost != previous) {
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		~PlayerCostScope() {
+			if (current && current != previous) {
+				current->dispatcherTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			}
+			current = previous;
+		}
+
+		static PlayerCost* getCurrent() {
+			return current;
+		}
+
+		// non-copyable
+		PlayerCostScope(const PlayerCostScope&) = delete;
+		PlayerCostScope& operator=(const PlayerCostScope&) = delete;
+
+	private:
+		static inline thread_local PlayerCost* current = nullptr;
+
+		PlayerCost* previous;
+		std::chrono::steady_clock::time_point start;
+};
+
+// charges a Lua call to the player of the enclosing scope, if any, the
+// calls it makes back into Lua are part of it
+class PlayerLuaTimer
+{
+	public:
+		PlayerLuaTimer() : cost(inside ? nullptr : PlayerCostScope::getCurrent()) {
+			if (cost) {
+				inside = true;
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		~PlayerLuaTimer() {
+			if (cost) {
+				cost->luaTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+				inside = false;
+			}
+		}
+
+		// non-copyable
+		PlayerLuaTimer(const PlayerLuaTimer&) = delete;
+		PlayerLuaTimer& operator=(const PlayerLuaTimer&) = delete;
+
+	private:
+		static inline thread_local bool inside = false;
+
+		PlayerCost* cost;
+		std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,362 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "playerjournal.h"
+
+#include "configmanager.h"
+#include "database.h"
+#include "threadrole.h"
+#include "tracing.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <optional>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+extern ConfigManager g_config;
+
+PlayerJournal g_playerJournal;
+
+namespace {
+
+using Record = PlayerJournal::Record;
+
+// the file is rewritten once it is this big and mostly made of records the database already has
+constexpr uint64_t COMPACT_SIZE = 8 * 1024 * 1024;
+
+uint32_t getChecksum(const Record& record)
+{
+	// FNV-1a of everything before the checksum
+	const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < offsetof(Record, checksum); ++i) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+bool syncFile(std::FILE* file)
+{
+	if (std::fflush(file) != 0) {
+		return false;
+	}
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+// what the database is missing after the records applied so far
+class JournalState
+{
+	public:
+		void apply(const Record& record) {
+			switch (record.type) {
+				case JOURNAL_EXPERIENCE:
+				case JOURNAL_LEVEL_STATS:
+				case JOURNAL_BANK_BALANCE:
+					players[record.owner].values[record.type] = record;
+					break;
+
+				case JOURNAL_PLAYER_STORAGE:
+				case JOURNAL_ACCOUNT_STORAGE:
+					storage[record.type - JOURNAL_PLAYER_STORAGE][StorageJournal::getKey(record.owner, record.key)] = record;
+					break;
+
+				case JOURNAL_PLAYER_SAVED: {
+					auto it = players.find(record.owner);
+					if (it == players.end()) {
+						break;
+					}
+
+					// the file is in sequence order, what comes later for this player is newer than the save
+					const uint64_t saved = static_cast<uint64_t>(record.value);
+					bool empty = true;
+					for (auto& value : it->second.values) {
+						if (value && value->sequence <= saved) {
+							value.reset();
+						}
+						empty = empty && !value;
+					}
+					if (empty) {
+						players.erase(it);
+					}
+					break;
+				}
+
+				case JOURNAL_STORAGE_SAVED: {
+					const uint64_t saved = static_cast<uint64_t>(record.value);
+					for (auto& table : storage) {
+						for (auto it = table.begin(); it != table.end();) {
+							if (it->second.sequence <= saved) {
+								table.erase(it++);
+							} else {
+								++it;
+							}
+						}
+					}
+					break;
+				}
+
+				default:
+					break;
+			}
+		}
+
+		size_t size() const {
+			size_t count = storage[0].size() + storage[1].size();
+			for (const auto& it : players) {
+				count += std::count_if(it.second.values.begin(), it.second.values.end(), [](const auto& value) { return value.has_value(); });
+			}
+			return count;
+		}
+
+		template <typename F>
+		void forEach(F&& f) const {
+			for (const auto& it : players) {
+				for (const auto& value : it.second.values) {
+					if (value) {
+						f(*value);
+					}
+				}
+			}
+			for (const auto& table : storage) {
+				for (const auto& it : table) {
+					f(it.second);
+				}
+			}
+		}
+
+		bool write(Database& db) const {
+			for (const auto& [guid, player] : players) {
+				std::vector<std::string> columns;
+				if (const auto& record = player.values[JOURNAL_EXPERIENCE]) {
+					columns.push_back(fmt::format("`experience` = {:d}, `level` = {:d}", record->value, record->key));
+				}
+				if (const auto& record = player.values[JOURNAL_LEVEL_STATS]) {
+					columns.push_back(fmt::format("`healthmax` = {:d}, `manamax` = {:d}, `cap` = {:d}", record->value >> 32, record->value & 0xFFFFFFFF, record->key));
+				}
+				if (const auto& record = player.values[JOURNAL_BANK_BALANCE]) {
+					columns.push_back(fmt::format("`balance` = {:d}", record->value));
+				}
+
+				if (!db.executeQuery(fmt::format("UPDATE `players` SET {:s} WHERE `id` = {:d}", fmt::join(columns, ", "), guid))) {
+					return false;
+				}
+			}
+
+			for (size_t table = 0; table < storage.size(); ++table) {
+				StorageJournal::Changes changes;
+				for (const auto& it : storage[table]) {
+					changes[it.first] = static_cast<int32_t>(it.second.value);
+				}
+				if (!StorageJournal::writeTable(db, static_cast<StorageTable_t>(table), changes)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		struct PlayerState
+		{
+			// by JournalRecord_t, up to the bank balance
+			std::array<std::optional<Record>, JOURNAL_BANK_BALANCE + 1> values;
+		};
+
+		gtl::flat_hash_map<uint32_t, PlayerState> players;
+		// by StorageTable_t
+		std::array<gtl::flat_hash_map<uint64_t, Record>, STORAGE_TABLE_LAST> storage;
+};
+
+}
+
+bool PlayerJournal::replay(const std::string& journalFile)
+{
+	JournalState state;
+	if (std::FILE* in = std::fopen(journalFile.c_str(), "rb")) {
+		Record record;
+		// a crash may have cut the last group short, what follows a torn record is dropped
+		while (std::fread(&record, sizeof(record), 1, in) == 1 && record.checksum == getChecksum(record)) {
+			state.apply(record);
+		}
+		std::fclose(in);
+	}
+
+	if (state.size() != 0) {
+		std::cout << ">> Writing " << state.size() << " values of the player journal" << std::endl;
+
+		Database& db = Database::getInstance();
+		DBTransaction transaction(db);
+		if (!transaction.begin() || !state.write(db) || !transaction.commit()) {
+			return false;
+		}
+	}
+
+	// the database has it all now
+	file = std::fopen(journalFile.c_str(), "wb");
+	if (!file) {
+		std::cout << "> ERROR: Can not open " << journalFile << " for writing." << std::endl;
+		return false;
+	}
+
+	path = journalFile;
+	fileSize = 0;
+	return true;
+}
+
+void PlayerJournal::recordExperience(uint32_t guid, uint32_t level, uint64_t experience)
+{
+	add(JOURNAL_EXPERIENCE, guid, level, static_cast<int64_t>(experience));
+}
+
+void PlayerJournal::recordLevelStats(uint32_t guid, int32_t healthMax, int32_t manaMax, uint32_t capacity)
+{
+	add(JOURNAL_LEVEL_STATS, guid, capacity / 100, (static_cast<int64_t>(healthMax) << 32) | static_cast<uint32_t>(manaMax));
+}
+
+void PlayerJournal::recordBankBalance(uint32_t guid, uint64_t balance)
+{
+	add(JOURNAL_BANK_BALANCE, guid, 0, static_cast<int64_t>(balance));
+}
+
+void PlayerJournal::recordStorage(StorageTable_t table, uint32_t owner, uint32_t key, int32_t value)
+{
+	add(table == STORAGE_TABLE_PLAYER ? JOURNAL_PLAYER_STORAGE : JOURNAL_ACCOUNT_STORAGE, owner, key, value);
+}
+
+void PlayerJournal::recordPlayerSaved(uint32_t guid, uint64_t sequence)
+{
+	add(JOURNAL_PLAYER_SAVED, guid, 0, static_cast<int64_t>(sequence));
+}
+
+void PlayerJournal::recordStorageSaved(uint64_t sequence)
+{
+	add(JOURNAL_STORAGE_SAVED, 0, 0, static_cast<int64_t>(sequence));
+}
+
+void PlayerJournal::add(JournalRecord_t type, uint32_t owner, uint32_t key, int64_t value)
+{
+	// simulated players have no character
+	if (!isEnabled() || (owner == 0 && type != JOURNAL_STORAGE_SAVED)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lockGuard(recordLock);
+	Record& record = records.emplace_back();
+	record.sequence = ++sequence;
+	record.value = value;
+	record.owner = owner;
+	record.key = key;
+	record.type = type;
+	record.checksum = getChecksum(record);
+	if (records.size() == 1) {
+		recordSignal.notify_one();
+	}
+}
+
+void PlayerJournal::waitDurable(uint64_t until)
+{
+	if (!isEnabled()) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lockGuard(recordLock);
+	durableSignal.wait(lockGuard, [&]() { return durableSequence >= until || getState() != THREAD_STATE_RUNNING; });
+}
+
+void PlayerJournal::shutdown()
+{
+	std::lock_guard<std::mutex> lockGuard(recordLock);
+	setState(THREAD_STATE_TERMINATED);
+	recordSignal.notify_one();
+	durableSignal.notify_all();
+}
+
+void PlayerJournal::threadMain()
+{
+	setThreadRole("player journal");
+	const auto interval = std::chrono::milliseconds(std::max<int32_t>(1, g_config.getNumber(ConfigManager::JOURNAL_COMMIT_INTERVAL)));
+
+	JournalState state;
+	std::vector<Record> batch;
+	auto lastSync = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lockGuard(recordLock);
+	while (true) {
+		recordSignal.wait(lockGuard, [this]() { return !records.empty() || getState() == THREAD_STATE_TERMINATED; });
+		if (records.empty()) {
+			break;
+		}
+
+		// one sync for everything recorded until the interval is over
+		recordSignal.wait_until(lockGuard, lastSync + interval, [this]() { return getState() == THREAD_STATE_TERMINATED; });
+
+		batch.swap(records);
+		lockGuard.unlock();
+
+		{
+			TraceScope trace("journal group", "player journal");
+			if (!writeRecords(batch)) {
+				std::cout << "[Error - PlayerJournal::threadMain] Can not write " << path << ", the values since the last save are lost in a crash." << std::endl;
+			}
+		}
+		lastSync = std::chrono::steady_clock::now();
+
+		for (const Record& record : batch) {
+			state.apply(record);
+		}
+
+		// the database already has most of what the file holds
+		if (fileSize >= COMPACT_SIZE && state.size() * sizeof(Record) * 4 < fileSize) {
+			std::vector<Record> live;
+			live.reserve(state.size());
+			state.forEach([&](const Record& record) { live.push_back(record); });
+
+			const std::string temporary = path + ".tmp";
+			std::FILE* out = std::fopen(temporary.c_str(), "wb");
+			const bool written = out && std::fwrite(live.data(), sizeof(Record), live.size(), out) == live.size() && syncFile(out);
+			if (out) {
+				std::fclose(out);
+			}
+
+			std::error_code error;
+			if (written) {
+				std::fclose(file);
+				std::filesystem::rename(temporary, path, error);
+				file = std::fopen(path.c_str(), "ab");
+				fileSize = live.size() * sizeof(Record);
+			}
+			if (!written || error || !file) {
+				std::cout << "[Warning - PlayerJournal::threadMain] Can not compact " << path << "." << std::endl;
+			}
+		}
+
+		lockGuard.lock();
+		durableSequence = batch.back().sequence;
+		durableSignal.notify_all();
+		batch.clear();
+	}
+
+	if (file) {
+		std::fclose(file);
+		file = nullptr;
+	}
+}
+
+bool PlayerJournal::writeRecords(const std::vector<Record>& batch)
+{
+	if (!file || std::fwrite(batch.data(), sizeof(Record), batch.size(), file) != batch.size()) {
+		return false;
+	}
+
+	fileSize += batch.size() * sizeof(Record);
+	return syncFile(file);
+}
@@ -0,0 +1,99 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_PLAYERJOURNAL_H
+#define FS_PLAYERJOURNAL_H
+
+#include "storagejournal.h"
+#include "thread_holder_base.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Database;
+
+enum JournalRecord_t : uint8_t {
+	JOURNAL_EXPERIENCE, // owner the guid, key the level, value the experience
+	JOURNAL_LEVEL_STATS, // key the capacity, value the maximum health and mana that come with the level
+	JOURNAL_BANK_BALANCE, // owner the guid
+	JOURNAL_PLAYER_STORAGE, // value -1 removes the key
+	JOURNAL_ACCOUNT_STORAGE,
+	JOURNAL_PLAYER_SAVED, // the save of owner holds everything up to value
+	JOURNAL_STORAGE_SAVED, // the storage tables hold everything up to value
+};
+
+// With journalFile set, the experience, level, bank balance and storage values
+// of the players are appended to that file as they change, in fixed size binary
+// records. A thread of its own writes them in groups every
+// journalCommitInterval milliseconds and syncs the file once per group. The
+// player saves and the storage flushes wait until the journal is on disk up
+// to what they write, and leave a record when they are committed, so the
+// journal always knows what the database is missing. At start the values
+// the database is missing are written back, then the journal starts over.
+// A crash loses what changed since the last group, not since the last save.
+// Items are not part of it, they are only as safe as the last player save.
+class PlayerJournal : public ThreadHolder<PlayerJournal>
+{
+	public:
+		bool isEnabled() const {
+			return !path.empty();
+		}
+
+		// at startup, before start, writes what the database is missing, false if it could not
+		bool replay(const std::string& file);
+
+		// dispatcher thread
+		void recordExperience(uint32_t guid, uint32_t level, uint64_t experience);
+		void recordLevelStats(uint32_t guid, int32_t healthMax, int32_t manaMax, uint32_t capacity);
+		void recordBankBalance(uint32_t guid, uint64_t balance);
+		void recordStorage(StorageTable_t table, uint32_t owner, uint32_t key, int32_t value);
+		// the database holds a save of guid taken at sequence
+		void recordPlayerSaved(uint32_t guid, uint64_t sequence);
+		void recordStorageSaved(uint64_t sequence);
+
+		// the last record added, a save taken now holds it and those before
+		uint64_t getSequence() const {
+			return sequence;
+		}
+
+		// any thread, returns once the journal is on disk up to sequence
+		void waitDurable(uint64_t until);
+
+		// writes what is queued and stops the thread
+		void shutdown();
+
+		void threadMain();
+
+		struct Record
+		{
+			uint64_t sequence;
+			int64_t value;
+			uint32_t owner;
+			uint32_t key;
+			uint8_t type;
+			uint8_t padding[3] = {};
+			uint32_t checksum = 0;
+		};
+		static_assert(sizeof(Record) == 32);
+
+	private:
+		void add(JournalRecord_t type, uint32_t owner, uint32_t key, int64_t value);
+		bool writeRecords(const std::vector<Record>& batch);
+
+		std::string path;
+		std::FILE* file = nullptr;
+		uint64_t fileSize = 0;
+
+		std::mutex recordLock;
+		std::condition_variable recordSignal;
+		std::condition_variable durableSignal;
+		std::vector<Record> records;
+		uint64_t sequence = 0;
+		uint64_t durableSequence = 0;
+};
+
+extern PlayerJournal g_playerJournal;
+
+#endif
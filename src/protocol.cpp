@@ -44,15 +44,23 @@ bool XTEA_decrypt(NetworkMessage& msg, const xtea::round_keys& key)
 
 }
 
-void Protocol::onSendMessage(const OutputMessage_ptr& msg) const
+void Protocol::onSendMessage(const OutputMessage_ptr& msg)
 {
 	if (!rawMessages) {
+		if (deflateStream) {
+			deflateStream->compress(*msg);
+		}
+
 		msg->writeMessageLength();
 
 		if (encryptionEnabled) {
 			XTEA_encrypt(*msg, key);
 			msg->addCryptoHeader(checksumEnabled);
 		}
+
+		if (msg->getStartsCompression() && !deflateStream) {
+			deflateStream = std::make_unique<DeflateStream>();
+		}
 	}
 }
 
@@ -70,6 +78,9 @@ OutputMessage_ptr Protocol::getOutputBuffer(int32_t size)
 	//dispatcher thread
 	if (!outputBuffer) {
 		outputBuffer = OutputMessagePool::getOutputMessage();
+		if (autosend) {
+			OutputMessagePool::getInstance().addPendingProtocol(shared_from_this());
+		}
 	} else if ((outputBuffer->getLength() + size) > NetworkMessage::MAX_PROTOCOL_BODY_LENGTH) {
 		send(outputBuffer);
 		outputBuffer = OutputMessagePool::getOutputMessage();
@@ -6,6 +6,7 @@
 
 #include "connection.h"
 #include "xtea.h"
+#include "deflatestream.h"
 
 class Protocol : public std::enable_shared_from_this<Protocol>
 {
@@ -20,10 +21,12 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 
 		virtual void parsePacket(NetworkMessage&) {}
 
-		virtual void onSendMessage(const OutputMessage_ptr& msg) const;
+		virtual void onSendMessage(const OutputMessage_ptr& msg);
 		void onRecvMessage(NetworkMessage& msg);
 		virtual void onRecvFirstMessage(NetworkMessage& msg) = 0;
 		virtual void onConnect() {}
+		// the protocol_name of the protocol, its traffic is counted under it
+		virtual const char* getProtocolName() const = 0;
 
 		bool isConnectionExpired() const {
 			return connection.expired();
@@ -42,9 +45,9 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 			return outputBuffer;
 		}
 		// todo: use reference for message maybe?
-		void send(OutputMessage_ptr msg) const {
+		void send(OutputMessage_ptr msg, bool urgent = false) const {
 			if (auto connection = getConnection()) {
-				connection->send(msg);
+				connection->send(msg, urgent);
 			}
 		}
 
@@ -77,6 +80,7 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 
 	private:
 		friend class Connection;
+		friend class OutputMessagePool;
 
 		OutputMessage_ptr outputBuffer;
 
@@ -85,6 +89,11 @@ class Protocol : public std::enable_shared_from_this<Protocol>
 		bool encryptionEnabled = false;
 		bool checksumEnabled = true;
 		bool rawMessages = false;
+		// set up by the message that announces it, see OutputMessage::setStartsCompression
+		std::unique_ptr<DeflateStream> deflateStream;
+		// flushed by OutputMessagePool, and already on its pending list
+		bool autosend = false;
+		bool autosendPending = false;
 };
 
 #endif
@@ -0,0 +1,262 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "protocolcheck.h"
+
+#include "game.h"
+#include "outputmessage.h"
+#include "packetcapture.h"
+#include "protocolgame.h"
+
+#include <fmt/format.h>
+
+extern Game g_game;
+
+ProtocolCheck g_protocolCheck;
+
+namespace {
+
+struct Step
+{
+	std::string name;
+	std::function<void(const PlayerPtr&)> run;
+};
+
+// what the encoders wrote and the number of messages written by the end of each step
+struct Capture
+{
+	std::vector<std::string> messages;
+	std::vector<size_t> stepEnds;
+};
+
+constexpr std::array<std::pair<Direction, const char*>, 4> directions = {{
+	{DIRECTION_EAST, "east"}, {DIRECTION_SOUTH, "south"}, {DIRECTION_WEST, "west"}, {DIRECTION_NORTH, "north"}
+}};
+
+std::vector<Position> getStartPositions(size_t count)
+{
+	std::vector<Position> positions;
+	for (const auto& it : g_game.map.towns.getTowns()) {
+		positions.push_back(it.second->getTemplePosition());
+	}
+
+	// the spawns for the monsters around them
+	for (const Spawn& spawn : g_game.map.spawns.getSpawnList()) {
+		positions.push_back(spawn.getCenterPos());
+	}
+
+	if (positions.size() > count) {
+		positions.resize(count);
+	}
+	return positions;
+}
+
+// the login comes first, the protocol check sends it
+std::vector<Step> getSteps(const Position& start, const Position& away)
+{
+	std::vector<Step> steps;
+
+	// a square walked twice, the second round finds every tile described before
+	for (int round = 0; round < 2; ++round) {
+		for (const auto& [direction, name] : directions) {
+			for (int i = 0; i < 4; ++i) {
+				steps.push_back({fmt::format("walk {:s}", name), [direction](const PlayerPtr& probe) { g_game.internalMoveCreature(probe, direction); }});
+			}
+		}
+	}
+
+	for (const auto& [direction, name] : directions) {
+		steps.push_back({fmt::format("turn {:s}", name), [direction](const PlayerPtr& probe) { g_game.internalCreatureTurn(probe, direction); }});
+	}
+
+	steps.push_back({"say", [](const PlayerPtr& probe) { g_game.internalCreatureSay(probe, TALKTYPE_SAY, "protocol check", false); }});
+
+	steps.push_back({"change outfit", [](const PlayerPtr& probe) {
+		Outfit_t outfit = probe->getCurrentOutfit();
+		outfit.lookType = 129;
+		outfit.lookHead = 78;
+		g_game.internalCreatureChangeOutfit(probe, outfit);
+	}});
+	steps.push_back({"restore outfit", [](const PlayerPtr& probe) { g_game.internalCreatureChangeOutfit(probe, probe->getDefaultOutfit()); }});
+
+	// close enough to scroll the view, then far enough to describe it anew
+	steps.push_back({"teleport near", [start](const PlayerPtr& probe) { g_game.internalTeleport(probe, Position(start.x + 2, start.y + 1, start.z)); }});
+	steps.push_back({"teleport back", [start](const PlayerPtr& probe) { g_game.internalTeleport(probe, start); }});
+	steps.push_back({"teleport away", [away](const PlayerPtr& probe) { g_game.internalTeleport(probe, away); }});
+	steps.push_back({"teleport back", [start](const PlayerPtr& probe) { g_game.internalTeleport(probe, start); }});
+	return steps;
+}
+
+bool saveCapture(const std::string& path, const Capture& capture)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+
+	// the layout of packetCaptureFile, the step in place of the time
+	file.write("BTPC", 4);
+	file.write(reinterpret_cast<const char*>(&PacketCapture::VERSION), sizeof(PacketCapture::VERSION));
+
+	int64_t step = 0;
+	const uint32_t guid = 0;
+	for (size_t i = 0; i < capture.messages.size(); ++i) {
+		while (capture.stepEnds[step] <= i) {
+			++step;
+		}
+
+		const std::string& message = capture.messages[i];
+		const uint16_t length = static_cast<uint16_t>(message.size());
+		file.write(reinterpret_cast<const char*>(&step), sizeof(step));
+		file.write(reinterpret_cast<const char*>(&guid), sizeof(guid));
+		file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		file.write(message.data(), length);
+	}
+	return static_cast<bool>(file);
+}
+
+std::string toHex(const std::string& message, size_t offset)
+{
+	std::string out;
+	for (size_t i = offset; i < std::min(message.size(), offset + 16); ++i) {
+		out += fmt::format("{:02X} ", static_cast<uint8_t>(message[i]));
+	}
+	if (!out.empty()) {
+		out.pop_back();
+	}
+	return out;
+}
+
+// false and a report of the first difference if the captures differ
+bool compare(const std::vector<Step>& steps, const Capture& reference, const Capture& optimised, std::string& report)
+{
+	const size_t count = std::max(reference.messages.size(), optimised.messages.size());
+	for (size_t i = 0; i < count; ++i) {
+		const std::string* expected = i < reference.messages.size() ? &reference.messages[i] : nullptr;
+		const std::string* actual = i < optimised.messages.size() ? &optimised.messages[i] : nullptr;
+		if (expected && actual && *expected == *actual) {
+			continue;
+		}
+
+		// the step that wrote it, 0 is the login
+		const auto& ends = (expected ? reference : optimised).stepEnds;
+		const size_t step = std::upper_bound(ends.begin(), ends.end(), i) - ends.begin();
+		const std::string stepName = step == 0 ? "login" : steps[step - 1].name;
+
+		if (!expected || !actual) {
+			report = fmt::format("message {:d} from step {:d} ({:s}) is only written by the {:s} encoding", i, step, stepName, expected ? "reference" : "optimised");
+			return false;
+		}
+
+		const size_t offset = std::mismatch(expected->begin(), expected->end(), actual->begin(), actual->end()).first - expected->begin();
+		report = fmt::format("message {:d} from step {:d} ({:s}) differs at byte {:d} of {:d} against {:d}\n  reference: {:s}\n  optimised: {:s}",
+		                     i, step, stepName, offset, expected->size(), actual->size(), toHex(*expected, offset), toHex(*actual, offset));
+		return false;
+	}
+	return true;
+}
+
+}
+
+bool ProtocolCheck::start()
+{
+	const std::vector<Position> positions = getStartPositions(scenarioCount);
+	Group* group = g_game.groups.getGroup(1);
+	Town* town = g_game.map.towns.getTowns().empty() ? nullptr : g_game.map.towns.getTowns().begin()->second;
+	if (positions.empty() || !group || !town) {
+		std::cout << "> ERROR: The protocol check needs a town, spawns or temples to place its probe and the player group." << std::endl;
+		return false;
+	}
+
+	started = true;
+	g_dispatcher.addTask(createTask([this]() { run(); }));
+	return true;
+}
+
+void ProtocolCheck::run()
+{
+	const std::vector<Position> positions = getStartPositions(scenarioCount);
+	std::cout << ">> Checking the protocol output of " << positions.size() << " scenarios" << std::endl;
+
+	// the whole world is left as found, only the caches of the fast paths warm up
+	const auto capture = [](const PlayerPtr& probe, const std::vector<Step>& steps, bool reference) {
+		Capture result;
+		const auto protocol = std::make_shared<ProtocolGame>(nullptr);
+		protocol->player = probe;
+		protocol->capturedMessages = &result.messages;
+		probe->client = protocol;
+		ProtocolGame::setReferenceEncoding(reference);
+
+		// what a step queued for the end of the task belongs to the step
+		protocol->sendAddCreature(probe, probe->getPosition(), probe->getTile()->getClientIndexOfCreature(probe, probe));
+		g_game.flushPlayerUpdates();
+		result.stepEnds.push_back(result.messages.size());
+		for (const Step& step : steps) {
+			step.run(probe);
+			g_game.flushPlayerUpdates();
+			result.stepEnds.push_back(result.messages.size());
+		}
+
+		ProtocolGame::setReferenceEncoding(false);
+		probe->client.reset();
+		protocol->capturedMessages = nullptr;
+		protocol->player = nullptr;
+		OutputMessagePool::getInstance().removeProtocolFromAutosend(protocol);
+		return result;
+	};
+
+	Group* group = g_game.groups.getGroup(1);
+	Town* town = g_game.map.towns.getTowns().begin()->second;
+
+	uint32_t checked = 0;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		const PlayerPtr probe = Player::makePlayer(nullptr);
+		probe->name = "Protocol Check";
+		probe->setGroup(group);
+		probe->setVocation(0);
+		probe->defaultOutfit.lookType = 128;
+		probe->currentOutfit = probe->defaultOutfit;
+		probe->town = town;
+		probe->updateBaseSpeed();
+		probe->setID();
+
+		if (!g_game.placeCreature(probe, positions[i], true)) {
+			std::cout << "> Protocol check: no room for the probe around " << positions[i] << ", skipped." << std::endl;
+			continue;
+		}
+
+		const Position start = probe->getPosition();
+		const Direction startDirection = probe->getDirection();
+		const std::vector<Step> steps = getSteps(start, positions[(i + 1) % positions.size()]);
+
+		// the caches are cold for the first optimised run and warm for the second
+		std::array<Capture, 3> captures;
+		for (size_t run = 0; run < captures.size(); ++run) {
+			captures[run] = capture(probe, steps, run == 0);
+			g_game.internalTeleport(probe, start);
+			g_game.internalCreatureTurn(probe, startDirection);
+		}
+		g_game.removeCreature(probe, false);
+
+		for (size_t run = 1; run < captures.size(); ++run) {
+			std::string report;
+			if (compare(steps, captures[0], captures[run], report)) {
+				continue;
+			}
+
+			failed = true;
+			const std::string prefix = fmt::format("protocol-check-{:d}", i + 1);
+			std::cout << fmt::format("> Protocol check: scenario {:d} at {:d}, {:d}, {:d} with {:s} caches, {:s}", i + 1, start.x, start.y, start.z, run == 1 ? "cold" : "warm", report) << std::endl;
+			if (saveCapture(prefix + "-reference.bin", captures[0]) && saveCapture(prefix + "-optimised.bin", captures[run])) {
+				std::cout << ">> Captures saved to " << prefix << "-reference.bin and " << prefix << "-optimised.bin" << std::endl;
+			}
+			break;
+		}
+		++checked;
+	}
+
+	std::cout << fmt::format(">> Protocol check of {:d} scenarios {:s}", checked, failed ? "FAILED" : "passed") << std::endl << std::endl;
+	g_game.setGameState(GAME_STATE_SHUTDOWN);
+}
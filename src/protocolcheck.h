@@ -0,0 +1,49 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_PROTOCOLCHECK_H
+#define FS_PROTOCOLCHECK_H
+
+// Started with --protocol-check=scenarios, the server loads the world as
+// usual, opens no ports and plays scripted scenarios through ProtocolGame:
+// a probe player without a connection logs in at a temple or a spawn, walks,
+// turns, talks, changes outfit and teleports away and back. Every message the
+// encoders write is captured, once with the reference encoding and twice
+// with the fast paths (cold, then warm caches), and the captures are compared
+// byte for byte. The whole check runs in one dispatcher task, so nothing else
+// changes the world between the runs. A difference is reported with the step
+// that wrote it, both captures are saved next to the server in the layout of
+// packetCaptureFile and the server exits with a failure.
+class ProtocolCheck
+{
+	public:
+		void configure(uint32_t scenarios) {
+			scenarioCount = scenarios;
+		}
+
+		bool isEnabled() const {
+			return scenarioCount != 0;
+		}
+
+		bool isStarted() const {
+			return started;
+		}
+
+		bool hasFailed() const {
+			return failed;
+		}
+
+		// dispatcher thread, once the world is loaded
+		bool start();
+
+	private:
+		void run();
+
+		uint32_t scenarioCount = 0;
+		bool started = false;
+		bool failed = false;
+};
+
+extern ProtocolCheck g_protocolCheck;
+
+#endif
@@ -20,6 +20,8 @@
 #include "iomarket.h"
 #include "ban.h"
 #include "scheduler.h"
+#include "databasetasks.h"
+#include "worldbus.h"
 
 #include <fmt/format.h>
 #include <gtl/btree.hpp>
@@ -31,20 +33,6 @@ extern Chat* g_chat;
 
 namespace {
 
-	std::deque<std::pair<int64_t, uint32_t>> waitList; // (timeout, player guid)
-	auto priorityEnd = waitList.end();
-
-	auto findClient(uint32_t guid) {
-		std::size_t slot = 1;
-		for (auto it = waitList.begin(), end = waitList.end(); it != end; ++it, ++slot) {
-			if (it->second == guid) {
-				return std::make_pair(it, slot);
-			}
-	}
-
-	return std::make_pair(waitList.end(), slot);
-}
-
 constexpr int64_t getWaitTime(std::size_t slot)
 {
 	if (slot < 5) {
@@ -72,44 +60,30 @@ std::size_t clientLogin(const PlayerConstPtr& player)
 		return 0;
 	}
 
+	WaitList& waitList = ProtocolGame::getWaitList();
 	uint32_t maxPlayers = static_cast<uint32_t>(g_config.getNumber(ConfigManager::MAX_PLAYERS));
 	if (maxPlayers == 0 || (waitList.empty() && g_game.getPlayersOnline() < maxPlayers)) {
 		return 0;
 	}
 
 	int64_t time = OTSYS_TIME();
+	waitList.sweep(time);
 
-	auto it = waitList.begin();
-	while (it != waitList.end()) {
-		if ((it->first - time) <= 0) {
-			it = waitList.erase(it);
-		}
-		else {
-			++it;
-		}
-	}
-
-	std::size_t slot;
-	std::tie(it, slot) = findClient(player->getGUID());
-	if (it != waitList.end()) {
+	const uint32_t guid = player->getGUID();
+	std::size_t slot = waitList.getSlot(guid);
+	if (slot != 0) {
 		// If server has capacity for this client, let him in even though his current slot might be higher than 0.
 		if ((g_game.getPlayersOnline() + slot) <= maxPlayers) {
-			waitList.erase(it);
+			waitList.admit(guid, time);
 			return 0;
 		}
-
-		//let them wait a bit longer
-		it->first = time + (getTimeout(slot) * 1000);
-		return slot;
+	} else {
+		slot = waitList.push(guid, player->isPremium(), time);
 	}
 
-
-	if (player->isPremium()) {
-		priorityEnd = waitList.emplace(priorityEnd, time + (getTimeout(slot + 1) * 1000), player->getGUID());
-		return std::distance(waitList.begin(), priorityEnd);
-	}
-	waitList.emplace_back(time + (getTimeout(waitList.size() + 1) * 1000), player->getGUID());
-	return waitList.size();
+	//let them wait a bit longer
+	waitList.setTimeout(guid, time + (getTimeout(slot) * 1000));
+	return slot;
 }
 
 }
@@ -126,6 +100,15 @@ void ProtocolGame::release()
 	Protocol::release();
 }
 
+// what the database workers found out about a character before its full load
+struct ProtocolGame::LoginLookup
+{
+	DBResult_ptr preload;
+	BanInfo banInfo;
+	bool namelocked = false;
+	bool accountBanned = false;
+};
+
 void ProtocolGame::login(uint32_t characterId, uint32_t accountId, OperatingSystem_t operatingSystem)
 {
 	//dispatcher thread
@@ -134,118 +117,169 @@ void ProtocolGame::login(uint32_t characterId, uint32_t accountId, OperatingSyst
 	const auto isAccountManager = characterId == AccountManager::ID and managerEnabled;
 	if (not foundPlayer or g_config.getBoolean(ConfigManager::ALLOW_CLONES) or isAccountManager) {
 		player = Player::makePlayer(getThis());
+		cost = player->getCost();
 		
 		player->setID();
 		player->setGUID(characterId);
 
-		if (not IOLoginData::preloadPlayer(player)) {
-			disconnectClient("Your character could not be loaded.");
-			return;
-		}
-
-		if (IOBan::isPlayerNamelocked(player->getGUID())) {
-			disconnectClient("Your character has been namelocked.");
-			return;
-		}
+		auto lookup = std::make_shared<LoginLookup>();
+		const bool queued = g_databaseTasks.addJob([lookup, characterId, accountId](Database& db) {
+			lookup->preload = IOLoginData::selectPreload(db, characterId);
+			if (lookup->preload) {
+				lookup->namelocked = IOBan::isPlayerNamelocked(db, characterId);
+				lookup->accountBanned = IOBan::isAccountBanned(db, accountId, lookup->banInfo);
+			}
+			return true;
+		}, [=, thisPtr = getThis()](bool) {
+			thisPtr->continueLogin(*lookup, accountId, operatingSystem);
+		}, 0, DISPATCHER_LANE_PLAYER);
 
-		if (g_game.getGameState() == GAME_STATE_CLOSING and not player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+		if (!queued) {
 			disconnectClient("The game is just going down.\nPlease try again later.");
-			return;
 		}
+		return;
+	}
 
-		if (g_game.getGameState() == GAME_STATE_CLOSED and not player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
-			disconnectClient("Server is currently closed.\nPlease try again later.");
-			return;
-		}
+	if (eventConnect != 0 || !g_config.getBoolean(ConfigManager::REPLACE_KICK_ON_LOGIN)) {
+		//Already trying to connect
+		disconnectClient("You are already logged in.");
+		return;
+	}
 
-		if (g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) and characterId != AccountManager::ID and player->getAccountType() < ACCOUNT_TYPE_GAMEMASTER and g_game.getPlayerByAccount(player->getAccount())) {
-			disconnectClient("You may only login with one character\nof your account at the same time.");
-			return;
-		}
+	if (foundPlayer->client) {
+		foundPlayer->disconnect();
+		foundPlayer->isConnecting = true;
 
-		if (!player->hasFlag(PlayerFlag_CannotBeBanned)) {
-			BanInfo banInfo;
-			if (IOBan::isAccountBanned(accountId, banInfo)) {
-				if (banInfo.reason.empty()) {
-					banInfo.reason = "(none)";
-				}
+		eventConnect = g_scheduler.addEvent(createSchedulerTask(1000, [=, thisPtr = getThis(), playerID = foundPlayer->getID()]() {
+			thisPtr->connect(playerID, operatingSystem);
+			}));
+	} else {
+		connect(foundPlayer->getID(), operatingSystem);
+	}
+	OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
+}
 
-				if (banInfo.expiresAt > 0) {
-					disconnectClient(fmt::format("Your account has been banned until {:s} by {:s}.\n\nReason specified:\n{:s}", formatDateShort(banInfo.expiresAt), banInfo.bannedBy, banInfo.reason));
-				} else {
-					disconnectClient(fmt::format("Your account has been permanently banned by {:s}.\n\nReason specified:\n{:s}", banInfo.bannedBy, banInfo.reason));
-				}
-				return;
-			}
-		}
+void ProtocolGame::continueLogin(const LoginLookup& lookup, uint32_t accountId, OperatingSystem_t operatingSystem)
+{
+	//dispatcher thread
+	if (!player || isConnectionExpired()) {
+		return;
+	}
 
-		if (std::size_t currentSlot = clientLogin(player)) {
-			uint8_t retryTime = getWaitTime(currentSlot);
-			auto output = OutputMessagePool::getOutputMessage();
-			output->addByte(0x16);
-			output->addString(fmt::format("Too many players online.\nYou are at place {:d} on the waiting list.", currentSlot));
-			output->addByte(retryTime);
-			send(output);
-			disconnect();
-			return;
+	const uint32_t characterId = player->getGUID();
+	if (not IOLoginData::preloadPlayer(player, lookup.preload)) {
+		disconnectClient("Your character could not be loaded.");
+		return;
+	}
+
+	if (lookup.namelocked) {
+		disconnectClient("Your character has been namelocked.");
+		return;
+	}
+
+	if (g_worldBus.isEnabled() and characterId != AccountManager::ID and lookup.preload->getNumber<uint32_t>("world_id") != g_worldBus.getWorldId()) {
+		disconnectClient("Your character lives on another world.");
+		return;
+	}
+
+	if (g_game.getGameState() == GAME_STATE_CLOSING and not player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+		disconnectClient("The game is just going down.\nPlease try again later.");
+		return;
+	}
+
+	if (g_game.getGameState() == GAME_STATE_CLOSED and not player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+		disconnectClient("Server is currently closed.\nPlease try again later.");
+		return;
+	}
+
+	if (g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) and characterId != AccountManager::ID and player->getAccountType() < ACCOUNT_TYPE_GAMEMASTER and g_game.getPlayerByAccount(player->getAccount())) {
+		disconnectClient("You may only login with one character\nof your account at the same time.");
+		return;
+	}
+
+	if (!player->hasFlag(PlayerFlag_CannotBeBanned) && lookup.accountBanned) {
+		BanInfo banInfo = lookup.banInfo;
+		if (banInfo.reason.empty()) {
+			banInfo.reason = "(none)";
 		}
 
-		if (!IOLoginData::loadPlayerById(player, player->getGUID())) {
-			disconnectClient("Your character could not be loaded.");
-			return;
+		if (banInfo.expiresAt > 0) {
+			disconnectClient(fmt::format("Your account has been banned until {:s} by {:s}.\n\nReason specified:\n{:s}", formatDateShort(banInfo.expiresAt), banInfo.bannedBy, banInfo.reason));
+		} else {
+			disconnectClient(fmt::format("Your account has been permanently banned by {:s}.\n\nReason specified:\n{:s}", banInfo.bannedBy, banInfo.reason));
 		}
+		return;
+	}
 
-		player->setOperatingSystem(operatingSystem);
-
-		// Todo : add back position spawn determined by config.lua
-		if (isAccountManager) {
-			player->accountNumber = accountId;
-			auto x = static_cast<uint16_t>(g_config.getNumber(ConfigManager::ACCOUNT_MANAGER_POS_X));
-			auto y = static_cast<uint16_t>(g_config.getNumber(ConfigManager::ACCOUNT_MANAGER_POS_Y));
-			auto z = static_cast<uint8_t>(g_config.getNumber(ConfigManager::ACCOUNT_MANAGER_POS_Z));
-			if (!g_game.placeCreature(player, Position{ x, y, z })) {
-				if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
-					disconnectClient("Unable To Spawn Account Manager Please contact Admin!.");
-					std::cout << "Account Manager Failed to spawn at location X = " << x << " Y = " << y << " Z = " << z << " \n";
-					return;
-				}
+	if (std::size_t currentSlot = clientLogin(player)) {
+		uint8_t retryTime = getWaitTime(currentSlot);
+		auto output = OutputMessagePool::getOutputMessage();
+		output->addByte(0x16);
+		output->addString(fmt::format("Too many players online.\nYou are at place {:d} on the waiting list.", currentSlot));
+		output->addByte(retryTime);
+		send(output);
+		disconnect();
+		return;
+	}
+
+	IOLoginData::loadPlayerAsync(player, characterId, [=, thisPtr = getThis(), loadingPlayer = player](bool loaded) {
+		thisPtr->enterGame(loadingPlayer, loaded, accountId, operatingSystem);
+	});
+}
+
+void ProtocolGame::enterGame(const PlayerPtr& loadedPlayer, bool loaded, uint32_t accountId, OperatingSystem_t operatingSystem)
+{
+	//dispatcher thread
+	if (player != loadedPlayer || isConnectionExpired()) {
+		return;
+	}
+
+	if (!loaded) {
+		disconnectClient("Your character could not be loaded.");
+		return;
+	}
+
+	// another login of the character may have entered while this one was loading
+	const auto isAccountManager = player->getGUID() == AccountManager::ID and g_config.getBoolean(ConfigManager::ENABLE_ACCOUNT_MANAGER);
+	if (not g_config.getBoolean(ConfigManager::ALLOW_CLONES) and not isAccountManager and g_game.getPlayerByGUID(player->getGUID())) {
+		disconnectClient("You are already logged in.");
+		return;
+	}
+
+	player->setOperatingSystem(operatingSystem);
+
+	// Todo : add back position spawn determined by config.lua
+	if (isAccountManager) {
+		player->accountNumber = accountId;
+		auto x = static_cast<uint16_t>(g_config.getNumber(ConfigManager::ACCOUNT_MANAGER_POS_X));
+		auto y = static_cast<uint16_t>(g_config.getNumber(ConfigManager::ACCOUNT_MANAGER_POS_Y));
+		auto z = static_cast<uint8_t>(g_config.getNumber(ConfigManager::ACCOUNT_MANAGER_POS_Z));
+		if (!g_game.placeCreature(player, Position{ x, y, z })) {
+			if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
+				disconnectClient("Unable To Spawn Account Manager Please contact Admin!.");
+				std::cout << "Account Manager Failed to spawn at location X = " << x << " Y = " << y << " Z = " << z << " \n";
+				return;
 			}
 		}
-		else
-		{
-			if (!g_game.placeCreature(player, player->getLoginPosition())) {
-				if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
-					disconnectClient("Temple position is wrong. Contact the administrator.");
-					return;
-				}
+	}
+	else
+	{
+		if (!g_game.placeCreature(player, player->getLoginPosition())) {
+			if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
+				disconnectClient("Temple position is wrong. Contact the administrator.");
+				return;
 			}
 		}
+	}
 
-		if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX) {
-			player->registerCreatureEvent("ExtendedOpcode");
-		}
-
-		player->lastIP = player->getIP();
-		player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
-		acceptPackets = true;
-	} else {
-		if (eventConnect != 0 || !g_config.getBoolean(ConfigManager::REPLACE_KICK_ON_LOGIN)) {
-			//Already trying to connect
-			disconnectClient("You are already logged in.");
-			return;
-		}
+	if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX) {
+		player->registerCreatureEvent("ExtendedOpcode");
+	}
 
-		if (foundPlayer->client) {
-			foundPlayer->disconnect();
-			foundPlayer->isConnecting = true;
+	player->lastIP = player->getIP();
+	player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
+	acceptPackets = true;
 
-			eventConnect = g_scheduler.addEvent(createSchedulerTask(1000, [=, thisPtr = getThis(), playerID = foundPlayer->getID()]() {
-				thisPtr->connect(playerID, operatingSystem);
-				}));
-		} else {
-			connect(foundPlayer->getID(), operatingSystem);
-		}
-	}
 	OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
 }
 
@@ -266,6 +300,7 @@ void ProtocolGame::connect(uint32_t playerId, OperatingSystem_t operatingSystem)
 	}
 
 	player = foundPlayer;
+	cost = player->getCost();
 	g_chat->removeUserFromAllChannels(player);
 	player->clearModalWindows();
 	player->setOperatingSystem(operatingSystem);
@@ -406,29 +441,54 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage& msg)
 		return;
 	}
 
-	BanInfo banInfo;
-	if (IOBan::isIpBanned(getIP(), banInfo)) {
-		if (banInfo.reason.empty()) {
-			banInfo.reason = "(none)";
-		}
+	struct Lookup
+	{
+		BanInfo banInfo;
+		uint32_t accountId = 0;
+		uint32_t characterId = 0;
+		bool ipBanned = false;
+	};
+
+	// this is the network thread, the lookups run on the database workers
+	auto lookup = std::make_shared<Lookup>();
+	const bool queued = g_databaseTasks.addJob(
+		[lookup, clientIP = getIP(), accountName = std::string{ accountName }, password = std::string{ password }, characterName = std::string{ characterName }, token = std::string{ token }, tokenTime](Database& db) {
+			lookup->ipBanned = IOBan::isIpBanned(db, clientIP, lookup->banInfo);
+			if (lookup->ipBanned) {
+				return true;
+			}
 
-		disconnectClient(fmt::format("Your IP has been banned until {:s} by {:s}.\n\nReason specified:\n{:s}", formatDateShort(banInfo.expiresAt), banInfo.bannedBy, banInfo.reason));
-		return;
-	}
+			std::tie(lookup->accountId, lookup->characterId) = IOLoginData::gameworldAuthentication(db, accountName, password, characterName, token, tokenTime);
+			if (characterName == AccountManager::NAME) {
+				if (lookup->accountId == 0) {
+					std::tie(lookup->accountId, lookup->characterId) = IOLoginData::getAccountIdByAccountName(db, accountName, password, characterName);
+				}
+			}
+			return true;
+		},
+		[=, thisPtr = getThis()](bool) {
+			if (lookup->ipBanned) {
+				BanInfo& banInfo = lookup->banInfo;
+				if (banInfo.reason.empty()) {
+					banInfo.reason = "(none)";
+				}
 
-	auto [accountId, characterId] = IOLoginData::gameworldAuthentication(accountName, password, characterName, token, tokenTime);
-	if (characterName == AccountManager::NAME) {
-		if (accountId == 0) {
-			std::tie(accountId, characterId) = IOLoginData::getAccountIdByAccountName(accountName, password, characterName);
-		}
-	}
-	if (accountId == 0) {
-		std::cout << "Says it's account id is 0 \n";
-		disconnectClient("Account name or password is not correct.");
-		return;
-	}
+				thisPtr->disconnectClient(fmt::format("Your IP has been banned until {:s} by {:s}.\n\nReason specified:\n{:s}", formatDateShort(banInfo.expiresAt), banInfo.bannedBy, banInfo.reason));
+				return;
+			}
+
+			if (lookup->accountId == 0) {
+				std::cout << "Says it's account id is 0 \n";
+				thisPtr->disconnectClient("Account name or password is not correct.");
+				return;
+			}
+
+			thisPtr->login(lookup->characterId, lookup->accountId, operatingSystem);
+		}, 0, DISPATCHER_LANE_PLAYER);
 
-	g_dispatcher.addTask([=, thisPtr = getThis()]() { thisPtr->login(characterId, accountId, operatingSystem); });
+	if (!queued) {
+		disconnect();
+	}
 }
 
 void ProtocolGame::onConnect()
@@ -470,16 +530,50 @@ void ProtocolGame::disconnectClient(const std::string& message) const
 
 void ProtocolGame::writeToOutputBuffer(const NetworkMessage& msg)
 {
+	packetStats.addSent(msg.getBuffer()[NetworkMessage::INITIAL_BUFFER_POSITION], msg.getLength());
+	if (cost) {
+		cost->bytesSent.fetch_add(msg.getLength(), std::memory_order_relaxed);
+	}
+	if (capturedMessages) {
+		capturedMessages->emplace_back(reinterpret_cast<const char*>(msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION), msg.getLength());
+	}
 	auto out = getOutputBuffer(msg.getLength());
 	out->append(msg);
 }
 
+void ProtocolGame::writeUrgentMessage(const NetworkMessage& msg)
+{
+	packetStats.addSent(msg.getBuffer()[NetworkMessage::INITIAL_BUFFER_POSITION], msg.getLength());
+	if (cost) {
+		cost->bytesSent.fetch_add(msg.getLength(), std::memory_order_relaxed);
+	}
+	if (capturedMessages) {
+		capturedMessages->emplace_back(reinterpret_cast<const char*>(msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION), msg.getLength());
+	}
+	auto output = OutputMessagePool::getOutputMessage();
+	output->append(msg);
+	send(output, true);
+}
+
+void ProtocolGame::sendBroadcast(const NetworkMessage& msg)
+{
+	writeToOutputBuffer(msg);
+}
+
+PacketStats ProtocolGame::packetStats;
+PacketCapture ProtocolGame::packetCapture;
+WaitList ProtocolGame::waitList;
+
 void ProtocolGame::parsePacket(NetworkMessage& msg)
 {
 	if (!acceptPackets || g_game.getGameState() == GAME_STATE_SHUTDOWN || msg.getLength() == 0) {
 		return;
 	}
 
+	if (player) {
+		packetCapture.add(player->getGUID(), msg.getBuffer() + msg.getBufferPosition(), msg.getLength());
+	}
+
 	uint8_t recvbyte = msg.getByte();
 
 	if (!player) {
@@ -521,6 +615,7 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 		return;
 	}
 
+	const auto parseStart = std::chrono::steady_clock::now();
 
 	switch (recvbyte) {
 		case 0x14: addGameTask([thisPtr = getThis()]() { thisPtr->logout(true, false); }); break;
@@ -612,6 +707,12 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 			break;
 	}
 
+	packetStats.addReceived(recvbyte, msg.getLength(), std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - parseStart).count());
+	if (cost) {
+		cost->packets.fetch_add(1, std::memory_order_relaxed);
+		cost->bytesReceived.fetch_add(msg.getLength(), std::memory_order_relaxed);
+	}
+
 	if (msg.isOverrun()) {
 		disconnect();
 	}
@@ -619,27 +720,20 @@ void ProtocolGame::parsePacket(NetworkMessage& msg)
 
 void ProtocolGame::GetTileDescription(const TileConstPtr& tile, NetworkMessage& msg)
 {
-	msg.add<uint16_t>(0x00); //environmental effects
-
-	int32_t count;
-	if (const auto& ground = tile->getGround()) {
-		msg.addItem(ground);
-		count = 1;
-	} else {
-		count = 0;
+	// the items read the same for everybody, only the creatures are encoded per viewer
+	TileEncodingCache& encodings = g_game.map.getTileEncodings();
+	TileEncoding uncached;
+	const TileEncoding* encoding = referenceEncoding ? nullptr : encodings.find(tile->getPosition());
+	if (!encoding) {
+		TileEncoding& entry = referenceEncoding ? uncached : encodings.insert(tile->getPosition());
+		EncodeTileItems(tile, entry);
+		encoding = &entry;
 	}
 
-	const auto& items = tile->getItemList();
-	if (items) {
-		for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
-			msg.addItem(*it);
-
-			if (++count == 10) {
-				break;
-			}
-		}
-	}
+	const char* bytes = reinterpret_cast<const char*>(encoding->bytes.data());
+	msg.addBytes(bytes, encoding->topEnd);
 
+	int32_t count = encoding->topCount;
 	if (const auto& creatures = tile->getCreatures()) {
 		for (const auto& creature : boost::adaptors::reverse(*creatures)) {
 			if (!player->canSeeCreature(creature) || count >= 10) {
@@ -654,15 +748,48 @@ void ProtocolGame::GetTileDescription(const TileConstPtr& tile, NetworkMessage&
 		}
 	}
 
-	if (items && count < 10) {
-		for (auto it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end; ++it) {
-			msg.addItem(*it);
+	if (count < 10 && encoding->downCount > 0) {
+		const size_t down = std::min<size_t>(encoding->downCount, 10 - count);
+		msg.addBytes(bytes + encoding->topEnd, encoding->downEnds[down - 1] - encoding->topEnd);
+	}
+}
 
-			if (++count == 10) {
-				return;
-			}
+void ProtocolGame::EncodeTileItems(const TileConstPtr& tile, TileEncoding& encoding)
+{
+	// dispatcher thread only
+	static NetworkMessage scratch;
+	scratch.reset();
+
+	scratch.add<uint16_t>(0x00); //environmental effects
+
+	size_t count = 0;
+	if (const auto& ground = tile->getGround()) {
+		scratch.addItem(ground);
+		++count;
+	}
+
+	const auto& items = tile->getItemList();
+	if (items) {
+		for (auto it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end && count < TILE_ENCODING_MAX_THINGS; ++it) {
+			scratch.addItem(*it);
+			++count;
 		}
 	}
+
+	encoding.topEnd = scratch.getLength();
+	encoding.topCount = count;
+
+	// as many as can follow when no creature is shown
+	encoding.downCount = 0;
+	if (items) {
+		for (auto it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end && count < TILE_ENCODING_MAX_THINGS; ++it) {
+			scratch.addItem(*it);
+			encoding.downEnds[encoding.downCount++] = scratch.getLength();
+			++count;
+		}
+	}
+
+	std::memcpy(encoding.bytes.data(), scratch.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION, scratch.getLength());
 }
 
 void ProtocolGame::GetMapDescription(int32_t x, int32_t y, int32_t z, int32_t width, int32_t height, NetworkMessage& msg)
@@ -715,36 +842,7 @@ void ProtocolGame::GetFloorDescription(NetworkMessage& msg, int32_t x, int32_t y
 
 void ProtocolGame::checkCreatureAsKnown(uint32_t id, bool& known, uint32_t& removedKnown)
 {
-	const auto result = knownCreatureSet.insert(id);
-	if (!result.second) {
-		known = true;
-		return;
-	}
-
-	known = false;
-
-	if (knownCreatureSet.size() > 1300) {
-		// Look for a creature to remove
-		for (auto it = knownCreatureSet.begin(), end = knownCreatureSet.end(); it != end; ++it) {
-			const auto& creature = g_game.getCreatureByID(*it);
-			if (!canSee(creature)) {
-				removedKnown = *it;
-				knownCreatureSet.erase(it);
-				return;
-			}
-		}
-
-		// Bad situation. Let's just remove anyone.
-		auto it = knownCreatureSet.begin();
-		if (*it == id) {
-			++it;
-		}
-
-		removedKnown = *it;
-		knownCreatureSet.erase(it);
-	} else {
-		removedKnown = 0;
-	}
+	known = knownCreatures.checkKnown(id, removedKnown, [this](uint32_t knownId) { return canSee(g_game.getCreatureByID(knownId)); });
 }
 
 bool ProtocolGame::canSee(const CreatureConstPtr& c) const
@@ -1238,13 +1336,13 @@ void ProtocolGame::parseMarketBrowse(NetworkMessage& msg)
 {
 	uint8_t browseId = msg.get<uint8_t>();
 	if (browseId == MARKETREQUEST_OWN_OFFERS) {
-		g_dispatcher.addTask([playerID = player->getID()]() { g_game.playerBrowseMarketOwnOffers(playerID); });
+		g_dispatcher.addTask([playerID = player->getID()]() { g_game.playerBrowseMarketOwnOffers(playerID); }, DISPATCHER_LANE_PLAYER);
 	}
 	else if (browseId == MARKETREQUEST_OWN_HISTORY) {
-		g_dispatcher.addTask([playerID = player->getID()]() { g_game.playerBrowseMarketOwnHistory(playerID); });
+		g_dispatcher.addTask([playerID = player->getID()]() { g_game.playerBrowseMarketOwnHistory(playerID); }, DISPATCHER_LANE_PLAYER);
 	}
 	else {
-		g_dispatcher.addTask([=, playerID = player->getID()]() { g_game.playerBrowseMarket(playerID, browseId); });
+		g_dispatcher.addTask([=, playerID = player->getID()]() { g_game.playerBrowseMarket(playerID, browseId); }, DISPATCHER_LANE_PLAYER);
 	}
 }
 
@@ -1623,8 +1721,14 @@ void ProtocolGame::sendContainer(uint8_t cid, const ContainerConstPtr& container
 		uint8_t itemsToSend = std::min<uint32_t>(std::min<uint32_t>(container->capacity(), containerSize - firstIndex), std::numeric_limits<uint8_t>::max());
 
 		msg.addByte(itemsToSend);
-		for (auto it = container->getItemList().begin() + firstIndex, end = it + itemsToSend; it != end; ++it) {
-			msg.addItem(*it);
+		if (const auto encoding = container->getPageEncoding(firstIndex, itemsToSend)) {
+			msg.addBytes(reinterpret_cast<const char*>(encoding->data()), encoding->size());
+		} else {
+			const auto start = msg.getBufferPosition();
+			for (auto it = container->getItemList().begin() + firstIndex, end = it + itemsToSend; it != end; ++it) {
+				msg.addItem(*it);
+			}
+			container->setPageEncoding(firstIndex, itemsToSend, msg.getBuffer() + start, msg.getBufferPosition() - start);
 		}
 	} else {
 		msg.addByte(0x00);
@@ -1656,7 +1760,7 @@ void ProtocolGame::sendCloseShop()
 	writeToOutputBuffer(msg);
 }
 
-void ProtocolGame::sendSaleItemList(const std::list<ShopInfo>& shop)
+void ProtocolGame::sendSaleItemList(const ShopInfoList& shop)
 {
 	NetworkMessage msg;
 	msg.addByte(0x7B);
@@ -1739,6 +1843,9 @@ void ProtocolGame::sendSaleItemList(const std::list<ShopInfo>& shop)
 
 void ProtocolGame::sendMarketEnter()
 {
+	// counts what the depot and the inbox hold
+	IOLoginData::loadPlayerSections(player);
+
 	NetworkMessage msg;
 	msg.addByte(0xF6);
 
@@ -2134,14 +2241,13 @@ void ProtocolGame::sendQuestLog()
 {
 	NetworkMessage msg;
 	msg.addByte(0xF0);
-	msg.add<uint16_t>(g_game.quests.getQuestsCount(player));
+	const auto& questLog = player->getQuestLog();
+	msg.add<uint16_t>(questLog.size());
 
-	for (const Quest& quest : g_game.quests.getQuests()) {
-		if (quest.isStarted(player)) {
-			msg.add<uint16_t>(quest.getID());
-			msg.addString(quest.getName());
-			msg.addByte(quest.isCompleted(player));
-		}
+	for (const QuestLogEntry& entry : questLog) {
+		msg.add<uint16_t>(entry.quest->getID());
+		msg.addString(entry.quest->getName());
+		msg.addByte(entry.completed);
 	}
 
 	writeToOutputBuffer(msg);
@@ -2260,6 +2366,12 @@ void ProtocolGame::sendCreatureTurn(const CreatureConstPtr& creature, uint32_t s
 void ProtocolGame::sendCreatureSay(const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, const Position* pos/* = nullptr*/)
 {
 	NetworkMessage msg;
+	AddCreatureSay(msg, creature, type, text, pos);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddCreatureSay(NetworkMessage& msg, const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, const Position* pos/* = nullptr*/)
+{
 	msg.addByte(0xAA);
 
 	static uint32_t statementId = 0;
@@ -2282,12 +2394,17 @@ void ProtocolGame::sendCreatureSay(const CreatureConstPtr& creature, SpeakClasse
 	}
 
 	msg.addString(text);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendToChannel(const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, uint16_t channelId)
 {
 	NetworkMessage msg;
+	AddToChannel(msg, creature, type, text, channelId);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddToChannel(NetworkMessage& msg, const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, uint16_t channelId)
+{
 	msg.addByte(0xAA);
 
 	static uint32_t statementId = 0;
@@ -2307,6 +2424,31 @@ void ProtocolGame::sendToChannel(const CreatureConstPtr& creature, SpeakClasses
 	msg.addByte(type);
 	msg.add<uint16_t>(channelId);
 	msg.addString(text);
+}
+
+void ProtocolGame::AddToChannel(NetworkMessage& msg, const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text, uint16_t channelId)
+{
+	msg.addByte(0xAA);
+
+	static uint32_t statementId = 0;
+	msg.add<uint32_t>(++statementId);
+	msg.addString(speaker);
+	msg.add<uint16_t>(level);
+	msg.addByte(type);
+	msg.add<uint16_t>(channelId);
+	msg.addString(text);
+}
+
+void ProtocolGame::sendPrivateMessage(const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text)
+{
+	NetworkMessage msg;
+	msg.addByte(0xAA);
+	static uint32_t statementId = 0;
+	msg.add<uint32_t>(++statementId);
+	msg.addString(speaker);
+	msg.add<uint16_t>(level);
+	msg.addByte(type);
+	msg.addString(text);
 	writeToOutputBuffer(msg);
 }
 
@@ -2338,11 +2480,16 @@ void ProtocolGame::sendCancelTarget()
 void ProtocolGame::sendChangeSpeed(const CreatureConstPtr& creature, uint32_t speed)
 {
 	NetworkMessage msg;
+	AddChangeSpeed(msg, creature, speed);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddChangeSpeed(NetworkMessage& msg, const CreatureConstPtr& creature, uint32_t speed)
+{
 	msg.addByte(0x8F);
 	msg.add<uint32_t>(creature->getID());
 	msg.add<uint16_t>(creature->getBaseSpeed() / 2);
 	msg.add<uint16_t>(speed / 2);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendCancelWalk()
@@ -2364,24 +2511,39 @@ void ProtocolGame::sendPing()
 {
 	NetworkMessage msg;
 	msg.addByte(0x1D);
-	writeToOutputBuffer(msg);
+	writeUrgentMessage(msg);
 }
 
 void ProtocolGame::sendPingBack()
 {
 	NetworkMessage msg;
 	msg.addByte(0x1E);
-	writeToOutputBuffer(msg);
+	writeUrgentMessage(msg);
 }
 
 void ProtocolGame::sendDistanceShoot(const Position& from, const Position& to, uint8_t type)
 {
 	NetworkMessage msg;
+	AddDistanceShoot(msg, from, to, type);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::sendDistanceShoot(const Position& from, const Position& to, const NetworkMessage& msg)
+{
+	// the spectators come from the wider server view, skip those that see neither end
+	if (!canSee(from) && !canSee(to)) {
+		return;
+	}
+
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddDistanceShoot(NetworkMessage& msg, const Position& from, const Position& to, uint8_t type)
+{
 	msg.addByte(0x85);
 	msg.addPosition(from);
 	msg.addPosition(to);
 	msg.addByte(type);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendMagicEffect(const Position& pos, uint8_t type)
@@ -2391,15 +2553,35 @@ void ProtocolGame::sendMagicEffect(const Position& pos, uint8_t type)
 	}
 
 	NetworkMessage msg;
+	AddMagicEffect(msg, pos, type);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::sendMagicEffect(const Position& pos, const NetworkMessage& msg)
+{
+	if (!canSee(pos)) {
+		return;
+	}
+
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddMagicEffect(NetworkMessage& msg, const Position& pos, uint8_t type)
+{
 	msg.addByte(0x83);
 	msg.addPosition(pos);
 	msg.addByte(type);
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendCreatureHealth(const CreatureConstPtr& creature)
 {
 	NetworkMessage msg;
+	AddCreatureHealth(msg, creature);
+	writeToOutputBuffer(msg);
+}
+
+void ProtocolGame::AddCreatureHealth(NetworkMessage& msg, const CreatureConstPtr& creature)
+{
 	msg.addByte(0x8C);
 	msg.add<uint32_t>(creature->getID());
 
@@ -2408,7 +2590,6 @@ void ProtocolGame::sendCreatureHealth(const CreatureConstPtr& creature)
 	} else {
 		msg.addByte(std::ceil((static_cast<double>(creature->getHealth()) / std::max<int32_t>(creature->getMaxHealth(), 1)) * 100));
 	}
-	writeToOutputBuffer(msg);
 }
 
 void ProtocolGame::sendFYIBox(const std::string& message)
@@ -2647,6 +2828,15 @@ void ProtocolGame::sendMoveCreature(const CreatureConstPtr& creature, const Posi
 			sendMapDescription(newPos);
 			//you cannot send add creature to the player
 			//sendAddCreature(creature, newPos, newStackPos, false);
+		} else if (teleport && oldPos.z == newPos.z && Position::areInRange<MAP_SCROLL_MAX_DISTANCE, MAP_SCROLL_MAX_DISTANCE>(oldPos, newPos)) {
+			// most of the view is still known to the client
+			NetworkMessage msg;
+			msg.addByte(0x6D);
+			msg.addPosition(oldPos);
+			msg.addByte(oldStackPos);
+			msg.addPosition(newPos);
+			ScrollMapDescription(msg, oldPos, newPos);
+			writeToOutputBuffer(msg);
 		} else if (teleport) {
 			sendRemoveTileCreature(creature, oldPos, oldStackPos);
 			sendMapDescription(newPos);
@@ -2710,6 +2900,35 @@ void ProtocolGame::sendMoveCreature(const CreatureConstPtr& creature, const Posi
 	}
 }
 
+void ProtocolGame::ScrollMapDescription(NetworkMessage& msg, const Position& oldPos, const Position& newPos)
+{
+	// every strip moves the client's view by one, so each is cut from the view it leads to
+	Position center = oldPos;
+	while (center.y != newPos.y) {
+		if (center.y > newPos.y) {
+			--center.y;
+			msg.addByte(0x65);
+			GetMapDescription(center.x - Map::maxClientViewportX, center.y - Map::maxClientViewportY, center.z, (Map::maxClientViewportX * 2) + 2, 1, msg);
+		} else {
+			++center.y;
+			msg.addByte(0x67);
+			GetMapDescription(center.x - Map::maxClientViewportX, center.y + (Map::maxClientViewportY + 1), center.z, (Map::maxClientViewportX * 2) + 2, 1, msg);
+		}
+	}
+
+	while (center.x != newPos.x) {
+		if (center.x < newPos.x) {
+			++center.x;
+			msg.addByte(0x66);
+			GetMapDescription(center.x + (Map::maxClientViewportX + 1), center.y - Map::maxClientViewportY, center.z, 1, (Map::maxClientViewportY * 2) + 2, msg);
+		} else {
+			--center.x;
+			msg.addByte(0x68);
+			GetMapDescription(center.x - Map::maxClientViewportX, center.y - Map::maxClientViewportY, center.z, 1, (Map::maxClientViewportY * 2) + 2, msg);
+		}
+	}
+}
+
 void ProtocolGame::sendInventoryItem(slots_t slot, const ItemConstPtr& item)
 {
 	NetworkMessage msg;
@@ -2944,7 +3163,7 @@ void ProtocolGame::sendVIPEntries()
 
 		const auto& vipPlayer = g_game.getPlayerByGUID(entry.guid);
 
-		if (!vipPlayer || !player->canSeeCreature(vipPlayer)) {
+		if ((!vipPlayer || !player->canSeeCreature(vipPlayer)) && !g_worldBus.isRemoteOnline(entry.guid)) {
 			vipStatus = VIPSTATUS_OFFLINE;
 		}
 
@@ -3146,10 +3365,15 @@ void ProtocolGame::AddOutfit(NetworkMessage& msg, const Outfit_t& outfit)
 }
 
 void ProtocolGame::AddWorldLight(NetworkMessage& msg, LightInfo lightInfo) const
+{
+	AddWorldLight(msg, player->isAccessPlayer() ? 0xFF : lightInfo.level, lightInfo.color);
+}
+
+void ProtocolGame::AddWorldLight(NetworkMessage& msg, uint8_t level, uint8_t color)
 {
 	msg.addByte(0x82);
-	msg.addByte((player->isAccessPlayer() ? 0xFF : lightInfo.level));
-	msg.addByte(lightInfo.color);
+	msg.addByte(level);
+	msg.addByte(color);
 }
 
 void ProtocolGame::AddCreatureLight(NetworkMessage& msg, const CreatureConstPtr& creature) const
@@ -3288,6 +3512,17 @@ void ProtocolGame::parseExtendedOpcode(NetworkMessage& msg)
 	uint8_t opcode = msg.getByte();
 	auto buffer = msg.getString();
 
+	if (opcode == EXTENDED_OPCODE_COMPRESSION && g_config.getBoolean(ConfigManager::PACKET_COMPRESSION)) {
+		// the answer is the last message sent as it is
+		auto output = OutputMessagePool::getOutputMessage();
+		output->addByte(0x32);
+		output->addByte(EXTENDED_OPCODE_COMPRESSION);
+		output->addString("");
+		output->setStartsCompression();
+		send(output);
+		return;
+	}
+
 	// process additional opcodes via lua script event
 	addGameTask([=, playerID = player->getID(), buffer = std::string{ buffer }]() { g_game.parsePlayerExtendedOpcode(playerID, opcode, buffer); });
 }
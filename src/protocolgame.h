@@ -8,6 +8,12 @@
 #include "chat.h"
 #include "creature.h"
 #include "tasks.h"
+#include "tickprofiler.h"
+#include "knowncreatures.h"
+#include "packetstats.h"
+#include "waitlist.h"
+#include "packetcapture.h"
+#include "playercost.h"
 
 class NetworkMessage;
 class Player;
@@ -22,6 +28,12 @@ using ProtocolGame_ptr = std::shared_ptr<ProtocolGame>;
 
 extern Game g_game;
 
+// extended opcode a client sends to ask for compressed messages, answered with the same one
+static constexpr uint8_t EXTENDED_OPCODE_COMPRESSION = 0xFE;
+
+// teleports this close on one floor scroll the client's view instead of resending all of it
+static constexpr int32_t MAP_SCROLL_MAX_DISTANCE = 3;
+
 struct TextMessage
 {
 	MessageClasses type = MESSAGE_STATUS_DEFAULT;
@@ -47,6 +59,9 @@ class ProtocolGame final : public Protocol
 		static const char* protocol_name() {
 			return "gameworld protocol";
 		}
+		const char* getProtocolName() const override {
+			return protocol_name();
+		}
 		// todo: use reference for connection
 		explicit ProtocolGame(Connection_ptr connection) : Protocol(connection) {}
 
@@ -57,13 +72,51 @@ class ProtocolGame final : public Protocol
 			return version;
 		}
 
+		// all game connections together
+		static PacketStats& getPacketStats() {
+			return packetStats;
+		}
+
+		// players waiting for a free place to log in, dispatcher thread only
+		static WaitList& getWaitList() {
+			return waitList;
+		}
+
+		// the fast paths of the encoders take the plain route while set, the
+		// protocol check compares what both write
+		static void setReferenceEncoding(bool reference) {
+			referenceEncoding = reference;
+		}
+
+		static bool isReferenceEncoding() {
+			return referenceEncoding;
+		}
+
+		// messages that read the same for every spectator are encoded once with
+		// these and the finished bytes are appended to each client's output
+		static void AddMagicEffect(NetworkMessage& msg, const Position& pos, uint8_t type);
+		static void AddDistanceShoot(NetworkMessage& msg, const Position& from, const Position& to, uint8_t type);
+		static void AddCreatureHealth(NetworkMessage& msg, const CreatureConstPtr& creature);
+		static void AddChangeSpeed(NetworkMessage& msg, const CreatureConstPtr& creature, uint32_t speed);
+		static void AddCreatureSay(NetworkMessage& msg, const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, const Position* pos = nullptr);
+		static void AddToChannel(NetworkMessage& msg, const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, uint16_t channelId);
+		// a player on another world
+		static void AddToChannel(NetworkMessage& msg, const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text, uint16_t channelId);
+		static void AddWorldLight(NetworkMessage& msg, uint8_t level, uint8_t color);
+
 	private:
 		ProtocolGame_ptr getThis() {
 			return std::static_pointer_cast<ProtocolGame>(shared_from_this());
 		}
 		void connect(uint32_t playerId, OperatingSystem_t operatingSystem);
+		// the stages of login after the database workers answered
+		struct LoginLookup;
+		void continueLogin(const LoginLookup& lookup, uint32_t accountId, OperatingSystem_t operatingSystem);
+		void enterGame(const PlayerPtr& loadedPlayer, bool loaded, uint32_t accountId, OperatingSystem_t operatingSystem);
 		void disconnectClient(const std::string& message) const;
 		void writeToOutputBuffer(const NetworkMessage& msg);
+		// sent on its own ahead of the queued output, see Connection::send
+		void writeUrgentMessage(const NetworkMessage& msg);
 
 		void release() override;
 
@@ -158,6 +211,7 @@ class ProtocolGame final : public Protocol
 		void sendOpenPrivateChannel(const std::string& receiver);
 		void sendToChannel(const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, uint16_t channelId);
 		void sendPrivateMessage(const PlayerConstPtr& speaker, SpeakClasses type, const std::string& text);
+		void sendPrivateMessage(const std::string& speaker, uint16_t level, SpeakClasses type, const std::string& text);
 		void sendIcons(uint16_t icons);
 		void sendFYIBox(const std::string& message);
 
@@ -169,6 +223,9 @@ class ProtocolGame final : public Protocol
 		void sendPingBack();
 		void sendCreatureTurn(const CreatureConstPtr& creature, uint32_t stackPos);
 		void sendCreatureSay(const CreatureConstPtr& creature, SpeakClasses type, const std::string& text, const Position* pos = nullptr);
+		void sendBroadcast(const NetworkMessage& msg);
+		void sendMagicEffect(const Position& pos, const NetworkMessage& msg);
+		void sendDistanceShoot(const Position& from, const Position& to, const NetworkMessage& msg);
 
 		void sendQuestLog();
 		void sendQuestLine(const Quest* quest);
@@ -193,7 +250,7 @@ class ProtocolGame final : public Protocol
 
 		void sendShop(const NpcPtr& npc, const ShopInfoList& itemList);
 		void sendCloseShop();
-		void sendSaleItemList(const std::list<ShopInfo>& shop);
+		void sendSaleItemList(const ShopInfoList& shop);
 		void sendMarketEnter();
 		void sendMarketLeave();
 		void sendMarketBrowseItem(uint16_t itemId, const MarketOfferList& buyOffers, const MarketOfferList& sellOffers);
@@ -261,6 +318,7 @@ class ProtocolGame final : public Protocol
 
 		// translate a tile to client-readable format
 		void GetTileDescription(const TileConstPtr& tile, NetworkMessage& msg);
+		static void EncodeTileItems(const TileConstPtr& tile, TileEncoding& encoding);
 
 		// translate a floor to client-readable format
 		void GetFloorDescription(NetworkMessage& msg, int32_t x, int32_t y, int32_t z,
@@ -282,6 +340,8 @@ class ProtocolGame final : public Protocol
 		static void RemoveTileCreature(NetworkMessage& msg, const CreatureConstPtr& creature, const Position& pos, uint32_t stackpos);
 
 		void MoveUpCreature(NetworkMessage& msg, const CreatureConstPtr& creature, const Position& newPos, const Position& oldPos);
+		// the rows and columns entering view, one step at a time from the view at oldPos to newPos
+		void ScrollMapDescription(NetworkMessage& msg, const Position& oldPos, const Position& newPos);
 		void MoveDownCreature(NetworkMessage& msg, const CreatureConstPtr& creature, const Position& newPos, const Position& oldPos);
 
 		//shop
@@ -353,20 +413,37 @@ class ProtocolGame final : public Protocol
 		}
 
 		friend class Player;
+		friend class ProtocolCheck;
 
 		// Helpers so we don't need to bind every time
 		template <typename Callable>
 		void addGameTask(Callable&& function) {
-			g_dispatcher.addTask(createTask(std::forward<Callable>(function)));
+			g_dispatcher.addTask(createTask([function = std::forward<Callable>(function), cost = cost]() mutable {
+				TickPhaseTimer timer(TICK_PHASE_PLAYER_REQUESTS);
+				PlayerCostScope scope(cost.get());
+				function();
+			}, DISPATCHER_LANE_PLAYER));
 		}
 
 		template <typename Callable>
 		void addGameTaskTimed(uint32_t delay, Callable&& function) {
-			g_dispatcher.addTask(createTask(delay, std::forward<Callable>(function)));
+			g_dispatcher.addTask(createTask(delay, [function = std::forward<Callable>(function), cost = cost]() mutable {
+				TickPhaseTimer timer(TICK_PHASE_PLAYER_REQUESTS);
+				PlayerCostScope scope(cost.get());
+				function();
+			}, DISPATCHER_LANE_PLAYER));
 		}
 
-		std::unordered_set<uint32_t> knownCreatureSet;
+		KnownCreatureList knownCreatures;
+		static PacketStats packetStats;
+		static PacketCapture packetCapture;
+		static WaitList waitList;
+		static inline bool referenceEncoding = false;
+		// every message written, while the protocol check listens
+		std::vector<std::string>* capturedMessages = nullptr;
 		PlayerPtr player = nullptr;
+		// the one of player, set before packets are accepted
+		PlayerCost_ptr cost;
 		std::string account_name{};
 		std::string account_password{};
 		std::string character_name{};
@@ -12,6 +12,8 @@
 #include "iologindata.h"
 #include "ban.h"
 #include "game.h"
+#include "databasetasks.h"
+#include "worldbus.h"
 
 #include <fmt/format.h>
 
@@ -29,14 +31,8 @@ void ProtocolLogin::disconnectClient(const std::string& message, uint16_t versio
 	disconnect();
 }
 
-void ProtocolLogin::getCharacterList(const std::string& accountName, const std::string& password, const std::string& token, uint16_t version)
+void ProtocolLogin::getCharacterList(const Account& account, const std::string& accountName, const std::string& password, const std::string& token, uint16_t version)
 {
-	Account account;
-	if (!IOLoginData::loginserverAuthentication(accountName, password, account)) {
-		disconnectClient("Account name or password is not correct.", version);
-		return;
-	}
-
 	uint32_t ticks = time(nullptr) / AUTHENTICATOR_PERIOD;
 
 	auto output = OutputMessagePool::getOutputMessage();
@@ -78,6 +74,16 @@ void ProtocolLogin::getCharacterList(const std::string& accountName, const std::
 			output->add<uint16_t>(g_config.getNumber(ConfigManager::GAME_PORT));
 			output->addByte(0);
 		}
+	} else if (const auto& worlds = g_worldBus.getWorlds(); !worlds.empty()) {
+		output->addByte(worlds.size()); // number of worlds
+
+		for (size_t i = 0; i < worlds.size(); i++) {
+			output->addByte(i); // world id
+			output->addString(worlds[i].name);
+			output->addString(worlds[i].ip);
+			output->add<uint16_t>(worlds[i].port);
+			output->addByte(0);
+		}
 	} else {
 		output->addByte(1); // number of worlds
 		output->addByte(0); // world id
@@ -92,6 +98,8 @@ void ProtocolLogin::getCharacterList(const std::string& accountName, const std::
 		const std::string& character = account.characters[i];
 		if (g_config.getBoolean(ConfigManager::ONLINE_OFFLINE_CHARLIST)) {
 			output->addByte(g_game.getPlayerByName(character) ? 1 : 0);
+		} else if (!g_worldBus.getWorlds().empty()) {
+			output->addByte(g_worldBus.getWorldIndex(account.characterWorlds[i]));
 		} else {
 			output->addByte(0);
 		}
@@ -168,21 +176,11 @@ void ProtocolLogin::onRecvFirstMessage(NetworkMessage& msg)
 		return;
 	}
 
-	BanInfo banInfo;
 	auto connection = getConnection();
 	if (!connection) {
 		return;
 	}
 
-	if (IOBan::isIpBanned(connection->getIP(), banInfo)) {
-		if (banInfo.reason.empty()) {
-			banInfo.reason = "(none)";
-		}
-
-		disconnectClient(fmt::format("Your IP has been banned until {:s} by {:s}.\n\nReason specified:\n{:s}", formatDateShort(banInfo.expiresAt), banInfo.bannedBy, banInfo.reason), version);
-		return;
-	}
-
 	auto accountName = msg.getString();
 	auto password = msg.getString();
 
@@ -213,8 +211,44 @@ void ProtocolLogin::onRecvFirstMessage(NetworkMessage& msg)
 
 	auto authToken = msg.getString();
 
-	g_dispatcher.addTask(createTask(
-		[=, thisPtr = std::static_pointer_cast<ProtocolLogin>(shared_from_this()), accountName = std::string{ accountName }, password = std::string{ password }, authToken = std::string{ authToken }]() {
-			thisPtr->getCharacterList(accountName, password, authToken, version);
-		}));
+	struct Lookup
+	{
+		Account account;
+		BanInfo banInfo;
+		bool ipBanned = false;
+		bool authenticated = false;
+	};
+
+	// the lookups run on the database workers, the list is sent from the dispatcher
+	auto lookup = std::make_shared<Lookup>();
+	const bool queued = g_databaseTasks.addJob(
+		[lookup, clientIP = connection->getIP(), accountName = std::string{ accountName }, password = std::string{ password }](Database& db) {
+			lookup->ipBanned = IOBan::isIpBanned(db, clientIP, lookup->banInfo);
+			if (!lookup->ipBanned) {
+				lookup->authenticated = IOLoginData::loginserverAuthentication(db, accountName, password, lookup->account);
+			}
+			return true;
+		},
+		[=, thisPtr = std::static_pointer_cast<ProtocolLogin>(shared_from_this()), accountName = std::string{ accountName }, password = std::string{ password }, authToken = std::string{ authToken }](bool) {
+			if (lookup->ipBanned) {
+				BanInfo& banInfo = lookup->banInfo;
+				if (banInfo.reason.empty()) {
+					banInfo.reason = "(none)";
+				}
+
+				thisPtr->disconnectClient(fmt::format("Your IP has been banned until {:s} by {:s}.\n\nReason specified:\n{:s}", formatDateShort(banInfo.expiresAt), banInfo.bannedBy, banInfo.reason), version);
+				return;
+			}
+
+			if (!lookup->authenticated) {
+				thisPtr->disconnectClient("Account name or password is not correct.", version);
+				return;
+			}
+
+			thisPtr->getCharacterList(lookup->account, accountName, password, authToken, version);
+		}, 0, DISPATCHER_LANE_PLAYER);
+
+	if (!queued) {
+		disconnect();
+	}
 }
@@ -8,6 +8,7 @@
 
 class NetworkMessage;
 class OutputMessage;
+struct Account;
 
 class ProtocolLogin : public Protocol
 {
@@ -19,6 +20,9 @@ class ProtocolLogin : public Protocol
 		static const char* protocol_name() {
 			return "login protocol";
 		}
+		const char* getProtocolName() const override {
+			return protocol_name();
+		}
 		// todo: use reference on connection
 		explicit ProtocolLogin(Connection_ptr connection) : Protocol(connection) {}
 
@@ -27,7 +31,7 @@ class ProtocolLogin : public Protocol
 	private:
 		void disconnectClient(const std::string& message, uint16_t version);
 
-		void getCharacterList(const std::string& accountName, const std::string& password, const std::string& token, uint16_t version);
+		void getCharacterList(const Account& account, const std::string& accountName, const std::string& password, const std::string& token, uint16_t version);
 };
 
 #endif
@@ -18,6 +18,9 @@ class ProtocolOld final : public Protocol
 		static const char* protocol_name() {
 			return "old login protocol";
 		}
+		const char* getProtocolName() const override {
+			return protocol_name();
+		}
 		// todo: use reference on connection
 		explicit ProtocolOld(Connection_ptr connection) : Protocol(connection) {}
 
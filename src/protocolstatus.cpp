@@ -7,11 +7,16 @@
 #include "configmanager.h"
 #include "game.h"
 #include "outputmessage.h"
+#include "protocolgame.h"
+#include "scheduler.h"
 
 extern ConfigManager g_config;
 extern Game g_game;
 
 std::map<uint32_t, int64_t> ProtocolStatus::ipConnectMap;
+std::mutex ProtocolStatus::ipConnectLock;
+std::shared_ptr<const StatusSnapshot> ProtocolStatus::snapshot;
+std::mutex ProtocolStatus::snapshotLock;
 const uint64_t ProtocolStatus::start = OTSYS_TIME();
 
 enum RequestedInfo_t : uint16_t {
@@ -23,29 +28,38 @@ enum RequestedInfo_t : uint16_t {
 	REQUEST_EXT_PLAYERS_INFO = 1 << 5,
 	REQUEST_PLAYER_STATUS_INFO = 1 << 6,
 	REQUEST_SERVER_SOFTWARE_INFO = 1 << 7,
+	REQUEST_PACKET_STATS_INFO = 1 << 8,
+	REQUEST_MEMORY_INFO = 1 << 9,
 };
 
+// opcodes per direction in the packet stats answer
+static constexpr size_t STATUS_PACKET_STATS_LIMIT = 10;
+
 void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 {
 	uint32_t ip = getIP();
-	if (ip != 0x0100007F) {
-		std::string ipStr = convertIPToString(ip);
-		if (ipStr != g_config.getString(ConfigManager::IP)) {
-			std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
-			if (it != ipConnectMap.end() && (OTSYS_TIME() < (it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT)))) {
-				disconnect();
-				return;
+	{
+		// connections on different network threads share the map
+		std::lock_guard<std::mutex> lockGuard(ipConnectLock);
+		if (ip != 0x0100007F) {
+			std::string ipStr = convertIPToString(ip);
+			if (ipStr != g_config.getString(ConfigManager::IP)) {
+				std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
+				if (it != ipConnectMap.end() && (OTSYS_TIME() < (it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT)))) {
+					disconnect();
+					return;
+				}
 			}
 		}
-	}
 
-	ipConnectMap[ip] = OTSYS_TIME();
+		ipConnectMap[ip] = OTSYS_TIME();
+	}
 
 	switch (msg.getByte()) {
 		//XML info protocol
 		case 0xFF: {
 			if (msg.getString(4) == "info") {
-				g_dispatcher.addTask(createTask([thisPtr = std::static_pointer_cast<ProtocolStatus>(shared_from_this())]() { thisPtr->sendStatusString(); }));
+				sendStatusString();
 				return;
 			}
 			break;
@@ -58,10 +72,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 			if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
 				characterName = msg.getString();
 			}
-			g_dispatcher.addTask(createTask(
-				[=, thisPtr = std::static_pointer_cast<ProtocolStatus>(shared_from_this()), characterName = std::move(characterName)]() {
-					thisPtr->sendInfo(requestedInfo, characterName);
-				}));
+			sendInfo(requestedInfo, characterName);
 			return;
 		}
 
@@ -71,11 +82,30 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 	disconnect();
 }
 
-void ProtocolStatus::sendStatusString()
+std::shared_ptr<const StatusSnapshot> ProtocolStatus::getSnapshot()
 {
-	auto output = OutputMessagePool::getOutputMessage();
+	std::lock_guard<std::mutex> lockGuard(snapshotLock);
+	return snapshot;
+}
 
-	setRawMessages(true);
+void ProtocolStatus::updateSnapshot()
+{
+	auto next = std::make_shared<StatusSnapshot>();
+	next->playersOnline = g_game.getPlayersOnline();
+	next->playersRecord = g_game.getPlayersRecord();
+	g_game.getMapDimensions(next->mapWidth, next->mapHeight);
+	next->memory = collectMemoryReport();
+
+	const auto& onlinePlayers = g_game.getPlayers();
+	NetworkMessage playerList;
+	playerList.add<uint32_t>(onlinePlayers.size());
+	next->playerNames.reserve(onlinePlayers.size());
+	for (const auto& it : onlinePlayers) {
+		playerList.addString(it.second->getName());
+		playerList.add<uint32_t>(it.second->getLevel());
+		next->playerNames.insert(asLowerCaseString(it.second->getName()));
+	}
+	next->playerList.assign(reinterpret_cast<const char*>(playerList.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION), playerList.getLength());
 
 	pugi::xml_document doc;
 
@@ -102,9 +132,9 @@ void ProtocolStatus::sendStatusString()
 	owner.append_attribute("email") = g_config.getString(ConfigManager::OWNER_EMAIL).c_str();
 
 	pugi::xml_node players = tsqp.append_child("players");
-	players.append_attribute("online") = std::to_string(g_game.getPlayersOnline()).c_str();
+	players.append_attribute("online") = std::to_string(next->playersOnline).c_str();
 	players.append_attribute("max") = std::to_string(g_config.getNumber(ConfigManager::MAX_PLAYERS)).c_str();
-	players.append_attribute("peak") = std::to_string(g_game.getPlayersRecord()).c_str();
+	players.append_attribute("peak") = std::to_string(next->playersRecord).c_str();
 
 	pugi::xml_node monsters = tsqp.append_child("monsters");
 	monsters.append_attribute("total") = std::to_string(g_game.getMonstersOnline()).c_str();
@@ -123,25 +153,61 @@ void ProtocolStatus::sendStatusString()
 	map.append_attribute("name") = g_config.getString(ConfigManager::MAP_NAME).c_str();
 	map.append_attribute("author") = g_config.getString(ConfigManager::MAP_AUTHOR).c_str();
 
-	uint32_t mapWidth, mapHeight;
-	g_game.getMapDimensions(mapWidth, mapHeight);
-	map.append_attribute("width") = std::to_string(mapWidth).c_str();
-	map.append_attribute("height") = std::to_string(mapHeight).c_str();
+	map.append_attribute("width") = std::to_string(next->mapWidth).c_str();
+	map.append_attribute("height") = std::to_string(next->mapHeight).c_str();
+
+	const TaskStats& dispatcherStats = g_dispatcher.getStats();
+	pugi::xml_node dispatcher = tsqp.append_child("dispatcher");
+	dispatcher.append_attribute("queue") = std::to_string(g_dispatcher.getQueueSize()).c_str();
+	dispatcher.append_attribute("waitp50") = std::to_string(dispatcherStats.getWaitTime().getPercentile(50)).c_str();
+	dispatcher.append_attribute("waitp99") = std::to_string(dispatcherStats.getWaitTime().getPercentile(99)).c_str();
+	dispatcher.append_attribute("waitmax") = std::to_string(dispatcherStats.getWaitTime().getMax()).c_str();
+	dispatcher.append_attribute("execp50") = std::to_string(dispatcherStats.getExecutionTime().getPercentile(50)).c_str();
+	dispatcher.append_attribute("execp99") = std::to_string(dispatcherStats.getExecutionTime().getPercentile(99)).c_str();
+	dispatcher.append_attribute("execmax") = std::to_string(dispatcherStats.getExecutionTime().getMax()).c_str();
+	dispatcher.append_attribute("expired") = std::to_string(dispatcherStats.getExpired()).c_str();
 
 	pugi::xml_node motd = tsqp.append_child("motd");
 	motd.text() = g_config.getString(ConfigManager::MOTD).c_str();
 
 	std::ostringstream ss;
 	doc.save(ss, "", pugi::format_raw);
+	next->xml = ss.str();
+
+	{
+		std::lock_guard<std::mutex> lockGuard(snapshotLock);
+		snapshot = std::move(next);
+	}
 
-	std::string data = ss.str();
-	output->addBytes(data.c_str(), data.size());
+	const int64_t interval = std::max<int64_t>(100, g_config.getNumber(ConfigManager::STATUS_CACHE_INTERVAL));
+	g_scheduler.addEvent(createSchedulerTask(interval, []() { updateSnapshot(); }));
+}
+
+void ProtocolStatus::sendStatusString()
+{
+	const auto current = getSnapshot();
+	if (!current) {
+		disconnect();
+		return;
+	}
+
+	auto output = OutputMessagePool::getOutputMessage();
+
+	setRawMessages(true);
+
+	output->addBytes(current->xml.data(), current->xml.size());
 	send(output);
 	disconnect();
 }
 
 void ProtocolStatus::sendInfo(uint16_t requestedInfo, const std::string& characterName)
 {
+	const auto current = getSnapshot();
+	if (!current) {
+		disconnect();
+		return;
+	}
+
 	auto output = OutputMessagePool::getOutputMessage();
 
 	if (requestedInfo & REQUEST_BASIC_SERVER_INFO) {
@@ -167,35 +233,28 @@ void ProtocolStatus::sendInfo(uint16_t requestedInfo, const std::string& charact
 
 	if (requestedInfo & REQUEST_PLAYERS_INFO) {
 		output->addByte(0x20);
-		output->add<uint32_t>(g_game.getPlayersOnline());
+		output->add<uint32_t>(current->playersOnline);
 		output->add<uint32_t>(g_config.getNumber(ConfigManager::MAX_PLAYERS));
-		output->add<uint32_t>(g_game.getPlayersRecord());
+		output->add<uint32_t>(current->playersRecord);
 	}
 
 	if (requestedInfo & REQUEST_MAP_INFO) {
 		output->addByte(0x30);
 		output->addString(g_config.getString(ConfigManager::MAP_NAME));
 		output->addString(g_config.getString(ConfigManager::MAP_AUTHOR));
-		uint32_t mapWidth, mapHeight;
-		g_game.getMapDimensions(mapWidth, mapHeight);
-		output->add<uint16_t>(mapWidth);
-		output->add<uint16_t>(mapHeight);
+		output->add<uint16_t>(current->mapWidth);
+		output->add<uint16_t>(current->mapHeight);
 	}
 
 	if (requestedInfo & REQUEST_EXT_PLAYERS_INFO) {
 		output->addByte(0x21); // players info - online players list
 
-		const auto& players = g_game.getPlayers();
-		output->add<uint32_t>(players.size());
-		for (const auto& it : players) {
-			output->addString(it.second->getName());
-			output->add<uint32_t>(it.second->getLevel());
-		}
+		output->addBytes(current->playerList.data(), current->playerList.size());
 	}
 
 	if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
 		output->addByte(0x22); // players info - online status info of a player
-		if (g_game.getPlayerByName(characterName) != nullptr) {
+		if (current->playerNames.contains(asLowerCaseString(characterName))) {
 			output->addByte(0x01);
 		} else {
 			output->addByte(0x00);
@@ -208,6 +267,31 @@ void ProtocolStatus::sendInfo(uint16_t requestedInfo, const std::string& charact
 		output->addString(STATUS_SERVER_VERSION);
 		output->addString(CLIENT_VERSION_STR);
 	}
+
+	// traffic details are for tools running on the server itself
+	if ((requestedInfo & REQUEST_PACKET_STATS_INFO) && getIP() == 0x0100007F) {
+		output->addByte(0x24); // packet stats
+		const PacketStats& stats = ProtocolGame::getPacketStats();
+		for (const auto& top : {stats.getTopReceived(STATUS_PACKET_STATS_LIMIT), stats.getTopSent(STATUS_PACKET_STATS_LIMIT)}) {
+			output->addByte(top.size());
+			for (const OpcodeSummary& summary : top) {
+				output->addByte(summary.opcode);
+				output->add<uint64_t>(summary.count);
+				output->add<uint64_t>(summary.bytes);
+			}
+		}
+	}
+
+	// as of the last snapshot, also for local tools only
+	if ((requestedInfo & REQUEST_MEMORY_INFO) && getIP() == 0x0100007F) {
+		output->addByte(0x25); // memory report
+		output->addByte(current->memory.size());
+		for (const MemoryReportEntry& entry : current->memory) {
+			output->addString(entry.name);
+			output->add<uint64_t>(entry.count);
+			output->add<uint64_t>(entry.bytes);
+		}
+	}
 	send(output);
 	disconnect();
 }
@@ -6,6 +6,25 @@
 
 #include "networkmessage.h"
 #include "protocol.h"
+#include "memoryreport.h"
+
+#include <gtl/phmap.hpp>
+
+// What the status answers need from the game, taken on the dispatcher every
+// statusCacheInterval and then only read by the network threads.
+struct StatusSnapshot
+{
+	std::string xml;
+	// body of the online players list answer
+	std::string playerList;
+	// lower case, for the online status of a player
+	gtl::flat_hash_set<std::string> playerNames;
+	uint32_t playersOnline = 0;
+	uint32_t playersRecord = 0;
+	uint32_t mapWidth = 0;
+	uint32_t mapHeight = 0;
+	std::vector<MemoryReportEntry> memory;
+};
 
 class ProtocolStatus final : public Protocol
 {
@@ -17,6 +36,9 @@ class ProtocolStatus final : public Protocol
 		static const char* protocol_name() {
 			return "status protocol";
 		}
+		const char* getProtocolName() const override {
+			return protocol_name();
+		}
 
 		// todo: change connection to reference
 		explicit ProtocolStatus(Connection_ptr connection) : Protocol(connection) {}
@@ -26,10 +48,18 @@ class ProtocolStatus final : public Protocol
 		void sendStatusString();
 		void sendInfo(uint16_t requestedInfo, const std::string& characterName);
 
+		// dispatcher thread, renews the snapshot and schedules the next renewal
+		static void updateSnapshot();
+
 		static const uint64_t start;
 
 	private:
+		static std::shared_ptr<const StatusSnapshot> getSnapshot();
+
 		static std::map<uint32_t, int64_t> ipConnectMap;
+		static std::mutex ipConnectLock;
+		static std::shared_ptr<const StatusSnapshot> snapshot;
+		static std::mutex snapshotLock;
 };
 
 #endif
@@ -0,0 +1,141 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "querystats.h"
+
+#include "configmanager.h"
+#include "tasks.h"
+
+#include <fmt/format.h>
+
+extern ConfigManager g_config;
+
+QueryStats g_queryStats;
+
+namespace {
+
+bool isIdentifier(char c)
+{
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '`';
+}
+
+void appendValue(std::string& out)
+{
+	// lists of values are one value, IN (1, 2, 3) is IN (?)
+	out += '?';
+	if (out.ends_with("?, ?")) {
+		out.resize(out.size() - 3);
+	} else if (out.ends_with("?,?")) {
+		out.resize(out.size() - 2);
+	}
+}
+
+void collapseGroup(std::string& out)
+{
+	// rows of an insert are one row, VALUES (?), (?) is VALUES (?)
+	size_t depth = 0;
+	size_t open = out.size();
+	while (open-- > 0) {
+		if (out[open] == ')') {
+			++depth;
+		} else if (out[open] == '(' && --depth == 0) {
+			break;
+		}
+	}
+	if (open == std::string::npos) {
+		return;
+	}
+
+	const std::string_view group = std::string_view(out).substr(open);
+	const std::string_view before = std::string_view(out).substr(0, open);
+	for (const std::string_view separator : {", ", ","}) {
+		if (before.size() >= group.size() + separator.size() && before.ends_with(separator) && before.substr(before.size() - separator.size() - group.size(), group.size()) == group) {
+			out.resize(open - separator.size());
+			return;
+		}
+	}
+}
+
+}
+
+std::string QueryStats::getFingerprint(std::string_view query)
+{
+	std::string out;
+	out.reserve(std::min(query.size(), MAX_FINGERPRINT));
+
+	for (size_t i = 0; i < query.size() && out.size() < MAX_FINGERPRINT; ++i) {
+		const char c = query[i];
+		if (c == '\'' || c == '"') {
+			// the whole literal, escaped and doubled quotes included
+			for (++i; i < query.size(); ++i) {
+				if (query[i] == '\\') {
+					++i;
+				} else if (query[i] == c) {
+					if (i + 1 < query.size() && query[i + 1] == c) {
+						++i;
+					} else {
+						break;
+					}
+				}
+			}
+			appendValue(out);
+		} else if (std::isdigit(static_cast<unsigned char>(c)) && (out.empty() || !isIdentifier(out.back()))) {
+			// decimals and hexadecimal blobs too
+			while (i + 1 < query.size() && (std::isalnum(static_cast<unsigned char>(query[i + 1])) || query[i + 1] == '.')) {
+				++i;
+			}
+			appendValue(out);
+		} else if (std::isspace(static_cast<unsigned char>(c))) {
+			if (!out.empty() && out.back() != ' ') {
+				out += ' ';
+			}
+		} else {
+			out += c;
+			if (c == ')') {
+				collapseGroup(out);
+			}
+		}
+	}
+
+	if (!out.empty() && out.back() == ' ') {
+		out.pop_back();
+	}
+	return out;
+}
+
+void QueryStats::add(std::string_view query, const std::source_location& location, std::chrono::steady_clock::duration time)
+{
+	const int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+	const bool blocking = !workerThread;
+	const bool dispatcher = blocking && g_dispatcher.isCurrentThread();
+
+	std::string fingerprint = getFingerprint(query);
+	{
+		std::lock_guard<std::mutex> lockGuard(shapesLock);
+		QueryShape& shape = shapes[fingerprint];
+		shape.latency.add(micros);
+		shape.site = TaskSite{location.file_name(), location.function_name(), location.line()};
+		shape.blocking += blocking;
+		shape.dispatcher += dispatcher;
+	}
+
+	if (const int64_t threshold = g_config.getNumber(ConfigManager::SLOW_QUERY_THRESHOLD); threshold > 0 && micros >= threshold * 1000) {
+		// the shape rather than the query, the values may be anything down to password hashes
+		const char* thread = dispatcher ? "the dispatcher" : blocking ? "a blocking thread" : "a database worker";
+		std::cout << fmt::format("> Warning: a query took {:.1f} ms on {:s}, sent from {:s}:{:d}: {:s}", micros / 1e3, thread, location.file_name(), location.line(), fingerprint) << std::endl;
+	}
+}
+
+std::vector<std::pair<std::string, QueryShape>> QueryStats::getShapes() const
+{
+	std::lock_guard<std::mutex> lockGuard(shapesLock);
+	return {shapes.begin(), shapes.end()};
+}
+
+void QueryStats::reset()
+{
+	std::lock_guard<std::mutex> lockGuard(shapesLock);
+	shapes.clear();
+}
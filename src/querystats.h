@@ -0,0 +1,71 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_QUERYSTATS_H
+#define FS_QUERYSTATS_H
+
+#include "taskstats.h"
+
+struct QueryShape
+{
+	LatencyHistogram latency;
+	// where it was sent from last
+	TaskSite site;
+	// the calling thread waited for these, the dispatcher ones froze the world
+	uint64_t blocking = 0;
+	uint64_t dispatcher = 0;
+};
+
+// Time of every query sent to the database, by the shape of the query: its
+// text with the literals replaced by ?, so a statement run for one player or
+// another counts as the same one. A query slower than slowQueryThreshold
+// milliseconds is logged with the site that sent it and the thread it ran on.
+class QueryStats
+{
+	public:
+		// the longest shape kept, the rest of a long query is cut off
+		static constexpr size_t MAX_FINGERPRINT = 256;
+
+		// threads of g_databaseTasks, anything else blocks on its queries
+		static void setWorkerThread() {
+			workerThread = true;
+		}
+
+		static std::string getFingerprint(std::string_view query);
+
+		// any thread
+		void add(std::string_view query, const std::source_location& location, std::chrono::steady_clock::duration time);
+
+		std::vector<std::pair<std::string, QueryShape>> getShapes() const;
+		void reset();
+
+	private:
+		static inline thread_local bool workerThread = false;
+
+		mutable std::mutex shapesLock;
+		gtl::flat_hash_map<std::string, QueryShape> shapes;
+};
+
+extern QueryStats g_queryStats;
+
+// times a query from its construction to its destruction
+class QueryTimer
+{
+	public:
+		QueryTimer(std::string_view query, const std::source_location& location) : query(query), location(location) {}
+
+		~QueryTimer() {
+			g_queryStats.add(query, location, std::chrono::steady_clock::now() - start);
+		}
+
+		// non-copyable
+		QueryTimer(const QueryTimer&) = delete;
+		QueryTimer& operator=(const QueryTimer&) = delete;
+
+	private:
+		std::string_view query;
+		const std::source_location& location;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+#endif
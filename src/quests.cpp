@@ -127,6 +127,7 @@ bool Quest::isStarted(const PlayerPtr& player) const
 bool Quests::reload()
 {
 	quests.clear();
+	storageQuests.clear();
 	return loadFromToml();
 }
 
@@ -205,13 +206,35 @@ bool Quests::loadFromToml()
 			}
 			catch (const toml::parse_error& err) {
 				std::cerr << "Failed to parse "<< entry.path().string() << ". Reason : " << err.what() << " \n";
+				indexStorageKeys();
 				return false;
 			}
 		}
 	}
+
+	indexStorageKeys();
 	return true;
 }
 
+void Quests::indexStorageKeys()
+{
+	storageQuests.clear();
+	for (const Quest& quest : quests) {
+		const auto addKey = [&](uint32_t key) {
+			auto& keyQuests = storageQuests[key];
+			if (keyQuests.empty() || keyQuests.back() != &quest) {
+				keyQuests.push_back(&quest);
+			}
+		};
+
+		addKey(quest.getStartStorageId());
+		for (const Mission& mission : quest.getMissions()) {
+			addKey(mission.getStorageId());
+		}
+	}
+	++version;
+}
+
 Quest* Quests::getQuestByID(uint16_t id)
 {
 	for (Quest& quest : quests) {
@@ -235,12 +258,17 @@ uint16_t Quests::getQuestsCount(const PlayerPtr& player) const
 
 bool Quests::isQuestStorage(const uint32_t key, const int32_t value, const int32_t oldValue) const
 {
-	for (const Quest& quest : quests) {
-		if (quest.getStartStorageId() == key && quest.getStartStorageValue() == value) {
+	const auto it = storageQuests.find(key);
+	if (it == storageQuests.end()) {
+		return false;
+	}
+
+	for (const Quest* quest : it->second) {
+		if (quest->getStartStorageId() == key && quest->getStartStorageValue() == value) {
 			return true;
 		}
 
-		for (const Mission& mission : quest.getMissions()) {
+		for (const Mission& mission : quest->getMissions()) {
 			if (mission.getStorageId() == key && value >= mission.getStartStorageValue() && value <= mission.getEndStorageValue()) {
 				return mission.mainDescription.empty() || oldValue < mission.getStartStorageValue() || oldValue > mission.getEndStorageValue();
 			}
@@ -99,11 +99,24 @@ class Quests
 		bool loadFromToml();
 		Quest* getQuestByID(uint16_t id);
 		bool isQuestStorage(const uint32_t key, const int32_t value, const int32_t oldValue) const;
+		// whether any quest or mission reads the key at all
+		bool isQuestStorageKey(const uint32_t key) const {
+			return storageQuests.contains(key);
+		}
+		// changes with every load, the caches of the players drop what they read before
+		uint32_t getVersion() const {
+			return version;
+		}
 		uint16_t getQuestsCount(const PlayerPtr& player) const;
 		bool reload();
 
 	private:
+		void indexStorageKeys();
+
 		QuestsList quests;
+		// by storage key, the quests that read it themselves or through a mission, in the order of quests
+		gtl::flat_hash_map<uint32_t, std::vector<const Quest*>> storageQuests;
+		uint32_t version = 0;
 };
 
 #endif
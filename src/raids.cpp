@@ -11,6 +11,7 @@
 #include "configmanager.h"
 #include "scheduler.h"
 #include "monster.h"
+#include "tickprofiler.h"
 
 #include <fmt/format.h>
 
@@ -90,6 +91,10 @@ bool Raids::loadFromXml()
 		}
 	}
 
+	minMargin = raidList.empty() ? 0 : (*std::min_element(raidList.begin(), raidList.end(), [](const Raid* lhs, const Raid* rhs) {
+		return lhs->getMargin() < rhs->getMargin();
+	}))->getMargin();
+
 	loaded = true;
 	return true;
 }
@@ -104,15 +109,35 @@ bool Raids::startup()
 
 	setLastRaidEnd(OTSYS_TIME());
 
-	checkRaidsEvent = g_scheduler.addEvent(createSchedulerTask(CHECK_RAIDS_INTERVAL * 1000, [this]() { checkRaids(); }));
+	scheduleCheck();
 
 	started = true;
 	return started;
 }
 
+void Raids::scheduleCheck()
+{
+	// the checks keep to their interval, the ones before the margin of any
+	// raid has passed are skipped, up to an hour of them at once
+	static constexpr uint64_t MAX_SKIPPED_CHECKS = 60;
+
+	const uint64_t interval = CHECK_RAIDS_INTERVAL * 1000;
+	uint64_t checks = 1;
+	if (!getRunning() && !raidList.empty()) {
+		const uint64_t now = OTSYS_TIME();
+		const uint64_t eligible = getLastRaidEnd() + minMargin;
+		if (eligible > now + interval) {
+			checks = std::min(MAX_SKIPPED_CHECKS, (eligible - now + interval - 1) / interval);
+		}
+	}
+
+	checkRaidsEvent = g_scheduler.addEvent(createSchedulerTask(static_cast<uint32_t>(checks * interval), [this]() { checkRaids(); }, DISPATCHER_LANE_BACKGROUND));
+}
+
 void Raids::checkRaids()
 {
-	if (!getRunning()) {
+	TickPhaseTimer timer(TICK_PHASE_RAIDS);
+	if (!getRunning() && OTSYS_TIME() >= getLastRaidEnd() + minMargin) {
 		uint64_t now = OTSYS_TIME();
 
 		for (auto it = raidList.begin(), end = raidList.end(); it != end; ++it) {
@@ -131,7 +156,7 @@ void Raids::checkRaids()
 		}
 	}
 
-	checkRaidsEvent = g_scheduler.addEvent(createSchedulerTask(CHECK_RAIDS_INTERVAL * 1000, [this]() { checkRaids(); }));
+	scheduleCheck();
 }
 
 void Raids::clear()
@@ -144,6 +169,7 @@ void Raids::clear()
 		delete raid;
 	}
 	raidList.clear();
+	minMargin = 0;
 
 	loaded = false;
 	started = false;
@@ -225,19 +251,20 @@ void Raid::startRaid()
 	RaidEvent* raidEvent = getNextRaidEvent();
 	if (raidEvent) {
 		state = RAIDSTATE_EXECUTING;
-		nextEventEvent = g_scheduler.addEvent(createSchedulerTask(raidEvent->getDelay(), [=, this]() { executeRaidEvent(raidEvent); }));
+		nextEventEvent = g_scheduler.addEvent(createSchedulerTask(raidEvent->getDelay(), [=, this]() { executeRaidEvent(raidEvent); }, DISPATCHER_LANE_BACKGROUND));
 	}
 }
 
 void Raid::executeRaidEvent(RaidEvent* raidEvent)
 {
+	TickPhaseTimer timer(TICK_PHASE_RAIDS);
 	if (raidEvent->executeEvent()) {
 		nextEvent++;
 		RaidEvent* newRaidEvent = getNextRaidEvent();
 
 		if (newRaidEvent) {
 			uint32_t ticks = static_cast<uint32_t>(std::max<int32_t>(RAID_MINTICKS, newRaidEvent->getDelay() - raidEvent->getDelay()));
-			nextEventEvent = g_scheduler.addEvent(createSchedulerTask(ticks, [=, this]() { executeRaidEvent(newRaidEvent); }));
+			nextEventEvent = g_scheduler.addEvent(createSchedulerTask(ticks, [=, this]() { executeRaidEvent(newRaidEvent); }, DISPATCHER_LANE_BACKGROUND));
 		} else {
 			resetRaid();
 		}
@@ -503,8 +530,31 @@ bool AreaSpawnEvent::configureRaidEvent(const pugi::xml_node& eventNode)
 	return true;
 }
 
+const std::vector<Position>& AreaSpawnEvent::getCandidates()
+{
+	if (candidatesLoaded) {
+		return candidates;
+	}
+
+	for (uint32_t z = fromPos.z; z <= toPos.z; ++z) {
+		for (uint32_t y = fromPos.y; y <= toPos.y; ++y) {
+			for (uint32_t x = fromPos.x; x <= toPos.x; ++x) {
+				const auto& tile = g_game.map.getTile(x, y, z);
+				if (tile && tile->getGround() && !tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
+					candidates.emplace_back(static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint8_t>(z));
+				}
+			}
+		}
+	}
+	candidates.shrink_to_fit();
+	candidatesLoaded = true;
+	return candidates;
+}
+
 bool AreaSpawnEvent::executeEvent()
 {
+	// a tile that was tried is taken or blocked for the rest of this wave
+	std::vector<Position> free = getCandidates();
 	for (const MonsterSpawn& spawn : spawnList) {
 		uint32_t amount = uniform_random(spawn.minAmount, spawn.maxAmount);
 		for (uint32_t i = 0; i < amount; ++i) {
@@ -515,9 +565,14 @@ bool AreaSpawnEvent::executeEvent()
 			}
 
 			bool success = false;
-			for (int32_t tries = 0; tries < MAXIMUM_TRIES_PER_MONSTER; tries++) {
-				const auto& tile = g_game.map.getTile(uniform_random(fromPos.x, toPos.x), uniform_random(fromPos.y, toPos.y), uniform_random(fromPos.z, toPos.z));
-				if (tile && !tile->isMoveableBlocking() && !tile->hasFlag(TILESTATE_PROTECTIONZONE) && tile->getTopCreature() == nullptr && g_game.placeCreature(monster, tile->getPosition(), false, true)) {
+			for (int32_t tries = 0; tries < MAXIMUM_TRIES_PER_MONSTER && !free.empty(); tries++) {
+				const size_t index = uniform_random(0, static_cast<int32_t>(free.size()) - 1);
+				const Position position = free[index];
+				free[index] = free.back();
+				free.pop_back();
+
+				const auto& tile = g_game.map.getTile(position);
+				if (tile && !tile->isMoveableBlocking() && tile->getTopCreature() == nullptr && g_game.placeCreature(monster, position, false, true)) {
 					success = true;
 					break;
 				}
@@ -80,9 +80,14 @@ class Raids
 		}
 
 	private:
+		void scheduleCheck();
+
 		LuaScriptInterface scriptInterface{"Raid Interface"};
 
-		std::list<Raid*> raidList;
+		std::vector<Raid*> raidList;
+		// the smallest margin of raidList, no raid can start before the last
+		// one ended that long ago
+		uint64_t minMargin = 0;
 		Raid* running = nullptr;
 		uint64_t lastRaidEnd = 0;
 		uint32_t checkRaidsEvent = 0;
@@ -198,8 +203,14 @@ class AreaSpawnEvent final : public RaidEvent
 		bool executeEvent() override;
 
 	private:
-		std::list<MonsterSpawn> spawnList;
+		// the tiles of the area with ground and out of protection zones, taken
+		// from the map the first time the event runs
+		const std::vector<Position>& getCandidates();
+
+		std::vector<MonsterSpawn> spawnList;
+		std::vector<Position> candidates;
 		Position fromPos, toPos;
+		bool candidatesLoaded = false;
 };
 
 class ScriptEvent final : public RaidEvent, public Event
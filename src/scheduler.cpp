@@ -4,8 +4,18 @@
 #include "otpch.h"
 
 #include "scheduler.h"
-#include <boost/asio/post.hpp>
-#include <memory>
+#include "threadrole.h"
+#include "tracing.h"
+
+namespace {
+
+bool compareDeadline(const SchedulerTask* lhs, const SchedulerTask* rhs)
+{
+	// std::push_heap builds a max-heap, so invert to keep the nearest deadline on top
+	return lhs->getDeadline() > rhs->getDeadline();
+}
+
+}
 
 uint32_t Scheduler::addEvent(SchedulerTask* task)
 {
@@ -14,25 +24,27 @@ uint32_t Scheduler::addEvent(SchedulerTask* task)
 		task->setEventId(++lastEventId);
 	}
 
-	boost::asio::post(io_context, [this, task]() {
-		// insert the event id in the list of active events
-		auto it = eventIdTimerMap.emplace(task->getEventId(), boost::asio::steady_timer{io_context});
-		auto& timer = it.first->second;
-
-		timer.expires_after(std::chrono::milliseconds(task->getDelay()));
-		timer.async_wait([this, task](const boost::system::error_code& error) {
-			eventIdTimerMap.erase(task->getEventId());
+	task->deadline = Clock::now() + std::chrono::milliseconds(task->getDelay());
+	task->tick = getTick(task->deadline);
 
-			if (error == boost::asio::error::operation_aborted || getState() == THREAD_STATE_TERMINATED) {
-				// the timer has been manually canceled(timer->cancel()) or Scheduler::shutdown has been called
-				delete task;
-				return;
-			}
+	std::lock_guard<std::mutex> lockClass(eventLock);
+	if (getState() == THREAD_STATE_TERMINATED) {
+		delete task;
+		return 0;
+	}
 
-			g_dispatcher.addTask(task);
-		});
-	});
+	// insert the event id in the list of active events
+	activeEvents[task->getEventId()] = task;
 
+	if (task->tick < currentTick) {
+		// that slot was already processed, so it goes straight to the due heap
+		scheduleDue(task);
+		if (task->deadline < nextWakeup) {
+			eventSignal.notify_one();
+		}
+	} else {
+		wheel[task->tick % SCHEDULER_WHEEL_SIZE].push_back(task);
+	}
 	return task->getEventId();
 }
 
@@ -42,29 +54,112 @@ void Scheduler::stopEvent(uint32_t eventId)
 		return;
 	}
 
-	boost::asio::post(io_context, [this, eventId]() {
-		// search the event id
-		auto it = eventIdTimerMap.find(eventId);
-		if (it != eventIdTimerMap.end()) {
-			it->second.cancel();
+	std::lock_guard<std::mutex> lockClass(eventLock);
+
+	// search the event id
+	auto it = activeEvents.find(eventId);
+	if (it != activeEvents.end()) {
+		// leave a tombstone, the task is released when its slot comes up
+		it->second->cancelled = true;
+		activeEvents.erase(it);
+	}
+}
+
+size_t Scheduler::getEventCount()
+{
+	std::lock_guard<std::mutex> lockClass(eventLock);
+	return activeEvents.size();
+}
+
+void Scheduler::scheduleDue(SchedulerTask* task)
+{
+	dueEvents.push_back(task);
+	std::push_heap(dueEvents.begin(), dueEvents.end(), compareDeadline);
+}
+
+void Scheduler::advanceSlot()
+{
+	auto& slot = wheel[currentTick % SCHEDULER_WHEEL_SIZE];
+
+	size_t kept = 0;
+	for (SchedulerTask* task : slot) {
+		if (task->cancelled) {
+			delete task;
+		} else if (task->tick > currentTick) {
+			// belongs to a later revolution of the wheel
+			slot[kept++] = task;
+		} else {
+			scheduleDue(task);
+		}
+	}
+	slot.resize(kept);
+
+	++currentTick;
+}
+
+void Scheduler::threadMain()
+{
+	setThreadRole("scheduler");
+	std::unique_lock<std::mutex> eventLockUnique(eventLock);
+
+	while (getState() != THREAD_STATE_TERMINATED) {
+		const auto now = Clock::now();
+
+		// every slot whose window has started feeds the due heap
+		while (getTickTime(currentTick) <= now) {
+			advanceSlot();
 		}
-	});
+
+		while (!dueEvents.empty() && dueEvents.front()->deadline <= now) {
+			std::pop_heap(dueEvents.begin(), dueEvents.end(), compareDeadline);
+			SchedulerTask* task = dueEvents.back();
+			dueEvents.pop_back();
+
+			if (task->cancelled) {
+				delete task;
+				continue;
+			}
+
+			activeEvents.erase(task->getEventId());
+			readyEvents.push_back(task);
+			if (TraceRecorder::isRecording()) {
+				g_traceRecorder.add(task->getLocation().function_name(), "scheduler", now, now, true);
+			}
+		}
+
+		// everything that expired this round goes over as one batch, in deadline order
+		g_dispatcher.addTasks(readyEvents);
+
+		nextWakeup = getTickTime(currentTick);
+		if (!dueEvents.empty()) {
+			nextWakeup = std::min(nextWakeup, dueEvents.front()->deadline);
+		}
+		eventSignal.wait_until(eventLockUnique, nextWakeup);
+	}
+
+	// the scheduler is shutting down, release every pending event
+	for (auto& slot : wheel) {
+		for (SchedulerTask* task : slot) {
+			delete task;
+		}
+		slot.clear();
+	}
+
+	for (SchedulerTask* task : dueEvents) {
+		delete task;
+	}
+	dueEvents.clear();
+	activeEvents.clear();
 }
 
 void Scheduler::shutdown()
 {
+	std::lock_guard<std::mutex> lockClass(eventLock);
 	setState(THREAD_STATE_TERMINATED);
-	boost::asio::post(io_context, [this]() {
-		// cancel all active timers
-		for (auto& it : eventIdTimerMap) {
-			it.second.cancel();
-		}
-
-		io_context.stop();
-	});
+	eventSignal.notify_one();
 }
 
-SchedulerTask* createSchedulerTask(uint32_t delay, TaskFunc&& f)
+SchedulerTask* createSchedulerTask(uint32_t delay, TaskFunc&& f, DispatcherLane_t lane/* = DISPATCHER_LANE_DEFAULT*/, const std::source_location& location/* = std::source_location::current()*/)
 {
-	return new SchedulerTask(delay, std::move(f));
+	return new SchedulerTask(delay, std::move(f), lane, location);
 }
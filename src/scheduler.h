@@ -7,9 +7,13 @@
 #include "tasks.h"
 #include "thread_holder_base.h"
 
+#include <array>
+#include <condition_variable>
 #include <gtl/phmap.hpp>
 
 static constexpr int32_t SCHEDULER_MINTICKS = 50;
+// number of SCHEDULER_MINTICKS slots in the timing wheel, one revolution is ~51 seconds
+static constexpr size_t SCHEDULER_WHEEL_SIZE = 1024;
 
 class SchedulerTask : public Task
 {
@@ -25,32 +29,84 @@ class SchedulerTask : public Task
 		uint32_t getDelay() const {
 			return delay;
 		}
+
+		std::chrono::steady_clock::time_point getDeadline() const {
+			return deadline;
+		}
+
+		static void* operator new(size_t size) {
+			if (size != sizeof(SchedulerTask)) {
+				return ::operator new(size);
+			}
+			return LockfreePoolingAllocator<SchedulerTask, TASK_FREE_LIST_CAPACITY>().allocate(1);
+		}
+
+		static void operator delete(void* p, size_t size) {
+			if (size != sizeof(SchedulerTask)) {
+				::operator delete(p);
+				return;
+			}
+			LockfreePoolingAllocator<SchedulerTask, TASK_FREE_LIST_CAPACITY>().deallocate(static_cast<SchedulerTask*>(p), 1);
+		}
 	
 	private:
-		SchedulerTask(uint32_t delay, TaskFunc&& f) : Task(std::move(f)), delay(delay) {}
+		SchedulerTask(uint32_t delay, TaskFunc&& f, DispatcherLane_t lane, const std::source_location& location) : Task(std::move(f), lane, location), delay(delay) {}
 
+		std::chrono::steady_clock::time_point deadline;
+		uint64_t tick = 0;
 		uint32_t eventId = 0;
 		uint32_t delay = 0;
+		bool cancelled = false;
 
-		friend SchedulerTask* createSchedulerTask(uint32_t, TaskFunc&&);
+		friend SchedulerTask* createSchedulerTask(uint32_t, TaskFunc&&, DispatcherLane_t, const std::source_location&);
+		friend class Scheduler;
 };
 
-SchedulerTask* createSchedulerTask(uint32_t delay, TaskFunc&& f);
+SchedulerTask* createSchedulerTask(uint32_t delay, TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current());
 
+// Hashed timing wheel, every slot holds the events whose deadline falls in
+// its SCHEDULER_MINTICKS window. Adding and cancelling an event is O(1), once
+// a slot comes up its events are moved to a small deadline-ordered heap so
+// they still fire at their exact time rather than on the tick boundary.
 class Scheduler : public ThreadHolder<Scheduler>
 {
 	public:
 		uint32_t addEvent(SchedulerTask* task);
 		void stopEvent(uint32_t eventId);
 
+		// events waiting for their deadline
+		size_t getEventCount();
+
 		void shutdown();
 
-		void threadMain() { io_context.run(); }
+		void threadMain();
 	private:
+		using Clock = std::chrono::steady_clock;
+
+		Clock::time_point getTickTime(uint64_t tick) const {
+			return epoch + std::chrono::milliseconds(tick * SCHEDULER_MINTICKS);
+		}
+
+		uint64_t getTick(Clock::time_point time) const {
+			return std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch).count() / SCHEDULER_MINTICKS;
+		}
+
+		void scheduleDue(SchedulerTask* task);
+		void advanceSlot();
+
+		std::mutex eventLock;
+		std::condition_variable eventSignal;
+
 		std::atomic<uint32_t> lastEventId{0};
-		gtl::node_hash_map<uint32_t, boost::asio::steady_timer> eventIdTimerMap;
-		boost::asio::io_context io_context;
-		boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work{ io_context.get_executor() };
+		gtl::flat_hash_map<uint32_t, SchedulerTask*> activeEvents;
+
+		std::array<std::vector<SchedulerTask*>, SCHEDULER_WHEEL_SIZE> wheel;
+		std::vector<SchedulerTask*> dueEvents;
+		std::vector<Task*> readyEvents;
+
+		const Clock::time_point epoch = Clock::now();
+		Clock::time_point nextWakeup = epoch;
+		uint64_t currentTick = 0;
 };
 
 extern Scheduler g_scheduler;
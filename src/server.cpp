@@ -8,6 +8,7 @@
 #include "scheduler.h"
 #include "configmanager.h"
 #include "ban.h"
+#include "threadrole.h"
 
 extern ConfigManager g_config;
 Ban g_bans;
@@ -26,7 +27,9 @@ void ServiceManager::run()
 {
 	assert(!running);
 	running = true;
+	setThreadRole("network");
 	io_context.run();
+	connectionContexts.stop();
 }
 
 void ServiceManager::stop()
@@ -47,10 +50,73 @@ void ServiceManager::stop()
 
 	acceptors.clear();
 
+	if (metrics) {
+		boost::asio::post(io_context, [metrics = std::move(metrics)]() { metrics->close(); });
+	}
+
 	death_timer.expires_after(std::chrono::seconds(3));
 	death_timer.async_wait([this](const boost::system::error_code&) { die(); });
 }
 
+bool ServiceManager::addMetrics(uint16_t port)
+{
+	if (port == 0 || metrics) {
+		return false;
+	}
+
+	if (auto it = acceptors.find(port); it != acceptors.end()) {
+		std::cout << "ERROR: metrics and " << it->second->get_protocol_names() << " cannot use the same port " << port << '.' << std::endl;
+		return false;
+	}
+
+	metrics = std::make_shared<MetricsServer>(io_context);
+	metrics->open(port);
+	return true;
+}
+
+ConnectionContextPool::~ConnectionContextPool()
+{
+	stop();
+}
+
+void ConnectionContextPool::start()
+{
+	const int32_t threadCount = g_config.getNumber(ConfigManager::NETWORK_THREADS);
+	for (int32_t i = 0; i < threadCount; ++i) {
+		auto& context = contexts.emplace_back(std::make_unique<boost::asio::io_context>(1));
+		workGuards.emplace_back(boost::asio::make_work_guard(*context));
+		threads.emplace_back([context = context.get()]() {
+			setThreadRole("network");
+			context->run();
+		});
+	}
+}
+
+void ConnectionContextPool::stop()
+{
+	workGuards.clear();
+	for (auto& context : contexts) {
+		context->stop();
+	}
+
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+boost::asio::io_context& ConnectionContextPool::getNext(boost::asio::io_context& fallback)
+{
+	// the config is loaded by the time the first port accepts
+	std::call_once(startFlag, [this]() { start(); });
+	if (contexts.empty()) {
+		return fallback;
+	}
+	return *contexts[nextContext++ % contexts.size()];
+}
+
 ServicePort::~ServicePort()
 {
 	close();
@@ -82,7 +148,7 @@ void ServicePort::accept()
 		return;
 	}
 
-	auto connection = ConnectionManager::getInstance().createConnection(io_context, shared_from_this());
+	auto connection = ConnectionManager::getInstance().createConnection(connectionContexts.getNext(io_context), shared_from_this());
 	acceptor->async_accept(connection->getSocket(), [=, thisPtr = shared_from_this()](const boost::system::error_code& error) { thisPtr->onAccept(connection, error); });
 }
 
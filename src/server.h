@@ -5,6 +5,7 @@
 #define FS_SERVER_H
 
 #include "connection.h"
+#include "metrics.h"
 #include "signals.h"
 
 #include <memory>
@@ -45,10 +46,40 @@ class Service final : public ServiceBase
 		}
 };
 
+// io_contexts the accepted connections run on, one thread each. Connections
+// are handed out round robin and stay on their context, so decryption and
+// packet framing of different clients run side by side. Without threads
+// they stay on the io_context of the service manager.
+class ConnectionContextPool
+{
+	public:
+		ConnectionContextPool() = default;
+		~ConnectionContextPool();
+
+		// non-copyable
+		ConnectionContextPool(const ConnectionContextPool&) = delete;
+		ConnectionContextPool& operator=(const ConnectionContextPool&) = delete;
+
+		boost::asio::io_context& getNext(boost::asio::io_context& fallback);
+		void stop();
+
+	private:
+		using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+		void start();
+
+		std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+		std::vector<WorkGuard> workGuards;
+		std::vector<std::thread> threads;
+		std::atomic<size_t> nextContext{0};
+		std::once_flag startFlag;
+};
+
 class ServicePort : public std::enable_shared_from_this<ServicePort>
 {
 	public:
-		explicit ServicePort(boost::asio::io_context& io_context) : io_context(io_context) {}
+		ServicePort(boost::asio::io_context& io_context, ConnectionContextPool& connectionContexts) :
+			io_context(io_context), connectionContexts(connectionContexts) {}
 		~ServicePort();
 
 		// non-copyable
@@ -71,6 +102,7 @@ class ServicePort : public std::enable_shared_from_this<ServicePort>
 		void accept();
 
 		boost::asio::io_context& io_context;
+		ConnectionContextPool& connectionContexts;
 		std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
 		std::vector<Service_ptr> services;
 
@@ -93,6 +125,8 @@ class ServiceManager
 
 		template <typename ProtocolType>
 		bool add(uint16_t port);
+		// the Prometheus endpoint, false when port is 0
+		bool addMetrics(uint16_t port);
 
 		bool is_running() const {
 			return acceptors.empty() == false;
@@ -102,8 +136,10 @@ class ServiceManager
 		void die();
 
 		gtl::node_hash_map<uint16_t, ServicePort_ptr> acceptors;
+		MetricsServer_ptr metrics;
 
 		boost::asio::io_context io_context;
+		ConnectionContextPool connectionContexts;
 		Signals signals{io_context};
 		boost::asio::steady_timer death_timer { io_context };
 		bool running = false;
@@ -122,7 +158,7 @@ bool ServiceManager::add(uint16_t port)
 	auto foundServicePort = acceptors.find(port);
 
 	if (foundServicePort == acceptors.end()) {
-		service_port = std::make_shared<ServicePort>(io_context);
+		service_port = std::make_shared<ServicePort>(io_context, connectionContexts);
 		service_port->open(port);
 		acceptors[port] = service_port;
 	} else {
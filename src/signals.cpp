@@ -21,6 +21,7 @@
 #include "events.h"
 #include "scheduler.h"
 #include "databasetasks.h"
+#include "tracing.h"
 
 extern Scheduler g_scheduler;
 extern DatabaseTasks g_databaseTasks;
@@ -48,7 +49,18 @@ void sigusr1Handler()
 	//Dispatcher thread
 	std::cout << "SIGUSR1 received, saving the game state..." << std::endl;
 	g_globalEvents->save();
-	g_game.saveGameState();
+	g_game.scheduleSaveGameState();
+}
+
+void sigusr2Handler()
+{
+	//Dispatcher thread
+	const std::string file = g_traceRecorder.start(10);
+	if (file.empty()) {
+		std::cout << "SIGUSR2 received, a trace is already being recorded." << std::endl;
+	} else {
+		std::cout << "SIGUSR2 received, recording a trace of 10 seconds to " << file << "..." << std::endl;
+	}
 }
 
 void sighupHandler()
@@ -153,6 +165,9 @@ void dispatchSignalHandler(int signal)
 		case SIGUSR1: //Saves game state
 			g_dispatcher.addTask(createTask(sigusr1Handler));
 			break;
+		case SIGUSR2: //Records a trace
+			g_dispatcher.addTask(createTask(sigusr2Handler));
+			break;
 #else
 		case SIGBREAK: //Shuts the server down
 			g_dispatcher.addTask(createTask(sigbreakHandler));
@@ -175,6 +190,7 @@ Signals::Signals(boost::asio::io_context& context): set(context)
 	set.add(SIGTERM);
 #ifndef _WIN32
 	set.add(SIGUSR1);
+	set.add(SIGUSR2);
 	set.add(SIGHUP);
 #else
 	// This must be a blocking call as Windows calls it in a new thread and terminates
@@ -0,0 +1,229 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "simulation.h"
+
+#include "allocprofiler.h"
+
+#include "game.h"
+#include "monster.h"
+#include "scheduler.h"
+
+#include <fmt/format.h>
+
+extern Game g_game;
+
+Simulation g_simulation;
+
+namespace {
+
+constexpr uint32_t SIMULATION_LEVEL = 50;
+constexpr uint32_t SIMULATION_MIN_DELAY = 500;
+constexpr uint32_t SIMULATION_MAX_DELAY = 1500;
+
+// the attack spell of each vocation, then spells any of them can cast
+constexpr std::array<const char*, 5> vocationSpells = {"exura", "exevo vis lux", "exori frigo", "exori san", "exori"};
+constexpr std::array<const char*, 3> commonSpells = {"exura", "utani hur", "utevo lux"};
+
+std::vector<Position> getStartPositions()
+{
+	std::vector<Position> positions;
+	for (const Spawn& spawn : g_game.map.spawns.getSpawnList()) {
+		positions.push_back(spawn.getCenterPos());
+	}
+
+	if (positions.empty()) {
+		for (const auto& it : g_game.map.towns.getTowns()) {
+			positions.push_back(it.second->getTemplePosition());
+		}
+	}
+	return positions;
+}
+
+uint32_t randomDelay()
+{
+	return static_cast<uint32_t>(uniform_random(SIMULATION_MIN_DELAY, SIMULATION_MAX_DELAY));
+}
+
+MonsterPtr findNearestMonster(const PlayerPtr& player)
+{
+	const Position& playerPos = player->getPosition();
+
+	SpectatorVec spectators;
+	g_game.map.getSpectators(spectators, playerPos, false, false,
+	                         Map::maxClientViewportX, Map::maxClientViewportX, Map::maxClientViewportY, Map::maxClientViewportY);
+
+	MonsterPtr nearest;
+	int32_t nearestDistance = std::numeric_limits<int32_t>::max();
+	for (const auto& spectator : spectators) {
+		const auto monster = spectator->getMonster();
+		if (!monster || monster->isRemoved() || monster->getHealth() <= 0) {
+			continue;
+		}
+
+		const Position& monsterPos = monster->getPosition();
+		const int32_t distance = std::max(Position::getDistanceX(playerPos, monsterPos), Position::getDistanceY(playerPos, monsterPos));
+		if (distance < nearestDistance) {
+			nearestDistance = distance;
+			nearest = monster;
+		}
+	}
+	return nearest;
+}
+
+// a container lying next to the player, corpses mostly
+ContainerPtr findAdjacentContainer(const PlayerPtr& player)
+{
+	const Position& playerPos = player->getPosition();
+	for (int32_t dx = -1; dx <= 1; ++dx) {
+		for (int32_t dy = -1; dy <= 1; ++dy) {
+			const auto tile = g_game.map.getTile(playerPos.x + dx, playerPos.y + dy, playerPos.z);
+			if (!tile) {
+				continue;
+			}
+
+			const auto items = tile->getItemList();
+			if (!items) {
+				continue;
+			}
+
+			for (const auto& item : *items) {
+				if (const auto container = item->getContainer(); container && !container->empty()) {
+					return container;
+				}
+			}
+		}
+	}
+	return nullptr;
+}
+
+}
+
+bool Simulation::start()
+{
+	const std::vector<Position> positions = getStartPositions();
+	Group* group = g_game.groups.getGroup(1);
+	Town* town = g_game.map.towns.getTowns().empty() ? nullptr : g_game.map.towns.getTowns().begin()->second;
+	if (positions.empty() || !group || !town) {
+		std::cout << "> ERROR: The simulation needs a town, spawns or temples to place its players and the player group." << std::endl;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < playerCount; ++i) {
+		const PlayerPtr player = Player::makePlayer(nullptr);
+		player->name = fmt::format("Simulated Player {:d}", i + 1);
+		player->setGroup(group);
+		if (!player->setVocation(static_cast<uint16_t>(1 + i % 4))) {
+			player->setVocation(0);
+		}
+
+		player->level = SIMULATION_LEVEL;
+		player->experience = Player::getExpForLevel(SIMULATION_LEVEL);
+		player->healthMax = player->health = 185 + SIMULATION_LEVEL * 15;
+		player->manaMax = player->mana = 90 + SIMULATION_LEVEL * 20;
+		player->capacity = 40000;
+		player->defaultOutfit.lookType = 128;
+		player->currentOutfit = player->defaultOutfit;
+		player->town = town;
+		player->loginPosition = positions[i % positions.size()];
+		player->internalAddThing(CONST_SLOT_BACKPACK, Item::CreateItem(ITEM_BAG));
+		player->updateBaseSpeed();
+		player->updateInventoryWeight();
+		player->setID();
+
+		if (!g_game.placeCreature(player, player->loginPosition, true) && !g_game.placeCreature(player, town->getTemplePosition(), false, true)) {
+			continue;
+		}
+
+		++spawnedPlayers;
+		const uint32_t playerId = player->getID();
+		g_scheduler.addEvent(createSchedulerTask(randomDelay(), [this, playerId]() { act(playerId); }, DISPATCHER_LANE_PLAYER));
+	}
+
+	std::cout << ">> Simulating " << spawnedPlayers << " players for " << duration << " seconds" << std::endl;
+
+	g_dispatcher.getStats().reset();
+	g_tickProfiler.setEnabled(true);
+	startTotals = g_tickProfiler.getTotals();
+	startAllocations = AllocationProfiler::getTotalAllocations();
+	startTime = std::chrono::steady_clock::now();
+	running = true;
+	started = true;
+
+	g_scheduler.addEvent(createSchedulerTask(duration * 1000, [this]() { finish(); }));
+	return true;
+}
+
+void Simulation::act(uint32_t playerId)
+{
+	const auto player = g_game.getPlayerByID(playerId);
+	if (!player || !running) {
+		return;
+	}
+
+	// nobody answers the pings of these players
+	player->lastPong = OTSYS_TIME();
+
+	const int32_t roll = uniform_random(1, 100);
+	if (roll <= 10) {
+		const char* words = uniform_random(0, 1) == 0 ? vocationSpells[player->getVocationId() % vocationSpells.size()] : commonSpells[uniform_random(0, commonSpells.size() - 1)];
+		g_game.playerSay(playerId, 0, TALKTYPE_SAY, "", words);
+		++casts;
+	} else if (const MonsterPtr monster = roll <= 30 && !player->getAttackedCreature() ? findNearestMonster(player) : nullptr) {
+		g_game.playerSetFightModes(playerId, FIGHTMODE_ATTACK, true, false);
+		g_game.playerSetAttackedCreature(playerId, monster->getID());
+		++attacks;
+	} else if (const ContainerPtr container = roll <= 40 ? findAdjacentContainer(player) : nullptr) {
+		const auto item = container->getItemByIndex(0);
+		g_game.internalMoveItem(container, player, INDEX_WHEREEVER, item, item->getItemCount(), std::nullopt, 0, player);
+		++loots;
+	} else if (!player->getAttackedCreature()) {
+		g_game.playerMove(playerId, static_cast<Direction>(uniform_random(DIRECTION_NORTH, DIRECTION_LAST)));
+		++steps;
+	}
+
+	g_scheduler.addEvent(createSchedulerTask(randomDelay(), [this, playerId]() { act(playerId); }, DISPATCHER_LANE_PLAYER));
+}
+
+void Simulation::finish()
+{
+	running = false;
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+	const double wallMillis = std::max<int64_t>(1, elapsed.count()) / 1e6;
+
+	std::cout << std::endl << ">> Simulation of " << spawnedPlayers << " players finished after " << fmt::format("{:.1f}", wallMillis / 1000) << " seconds" << std::endl;
+	std::cout << fmt::format("{:<18s}{:>12s}{:>10s}", "phase", "ms", "wall %") << std::endl;
+	const auto& totals = g_tickProfiler.getTotals();
+	for (size_t i = 0; i < TICK_PHASE_LAST; ++i) {
+		const double millis = (totals[i] - startTotals[i]) / 1e6;
+		std::cout << fmt::format("{:<18s}{:>12.1f}{:>10.2f}", TickProfiler::getPhaseName(static_cast<TickPhase_t>(i)), millis, millis * 100 / wallMillis) << std::endl;
+	}
+
+	for (const auto& [name, time] : g_tickProfiler.getLastSecond().sources) {
+		std::cout << fmt::format("last second, {:s}: {:.1f} ms", name, time / 1e6) << std::endl;
+	}
+
+	std::cout << fmt::format("steps {:d}, casts {:d}, attacks {:d}, loots {:d}", steps, casts, attacks, loots) << std::endl;
+
+	if (AllocationProfiler::isBuiltIn()) {
+		const uint64_t allocations = AllocationProfiler::getTotalAllocations() - startAllocations;
+		std::cout << fmt::format("allocations {:d}, {:.0f} per second from {:s}", allocations, allocations * 1000 / wallMillis, AllocationProfiler::getAllocatorName()) << std::endl;
+		const auto& rates = g_allocationProfiler.getLastSecond();
+		for (size_t i = 0; i < std::min<size_t>(rates.size(), 5); ++i) {
+			std::cout << fmt::format("last second, {:s}: {:d} allocations, {:d} bytes", rates[i].label, rates[i].allocations, rates[i].bytes) << std::endl;
+		}
+	} else {
+		std::cout << "allocator " << AllocationProfiler::getAllocatorName() << std::endl;
+	}
+	std::cout << fmt::format("players {:d}, monsters {:d}, npcs {:d}", g_game.getPlayersOnline(), g_game.getMonstersOnline(), g_game.getNpcsOnline()) << std::endl;
+
+	const TaskStats& stats = g_dispatcher.getStats();
+	std::cout << fmt::format("dispatcher execution p50 {:d} us, p99 {:d} us, max {:d} us; wait p50 {:d} us, p99 {:d} us",
+	                         stats.getExecutionTime().getPercentile(50), stats.getExecutionTime().getPercentile(99), stats.getExecutionTime().getMax(),
+	                         stats.getWaitTime().getPercentile(50), stats.getWaitTime().getPercentile(99)) << std::endl << std::endl;
+
+	g_game.setGameState(GAME_STATE_SHUTDOWN);
+}
@@ -0,0 +1,56 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_SIMULATION_H
+#define FS_SIMULATION_H
+
+#include "tickprofiler.h"
+
+// Started with --simulate=players, the server loads the world as usual but
+// opens no ports. Players without a client are spread over the spawns and
+// walk, cast, attack and loot through the same Game calls a client would
+// make. After --simulate-time seconds the time the tick profiler measured in
+// each phase is reported and the server shuts down. Simulated players have no
+// character and are never saved.
+class Simulation
+{
+	public:
+		void configure(uint32_t players, uint32_t seconds) {
+			playerCount = players;
+			duration = seconds;
+		}
+
+		bool isEnabled() const {
+			return playerCount != 0;
+		}
+
+		bool isStarted() const {
+			return started;
+		}
+
+		// dispatcher thread, once the world is loaded
+		bool start();
+
+	private:
+		void act(uint32_t playerId);
+		void finish();
+
+		std::array<int64_t, TICK_PHASE_LAST> startTotals{};
+		std::chrono::steady_clock::time_point startTime;
+		uint64_t startAllocations = 0;
+
+		uint64_t steps = 0;
+		uint64_t casts = 0;
+		uint64_t attacks = 0;
+		uint64_t loots = 0;
+
+		uint32_t playerCount = 0;
+		uint32_t duration = 60;
+		uint32_t spawnedPlayers = 0;
+		bool started = false;
+		bool running = false;
+};
+
+extern Simulation g_simulation;
+
+#endif
@@ -37,6 +37,42 @@
 namespace Components {
     namespace Skills {
 
+        std::shared_ptr<const SkillDefinition> SkillDefinition::get(FormulaType form, uint16_t max, float x, float y, float z)
+        {
+            struct Key
+            {
+                FormulaType formula;
+                uint16_t max;
+                float x, y, z;
+
+                bool operator==(const Key&) const = default;
+            };
+
+            struct KeyHash
+            {
+                size_t operator()(const Key& key) const noexcept
+                {
+                    size_t seed = std::hash<uint8_t>{}(key.formula) ^ (std::hash<uint16_t>{}(key.max) << 8);
+                    for (const float value : {key.x, key.y, key.z})
+                    {
+                        seed ^= std::hash<float>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                    }
+                    return seed;
+                }
+            };
+
+            static std::mutex registry_lock;
+            static gtl::flat_hash_map<Key, std::shared_ptr<const SkillDefinition>, KeyHash> registry;
+
+            std::lock_guard<std::mutex> lock(registry_lock);
+            auto& definition = registry[Key{form, max, x, y, z}];
+            if (not definition)
+            {
+                definition = std::make_shared<const SkillDefinition>(form, max, x, y, z);
+            }
+            return definition;
+        }
+
         [[nodiscard]]
         FormulaType const ParseFormula(std::string_view modName) noexcept
         {
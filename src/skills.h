@@ -28,6 +28,9 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <algorithm>
 #include <gtl/phmap.hpp>
 #include "const.h"
 
@@ -41,15 +44,405 @@ namespace Components {
         static constexpr uint64_t PointMax = UINT64_MAX;
         static constexpr uint16_t LevelMax = UINT16_MAX;
 
+        // The points each level of a skill definition takes. Levels are worked
+        // out in chunks the first time they are asked for, later lookups read
+        // the table.
+        class SkillCurve {
+        public:
+            static constexpr uint32_t ChunkSize = 256;
+
+            template <typename Formula>
+            [[nodiscard]]
+            uint64_t required(uint64_t level, const Formula& formula)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                extend(level, formula);
+                return points[level];
+            }
+
+            // Moves level up while the points pay for the next one in full, not past
+            // last nor into a level that takes no points or more than PointMax.
+            // What is left of the points stays in points.
+            template <typename Formula>
+            void advance(uint64_t& level, uint64_t& remaining, uint64_t last, const Formula& formula)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                extend(level, formula);
+
+                [[unlikely]]
+                if (totals[level] == PointMax)
+                {
+                    return;
+                }
+
+                // a goal past PointMax is held below it, levels whose totals overflowed stay out of reach
+                const uint64_t goal = remaining >= PointMax - totals[level] ? PointMax - 1 : totals[level] + remaining;
+                while (points.size() - 1 < last and nextBarrier(level) == PointMax and totals.back() <= goal)
+                {
+                    extend(points.size(), formula);
+                }
+
+                const uint64_t upper = std::min<uint64_t>({last, nextBarrier(level) - 1, points.size() - 1});
+                if (upper <= level)
+                {
+                    return;
+                }
+
+                // the last level whose total the points reach
+                const auto it = std::upper_bound(totals.begin() + level + 1, totals.begin() + upper + 1, goal);
+                const uint64_t reached = static_cast<uint64_t>(it - totals.begin()) - 1;
+                remaining -= totals[reached] - totals[level];
+                level = reached;
+            }
+
+        private:
+            // levels up to and including level, rounded up to a whole chunk
+            template <typename Formula>
+            void extend(uint64_t level, const Formula& formula)
+            {
+                if (level < points.size())
+                {
+                    return;
+                }
+
+                const uint64_t end = std::min<uint64_t>((level / ChunkSize + 1) * ChunkSize, static_cast<uint64_t>(LevelMax) + 2);
+                points.reserve(end);
+                totals.reserve(end);
+                for (uint64_t next = points.size(); next < std::max<uint64_t>(end, level + 1); ++next)
+                {
+                    const uint64_t value = formula(next);
+                    if (value == 0 or value == PointMax)
+                    {
+                        barriers.push_back(next);
+                    }
+
+                    points.push_back(value);
+                    totals.push_back(value > PointMax - totals.back() ? PointMax : totals.back() + value);
+                }
+            }
+
+            // the first level above level that points can not reach
+            [[nodiscard]]
+            uint64_t nextBarrier(uint64_t level) const
+            {
+                const auto it = std::upper_bound(barriers.begin(), barriers.end(), level);
+                return it != barriers.end() ? *it : PointMax;
+            }
+
+            std::mutex mutex;
+            std::vector<uint64_t> points{0};
+            // the points of levels 1 to n added up, PointMax once they overflow
+            std::vector<uint64_t> totals{0};
+            // the levels that take no points or more than PointMax, the points stop below them
+            std::vector<uint64_t> barriers;
+        };
+
+        // What every owner of a skill shares: the formula, its values, the max
+        // level and the points of each level. Owners keep only their progress.
+        class SkillDefinition {
+        public:
+
+            SkillDefinition(FormulaType form, uint16_t max, float x, float y, float z) :
+                _multiplier(x),
+                _difficulty(y),
+                _threshold(z),
+                max_level(max),
+                _formula(form)
+            {
+                //
+            }
+
+            // one definition for each formula, max and values in use
+            static std::shared_ptr<const SkillDefinition> get(FormulaType form, uint16_t max, float x, float y, float z);
+
+            [[nodiscard]]
+            const float multiplier() const noexcept
+            {
+                return _multiplier;
+            }
+
+            [[nodiscard]]
+            const float difficulty() const noexcept
+            {
+                return _difficulty;
+            }
+
+            [[nodiscard]]
+            const float threshold() const noexcept
+            {
+                return _threshold;
+            }
+
+            [[nodiscard]]
+            const uint16_t max() const noexcept
+            {
+                return max_level;
+            }
+
+            [[nodiscard]]
+            const FormulaType formula() const noexcept
+            {
+                return _formula;
+            }
+
+            [[nodiscard]] 
+            uint64_t pointsRequired(uint64_t target_level) const
+            {
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                [[likely]]
+                if (target_level <= LevelMax)
+                {
+                    return curve.required(target_level, [this](uint64_t level) { return formulaPoints(level); });
+                }
+                return formulaPoints(target_level);
+            }
+
+            void advance(uint64_t& level, uint64_t& remaining, uint64_t last) const
+            {
+                curve.advance(level, remaining, last, [this](uint64_t level) { return formulaPoints(level); });
+            }
+
+        private:
+
+            float _multiplier = 1;
+            float _difficulty = 1;
+            float _threshold = 1;
+            uint16_t max_level = 0;  // Maximum allowed level, if 0, limit is numerical limit;
+            FormulaType _formula = FormulaType::EXPONENTIAL;
+            mutable SkillCurve curve;
+
+
+            [[nodiscard]]
+            constexpr uint64_t safeRound(double value) const
+            {
+                if (value >= static_cast<double>(PointMax)) {
+                    return PointMax;
+                }
+                if (value <= 0.0) {
+                    return 0;
+                }
+                return static_cast<uint64_t>(std::round(value));
+            }
+
+
+            uint64_t formulaPoints(uint64_t target_level) const
+            {
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                switch (_formula) 
+                {
+                    case FormulaType::LINEAR: return linearGrowth(target_level);
+                    case FormulaType::LOGARITHMIC: return logarithmicGrowth(target_level);
+                    case FormulaType::EXPONENTIAL: return exponentialGrowth(target_level);
+                    case FormulaType::QUADRATIC: return quadraticGrowth(target_level);
+                    case FormulaType::CUBIC: return cubicGrowth(target_level);
+                    case FormulaType::STEP: return stepGrowth(target_level);
+                    case FormulaType::ROOT: return rootGrowth(target_level);
+                    case FormulaType::INVERSE: return inverseGrowth(target_level);
+                }
+                return 0;
+            }
+
+            static constexpr uint64_t integerSqrt(uint64_t n)
+            {
+                uint64_t left = 0, right = n, ans = 0;
+                while (left <= right) 
+                {
+                    uint64_t mid = left + (right - left) / 2;
+                    if (mid <= n / mid) 
+                    {
+                        ans = mid;
+                        left = mid + 1;
+                    }
+                    else 
+                    {
+                        right = mid - 1;
+                    }
+                }
+                return ans;
+            }
+
+            static constexpr uint64_t integerPow(uint64_t base, uint64_t exp)
+            {
+                uint64_t result = 1;
+                while (exp) 
+                {
+                    if (exp & 1) 
+                    {
+                        [[unlikely]]
+                        if (result > PointMax / base)
+                        {
+                            return PointMax;
+                        }     
+                        result *= base;
+                    }
+                    exp >>= 1;
+
+                    [[unlikely]]
+                    if (exp and base > PointMax / base)
+                    {
+                        return PointMax;
+                    }
+                    base *= base;
+                }
+                return result;
+            }
+
+            [[nodiscard ("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t linearGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double result = static_cast<double>(_multiplier) * static_cast<double>(_difficulty)
+                    + static_cast<double>(_threshold) * static_cast<double>(target_level);
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t logarithmicGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double logLevel = std::log(static_cast<double>(target_level));
+                double result = static_cast<double>(_multiplier) * static_cast<double>(_difficulty)
+                    + static_cast<double>(_threshold) * logLevel;
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t exponentialGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double base = static_cast<double>(_difficulty);
+                double result = static_cast<double>(_threshold) * std::pow(base, (target_level - (static_cast<double>(_multiplier) + 1)));
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t quadraticGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double level = static_cast<double>(target_level);
+                double result = static_cast<double>(_multiplier)
+                    + static_cast<double>(_difficulty) * level * level
+                    + static_cast<double>(_threshold) * level;
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t cubicGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double level = static_cast<double>(target_level);
+                double result = static_cast<double>(_multiplier)
+                    + static_cast<double>(_difficulty) * level * level * level
+                    + static_cast<double>(_threshold) * level;
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t stepGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double steps = std::floor(static_cast<double>(target_level) / static_cast<double>(_multiplier));
+                double result = steps * static_cast<double>(_difficulty) + static_cast<double>(_threshold);
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t rootGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double sqrtLevel = std::sqrt(static_cast<double>(target_level));
+                double result = static_cast<double>(_multiplier) * sqrtLevel + static_cast<double>(_threshold);
+
+                return safeRound(result);
+            }
+
+            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
+            const uint64_t inverseGrowth(uint64_t target_level) const
+            {
+                // this is redundant extra protection, in case someone uses method elsewhere
+                [[unlikely]]
+                if (not target_level)
+                {
+                    return 0;
+                }
+
+                double inverse = 1.0 / static_cast<double>(target_level);
+                double result = static_cast<double>(_multiplier) * inverse * static_cast<double>(_difficulty)
+                    + static_cast<double>(_threshold);
+
+                return safeRound(result);
+            }
+        };
+
         class CustomSkill {
         public:
 
-            CustomSkill(uint8_t form = FormulaType::EXPONENTIAL, uint16_t max = 0, float x = 1.0, float y = 50, float z = 10) :
-                _multiplier(x),
-                _difficulty(y),
-                _threshold(z),
-                max_level(max),
-                _formula(static_cast<FormulaType>(form))
+            CustomSkill(uint8_t form = FormulaType::EXPONENTIAL, uint16_t max = 0, float x = 1.0, float y = 50, float z = 10) :
+                definition(SkillDefinition::get(static_cast<FormulaType>(form), max, x, y, z))
+            {
+                //
+            }
+
+            explicit CustomSkill(std::shared_ptr<const SkillDefinition> skill_definition) :
+                definition(std::move(skill_definition))
             {
                 //
             }
@@ -73,9 +466,9 @@ namespace Components {
             const uint64_t points() const noexcept 
             {
                 [[unlikely]]
-                if (max_level > 0 and current_level >= max_level) 
+                if (max() > 0 and current_level >= max()) 
                 {
-                    auto current = pointsRequired(max_level);
+                    auto current = pointsRequired(max());
                     return current;
                 }
                 [[likely]]
@@ -97,19 +490,19 @@ namespace Components {
             [[nodiscard]]
             const float multiplier() const noexcept
             {
-                return _multiplier;
+                return definition->multiplier();
             }
 
             [[nodiscard]]
             const float difficulty() const noexcept
             {
-                return _difficulty;
+                return definition->difficulty();
             }
 
             [[nodiscard]]
             const float threshold() const noexcept
             {
-                return _threshold;
+                return definition->threshold();
             }
 
             // It's worth noting that even tho we have a bonus level
@@ -144,13 +537,13 @@ namespace Components {
             [[nodiscard]]
             const uint16_t max() const noexcept
             {
-                return max_level;
+                return definition->max();
             }
 
             [[nodiscard]]
             const FormulaType formula() const noexcept
             {
-                return _formula;
+                return definition->formula();
             }
 
             bool addPoints(uint32_t points) noexcept
@@ -161,41 +554,37 @@ namespace Components {
                     return false;
                 }
 
-                auto temp_level = static_cast<uint64_t>(current_level);
-                auto temp_current_points = current_points;
+                const uint16_t max_level = max();
+                if (max_level and current_level >= max_level) 
+                {
+                    current_points = 0;
+                    return true;
+                }
+
+                uint64_t temp_level = current_level;
+                uint64_t remaining = points;
 
-                while (true) 
+                // the level in progress first, it may hold more points than it takes
+                uint64_t points_required = pointsRequired(temp_level + 1);
+                if (points_required == std::numeric_limits<uint64_t>::max() or points_required == 0
+                    or current_points > points_required or remaining < points_required - current_points)
                 {
-                    if (max_level and temp_level >= max_level) 
-                    {
-                        temp_current_points = 0;
-                        break;
-                    }
+                    current_points += remaining;
+                    return true;
+                }
 
-                    uint64_t points_required = pointsRequired(temp_level + 1);
-                    if (points_required == std::numeric_limits<uint64_t>::max() or points_required == 0)
-                    {
-                        temp_current_points += points;
-                        break;
-                    }
+                remaining -= points_required - current_points;
+                temp_level++;
 
-                    uint64_t excess_points = points_required - temp_current_points;
-                    if (points >= excess_points)
-                    {
-                        points -= excess_points;
-                        temp_level++;
-                        temp_current_points = 0;
-                    }
-                    else 
-                    {
-                        temp_current_points += points;
-                        points = 0;
-                        break;
-                    }
+                // then every level the rest pays for in one search of the table
+                const uint64_t last = max_level ? max_level : LevelMax;
+                if (temp_level < last)
+                {
+                    definition->advance(temp_level, remaining, last);
                 }
 
-                current_points = temp_current_points;
                 current_level = static_cast<uint16_t>(temp_level);
+                current_points = max_level and temp_level >= max_level ? 0 : remaining;
                 return true;
             }
 
@@ -252,6 +641,7 @@ namespace Components {
                     return false;
                 }
 
+                const uint16_t max_level = max();
                 uint64_t required = pointsRequired(current_level);
                 double percent = save_progress and required > 0 ? static_cast<double>(current_points) / required : 0.0;
                 current_level = max_level and (levels + current_level) >= max_level ? max_level : levels + current_level;
@@ -348,6 +738,21 @@ namespace Components {
                 return true;
             }
 
+            // puts back progress that was saved, without counting it up level by level
+            void restore(uint16_t level, uint64_t points, int16_t bonus) noexcept
+            {
+                const uint16_t max_level = max();
+                current_level = std::max<uint16_t>(1, max_level and level > max_level ? max_level : level);
+                current_points = max_level and current_level >= max_level ? 0 : points;
+                bonus_level = bonus;
+            }
+
+            [[nodiscard]]
+            const std::shared_ptr<const SkillDefinition>& getDefinition() const noexcept
+            {
+                return definition;
+            }
+
             void clearLevels(bool include_bonus)
             {
                 current_points = 0;
@@ -365,229 +770,16 @@ namespace Components {
 
         private:
 
-            uint64_t current_points = 0;
-            float _multiplier = 1;
-            float _difficulty = 1;
-            float _threshold = 1;
-            uint16_t current_level = 1;
-            int16_t bonus_level = 0;
-            uint16_t max_level = 0;  // Maximum allowed level, if 0, limit is numerical limit;
-            FormulaType _formula = FormulaType::EXPONENTIAL;
-
-            [[nodiscard]]
-            constexpr uint64_t safeRound(double value) const
-            {
-                if (value >= static_cast<double>(PointMax)) {
-                    return PointMax;
-                }
-                if (value <= 0.0) {
-                    return 0;
-                }
-                return static_cast<uint64_t>(std::round(value));
-            }
-
-
             [[nodiscard]] 
             uint64_t pointsRequired(uint64_t target_level) const
             {
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                switch (_formula) 
-                {
-                    case FormulaType::LINEAR: return linearGrowth(target_level);
-                    case FormulaType::LOGARITHMIC: return logarithmicGrowth(target_level);
-                    case FormulaType::EXPONENTIAL: return exponentialGrowth(target_level);
-                    case FormulaType::QUADRATIC: return quadraticGrowth(target_level);
-                    case FormulaType::CUBIC: return cubicGrowth(target_level);
-                    case FormulaType::STEP: return stepGrowth(target_level);
-                    case FormulaType::ROOT: return rootGrowth(target_level);
-                    case FormulaType::INVERSE: return inverseGrowth(target_level);
-                }
-                return 0;
-            }
-
-            static constexpr uint64_t integerSqrt(uint64_t n)
-            {
-                uint64_t left = 0, right = n, ans = 0;
-                while (left <= right) 
-                {
-                    uint64_t mid = left + (right - left) / 2;
-                    if (mid <= n / mid) 
-                    {
-                        ans = mid;
-                        left = mid + 1;
-                    }
-                    else 
-                    {
-                        right = mid - 1;
-                    }
-                }
-                return ans;
-            }
-
-            static constexpr uint64_t integerPow(uint64_t base, uint64_t exp)
-            {
-                uint64_t result = 1;
-                while (exp) 
-                {
-                    if (exp & 1) 
-                    {
-                        [[unlikely]]
-                        if (result > PointMax / base)
-                        {
-                            return PointMax;
-                        }     
-                        result *= base;
-                    }
-                    exp >>= 1;
-
-                    [[unlikely]]
-                    if (exp and base > PointMax / base)
-                    {
-                        return PointMax;
-                    }
-                    base *= base;
-                }
-                return result;
-            }
-
-            [[nodiscard ("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t linearGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double result = static_cast<double>(_multiplier) * static_cast<double>(_difficulty)
-                    + static_cast<double>(_threshold) * static_cast<double>(target_level);
-
-                return safeRound(result);
-            }
-
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t logarithmicGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double logLevel = std::log(static_cast<double>(target_level));
-                double result = static_cast<double>(_multiplier) * static_cast<double>(_difficulty)
-                    + static_cast<double>(_threshold) * logLevel;
-
-                return safeRound(result);
-            }
-
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t exponentialGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double base = static_cast<double>(_difficulty);
-                double result = static_cast<double>(_threshold) * std::pow(base, (target_level - (static_cast<double>(_multiplier) + 1)));
-
-                return safeRound(result);
-            }
-
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t quadraticGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double level = static_cast<double>(target_level);
-                double result = static_cast<double>(_multiplier)
-                    + static_cast<double>(_difficulty) * level * level
-                    + static_cast<double>(_threshold) * level;
-
-                return safeRound(result);
-            }
-
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t cubicGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double level = static_cast<double>(target_level);
-                double result = static_cast<double>(_multiplier)
-                    + static_cast<double>(_difficulty) * level * level * level
-                    + static_cast<double>(_threshold) * level;
-
-                return safeRound(result);
-            }
-
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t stepGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double steps = std::floor(static_cast<double>(target_level) / static_cast<double>(_multiplier));
-                double result = steps * static_cast<double>(_difficulty) + static_cast<double>(_threshold);
-
-                return safeRound(result);
-            }
-
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t rootGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double sqrtLevel = std::sqrt(static_cast<double>(target_level));
-                double result = static_cast<double>(_multiplier) * sqrtLevel + static_cast<double>(_threshold);
-
-                return safeRound(result);
+                return definition->pointsRequired(target_level);
             }
 
-            [[nodiscard("This is an internal method that should only be called when the return value is intended for use.")]]
-            const uint64_t inverseGrowth(uint64_t target_level) const
-            {
-                // this is redundant extra protection, in case someone uses method elsewhere
-                [[unlikely]]
-                if (not target_level)
-                {
-                    return 0;
-                }
-
-                double inverse = 1.0 / static_cast<double>(target_level);
-                double result = static_cast<double>(_multiplier) * inverse * static_cast<double>(_difficulty)
-                    + static_cast<double>(_threshold);
-
-                return safeRound(result);
-            }
+            std::shared_ptr<const SkillDefinition> definition;
+            uint64_t current_points = 0;
+            uint16_t current_level = 1;
+            int16_t bonus_level = 0;
         };
     }
 }
@@ -11,6 +11,7 @@
 
 #include "pugicast.h"
 #include "events.h"
+#include "tickprofiler.h"
 
 extern ConfigManager g_config;
 extern Monsters g_monsters;
@@ -206,15 +207,48 @@ void Spawns::startup()
 	}
 	npcList.clear();
 
+	// neighbouring spawns go in the same batch, so a batch touches few map nodes
+	startupQueue.clear();
+	startupIndex = 0;
 	for (Spawn& spawn : spawnList) {
-		spawn.startup();
+		startupQueue.push_back(&spawn);
 	}
+	std::ranges::sort(startupQueue, std::less<>(), [](const Spawn* spawn) {
+		const Position& pos = spawn->getCenterPos();
+		return std::make_tuple(pos.z, pos.y >> 6, pos.x >> 6, pos.y, pos.x);
+	});
 
+	startupEvent = g_scheduler.addEvent(createSchedulerTask(SPAWN_STARTUP_INTERVAL, [this]() { startupBatch(); }));
 	started = true;
 }
 
+void Spawns::startupBatch()
+{
+	startupEvent = 0;
+
+	const size_t last = std::min(startupIndex + SPAWN_STARTUP_BATCH, startupQueue.size());
+	for (; startupIndex < last; ++startupIndex) {
+		startupQueue[startupIndex]->startup();
+	}
+
+	if (isStartupPending()) {
+		startupEvent = g_scheduler.addEvent(createSchedulerTask(SPAWN_STARTUP_INTERVAL, [this]() { startupBatch(); }));
+	} else {
+		startupQueue.clear();
+		startupQueue.shrink_to_fit();
+		startupIndex = 0;
+	}
+}
+
 void Spawns::clear()
 {
+	if (startupEvent != 0) {
+		g_scheduler.stopEvent(startupEvent);
+		startupEvent = 0;
+	}
+	startupQueue.clear();
+	startupIndex = 0;
+
 	for (Spawn& spawn : spawnList) {
 		spawn.stopEvent();
 	}
@@ -252,6 +286,10 @@ Spawn::~Spawn()
 
 bool Spawn::findPlayer(const Position& pos)
 {
+	if (!g_game.map.mayHaveCreaturesNear(pos, false)) {
+		return false;
+	}
+
 	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, pos, false, true);
 	for (const auto& spectator : spectators) {
@@ -312,8 +350,9 @@ bool Spawn::spawnMonster(uint32_t spawnId, MonsterType* mType, const Position& p
 	}
 
 	if (startup) {
-		//No need to send out events to the surrounding since there is no one out there to listen!
-		if (!g_game.internalPlaceCreature(monster, pos, true)) {
+		// startup batches run after the world opened, only an empty world can skip the events
+		const bool placed = g_game.getPlayersOnline() == 0 ? g_game.internalPlaceCreature(monster, pos, true) : g_game.placeCreature(monster, pos, true);
+		if (!placed) {
 			std::cout << "[Warning - Spawns::startup] Couldn't spawn monster \"" << monster->getName() << "\" on position: " << pos << '.' << std::endl;
 			return false;
 		}
@@ -343,6 +382,7 @@ void Spawn::startup()
 
 void Spawn::checkSpawn()
 {
+	TickPhaseTimer timer(TICK_PHASE_SPAWNS);
 	checkSpawnEvent = 0;
 
 	cleanup();
@@ -14,6 +14,10 @@ class Monster;
 class MonsterType;
 class Npc;
 
+// startup spawning is spread over ticks once the world runs, this many spawns per tick
+static constexpr size_t SPAWN_STARTUP_BATCH = 64;
+static constexpr uint32_t SPAWN_STARTUP_INTERVAL = 50;
+
 struct spawnBlock_t {
 	Position pos;
 	std::vector<std::pair<MonsterType*, uint16_t>> mTypes;
@@ -39,6 +43,10 @@ class Spawn
 		uint32_t getInterval() const {
 			return interval;
 		}
+
+		const Position& getCenterPos() const {
+			return centerPos;
+		}
 	
 		void startup();
 		void startSpawnCheck();
@@ -74,13 +82,27 @@ class Spawns
 		void startup();
 		void clear();
 
+		bool isStartupPending() const {
+			return startupIndex < startupQueue.size();
+		}
+
 		bool isStarted() const {
 			return started;
 		}
 
+		const std::forward_list<Spawn>& getSpawnList() const {
+			return spawnList;
+		}
+
 	private:
+		void startupBatch();
+
 		std::forward_list<NpcPtr> npcList;
 		std::forward_list<Spawn> spawnList;
+		// spawns still waiting for their first monsters, ordered by map area
+		std::vector<Spawn*> startupQueue;
+		size_t startupIndex = 0;
+		uint32_t startupEvent = 0;
 		std::string filename;
 		bool loaded = false;
 		bool started = false;
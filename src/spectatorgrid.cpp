@@ -0,0 +1,142 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "spectatorgrid.h"
+#include "creature.h"
+
+void SpectatorGrid::addSector(const Position& pos)
+{
+	sectors.try_emplace(getSectorKey(pos.x, pos.y, pos.z));
+}
+
+void SpectatorGrid::addCreature(const CreaturePtr& creature, const Position& pos)
+{
+	Sector* sector = getSector(pos);
+	if (!sector) {
+		// creatures only ever stand on tiles, but better safe than lost
+		sector = &sectors[getSectorKey(pos.x, pos.y, pos.z)];
+	}
+
+	sector->creatures.push_back(creature);
+	sector->positions.push_back(packPosition(pos));
+	sector->players.push_back(creature->getPlayer() ? 1 : 0);
+}
+
+void SpectatorGrid::removeCreature(const CreaturePtr& creature, const Position& pos)
+{
+	Sector* sector = getSector(pos);
+	if (!sector) {
+		return;
+	}
+
+	auto& creatures = sector->creatures;
+	const auto it = std::ranges::find(creatures, creature);
+	if (it == creatures.end()) {
+		return;
+	}
+
+	const size_t index = it - creatures.begin();
+	const size_t last = creatures.size() - 1;
+	if (index != last) {
+		creatures[index] = std::move(creatures[last]);
+		sector->positions[index] = sector->positions[last];
+		sector->players[index] = sector->players[last];
+	}
+
+	creatures.pop_back();
+	sector->positions.pop_back();
+	sector->players.pop_back();
+}
+
+void SpectatorGrid::moveCreature(const CreaturePtr& creature, const Position& oldPos, const Position& newPos)
+{
+	if (getSectorKey(oldPos.x, oldPos.y, oldPos.z) != getSectorKey(newPos.x, newPos.y, newPos.z)) {
+		removeCreature(creature, oldPos);
+		addCreature(creature, newPos);
+		return;
+	}
+
+	// same sector, only the packed coordinate changes
+	if (Sector* sector = getSector(oldPos)) {
+		if (const auto it = std::ranges::find(sector->creatures, creature); it != sector->creatures.end()) {
+			sector->positions[it - sector->creatures.begin()] = packPosition(newPos);
+		}
+	}
+}
+
+void SpectatorGrid::getSpectators(SpectatorVec& spectators, const Position& centerPos,
+                                  int32_t minX, int32_t maxX, int32_t minY, int32_t maxY,
+                                  int32_t minZ, int32_t maxZ, bool onlyPlayers, const ChunkKey* cacheKey) const
+{
+	// scratch space for the match flags of one sector
+	std::vector<uint8_t> matches;
+
+	for (int32_t z = minZ; z <= maxZ; ++z) {
+		// floors above look further away, the same shift getSpectatorsInternal applies
+		const int32_t offsetZ = Position::getOffsetZ(centerPos, Position(centerPos.x, centerPos.y, z));
+		const int32_t lowX = std::max<int32_t>(0, minX + offsetZ);
+		const int32_t highX = std::min<int32_t>(0xFFFF, maxX + offsetZ);
+		const int32_t lowY = std::max<int32_t>(0, minY + offsetZ);
+		const int32_t highY = std::min<int32_t>(0xFFFF, maxY + offsetZ);
+		if (lowX > highX || lowY > highY) {
+			continue;
+		}
+
+		const uint32_t widthX = highX - lowX;
+		const uint32_t widthY = highY - lowY;
+
+		for (int32_t sy = lowY >> SPECTATOR_SECTOR_BITS; sy <= (highY >> SPECTATOR_SECTOR_BITS); ++sy) {
+			for (int32_t sx = lowX >> SPECTATOR_SECTOR_BITS; sx <= (highX >> SPECTATOR_SECTOR_BITS); ++sx) {
+				const auto it = sectors.find(getSectorKey(sx << SPECTATOR_SECTOR_BITS, sy << SPECTATOR_SECTOR_BITS, z));
+				if (it == sectors.end()) {
+					continue;
+				}
+
+				const Sector& sector = it->second;
+				if (cacheKey) {
+					// the caller holds the lock guarding the key sets
+					auto& keys = const_cast<Sector&>(sector).cacheKeys;
+					if (!keys) {
+						keys = std::make_unique<gtl::flat_hash_set<ChunkKey, ChunkKeyHash, ChunkKeyEqual>>();
+					}
+					keys->insert(*cacheKey);
+				}
+
+				const size_t count = sector.positions.size();
+				if (count == 0) {
+					continue;
+				}
+
+				// plain loop over packed coordinates, simple enough for the compiler to vectorize
+				matches.resize(count);
+				const uint32_t* positions = sector.positions.data();
+				const uint8_t* players = sector.players.data();
+				for (size_t i = 0; i < count; ++i) {
+					const uint32_t x = positions[i] & 0xFFFF;
+					const uint32_t y = positions[i] >> 16;
+					const bool inRange = (x - lowX) <= widthX && (y - lowY) <= widthY;
+					matches[i] = inRange & (!onlyPlayers | players[i]);
+				}
+
+				for (size_t i = 0; i < count; ++i) {
+					if (matches[i]) {
+						spectators.emplace_back(sector.creatures[i]);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SpectatorGrid::takeCacheKeys(const Position& pos, std::vector<ChunkKey>& keys)
+{
+	Sector* sector = getSector(pos);
+	if (!sector || !sector->cacheKeys) {
+		return;
+	}
+
+	keys.insert(keys.end(), sector->cacheKeys->begin(), sector->cacheKeys->end());
+	sector->cacheKeys->clear();
+}
@@ -0,0 +1,64 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_SPECTATORGRID_H
+#define FS_SPECTATORGRID_H
+
+#include "declarations.h"
+#include "position.h"
+#include "spectators.h"
+
+#include <gtl/phmap.hpp>
+
+// sectors are as big as a quadtree leaf but there is one per floor
+static constexpr int32_t SPECTATOR_SECTOR_BITS = 3;
+static constexpr int32_t SPECTATOR_SECTOR_SIZE = (1 << SPECTATOR_SECTOR_BITS);
+
+// Alternative spectator index, built with SPECTATOR_GRID. Creatures are kept
+// per floor in flat 8x8 sectors next to a packed copy of their coordinates,
+// so a query is a handful of lookups and a branch-free filter over arrays.
+class SpectatorGrid
+{
+	public:
+		// sectors only exist where the map has tiles, queries never create them
+		void addSector(const Position& pos);
+
+		void addCreature(const CreaturePtr& creature, const Position& pos);
+		void removeCreature(const CreaturePtr& creature, const Position& pos);
+		void moveCreature(const CreaturePtr& creature, const Position& oldPos, const Position& newPos);
+
+		// the box is in absolute coordinates at centerPos.z, other floors are shifted by their z offset
+		void getSpectators(SpectatorVec& spectators, const Position& centerPos,
+		                   int32_t minX, int32_t maxX, int32_t minY, int32_t maxY,
+		                   int32_t minZ, int32_t maxZ, bool onlyPlayers, const ChunkKey* cacheKey) const;
+
+		// hands over the cache keys registered on the sector of pos
+		void takeCacheKeys(const Position& pos, std::vector<ChunkKey>& keys);
+
+	private:
+		struct Sector
+		{
+			std::vector<CreaturePtr> creatures;
+			// x | y << 16, same order as creatures
+			std::vector<uint32_t> positions;
+			std::vector<uint8_t> players;
+			std::unique_ptr<gtl::flat_hash_set<ChunkKey, ChunkKeyHash, ChunkKeyEqual>> cacheKeys;
+		};
+
+		static uint64_t getSectorKey(uint16_t x, uint16_t y, uint8_t z) {
+			return (static_cast<uint64_t>(z) << 32) | (static_cast<uint64_t>(y >> SPECTATOR_SECTOR_BITS) << 16) | (x >> SPECTATOR_SECTOR_BITS);
+		}
+
+		static uint32_t packPosition(const Position& pos) {
+			return pos.x | (static_cast<uint32_t>(pos.y) << 16);
+		}
+
+		Sector* getSector(const Position& pos) {
+			auto it = sectors.find(getSectorKey(pos.x, pos.y, pos.z));
+			return it != sectors.end() ? &it->second : nullptr;
+		}
+
+		gtl::flat_hash_map<uint64_t, Sector> sectors;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #ifndef FS_SPECTATORS_H
 #define FS_SPECTATORS_H
 
+#include <array>
 #include <vector>
 
 class Creature;
@@ -41,6 +42,7 @@ public:
 	}
 
 	size_t size() const { return vec.size(); }
+	size_t capacity() const { return vec.capacity(); }
 	bool empty() const { return vec.empty(); }
 	Iterator begin() { return vec.begin(); }
 	ConstIterator begin() const { return vec.begin(); }
@@ -52,4 +54,91 @@ private:
 	Vec vec;
 };
 
+// Borrowed spectators for results consumed inside the same dispatcher task.
+// The first entries live inline so the common query neither allocates nor
+// touches a reference count. Nothing that can remove a creature from the map
+// may run while a view is iterated, keep a SpectatorVec for that.
+class SpectatorView
+{
+	static constexpr size_t INLINE_CAPACITY = 32;
+public:
+	SpectatorView() = default;
+
+	// non-copyable
+	SpectatorView(const SpectatorView&) = delete;
+	SpectatorView& operator=(const SpectatorView&) = delete;
+
+	void addSpectators(const SpectatorVec& spectators) {
+		const bool unique = empty();
+		for (const CreaturePtr& spectator : spectators) {
+			if (!unique && std::find(begin(), end(), spectator.get()) != end()) {
+				continue;
+			}
+			emplace_back(spectator.get());
+		}
+	}
+
+	void emplace_back(Creature* c) {
+		if (heap.empty()) {
+			if (count < INLINE_CAPACITY) {
+				inlineBuffer[count++] = c;
+				return;
+			}
+			heap.reserve(INLINE_CAPACITY * 2);
+			heap.assign(inlineBuffer.begin(), inlineBuffer.end());
+		}
+		heap.push_back(c);
+		++count;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	Creature* const* begin() const { return heap.empty() ? inlineBuffer.data() : heap.data(); }
+	Creature* const* end() const { return begin() + count; }
+
+private:
+	std::array<Creature*, INLINE_CAPACITY> inlineBuffer;
+	std::vector<Creature*> heap;
+	size_t count = 0;
+};
+
+// compared field by field, a key built on the stack has undefined padding
+struct ChunkKey {
+	int32_t minRangeX, maxRangeX, minRangeY, maxRangeY;
+	uint16_t x, y;
+	uint8_t z;
+	bool multifloor, onlyPlayers;
+
+	bool operator==(const ChunkKey& other) const noexcept {
+		return minRangeX == other.minRangeX && maxRangeX == other.maxRangeX && minRangeY == other.minRangeY && maxRangeY == other.maxRangeY &&
+		       x == other.x && y == other.y && z == other.z && multifloor == other.multifloor && onlyPlayers == other.onlyPlayers;
+	}
+};
+
+struct ChunkKeyHash {
+	std::size_t operator()(const ChunkKey& key) const noexcept {
+		std::size_t hash = 0;
+		hash_combine(hash, key.minRangeX, key.maxRangeX, key.minRangeY, key.maxRangeY,
+					 key.x, key.y, key.z, key.multifloor, key.onlyPlayers);
+		return hash;
+	}
+
+private:
+	template <typename... Args>
+	static void hash_combine(std::size_t& seed, Args&&... args) {
+		(hash_combine_impl(seed, std::forward<Args>(args)), ...);
+	}
+
+	template <typename T>
+	static void hash_combine_impl(std::size_t& seed, const T& v) {
+		seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+};
+
+struct ChunkKeyEqual {
+	bool operator()(const ChunkKey& lhs, const ChunkKey& rhs) const noexcept {
+		return lhs == rhs;
+	}
+};
+
 #endif
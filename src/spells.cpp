@@ -100,6 +100,11 @@ void Spells::clearMaps(bool fromLua)
 			++rune;
 		}
 	}
+
+	runeLookup.clear();
+	runeLookupSize = 0;
+	instantLookup.clear();
+	instantLookupSize = 0;
 }
 
 void Spells::clear(bool fromLua)
@@ -188,16 +193,64 @@ Spell* Spells::getSpellByName(const std::string& name)
 
 RuneSpell* Spells::getRuneSpell(uint32_t id)
 {
-	auto it = runes.find(id);
-	if (it == runes.end()) {
-		for (auto& rune : runes) {
-			if (rune.second.getId() == id) {
-				return &rune.second;
+	if (runeLookupSize != runes.size()) {
+		updateRuneLookup();
+	}
+	return id < runeLookup.size() ? runeLookup[id] : nullptr;
+}
+
+void Spells::updateInstantLookup()
+{
+	instantLookup.clear();
+	instantWordLengths.clear();
+	instantFirstLetters.reset();
+	instantLookupSize = instants.size();
+
+	// the first of the spells whose words only differ in case, as the search through all of them found
+	for (auto& it : instants) {
+		const std::string& spellWords = it.second.getWords();
+		if (spellWords.empty()) {
+			continue;
+		}
+
+		const auto result = instantLookup.emplace(asLowerCaseString(spellWords), &it.second);
+		if (result.second) {
+			const char first = result.first->first.front();
+			instantWordLengths.push_back(spellWords.length());
+			instantFirstLetters.set(static_cast<uint8_t>(first));
+			if (first >= 'a' && first <= 'z') {
+				instantFirstLetters.set(static_cast<uint8_t>(first - 'a' + 'A'));
 			}
 		}
-		return nullptr;
 	}
-	return &it->second;
+
+	std::sort(instantWordLengths.begin(), instantWordLengths.end(), std::greater<>());
+	instantWordLengths.erase(std::unique(instantWordLengths.begin(), instantWordLengths.end()), instantWordLengths.end());
+}
+
+void Spells::updateRuneLookup()
+{
+	runeLookup.clear();
+	runeLookupSize = runes.size();
+	if (runes.empty()) {
+		return;
+	}
+
+	size_t size = runes.rbegin()->first + 1;
+	for (const auto& rune : runes) {
+		size = std::max<size_t>(size, rune.second.getId() + 1);
+	}
+	runeLookup.assign(size, nullptr);
+
+	// the rune item id first, the spell id for ids no rune is made of
+	for (auto& rune : runes) {
+		runeLookup[rune.first] = &rune.second;
+	}
+	for (auto& rune : runes) {
+		if (!runeLookup[rune.second.getId()]) {
+			runeLookup[rune.second.getId()] = &rune.second;
+		}
+	}
 }
 
 RuneSpell* Spells::getRuneSpellByName(const std::string& name)
@@ -212,18 +265,28 @@ RuneSpell* Spells::getRuneSpellByName(const std::string& name)
 
 InstantSpell* Spells::getInstantSpell(const std::string& words)
 {
+	if (instantLookupSize != instants.size()) {
+		updateInstantLookup();
+	}
+
+	// most of what is said is no spell
+	if (words.empty() || !instantFirstLetters[static_cast<uint8_t>(words.front())]) {
+		return nullptr;
+	}
+
+	// the longest words the line starts with
+	const std::string lowerWords = asLowerCaseString(words);
+	std::string prefix;
 	InstantSpell* result = nullptr;
+	for (const size_t length : instantWordLengths) {
+		if (length > lowerWords.length()) {
+			continue;
+		}
 
-	for (auto& it : instants) {
-		const std::string& instantSpellWords = it.second.getWords();
-		size_t spellLen = instantSpellWords.length();
-		if (caseInsensitiveStartsWith(words, instantSpellWords)) {
-			if (!result || spellLen > result->getWords().size()) {
-				result = &it.second;
-				if (words.length() == spellLen) {
-					break;
-				}
-			}
+		prefix.assign(lowerWords, 0, length);
+		if (const auto it = instantLookup.find(prefix); it != instantLookup.end()) {
+			result = it->second;
+			break;
 		}
 	}
 
@@ -345,8 +408,7 @@ bool CombatSpell::executeCastSpell(const CreaturePtr& creature, const LuaVariant
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 
 	LuaScriptInterface::pushVariant(L, var);
 
@@ -1035,8 +1097,7 @@ bool InstantSpell::executeCastSpell(const CreaturePtr& creature, const LuaVarian
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 
 	LuaScriptInterface::pushVariant(L, var);
 
@@ -1212,8 +1273,7 @@ bool RuneSpell::executeCastSpell(const CreaturePtr& creature, const LuaVariant&
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, creature);
-	LuaScriptInterface::setCreatureMetatable(L, -1, creature);
+	LuaScriptInterface::pushCreature(L, creature);
 
 	LuaScriptInterface::pushVariant(L, var);
 
@@ -9,6 +9,8 @@
 #include "talkaction.h"
 #include "baseevents.h"
 
+#include <bitset>
+
 class InstantSpell;
 class RuneSpell;
 class Spell;
@@ -53,9 +55,23 @@ class Spells final : public BaseEvents
 		Event_ptr getEvent(const std::string& nodeName) override;
 		bool registerEvent(Event_ptr event, const pugi::xml_node& node) override;
 
+		void updateRuneLookup();
+		void updateInstantLookup();
+
 		std::map<uint16_t, RuneSpell> runes;
 		std::map<std::string, InstantSpell> instants;
 
+		// what getRuneSpell finds by id, rebuilt once the number of runes changed since
+		std::vector<RuneSpell*> runeLookup;
+		size_t runeLookupSize = 0;
+
+		// the same for getInstantSpell, the spells by their words in lower case, the lengths
+		// of the words from the longest down and the letters they start with
+		gtl::flat_hash_map<std::string, InstantSpell*> instantLookup;
+		std::vector<size_t> instantWordLengths;
+		std::bitset<256> instantFirstLetters;
+		size_t instantLookupSize = 0;
+
 		friend class CombatSpell;
 		LuaScriptInterface scriptInterface { "Spell Interface" };
 };
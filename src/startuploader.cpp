@@ -0,0 +1,136 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "startuploader.h"
+
+#include "tools.h"
+
+StartupLoader::Stage StartupLoader::add(std::string name, std::string errorMessage, std::function<bool()> load, std::initializer_list<Stage> dependencies/* = {}*/, bool concurrent/* = false*/)
+{
+	Entry& entry = entries.emplace_back();
+	entry.name = std::move(name);
+	entry.errorMessage = std::move(errorMessage);
+	entry.load = std::move(load);
+	entry.dependencies = dependencies;
+	entry.concurrent = concurrent;
+	return entries.size() - 1;
+}
+
+bool StartupLoader::isReady(const Entry& entry) const
+{
+	return std::all_of(entry.dependencies.begin(), entry.dependencies.end(), [this](Stage dependency) {
+		return entries[dependency].state == STAGE_DONE;
+	});
+}
+
+void StartupLoader::runStage(Stage stage)
+{
+	// the entries are not added to while running, the reference stays valid
+	Entry& entry = entries[stage];
+	const int64_t start = OTSYS_TIME();
+
+	bool success;
+	try {
+		success = entry.load();
+	} catch (const std::exception& e) {
+		std::cout << "[Error - StartupLoader::run] " << entry.name << ": " << e.what() << std::endl;
+		success = false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lockGuard(lock);
+		entry.duration = OTSYS_TIME() - start;
+		entry.state = success ? STAGE_DONE : STAGE_FAILED;
+	}
+	signal.notify_all();
+}
+
+bool StartupLoader::run()
+{
+	const int64_t start = OTSYS_TIME();
+	bool failed = false;
+
+	std::unique_lock<std::mutex> lockGuard(lock);
+	while (true) {
+		size_t running = 0;
+		size_t pending = 0;
+		Entry* failure = nullptr;
+		for (Entry& entry : entries) {
+			if (entry.state == STAGE_RUNNING) {
+				++running;
+			} else if (entry.state == STAGE_PENDING) {
+				++pending;
+			} else if (entry.state == STAGE_FAILED && !failure) {
+				failure = &entry;
+			}
+		}
+
+		if (failure && !failed) {
+			errorMessage = failure->errorMessage;
+			failed = true;
+		}
+
+		if (failed || pending == 0) {
+			if (running == 0) {
+				break;
+			}
+			signal.wait(lockGuard);
+			continue;
+		}
+
+		// concurrent stages start as soon as they can, they never hold up the calling thread
+		for (Stage stage = 0; stage < entries.size(); ++stage) {
+			Entry& entry = entries[stage];
+			if (entry.concurrent && entry.state == STAGE_PENDING && isReady(entry)) {
+				std::cout << ">> Loading " << entry.name << std::endl;
+				entry.state = STAGE_RUNNING;
+				++running;
+				threads.emplace_back(&StartupLoader::runStage, this, stage);
+			}
+		}
+
+		// the calling thread takes its stages in order
+		Stage next = entries.size();
+		for (Stage stage = 0; stage < entries.size(); ++stage) {
+			const Entry& entry = entries[stage];
+			if (!entry.concurrent && entry.state == STAGE_PENDING) {
+				next = stage;
+				break;
+			}
+		}
+
+		if (next != entries.size() && isReady(entries[next])) {
+			std::cout << ">> Loading " << entries[next].name << std::endl;
+			entries[next].state = STAGE_RUNNING;
+			lockGuard.unlock();
+			runStage(next);
+			lockGuard.lock();
+			continue;
+		}
+
+		if (running == 0) {
+			// nothing runs and nothing can start, a dependency is never added or never done
+			errorMessage = "Startup stages depend on each other in a cycle.";
+			failed = true;
+			break;
+		}
+		signal.wait(lockGuard);
+	}
+	lockGuard.unlock();
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	threads.clear();
+
+	if (!failed) {
+		std::cout << ">> Loaded in " << (OTSYS_TIME() - start) / (1000.) << " s:";
+		for (const Entry& entry : entries) {
+			std::cout << ' ' << entry.name << ' ' << entry.duration / (1000.) << " s" << (&entry != &entries.back() ? "," : "");
+		}
+		std::cout << std::endl;
+	}
+	return !failed;
+}
@@ -0,0 +1,61 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_STARTUPLOADER_H
+#define FS_STARTUPLOADER_H
+
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// Runs the startup stages as soon as the stages they depend on are done.
+// Stages that touch Lua or anything else one thread owns run on the calling
+// thread in the order they were added, concurrent stages get a thread each
+// and run alongside them. Every stage is timed, run prints the timings once
+// all stages are done.
+class StartupLoader
+{
+	public:
+		using Stage = size_t;
+
+		// load returns false on failure, errorMessage is what run reports then
+		Stage add(std::string name, std::string errorMessage, std::function<bool()> load, std::initializer_list<Stage> dependencies = {}, bool concurrent = false);
+
+		// false once a stage failed, the stages already running are waited for
+		bool run();
+
+		const std::string& getErrorMessage() const {
+			return errorMessage;
+		}
+
+	private:
+		enum StageState_t : uint8_t {
+			STAGE_PENDING,
+			STAGE_RUNNING,
+			STAGE_DONE,
+			STAGE_FAILED,
+		};
+
+		struct Entry
+		{
+			std::string name;
+			std::string errorMessage;
+			std::function<bool()> load;
+			std::vector<Stage> dependencies;
+			int64_t duration = 0;
+			StageState_t state = STAGE_PENDING;
+			bool concurrent;
+		};
+
+		// every dependency is done, called with lock held
+		bool isReady(const Entry& entry) const;
+		void runStage(Stage stage);
+
+		std::vector<Entry> entries;
+		std::vector<std::thread> threads;
+		std::mutex lock;
+		std::condition_variable signal;
+		std::string errorMessage;
+};
+
+#endif
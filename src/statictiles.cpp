@@ -0,0 +1,47 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "statictiles.h"
+#include "item.h"
+
+void StaticTileLayer::add(const uint16_t x, const uint16_t y, const uint8_t z, const uint32_t flags, const std::vector<uint16_t>& ids)
+{
+	records[getKey(x, y, z)] = {flags, static_cast<uint32_t>(itemIds.size()), static_cast<uint16_t>(ids.size())};
+	itemIds.insert(itemIds.end(), ids.begin(), ids.end());
+}
+
+bool StaticTileLayer::take(const uint16_t x, const uint16_t y, const uint8_t z, uint32_t& flags, std::vector<uint16_t>& ids)
+{
+	const auto it = records.find(getKey(x, y, z));
+	if (it == records.end()) {
+		return false;
+	}
+
+	const Record& record = it->second;
+	flags = record.flags;
+	ids.assign(itemIds.begin() + record.offset, itemIds.begin() + record.offset + record.count);
+	records.erase(it);
+
+	if (records.empty()) {
+		itemIds.clear();
+		itemIds.shrink_to_fit();
+	}
+	return true;
+}
+
+bool StaticTileLayer::isStaticItem(const uint16_t id)
+{
+	if (id >= Item::items.size()) {
+		return false;
+	}
+
+	const ItemType& it = Item::items[id];
+	if (it.id == 0 || it.type != ITEM_TYPE_NONE || it.isContainer()) {
+		return false;
+	}
+
+	// decaying items are scheduled as soon as they are loaded
+	return it.decayTo < 0 || it.decayTime == 0;
+}
@@ -0,0 +1,53 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_STATICTILES_H
+#define FS_STATICTILES_H
+
+#include <gtl/phmap.hpp>
+
+// Tiles IOMap found to hold nothing but plain items, kept as packed item ids
+// until Map is first asked for them. A map that is mostly walls and scenery
+// then never allocates Tile or Item objects for the parts nobody visits.
+class StaticTileLayer
+{
+	public:
+		// item ids are in map file order, ground first as IOMap reads them
+		void add(uint16_t x, uint16_t y, uint8_t z, uint32_t flags, const std::vector<uint16_t>& ids);
+
+		// hands over and forgets the record of a position
+		bool take(uint16_t x, uint16_t y, uint8_t z, uint32_t& flags, std::vector<uint16_t>& ids);
+
+		// items without behaviour, state or a decay that has to start at load
+		static bool isStaticItem(uint16_t id);
+
+		bool empty() const {
+			return records.empty();
+		}
+
+		size_t size() const {
+			return records.size();
+		}
+
+		size_t getMemoryUsage() const {
+			return records.size() * (sizeof(uint64_t) + sizeof(Record)) + itemIds.capacity() * sizeof(uint16_t);
+		}
+
+	private:
+		struct Record
+		{
+			uint32_t flags;
+			uint32_t offset;
+			uint16_t count;
+		};
+
+		static uint64_t getKey(uint16_t x, uint16_t y, uint8_t z) {
+			return (static_cast<uint64_t>(z) << 32) | (static_cast<uint64_t>(y) << 16) | x;
+		}
+
+		gtl::flat_hash_map<uint64_t, Record> records;
+		// taken records leave their ids behind until the layer is empty
+		std::vector<uint16_t> itemIds;
+};
+
+#endif
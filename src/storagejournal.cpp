@@ -0,0 +1,175 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "storagejournal.h"
+#include "configmanager.h"
+#include "databasetasks.h"
+#include "playerjournal.h"
+#include "scheduler.h"
+
+#include <fmt/format.h>
+
+extern ConfigManager g_config;
+extern Scheduler g_scheduler;
+
+// keeps the flushes in order, player saves use their guid which never gets this high
+static constexpr uint64_t STORAGE_JOURNAL_TASK_KEY = 1ULL << 63;
+
+// by StorageTable_t
+static constexpr std::array<std::string_view, STORAGE_TABLE_LAST> storageTables = {
+	"player_storage",
+	"account_storage",
+};
+
+static constexpr std::array<std::string_view, STORAGE_TABLE_LAST> storageOwnerColumns = {
+	"player_id",
+	"account_id",
+};
+
+// rows of one delete
+static constexpr size_t STORAGE_DELETE_BATCH = 1000;
+
+void StorageJournal::record(StorageTable_t table, uint32_t owner, uint32_t key, int32_t value)
+{
+	pending[table][getKey(owner, key)] = value;
+	g_playerJournal.recordStorage(table, owner, key, value);
+}
+
+bool StorageJournal::flush()
+{
+	if (std::all_of(pending.begin(), pending.end(), [](const Changes& changes) { return changes.empty(); })) {
+		return true;
+	}
+
+	auto batch = std::make_shared<Batch>();
+	batch->changes.swap(pending);
+	batch->journalSequence = g_playerJournal.getSequence();
+	batch->number = ++batches;
+	inFlight.push_back(batch);
+
+	const bool queued = g_databaseTasks.addJob(
+		[batch](Database& db) {
+			// the journal comes first, a crash then never finds the database ahead of it
+			g_playerJournal.waitDurable(batch->journalSequence);
+			return write(db, *batch);
+		},
+		[this, batch](bool success) { finish(batch, success); },
+		STORAGE_JOURNAL_TASK_KEY);
+	if (queued) {
+		return true;
+	}
+
+	// the database thread is stopping, write it here
+	g_playerJournal.waitDurable(batch->journalSequence);
+	const bool success = write(Database::getInstance(), *batch);
+	finish(batch, success);
+	return success;
+}
+
+void StorageJournal::start()
+{
+	flush();
+
+	const int64_t interval = std::max<int64_t>(100, g_config.getNumber(ConfigManager::STORAGE_FLUSH_INTERVAL));
+	g_scheduler.addEvent(createSchedulerTask(interval, [this]() { start(); }));
+}
+
+bool StorageJournal::write(Database& db, const Batch& batch)
+{
+	DBTransaction transaction(db);
+	if (!transaction.begin()) {
+		return false;
+	}
+
+	for (size_t table = 0; table < STORAGE_TABLE_LAST; ++table) {
+		if (!writeTable(db, static_cast<StorageTable_t>(table), batch.changes[table])) {
+			return false;
+		}
+	}
+
+	return transaction.commit();
+}
+
+bool StorageJournal::writeTable(Database& db, StorageTable_t table, const Changes& changes)
+{
+	if (changes.empty()) {
+		return true;
+	}
+
+	DBInsert upsert(fmt::format("INSERT INTO `{:s}` (`{:s}`, `key`, `value`) VALUES ", storageTables[table], storageOwnerColumns[table]));
+	upsert.setUpsert("`value` = VALUES(`value`)");
+	upsert.hold();
+
+	std::string deletion;
+	size_t deletionRows = 0;
+	for (const auto& [key, value] : changes) {
+		const uint32_t owner = static_cast<uint32_t>(key >> 32);
+		if (value != -1) {
+			upsert.beginRow();
+			upsert.addNumber(owner);
+			upsert.addNumber(static_cast<uint32_t>(key));
+			upsert.addNumber(value);
+			upsert.endRow();
+			continue;
+		}
+
+		if (deletionRows == 0) {
+			deletion = fmt::format("DELETE FROM `{:s}` WHERE (`{:s}`, `key`) IN (", storageTables[table], storageOwnerColumns[table]);
+		} else {
+			deletion.push_back(',');
+		}
+		fmt::format_to(std::back_inserter(deletion), "({:d},{:d})", owner, static_cast<uint32_t>(key));
+
+		if (++deletionRows == STORAGE_DELETE_BATCH) {
+			deletion.push_back(')');
+			if (!db.executeQuery(deletion)) {
+				return false;
+			}
+			deletionRows = 0;
+		}
+	}
+
+	if (deletionRows != 0) {
+		deletion.push_back(')');
+		if (!db.executeQuery(deletion)) {
+			return false;
+		}
+	}
+
+	return upsert.release(db);
+}
+
+void StorageJournal::finish(const std::shared_ptr<Batch>& batch, bool success)
+{
+	auto it = std::find(inFlight.begin(), inFlight.end(), batch);
+	if (it == inFlight.end()) {
+		return;
+	}
+	it = inFlight.erase(it);
+
+	if (success) {
+		// a batch taken before a failure was merged back does not hold the failed changes
+		if (batch->number > retriedBatch) {
+			g_playerJournal.recordStorageSaved(batch->journalSequence);
+		}
+		return;
+	}
+
+	retriedBatch = batches;
+
+	std::cout << "[Error - StorageJournal::flush] Storage values could not be saved, they are tried again with the next flush." << std::endl;
+
+	// the batch goes out again, except for the keys written since
+	for (size_t table = 0; table < STORAGE_TABLE_LAST; ++table) {
+		for (const auto& change : batch->changes[table]) {
+			const bool overwritten = std::any_of(it, inFlight.end(), [&](const std::shared_ptr<Batch>& later) {
+				return later->changes[table].contains(change.first);
+			});
+			if (!overwritten) {
+				pending[table].insert(change);
+			}
+		}
+	}
+}
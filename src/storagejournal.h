@@ -0,0 +1,82 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_STORAGEJOURNAL_H
+#define FS_STORAGEJOURNAL_H
+
+#include <gtl/btree.hpp>
+
+class Database;
+
+enum StorageTable_t : uint8_t {
+	STORAGE_TABLE_PLAYER,
+	STORAGE_TABLE_ACCOUNT,
+
+	STORAGE_TABLE_LAST
+};
+
+// Write-behind log of storage values. Every write is kept by owner and key,
+// the last one wins, and flush sends what changed since the previous flush
+// to the database thread as one upsert and one delete per table. Entries stay
+// readable until their write is committed, so a player logging in again
+// before that sees the values the server already knows about.
+// Only used from the dispatcher.
+class StorageJournal
+{
+	public:
+		// value -1 removes the key
+		void record(StorageTable_t table, uint32_t owner, uint32_t key, int32_t value);
+
+		// calls f(key, value) for every change of owner not yet committed, oldest first
+		template <typename F>
+		void forEachChange(StorageTable_t table, uint32_t owner, F&& f) const {
+			for (const auto& batch : inFlight) {
+				forEachChange(batch->changes[table], owner, f);
+			}
+			forEachChange(pending[table], owner, f);
+		}
+
+		// hands the pending changes to the database thread, false if writing them failed
+		// right away because the thread is not running
+		bool flush();
+
+		// flushes now and again every storageFlushInterval milliseconds
+		void start();
+
+		// owner in the high half, key in the low half, in that order
+		using Changes = gtl::btree_map<uint64_t, int32_t>;
+
+		static uint64_t getKey(uint32_t owner, uint32_t key) {
+			return (static_cast<uint64_t>(owner) << 32) | key;
+		}
+
+		// one upsert and the deletes of the changes of table, inside the transaction of the caller
+		static bool writeTable(Database& db, StorageTable_t table, const Changes& changes);
+
+	private:
+		struct Batch
+		{
+			std::array<Changes, STORAGE_TABLE_LAST> changes;
+			// of the player journal when the batch was taken
+			uint64_t journalSequence = 0;
+			uint64_t number = 0;
+		};
+
+		template <typename F>
+		static void forEachChange(const Changes& changes, uint32_t owner, F&& f) {
+			for (auto it = changes.lower_bound(getKey(owner, 0)); it != changes.end() && (it->first >> 32) == owner; ++it) {
+				f(static_cast<uint32_t>(it->first), it->second);
+			}
+		}
+
+		static bool write(Database& db, const Batch& batch);
+		void finish(const std::shared_ptr<Batch>& batch, bool success);
+
+		std::array<Changes, STORAGE_TABLE_LAST> pending;
+		std::list<std::shared_ptr<Batch>> inFlight;
+		uint64_t batches = 0;
+		// batches up to this one were taken before the last failure was merged back into pending
+		uint64_t retriedBatch = 0;
+};
+
+#endif
@@ -0,0 +1,16 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "storagemap.h"
+
+uint32_t StorageMap::hotStart = 0;
+uint32_t StorageMap::hotSize = 0;
+
+void StorageMap::setHotRange(uint32_t start, uint32_t size)
+{
+	hotStart = start;
+	// keys past the end of uint32_t can not be stored in the pages
+	hotSize = std::min<uint64_t>(size, std::numeric_limits<uint32_t>::max() - start);
+}
@@ -0,0 +1,99 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_STORAGEMAP_H
+#define FS_STORAGEMAP_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <gtl/phmap.hpp>
+
+// The storage values of a player. Keys of the hot range, where the scripts of
+// a datapack keep their quests, live in pages of a dense array allocated as
+// they are first written, every other key in a flat hash map. A missing value
+// reads as -1, like it does for scripts, and writing -1 removes it.
+class StorageMap
+{
+	public:
+		static constexpr uint32_t PAGE_SIZE = 256;
+
+		// the same for every player, set once before the first one is loaded
+		static void setHotRange(uint32_t start, uint32_t size);
+
+		bool get(uint32_t key, int32_t& value) const {
+			if (const uint32_t offset = key - hotStart; offset < hotSize) {
+				const uint32_t page = offset / PAGE_SIZE;
+				value = page < pages.size() && pages[page] ? (*pages[page])[offset % PAGE_SIZE] : -1;
+				return value != -1;
+			}
+
+			const auto it = values.find(key);
+			if (it == values.end()) {
+				value = -1;
+				return false;
+			}
+
+			value = it->second;
+			return true;
+		}
+
+		void set(uint32_t key, int32_t value) {
+			if (const uint32_t offset = key - hotStart; offset < hotSize) {
+				const uint32_t page = offset / PAGE_SIZE;
+				if (page >= pages.size()) {
+					if (value == -1) {
+						return;
+					}
+					pages.resize(page + 1);
+				}
+
+				if (!pages[page]) {
+					if (value == -1) {
+						return;
+					}
+					pages[page] = std::make_unique<Page>();
+					pages[page]->fill(-1);
+				}
+				(*pages[page])[offset % PAGE_SIZE] = value;
+				return;
+			}
+
+			if (value == -1) {
+				values.erase(key);
+			} else {
+				values[key] = value;
+			}
+		}
+
+		// every key holding a value, in no particular order
+		template <typename Function>
+		void forEach(Function&& function) const {
+			for (uint32_t page = 0; page < pages.size(); ++page) {
+				if (!pages[page]) {
+					continue;
+				}
+
+				for (uint32_t i = 0; i < PAGE_SIZE; ++i) {
+					if (const int32_t value = (*pages[page])[i]; value != -1) {
+						function(hotStart + page * PAGE_SIZE + i, value);
+					}
+				}
+			}
+
+			for (const auto& [key, value] : values) {
+				function(key, value);
+			}
+		}
+
+	private:
+		using Page = std::array<int32_t, PAGE_SIZE>;
+
+		static uint32_t hotStart;
+		static uint32_t hotSize;
+
+		std::vector<std::unique_ptr<Page>> pages;
+		gtl::flat_hash_map<uint32_t, int32_t> values;
+};
+
+#endif
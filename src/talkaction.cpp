@@ -27,10 +27,29 @@ void TalkActions::clear(bool fromLua)
 			++it;
 		}
 	}
+	rebuildWordsIndex();
 
 	reInitState(fromLua);
 }
 
+void TalkActions::indexWords(TalkActionMap::const_iterator it)
+{
+	auto& entries = wordsIndex[asLowerCaseString(it->first)];
+	entries.insert(std::upper_bound(entries.begin(), entries.end(), it, [](const auto& lhs, const auto& rhs) {
+		return lhs->first < rhs->first;
+	}), it);
+	maxWordsLength = std::max(maxWordsLength, it->first.size());
+}
+
+void TalkActions::rebuildWordsIndex()
+{
+	wordsIndex.clear();
+	maxWordsLength = 0;
+	for (auto it = talkActions.cbegin(); it != talkActions.cend(); ++it) {
+		indexWords(it);
+	}
+}
+
 LuaScriptInterface& TalkActions::getScriptInterface()
 {
 	return scriptInterface;
@@ -50,10 +69,9 @@ bool TalkActions::registerEvent(Event_ptr event, const pugi::xml_node&)
 	std::vector<std::string> words = talkAction->getWordsMap();
 
 	for (size_t i = 0; i < words.size(); i++) {
-		if (i == words.size() - 1) {
-			talkActions.emplace(words[i], std::move(*talkAction));
-		} else {
-			talkActions.emplace(words[i], *talkAction);
+		const auto [it, inserted] = i == words.size() - 1 ? talkActions.emplace(words[i], std::move(*talkAction)) : talkActions.emplace(words[i], *talkAction);
+		if (inserted) {
+			indexWords(it);
 		}
 	}
 
@@ -66,10 +84,9 @@ bool TalkActions::registerLuaEvent(TalkAction* event)
 	std::vector<std::string> words = talkAction->getWordsMap();
 
 	for (size_t i = 0; i < words.size(); i++) {
-		if (i == words.size() - 1) {
-			talkActions.emplace(words[i], std::move(*talkAction));
-		} else {
-			talkActions.emplace(words[i], *talkAction);
+		const auto [it, inserted] = i == words.size() - 1 ? talkActions.emplace(words[i], std::move(*talkAction)) : talkActions.emplace(words[i], *talkAction);
+		if (inserted) {
+			indexWords(it);
 		}
 	}
 
@@ -79,18 +96,37 @@ bool TalkActions::registerLuaEvent(TalkAction* event)
 TalkActionResult_t TalkActions::playerSaySpell(const PlayerPtr& player, SpeakClasses type, const std::string& words) const
 {
 	size_t wordsLength = words.length();
-	for (auto it = talkActions.begin(); it != talkActions.end(); ) {
-		const std::string& talkactionWords = it->first;
-		if (!caseInsensitiveStartsWith(words, talkactionWords)) {
-			++it;
+	if (wordsLength == 0 || wordsIndex.empty()) {
+		return TALKACTION_CONTINUE;
+	}
+
+	// talkaction words are followed by a space or the end of what was said,
+	// so only the lengths ending there are looked up
+	std::string prefix = asLowerCaseString(words.substr(0, maxWordsLength));
+	std::vector<TalkActionMap::const_iterator> candidates;
+	for (size_t length = prefix.size(); length > 0; --length) {
+		if (length != wordsLength && words[length] != ' ') {
 			continue;
 		}
 
+		prefix.resize(length);
+		if (auto entries = wordsIndex.find(prefix); entries != wordsIndex.end()) {
+			candidates.insert(candidates.end(), entries->second.begin(), entries->second.end());
+		}
+	}
+
+	// tried in the order of the words, as they were when all were compared
+	std::sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs->first < rhs->first;
+	});
+
+	for (const auto& it : candidates) {
+		const std::string& talkactionWords = it->first;
+
 		std::string param;
 		if (wordsLength != talkactionWords.size()) {
 			param = words.substr(talkactionWords.size());
 			if (param.front() != ' ') {
-				++it;
 				continue;
 			}
 			trim_left(param, ' ');
@@ -99,7 +135,6 @@ TalkActionResult_t TalkActions::playerSaySpell(const PlayerPtr& player, SpeakCla
 			if (separator != " ") {
 				if (!param.empty()) {
 					if (param != separator) {
-						++it;
 						continue;
 					} else {
 						param.erase(param.begin());
@@ -161,8 +196,7 @@ bool TalkAction::executeSay(const PlayerPtr& player, const std::string& words, c
 
 	scriptInterface->pushFunction(scriptId);
 
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 
 	LuaScriptInterface::pushString(L, words);
 	LuaScriptInterface::pushString(L, param);
@@ -91,7 +91,15 @@ class TalkActions final : public BaseEvents
 		Event_ptr getEvent(const std::string& nodeName) override;
 		bool registerEvent(Event_ptr event, const pugi::xml_node& node) override;
 
-		std::map<std::string, TalkAction> talkActions;
+		using TalkActionMap = std::map<std::string, TalkAction>;
+
+		void indexWords(TalkActionMap::const_iterator it);
+		void rebuildWordsIndex();
+
+		TalkActionMap talkActions;
+		// lower case words to the talkactions said with them, in the order of talkActions
+		gtl::flat_hash_map<std::string, std::vector<TalkActionMap::const_iterator>> wordsIndex;
+		size_t maxWordsLength = 0;
 
 		LuaScriptInterface scriptInterface;
 };
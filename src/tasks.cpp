@@ -4,78 +4,235 @@
 #include "otpch.h"
 
 #include "tasks.h"
+#include "allocprofiler.h"
 #include "game.h"
+#include "configmanager.h"
+#include "threadrole.h"
+#include "tracing.h"
 
 extern Game g_game;
+extern ConfigManager g_config;
 
-Task* createTask(TaskFunc&& f)
+namespace {
+
+uint32_t getLaneWeight(DispatcherLane_t lane)
+{
+	static constexpr ConfigManager::integer_config_t laneWeights[DISPATCHER_LANE_LAST] = {
+		ConfigManager::DISPATCHER_WEIGHT_PLAYER,
+		ConfigManager::DISPATCHER_WEIGHT_CREATURE,
+		ConfigManager::DISPATCHER_WEIGHT_DEFAULT,
+		ConfigManager::DISPATCHER_WEIGHT_BACKGROUND,
+	};
+
+	// the config isn't loaded yet while the server is starting up
+	return std::max<int32_t>(1, g_config.getNumber(laneWeights[lane]));
+}
+
+}
+
+Task* createTask(TaskFunc&& f, DispatcherLane_t lane/* = DISPATCHER_LANE_DEFAULT*/, const std::source_location& location/* = std::source_location::current()*/)
 {
-	return new Task(std::move(f));
+	return new Task(std::move(f), lane, location);
 }
 
-Task* createTask(uint32_t expiration, TaskFunc&& f)
+Task* createTask(uint32_t expiration, TaskFunc&& f, DispatcherLane_t lane/* = DISPATCHER_LANE_DEFAULT*/, const std::source_location& location/* = std::source_location::current()*/)
 {
-	return new Task(expiration, std::move(f));
+	return new Task(expiration, std::move(f), lane, location);
 }
 
 void Dispatcher::threadMain()
 {
+	setThreadRole("dispatcher");
+
 	std::vector<Task*> tmpTaskList;
-	// NOTE: second argument defer_lock is to prevent from immediate locking
-	std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
+	tmpTaskList.reserve(DISPATCHER_BATCH_SIZE);
+
+	std::array<uint32_t, DISPATCHER_LANE_LAST> weights;
 
 	while (getState() != THREAD_STATE_TERMINATED) {
-		// check if there are tasks waiting
-		taskLockUnique.lock();
-		if (taskList.empty()) {
-			//if the list is empty wait for signal
-			taskSignal.wait(taskLockUnique);
+		for (size_t lane = 0; lane < DISPATCHER_LANE_LAST; ++lane) {
+			weights[lane] = getLaneWeight(static_cast<DispatcherLane_t>(lane));
 		}
-		tmpTaskList.swap(taskList);
-		taskLockUnique.unlock();
 
+		// weighted round robin, every round takes up to weight tasks from each
+		// lane in priority order so a flooded lane can't starve the others
+		bool tookAny = true;
+		while (tookAny && tmpTaskList.size() < DISPATCHER_BATCH_SIZE) {
+			tookAny = false;
+			for (size_t lane = 0; lane < DISPATCHER_LANE_LAST && tmpTaskList.size() < DISPATCHER_BATCH_SIZE; ++lane) {
+				for (uint32_t i = 0; i < weights[lane] && tmpTaskList.size() < DISPATCHER_BATCH_SIZE; ++i) {
+					Task* task = taskQueues[lane].pop();
+					if (!task) {
+						break;
+					}
+					tmpTaskList.push_back(task);
+					tookAny = true;
+				}
+			}
+		}
+
+		if (tmpTaskList.empty()) {
+			if (hasPendingTasks()) {
+				// a producer is in the middle of a push, it will be visible in a moment
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (idleHook && idleHook()) {
+				continue;
+			}
+
+			const uint32_t signal = wakeupSignal.load(std::memory_order_acquire);
+			idle.store(true, std::memory_order_seq_cst);
+			if (!hasPendingTasks()) {
+				//if the queue is empty wait for signal
+				wakeupSignal.wait(signal, std::memory_order_acquire);
+			}
+			idle.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		queueSize.fetch_sub(tmpTaskList.size(), std::memory_order_relaxed);
+
+		// one timestamp for the whole batch, a backed up queue drops its stale
+		// player requests here without asking the clock for every single one
+		const auto now = std::chrono::steady_clock::now();
+
+		uint32_t expiredTasks = 0;
 		for (Task* task : tmpTaskList) {
-			if (!task->hasExpired()) {
-				++dispatcherCycle;
-				// execute it
+			if (task->hasExpired(now)) {
+				++expiredTasks;
+				delete task;
+				continue;
+			}
+
+			++dispatcherCycle;
+			AllocationScope allocations(task->getLocation().function_name());
+			// execute it
+			const bool sampled = stats.shouldSample();
+			const bool traced = TraceRecorder::isRecording();
+			if (sampled || traced) {
+				const auto start = std::chrono::steady_clock::now();
+				(*task)();
+				const auto end = std::chrono::steady_clock::now();
+
+				using std::chrono::duration_cast;
+				using std::chrono::microseconds;
+				if (sampled) {
+					stats.addSample(task->getLocation(), duration_cast<microseconds>(start - task->enqueueTime).count(), duration_cast<microseconds>(end - start).count());
+				}
+				if (traced) {
+					g_traceRecorder.add(task->getLocation().function_name(), "dispatcher", start, end);
+				}
+			} else {
 				(*task)();
 			}
 			delete task;
 		}
 		tmpTaskList.clear();
+
+		if (batchCompleteHook) {
+			batchCompleteHook(now);
+		}
+
+		if (expiredTasks != 0) {
+			stats.addExpired(expiredTasks);
+		}
+	}
+
+	// release whatever was still queued when we were terminated
+	for (TaskQueue& taskQueue : taskQueues) {
+		while (Task* task = taskQueue.pop()) {
+			delete task;
+		}
 	}
 }
 
-void Dispatcher::addTask(Task* task)
+bool Dispatcher::hasPendingTasks() const
 {
-	bool do_signal = false;
+	return std::any_of(taskQueues.begin(), taskQueues.end(), [](const TaskQueue& taskQueue) { return !taskQueue.empty(); });
+}
 
-	taskLock.lock();
+void Dispatcher::wakeup()
+{
+	// send a signal only if the consumer is waiting for one
+	if (idle.load(std::memory_order_seq_cst) && idle.exchange(false, std::memory_order_seq_cst)) {
+		wakeupSignal.fetch_add(1, std::memory_order_release);
+		wakeupSignal.notify_one();
+	}
+}
 
-	if (getState() == THREAD_STATE_RUNNING) {
-		do_signal = taskList.empty();
-		taskList.push_back(task);
-	} else {
+void Dispatcher::addTask(Task* task)
+{
+	if (getState() != THREAD_STATE_RUNNING) {
 		delete task;
+		return;
+	}
+
+	task->enqueueTime = std::chrono::steady_clock::now();
+	queueSize.fetch_add(1, std::memory_order_relaxed);
+	taskQueues[task->getLane()].push(task);
+	wakeup();
+}
+
+void Dispatcher::addJob(std::unique_ptr<DispatcherJob> job, DispatcherLane_t lane/* = DISPATCHER_LANE_BACKGROUND*/)
+{
+	addTask([this, job = std::move(job), lane]() mutable { runJob(job, lane); }, lane);
+}
+
+void Dispatcher::runJob(std::unique_ptr<DispatcherJob>& job, DispatcherLane_t lane)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(g_config.getNumber(ConfigManager::DISPATCHER_JOB_BUDGET));
+	do {
+		if (job->step()) {
+			return;
+		}
+	} while (std::chrono::steady_clock::now() < deadline);
+
+	// budget used up, continue after whatever got queued in the meantime
+	addJob(std::move(job), lane);
+}
+
+void Dispatcher::addTasks(std::vector<Task*>& tasks)
+{
+	if (tasks.empty()) {
+		return;
 	}
 
-	taskLock.unlock();
+	if (getState() != THREAD_STATE_RUNNING) {
+		for (Task* task : tasks) {
+			delete task;
+		}
+	} else {
+		const auto now = std::chrono::steady_clock::now();
+		for (Task* task : tasks) {
+			task->enqueueTime = now;
+		}
 
-	// send a signal if the list was empty
-	if (do_signal) {
-		taskSignal.notify_one();
+		queueSize.fetch_add(tasks.size(), std::memory_order_relaxed);
+
+		// split the batch by lane, keeping the relative order inside every lane
+		thread_local std::array<std::vector<Task*>, DISPATCHER_LANE_LAST> laneTasks;
+		for (Task* task : tasks) {
+			laneTasks[task->getLane()].push_back(task);
+		}
+
+		for (size_t lane = 0; lane < DISPATCHER_LANE_LAST; ++lane) {
+			taskQueues[lane].push(laneTasks[lane]);
+			laneTasks[lane].clear();
+		}
+		wakeup();
 	}
+	tasks.clear();
 }
 
 void Dispatcher::shutdown()
 {
 	Task* task = createTask([this]() {
 		setState(THREAD_STATE_TERMINATED);
-		taskSignal.notify_one();
 	});
 
-	std::lock_guard<std::mutex> lockClass(taskLock);
-	taskList.push_back(task);
-
-	taskSignal.notify_one();
+	queueSize.fetch_add(1, std::memory_order_relaxed);
+	taskQueues[task->getLane()].push(task);
+	wakeup();
 }
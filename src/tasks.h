@@ -4,59 +4,329 @@
 #ifndef FS_TASKS_H
 #define FS_TASKS_H
 
-#include <condition_variable>
+#include <array>
+#include <atomic>
+#include <source_location>
+#include <type_traits>
 #include "thread_holder_base.h"
 #include "enums.h"
+#include "lockfree.h"
+#include "taskstats.h"
+
+// Move-only replacement for std::function<void(void)>, callables that fit
+// in the inline buffer (the vast majority of our lambdas) never touch the heap
+class TaskFunc
+{
+	public:
+		TaskFunc() = default;
+		TaskFunc(std::nullptr_t) {}
+
+		template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, TaskFunc>>>
+		TaskFunc(F&& f) {
+			using Callable = std::decay_t<F>;
+			if constexpr (fitsInline<Callable>()) {
+				new (storage) Callable(std::forward<F>(f));
+				ops = &inlineOps<Callable>;
+			} else {
+				*reinterpret_cast<Callable**>(storage) = new Callable(std::forward<F>(f));
+				ops = &heapOps<Callable>;
+			}
+		}
+
+		// non-copyable
+		TaskFunc(const TaskFunc&) = delete;
+		TaskFunc& operator=(const TaskFunc&) = delete;
+
+		TaskFunc(TaskFunc&& other) noexcept {
+			moveFrom(other);
+		}
+
+		TaskFunc& operator=(TaskFunc&& other) noexcept {
+			if (this != &other) {
+				reset();
+				moveFrom(other);
+			}
+			return *this;
+		}
+
+		~TaskFunc() {
+			reset();
+		}
+
+		void operator()() const {
+			ops->invoke(storage);
+		}
+
+		explicit operator bool() const {
+			return ops != nullptr;
+		}
+
+	private:
+		// room for a player id, a few values and two strings, which covers the
+		// parse tasks carrying text from a packet such as a say or a text window
+		static constexpr size_t INLINE_STORAGE_SIZE = 96;
+
+		struct Ops
+		{
+			void (*invoke)(void* storage);
+			void (*move)(void* dst, void* src);
+			void (*destroy)(void* storage);
+		};
+
+		template <typename Callable>
+		static constexpr bool fitsInline() {
+			return sizeof(Callable) <= INLINE_STORAGE_SIZE && alignof(Callable) <= alignof(std::max_align_t) &&
+			       std::is_nothrow_move_constructible_v<Callable>;
+		}
+
+		template <typename Callable>
+		static constexpr Ops inlineOps = {
+			[](void* s) { (*static_cast<Callable*>(s))(); },
+			[](void* dst, void* src) {
+				new (dst) Callable(std::move(*static_cast<Callable*>(src)));
+				static_cast<Callable*>(src)->~Callable();
+			},
+			[](void* s) { static_cast<Callable*>(s)->~Callable(); },
+		};
+
+		template <typename Callable>
+		static constexpr Ops heapOps = {
+			[](void* s) { (**static_cast<Callable**>(s))(); },
+			[](void* dst, void* src) { *static_cast<Callable**>(dst) = *static_cast<Callable**>(src); },
+			[](void* s) { delete *static_cast<Callable**>(s); },
+		};
+
+		void moveFrom(TaskFunc& other) noexcept {
+			if (other.ops) {
+				other.ops->move(storage, other.storage);
+				ops = std::exchange(other.ops, nullptr);
+			}
+		}
+
+		void reset() {
+			if (ops) {
+				ops->destroy(storage);
+				ops = nullptr;
+			}
+		}
+
+		const Ops* ops = nullptr;
+		alignas(std::max_align_t) mutable unsigned char storage[INLINE_STORAGE_SIZE];
+};
+
+enum DispatcherLane_t : uint8_t {
+	DISPATCHER_LANE_PLAYER, // actions parsed from player packets
+	DISPATCHER_LANE_CREATURE, // creature think, walk and attack checks
+	DISPATCHER_LANE_DEFAULT,
+	DISPATCHER_LANE_BACKGROUND, // database callbacks, global events, raids, market expiry
+
+	DISPATCHER_LANE_LAST /* this must be the last one */
+};
 
-using TaskFunc = std::function<void(void)>;
 const int DISPATCHER_TASK_EXPIRATION = 2000;
-const auto SYSTEM_TIME_ZERO = std::chrono::system_clock::time_point(std::chrono::milliseconds(0));
+// upper bound of tasks taken off the queue and evaluated against one timestamp
+const size_t DISPATCHER_BATCH_SIZE = 256;
+const uint16_t TASK_FREE_LIST_CAPACITY = 8192;
+const auto TASK_NEVER_EXPIRES = std::chrono::steady_clock::time_point::max();
 
 class Task
 {
 	public:
 		// DO NOT allocate this class on the stack
-		explicit Task(TaskFunc&& f) : func(std::move(f)) {}
-		Task(uint32_t ms, TaskFunc&& f) :
-			expiration(std::chrono::system_clock::now() + std::chrono::milliseconds(ms)), func(std::move(f)) {}
+		explicit Task(TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current()) :
+			func(std::move(f)), location(location), lane(lane) {}
+		Task(uint32_t ms, TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current()) :
+			expiration(std::chrono::steady_clock::now() + std::chrono::milliseconds(ms)), func(std::move(f)), location(location), lane(lane) {}
 
 		virtual ~Task() = default;
+
+		// tasks are created and destroyed at a very high rate, so recycle their memory
+		static void* operator new(size_t size) {
+			if (size != sizeof(Task)) {
+				return ::operator new(size);
+			}
+			return LockfreePoolingAllocator<Task, TASK_FREE_LIST_CAPACITY>().allocate(1);
+		}
+
+		static void operator delete(void* p, size_t size) {
+			if (size != sizeof(Task)) {
+				::operator delete(p);
+				return;
+			}
+			LockfreePoolingAllocator<Task, TASK_FREE_LIST_CAPACITY>().deallocate(static_cast<Task*>(p), 1);
+		}
+
 		void operator()() const
 		{
 			func();
 		}
 
 		void setDontExpire() {
-			expiration = SYSTEM_TIME_ZERO;
+			expiration = TASK_NEVER_EXPIRES;
 		}
 
-		bool hasExpired() const {
-			if (expiration == SYSTEM_TIME_ZERO) {
-				return false;
-			}
-			return expiration < std::chrono::system_clock::now();
+		// now is sampled once per dispatcher batch, expiration is monotonic so
+		// wall clock adjustments can't drop or keep tasks by accident
+		bool hasExpired(std::chrono::steady_clock::time_point now) const {
+			return expiration < now;
+		}
+
+		// where the task was created, used to attribute dispatcher time
+		const std::source_location& getLocation() const {
+			return location;
+		}
+
+		DispatcherLane_t getLane() const {
+			return lane;
+		}
+
+		void setLane(DispatcherLane_t newLane) {
+			lane = newLane;
 		}
 
 	protected:
-		std::chrono::system_clock::time_point expiration = SYSTEM_TIME_ZERO;
+		std::chrono::steady_clock::time_point expiration = TASK_NEVER_EXPIRES;
 
 	private:
 		// Expiration has another meaning for scheduler tasks,
 		// then it is the time the task should be added to the
 		// dispatcher
 		TaskFunc func;
+
+		std::source_location location;
+		std::chrono::steady_clock::time_point enqueueTime;
+		DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT;
+
+		// intrusive link used by TaskQueue
+		std::atomic<Task*> next{nullptr};
+
+		friend class TaskQueue;
+		friend class Dispatcher;
 };
 
-Task* createTask(TaskFunc&& f);
-Task* createTask(uint32_t expiration, TaskFunc&& f);
+// Intrusive lock-free multi-producer/single-consumer queue (Vyukov),
+// push may be called from any thread, pop and empty only from the consumer
+class TaskQueue
+{
+	public:
+		TaskQueue() : head(&stub), tail(&stub) {}
+
+		// non-copyable
+		TaskQueue(const TaskQueue&) = delete;
+		TaskQueue& operator=(const TaskQueue&) = delete;
+
+		void push(Task* task) {
+			task->next.store(nullptr, std::memory_order_relaxed);
+			Task* prev = head.exchange(task, std::memory_order_seq_cst);
+			prev->next.store(task, std::memory_order_release);
+		}
+
+		// links a whole batch in with a single exchange, keeping its order
+		void push(const std::vector<Task*>& tasks) {
+			if (tasks.empty()) {
+				return;
+			}
+
+			for (size_t i = 1; i < tasks.size(); ++i) {
+				tasks[i - 1]->next.store(tasks[i], std::memory_order_relaxed);
+			}
+
+			Task* last = tasks.back();
+			last->next.store(nullptr, std::memory_order_relaxed);
+			Task* prev = head.exchange(last, std::memory_order_seq_cst);
+			prev->next.store(tasks.front(), std::memory_order_release);
+		}
+
+		// returns nullptr when the queue is empty or a producer is halfway through a push
+		Task* pop() {
+			Task* first = tail;
+			Task* next = first->next.load(std::memory_order_acquire);
+			if (first == &stub) {
+				if (!next) {
+					return nullptr;
+				}
+				tail = next;
+				first = next;
+				next = next->next.load(std::memory_order_acquire);
+			}
+
+			if (next) {
+				tail = next;
+				return first;
+			}
+
+			if (first != head.load(std::memory_order_acquire)) {
+				return nullptr;
+			}
+
+			push(&stub);
+
+			next = first->next.load(std::memory_order_acquire);
+			if (next) {
+				tail = next;
+				return first;
+			}
+			return nullptr;
+		}
+
+		bool empty() const {
+			return head.load(std::memory_order_seq_cst) == tail && tail->next.load(std::memory_order_acquire) == nullptr;
+		}
+
+	private:
+		std::atomic<Task*> head;
+		Task* tail;
+		Task stub{nullptr};
+};
+
+Task* createTask(TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current());
+Task* createTask(uint32_t expiration, TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current());
+
+// Long running game thread work broken into small steps. Once queued the
+// dispatcher keeps calling step() until the time budget of the cycle is spent,
+// then puts the job back at the end of its lane so other tasks get to run.
+class DispatcherJob
+{
+	public:
+		virtual ~DispatcherJob() = default;
+
+		// does one unit of work, returns true when there is nothing left to do
+		virtual bool step() = 0;
+
+		// runs every remaining step right away, for callers that can't wait
+		void complete() {
+			while (!step()) {}
+		}
+};
 
 class Dispatcher : public ThreadHolder<Dispatcher> {
 	public:
 		void addTask(Task* task);
+		// hands over every task in one go, tasks is left empty
+		void addTasks(std::vector<Task*>& tasks);
 
-		void addTask(TaskFunc&& f) { addTask(new Task(std::move(f))); }
+		void addTask(TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current()) {
+			addTask(new Task(std::move(f), lane, location));
+		}
 
-		void addTask(uint32_t expiration, TaskFunc&& f) { addTask(new Task(expiration, std::move(f))); }
+		void addTask(uint32_t expiration, TaskFunc&& f, DispatcherLane_t lane = DISPATCHER_LANE_DEFAULT, const std::source_location& location = std::source_location::current()) {
+			addTask(new Task(expiration, std::move(f), lane, location));
+		}
+
+		void addJob(std::unique_ptr<DispatcherJob> job, DispatcherLane_t lane = DISPATCHER_LANE_BACKGROUND);
+
+		// runs on the dispatcher thread after every batch of tasks with the time the
+		// batch started at, set before start
+		using BatchCompleteHook = std::function<void(std::chrono::steady_clock::time_point)>;
+		void setBatchCompleteHook(BatchCompleteHook hook) {
+			batchCompleteHook = std::move(hook);
+		}
+
+		// runs on the dispatcher thread when no task is waiting, before it goes to
+		// sleep, returns true to be called again once the queues were looked at
+		void setIdleHook(std::function<bool()> hook) {
+			idleHook = std::move(hook);
+		}
 
 		void shutdown();
 
@@ -64,17 +334,39 @@ class Dispatcher : public ThreadHolder<Dispatcher> {
 			return dispatcherCycle;
 		}
 
+		// number of tasks waiting to be executed
+		uint32_t getQueueSize() const {
+			return std::max<int64_t>(0, queueSize.load(std::memory_order_relaxed));
+		}
+
+		// dispatcher thread only
+		TaskStats& getStats() {
+			return stats;
+		}
+
 		void threadMain();
 
 	private:
-		std::mutex taskLock;
-		std::condition_variable taskSignal;
+		void wakeup();
+		bool hasPendingTasks() const;
+		void runJob(std::unique_ptr<DispatcherJob>& job, DispatcherLane_t lane);
+
+		// every lane is a FIFO of its own, the game thread drains them by weight
+		std::array<TaskQueue, DISPATCHER_LANE_LAST> taskQueues;
+
+		// the consumer only sleeps after announcing it through idle, so producers
+		// skip the futex wakeup entirely while the game thread is busy
+		std::atomic<bool> idle{false};
+		std::atomic<uint32_t> wakeupSignal{0};
+
+		std::atomic<int64_t> queueSize{0};
+		TaskStats stats;
+		BatchCompleteHook batchCompleteHook;
+		std::function<bool()> idleHook;
 
-		std::vector<Task*> taskList;
 		uint64_t dispatcherCycle = 0;
 };
 
 extern Dispatcher g_dispatcher;
-extern Dispatcher g_dispatcher_discord;
 
 #endif
@@ -0,0 +1,50 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "taskstats.h"
+
+#include <bit>
+
+void LatencyHistogram::add(uint64_t micros)
+{
+	// bucket i holds values in [2^(i-1), 2^i)
+	++buckets[std::bit_width(micros)];
+	++count;
+	sum += micros;
+	max = std::max(max, micros);
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(count * percentile / 100.0));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < buckets.size(); ++i) {
+		seen += buckets[i];
+		if (seen >= target) {
+			// the upper bound of the bucket, but never more than what we actually saw
+			return std::min(max, (uint64_t{1} << i) - 1);
+		}
+	}
+	return max;
+}
+
+void TaskStats::addSample(const std::source_location& location, uint64_t waitMicros, uint64_t executionMicros)
+{
+	waitTime.add(waitMicros);
+	executionTime.add(executionMicros);
+	sites[TaskSite{location.file_name(), location.function_name(), location.line()}].add(executionMicros);
+}
+
+void TaskStats::reset()
+{
+	waitTime = {};
+	executionTime = {};
+	sites.clear();
+	expiredTasks = 0;
+}
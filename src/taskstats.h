@@ -0,0 +1,104 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_TASKSTATS_H
+#define FS_TASKSTATS_H
+
+#include <array>
+#include <source_location>
+#include <gtl/phmap.hpp>
+
+// Power-of-two bucketed histogram of durations in microseconds, cheap enough
+// to update on every sample, percentiles are approximated by the bucket bound
+class LatencyHistogram
+{
+	public:
+		void add(uint64_t micros);
+		uint64_t getPercentile(double percentile) const;
+
+		uint64_t getCount() const {
+			return count;
+		}
+
+		uint64_t getMax() const {
+			return max;
+		}
+
+		uint64_t getSum() const {
+			return sum;
+		}
+
+		// bucket i counts the samples below 2^i
+		const std::array<uint64_t, 64>& getBuckets() const {
+			return buckets;
+		}
+
+	private:
+		std::array<uint64_t, 64> buckets = {};
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+};
+
+struct TaskSite
+{
+	const char* file;
+	const char* function;
+	uint32_t line;
+
+	bool operator==(const TaskSite& other) const {
+		return line == other.line && file == other.file;
+	}
+};
+
+struct TaskSiteHash
+{
+	size_t operator()(const TaskSite& site) const {
+		return std::hash<const char*>()(site.file) ^ (static_cast<size_t>(site.line) << 1);
+	}
+};
+
+// Sampled dispatcher latency statistics, only touched from the dispatcher thread
+class TaskStats
+{
+	public:
+		// one out of every SAMPLE_RATE executed tasks is measured
+		static constexpr uint32_t SAMPLE_RATE = 8;
+
+		bool shouldSample() {
+			return ++sampleCounter % SAMPLE_RATE == 0;
+		}
+
+		void addSample(const std::source_location& location, uint64_t waitMicros, uint64_t executionMicros);
+		void reset();
+
+		// tasks dropped because they sat in the queue past their expiration
+		void addExpired(uint32_t tasks) {
+			expiredTasks += tasks;
+		}
+
+		uint64_t getExpired() const {
+			return expiredTasks;
+		}
+
+		const LatencyHistogram& getWaitTime() const {
+			return waitTime;
+		}
+
+		const LatencyHistogram& getExecutionTime() const {
+			return executionTime;
+		}
+
+		const gtl::flat_hash_map<TaskSite, LatencyHistogram, TaskSiteHash>& getSites() const {
+			return sites;
+		}
+
+	private:
+		LatencyHistogram waitTime;
+		LatencyHistogram executionTime;
+		gtl::flat_hash_map<TaskSite, LatencyHistogram, TaskSiteHash> sites;
+		uint64_t expiredTasks = 0;
+		uint32_t sampleCounter = 0;
+};
+
+#endif
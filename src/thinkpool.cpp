@@ -0,0 +1,96 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "thinkpool.h"
+#include "threadrole.h"
+#include "tracing.h"
+
+void ThinkPool::start(size_t threadCount)
+{
+	stopping = false;
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&ThinkPool::threadMain, this);
+	}
+}
+
+void ThinkPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(batchLock);
+		stopping = true;
+	}
+	batchSignal.notify_all();
+
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
+
+void ThinkPool::parallelFor(size_t count, const std::function<void(size_t)>& f, size_t chunk /*= CHUNK_SIZE*/)
+{
+	if (threads.empty() || count <= chunk) {
+		for (size_t i = 0; i < count; ++i) {
+			f(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lockGuard(batchLock);
+		batch = &f;
+		batchSize = count;
+		batchChunk = chunk;
+		nextIndex = 0;
+		busyThreads = threads.size();
+		++batchGeneration;
+	}
+	batchSignal.notify_all();
+
+	runChunks();
+
+	// every worker checks in, so none is still reading this batch when the next one starts
+	std::unique_lock<std::mutex> lockGuard(batchLock);
+	doneSignal.wait(lockGuard, [this]() { return busyThreads == 0 || stopping; });
+	batch = nullptr;
+}
+
+void ThinkPool::runChunks()
+{
+	for (size_t first = nextIndex.fetch_add(batchChunk); first < batchSize; first = nextIndex.fetch_add(batchChunk)) {
+		const size_t last = std::min(first + batchChunk, batchSize);
+		for (size_t i = first; i < last; ++i) {
+			(*batch)(i);
+		}
+	}
+}
+
+void ThinkPool::threadMain()
+{
+	setThreadRole("think pool");
+	uint64_t seenGeneration = 0;
+	std::unique_lock<std::mutex> lockGuard(batchLock);
+	while (true) {
+		batchSignal.wait(lockGuard, [&]() { return stopping || batchGeneration != seenGeneration; });
+		if (stopping) {
+			return;
+		}
+
+		seenGeneration = batchGeneration;
+		lockGuard.unlock();
+
+		{
+			TraceScope trace("creature check chunks", "think pool");
+			runChunks();
+		}
+
+		lockGuard.lock();
+		if (--busyThreads == 0) {
+			doneSignal.notify_one();
+		}
+	}
+}
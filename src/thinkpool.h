@@ -0,0 +1,55 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_THINKPOOL_H
+#define FS_THINKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+
+// smallest batch worth waking the workers for
+static constexpr size_t THINK_POOL_MIN_JOBS = 64;
+
+// Worker threads for the read only part of a creature check. The game thread
+// hands out a batch and helps until it is done, nothing changes the world
+// meanwhile, so the workers see exactly what the serial pass after them will.
+// Idle threads take the next chunk of the batch from a shared counter.
+// IOMap starts a pool of its own to read the tile areas of a map.
+class ThinkPool
+{
+	public:
+		void start(size_t threadCount);
+		void shutdown();
+
+		bool isRunning() const {
+			return !threads.empty();
+		}
+
+		// calls f(i) for every i below count and returns once all calls are done,
+		// a thread takes chunk of them at a time
+		void parallelFor(size_t count, const std::function<void(size_t)>& f, size_t chunk = CHUNK_SIZE);
+
+	private:
+		static constexpr size_t CHUNK_SIZE = 16;
+
+		void threadMain();
+		void runChunks();
+
+		std::vector<std::thread> threads;
+		std::mutex batchLock;
+		std::condition_variable batchSignal;
+		std::condition_variable doneSignal;
+		const std::function<void(size_t)>* batch = nullptr;
+		size_t batchSize = 0;
+		size_t batchChunk = CHUNK_SIZE;
+		std::atomic<size_t> nextIndex{0};
+		size_t busyThreads = 0;
+		uint64_t batchGeneration = 0;
+		bool stopping = false;
+};
+
+extern ThinkPool g_thinkPool;
+
+#endif
@@ -27,6 +27,14 @@ class ThreadHolder
 				thread.join();
 			}
 		}
+
+		bool isCurrentThread() const {
+			return thread.get_id() == std::this_thread::get_id();
+		}
+
+		std::thread::native_handle_type getNativeHandle() {
+			return thread.native_handle();
+		}
 	protected:
 		void setState(ThreadState newState) {
 			threadState.store(newState, std::memory_order_relaxed);
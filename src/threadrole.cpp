@@ -0,0 +1,135 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "threadrole.h"
+
+#include "configmanager.h"
+#include "tools.h"
+#include "tracing.h"
+
+#include <charconv>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+extern ConfigManager g_config;
+
+namespace {
+
+std::string_view trim(std::string_view text)
+{
+	const size_t first = text.find_first_not_of(" \t");
+	if (first == std::string_view::npos) {
+		return {};
+	}
+	return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+// the cpus of a list like "4-7,12", what does not parse is left out
+std::vector<uint32_t> parseCpuList(std::string_view list)
+{
+	std::vector<uint32_t> cpus;
+	for (const auto& range : explodeString(list, ",")) {
+		const std::string_view part = trim(range);
+		const size_t dash = part.find('-');
+		uint32_t first = 0;
+		const std::string_view firstText = part.substr(0, dash);
+		if (std::from_chars(firstText.data(), firstText.data() + firstText.size(), first).ec != std::errc{}) {
+			continue;
+		}
+
+		uint32_t last = first;
+		if (dash != std::string_view::npos) {
+			const std::string_view lastText = part.substr(dash + 1);
+			if (std::from_chars(lastText.data(), lastText.data() + lastText.size(), last).ec != std::errc{} || last < first) {
+				continue;
+			}
+		}
+
+		for (uint32_t cpu = first; cpu <= last; ++cpu) {
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+// threadAffinity is "role=cpus;role=cpus", the roles as the threads name themselves
+std::vector<uint32_t> getRoleCpus(std::string_view role)
+{
+	for (const auto& entry : explodeString(g_config.getString(ConfigManager::THREAD_AFFINITY), ";")) {
+		const size_t equals = entry.find('=');
+		if (equals != std::string_view::npos && caseInsensitiveEqual(trim(entry.substr(0, equals)), role)) {
+			return parseCpuList(entry.substr(equals + 1));
+		}
+	}
+	return {};
+}
+
+}
+
+void setThreadRole(const char* role)
+{
+	TraceRecorder::setThreadName(role);
+
+#ifdef __linux__
+	// the system keeps 15 characters of a name
+	char name[16];
+	std::snprintf(name, sizeof(name), "%s", role);
+	pthread_setname_np(pthread_self(), name);
+	placeThread(pthread_self(), role);
+#elif defined(_WIN32)
+	placeThread(GetCurrentThread(), role);
+#endif
+}
+
+void placeThread(std::thread::native_handle_type thread, std::string_view role)
+{
+	if (const std::vector<uint32_t> cpus = getRoleCpus(role); !cpus.empty()) {
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (uint32_t cpu : cpus) {
+			if (cpu < CPU_SETSIZE) {
+				CPU_SET(cpu, &set);
+			}
+		}
+
+		if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0) {
+			std::cout << "[Warning - placeThread] Can not pin the " << role << " thread to the cpus of threadAffinity." << std::endl;
+		}
+#elif defined(_WIN32)
+		DWORD_PTR mask = 0;
+		for (uint32_t cpu : cpus) {
+			if (cpu < sizeof(mask) * 8) {
+				mask |= static_cast<DWORD_PTR>(1) << cpu;
+			}
+		}
+
+		if (mask == 0 || SetThreadAffinityMask(thread, mask) == 0) {
+			std::cout << "[Warning - placeThread] Can not pin the " << role << " thread to the cpus of threadAffinity." << std::endl;
+		}
+#endif
+	}
+
+	const int32_t priority = g_config.getNumber(ConfigManager::DISPATCHER_REALTIME_PRIORITY);
+	if (role != "dispatcher" || priority <= 0) {
+		return;
+	}
+
+#ifdef __linux__
+	// needs CAP_SYS_NICE or a matching RLIMIT_RTPRIO
+	sched_param param{};
+	param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+	if (pthread_setschedparam(thread, SCHED_FIFO, &param) != 0) {
+		std::cout << "[Warning - placeThread] Can not give the dispatcher a real-time priority, the server lacks the permission." << std::endl;
+	}
+#elif defined(_WIN32)
+	if (!SetThreadPriority(thread, THREAD_PRIORITY_TIME_CRITICAL)) {
+		std::cout << "[Warning - placeThread] Can not give the dispatcher a real-time priority." << std::endl;
+	}
+#endif
+}
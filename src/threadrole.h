@@ -0,0 +1,19 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_THREADROLE_H
+#define FS_THREADROLE_H
+
+#include <string_view>
+#include <thread>
+
+// At the start of a thread, names it after its role in the trace and for the
+// system tools (top -H, gdb, perf) and places it as placeThread does.
+void setThreadRole(const char* role);
+
+// Pins the thread to the cpus threadAffinity lists for the role and gives the
+// dispatcher the dispatcherRealtimePriority. Nothing changes for a role the
+// config does not mention, or before the config is loaded.
+void placeThread(std::thread::native_handle_type thread, std::string_view role);
+
+#endif
@@ -0,0 +1,164 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "tickprofiler.h"
+
+#include "creature.h"
+
+#include <fmt/format.h>
+
+TickProfiler g_tickProfiler;
+
+namespace {
+
+constexpr std::array<const char*, TICK_PHASE_LAST> phaseNames = {
+	"creature checks",
+	"decay",
+	"light",
+	"spawns",
+	"raids",
+	"globalevents",
+	"player requests",
+	"spectators",
+	"pathfinding",
+	"lua",
+	"network",
+};
+
+// phases and sources named in a slow batch warning
+constexpr size_t WARNING_OFFENDERS = 3;
+
+double toMillis(int64_t nanoseconds)
+{
+	return nanoseconds / 1e6;
+}
+
+}
+
+const char* TickProfiler::getPhaseName(TickPhase_t phase)
+{
+	return phaseNames[phase];
+}
+
+std::string_view TickProfiler::getSourceName(const Creature* creature)
+{
+	// players think alike, one line for all of them
+	if (creature->getPlayer()) {
+		return "players";
+	}
+	return creature->getName();
+}
+
+void TickProfiler::setEnabled(bool value)
+{
+	enabled = value;
+
+	// whatever a batch measured before it changed is dropped
+	cyclePhases.fill(0);
+	for (auto source : cycleSources) {
+		source->second.cycle = 0;
+	}
+	cycleSources.clear();
+	secondStart = std::chrono::steady_clock::now();
+}
+
+void TickProfiler::addSourceTime(std::string_view source, std::chrono::steady_clock::duration time)
+{
+	auto it = sources.find(source);
+	if (it == sources.end()) {
+		it = sources.emplace(std::string(source), SourceTime{}).first;
+	}
+
+	if (it->second.cycle == 0) {
+		cycleSources.push_back(&*it);
+	}
+	it->second.cycle += std::max<int64_t>(1, std::chrono::nanoseconds(time).count());
+}
+
+void TickProfiler::endBatch(std::chrono::steady_clock::time_point batchStart)
+{
+	if (!enabled) {
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+	const auto batchTime = now - batchStart;
+	const int64_t batchNanos = std::chrono::nanoseconds(batchTime).count();
+	current.busy += batchNanos;
+	current.maxBatch = std::max(current.maxBatch, batchNanos);
+	++current.batches;
+
+	if (warningThreshold.count() > 0 && batchTime >= warningThreshold) {
+		++current.slowBatches;
+		// one line a second at most, a server that stays behind would flood the log
+		if (!warnedThisSecond) {
+			warnedThisSecond = true;
+			logSlowBatch(batchTime);
+		}
+	}
+
+	for (size_t i = 0; i < TICK_PHASE_LAST; ++i) {
+		secondPhases[i] += cyclePhases[i];
+		totalPhases[i] += cyclePhases[i];
+		cyclePhases[i] = 0;
+	}
+
+	for (auto source : cycleSources) {
+		source->second.second += source->second.cycle;
+		source->second.cycle = 0;
+	}
+	cycleSources.clear();
+
+	if (now - secondStart >= std::chrono::seconds(1)) {
+		endSecond(now);
+	}
+}
+
+void TickProfiler::logSlowBatch(std::chrono::steady_clock::duration batchTime)
+{
+	std::array<size_t, TICK_PHASE_LAST> phases;
+	for (size_t i = 0; i < TICK_PHASE_LAST; ++i) {
+		phases[i] = i;
+	}
+	std::ranges::sort(phases, std::ranges::greater(), [this](size_t phase) { return cyclePhases[phase]; });
+	std::ranges::sort(cycleSources, std::ranges::greater(), [](const auto source) { return source->second.cycle; });
+
+	std::string message = fmt::format("> Warning: a dispatcher batch took {:.1f} ms", toMillis(std::chrono::nanoseconds(batchTime).count()));
+	for (size_t i = 0; i < WARNING_OFFENDERS && cyclePhases[phases[i]] > 0; ++i) {
+		message += fmt::format("{:s} {:s} {:.1f} ms", i == 0 ? ":" : ",", phaseNames[phases[i]], toMillis(cyclePhases[phases[i]]));
+	}
+	for (size_t i = 0; i < WARNING_OFFENDERS && i < cycleSources.size(); ++i) {
+		message += fmt::format("{:s} {:s} {:.1f} ms", i == 0 ? ";" : ",", cycleSources[i]->first, toMillis(cycleSources[i]->second.cycle));
+	}
+	std::cout << message << std::endl;
+}
+
+void TickProfiler::endSecond(std::chrono::steady_clock::time_point now)
+{
+	current.window = std::chrono::nanoseconds(now - secondStart).count();
+	current.phases = secondPhases;
+	secondPhases.fill(0);
+
+	std::vector<std::pair<const std::string, SourceTime>*> busiest;
+	for (auto& source : sources) {
+		if (source.second.second > 0) {
+			busiest.push_back(&source);
+		}
+	}
+
+	const size_t count = std::min(TOP_SOURCES, busiest.size());
+	std::ranges::partial_sort(busiest, busiest.begin() + count, std::ranges::greater(), [](const auto source) { return source->second.second; });
+	for (size_t i = 0; i < count; ++i) {
+		current.sources.emplace_back(busiest[i]->first, busiest[i]->second.second);
+	}
+	for (const auto source : busiest) {
+		source->second.second = 0;
+	}
+
+	lastSecond = std::move(current);
+	current = {};
+	secondStart = now;
+	warnedThisSecond = false;
+}
@@ -0,0 +1,196 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_TICKPROFILER_H
+#define FS_TICKPROFILER_H
+
+#include <array>
+#include <chrono>
+#include <gtl/phmap.hpp>
+
+class Creature;
+
+enum TickPhase_t : uint8_t {
+	TICK_PHASE_CREATURES,
+	TICK_PHASE_DECAY,
+	TICK_PHASE_LIGHT,
+	TICK_PHASE_SPAWNS,
+	TICK_PHASE_RAIDS,
+	TICK_PHASE_GLOBALEVENTS,
+	TICK_PHASE_PLAYER_REQUESTS,
+	TICK_PHASE_SPECTATORS,
+	TICK_PHASE_PATHFINDING,
+	TICK_PHASE_LUA,
+	TICK_PHASE_NETWORK,
+
+	TICK_PHASE_LAST
+};
+
+// what one second of dispatcher batches spent its time on, in nanoseconds
+struct TickBudget
+{
+	std::array<int64_t, TICK_PHASE_LAST> phases{};
+	// the creature types and scripts that took longest, longest first
+	std::vector<std::pair<std::string, int64_t>> sources;
+	int64_t window = 0;
+	int64_t busy = 0;
+	int64_t maxBatch = 0;
+	uint32_t batches = 0;
+	uint32_t slowBatches = 0;
+};
+
+// Splits the time of every dispatcher batch into the phases the game thread
+// runs, and the onThink of each creature type and each script into sources.
+// Phases nest, each one only counts the time not spent in a phase it called,
+// sources count everything they called. Once a second the totals become the
+// budget report, a batch slower than the warning threshold is logged with the
+// phases and sources that took it.
+// Timers only measure on the thread that attached, the dispatcher, anywhere
+// else and while disabled they cost a thread local read.
+class TickProfiler
+{
+	public:
+		static constexpr size_t TOP_SOURCES = 5;
+
+		static bool isActive() {
+			return attached && enabled;
+		}
+
+		static const char* getPhaseName(TickPhase_t phase);
+		static std::string_view getSourceName(const Creature* creature);
+
+		// dispatcher thread
+		void attachThread() {
+			attached = true;
+		}
+
+		void setEnabled(bool value);
+
+		void setWarningThreshold(uint32_t milliseconds) {
+			warningThreshold = std::chrono::milliseconds(milliseconds);
+		}
+
+		void addPhaseTime(TickPhase_t phase, std::chrono::steady_clock::duration time) {
+			cyclePhases[phase] += std::chrono::nanoseconds(time).count();
+		}
+
+		void addSourceTime(std::string_view source, std::chrono::steady_clock::duration time);
+
+		// after every batch, with the time it started at
+		void endBatch(std::chrono::steady_clock::time_point batchStart);
+
+		const TickBudget& getLastSecond() const {
+			return lastSecond;
+		}
+
+		// every phase since startup, in nanoseconds
+		const std::array<int64_t, TICK_PHASE_LAST>& getTotals() const {
+			return totalPhases;
+		}
+
+	private:
+		struct SourceTime
+		{
+			int64_t second = 0;
+			int64_t cycle = 0;
+		};
+
+		void logSlowBatch(std::chrono::steady_clock::duration batchTime);
+		void endSecond(std::chrono::steady_clock::time_point now);
+
+		static inline thread_local bool attached = false;
+		static inline bool enabled = false;
+
+		std::array<int64_t, TICK_PHASE_LAST> cyclePhases{};
+		std::array<int64_t, TICK_PHASE_LAST> secondPhases{};
+		std::array<int64_t, TICK_PHASE_LAST> totalPhases{};
+
+		// nodes stay put, the batch keeps pointers to the sources it touched
+		gtl::node_hash_map<std::string, SourceTime> sources;
+		std::vector<std::pair<const std::string, SourceTime>*> cycleSources;
+
+		TickBudget current;
+		TickBudget lastSecond;
+		std::chrono::steady_clock::time_point secondStart;
+		std::chrono::steady_clock::duration warningThreshold = std::chrono::milliseconds(100);
+		bool warnedThisSecond = false;
+};
+
+extern TickProfiler g_tickProfiler;
+
+class TickPhaseTimer
+{
+	public:
+		explicit TickPhaseTimer(TickPhase_t phase) : phase(phase) {
+			if (!TickProfiler::isActive()) {
+				return;
+			}
+
+			active = true;
+			parent = current;
+			current = this;
+			start = std::chrono::steady_clock::now();
+			if (parent) {
+				g_tickProfiler.addPhaseTime(parent->phase, start - parent->start);
+			}
+		}
+
+		~TickPhaseTimer() {
+			if (!active) {
+				return;
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+			g_tickProfiler.addPhaseTime(phase, now - start);
+			current = parent;
+			if (parent) {
+				parent->start = now;
+			}
+		}
+
+		// non-copyable
+		TickPhaseTimer(const TickPhaseTimer&) = delete;
+		TickPhaseTimer& operator=(const TickPhaseTimer&) = delete;
+
+	private:
+		static inline thread_local TickPhaseTimer* current = nullptr;
+
+		std::chrono::steady_clock::time_point start;
+		TickPhaseTimer* parent = nullptr;
+		TickPhase_t phase;
+		bool active = false;
+};
+
+class TickSourceTimer
+{
+	public:
+		explicit TickSourceTimer(const Creature* creature) {
+			if (TickProfiler::isActive()) {
+				source = TickProfiler::getSourceName(creature);
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		explicit TickSourceTimer(std::string_view source) {
+			if (TickProfiler::isActive()) {
+				this->source = source;
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		~TickSourceTimer() {
+			if (!source.empty()) {
+				g_tickProfiler.addSourceTime(source, std::chrono::steady_clock::now() - start);
+			}
+		}
+
+		// non-copyable
+		TickSourceTimer(const TickSourceTimer&) = delete;
+		TickSourceTimer& operator=(const TickSourceTimer&) = delete;
+
+	private:
+		std::string_view source;
+		std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -342,6 +342,8 @@ ThingPtr Tile::getTopVisibleThing(const CreaturePtr creature)
 
 void Tile::onAddTileItem(ItemPtr& item)
 {
+	g_game.map.invalidateTileEncoding(getPosition());
+
 	if (item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) {
 		if (const auto it = g_game.browseFields.find(getTile()); it != g_game.browseFields.end()) {
 			it->second->addItemBack(item);
@@ -357,19 +359,19 @@ void Tile::onAddTileItem(ItemPtr& item)
 	g_game.map.getSpectators(spectators, cylinderMapPos, true);
 
 	//send to client
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto spectatorPlayer = spectator->getPlayer()) {
 			spectatorPlayer->sendAddTileItem(getTile(), cylinderMapPos, item);
 		}
 	}
 
 	//event methods
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		TilePtr tp = this->getTile();
 		spectator->onAddTileItem(tp, cylinderMapPos);
 	}
 
-	if ((!hasFlag(TILESTATE_PROTECTIONZONE) || g_config.getBoolean(ConfigManager::CLEAN_PROTECTION_ZONES)) && item->isCleanable()) {
+	if ((!hasFlag(TILESTATE_PROTECTIONZONE) || g_config.getSnapshot().cleanProtectionZones) && item->isCleanable()) {
 		if (!isHouseTile()) {
 			g_game.addTileToClean(getTile());
 		}
@@ -378,6 +380,8 @@ void Tile::onAddTileItem(ItemPtr& item)
 
 void Tile::onUpdateTileItem(const ItemPtr& oldItem, const ItemType& oldType, const ItemPtr& newItem, const ItemType& newType)
 {
+	g_game.map.invalidateTileEncoding(getPosition());
+
 	if (newItem->hasProperty(CONST_PROP_MOVEABLE) || newItem->getContainer()) {
 		if (const auto it = g_game.browseFields.find(getTile()); it != g_game.browseFields.end()) {
 			if (int32_t index = it->second->getThingIndex(oldItem); index != -1) {
@@ -399,20 +403,22 @@ void Tile::onUpdateTileItem(const ItemPtr& oldItem, const ItemType& oldType, con
 	g_game.map.getSpectators(spectators, cylinderMapPos, true);
 
 	//send to client
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto spectatorPlayer = spectator->getPlayer()) {
 			spectatorPlayer->sendUpdateTileItem(getTile(), cylinderMapPos, newItem);
 		}
 	}
 
 	//event methods
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		spectator->onUpdateTileItem(getTile(), cylinderMapPos, oldItem, oldType, newItem, newType);
 	}
 }
 
 void Tile::onRemoveTileItem(const SpectatorVec& spectators, const std::vector<int32_t>& oldStackPosVector, const ItemPtr& item)
 {
+	g_game.map.invalidateTileEncoding(getPosition());
+
 	if (item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) {
 		if (const auto it = g_game.browseFields.find(getTile()); it != g_game.browseFields.end()) {
 			it->second->removeThing(item, item->getItemCount());
@@ -426,18 +432,20 @@ void Tile::onRemoveTileItem(const SpectatorVec& spectators, const std::vector<in
 
 	//send to client
 	size_t i = 0;
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		if (const auto tmpPlayer = spectator->getPlayer()) {
 			tmpPlayer->sendRemoveTileThing(cylinderMapPos, oldStackPosVector[i++]);
 		}
 	}
 
 	//event methods
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		spectator->onRemoveTileItem(getTile(), cylinderMapPos, iType, item);
 	}
 
-	if (!hasFlag(TILESTATE_PROTECTIONZONE) || g_config.getBoolean(ConfigManager::CLEAN_PROTECTION_ZONES)) {
+	// the tile only leaves the clean list when its last cleanable item goes, the
+	// others on it stay as they were, so busy tiles are not searched on every removal
+	if (item->isCleanable() && (!hasFlag(TILESTATE_PROTECTIONZONE) || g_config.getSnapshot().cleanProtectionZones)) {
 		const auto items = getItemList();
 		if (!items || items->empty()) {
 			g_game.removeTileToClean(getTile());
@@ -445,7 +453,7 @@ void Tile::onRemoveTileItem(const SpectatorVec& spectators, const std::vector<in
 		}
 
 		bool ret = false;
-		for (const auto toCheck : *items) {
+		for (const auto& toCheck : *items) {
 			if (toCheck->isCleanable()) {
 				ret = true;
 				break;
@@ -463,7 +471,7 @@ void Tile::onUpdateTile(const SpectatorVec& spectators)
 	const Position& cylinderMapPos = getPosition();
 
 	//send to clients
-	for (const auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
 		std::static_pointer_cast<Player>(spectator)->sendUpdateTile(getTile(), cylinderMapPos);
 	}
@@ -667,7 +675,7 @@ ReturnValue Tile::queryAdd(NpcPtr npc, uint32_t flags) {
 		return RETURNVALUE_NOERROR;
 	}
 
-	if (g_config.getBoolean(ConfigManager::NPC_PZ_WALKTHROUGH) and this->hasFlag(TILESTATE_PVPZONE)) {
+	if (g_config.getSnapshot().npcPzWalkthrough and this->hasFlag(TILESTATE_PVPZONE)) {
 		return RETURNVALUE_NOERROR;
 	}
 
@@ -712,7 +720,7 @@ ReturnValue Tile::queryAdd(ItemPtr item, uint32_t flags, CreaturePtr mover) {
 			return RETURNVALUE_ITEMCANNOTBEMOVEDTHERE;
 		}
 
-		if (mover && g_config.getBoolean(ConfigManager::ONLY_INVITED_CAN_MOVE_HOUSE_ITEMS)) {
+		if (mover && g_config.getSnapshot().onlyInvitedCanMoveHouseItems) {
 			if (!house->isInvited(mover->getPlayer())) {
 				return RETURNVALUE_PLAYERISNOTINVITED;
 			}
@@ -816,7 +824,7 @@ ReturnValue Tile::queryRemove(const ThingPtr& thing, const uint32_t count, uint3
 		return RETURNVALUE_NOTPOSSIBLE;
 	}
 
-	if (actor && g_config.getBoolean(ConfigManager::ONLY_INVITED_CAN_MOVE_HOUSE_ITEMS)) {
+	if (actor && g_config.getSnapshot().onlyInvitedCanMoveHouseItems) {
 		if (isHouseTile() && !house->isInvited(actor->getPlayer())) {
 			return RETURNVALUE_PLAYERISNOTINVITED;
 		}
@@ -926,7 +934,7 @@ void Tile::addThing(ThingPtr thing)
 void Tile::addThing(int32_t, ThingPtr thing)
 {
 	if (const auto& creature = thing->getCreature()) {
-		g_game.map.clearChunkSpectatorCache();
+		g_game.map.clearChunkSpectatorCache(getPosition());
 		creature->setParent(getTile());
 		const auto& creatures = getCreatures();
 		creatures->insert(creatures->begin(), creature);
@@ -1123,7 +1131,7 @@ void Tile::removeThing(ThingPtr thing, uint32_t count)
 	if (const auto creature = thing->getCreature()) {
 		if (const auto creatures = getCreatures()) {
 			if (const auto it = std::ranges::find(*creatures, thing); it != creatures->end()) {
-				g_game.map.clearChunkSpectatorCache();
+				g_game.map.clearChunkSpectatorCache(getPosition());
 
 				creatures->erase(it);
 			}
@@ -1216,6 +1224,10 @@ bool Tile::hasCreature(CreaturePtr& creature)
 void Tile::removeCreature(CreaturePtr& creature)
 {
 	g_game.map.getQTNode(tilePos.x, tilePos.y)->removeCreature(creature);
+#ifdef SPECTATOR_GRID
+	g_game.map.spectatorGrid.removeCreature(creature, tilePos);
+#endif
+	g_game.map.removeObservers(creature.get());
 	removeThing(creature, 0);
 }
 
@@ -1408,7 +1420,7 @@ void Tile::postAddNotification(ThingPtr thing, CylinderPtr oldParent, int32_t in
 {
 	SpectatorVec spectators;
 	g_game.map.getSpectators(spectators, getPosition(), true, true);
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
 		std::static_pointer_cast<Player>(spectator)->postAddNotification(thing, oldParent, index, LINK_NEAR);
 	}
@@ -1451,7 +1463,7 @@ void Tile::postRemoveNotification(ThingPtr thing, CylinderPtr newParent, int32_t
 		onUpdateTile(spectators);
 	}
 
-	for (auto spectator : spectators) {
+	for (const auto& spectator : spectators) {
 		assert(std::dynamic_pointer_cast<Player>(spectator) != nullptr);
 		std::static_pointer_cast<Player>(spectator)->postRemoveNotification(thing, newParent, index, LINK_NEAR);
 	}
@@ -1476,7 +1488,7 @@ void Tile::internalAddThing(uint32_t, ThingPtr thing)
 	thing->setParent(getTile());
 
 	if (const auto& creature = thing->getCreature()) {
-		g_game.map.clearChunkSpectatorCache();
+		g_game.map.clearChunkSpectatorCache(getPosition());
 
 		const auto& creatures = getCreatures();
 		creatures->insert(creatures->begin(), creature);
@@ -1485,6 +1497,7 @@ void Tile::internalAddThing(uint32_t, ThingPtr thing)
 		if (item == nullptr) {
 			return;
 		}
+		g_game.map.invalidateTileEncoding(getPosition());
 		updateHouse(item);
 		const ItemType& itemType = Item::items[item->getID()];
 		if (itemType.isGroundTile()) {
@@ -1578,6 +1591,12 @@ void Tile::setTileFlags(const ItemConstPtr& item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		setFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (g_moveEvents && g_moveEvents->mayHaveTileEvent(item)) {
+		setFlag(TILESTATE_MOVEEVENT);
+	}
+
+	g_game.map.updateTileState(*this);
 }
 
 void Tile::resetTileFlags(const ItemPtr& item)
@@ -1637,6 +1656,32 @@ void Tile::resetTileFlags(const ItemPtr& item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		resetFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	if (hasFlag(TILESTATE_MOVEEVENT) && !hasMoveEventItem(item)) {
+		resetFlag(TILESTATE_MOVEEVENT);
+	}
+
+	g_game.map.updateTileState(*this);
+}
+
+bool Tile::hasMoveEventItem(const ItemPtr& exclude) const
+{
+	if (!g_moveEvents) {
+		return false;
+	}
+
+	if (ground && ground != exclude && g_moveEvents->mayHaveTileEvent(ground)) {
+		return true;
+	}
+
+	if (const TileItemsConstPtr items = getItemList()) {
+		for (const auto& item : *items) {
+			if (item != exclude && g_moveEvents->mayHaveTileEvent(item)) {
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
 bool Tile::isMoveableBlocking() const
@@ -9,6 +9,7 @@
 #include "tools.h"
 #include "spectators.h"
 #include "declarations.h"
+#include "instancecounter.h"
 
 enum tileflags_t : uint32_t {
 	TILESTATE_NONE = 0,
@@ -37,6 +38,7 @@ enum tileflags_t : uint32_t {
 	TILESTATE_IMMOVABLENOFIELDBLOCKPATH = 1 << 21,
 	TILESTATE_NOFIELDBLOCKPATH = 1 << 22,
 	TILESTATE_SUPPORTS_HANGABLE = 1 << 23,
+	TILESTATE_MOVEEVENT = 1 << 24, // an item on the tile may fire a step or item tile move event
 
 	TILESTATE_FLOORCHANGE = TILESTATE_FLOORCHANGE_DOWN | TILESTATE_FLOORCHANGE_NORTH | TILESTATE_FLOORCHANGE_SOUTH | TILESTATE_FLOORCHANGE_EAST | TILESTATE_FLOORCHANGE_WEST | TILESTATE_FLOORCHANGE_SOUTH_ALT | TILESTATE_FLOORCHANGE_EAST_ALT,
 };
@@ -133,17 +135,12 @@ class TileItemVector : public ItemVector
 
 class House;
 
-class Tile : public Cylinder, public SharedObject
+class Tile : public Cylinder, public SharedObject, public InstanceCounter<Tile>
 {
 	public:
-		Tile(uint16_t x, uint16_t y, uint8_t z) : tilePos(x, y, z) {
-			items = std::make_shared<TileItemVector>();
-			creatures = std::make_shared<CreatureVector>();
-		}
+		Tile(uint16_t x, uint16_t y, uint8_t z) : tilePos(x, y, z) {}
 
 		Tile(uint16_t x, uint16_t y, uint8_t z, House* house) : tilePos(x, y, z) {
-			items = std::make_shared<TileItemVector>();
-			creatures = std::make_shared<CreatureVector>();
 			this->house = house;
 		}
 
@@ -155,21 +152,21 @@ class Tile : public Cylinder, public SharedObject
 		Tile(const Tile&) = delete;
 		Tile& operator=(const Tile&) = delete;
 
+		// the lists live inside the tile, the pointers share its ownership
 		TileItemsPtr getItemList() {
-			return items;
+			return TileItemsPtr(shared_from_this(), &itemList);
 		}
 
 		TileItemsConstPtr getItemList() const {
-			return items;
+			return TileItemsConstPtr(shared_from_this(), &itemList);
 		}
 
 		TileCreaturesPtr getCreatures() {
-			return creatures;
+			return TileCreaturesPtr(shared_from_this(), &creatureList);
 		}
 
-
 		TileCreaturesConstPtr getCreatures() const {
-			return creatures;
+			return TileCreaturesConstPtr(shared_from_this(), &creatureList);
 		}
 
 		House* getHouse() const {
@@ -329,12 +326,13 @@ class Tile : public Cylinder, public SharedObject
 		void onUpdateTile(const SpectatorVec& spectators);
 		void setTileFlags(const ItemConstPtr& item);
 		void resetTileFlags(const ItemPtr& item);
+		bool hasMoveEventItem(const ItemPtr& exclude) const;
 
 		House* house = nullptr;
 		ItemPtr ground = nullptr;
 		Position tilePos;
 		uint32_t flags = 0;
-		TileItemsPtr items;
-		TileCreaturesPtr creatures;
+		TileItemVector itemList;
+		CreatureVector creatureList;
 };
 #endif
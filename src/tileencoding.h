@@ -0,0 +1,80 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_TILEENCODING_H
+#define FS_TILEENCODING_H
+
+#include "position.h"
+
+#include <array>
+#include <bit>
+#include <vector>
+
+static constexpr size_t TILE_ENCODING_CACHE_SIZE = 65536;
+// the client shows ten things per tile, an item takes at most five bytes
+static constexpr size_t TILE_ENCODING_MAX_THINGS = 10;
+static constexpr size_t TILE_ENCODING_MAX_BYTES = 2 + TILE_ENCODING_MAX_THINGS * 5;
+
+// The items of a tile as a map description sends them, split around the
+// place the creatures go, which depends on the viewer.
+struct TileEncoding
+{
+	std::array<uint8_t, TILE_ENCODING_MAX_BYTES> bytes;
+	// end of the effects, ground and top items and how many things they are
+	uint8_t topEnd = 0;
+	uint8_t topCount = 0;
+	// end of each down item after topEnd
+	uint8_t downCount = 0;
+	std::array<uint8_t, TILE_ENCODING_MAX_THINGS> downEnds;
+};
+
+// Remembers the encoding of recently described tiles, so logins, teleports
+// and floor changes copy the bytes instead of walking every item. Any
+// change to the items of a position drops its entry.
+class TileEncodingCache
+{
+	public:
+		TileEncodingCache() : entries(TILE_ENCODING_CACHE_SIZE) {}
+
+		const TileEncoding* find(const Position& pos) const {
+			const uint64_t key = getKey(pos);
+			const Entry& entry = entries[getSlot(key)];
+			return entry.key == key ? &entry.encoding : nullptr;
+		}
+
+		TileEncoding& insert(const Position& pos) {
+			const uint64_t key = getKey(pos);
+			Entry& entry = entries[getSlot(key)];
+			entry.key = key;
+			return entry.encoding;
+		}
+
+		void invalidate(const Position& pos) {
+			const uint64_t key = getKey(pos);
+			Entry& entry = entries[getSlot(key)];
+			if (entry.key == key) {
+				entry.key = 0;
+			}
+		}
+
+	private:
+		struct Entry
+		{
+			// 0 is free, positions are stored with a bit above z set
+			uint64_t key = 0;
+			TileEncoding encoding;
+		};
+
+		static uint64_t getKey(const Position& pos) {
+			return (uint64_t(1) << 40) | (static_cast<uint64_t>(pos.z) << 32) | (static_cast<uint64_t>(pos.y) << 16) | pos.x;
+		}
+
+		static size_t getSlot(uint64_t key) {
+			// fibonacci hashing, the top bits pick the slot
+			return (key * 0x9E3779B97F4A7C15ULL) >> (64 - std::countr_zero(TILE_ENCODING_CACHE_SIZE));
+		}
+
+		std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,64 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_TILEREGIONS_H
+#define FS_TILEREGIONS_H
+
+#include "declarations.h"
+
+#include <array>
+#include <gtl/phmap.hpp>
+
+static constexpr int32_t TILE_REGION_BITS = 6;
+static constexpr int32_t TILE_REGION_SIZE = (1 << TILE_REGION_BITS);
+static constexpr int32_t TILE_REGION_MASK = (TILE_REGION_SIZE - 1);
+
+// Tile storage for dense maps, built with DENSE_TILE_STORE. Every 64x64 block
+// of a floor is one contiguous array, so a lookup is a single hash probe
+// instead of a quadtree walk and the tiles of an area share cache lines.
+class TileRegionStore
+{
+	public:
+		const TilePtr* find(uint16_t x, uint16_t y, uint8_t z) const {
+			const auto it = regions.find(getRegionKey(x, y, z));
+			if (it == regions.end()) {
+				return nullptr;
+			}
+			return &it->second->tiles[getTileIndex(x, y)];
+		}
+
+		TilePtr& create(uint16_t x, uint16_t y, uint8_t z) {
+			auto& region = regions[getRegionKey(x, y, z)];
+			if (!region) {
+				region = std::make_unique<Region>();
+			}
+			return region->tiles[getTileIndex(x, y)];
+		}
+
+		size_t getRegionCount() const {
+			return regions.size();
+		}
+
+		size_t getMemoryUsage() const {
+			return regions.size() * (sizeof(Region) + sizeof(uint32_t) + sizeof(std::unique_ptr<Region>));
+		}
+
+	private:
+		struct Region
+		{
+			std::array<TilePtr, TILE_REGION_SIZE * TILE_REGION_SIZE> tiles;
+		};
+
+		static uint32_t getRegionKey(uint16_t x, uint16_t y, uint8_t z) {
+			return (static_cast<uint32_t>(z) << 20) | (static_cast<uint32_t>(y >> TILE_REGION_BITS) << 10) | (x >> TILE_REGION_BITS);
+		}
+
+		// row major, neighbours on x are adjacent
+		static size_t getTileIndex(uint16_t x, uint16_t y) {
+			return ((y & TILE_REGION_MASK) << TILE_REGION_BITS) | (x & TILE_REGION_MASK);
+		}
+
+		gtl::flat_hash_map<uint32_t, std::unique_ptr<Region>> regions;
+};
+
+#endif
@@ -0,0 +1,180 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_TILESTATES_H
+#define FS_TILESTATES_H
+
+#include <array>
+#include <bit>
+#include <gtl/phmap.hpp>
+
+enum TileStatePlane_t : uint8_t {
+	TILESTATEPLANE_EXISTS,
+	TILESTATEPLANE_GROUND,
+	TILESTATEPLANE_BLOCKSOLID,
+	TILESTATEPLANE_BLOCKPATH,
+	TILESTATEPLANE_BLOCKPROJECTILE,
+	TILESTATEPLANE_FLOORCHANGE,
+	TILESTATEPLANE_TELEPORT,
+
+	TILESTATEPLANE_LAST
+};
+
+enum TileStateBits_t : uint8_t {
+	TILESTATEBIT_NONE = 0,
+	TILESTATEBIT_EXISTS = 1 << TILESTATEPLANE_EXISTS,
+	TILESTATEBIT_GROUND = 1 << TILESTATEPLANE_GROUND,
+	TILESTATEBIT_BLOCKSOLID = 1 << TILESTATEPLANE_BLOCKSOLID,
+	TILESTATEBIT_BLOCKPATH = 1 << TILESTATEPLANE_BLOCKPATH,
+	TILESTATEBIT_BLOCKPROJECTILE = 1 << TILESTATEPLANE_BLOCKPROJECTILE,
+	TILESTATEBIT_FLOORCHANGE = 1 << TILESTATEPLANE_FLOORCHANGE,
+	TILESTATEBIT_TELEPORT = 1 << TILESTATEPLANE_TELEPORT,
+};
+
+static constexpr int32_t TILESTATE_REGION_BITS = 6;
+static constexpr int32_t TILESTATE_REGION_SIZE = (1 << TILESTATE_REGION_BITS);
+static constexpr int32_t TILESTATE_REGION_MASK = (TILESTATE_REGION_SIZE - 1);
+
+// Per floor bit planes of the tile state that walking, pathfinding and sight
+// checks look at, kept by Map whenever a tile changes its flags. A query reads
+// a bit instead of fetching the tile and walking its items. Positions without
+// a tile read as TILESTATEBIT_NONE.
+class TileStateMap
+{
+	public:
+		using Row = uint64_t;
+
+		uint8_t get(uint16_t x, uint16_t y, uint8_t z) const {
+			const Region* region = findRegion(x, y, z);
+			if (!region) {
+				return TILESTATEBIT_NONE;
+			}
+
+			const size_t row = y & TILESTATE_REGION_MASK;
+			const size_t column = x & TILESTATE_REGION_MASK;
+			uint8_t bits = TILESTATEBIT_NONE;
+			for (size_t plane = 0; plane < TILESTATEPLANE_LAST; ++plane) {
+				bits |= ((region->planes[plane][row] >> column) & 1) << plane;
+			}
+			return bits;
+		}
+
+		bool test(uint16_t x, uint16_t y, uint8_t z, TileStatePlane_t plane) const {
+			const Region* region = findRegion(x, y, z);
+			return region && ((region->planes[plane][y & TILESTATE_REGION_MASK] >> (x & TILESTATE_REGION_MASK)) & 1);
+		}
+
+		// the 64 tiles of row y starting at the region boundary at or below x, or nullptr
+		const Row* getRow(uint16_t x, uint16_t y, uint8_t z, TileStatePlane_t plane) const {
+			const Region* region = findRegion(x, y, z);
+			return region ? &region->planes[plane][y & TILESTATE_REGION_MASK] : nullptr;
+		}
+
+		void set(uint16_t x, uint16_t y, uint8_t z, uint8_t bits) {
+			auto& region = regions[getRegionKey(x, y, z)];
+			if (!region) {
+				region = std::make_unique<Region>();
+			}
+
+			const size_t row = y & TILESTATE_REGION_MASK;
+			const Row mask = Row(1) << (x & TILESTATE_REGION_MASK);
+			if (((region->planes[TILESTATEPLANE_BLOCKPROJECTILE][row] & mask) != 0) != ((bits & TILESTATEBIT_BLOCKPROJECTILE) != 0)) {
+				++sightGeneration;
+			}
+
+			for (size_t plane = 0; plane < TILESTATEPLANE_LAST; ++plane) {
+				if ((bits >> plane) & 1) {
+					region->planes[plane][row] |= mask;
+				} else {
+					region->planes[plane][row] &= ~mask;
+				}
+			}
+		}
+
+		// calls f(x, y, z) with the first position of every region holding tiles
+		template <typename F>
+		void forEachRegion(F&& f) const {
+			for (const auto& it : regions) {
+				const uint32_t key = it.first;
+				f(static_cast<uint16_t>((key & 0x3FF) << TILESTATE_REGION_BITS), static_cast<uint16_t>(((key >> 10) & 0x3FF) << TILESTATE_REGION_BITS), static_cast<uint8_t>(key >> 20));
+			}
+		}
+
+		// changes whenever a position starts or stops blocking projectiles
+		uint32_t getSightGeneration() const {
+			return sightGeneration;
+		}
+
+	private:
+		struct Region
+		{
+			std::array<std::array<Row, TILESTATE_REGION_SIZE>, TILESTATEPLANE_LAST> planes{};
+		};
+
+		static uint32_t getRegionKey(uint16_t x, uint16_t y, uint8_t z) {
+			return (static_cast<uint32_t>(z) << 20) | (static_cast<uint32_t>(y >> TILESTATE_REGION_BITS) << 10) | (x >> TILESTATE_REGION_BITS);
+		}
+
+		const Region* findRegion(uint16_t x, uint16_t y, uint8_t z) const {
+			const auto it = regions.find(getRegionKey(x, y, z));
+			return it != regions.end() ? it->second.get() : nullptr;
+		}
+
+		gtl::flat_hash_map<uint32_t, std::unique_ptr<Region>> regions;
+		uint32_t sightGeneration = 0;
+};
+
+static constexpr size_t SIGHT_LINE_MEMO_SIZE = 1024;
+
+// a sight line to trace ahead of the checks that will ask for it
+struct SightLineJob {
+	uint16_t x0, y0, x1, y1;
+	uint8_t z;
+	bool clear = false;
+};
+
+// Remembers recent sight line results. Entries are stamped with the sight
+// generation of the TileStateMap they were computed from, so any change to a
+// projectile blocking tile drops all of them at once.
+class SightLineMemo
+{
+	public:
+		bool find(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t z, uint32_t generation, bool& clear) const {
+			const uint64_t key = getKey(x0, y0, x1, y1);
+			const Entry& entry = entries[getSlot(key, z)];
+			if (!entry.used || entry.key != key || entry.z != z || entry.generation != generation) {
+				return false;
+			}
+
+			clear = entry.clear;
+			return true;
+		}
+
+		void insert(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t z, uint32_t generation, bool clear) {
+			const uint64_t key = getKey(x0, y0, x1, y1);
+			entries[getSlot(key, z)] = {key, generation, z, clear, true};
+		}
+
+	private:
+		struct Entry
+		{
+			uint64_t key;
+			uint32_t generation;
+			uint8_t z;
+			bool clear;
+			bool used;
+		};
+
+		static uint64_t getKey(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+			return (static_cast<uint64_t>(x0) << 48) | (static_cast<uint64_t>(y0) << 32) | (static_cast<uint64_t>(x1) << 16) | y1;
+		}
+
+		static size_t getSlot(uint64_t key, uint8_t z) {
+			// fibonacci hashing, the top bits pick the slot
+			return ((key ^ z) * 0x9E3779B97F4A7C15ULL) >> (64 - std::countr_zero(SIGHT_LINE_MEMO_SIZE));
+		}
+
+		std::array<Entry, SIGHT_LINE_MEMO_SIZE> entries{};
+};
+
+#endif
@@ -12,6 +12,12 @@
 
 #include <regex>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 extern ConfigManager g_config;
 
 void printXMLError(const std::string& where, const std::string& fileName, const pugi::xml_parse_result& result)
@@ -251,9 +257,27 @@ void trim_left(std::string& source, char t)
 	source.erase(0, source.find_first_not_of(t));
 }
 
+namespace {
+
+// ascii only like tolower in the C locale, without the call per char it is
+// turned into vector code
+constexpr char asciiLower(char c)
+{
+	return c + ((static_cast<unsigned char>(c - 'A') < 26) ? ('a' - 'A') : 0);
+}
+
+constexpr char asciiUpper(char c)
+{
+	return c - ((static_cast<unsigned char>(c - 'a') < 26) ? ('a' - 'A') : 0);
+}
+
+}
+
 void toLowerCaseString(std::string& source)
 {
-	std::transform(source.begin(), source.end(), source.begin(), tolower);
+	for (char& c : source) {
+		c = asciiLower(c);
+	}
 }
 
 std::string asLowerCaseString(std::string source)
@@ -264,21 +288,23 @@ std::string asLowerCaseString(std::string source)
 
 std::string asUpperCaseString(std::string source)
 {
-	std::transform(source.begin(), source.end(), source.begin(), toupper);
+	for (char& c : source) {
+		c = asciiUpper(c);
+	}
 	return source;
 }
 
 bool caseInsensitiveEqual(std::string_view str1, std::string_view str2)
 {
 	return str1.size() == str2.size() && std::equal(str1.begin(), str1.end(), str2.begin(), [](char a, char b) {
-		return tolower(a) == tolower(b);
+		return asciiLower(a) == asciiLower(b);
 		});
 }
 
 bool caseInsensitiveStartsWith(std::string_view str, std::string_view prefix)
 {
 	return str.size() >= prefix.size() && std::equal(prefix.begin(), prefix.end(), str.begin(), [](char a, char b) {
-		return tolower(a) == tolower(b);
+		return asciiLower(a) == asciiLower(b);
 		});
 }
 
@@ -824,27 +850,93 @@ std::string getSkillName(uint8_t skillid)
 	}
 }
 
+namespace {
+
+constexpr uint32_t ADLER_BASE = 65521;
+// largest run of bytes before the sums have to be reduced to stay in 32 bits
+constexpr size_t ADLER_NMAX = 5552;
+constexpr size_t ADLER_BLOCK = 16;
+
+// Adds the 16 byte blocks of data to a and b without reducing them. For a
+// block the bytes add up into a and each byte adds (16 - i) times into b,
+// on top of 16 times the a that the block started with.
+size_t adlerBlocks(const uint8_t* data, size_t length, uint32_t& a, uint32_t& b)
+{
+	const size_t blocks = length / ADLER_BLOCK;
+	if (blocks == 0) {
+		return 0;
+	}
+
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lowWeights = _mm_set_epi16(9, 10, 11, 12, 13, 14, 15, 16);
+	const __m128i highWeights = _mm_set_epi16(1, 2, 3, 4, 5, 6, 7, 8);
+	__m128i sums = zero, previousSums = zero, weightedSums = zero;
+
+	for (size_t i = 0; i < blocks; ++i) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * ADLER_BLOCK));
+		previousSums = _mm_add_epi32(previousSums, sums);
+		sums = _mm_add_epi32(sums, _mm_sad_epu8(bytes, zero));
+		weightedSums = _mm_add_epi32(weightedSums, _mm_madd_epi16(_mm_unpacklo_epi8(bytes, zero), lowWeights));
+		weightedSums = _mm_add_epi32(weightedSums, _mm_madd_epi16(_mm_unpackhi_epi8(bytes, zero), highWeights));
+	}
+
+	const auto sum = [](__m128i v) {
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+	};
+
+	b += static_cast<uint32_t>(blocks * ADLER_BLOCK) * a + sum(previousSums) * ADLER_BLOCK + sum(weightedSums);
+	a += sum(sums);
+	return blocks * ADLER_BLOCK;
+#elif defined(__aarch64__)
+	static constexpr uint8_t weights[ADLER_BLOCK] = {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+	const uint8x8_t lowWeights = vld1_u8(weights), highWeights = vld1_u8(weights + 8);
+	uint32x4_t sums = vdupq_n_u32(0), previousSums = vdupq_n_u32(0), weightedSums = vdupq_n_u32(0);
+
+	for (size_t i = 0; i < blocks; ++i) {
+		const uint8x16_t bytes = vld1q_u8(data + i * ADLER_BLOCK);
+		previousSums = vaddq_u32(previousSums, sums);
+		sums = vpadalq_u16(sums, vpaddlq_u8(bytes));
+		weightedSums = vpadalq_u16(weightedSums, vmull_u8(vget_low_u8(bytes), lowWeights));
+		weightedSums = vpadalq_u16(weightedSums, vmull_u8(vget_high_u8(bytes), highWeights));
+	}
+
+	b += static_cast<uint32_t>(blocks * ADLER_BLOCK) * a + vaddvq_u32(previousSums) * ADLER_BLOCK + vaddvq_u32(weightedSums);
+	a += vaddvq_u32(sums);
+	return blocks * ADLER_BLOCK;
+#else
+	return 0;
+#endif
+}
+
+}
+
 uint32_t adlerChecksum(const uint8_t* data, size_t length)
 {
 	if (length > NETWORKMESSAGE_MAXSIZE) {
 		return 0;
 	}
 
-	const uint16_t adler = 65521;
-
 	uint32_t a = 1, b = 0;
 
 	while (length > 0) {
-		size_t tmp = length > 5552 ? 5552 : length;
+		size_t tmp = length > ADLER_NMAX ? ADLER_NMAX : length;
 		length -= tmp;
 
-		do {
+		const size_t done = adlerBlocks(data, tmp, a, b);
+		data += done;
+		tmp -= done;
+
+		while (tmp > 0) {
 			a += *data++;
 			b += a;
-		} while (--tmp);
+			--tmp;
+		}
 
-		a %= adler;
-		b %= adler;
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
 	}
 
 	return (b << 16) | a;
@@ -0,0 +1,133 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "tracing.h"
+
+#include "logwriter.h"
+#include "scheduler.h"
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+TraceRecorder g_traceRecorder;
+
+namespace {
+
+void appendEscaped(std::string& out, std::string_view text)
+{
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			out += ' ';
+		} else {
+			out += c;
+		}
+	}
+}
+
+}
+
+std::string TraceRecorder::start(uint32_t seconds)
+{
+	if (isRecording()) {
+		return {};
+	}
+
+	{
+		std::lock_guard<std::mutex> lockGuard(buffersLock);
+		for (const auto& buffer : buffers) {
+			std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+			buffer->events.clear();
+			buffer->next = 0;
+		}
+	}
+
+	file = fmt::format("data/logs/trace-{:%Y%m%d-%H%M%S}.json", fmt::localtime(time(nullptr)));
+	started = std::chrono::steady_clock::now();
+	recording.store(true, std::memory_order_relaxed);
+
+	seconds = std::clamp<uint32_t>(seconds, 1, MAX_SECONDS);
+	g_scheduler.addEvent(createSchedulerTask(seconds * 1000, [this]() { stop(); }));
+	return file;
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::getThreadBuffer()
+{
+	if (!threadBuffer) {
+		std::lock_guard<std::mutex> lockGuard(buffersLock);
+		auto& buffer = buffers.emplace_back(std::make_unique<ThreadBuffer>());
+		buffer->name = threadName;
+		buffer->id = static_cast<uint32_t>(buffers.size());
+		threadBuffer = buffer.get();
+	}
+	return *threadBuffer;
+}
+
+void TraceRecorder::add(const char* name, const char* category, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end, bool instant /*= false*/)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	const TraceEvent event{name, category, std::chrono::nanoseconds(begin - started).count(), std::chrono::nanoseconds(end - started).count(), instant};
+
+	// only the dump ever waits on this lock
+	std::lock_guard<std::mutex> lockGuard(buffer.lock);
+	if (buffer.events.size() < THREAD_CAPACITY) {
+		buffer.events.push_back(event);
+	} else {
+		buffer.events[buffer.next] = event;
+		buffer.next = (buffer.next + 1) % THREAD_CAPACITY;
+	}
+}
+
+const char* TraceRecorder::intern(std::string_view name)
+{
+	std::lock_guard<std::mutex> lockGuard(namesLock);
+	auto it = names.find(name);
+	if (it == names.end()) {
+		it = names.emplace(name).first;
+	}
+	return it->c_str();
+}
+
+void TraceRecorder::stop()
+{
+	recording.store(false, std::memory_order_relaxed);
+
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	size_t events = 0;
+	bool first = true;
+	{
+		std::lock_guard<std::mutex> lockGuard(buffersLock);
+		for (const auto& buffer : buffers) {
+			std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+			if (buffer->events.empty()) {
+				continue;
+			}
+
+			out += fmt::format("{:s}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{:d},\"args\":{{\"name\":\"", first ? "" : ",", buffer->id);
+			first = false;
+			appendEscaped(out, buffer->name);
+			out += "\"}}";
+
+			for (const TraceEvent& event : buffer->events) {
+				out += ",{\"name\":\"";
+				appendEscaped(out, event.name);
+				out += fmt::format("\",\"cat\":\"{:s}\",\"pid\":1,\"tid\":{:d},\"ts\":{:.3f}", event.category, buffer->id, event.begin / 1e3);
+				if (event.instant) {
+					out += ",\"ph\":\"i\",\"s\":\"t\"}";
+				} else {
+					out += fmt::format(",\"ph\":\"X\",\"dur\":{:.3f}}}", (event.end - event.begin) / 1e3);
+				}
+			}
+			events += buffer->events.size();
+		}
+	}
+	out += "]}\n";
+
+	// a few megabytes, the log writer takes them off the game thread
+	g_logWriter.write(file, std::move(out));
+	std::cout << ">> Trace of " << events << " events is being written to " << file << std::endl;
+}
@@ -0,0 +1,112 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_TRACING_H
+#define FS_TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <gtl/phmap.hpp>
+
+struct TraceEvent
+{
+	const char* name;
+	const char* category;
+	int64_t begin;
+	int64_t end;
+	bool instant;
+};
+
+// Records what every server thread did during a window of a few seconds:
+// dispatcher tasks, scheduler events firing, database tasks, packets read
+// and written and Lua calls, each with its begin and end. Every thread fills
+// a ring of its own, when the window closes they are written as one Chrome
+// trace (chrome://tracing, ui.perfetto.dev) to data/logs.
+// Names are never copied, they have to outlive the server or be interned.
+class TraceRecorder
+{
+	public:
+		// the oldest events of a thread are overwritten past this
+		static constexpr size_t THREAD_CAPACITY = 1 << 16;
+		static constexpr uint32_t MAX_SECONDS = 60;
+
+		static bool isRecording() {
+			return recording.load(std::memory_order_relaxed);
+		}
+
+		// at the start of a thread, names it in the trace
+		static void setThreadName(const char* name) {
+			threadName = name;
+		}
+
+		static const char* getThreadName() {
+			return threadName;
+		}
+
+		// dispatcher thread, returns the file the trace is going to be written
+		// to, or an empty string while another one is being recorded
+		std::string start(uint32_t seconds);
+
+		// any thread
+		void add(const char* name, const char* category, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end, bool instant = false);
+		const char* intern(std::string_view name);
+
+	private:
+		struct ThreadBuffer
+		{
+			std::mutex lock;
+			std::vector<TraceEvent> events;
+			size_t next = 0;
+			const char* name;
+			uint32_t id;
+		};
+
+		ThreadBuffer& getThreadBuffer();
+		void stop();
+
+		static inline std::atomic<bool> recording{false};
+		static inline thread_local const char* threadName = "unnamed";
+		static inline thread_local ThreadBuffer* threadBuffer = nullptr;
+
+		// buffers stay until exit, their threads keep a pointer
+		std::mutex buffersLock;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+		std::mutex namesLock;
+		gtl::node_hash_set<std::string> names;
+
+		std::string file;
+		std::chrono::steady_clock::time_point started;
+};
+
+extern TraceRecorder g_traceRecorder;
+
+class TraceScope
+{
+	public:
+		TraceScope(const char* name, const char* category) {
+			if (name && TraceRecorder::isRecording()) {
+				this->name = name;
+				this->category = category;
+				begin = std::chrono::steady_clock::now();
+			}
+		}
+
+		~TraceScope() {
+			if (name) {
+				g_traceRecorder.add(name, category, begin, std::chrono::steady_clock::now());
+			}
+		}
+
+		// non-copyable
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		const char* name = nullptr;
+		const char* category = nullptr;
+		std::chrono::steady_clock::time_point begin;
+};
+
+#endif
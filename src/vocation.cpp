@@ -14,12 +14,11 @@ gtl::flat_hash_map<uint16_t, SkillRegistry> vocation_skills;
 
 Vocation* Vocations::getVocation(uint16_t id)
 {
-	auto it = vocationsMap.find(id);
-	if (it == vocationsMap.end()) {
+	if (id >= vocationIndex.size() || !vocationIndex[id]) {
 		std::cout << "[Warning - Vocations::getVocation] Vocation " << id << " not found." << std::endl;
 		return nullptr;
 	}
-	return &it->second;
+	return vocationIndex[id];
 }
 
 bool Vocations::addVocationSkill(uint32_t vocationId, std::string_view name, const std::shared_ptr<CustomSkill>& skill)
@@ -236,5 +235,9 @@ bool Vocations::loadFromToml() {
 		}
 	}
 
+	vocationIndex.assign(vocationsMap.empty() ? 0 : vocationsMap.rbegin()->first + 1, nullptr);
+	for (auto& [id, vocation] : vocationsMap) {
+		vocationIndex[id] = &vocation;
+	}
 	return loaded;
 }
@@ -146,6 +146,8 @@ class Vocations
 
 	private:
 		VocationMap vocationsMap;
+		// by id, into vocationsMap
+		std::vector<Vocation*> vocationIndex;
 		static constexpr auto folder = "data/vocations/";
 };
 
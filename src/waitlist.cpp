@@ -0,0 +1,184 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "waitlist.h"
+
+#include <bit>
+
+uint32_t WaitList::Queue::push(uint32_t guid)
+{
+	guids.push_back(guid);
+	++count;
+
+	// the new node counts itself and the nodes before it that it covers
+	const size_t i = guids.size();
+	tree.push_back(1 + getPrefix(i - 1) - getPrefix(i - (i & (~i + 1))));
+	return static_cast<uint32_t>(i - 1);
+}
+
+void WaitList::Queue::remove(uint32_t index)
+{
+	guids[index] = 0;
+	add(index + 1, -1);
+	if (--count == 0) {
+		guids.clear();
+		tree.resize(1);
+	}
+}
+
+size_t WaitList::Queue::getRank(uint32_t index) const
+{
+	return getPrefix(index + 1);
+}
+
+uint32_t WaitList::Queue::getFirst() const
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	// walk down to the last node with nothing waiting up to it
+	size_t position = 0;
+	for (size_t step = std::bit_floor(guids.size()); step != 0; step >>= 1) {
+		if (position + step <= guids.size() && tree[position + step] == 0) {
+			position += step;
+		}
+	}
+	return guids[position];
+}
+
+template <typename F>
+void WaitList::Queue::compact(F&& f)
+{
+	std::vector<uint32_t> waiting;
+	waiting.reserve(count);
+	for (uint32_t guid : guids) {
+		if (guid != 0) {
+			waiting.push_back(guid);
+		}
+	}
+
+	guids.clear();
+	tree.resize(1);
+	count = 0;
+	for (uint32_t guid : waiting) {
+		f(guid, push(guid));
+	}
+}
+
+void WaitList::Queue::add(size_t index, int32_t delta)
+{
+	for (; index < tree.size(); index += index & (~index + 1)) {
+		tree[index] += delta;
+	}
+}
+
+size_t WaitList::Queue::getPrefix(size_t index) const
+{
+	size_t sum = 0;
+	for (; index != 0; index -= index & (~index + 1)) {
+		sum += tree[index];
+	}
+	return sum;
+}
+
+size_t WaitList::getSlot(uint32_t guid) const
+{
+	auto it = entries.find(guid);
+	if (it == entries.end()) {
+		return 0;
+	}
+	return getSlot(it->second);
+}
+
+size_t WaitList::getSlot(const Entry& entry) const
+{
+	if (entry.priority) {
+		return priorityQueue.getRank(entry.index);
+	}
+	return priorityQueue.size() + normalQueue.getRank(entry.index);
+}
+
+size_t WaitList::push(uint32_t guid, bool priority, int64_t now)
+{
+	Queue& queue = priority ? priorityQueue : normalQueue;
+	Entry& entry = entries[guid];
+	entry.joined = now;
+	entry.timeout = 0;
+	entry.index = queue.push(guid);
+	entry.priority = priority;
+	return getSlot(entry);
+}
+
+void WaitList::setTimeout(uint32_t guid, int64_t timeout)
+{
+	auto it = entries.find(guid);
+	if (it == entries.end()) {
+		return;
+	}
+
+	Entry& entry = it->second;
+	if (entry.timeout != 0) {
+		timeouts.erase({entry.timeout, guid});
+	}
+	entry.timeout = timeout;
+	timeouts.emplace(timeout, guid);
+}
+
+void WaitList::admit(uint32_t guid, int64_t now)
+{
+	auto it = entries.find(guid);
+	if (it == entries.end()) {
+		return;
+	}
+
+	totalWait += now - it->second.joined;
+	++admitted;
+	remove(it);
+}
+
+void WaitList::sweep(int64_t now)
+{
+	while (!timeouts.empty() && timeouts.begin()->first <= now) {
+		const uint32_t guid = timeouts.begin()->second;
+		timeouts.erase(timeouts.begin());
+
+		auto it = entries.find(guid);
+		it->second.timeout = 0;
+		remove(it);
+		++timedOut;
+	}
+}
+
+int64_t WaitList::getLongestWait(int64_t now) const
+{
+	// premium players overtake, the first of either group may have joined earlier
+	int64_t longest = 0;
+	for (uint32_t first : {priorityQueue.getFirst(), normalQueue.getFirst()}) {
+		auto it = entries.find(first);
+		if (it != entries.end()) {
+			longest = std::max(longest, now - it->second.joined);
+		}
+	}
+	return longest;
+}
+
+void WaitList::remove(gtl::flat_hash_map<uint32_t, Entry>::iterator it)
+{
+	const Entry& entry = it->second;
+	if (entry.timeout != 0) {
+		timeouts.erase({entry.timeout, it->first});
+	}
+
+	Queue& queue = entry.priority ? priorityQueue : normalQueue;
+	queue.remove(entry.index);
+	entries.erase(it);
+
+	if (queue.isSparse()) {
+		queue.compact([this](uint32_t guid, uint32_t index) {
+			entries[guid].index = index;
+		});
+	}
+}
@@ -0,0 +1,109 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_WAITLIST_H
+#define FS_WAITLIST_H
+
+#include <vector>
+#include <gtl/phmap.hpp>
+#include <gtl/btree.hpp>
+
+// Login queue of the players waiting for a free place. Premium players wait in
+// front of everyone else, first come first served within each group. Players
+// are found by guid, their place is counted with a fenwick tree over the
+// order they joined in and expired entries are ordered by their timeout, so
+// neither a reconnect nor a sweep walks the whole queue.
+class WaitList
+{
+	public:
+		// place of guid counting from 1, 0 when it is not waiting
+		size_t getSlot(uint32_t guid) const;
+
+		// guid joins the back of its group, returns its place
+		size_t push(uint32_t guid, bool priority, int64_t now);
+		void setTimeout(uint32_t guid, int64_t timeout);
+		// guid leaves the queue to log in
+		void admit(uint32_t guid, int64_t now);
+		// drops everyone whose timeout passed
+		void sweep(int64_t now);
+
+		bool empty() const {
+			return entries.empty();
+		}
+		size_t size() const {
+			return entries.size();
+		}
+		size_t getPrioritySize() const {
+			return priorityQueue.size();
+		}
+
+		// milliseconds the player waiting the longest has been in line
+		int64_t getLongestWait(int64_t now) const;
+		// milliseconds the admitted players waited on average
+		int64_t getAverageWait() const {
+			return admitted != 0 ? totalWait / static_cast<int64_t>(admitted) : 0;
+		}
+		uint64_t getAdmittedCount() const {
+			return admitted;
+		}
+		uint64_t getTimedOutCount() const {
+			return timedOut;
+		}
+
+	private:
+		struct Entry
+		{
+			int64_t joined;
+			int64_t timeout;
+			uint32_t index;
+			bool priority;
+		};
+
+		// guids in joining order with a count of the ones still waiting
+		class Queue
+		{
+			public:
+				uint32_t push(uint32_t guid);
+				void remove(uint32_t index);
+				// waiting entries up to and including index
+				size_t getRank(uint32_t index) const;
+				// guid of the first waiting entry, 0 when there is none
+				uint32_t getFirst() const;
+
+				size_t size() const {
+					return count;
+				}
+
+				// the left entries are a small part of the storage
+				bool isSparse() const {
+					return guids.size() >= 1024 && count * 4 < guids.size();
+				}
+				// keeps the waiting entries only, f(guid, index) tells their new index
+				template <typename F>
+				void compact(F&& f);
+
+			private:
+				void add(size_t index, int32_t delta);
+				size_t getPrefix(size_t index) const;
+
+				// 0 once the entry left
+				std::vector<uint32_t> guids;
+				// 1 based, tree[i] counts the entries in (i - lowbit(i), i]
+				std::vector<uint32_t> tree{0};
+				size_t count = 0;
+		};
+
+		size_t getSlot(const Entry& entry) const;
+		void remove(gtl::flat_hash_map<uint32_t, Entry>::iterator it);
+
+		gtl::flat_hash_map<uint32_t, Entry> entries;
+		gtl::btree_set<std::pair<int64_t, uint32_t>> timeouts;
+		Queue priorityQueue;
+		Queue normalQueue;
+
+		int64_t totalWait = 0;
+		uint64_t admitted = 0;
+		uint64_t timedOut = 0;
+};
+
+#endif
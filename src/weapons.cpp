@@ -662,8 +662,7 @@ bool Weapon::executeUseWeapon(const PlayerPtr& player, const LuaVariant& var) co
 	lua_State* L = scriptInterface->getLuaState();
 
 	scriptInterface->pushFunction(scriptId);
-	LuaScriptInterface::pushSharedPtr(L, player);
-	LuaScriptInterface::setMetatable(L, -1, "Player");
+	LuaScriptInterface::pushSharedPtr(L, player, LuaData_Player);
 	scriptInterface->pushVariant(L, var);
 
 	return scriptInterface->callFunction(2);
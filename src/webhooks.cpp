@@ -0,0 +1,202 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "webhooks.h"
+
+#include "threadrole.h"
+
+Webhooks g_webhooks;
+
+namespace {
+
+// requests waiting to be sent or tried again, the next ones are dropped
+constexpr size_t MAX_QUEUED = 1000;
+
+// requests on the way at once, curl spreads them over its kept alive connections
+constexpr size_t MAX_TRANSFERS = 4;
+
+// the first try and the retries, each one after twice the delay of the one before
+constexpr uint8_t MAX_ATTEMPTS = 4;
+constexpr auto FIRST_RETRY_DELAY = std::chrono::milliseconds(500);
+
+constexpr long REQUEST_TIMEOUT_MS = 10000;
+
+// what the endpoint answers is not needed
+size_t discardResponse(char*, size_t size, size_t count, void*)
+{
+	return size * count;
+}
+
+}
+
+bool Webhooks::send(std::string url, std::string body)
+{
+	std::lock_guard<std::mutex> lockGuard(requestLock);
+	if (getState() != THREAD_STATE_RUNNING || requests.size() >= MAX_QUEUED) {
+		++stats.dropped;
+		return false;
+	}
+
+	requests.push_back({std::move(url), std::move(body), Clock::now()});
+	requestSignal.notify_one();
+	if (multi) {
+		curl_multi_wakeup(multi);
+	}
+	return true;
+}
+
+Webhooks::Stats Webhooks::getStats()
+{
+	std::lock_guard<std::mutex> lockGuard(requestLock);
+	Stats result = stats;
+	result.queued = requests.size();
+	return result;
+}
+
+void Webhooks::shutdown()
+{
+	std::lock_guard<std::mutex> lockGuard(requestLock);
+	setState(THREAD_STATE_TERMINATED);
+	requestSignal.notify_one();
+	if (multi) {
+		curl_multi_wakeup(multi);
+	}
+}
+
+void Webhooks::threadMain()
+{
+	setThreadRole("webhooks");
+
+	CURLM* handle = curl_multi_init();
+	curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+
+	// the easy handles are reused, with the connections curl keeps for them
+	std::vector<CURL*> idle;
+	std::vector<std::pair<CURL*, Request>> active;
+
+	struct Done
+	{
+		Request request;
+		CURLcode result;
+		long status;
+	};
+	std::vector<Done> done;
+
+	std::unique_lock<std::mutex> lockGuard(requestLock);
+	multi = handle;
+	while (true) {
+		const bool terminated = getState() == THREAD_STATE_TERMINATED;
+		if (terminated && requests.empty() && active.empty()) {
+			break;
+		}
+
+		const auto now = Clock::now();
+		auto nextDue = Clock::time_point::max();
+		for (auto it = requests.begin(); it != requests.end() && active.size() < MAX_TRANSFERS;) {
+			if (it->due > now && !terminated) {
+				nextDue = std::min(nextDue, it->due);
+				++it;
+				continue;
+			}
+
+			CURL* easy = nullptr;
+			if (idle.empty()) {
+				easy = curl_easy_init();
+			} else {
+				easy = idle.back();
+				idle.pop_back();
+			}
+
+			curl_easy_setopt(easy, CURLOPT_URL, it->url.c_str());
+			curl_easy_setopt(easy, CURLOPT_COPYPOSTFIELDS, it->body.c_str());
+			curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+			curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, discardResponse);
+			curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, REQUEST_TIMEOUT_MS);
+			curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+			curl_multi_add_handle(handle, easy);
+
+			active.emplace_back(easy, std::move(*it));
+			it = requests.erase(it);
+		}
+
+		if (active.empty()) {
+			// nothing on the way, until a request comes in or a retry is due
+			if (requests.empty()) {
+				requestSignal.wait(lockGuard, [this]() { return !requests.empty() || getState() == THREAD_STATE_TERMINATED; });
+			} else {
+				requestSignal.wait_until(lockGuard, nextDue, [this]() { return getState() == THREAD_STATE_TERMINATED; });
+			}
+			continue;
+		}
+
+		lockGuard.unlock();
+
+		int running = 0;
+		curl_multi_perform(handle, &running);
+
+		int messages = 0;
+		while (CURLMsg* message = curl_multi_info_read(handle, &messages)) {
+			if (message->msg != CURLMSG_DONE) {
+				continue;
+			}
+
+			CURL* easy = message->easy_handle;
+			long status = 0;
+			curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+			const CURLcode result = message->data.result;
+			curl_multi_remove_handle(handle, easy);
+			idle.push_back(easy);
+
+			auto it = std::find_if(active.begin(), active.end(), [easy](const auto& transfer) { return transfer.first == easy; });
+			done.push_back({std::move(it->second), result, status});
+			active.erase(it);
+		}
+
+		// woken early by curl_multi_wakeup when a request comes in
+		if (running > 0) {
+			curl_multi_poll(handle, nullptr, 0, 100, nullptr);
+		}
+
+		lockGuard.lock();
+		for (Done& transfer : done) {
+			if (finish(transfer.request, transfer.result, transfer.status)) {
+				requests.push_back(std::move(transfer.request));
+			}
+		}
+		done.clear();
+	}
+	multi = nullptr;
+	lockGuard.unlock();
+
+	for (CURL* easy : idle) {
+		curl_easy_cleanup(easy);
+	}
+	curl_multi_cleanup(handle);
+	curl_slist_free_all(headers);
+}
+
+bool Webhooks::finish(Request& request, CURLcode result, long status)
+{
+	if (result == CURLE_OK && status >= 200 && status < 300) {
+		++stats.sent;
+		return false;
+	}
+
+	// the endpoint could not be reached, is busy or limits the rate
+	const bool transient = result != CURLE_OK || status == 429 || status >= 500;
+	if (transient && ++request.attempts < MAX_ATTEMPTS && getState() != THREAD_STATE_TERMINATED) {
+		request.due = Clock::now() + FIRST_RETRY_DELAY * (1 << (request.attempts - 1));
+		++stats.retried;
+		return true;
+	}
+
+	++stats.failed;
+	if (result != CURLE_OK) {
+		std::cout << "[Warning - Webhooks::finish] Request failed - reason: " << curl_easy_strerror(result) << std::endl;
+	} else {
+		std::cout << "[Warning - Webhooks::finish] Request failed - HTTP status: " << status << std::endl;
+	}
+	return false;
+}
@@ -0,0 +1,68 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_WEBHOOKS_H
+#define FS_WEBHOOKS_H
+
+#include "thread_holder_base.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <curl/curl.h>
+
+// Posts JSON bodies to webhook urls from a thread of its own. All requests
+// share one curl multi handle, which keeps the connections to a host alive
+// between requests and runs several of them at once. A request that fails
+// to connect, or gets a 429 or 5xx answer, is tried again with a growing
+// delay. The queue is bounded: once it is full, new requests are dropped
+// and counted instead of backing up behind a slow endpoint.
+class Webhooks : public ThreadHolder<Webhooks>
+{
+	public:
+		struct Stats
+		{
+			uint64_t sent = 0;
+			uint64_t failed = 0;
+			uint64_t retried = 0;
+			uint64_t dropped = 0;
+			size_t queued = 0;
+		};
+
+		// any thread, false if the request was dropped
+		bool send(std::string url, std::string body);
+
+		Stats getStats();
+
+		// sends what is queued, without retries, and stops the thread
+		void shutdown();
+
+		void threadMain();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Request
+		{
+			std::string url;
+			std::string body;
+			Clock::time_point due;
+			uint8_t attempts = 0;
+		};
+
+		// false if the request is done, true if it should be tried again
+		bool finish(Request& request, CURLcode result, long status);
+
+		std::mutex requestLock;
+		std::condition_variable requestSignal;
+		std::deque<Request> requests;
+		CURLM* multi = nullptr;
+		Stats stats;
+};
+
+extern Webhooks g_webhooks;
+
+#endif
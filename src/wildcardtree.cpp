@@ -3,100 +3,140 @@
 
 #include "otpch.h"
 
-#include <stack>
-
 #include "wildcardtree.h"
 
-WildcardTreeNode* WildcardTreeNode::getChild(char ch)
+std::vector<WildcardTreeNode>::iterator WildcardTreeNode::findChild(char ch)
 {
-	auto it = children.find(ch);
-	if (it == children.end()) {
-		return nullptr;
+	auto it = std::lower_bound(children.begin(), children.end(), ch, [](const WildcardTreeNode& child, char ch) {
+		return child.label.front() < ch;
+	});
+	if (it == children.end() || it->label.front() != ch) {
+		return children.end();
 	}
-	return &it->second;
+	return it;
 }
 
-const WildcardTreeNode* WildcardTreeNode::getChild(char ch) const
+std::vector<WildcardTreeNode>::const_iterator WildcardTreeNode::findChild(char ch) const
 {
-	auto it = children.find(ch);
-	if (it == children.end()) {
-		return nullptr;
+	auto it = std::lower_bound(children.begin(), children.end(), ch, [](const WildcardTreeNode& child, char ch) {
+		return child.label.front() < ch;
+	});
+	if (it == children.end() || it->label.front() != ch) {
+		return children.end();
 	}
-	return &it->second;
+	return it;
 }
 
-WildcardTreeNode* WildcardTreeNode::addChild(char ch, bool breakpoint)
+void WildcardTreeNode::mergeChild()
 {
-	WildcardTreeNode* child = getChild(ch);
-	if (child) {
-		if (breakpoint && !child->breakpoint) {
-			child->breakpoint = true;
-		}
-	} else {
-		auto pair = children.emplace(std::piecewise_construct,
-				std::forward_as_tuple(ch), std::forward_as_tuple(breakpoint));
-		child = &pair.first->second;
-	}
-	return child;
+	WildcardTreeNode child = std::move(children.front());
+	label += child.label;
+	breakpoint = child.breakpoint;
+	children = std::move(child.children);
 }
 
 void WildcardTreeNode::insert(const std::string& str)
 {
+	if (str.empty()) {
+		return;
+	}
+
 	WildcardTreeNode* cur = this;
+	size_t pos = 0;
+	while (pos < str.length()) {
+		auto it = cur->findChild(str[pos]);
+		if (it == cur->children.end()) {
+			auto at = std::lower_bound(cur->children.begin(), cur->children.end(), str[pos], [](const WildcardTreeNode& child, char ch) {
+				return child.label.front() < ch;
+			});
+			cur->children.insert(at, WildcardTreeNode(str.substr(pos), true));
+			return;
+		}
 
-	size_t length = str.length() - 1;
-	for (size_t pos = 0; pos < length; ++pos) {
-		cur = cur->addChild(str[pos], false);
+		const std::string& childLabel = it->label;
+		size_t common = 1;
+		while (common < childLabel.length() && pos + common < str.length() && childLabel[common] == str[pos + common]) {
+			++common;
+		}
+
+		if (common < childLabel.length()) {
+			// split the child where the names part
+			WildcardTreeNode tail = std::move(*it);
+			*it = WildcardTreeNode(tail.label.substr(0, common), false);
+			tail.label.erase(0, common);
+			it->children.push_back(std::move(tail));
+		}
+
+		cur = &*it;
+		pos += common;
 	}
 
-	cur->addChild(str[length], true);
+	cur->breakpoint = true;
 }
 
 void WildcardTreeNode::remove(const std::string& str)
 {
-	WildcardTreeNode* cur = this;
+	std::vector<WildcardTreeNode*> path;
+	path.push_back(this);
 
-	std::stack<WildcardTreeNode*> path;
-	path.push(cur);
-	size_t len = str.length();
-	for (size_t pos = 0; pos < len; ++pos) {
-		cur = cur->getChild(str[pos]);
-		if (!cur) {
+	WildcardTreeNode* cur = this;
+	size_t pos = 0;
+	while (pos < str.length()) {
+		auto it = cur->findChild(str[pos]);
+		if (it == cur->children.end() || str.compare(pos, it->label.length(), it->label) != 0) {
 			return;
 		}
-		path.push(cur);
-	}
 
-	cur->breakpoint = false;
+		pos += it->label.length();
+		cur = &*it;
+		path.push_back(cur);
+	}
 
-	do {
-		cur = path.top();
-		path.pop();
+	if (path.size() == 1 || !cur->breakpoint) {
+		return;
+	}
 
-		if (!cur->children.empty() || cur->breakpoint || path.empty()) {
-			break;
-		}
+	cur->breakpoint = false;
+	if (cur->children.size() == 1) {
+		cur->mergeChild();
+		return;
+	}
 
-		cur = path.top();
+	if (!cur->children.empty()) {
+		return;
+	}
 
-		auto it = cur->children.find(str[--len]);
-		if (it != cur->children.end()) {
-			cur->children.erase(it);
-		}
-	} while (true);
+	// the node is no name and leads to none, it goes and takes a node that only led to it along
+	WildcardTreeNode* parent = path[path.size() - 2];
+	parent->children.erase(parent->findChild(cur->label.front()));
+	if (parent != this && parent->children.size() == 1 && !parent->breakpoint) {
+		parent->mergeChild();
+	}
 }
 
 ReturnValue WildcardTreeNode::findOne(const std::string& query, std::string& result) const
 {
 	const WildcardTreeNode* cur = this;
-	for (char pos : query) {
-		cur = cur->getChild(pos);
-		if (!cur) {
+	size_t pos = 0;
+	size_t matched = 0;
+	while (pos < query.length()) {
+		auto it = cur->findChild(query[pos]);
+		if (it == cur->children.end()) {
 			return RETURNVALUE_PLAYERWITHTHISNAMEISNOTONLINE;
 		}
+
+		matched = std::min(it->label.length(), query.length() - pos);
+		if (query.compare(pos, matched, it->label, 0, matched) != 0) {
+			return RETURNVALUE_PLAYERWITHTHISNAMEISNOTONLINE;
+		}
+
+		pos += matched;
+		cur = &*it;
 	}
 
+	// the query may end inside a label, the rest of it is the only way on
 	result = query;
+	result.append(cur->label, matched);
 
 	do {
 		size_t size = cur->children.size();
@@ -106,8 +146,7 @@ ReturnValue WildcardTreeNode::findOne(const std::string& query, std::string& res
 			return RETURNVALUE_NAMEISTOOAMBIGUOUS;
 		}
 
-		auto it = cur->children.begin();
-		result += it->first;
-		cur = &it->second;
+		cur = &cur->children.front();
+		result += cur->label;
 	} while (true);
 }
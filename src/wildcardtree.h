@@ -6,27 +6,35 @@
 
 #include "enums.h"
 
+// A radix tree of names: a node holds the run of characters leading to it
+// from its parent, and its children sorted by their first character.
 class WildcardTreeNode
 {
 	public:
 		explicit WildcardTreeNode(bool breakpoint) : breakpoint(breakpoint) {}
 		WildcardTreeNode(WildcardTreeNode&& other) = default;
+		WildcardTreeNode& operator=(WildcardTreeNode&& other) = default;
 
 		// non-copyable
 		WildcardTreeNode(const WildcardTreeNode&) = delete;
 		WildcardTreeNode& operator=(const WildcardTreeNode&) = delete;
 
-		WildcardTreeNode* getChild(char ch);
-		const WildcardTreeNode* getChild(char ch) const;
-		WildcardTreeNode* addChild(char ch, bool breakpoint);
-
 		void insert(const std::string& str);
 		void remove(const std::string& str);
 
 		ReturnValue findOne(const std::string& query, std::string& result) const;
 
 	private:
-		std::map<char, WildcardTreeNode> children;
+		WildcardTreeNode(std::string label, bool breakpoint) : label(std::move(label)), breakpoint(breakpoint) {}
+
+		std::vector<WildcardTreeNode>::iterator findChild(char ch);
+		std::vector<WildcardTreeNode>::const_iterator findChild(char ch) const;
+
+		// takes over the only child, a node that is no name with one child is a node too many
+		void mergeChild();
+
+		std::string label;
+		std::vector<WildcardTreeNode> children;
 		bool breakpoint;
 };
 
@@ -0,0 +1,198 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#include "otpch.h"
+
+#include "worldbus.h"
+
+#include "chat.h"
+#include "configmanager.h"
+#include "databasetasks.h"
+#include "game.h"
+#include "scheduler.h"
+
+#include <fmt/format.h>
+
+extern Chat* g_chat;
+extern ConfigManager g_config;
+extern Game g_game;
+
+WorldBus g_worldBus;
+
+namespace {
+
+// a world reads at most this many messages at a time, the rest with the next read
+constexpr uint32_t MESSAGES_PER_READ = 500;
+
+// nobody reads the messages older than this
+constexpr int64_t MESSAGE_LIFETIME = 60;
+
+}
+
+void WorldBus::load()
+{
+	worldId = g_config.getNumber(ConfigManager::WORLD_ID);
+	if (worldId == 0) {
+		return;
+	}
+
+	Database& db = Database::getInstance();
+	if (DBResult_ptr result = db.storeQuery("SELECT `id`, `name`, `ip`, `port` FROM `worlds` ORDER BY `id` LIMIT 255")) {
+		do {
+			worlds.push_back({result->getNumber<uint32_t>("id"), std::string(result->getString("name")), std::string(result->getString("ip")), result->getNumber<uint16_t>("port")});
+		} while (result->next());
+	}
+
+	// what was written before this world came up is for the others
+	if (DBResult_ptr result = db.storeQuery("SELECT MAX(`id`) AS `id` FROM `world_messages`")) {
+		lastMessageId = result->getNumber<uint64_t>("id");
+	}
+
+	if (DBResult_ptr result = db.storeQuery(fmt::format("SELECT `p`.`id`, `p`.`name` FROM `players_online` AS `o` JOIN `players` AS `p` ON `p`.`id` = `o`.`player_id` WHERE `p`.`world_id` != {:d}", worldId))) {
+		do {
+			const uint32_t guid = result->getNumber<uint32_t>("id");
+			std::string name(result->getString("name"));
+			remoteNames[asLowerCaseString(name)] = guid;
+			remotePlayers.emplace(guid, std::move(name));
+		} while (result->next());
+	}
+
+	std::cout << ">> World " << worldId << " of " << worlds.size() << ", " << remotePlayers.size() << " players online on the others" << std::endl;
+}
+
+void WorldBus::start()
+{
+	if (!isEnabled() || started) {
+		return;
+	}
+
+	started = true;
+	poll();
+}
+
+uint8_t WorldBus::getWorldIndex(uint32_t world) const
+{
+	uint8_t own = 0;
+	for (size_t i = 0; i < worlds.size(); ++i) {
+		if (worlds[i].id == world) {
+			return i;
+		}
+		if (worlds[i].id == worldId) {
+			own = i;
+		}
+	}
+	return own;
+}
+
+bool WorldBus::isRemoteOnline(const std::string& name) const
+{
+	return remoteNames.contains(asLowerCaseString(name));
+}
+
+void WorldBus::publishPresence(const PlayerConstPtr& player, bool online)
+{
+	// simulated players have no character
+	if (player->getGUID() == 0) {
+		return;
+	}
+	publish(WORLD_MESSAGE_PRESENCE, player->getGUID(), "", player, online ? 1 : 0, "");
+}
+
+void WorldBus::publishPrivateMessage(const PlayerConstPtr& speaker, SpeakClasses type, const std::string& receiver, const std::string& text)
+{
+	publish(WORLD_MESSAGE_PRIVATE, 0, receiver, speaker, type, text);
+}
+
+void WorldBus::publishGuildMessage(uint32_t guildId, const PlayerConstPtr& speaker, SpeakClasses type, const std::string& text)
+{
+	publish(WORLD_MESSAGE_GUILD, guildId, "", speaker, type, text);
+}
+
+void WorldBus::publish(WorldMessage_t type, uint32_t target, const std::string& receiver, const PlayerConstPtr& speaker, uint8_t talkType, const std::string& text)
+{
+	if (!isEnabled()) {
+		return;
+	}
+
+	Database& db = Database::getInstance();
+	g_databaseTasks.addTask(fmt::format("INSERT INTO `world_messages` (`origin`, `type`, `target`, `receiver`, `sender`, `level`, `talktype`, `text`, `created_at`) VALUES ({:d}, {:d}, {:d}, {:s}, {:s}, {:d}, {:d}, {:s}, {:d})",
+		worldId, static_cast<uint8_t>(type), target, db.escapeString(receiver), db.escapeString(speaker->getName()), speaker->getLevel(), talkType, db.escapeString(text), time(nullptr)));
+}
+
+void WorldBus::poll()
+{
+	const int64_t now = OTSYS_TIME();
+	const bool cleanup = now >= nextCleanup;
+	if (cleanup) {
+		nextCleanup = now + MESSAGE_LIFETIME * 1000;
+	}
+
+	auto result = std::make_shared<DBResult_ptr>();
+	const bool queued = g_databaseTasks.addJob([result, after = lastMessageId, cleanup](Database& db) {
+		if (cleanup) {
+			db.executeQuery(fmt::format("DELETE FROM `world_messages` WHERE `created_at` < {:d}", time(nullptr) - MESSAGE_LIFETIME));
+		}
+		*result = db.storeQuery(fmt::format("SELECT `id`, `origin`, `type`, `target`, `receiver`, `sender`, `level`, `talktype`, `text` FROM `world_messages` WHERE `id` > {:d} ORDER BY `id` LIMIT {:d}", after, MESSAGES_PER_READ));
+		return true;
+	}, [this, result](bool) {
+		if (*result) {
+			deliver(*result);
+		}
+		g_scheduler.addEvent(createSchedulerTask(std::max<int32_t>(50, g_config.getNumber(ConfigManager::WORLD_BUS_INTERVAL)), [this]() { poll(); }));
+	}, 0, DISPATCHER_LANE_PLAYER);
+
+	// the server is going down
+	if (!queued) {
+		started = false;
+	}
+}
+
+void WorldBus::deliver(const DBResult_ptr& result)
+{
+	do {
+		lastMessageId = std::max(lastMessageId, result->getNumber<uint64_t>("id"));
+		if (result->getNumber<uint32_t>("origin") == worldId) {
+			continue;
+		}
+
+		const uint32_t target = result->getNumber<uint32_t>("target");
+		const std::string sender(result->getString("sender"));
+		const uint16_t level = result->getNumber<uint16_t>("level");
+		const uint8_t talkType = result->getNumber<uint8_t>("talktype");
+
+		switch (result->getNumber<uint8_t>("type")) {
+			case WORLD_MESSAGE_PRESENCE: {
+				const VipStatus_t status = talkType != 0 ? VIPSTATUS_ONLINE : VIPSTATUS_OFFLINE;
+				if (status == VIPSTATUS_ONLINE) {
+					remoteNames[asLowerCaseString(sender)] = target;
+					remotePlayers[target] = sender;
+				} else {
+					remoteNames.erase(asLowerCaseString(sender));
+					remotePlayers.erase(target);
+				}
+
+				for (const auto& it : g_game.getPlayers()) {
+					it.second->notifyStatusChange(target, sender, status);
+				}
+				break;
+			}
+
+			case WORLD_MESSAGE_PRIVATE: {
+				if (const auto player = g_game.getPlayerByName(std::string(result->getString("receiver")))) {
+					player->sendPrivateMessage(sender, level, static_cast<SpeakClasses>(talkType), std::string(result->getString("text")));
+				}
+				break;
+			}
+
+			case WORLD_MESSAGE_GUILD: {
+				if (ChatChannel* channel = g_chat->getGuildChannelById(target)) {
+					channel->talk(sender, level, static_cast<SpeakClasses>(talkType), std::string(result->getString("text")));
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	} while (result->next());
+}
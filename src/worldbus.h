@@ -0,0 +1,88 @@
+// Copyright 2024 Black Tek Server Authors. All rights reserved.
+// Use of this source code is governed by the GPL-2.0 License that can be found in the LICENSE file.
+
+#ifndef FS_WORLDBUS_H
+#define FS_WORLDBUS_H
+
+#include "const.h"
+#include "database.h"
+#include "declarations.h"
+
+#include <gtl/phmap.hpp>
+
+struct WorldInfo
+{
+	uint32_t id;
+	std::string name;
+	std::string ip;
+	uint16_t port;
+};
+
+enum WorldMessage_t : uint8_t
+{
+	WORLD_MESSAGE_PRESENCE,
+	WORLD_MESSAGE_PRIVATE,
+	WORLD_MESSAGE_GUILD,
+};
+
+// With worldId set, every world is a process of its own on the one database.
+// The login server of any of them lists the worlds of the `worlds` table and
+// sends each character to the world of its `world_id`, a world only lets in
+// its own characters. The worlds tell each other who logs in and out, private
+// messages to players on another world and what is said in guild channels
+// through the `world_messages` table, each of them reads what the others
+// wrote every worldBusInterval milliseconds. The messages are best effort,
+// a world that is down when they are written does not get them later.
+class WorldBus
+{
+	public:
+		// dispatcher thread, at startup, reads the worlds and who is online on the others
+		void load();
+		// reads the messages of the other worlds from now on
+		void start();
+
+		bool isEnabled() const {
+			return worldId != 0;
+		}
+
+		uint32_t getWorldId() const {
+			return worldId;
+		}
+
+		// by id, empty with a single world
+		const std::vector<WorldInfo>& getWorlds() const {
+			return worlds;
+		}
+
+		// the index of world in getWorlds, this world for an unknown one
+		uint8_t getWorldIndex(uint32_t world) const;
+
+		// dispatcher thread, about players on the other worlds
+		bool isRemoteOnline(uint32_t guid) const {
+			return remotePlayers.contains(guid);
+		}
+		bool isRemoteOnline(const std::string& name) const;
+
+		// dispatcher thread, written on the database thread
+		void publishPresence(const PlayerConstPtr& player, bool online);
+		void publishPrivateMessage(const PlayerConstPtr& speaker, SpeakClasses type, const std::string& receiver, const std::string& text);
+		void publishGuildMessage(uint32_t guildId, const PlayerConstPtr& speaker, SpeakClasses type, const std::string& text);
+
+	private:
+		void publish(WorldMessage_t type, uint32_t target, const std::string& receiver, const PlayerConstPtr& speaker, uint8_t talkType, const std::string& text);
+		void poll();
+		void deliver(const DBResult_ptr& result);
+
+		std::vector<WorldInfo> worlds;
+		// guid and name of the players online on the other worlds
+		gtl::flat_hash_map<uint32_t, std::string> remotePlayers;
+		gtl::flat_hash_map<std::string, uint32_t> remoteNames;
+		uint64_t lastMessageId = 0;
+		int64_t nextCleanup = 0;
+		uint32_t worldId = 0;
+		bool started = false;
+};
+
+extern WorldBus g_worldBus;
+
+#endif
@@ -8,8 +8,149 @@
 #include <array>
 #include <assert.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace xtea {
 
+namespace {
+
+// blocks are independent, so the vector paths run the rounds on four blocks
+// at once with the left and right halves split into separate lanes
+constexpr size_t VECTOR_BLOCKS = 4;
+constexpr size_t BLOCK_SIZE = 8;
+
+void encryptBlock(uint8_t* it, const round_keys& k)
+{
+	uint32_t left, right;
+	std::memcpy(&left, it, 4);
+	std::memcpy(&right, it + 4, 4);
+
+	for (size_t i = 0; i < k.size(); i += 2) {
+		left += ((right << 4 ^ right >> 5) + right) ^ k[i];
+		right += ((left << 4 ^ left >> 5) + left) ^ k[i + 1];
+	}
+
+	std::memcpy(it, &left, 4);
+	std::memcpy(it + 4, &right, 4);
+}
+
+void decryptBlock(uint8_t* it, const round_keys& k)
+{
+	uint32_t left, right;
+	std::memcpy(&left, it, 4);
+	std::memcpy(&right, it + 4, 4);
+
+	for (size_t i = k.size(); i > 0; i -= 2) {
+		right -= ((left << 4 ^ left >> 5) + left) ^ k[i - 1];
+		left -= ((right << 4 ^ right >> 5) + right) ^ k[i - 2];
+	}
+
+	std::memcpy(it, &left, 4);
+	std::memcpy(it + 4, &right, 4);
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+inline __m128i mix(__m128i v)
+{
+	return _mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(v, 4), _mm_srli_epi32(v, 5)), v);
+}
+
+// splits two registers of interleaved blocks into their left and right halves
+inline void load(const uint8_t* it, __m128i& left, __m128i& right)
+{
+	const __m128 low = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(it)));
+	const __m128 high = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(it + 16)));
+	left = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+	right = _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+inline void store(uint8_t* it, __m128i left, __m128i right)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(it), _mm_unpacklo_epi32(left, right));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(it + 16), _mm_unpackhi_epi32(left, right));
+}
+
+size_t encryptBlocks(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t offset = 0;
+	for (; offset + VECTOR_BLOCKS * BLOCK_SIZE <= length; offset += VECTOR_BLOCKS * BLOCK_SIZE) {
+		__m128i left, right;
+		load(data + offset, left, right);
+		for (size_t i = 0; i < k.size(); i += 2) {
+			left = _mm_add_epi32(left, _mm_xor_si128(mix(right), _mm_set1_epi32(k[i])));
+			right = _mm_add_epi32(right, _mm_xor_si128(mix(left), _mm_set1_epi32(k[i + 1])));
+		}
+		store(data + offset, left, right);
+	}
+	return offset;
+}
+
+size_t decryptBlocks(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t offset = 0;
+	for (; offset + VECTOR_BLOCKS * BLOCK_SIZE <= length; offset += VECTOR_BLOCKS * BLOCK_SIZE) {
+		__m128i left, right;
+		load(data + offset, left, right);
+		for (size_t i = k.size(); i > 0; i -= 2) {
+			right = _mm_sub_epi32(right, _mm_xor_si128(mix(left), _mm_set1_epi32(k[i - 1])));
+			left = _mm_sub_epi32(left, _mm_xor_si128(mix(right), _mm_set1_epi32(k[i - 2])));
+		}
+		store(data + offset, left, right);
+	}
+	return offset;
+}
+#elif defined(__aarch64__)
+inline uint32x4_t mix(uint32x4_t v)
+{
+	return vaddq_u32(veorq_u32(vshlq_n_u32(v, 4), vshrq_n_u32(v, 5)), v);
+}
+
+size_t encryptBlocks(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t offset = 0;
+	for (; offset + VECTOR_BLOCKS * BLOCK_SIZE <= length; offset += VECTOR_BLOCKS * BLOCK_SIZE) {
+		// vld2 splits the interleaved halves itself
+		uint32x4x2_t v = vld2q_u32(reinterpret_cast<const uint32_t*>(data + offset));
+		for (size_t i = 0; i < k.size(); i += 2) {
+			v.val[0] = vaddq_u32(v.val[0], veorq_u32(mix(v.val[1]), vdupq_n_u32(k[i])));
+			v.val[1] = vaddq_u32(v.val[1], veorq_u32(mix(v.val[0]), vdupq_n_u32(k[i + 1])));
+		}
+		vst2q_u32(reinterpret_cast<uint32_t*>(data + offset), v);
+	}
+	return offset;
+}
+
+size_t decryptBlocks(uint8_t* data, size_t length, const round_keys& k)
+{
+	size_t offset = 0;
+	for (; offset + VECTOR_BLOCKS * BLOCK_SIZE <= length; offset += VECTOR_BLOCKS * BLOCK_SIZE) {
+		uint32x4x2_t v = vld2q_u32(reinterpret_cast<const uint32_t*>(data + offset));
+		for (size_t i = k.size(); i > 0; i -= 2) {
+			v.val[1] = vsubq_u32(v.val[1], veorq_u32(mix(v.val[0]), vdupq_n_u32(k[i - 1])));
+			v.val[0] = vsubq_u32(v.val[0], veorq_u32(mix(v.val[1]), vdupq_n_u32(k[i - 2])));
+		}
+		vst2q_u32(reinterpret_cast<uint32_t*>(data + offset), v);
+	}
+	return offset;
+}
+#else
+size_t encryptBlocks(uint8_t*, size_t, const round_keys&)
+{
+	return 0;
+}
+
+size_t decryptBlocks(uint8_t*, size_t, const round_keys&)
+{
+	return 0;
+}
+#endif
+
+} // namespace
+
 round_keys expand_key(const key& k)
 {
 	constexpr uint32_t delta = 0x9E3779B9;
@@ -25,35 +166,15 @@ round_keys expand_key(const key& k)
 
 void encrypt(uint8_t* data, size_t length, const round_keys& k)
 {
-	for (int32_t i = 0; i < k.size(); i += 2) {
-		for (auto it = data, last = data + length; it < last; it += 8) {
-			uint32_t left, right;
-			std::memcpy(&left, it, 4);
-			std::memcpy(&right, it + 4, 4);
-
-			left += ((right << 4 ^ right >> 5) + right) ^ k[i];
-			right += ((left << 4 ^ left >> 5) + left) ^ k[i + 1];
-
-			std::memcpy(it, &left, 4);
-			std::memcpy(it + 4, &right, 4);
-		}
+	for (size_t offset = encryptBlocks(data, length, k); offset < length; offset += BLOCK_SIZE) {
+		encryptBlock(data + offset, k);
 	}
 }
 
 void decrypt(uint8_t* data, size_t length, const round_keys& k)
 {
-	for (int32_t i = k.size() - 1; i > 0; i -= 2) {
-		for (auto it = data, last = data + length; it < last; it += 8) {
-			uint32_t left, right;
-			std::memcpy(&left, it, 4);
-			std::memcpy(&right, it + 4, 4);
-
-			right -= ((left << 4 ^ left >> 5) + left) ^ k[i];
-			left -= ((right << 4 ^ right >> 5) + right) ^ k[i - 1];
-
-			std::memcpy(it, &left, 4);
-			std::memcpy(it + 4, &right, 4);
-		}
+	for (size_t offset = decryptBlocks(data, length, k); offset < length; offset += BLOCK_SIZE) {
+		decryptBlock(data + offset, k);
 	}
 }
 
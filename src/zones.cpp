@@ -5,11 +5,63 @@
 #include "configmanager.h"
 
 #include <toml++/toml.hpp>
+#include <gtl/phmap.hpp>
 
 extern ConfigManager g_config;
 
 std::vector<Zone> g_zones = { Zone(0) };
-std::multimap<Position, int> p_zones = {};
+
+namespace {
+
+// Every tile in a zone refers to the set of zones it is in, each distinct set
+// of zone ids is kept once however many tiles share it. Set 0 is empty.
+std::vector<std::vector<int>> zoneSets = { {} };
+std::map<std::vector<int>, uint32_t> zoneSetIds;
+// the set a tile moves to when a zone is added to the set it is in
+gtl::flat_hash_map<uint64_t, uint32_t> zoneSetAdditions;
+gtl::flat_hash_map<uint64_t, uint32_t> p_zones;
+
+uint64_t positionKey(const Position& position)
+{
+	return static_cast<uint64_t>(position.x) | (static_cast<uint64_t>(position.y) << 16) | (static_cast<uint64_t>(position.z) << 32);
+}
+
+uint32_t getZoneSet(const Position& position)
+{
+	const auto it = p_zones.find(positionKey(position));
+	return it != p_zones.end() ? it->second : 0;
+}
+
+uint32_t addToZoneSet(uint32_t set, int id)
+{
+	const uint64_t additionKey = (static_cast<uint64_t>(set) << 32) | static_cast<uint32_t>(id);
+	if (const auto it = zoneSetAdditions.find(additionKey); it != zoneSetAdditions.end()) {
+		return it->second;
+	}
+
+	std::vector<int> ids = zoneSets[set];
+	if (const auto it = std::lower_bound(ids.begin(), ids.end(), id); it == ids.end() || *it != id) {
+		ids.insert(it, id);
+	}
+
+	auto [it, inserted] = zoneSetIds.try_emplace(ids, static_cast<uint32_t>(zoneSets.size()));
+	if (inserted) {
+		zoneSets.push_back(std::move(ids));
+	}
+	zoneSetAdditions.emplace(additionKey, it->second);
+	return it->second;
+}
+
+void addPositionsToZone(const std::vector<Position>& positions, int id)
+{
+	p_zones.reserve(p_zones.size() + positions.size());
+	for (const auto& position : positions) {
+		uint32_t& set = p_zones[positionKey(position)];
+		set = addToZoneSet(set, id);
+	}
+}
+
+}
 
 size_t Zones::count()
 {
@@ -29,15 +81,19 @@ Zone& Zones::getZone(int id)
 
 std::vector<int> Zones::getZonesByPosition(const Position& position)
 {
-	std::vector<int> result;
-	auto range = p_zones.equal_range(position);
+	const auto ids = getZoneIdsByPosition(position);
+	return { ids.begin(), ids.end() };
+}
 
-	for (auto& it = range.first; it != range.second; ++it)
-	{
-		result.push_back(it->second);
-	}
+std::span<const int> Zones::getZoneIdsByPosition(const Position& position)
+{
+	return zoneSets[getZoneSet(position)];
+}
 
-	return result;
+bool Zones::sameZones(const Position& from, const Position& to)
+{
+	// sets are kept once each, the same zones are the same set
+	return getZoneSet(from) == getZoneSet(to);
 }
 
 bool Zones::registerZone(Zone zone)
@@ -53,10 +109,7 @@ bool Zones::registerZone(Zone zone)
 		zones.resize(static_cast<std::vector<Zone, std::allocator<Zone>>::size_type>(zone.id) + 1);
 	}
 
-	for (const auto& position : zone.positions)
-	{
-		p_zones.insert(std::make_pair(position, zone.id));
-	}
+	addPositionsToZone(zone.positions, zone.id);
 
 	zones[zone.id] = std::move(zone);
 	return true;
@@ -78,10 +131,7 @@ Zone& Zones::createZone(int id, std::vector<Position> positions)
 		zones.resize(static_cast<std::vector<Zone, std::allocator<Zone>>::size_type>(id) + 1);
 	}
 
-	for (const auto& position : positions)
-	{
-		p_zones.insert(std::make_pair(position, id));
-	}
+	addPositionsToZone(positions, id);
 
 	newZone.positions = std::move(positions);
 	auto& zoneRef = zones[id] = std::move(newZone);
@@ -158,6 +208,9 @@ void Zones::clear()
 {
 	g_zones.clear();
 	p_zones.clear();
+	zoneSets = { {} };
+	zoneSetIds.clear();
+	zoneSetAdditions.clear();
 }
 
 void Zones::reload()
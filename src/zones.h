@@ -6,6 +6,8 @@
 #include "otpch.h"
 #include "position.h"
 
+#include <span>
+
 struct Zone {
 	Zone() : id(0) {}
 	Zone(int id) : id(id) {};
@@ -24,4 +26,8 @@ public:
 	static std::vector<Zone>& get();
 	static Zone& getZone(int id);
 	static std::vector<int> getZonesByPosition(const Position& position);
+	// the zone ids at position, valid until a zone is created or the zones reload
+	static std::span<const int> getZoneIdsByPosition(const Position& position);
+	// true when both positions are in exactly the same zones
+	static bool sameZones(const Position& from, const Position& to);
 };
\ No newline at end of file